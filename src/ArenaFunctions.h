@@ -0,0 +1,130 @@
+//SPDX-FileCopyrightText: 2023 Matthew Millard millard.matthew@gmail.com
+//SPDX-License-Identifier: MIT
+
+#ifndef ARENA_FUNCTIONS
+#define ARENA_FUNCTIONS
+
+#include <memory>
+#include <vector>
+#include <cstddef>
+#include <optional>
+#include <algorithm>
+#include <memory_resource>
+
+/*
+  A monotonic arena, one per thread, for the short-lived scratch data of the
+  ticker that the thread is evaluating. Allocations from the arena are a
+  pointer bump and frees are free: the whole arena is released at once when
+  the ticker is done. Containers that use it are std::pmr containers built
+  with getResource(), e.g.
+
+    ArenaFunctions::ScratchVector< double > w(x.size(),
+                                              ArenaFunctions::getResource());
+
+  Anything allocated from the arena must be destroyed before the TickerScope
+  that it was allocated in ends, and so scratch containers must not be
+  stored in a result. Outside of a TickerScope getResource returns the
+  default resource (the heap).
+*/
+class ArenaFunctions {
+
+  public:
+
+    template< typename T >
+    using ScratchVector = std::pmr::vector< T >;
+
+    //The size of the buffer that a thread starts with, and the largest size
+    //that the buffer of a thread is allowed to grow to
+    static constexpr size_t INITIAL_BUFFER_SIZE = 256*1024;
+    static constexpr size_t MAXIMUM_BUFFER_SIZE = 64*1024*1024;
+
+    //==========================================================================
+    /*
+      The heap, counting the bytes taken by an arena that has run out of
+      buffer.
+    */
+    class OverflowResource : public std::pmr::memory_resource{
+      public:
+        size_t bytesAllocated;
+        OverflowResource():bytesAllocated(0){};
+      private:
+        void* do_allocate(size_t bytes, size_t alignment) override {
+          bytesAllocated += bytes;
+          return std::pmr::new_delete_resource()->allocate(bytes,alignment);
+        };
+        void do_deallocate(void *p, size_t bytes, size_t alignment) override {
+          std::pmr::new_delete_resource()->deallocate(p,bytes,alignment);
+        };
+        bool do_is_equal(const std::pmr::memory_resource &other)
+          const noexcept override {
+          return this == &other;
+        };
+    };
+
+    //==========================================================================
+    struct TickerArena{
+      std::unique_ptr< std::byte[] > buffer;
+      size_t bufferSize;
+      OverflowResource overflow;
+      std::optional< std::pmr::monotonic_buffer_resource > resource;
+      TickerArena():bufferSize(0){};
+    };
+
+    //==========================================================================
+    static TickerArena& getThreadArena(){
+      thread_local TickerArena arena;
+      return arena;
+    };
+
+    //==========================================================================
+    static std::pmr::memory_resource* getResource(){
+      TickerArena &arena = getThreadArena();
+      if(arena.resource.has_value()){
+        return &(*arena.resource);
+      }
+      return std::pmr::get_default_resource();
+    };
+
+    //==========================================================================
+    /*
+      The arena of the calling thread is in use while this object exists.
+      When it ends everything in the arena is released and, if the ticker
+      needed more than the buffer, the buffer is enlarged so that the next
+      ticker of the same size does not touch the heap.
+    */
+    class TickerScope{
+      public:
+        TickerScope():arena(getThreadArena()),active(false){
+          if(arena.resource.has_value()){
+            return;
+          }
+          active = true;
+          if(!arena.buffer){
+            arena.bufferSize = INITIAL_BUFFER_SIZE;
+            arena.buffer.reset(new std::byte[arena.bufferSize]);
+          }
+          arena.overflow.bytesAllocated = 0;
+          arena.resource.emplace(arena.buffer.get(),arena.bufferSize,
+                                 &arena.overflow);
+        };
+        ~TickerScope(){
+          if(!active){
+            return;
+          }
+          arena.resource.reset();
+          if(arena.overflow.bytesAllocated > 0
+              && arena.bufferSize < MAXIMUM_BUFFER_SIZE){
+            arena.bufferSize = std::min(
+              arena.bufferSize + arena.overflow.bytesAllocated,
+              MAXIMUM_BUFFER_SIZE);
+            arena.buffer.reset(new std::byte[arena.bufferSize]);
+          }
+        };
+      private:
+        TickerArena &arena;
+        bool active;
+    };
+
+};
+
+#endif
@@ -4,6 +4,13 @@
 #ifndef DATA_STRUCTURES
 #define DATA_STRUCTURES
 
+#include <map>
+#include <cstdint>
+#include <algorithm>
+#include <limits>
+#include <string_view>
+#include <unordered_map>
+#include <initializer_list>
 #include "JsonFunctions.h"
 
 const char *GEN = "General";
@@ -66,6 +73,15 @@ class DataStructures {
                            dateNum(std::nan("1")){};                           
     };
     //============================================================================
+    //A family of funds, identified by a keyword in the fund name, whose 
+    //holdings are compared to the trading volume of a ticker. name is 
+    //prefixed to the fields written to the fund_liquidity_index.
+    struct FundLiquidityFamily{
+      std::string name;
+      std::string keyword;
+      int daysToAverageTradingVolumeOver;
+    };
+
     struct CalculationConfiguration{
       std::string eod_toolkit_config_folder;
       std::string default_spread_json_file;
@@ -84,6 +100,27 @@ class DataStructures {
       int number_of_years_of_growth;
       int number_of_years_used_in_growth_rate_calculation;
       int max_day_error;
+      //The axes of the grid of discounted cash flow scenarios. The offsets
+      //are added to the values of the ticker being evaluated.
+      std::vector< double > dcf_scenario_cost_of_capital_offsets;
+      std::vector< double > dcf_scenario_growth_offsets;
+      std::vector< int >    dcf_scenario_years_of_growth;
+      std::vector< double > dcf_scenario_terminal_growth_offsets;
+      //The Monte Carlo discounted free-cash-flow valuation. No paths are 
+      //evaluated if the number of paths is 0.
+      int monte_carlo_number_of_paths;
+      int monte_carlo_seed;
+      //The resampling of the price history before the price model is fitted
+      //(none, weekly, monthly, lttb). If error_report is true the model is
+      //also fitted to the full price history and the full resolution fit is
+      //used if the resampled fit differs from it by more than
+      //maximum_relative_error.
+      std::string price_model_resampling_method;
+      int price_model_resampling_maximum_number_of_points;
+      bool price_model_resampling_error_report;
+      double price_model_resampling_maximum_relative_error;
+      //The fund families used to evaluate the fund_liquidity_index
+      std::vector< FundLiquidityFamily > fund_liquidity_families;
 
       CalculationConfiguration():
         eod_toolkit_config_folder(""),
@@ -102,7 +139,18 @@ class DataStructures {
         number_of_years_to_average_capital_expenditures(-1),
         number_of_years_of_growth(-1),
         number_of_years_used_in_growth_rate_calculation(-1),
-        max_day_error(-1)
+        max_day_error(-1),
+        dcf_scenario_cost_of_capital_offsets({-0.02,-0.01,0.,0.01,0.02}),
+        dcf_scenario_growth_offsets({-0.04,-0.02,0.,0.02,0.04}),
+        dcf_scenario_years_of_growth({5,10}),
+        dcf_scenario_terminal_growth_offsets({-0.01,0.,0.01}),
+        monte_carlo_number_of_paths(10000),
+        monte_carlo_seed(0),
+        price_model_resampling_method("none"),
+        price_model_resampling_maximum_number_of_points(0),
+        price_model_resampling_error_report(false),
+        price_model_resampling_maximum_relative_error(0.05),
+        fund_liquidity_families({{"sp500_"," 500",28}})
         {};
       
       void load( const std::string &configurationFile, 
@@ -112,7 +160,13 @@ class DataStructures {
         nlohmann::ordered_json configData;
         bool validConfigFile = JsonFunctions::loadJsonFile(configurationFile,
                                                            configData, verbose);
+        loadFromJson(configData);
+      };
 
+      //The contents of a configuration file. The paths of the reference 
+      //files are relative to eod_toolkit_config_folder.
+      void loadFromJson(nlohmann::ordered_json configData)
+      {
         JsonFunctions::getJsonString(
             configData["eod_toolkit_config_folder"],
                         eod_toolkit_config_folder);  
@@ -195,6 +249,94 @@ class DataStructures {
             JsonFunctions::getJsonFloat(configData["max_day_error"])
           );
 
+        if(configData.contains("dcf_scenario_grid")){
+          nlohmann::ordered_json &grid = configData["dcf_scenario_grid"];
+          if(grid.contains("cost_of_capital_offsets")){
+            dcf_scenario_cost_of_capital_offsets.clear();
+            for(auto const &el : grid["cost_of_capital_offsets"]){
+              dcf_scenario_cost_of_capital_offsets.push_back(
+                JsonFunctions::getJsonFloat(el));
+            }
+          }
+          if(grid.contains("growth_offsets")){
+            dcf_scenario_growth_offsets.clear();
+            for(auto const &el : grid["growth_offsets"]){
+              dcf_scenario_growth_offsets.push_back(
+                JsonFunctions::getJsonFloat(el));
+            }
+          }
+          if(grid.contains("years_of_growth")){
+            dcf_scenario_years_of_growth.clear();
+            for(auto const &el : grid["years_of_growth"]){
+              dcf_scenario_years_of_growth.push_back(
+                static_cast<int>(JsonFunctions::getJsonFloat(el)));
+            }
+          }
+          if(grid.contains("terminal_growth_offsets")){
+            dcf_scenario_terminal_growth_offsets.clear();
+            for(auto const &el : grid["terminal_growth_offsets"]){
+              dcf_scenario_terminal_growth_offsets.push_back(
+                JsonFunctions::getJsonFloat(el));
+            }
+          }
+        }
+
+        if(configData.contains("monte_carlo_valuation")){
+          nlohmann::ordered_json &monteCarlo 
+            = configData["monte_carlo_valuation"];
+          if(monteCarlo.contains("number_of_paths")){
+            monte_carlo_number_of_paths = static_cast<int>(
+              JsonFunctions::getJsonFloat(monteCarlo["number_of_paths"]));
+          }
+          if(monteCarlo.contains("seed")){
+            monte_carlo_seed = static_cast<int>(
+              JsonFunctions::getJsonFloat(monteCarlo["seed"]));
+          }
+        }
+
+        if(configData.contains("price_model_resampling")){
+          nlohmann::ordered_json &resampling 
+            = configData["price_model_resampling"];
+          if(resampling.contains("method")){
+            JsonFunctions::getJsonString(resampling["method"],
+                                         price_model_resampling_method);
+          }
+          if(resampling.contains("maximum_number_of_points")){
+            price_model_resampling_maximum_number_of_points = 
+              static_cast<int>(JsonFunctions::getJsonFloat(
+                resampling["maximum_number_of_points"]));
+          }
+          if(resampling.contains("error_report")){
+            price_model_resampling_error_report =
+              JsonFunctions::getJsonBool(resampling["error_report"]);
+          }
+          if(resampling.contains("maximum_relative_error")){
+            price_model_resampling_maximum_relative_error =
+              JsonFunctions::getJsonFloat(
+                resampling["maximum_relative_error"]);
+          }
+        }
+
+        if(configData.contains("fund_liquidity_index")){
+          nlohmann::ordered_json &liquidity 
+            = configData["fund_liquidity_index"];
+          if(liquidity.contains("fund_families")){
+            fund_liquidity_families.clear();
+            for(auto &el : liquidity["fund_families"]){
+              FundLiquidityFamily family;
+              JsonFunctions::getJsonString(el["name"],family.name);
+              JsonFunctions::getJsonString(el["keyword"],family.keyword);
+              family.daysToAverageTradingVolumeOver = 28;
+              if(el.contains("days_to_average_trading_volume_over")){
+                family.daysToAverageTradingVolumeOver = static_cast<int>(
+                  JsonFunctions::getJsonFloat(
+                    el["days_to_average_trading_volume_over"]));
+              }
+              fund_liquidity_families.push_back(family);
+            }
+          }
+        }
+
       };
     };
     //============================================================================
@@ -397,6 +539,29 @@ class DataStructures {
       std::vector< EmpiricalGrowthModel > returnOnCapitalDeployedModel;
     };
 
+    //==========================================================================
+    struct EmpiricalGrowthModelCacheEntry{
+      bool validFitting;
+      EmpiricalGrowthModel model;
+      EmpiricalGrowthModelCacheEntry():
+        validFitting(false){};
+    };
+
+    //==========================================================================
+    // Models that have already been fitted, keyed by a hash of the data
+    // and settings that were used to fit them. previousFits is loaded from
+    // the last run, fits holds every model that was used in this run.
+    //==========================================================================
+    struct EmpiricalGrowthModelCache{
+      std::map< uint64_t, EmpiricalGrowthModelCacheEntry > previousFits;
+      std::map< uint64_t, EmpiricalGrowthModelCacheEntry > fits;
+      int numberOfReusedFits;
+      int numberOfNewFits;
+      EmpiricalGrowthModelCache():
+        numberOfReusedFits(0),
+        numberOfNewFits(0){};
+    };
+
     //==========================================================================
     struct EmpiricalGrowthSettings{
       int maxDateErrorInDays;
@@ -410,6 +575,9 @@ class DataStructures {
       int typeOfEmpiricalModel;
       double oldestValidDate;
       double newestValidDate;
+      EmpiricalGrowthModelCache *modelCache; //Optional: nullptr to refit
+      EmpiricalGrowthSettings():
+        modelCache(nullptr){};
     };
 
     //==========================================================================
@@ -616,8 +784,512 @@ class DataStructures {
         totalDebtEstimate(std::nan("1")){};
     };
 
+    //============================================================================
+    /*
+      The names of the terms that are written for every date of a ticker's 
+      analysis, in sorted order so that a name can be found with a binary 
+      search. The index of a term in this table is its index in every 
+      TermRecord, and so it is the same for every ticker and every run. 
+      Only the discounted cash flow terms, whose names are assembled from a 
+      prefix chosen at run time (e.g. priceToValueEmpirical_) and, for the 
+      projected years, a year suffix, are not in the table.
+    */
+    static constexpr std::string_view FIXED_TERM_NAMES[] = {
+      "PriestDividendMetrics_dividendFreeCashFlowRatio",
+      "PriestDividendMetrics_dividendFreeCashFlowRatioTrailingAverage",
+      "PriestDividendMetrics_dividendPayoutRatio",
+      "PriestDividendMetrics_dividendPayoutRatioTrailingAverage",
+      "PriestDividendMetrics_dividendYield",
+      "PriestDividendMetrics_dividendYieldGrowth",
+      "PriestDividendMetrics_dividendYieldGrowthAvg",
+      "PriestDividendMetrics_dividendsPaidGrowth",
+      "PriestDividendMetrics_dividendsPaidGrowthAvg",
+      "PriestDividendMetrics_freeCashFlowGrowth",
+      "PriestDividendMetrics_freeCashFlowGrowthAvg",
+      "PriestDividendMetrics_freeCashFlowLessDividendsYieldTrailingAverage",
+      "PriestDividendMetrics_freeCashFlowYieldTrailingAverage",
+      "acquirersMultiple",
+      "acquirersMultiple_enterpriseValue",
+      "acquirersMultiple_operatingEarnings",
+      "acquirersMultiple_operatingIncome",
+      "afterTaxCostOfDebt",
+      "afterTaxCostOfDebt_defaultSpread",
+      "afterTaxCostOfDebt_riskFreeRate",
+      "afterTaxCostOfDebt_taxRate",
+      "afterTaxOperatingIncomeGrowth",
+      "atoiEmpiricalAvg_AfterTaxOperatingIncomeGrowth",
+      "atoiEmpiricalAvg_Duration",
+      "atoiEmpiricalAvg_ModelDateError",
+      "atoiEmpiricalAvg_ModelType",
+      "atoiEmpiricalAvg_OutlierCount",
+      "atoiEmpiricalAvg_ReinvestmentRateMean",
+      "atoiEmpiricalAvg_ReinvestmentRateStandardDeviation",
+      "atoiEmpiricalAvg_ReturnOnCapitalDeployed",
+      "atoiEmpiricalAvg_ReturnOnCapitalDeployedStandardDeviation",
+      "atoiEmpiricalAvg_ReturnOnInvestedCapitalLessCostOfCapital",
+      "atoiEmpiricalAvg_r2",
+      "atoiEmpiricalAvg_r2Cyclic",
+      "atoiEmpiricalAvg_r2Trendline",
+      "atoiEmpirical_AfterTaxOperatingIncomeGrowth",
+      "atoiEmpirical_Duration",
+      "atoiEmpirical_ModelDateError",
+      "atoiEmpirical_ModelType",
+      "atoiEmpirical_OutlierCount",
+      "atoiEmpirical_ReinvestmentRateMean",
+      "atoiEmpirical_ReinvestmentRateStandardDeviation",
+      "atoiEmpirical_ReturnOnCapitalDeployed",
+      "atoiEmpirical_ReturnOnCapitalDeployedStandardDeviation",
+      "atoiEmpirical_ReturnOnInvestedCapitalLessCostOfCapital",
+      "atoiEmpirical_r2",
+      "atoiEmpirical_r2Cyclic",
+      "atoiEmpirical_r2Trendline",
+      "cashFlowConversionRatio",
+      "cashFlowConversionRatio_freeCashFlow",
+      "cashFlowConversionRatio_freeCashFlow_capitalExpenditures",
+      "cashFlowConversionRatio_freeCashFlow_freeCashFlow",
+      "cashFlowConversionRatio_freeCashFlow_freeCashFlowEOD",
+      "cashFlowConversionRatio_freeCashFlow_interestExpense",
+      "cashFlowConversionRatio_freeCashFlow_taxRate",
+      "cashFlowConversionRatio_freeCashFlow_taxShieldOnInterestExpense",
+      "cashFlowConversionRatio_freeCashFlow_totalCashFromOperatingActivities",
+      "cashFlowConversionRatio_netIncome",
+      "costOfCapital",
+      "costOfCapitalMature",
+      "costOfCapitalMature_afterTaxCostOfDebt",
+      "costOfCapitalMature_costOfEquityAsAPercentage",
+      "costOfCapitalMature_matureFirmDebtCapitalFraction",
+      "costOfCapital_adjustedClose",
+      "costOfCapital_afterTaxCostOfDebt",
+      "costOfCapital_costOfEquityAsAPercentage",
+      "costOfCapital_longTermDebt",
+      "costOfCapital_marketCapitalization",
+      "costOfCapital_outstandingShares",
+      "costOfEquityAsAPercentage",
+      "costOfEquityAsAPercentage_adjustedClose",
+      "costOfEquityAsAPercentage_beta",
+      "costOfEquityAsAPercentage_betaUnlevered",
+      "costOfEquityAsAPercentage_equityRiskPremium",
+      "costOfEquityAsAPercentage_inflation",
+      "costOfEquityAsAPercentage_inflationReference",
+      "costOfEquityAsAPercentage_longTermDebt",
+      "costOfEquityAsAPercentage_marketCapitalization",
+      "costOfEquityAsAPercentage_noInflation",
+      "costOfEquityAsAPercentage_outstandingShares",
+      "costOfEquityAsAPercentage_riskFreeRate",
+      "costOfEquityAsAPercentage_taxRate",
+      "debtToCapitalizationRatio",
+      "debtToCapitalizationRatio_totalDebtEstimate",
+      "debtToCapitalizationRatio_totalStockholderEquity",
+      "debt_capitalLeaseObligations",
+      "debt_cash",
+      "debt_longTermDebt",
+      "debt_longTermDebtEstimate",
+      "debt_longTermDebtEstimateMethod",
+      "debt_longTermDebtTotal",
+      "debt_netDebt",
+      "debt_shortLongTermDebt",
+      "debt_shortLongTermDebtTotal",
+      "debt_shortTermDebt",
+      "debt_shortTermDebtEstimate",
+      "debt_shortTermDebtEstimateMethod",
+      "debt_totalDebtEstimate",
+      "defaultSpread",
+      "defaultSpread_interestCover",
+      "enterpriseValue",
+      "enterpriseValue_cash",
+      "enterpriseValue_cashAndEquivalents",
+      "enterpriseValue_cashAndEquivalentsEntry",
+      "enterpriseValue_debtBookValue",
+      "enterpriseValue_marketCapitalization",
+      "enterpriseValue_minorityInterest",
+      "epsEmpiricalModelAvg_ModelType",
+      "epsEmpiricalModelAvg_date",
+      "epsEmpiricalModelAvg_growth",
+      "epsEmpiricalModelAvg_r2",
+      "epsEmpiricalModelAvg_r2Cyclic",
+      "epsEmpiricalModelAvg_r2Trendline",
+      "epsEmpiricalModelAvg_value",
+      "epsEmpiricalModel_ModelType",
+      "epsEmpiricalModel_date",
+      "epsEmpiricalModel_growth",
+      "epsEmpiricalModel_r2",
+      "epsEmpiricalModel_r2Cyclic",
+      "epsEmpiricalModel_r2Trendline",
+      "epsEmpiricalModel_value",
+      "equityEmpiricalModelAvg_ModelType",
+      "equityEmpiricalModelAvg_date",
+      "equityEmpiricalModelAvg_growth",
+      "equityEmpiricalModelAvg_r2",
+      "equityEmpiricalModelAvg_r2Cyclic",
+      "equityEmpiricalModelAvg_r2Trendline",
+      "equityEmpiricalModelAvg_value",
+      "equityEmpiricalModel_ModelType",
+      "equityEmpiricalModel_date",
+      "equityEmpiricalModel_growth",
+      "equityEmpiricalModel_r2",
+      "equityEmpiricalModel_r2Cyclic",
+      "equityEmpiricalModel_r2Trendline",
+      "equityEmpiricalModel_value",
+      "fcfEmpiricalModelAvg_ModelType",
+      "fcfEmpiricalModelAvg_date",
+      "fcfEmpiricalModelAvg_growth",
+      "fcfEmpiricalModelAvg_r2",
+      "fcfEmpiricalModelAvg_r2Cyclic",
+      "fcfEmpiricalModelAvg_r2Trendline",
+      "fcfEmpiricalModelAvg_value",
+      "fcfEmpiricalModel_ModelType",
+      "fcfEmpiricalModel_date",
+      "fcfEmpiricalModel_growth",
+      "fcfEmpiricalModel_r2",
+      "fcfEmpiricalModel_r2Cyclic",
+      "fcfEmpiricalModel_r2Trendline",
+      "fcfEmpiricalModel_value",
+      "financialRatios_dividendYield",
+      "financialRatios_operationalLeverage",
+      "financialRatios_pe",
+      "freeCashFlowToEquity",
+      "freeCashFlowToEquity_changeInDebt",
+      "freeCashFlowToEquity_changeInNonCashWorkingCapital",
+      "freeCashFlowToEquity_changeInNonCashWorkingCapital_changeInAccountsPayable",
+      "freeCashFlowToEquity_changeInNonCashWorkingCapital_changeInInventory",
+      "freeCashFlowToEquity_changeInNonCashWorkingCapital_changeInNetReceivables",
+      "freeCashFlowToEquity_debt",
+      "freeCashFlowToEquity_depreciation",
+      "freeCashFlowToEquity_netCapitalExpenditures",
+      "freeCashFlowToEquity_netCapitalExpenditures_capitalExpenditures",
+      "freeCashFlowToEquity_netCapitalExpenditures_changeInPlantPropertyEquipment",
+      "freeCashFlowToEquity_netCapitalExpenditures_depreciation",
+      "freeCashFlowToEquity_netIncome",
+      "freeCashFlowToEquity_previousDebt",
+      "freeCashFlowToFirm",
+      "freeCashFlowToFirm_afterTaxOperatingIncome",
+      "freeCashFlowToFirm_operatingIncome",
+      "freeCashFlowToFirm_reinvestmentRate",
+      "freeCashFlowToFirm_reinvestmentRate_afterTaxOperatingIncome",
+      "freeCashFlowToFirm_reinvestmentRate_changeInNonCashWorkingCapital",
+      "freeCashFlowToFirm_reinvestmentRate_changeInNonCashWorkingCapital_changeInAccountsPayable",
+      "freeCashFlowToFirm_reinvestmentRate_changeInNonCashWorkingCapital_changeInInventory",
+      "freeCashFlowToFirm_reinvestmentRate_changeInNonCashWorkingCapital_changeInNetReceivables",
+      "freeCashFlowToFirm_reinvestmentRate_netCapitalExpenditures",
+      "freeCashFlowToFirm_reinvestmentRate_netCapitalExpenditures_capitalExpenditures",
+      "freeCashFlowToFirm_reinvestmentRate_netCapitalExpenditures_changeInPlantPropertyEquipment",
+      "freeCashFlowToFirm_reinvestmentRate_netCapitalExpenditures_depreciation",
+      "freeCashFlowToFirm_reinvestmentRate_operatingIncome",
+      "freeCashFlowToFirm_reinvestmentRate_taxRate",
+      "freeCashFlowToFirm_taxRate",
+      "grossMargin",
+      "grossMargin_costOfRevenue",
+      "grossMargin_totalRevenue",
+      "grossProfitEmpiricalModelAvg_ModelType",
+      "grossProfitEmpiricalModelAvg_date",
+      "grossProfitEmpiricalModelAvg_growth",
+      "grossProfitEmpiricalModelAvg_r2",
+      "grossProfitEmpiricalModelAvg_r2Cyclic",
+      "grossProfitEmpiricalModelAvg_r2Trendline",
+      "grossProfitEmpiricalModelAvg_value",
+      "grossProfitEmpiricalModel_ModelType",
+      "grossProfitEmpiricalModel_date",
+      "grossProfitEmpiricalModel_growth",
+      "grossProfitEmpiricalModel_r2",
+      "grossProfitEmpiricalModel_r2Cyclic",
+      "grossProfitEmpiricalModel_r2Trendline",
+      "grossProfitEmpiricalModel_value",
+      "interestCover",
+      "interestCover_interestExpense",
+      "interestCover_operatingIncome",
+      "netIncomeGrowth",
+      "operatingEarnings",
+      "operatingEarnings_costOfRevenue",
+      "operatingEarnings_depreciationAndAmortization",
+      "operatingEarnings_sellingGeneralAdministrative",
+      "operatingEarnings_totalRevenue",
+      "operatingMargin",
+      "operatingMargin_operatingIncome",
+      "operatingMargin_totalRevenue",
+      "ownersEarnings",
+      "ownersEarnings_changeInNonCashWorkingCapital",
+      "ownersEarnings_changeInNonCashWorkingCapital_changeInAccountsPayable",
+      "ownersEarnings_changeInNonCashWorkingCapital_changeInInventory",
+      "ownersEarnings_changeInNonCashWorkingCapital_changeInNetReceivables",
+      "ownersEarnings_netCapitalExpenditures",
+      "ownersEarnings_netCapitalExpenditures_capitalExpenditures",
+      "ownersEarnings_netCapitalExpenditures_changeInPlantPropertyEquipment",
+      "ownersEarnings_netCapitalExpenditures_depreciation",
+      "ownersEarnings_netIncome",
+      "previousDebt_capitalLeaseObligations",
+      "previousDebt_cash",
+      "previousDebt_longTermDebt",
+      "previousDebt_longTermDebtEstimate",
+      "previousDebt_longTermDebtEstimateMethod",
+      "previousDebt_longTermDebtTotal",
+      "previousDebt_netDebt",
+      "previousDebt_shortLongTermDebt",
+      "previousDebt_shortLongTermDebtTotal",
+      "previousDebt_shortTermDebt",
+      "previousDebt_shortTermDebtEstimate",
+      "previousDebt_shortTermDebtEstimateMethod",
+      "previousDebt_totalDebtEstimate",
+      "reinvestmentRate",
+      "reinvestmentRate_afterTaxOperatingIncome",
+      "reinvestmentRate_changeInNonCashWorkingCapital",
+      "reinvestmentRate_changeInNonCashWorkingCapital_changeInAccountsPayable",
+      "reinvestmentRate_changeInNonCashWorkingCapital_changeInInventory",
+      "reinvestmentRate_changeInNonCashWorkingCapital_changeInNetReceivables",
+      "reinvestmentRate_netCapitalExpenditures",
+      "reinvestmentRate_netCapitalExpenditures_capitalExpenditures",
+      "reinvestmentRate_netCapitalExpenditures_changeInPlantPropertyEquipment",
+      "reinvestmentRate_netCapitalExpenditures_depreciation",
+      "reinvestmentRate_operatingIncome",
+      "reinvestmentRate_taxRate",
+      "residualCashFlow",
+      "residualCashFlowToEnterpriseValue",
+      "residualCashFlow_capitalExpenditureMean",
+      "residualCashFlow_costOfEquity",
+      "residualCashFlow_costOfEquityAsAPercentage",
+      "residualCashFlow_researchDevelopment",
+      "residualCashFlow_totalCashFromOperatingActivities",
+      "residualCashFlow_totalStockholderEquity",
+      "retentionRatio",
+      "retentionRatio_dividendsPaid",
+      "retentionRatio_netIncome",
+      "returnOnAssets",
+      "returnOnAssets_netIncome",
+      "returnOnAssets_totalAssets",
+      "returnOnCapitalDeployed",
+      "returnOnCapitalDeployedLessCostOfCapital",
+      "returnOnCapitalDeployed_afterTaxOperatingIncome",
+      "returnOnCapitalDeployed_longTermDebt",
+      "returnOnCapitalDeployed_operatingIncome",
+      "returnOnCapitalDeployed_taxRate",
+      "returnOnCapitalDeployed_totalStockholderEquity",
+      "returnOnEquity",
+      "returnOnEquityLessCostOfCapital",
+      "returnOnEquity_netIncome",
+      "returnOnEquity_totalStockholderEquity",
+      "returnOnInvestedFinancialCapital",
+      "returnOnInvestedFinancialCapitalLessCostOfCapital",
+      "returnOnInvestedFinancialCapital_afterTaxOperatingIncome",
+      "returnOnInvestedFinancialCapital_cash",
+      "returnOnInvestedFinancialCapital_debtBookValue",
+      "returnOnInvestedFinancialCapital_operatingIncome",
+      "returnOnInvestedFinancialCapital_otherLongTermLiabilities",
+      "returnOnInvestedFinancialCapital_taxRate",
+      "returnOnInvestedFinancialCapital_totalStockholderEquity",
+      "returnOnInvestedOperatingCapital",
+      "returnOnInvestedOperatingCapitalLessCostOfCapital",
+      "returnOnInvestedOperatingCapital_afterTaxOperatingIncome",
+      "returnOnInvestedOperatingCapital_goodWill",
+      "returnOnInvestedOperatingCapital_intangibleAssets",
+      "returnOnInvestedOperatingCapital_netWorkingCapital",
+      "returnOnInvestedOperatingCapital_operatingIncome",
+      "returnOnInvestedOperatingCapital_otherAssets",
+      "returnOnInvestedOperatingCapital_propertyPlantAndEquipmentNet",
+      "returnOnInvestedOperatingCapital_taxRate",
+      "revenueEmpiricalModelAvg_ModelType",
+      "revenueEmpiricalModelAvg_date",
+      "revenueEmpiricalModelAvg_growth",
+      "revenueEmpiricalModelAvg_r2",
+      "revenueEmpiricalModelAvg_r2Cyclic",
+      "revenueEmpiricalModelAvg_r2Trendline",
+      "revenueEmpiricalModelAvg_value",
+      "revenueEmpiricalModel_ModelType",
+      "revenueEmpiricalModel_date",
+      "revenueEmpiricalModel_growth",
+      "revenueEmpiricalModel_r2",
+      "revenueEmpiricalModel_r2Cyclic",
+      "revenueEmpiricalModel_r2Trendline",
+      "revenueEmpiricalModel_value",
+      "shareholderYield",
+      "shareholderYield_changeInDebt",
+      "shareholderYield_changeInOutstandingShares",
+      "shareholderYield_debtPaybackYield",
+      "shareholderYield_dividendYield",
+      "shareholderYield_dividendsPaid",
+      "shareholderYield_marketCapitalization",
+      "shareholderYield_outstandingShares",
+      "shareholderYield_shareBuybackYield",
+      "shareholderYield_sharePrice"
+    };
+
+    static constexpr size_t NUMBER_OF_FIXED_TERMS = 
+      sizeof(FIXED_TERM_NAMES)/sizeof(FIXED_TERM_NAMES[0]);
+
+    static constexpr size_t TERM_NOT_FOUND = 
+      std::numeric_limits<size_t>::max();
+
+    //============================================================================
+    static constexpr bool isFixedTermTableSorted(){
+      for(size_t i=1; i<NUMBER_OF_FIXED_TERMS; ++i){
+        if(!(FIXED_TERM_NAMES[i-1] < FIXED_TERM_NAMES[i])){
+          return false;
+        }
+      }
+      return true;
+    };
+
+    //============================================================================
+    static size_t getFixedTermIndex(std::string_view name){
+      const std::string_view *first = FIXED_TERM_NAMES;
+      const std::string_view *last  = FIXED_TERM_NAMES + NUMBER_OF_FIXED_TERMS;
+      const std::string_view *iter  = std::lower_bound(first,last,name);
+      if(iter == last || *iter != name){
+        return TERM_NOT_FOUND;
+      }
+      return static_cast<size_t>(iter-first);
+    };
+
+    //============================================================================
+    /*
+      The named terms (e.g. costOfCapital_longTermDebt) that are written for 
+      each date of a ticker's analysis.
+
+      The terms in FIXED_TERM_NAMES have the index of their entry in that 
+      table. Any other term (the discounted cash flow terms) is given the 
+      next free index the first time that its name is appended, and only 
+      these names are stored in the record. The values of a date are kept in
+      an array indexed by the term's index. Most term names are assembled 
+      from a parent name and a suffix, and so the parts of a name are passed 
+      separately: the name of each term is compared, part by part, against
+      the term that was appended at the same position for the previous date.
+      The name is only assembled and looked up when this comparison fails, 
+      which normally only happens for the first date. As a result, after the
+      first date, appending a term does not allocate memory.
+
+      Names and values can be appended separately (names first, or values
+      first) as with a pair of parallel vectors: the i-th name is paired with
+      the i-th value. As with a json object, if a name is appended twice for
+      one date the first value is kept.
+    */
+    struct TermRecord{
+      //The names of the terms that are not in FIXED_TERM_NAMES: the name of
+      //term NUMBER_OF_FIXED_TERMS+i is dynamicNames[i]
+      std::vector< std::string > dynamicNames;
+      std::unordered_map< std::string, size_t > indexOfDynamicName;
+      std::vector< double > values;
+      std::vector< unsigned char > isSet;
+      //Term indices in the order in which they were first set for this date
+      std::vector< size_t > order;
+      std::vector< size_t > nameSequence;
+      std::vector< size_t > previousNameSequence;
+      std::vector< double > valueSequence;
+      size_t numberOfPairs;
+      std::string nameBuffer;
+
+      TermRecord():
+        values(NUMBER_OF_FIXED_TERMS,std::nan("1")),
+        isSet(NUMBER_OF_FIXED_TERMS,0),
+        numberOfPairs(0){};
+
+      static constexpr size_t NOT_FOUND = TERM_NOT_FOUND;
+
+      //Clears the values of the date but keeps the names of the terms
+      void clear(){
+        for(auto const &index : order){
+          isSet[index]=0;
+        }
+        order.clear();
+        previousNameSequence.swap(nameSequence);
+        nameSequence.clear();
+        valueSequence.clear();
+        numberOfPairs=0;
+      };
+
+      size_t size() const {
+        return order.size();
+      };
+
+      std::string_view getName(size_t index) const {
+        if(index < NUMBER_OF_FIXED_TERMS){
+          return FIXED_TERM_NAMES[index];
+        }
+        return dynamicNames[index-NUMBER_OF_FIXED_TERMS];
+      };
+
+      bool isNameEqual(size_t index,
+              std::initializer_list< std::string_view > nameParts) const {
+        std::string_view name = getName(index);
+        size_t position = 0;
+        for(auto const &part : nameParts){
+          if(name.compare(position, part.size(), part) != 0){
+            return false;
+          }
+          position += part.size();
+        }
+        return (position == name.size());
+      };
+
+      size_t getTermIndex(const std::string &name) const {
+        size_t index = getFixedTermIndex(name);
+        if(index != NOT_FOUND){
+          return index;
+        }
+        auto iter = indexOfDynamicName.find(name);
+        if(iter == indexOfDynamicName.end()){
+          return NOT_FOUND;
+        }
+        return iter->second;
+      };
+
+      void appendName(std::initializer_list< std::string_view > nameParts){
+        size_t position = nameSequence.size();
+        size_t index = NOT_FOUND;
+        if(position < previousNameSequence.size()
+            && isNameEqual(previousNameSequence[position],nameParts)){
+          index = previousNameSequence[position];
+        }else{
+          nameBuffer.clear();
+          for(auto const &part : nameParts){
+            nameBuffer.append(part.data(),part.size());
+          }
+          index = getTermIndex(nameBuffer);
+          if(index == NOT_FOUND){
+            index = NUMBER_OF_FIXED_TERMS + dynamicNames.size();
+            dynamicNames.push_back(nameBuffer);
+            indexOfDynamicName[nameBuffer]=index;
+            values.push_back(std::nan("1"));
+            isSet.push_back(0);
+          }
+        }
+        nameSequence.push_back(index);
+        pairNamesAndValues();
+      };
+
+      void appendName(std::string_view name){
+        appendName({name});
+      };
+
+      void appendValue(double value){
+        valueSequence.push_back(value);
+        pairNamesAndValues();
+      };
+
+      void pairNamesAndValues(){
+        while(numberOfPairs < nameSequence.size()
+              && numberOfPairs < valueSequence.size()){
+          size_t index = nameSequence[numberOfPairs];
+          if(isSet[index]==0){
+            isSet[index]=1;
+            values[index]=valueSequence[numberOfPairs];
+            order.push_back(index);
+          }
+          ++numberOfPairs;
+        }
+      };
+
+      //Returns nan if the term has not been set for this date
+      double getValue(size_t index) const {
+        if(index < isSet.size() && isSet[index] != 0){
+          return values[index];
+        }
+        return std::nan("1");
+      };
+    };
+
 };
 
+static_assert(DataStructures::isFixedTermTableSorted(),
+              "FIXED_TERM_NAMES has to be sorted");
+
 
 
 #endif
\ No newline at end of file
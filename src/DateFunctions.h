@@ -12,6 +12,7 @@
 #include <chrono>
 
 #include "date.h"
+#include "ArenaFunctions.h"
 
 const char *DefaultDateFormat = "%Y-%m-%d";
 
@@ -21,17 +22,25 @@ class DateFunctions {
   public:
     static constexpr double DAYS_PER_YEAR = 365.25;
 
+    //A TTM date set is scratch data that is created for every date of a
+    //ticker, and so it lives in the arena of the ticker being evaluated
     struct DateSetTTM{
-      std::vector< std::string > dates;
-      std::vector< double > weights;
-      std::vector< double > weightsNormalized;
-      std::vector< int > days; 
+      ArenaFunctions::ScratchVector< std::string > dates;
+      ArenaFunctions::ScratchVector< double > weights;
+      ArenaFunctions::ScratchVector< double > weightsNormalized;
+      ArenaFunctions::ScratchVector< int > days; 
       bool isQuarterlyData;  
-      DateSetTTM():isQuarterlyData(false){
-        dates.resize(0);
-        weights.resize(0);
-        weightsNormalized.resize(0);
-        days.resize(0);
+      DateSetTTM():
+        dates(ArenaFunctions::getResource()),
+        weights(ArenaFunctions::getResource()),
+        weightsNormalized(ArenaFunctions::getResource()),
+        days(ArenaFunctions::getResource()),
+        isQuarterlyData(false){
+        //A TTM set has at most 4 quarters and the date that closes it
+        dates.reserve(5);
+        weights.reserve(5);
+        weightsNormalized.reserve(5);
+        days.reserve(5);
       };
       void clear(){
         dates.resize(0);
@@ -16,6 +16,8 @@
 
 #include "DataStructures.h"
 #include "DateFunctions.h"
+#include "ReferenceDataFunctions.h"
+#include "StringFunctions.h"
 
 const static std::vector< std::string > CurrencyPairs = {"GBX","GBP"};
 const static std::vector< double > CurrencyScale = { 0.01 };
@@ -89,6 +91,450 @@ class FinancialAnalysisFunctions {
 
     };
 
+    //==========================================================================
+    /*
+      Many of the metrics below share the same terms: free cash flow, net
+      capital expenditures, and the change in non-cash working capital are
+      used by the free-cash-flow-to-equity, owners earnings, reinvestment
+      rate, and free-cash-flow-to-firm, for example. The metric graph
+      evaluates each of these shared terms at most once for a (ticker, date
+      set) pair and keeps the result in a flat array.
+
+      Every metric is declared in the table in getMetricDefinitions along
+      with the metrics that it depends on. A metric is either a sum of a
+      field in the financial statements over the date set (a leaf) or is
+      evaluated by evaluateMetric from its dependencies.
+    */
+    enum MetricId{
+      //Leaves: fields summed over the date set
+      METRIC_OPERATING_INCOME=0,
+      METRIC_INTEREST_EXPENSE,
+      METRIC_NET_INCOME_IS,
+      METRIC_RESEARCH_DEVELOPMENT,
+      METRIC_TOTAL_CASH_FROM_OPERATING_ACTIVITIES,
+      METRIC_CAPITAL_EXPENDITURES,
+      METRIC_DEPRECIATION,
+      METRIC_NET_INCOME_CF,
+      METRIC_FREE_CASH_FLOW_EOD,
+      //Evaluated from the leaves and the financial records
+      METRIC_INTEREST_COVER,
+      METRIC_CAPITAL_EXPENDITURES_ESTIMATE,
+      METRIC_CHANGE_IN_PLANT_PROPERTY_EQUIPMENT,
+      METRIC_CHANGE_IN_INVENTORY,
+      METRIC_CHANGE_IN_NET_RECEIVABLES,
+      METRIC_CHANGE_IN_ACCOUNTS_PAYABLE,
+      METRIC_CHANGE_IN_NON_CASH_WORKING_CAPITAL,
+      //Evaluated from the historical data and the outstanding shares
+      METRIC_HISTORICAL_INDEX,
+      METRIC_HISTORICAL_INDEX_PREVIOUS,
+      METRIC_OUTSTANDING_SHARES,
+      METRIC_OUTSTANDING_SHARES_PREVIOUS,
+      NUMBER_OF_METRICS
+    };
+
+    //==========================================================================
+    struct MetricDefinition{
+      MetricId id;
+      const char* reportSection;  //nullptr if this is not a leaf
+      const char* fieldName;
+      std::vector< MetricId > dependencies;
+    };
+
+    //==========================================================================
+    struct MetricGraph{
+      const nlohmann::ordered_json *fundamentalData;
+      const nlohmann::ordered_json *historicalData;
+      const DateFunctions::DateSetTTM *dateSet;
+      const DateFunctions::DateSetTTM *previousDateSet;
+      //The date set with the first date of the previous date set appended
+      DateFunctions::DateSetTTM dateSetAnalysis;
+      std::string timeUnit;
+      std::string timeUnitOS;
+      bool setNansToMissingValue;
+      std::vector< double > values;
+      std::vector< unsigned char > evaluated;
+      MetricGraph():
+        fundamentalData(nullptr),
+        historicalData(nullptr),
+        dateSet(nullptr),
+        previousDateSet(nullptr),
+        setNansToMissingValue(false){};
+    };
+
+    //==========================================================================
+    static const std::vector< MetricDefinition >& getMetricDefinitions(){
+      static const std::vector< MetricDefinition > definitions = {
+        {METRIC_OPERATING_INCOME,   IS, "operatingIncome",    {}},
+        {METRIC_INTEREST_EXPENSE,   IS, "interestExpense",    {}},
+        {METRIC_NET_INCOME_IS,      IS, "netIncome",          {}},
+        {METRIC_RESEARCH_DEVELOPMENT,IS,"researchDevelopment",{}},
+        {METRIC_TOTAL_CASH_FROM_OPERATING_ACTIVITIES,
+                                    CF, "totalCashFromOperatingActivities",{}},
+        {METRIC_CAPITAL_EXPENDITURES,CF,"capitalExpenditures",{}},
+        {METRIC_DEPRECIATION,       CF, "depreciation",       {}},
+        {METRIC_NET_INCOME_CF,      CF, "netIncome",          {}},
+        {METRIC_FREE_CASH_FLOW_EOD, CF, "freeCashFlow",       {}},
+        {METRIC_INTEREST_COVER, nullptr, "interestCover",
+          {METRIC_OPERATING_INCOME, METRIC_INTEREST_EXPENSE}},
+        {METRIC_CAPITAL_EXPENDITURES_ESTIMATE, nullptr,
+          "capitalExpendituresEstimate", {METRIC_CAPITAL_EXPENDITURES}},
+        {METRIC_CHANGE_IN_PLANT_PROPERTY_EQUIPMENT, nullptr,
+          "changeInPlantPropertyEquipment", {METRIC_CAPITAL_EXPENDITURES}},
+        {METRIC_CHANGE_IN_INVENTORY, nullptr, "changeInInventory",{}},
+        {METRIC_CHANGE_IN_NET_RECEIVABLES, nullptr,
+          "changeInNetReceivables",{}},
+        {METRIC_CHANGE_IN_ACCOUNTS_PAYABLE, nullptr,
+          "changeInAccountsPayable",{}},
+        {METRIC_CHANGE_IN_NON_CASH_WORKING_CAPITAL, nullptr,
+          "changeInNonCashWorkingCapital",{}},
+        {METRIC_HISTORICAL_INDEX, nullptr, "historicalIndex",{}},
+        {METRIC_HISTORICAL_INDEX_PREVIOUS, nullptr,
+          "historicalIndexPrevious",{}},
+        {METRIC_OUTSTANDING_SHARES, nullptr, "outstandingShares",{}},
+        {METRIC_OUTSTANDING_SHARES_PREVIOUS, nullptr,
+          "outstandingSharesPrevious",{}}
+      };
+      return definitions;
+    };
+
+    //==========================================================================
+    /*
+      Prepares the graph for a new (ticker, date set) pair. The json data and
+      date sets are referenced, not copied, and so must outlive the graph's
+      use. The historical data and the previous date set are optional: the
+      metrics that need them cannot be evaluated without them.
+    */
+    static void resetMetricGraph(
+                  const nlohmann::ordered_json &fundamentalData,
+                  const nlohmann::ordered_json *historicalData,
+                  const DateFunctions::DateSetTTM &dateSet,
+                  const DateFunctions::DateSetTTM *previousDateSet,
+                  const char *timeUnit,
+                  const char *timeUnitOS,
+                  bool setNansToMissingValue,
+                  MetricGraph &graphUpd){
+
+      graphUpd.fundamentalData        = &fundamentalData;
+      graphUpd.historicalData         = historicalData;
+      graphUpd.dateSet                = &dateSet;
+      graphUpd.previousDateSet        = previousDateSet;
+      graphUpd.timeUnit               = timeUnit;
+      graphUpd.timeUnitOS             = (timeUnitOS == nullptr) ? "":timeUnitOS;
+      graphUpd.setNansToMissingValue  = setNansToMissingValue;
+
+      graphUpd.dateSetAnalysis = dateSet;
+      if(previousDateSet != nullptr && previousDateSet->dates.size() > 0){
+        graphUpd.dateSetAnalysis.appendDate(previousDateSet->dates[0],
+                                            previousDateSet->days[0]);
+      }
+
+      graphUpd.values.assign(NUMBER_OF_METRICS, std::nan("1"));
+      graphUpd.evaluated.assign(NUMBER_OF_METRICS, 0);
+    };
+
+    //==========================================================================
+    /*
+      Returns the value of a metric, evaluating it (and its dependencies) if
+      this has not yet been done. Leaves are stored with nan for missing data
+      and are converted to the requested convention here, so that callers
+      that always set nans to the missing value share the same entry.
+    */
+    static double getMetric(MetricGraph &graph,
+                            MetricId id,
+                            bool setNansToMissingValue){
+      if(graph.evaluated[id] == 0){
+        for(auto const &dependency : getMetricDefinitions()[id].dependencies){
+          getMetric(graph, dependency, graph.setNansToMissingValue);
+        }
+        evaluateMetric(graph,id);
+      }
+      double value = graph.values[id];
+      if(setNansToMissingValue && std::isnan(value)
+          && getMetricDefinitions()[id].reportSection != nullptr){
+        value = JsonFunctions::MISSING_VALUE;
+      }
+      return value;
+    };
+
+    //==========================================================================
+    static double getMetric(MetricGraph &graph, MetricId id){
+      return getMetric(graph, id, graph.setNansToMissingValue);
+    };
+
+    //==========================================================================
+    static void evaluateMetric(MetricGraph &graph, MetricId id){
+
+      const MetricDefinition &definition = getMetricDefinitions()[id];
+      const nlohmann::ordered_json &jsonData = *graph.fundamentalData;
+      const char *timeUnit = graph.timeUnit.c_str();
+
+      if(definition.reportSection != nullptr){
+        graph.values[id] = sumFundamentalDataOverDates(jsonData,FIN,
+                              definition.reportSection, timeUnit,
+                              *graph.dateSet, definition.fieldName, false);
+        graph.evaluated[id] = 1;
+        return;
+      }
+
+      switch(id){
+        case METRIC_INTEREST_COVER:{
+          double operatingIncome = getMetric(graph,METRIC_OPERATING_INCOME);
+          double interestExpense = getMetric(graph,METRIC_INTEREST_EXPENSE);
+          double interestCover = std::nan("1");
+          if(   JsonFunctions::isJsonFloatValid(operatingIncome)
+             && JsonFunctions::isJsonFloatValid(interestExpense)
+             && std::abs(interestExpense) > 0){
+            interestCover = operatingIncome/interestExpense;
+          }
+          graph.values[id] = interestCover;
+          graph.evaluated[id] = 1;
+        }break;
+
+        case METRIC_CAPITAL_EXPENDITURES_ESTIMATE:
+        case METRIC_CHANGE_IN_PLANT_PROPERTY_EQUIPMENT:{
+          evaluateCapitalExpendituresEstimate(graph);
+        }break;
+
+        case METRIC_CHANGE_IN_INVENTORY:
+        case METRIC_CHANGE_IN_NET_RECEIVABLES:
+        case METRIC_CHANGE_IN_ACCOUNTS_PAYABLE:
+        case METRIC_CHANGE_IN_NON_CASH_WORKING_CAPITAL:{
+          evaluateChangeInNonCashWorkingCapital(graph);
+        }break;
+
+        case METRIC_HISTORICAL_INDEX:
+        case METRIC_HISTORICAL_INDEX_PREVIOUS:{
+          const DateFunctions::DateSetTTM *dates =
+            (id == METRIC_HISTORICAL_INDEX) ? graph.dateSet
+                                            : graph.previousDateSet;
+          if(graph.historicalData == nullptr || dates == nullptr){
+            std::cerr << "Error: the metric graph needs the historical data "
+                         "and the previous date set to evaluate "
+                      << definition.fieldName << std::endl;
+            std::abort();
+          }
+          graph.values[id] = static_cast<double>(
+            calcIndexOfClosestDateInHistoricalData(dates->dates[0],
+              "%Y-%m-%d", *graph.historicalData, "%Y-%m-%d", false));
+          graph.evaluated[id] = 1;
+        }break;
+
+        case METRIC_OUTSTANDING_SHARES:
+        case METRIC_OUTSTANDING_SHARES_PREVIOUS:{
+          const DateFunctions::DateSetTTM *dates =
+            (id == METRIC_OUTSTANDING_SHARES) ? graph.dateSet
+                                              : graph.previousDateSet;
+          if(dates == nullptr){
+            std::cerr << "Error: the metric graph needs the previous date set"
+                         " to evaluate " << definition.fieldName << std::endl;
+            std::abort();
+          }
+          graph.values[id] = getOutstandingSharesClosestToDate(jsonData,
+                                dates->dates[0], graph.timeUnitOS.c_str());
+          graph.evaluated[id] = 1;
+        }break;
+
+        default:{
+          std::cerr << "Error: the metric graph has no rule to evaluate "
+                    << definition.fieldName << std::endl;
+          std::abort();
+        }
+      };
+    };
+
+    //==========================================================================
+    static void evaluateCapitalExpendituresEstimate(MetricGraph &graph){
+      /*
+      Problem: the depreciation field in EOD's json data is often null
+      Solution: Since Damodran's formula for net capital expenditures is
+
+      net capital expenditures =  capital expenditure - depreciation  [a]
+
+      where capital expendature is the change in plant, property and equipment
+      from the previous year we can instead use:
+
+      capital expenditure = PPE - PPE_previousYear
+
+      References
+        https://www.investopedia.com/terms/c/capitalexpenditure.asp
+
+        Damodaran, A.(2011). The Little Book of Valuation. Wiley.
+      */
+      const nlohmann::ordered_json &jsonData = *graph.fundamentalData;
+      const char *timeUnit = graph.timeUnit.c_str();
+      bool setNansToMissingValue = graph.setNansToMissingValue;
+
+      double capitalExpenditures =
+        getMetric(graph, METRIC_CAPITAL_EXPENDITURES);
+
+      double plantPropertyEquipment=0;
+      double plantPropertyEquipmentPrevious=0;
+      double changeInPlantPropertyEquipment = 0;
+
+      if(!JsonFunctions::isJsonFloatValid(capitalExpenditures)){
+
+        requirePreviousDateSet(graph,"capitalExpendituresEstimate");
+        const DateFunctions::DateSetTTM &dateSetAnalysis=graph.dateSetAnalysis;
+
+        capitalExpenditures=0.;
+
+        for(int indexPrevious=1;
+          indexPrevious < dateSetAnalysis.dates.size();++indexPrevious){
+
+          int index = indexPrevious-1;
+          double weight = dateSetAnalysis.weights[index];
+          double weightPrevious = dateSetAnalysis.weights[indexPrevious];
+
+          //Use an alternative method to calculate capital expenditures
+          plantPropertyEquipment =
+            JsonFunctions::getJsonFloat(
+              jsonData[FIN][BAL][timeUnit][dateSetAnalysis.dates[index].c_str()]
+              ["propertyPlantEquipment"], setNansToMissingValue);
+          plantPropertyEquipment *= weight;
+
+          plantPropertyEquipmentPrevious =
+            JsonFunctions::getJsonFloat(
+              jsonData[FIN][BAL][timeUnit][dateSetAnalysis.dates[indexPrevious].c_str()]
+              ["propertyPlantEquipment"], setNansToMissingValue);
+          plantPropertyEquipmentPrevious *= weightPrevious;
+
+          //If one of the PPE's is populated copy it over to the PPE that is
+          //nan: this is a better approximation of the PPE than 0.
+          if(   JsonFunctions::isJsonFloatValid(plantPropertyEquipment)
+            && JsonFunctions::isJsonFloatValid(plantPropertyEquipmentPrevious)){
+            changeInPlantPropertyEquipment +=
+                    ( plantPropertyEquipment
+                     -plantPropertyEquipmentPrevious);
+          }
+          capitalExpenditures  += (changeInPlantPropertyEquipment);
+
+        }
+      }
+
+      graph.values[METRIC_CAPITAL_EXPENDITURES_ESTIMATE] = capitalExpenditures;
+      graph.values[METRIC_CHANGE_IN_PLANT_PROPERTY_EQUIPMENT] =
+        changeInPlantPropertyEquipment;
+      graph.evaluated[METRIC_CAPITAL_EXPENDITURES_ESTIMATE] = 1;
+      graph.evaluated[METRIC_CHANGE_IN_PLANT_PROPERTY_EQUIPMENT] = 1;
+    };
+
+    //==========================================================================
+    static void evaluateChangeInNonCashWorkingCapital(MetricGraph &graph){
+      /*
+        Problem: Damodran's FCFE needs change in non-cash working capital, but
+                 this quantity is not really reported by EOD.
+
+        Solution: calculate the change in non-cash working capital directly
+                  using the suggestions in Ch. 3 of Damodran
+
+        change non-cash working capital = (inventory-inventoryPrevious)
+                                        + (netReceivables-netReceivablesPrevious)
+                                        - (accountsPayable-accountsPayablePrevious)
+
+      */
+      requirePreviousDateSet(graph,"changeInNonCashWorkingCapital");
+
+      const nlohmann::ordered_json &jsonData = *graph.fundamentalData;
+      const char *timeUnit = graph.timeUnit.c_str();
+      bool setNansToMissingValue = graph.setNansToMissingValue;
+
+      //The first interval of the previous data set has been appended to
+      //make it possible to evaluate the change in quantities associated with
+      //every entry in dataSet
+      const DateFunctions::DateSetTTM &dateSetAnalysis = graph.dateSetAnalysis;
+
+      double changeInNonCashWorkingCapital = 0.;
+      double changeInInventory          = 0.;
+      double changeInReceivables        = 0.;
+      double changeInAccountsPayable    = 0.;
+
+      for(int indexPrevious=1;
+          indexPrevious < dateSetAnalysis.dates.size();++indexPrevious){
+
+        int index = indexPrevious-1;
+
+        const std::string &date         = dateSetAnalysis.dates[index];
+        const std::string &datePrevious = dateSetAnalysis.dates[indexPrevious];
+
+        //Inventory, receivables, and accounts payable are quantities that
+        //do not accumulate over the year. I'm not going to use the
+        //weights associated with each date to scale the inventory, for example,
+        //for reporting periods that span more than a quarter.
+
+        double inventory =
+          JsonFunctions::getJsonFloat(
+            jsonData[FIN][BAL][timeUnit][date.c_str()]["inventory"],
+            setNansToMissingValue);
+
+        double inventoryPrevious =
+          JsonFunctions::getJsonFloat(
+            jsonData[FIN][BAL][timeUnit][datePrevious.c_str()]["inventory"],
+            setNansToMissingValue);
+
+        double netReceivables =
+          JsonFunctions::getJsonFloat(
+            jsonData[FIN][BAL][timeUnit][date.c_str()]["netReceivables"],
+            setNansToMissingValue);
+
+        double netReceivablesPrevious =
+          JsonFunctions::getJsonFloat(
+            jsonData[FIN][BAL][timeUnit][datePrevious.c_str()]["netReceivables"],
+            setNansToMissingValue);
+
+        double accountsPayable =
+          JsonFunctions::getJsonFloat(
+            jsonData[FIN][BAL][timeUnit][date.c_str()]["accountsPayable"],
+            setNansToMissingValue);
+
+        double accountsPayablePrevious =
+          JsonFunctions::getJsonFloat(
+            jsonData[FIN][BAL][timeUnit][datePrevious.c_str()]["accountsPayable"],
+            setNansToMissingValue);
+
+        //There are a number of companies that produce software or a service
+        //and so never have any inventory to report.
+        if(    JsonFunctions::isJsonFloatValid(  inventory)
+            && JsonFunctions::isJsonFloatValid(  inventoryPrevious)){
+          changeInInventory += (inventory-inventoryPrevious);
+          changeInNonCashWorkingCapital += (inventory-inventoryPrevious);
+        }
+
+        if(    JsonFunctions::isJsonFloatValid(  netReceivables         )
+            && JsonFunctions::isJsonFloatValid(  netReceivablesPrevious )){
+          changeInReceivables += (netReceivables-netReceivablesPrevious);
+          changeInNonCashWorkingCapital += (netReceivables-netReceivablesPrevious);
+        }
+
+        if(    JsonFunctions::isJsonFloatValid(  accountsPayable        )
+            && JsonFunctions::isJsonFloatValid(  accountsPayablePrevious)){
+          changeInAccountsPayable += -1.0*(accountsPayable-accountsPayablePrevious);
+          changeInNonCashWorkingCapital += -1.0*(accountsPayable-accountsPayablePrevious);
+        }
+
+      }
+
+      graph.values[METRIC_CHANGE_IN_INVENTORY]        = changeInInventory;
+      graph.values[METRIC_CHANGE_IN_NET_RECEIVABLES]  = changeInReceivables;
+      graph.values[METRIC_CHANGE_IN_ACCOUNTS_PAYABLE] = changeInAccountsPayable;
+      graph.values[METRIC_CHANGE_IN_NON_CASH_WORKING_CAPITAL] =
+        changeInNonCashWorkingCapital;
+      graph.evaluated[METRIC_CHANGE_IN_INVENTORY]        = 1;
+      graph.evaluated[METRIC_CHANGE_IN_NET_RECEIVABLES]  = 1;
+      graph.evaluated[METRIC_CHANGE_IN_ACCOUNTS_PAYABLE] = 1;
+      graph.evaluated[METRIC_CHANGE_IN_NON_CASH_WORKING_CAPITAL] = 1;
+    };
+
+    //==========================================================================
+    static void requirePreviousDateSet(const MetricGraph &graph,
+                                       const char *metricName){
+      if(graph.previousDateSet == nullptr
+          || graph.previousDateSet->dates.size()==0){
+        std::cerr << "Error: the metric graph needs the previous date set "
+                     "to evaluate " << metricName << std::endl;
+        std::abort();
+      }
+    };
+
     //==========================================================================
     static int calcIndexOfClosestDateInHistoricalData(
                   const std::string &targetDate,
@@ -158,8 +604,21 @@ class FinancialAnalysisFunctions {
       using json = nlohmann::ordered_json;
       std::ifstream jsonFileStream(filePathName.c_str());
 
+      //Only the PrimaryTicker is parsed into memory
+      static const JsonFunctions::SectionFilter primaryTickerSection = [](){
+        JsonFunctions::SectionFilter filter;
+        JsonFunctions::createSectionFilter({"General.PrimaryTicker"},filter);
+        return filter;
+      }();
+
       try{
-        json jsonData = json::parse(jsonFileStream);  
+        const std::string *prefetchedFile = 
+          PrefetchFunctions::getPrefetchedFile(filePathName);
+        json jsonData = (prefetchedFile != nullptr) ?
+          JsonFunctions::parseJsonSections(*prefetchedFile,
+                                           primaryTickerSection) :
+          JsonFunctions::parseJsonSections(jsonFileStream,
+                                           primaryTickerSection);  
 
         if( jsonData.contains("General") ){
           if(jsonData["General"].contains("PrimaryTicker")){
@@ -277,90 +736,18 @@ class FinancialAnalysisFunctions {
       updEodFileName.append(".json");
     };
     //==========================================================================
-
-
-    
+    /*
+      Reads a price from an entry of the historical data. The historical data 
+      must already be in the currency of the fundamental data: calculate
+      converts each historical file once, as it is loaded, using 
+      ForexFunctions::applyPriceConversion.
+    */
     static double getHistoricalDataInFundamentalUnit(
                     const nlohmann::ordered_json &historicalDataEntry,
-                    const nlohmann::ordered_json &fundamentalData,
                     bool setNansToMissingValue){
 
-
-      nlohmann::ordered_json currencyUnits;
-      //This will cause an error when used. This is a temporary placeholder.
-
-      double value = JsonFunctions::getJsonFloat(historicalDataEntry,
-                                                 setNansToMissingValue);
-
-      std::string historicalCurrency;
-      JsonFunctions::getJsonString( fundamentalData[GEN]["CurrencyCode"],
-                                    historicalCurrency);
-
-      std::string fundamentalCurrency;                                                 
-      JsonFunctions::getJsonString( fundamentalData[FIN][BAL]["currency_symbol"],
-                                    fundamentalCurrency);
-      
-
-      if(fundamentalCurrency.compare(historicalCurrency) != 0){
-
-        //
-        // Check to see if the stock price is reported in fractions of the 
-        // base currency
-        //
-        bool scaleConverted=false;
-        for(auto &el : currencyUnits){
-          std::string currencyCode;
-          JsonFunctions::getJsonString(el["StockPriceCurrencyCode"],currencyCode);
-          if(currencyCode.compare(historicalCurrency)==0){
-
-            //Update the price scale
-            double currencyScale = 
-              JsonFunctions::getJsonFloat(el["StockPriceToCurrencyScale"]);
-            value = value*currencyScale;
-
-            //Update the currency name
-            JsonFunctions::getJsonString(el["Currency"],historicalCurrency);
-            scaleConverted=true;
-          }
-        }
-
-        bool currencyConverted=false;
-        if(fundamentalCurrency.compare(historicalCurrency) != 0){        
-          std::cout << "You are here" << std::endl;
-          std::abort();
-        }else{
-          currencyConverted=true;
-        }
-
-        /*
-        for(int i=0; i<CurrencyScale.size();++i){
-          int j = i*2;
-          int k = j+1;
-
-          if(  (CurrencyPairs[j].compare(historicalCurrency)==0
-             && CurrencyPairs[k].compare(fundamentalCurrency)==0)){
-            value = value * CurrencyScale[i];
-            converted=true;
-          }
-          if(   CurrencyPairs[k].compare(historicalCurrency)==0
-             && CurrencyPairs[j].compare(fundamentalCurrency)==0){
-            value = value * (1.0/CurrencyScale[i]);            
-            converted=true;
-          }
-        }
-        */
-        if(!currencyConverted){
-
-          std::cerr << "getHistoricalDataInFundamentalUnit" << std::endl;
-          std::cerr << "Error: could not find this pair of currency units "
-                    << " in CurrencyPairs: " << historicalCurrency 
-                    << " " << fundamentalCurrency << std::endl;
-          std::abort();          
-        }
-
-      }
-
-      return value;
+      return JsonFunctions::getJsonFloat(historicalDataEntry,
+                                         setNansToMissingValue);
     };
 
     //==========================================================================
@@ -383,8 +770,7 @@ class FinancialAnalysisFunctions {
                     DataStructures::DebtInfo &debtInfoUpd,
                     bool appendTermRecord,
                     const std::string &parentCategoryName,
-                    std::vector< std::string> &termNames,
-                    std::vector< double > &termValues,                    
+                    DataStructures::TermRecord &termRecord,                    
                     bool setNansToMissingValue=false){
 
 
@@ -620,33 +1006,33 @@ class FinancialAnalysisFunctions {
       debtInfoUpd.info="";
 
       if(appendTermRecord){
-        termNames.push_back(parentCategoryName+"shortTermDebt");
-        termNames.push_back(parentCategoryName+"shortLongTermDebt");
-        termNames.push_back(parentCategoryName+"shortLongTermDebtTotal");
-        termNames.push_back(parentCategoryName+"longTermDebt");
-        termNames.push_back(parentCategoryName+"longTermDebtTotal");
-        termNames.push_back(parentCategoryName+"capitalLeaseObligations");
-        termNames.push_back(parentCategoryName+"netDebt");
-        termNames.push_back(parentCategoryName+"cash");
-        termNames.push_back(parentCategoryName+"shortTermDebtEstimate");
-        termNames.push_back(parentCategoryName+"shortTermDebtEstimateMethod");
-        termNames.push_back(parentCategoryName+"longTermDebtEstimate");
-        termNames.push_back(parentCategoryName+"longTermDebtEstimateMethod");
-        termNames.push_back(parentCategoryName+"totalDebtEstimate");
-
-        termValues.push_back(debtInfoUpd.shortTermDebt);
-        termValues.push_back(debtInfoUpd.shortLongTermDebt);
-        termValues.push_back(debtInfoUpd.shortLongTermDebtTotal);
-        termValues.push_back(debtInfoUpd.longTermDebt);
-        termValues.push_back(debtInfoUpd.longTermDebtTotal);
-        termValues.push_back(debtInfoUpd.capitalLeaseObligations);
-        termValues.push_back(debtInfoUpd.netDebt);
-        termValues.push_back(debtInfoUpd.cash);
-        termValues.push_back(debtInfoUpd.shortTermDebtEstimate);
-        termValues.push_back(shortTermDebtEstimateMethod);
-        termValues.push_back(debtInfoUpd.longTermDebtEstimate);
-        termValues.push_back(longTermDebtEstimateMethod);
-        termValues.push_back(debtInfoUpd.totalDebtEstimate);
+        termRecord.appendName({parentCategoryName, "shortTermDebt"});
+        termRecord.appendName({parentCategoryName, "shortLongTermDebt"});
+        termRecord.appendName({parentCategoryName, "shortLongTermDebtTotal"});
+        termRecord.appendName({parentCategoryName, "longTermDebt"});
+        termRecord.appendName({parentCategoryName, "longTermDebtTotal"});
+        termRecord.appendName({parentCategoryName, "capitalLeaseObligations"});
+        termRecord.appendName({parentCategoryName, "netDebt"});
+        termRecord.appendName({parentCategoryName, "cash"});
+        termRecord.appendName({parentCategoryName, "shortTermDebtEstimate"});
+        termRecord.appendName({parentCategoryName, "shortTermDebtEstimateMethod"});
+        termRecord.appendName({parentCategoryName, "longTermDebtEstimate"});
+        termRecord.appendName({parentCategoryName, "longTermDebtEstimateMethod"});
+        termRecord.appendName({parentCategoryName, "totalDebtEstimate"});
+
+        termRecord.appendValue(debtInfoUpd.shortTermDebt);
+        termRecord.appendValue(debtInfoUpd.shortLongTermDebt);
+        termRecord.appendValue(debtInfoUpd.shortLongTermDebtTotal);
+        termRecord.appendValue(debtInfoUpd.longTermDebt);
+        termRecord.appendValue(debtInfoUpd.longTermDebtTotal);
+        termRecord.appendValue(debtInfoUpd.capitalLeaseObligations);
+        termRecord.appendValue(debtInfoUpd.netDebt);
+        termRecord.appendValue(debtInfoUpd.cash);
+        termRecord.appendValue(debtInfoUpd.shortTermDebtEstimate);
+        termRecord.appendValue(shortTermDebtEstimateMethod);
+        termRecord.appendValue(debtInfoUpd.longTermDebtEstimate);
+        termRecord.appendValue(longTermDebtEstimateMethod);
+        termRecord.appendValue(debtInfoUpd.totalDebtEstimate);
 
       }
 
@@ -662,8 +1048,7 @@ class FinancialAnalysisFunctions {
                                     bool appendTermRecord,
                                     const std::string &parentCategoryName,
                                     bool setNansToMissingValue,
-                                    std::vector< std::string> &termNames,
-                                    std::vector< double > &termValues){
+                                    DataStructures::TermRecord &termRecord){
       // Return On Capital Deployed
       //  Source: https://www.investopedia.com/terms/r/roce.asp
       double longTermDebt = 
@@ -702,19 +1087,19 @@ class FinancialAnalysisFunctions {
         afterTaxOperatingIncome / (longTermDebt+totalStockholderEquity);
 
       if(appendTermRecord){
-        termNames.push_back(parentCategoryName+"returnOnCapitalDeployed_longTermDebt");
-        termNames.push_back(parentCategoryName+"returnOnCapitalDeployed_totalStockholderEquity");
-        termNames.push_back(parentCategoryName+"returnOnCapitalDeployed_operatingIncome");
-        termNames.push_back(parentCategoryName+"returnOnCapitalDeployed_taxRate");
-        termNames.push_back(parentCategoryName+"returnOnCapitalDeployed_afterTaxOperatingIncome");
-        termNames.push_back(parentCategoryName+"returnOnCapitalDeployed");
+        termRecord.appendName({parentCategoryName, "returnOnCapitalDeployed_longTermDebt"});
+        termRecord.appendName({parentCategoryName, "returnOnCapitalDeployed_totalStockholderEquity"});
+        termRecord.appendName({parentCategoryName, "returnOnCapitalDeployed_operatingIncome"});
+        termRecord.appendName({parentCategoryName, "returnOnCapitalDeployed_taxRate"});
+        termRecord.appendName({parentCategoryName, "returnOnCapitalDeployed_afterTaxOperatingIncome"});
+        termRecord.appendName({parentCategoryName, "returnOnCapitalDeployed"});
 
-        termValues.push_back(longTermDebt);
-        termValues.push_back(totalStockholderEquity);
-        termValues.push_back(operatingIncome);
-        termValues.push_back(taxRate);
-        termValues.push_back(afterTaxOperatingIncome);
-        termValues.push_back(returnOnCapitalDeployed);
+        termRecord.appendValue(longTermDebt);
+        termRecord.appendValue(totalStockholderEquity);
+        termRecord.appendValue(operatingIncome);
+        termRecord.appendValue(taxRate);
+        termRecord.appendValue(afterTaxOperatingIncome);
+        termRecord.appendValue(returnOnCapitalDeployed);
       }
 
       return returnOnCapitalDeployed;
@@ -768,8 +1153,7 @@ class FinancialAnalysisFunctions {
                                     bool appendTermRecord,
                                     const std::string &parentCategoryName,
                                     bool setNansToMissingValue,
-                                    std::vector< std::string> &termNames,
-                                    std::vector< double > &termValues){
+                                    DataStructures::TermRecord &termRecord){
 
       double netWorkingCapital= JsonFunctions::getJsonFloat(
                       jsonData[FIN][BAL][timeUnit][dateSet.dates[0].c_str()]
@@ -822,34 +1206,25 @@ class FinancialAnalysisFunctions {
       }
 
       if(appendTermRecord){
-        termNames.push_back(parentCategoryName
-          +"returnOnInvestedOperatingCapital_netWorkingCapital");
-        termNames.push_back(parentCategoryName
-          +"returnOnInvestedOperatingCapital_propertyPlantAndEquipmentNet");
-        termNames.push_back(parentCategoryName
-          +"returnOnInvestedOperatingCapital_intangibleAssets");
-        termNames.push_back(parentCategoryName
-          +"returnOnInvestedOperatingCapital_goodWill");
-        termNames.push_back(parentCategoryName
-          +"returnOnInvestedOperatingCapital_otherAssets");
-        termNames.push_back(parentCategoryName
-          +"returnOnInvestedOperatingCapital_operatingIncome");
-        termNames.push_back(parentCategoryName
-          +"returnOnInvestedOperatingCapital_taxRate");
-        termNames.push_back(parentCategoryName
-          +"returnOnInvestedOperatingCapital_afterTaxOperatingIncome");
-        termNames.push_back(parentCategoryName
-          +"returnOnInvestedOperatingCapital");
-
-        termValues.push_back(netWorkingCapital);
-        termValues.push_back(propertyPlantEquipmentNet);
-        termValues.push_back(intangibleAssets);
-        termValues.push_back(goodWill);
-        termValues.push_back(otherAssets);
-        termValues.push_back(operatingIncome);
-        termValues.push_back(taxRate);
-        termValues.push_back(afterTaxOperatingIncome);
-        termValues.push_back(returnOnInvestedCapital);
+        termRecord.appendName({parentCategoryName, "returnOnInvestedOperatingCapital_netWorkingCapital"});
+        termRecord.appendName({parentCategoryName, "returnOnInvestedOperatingCapital_propertyPlantAndEquipmentNet"});
+        termRecord.appendName({parentCategoryName, "returnOnInvestedOperatingCapital_intangibleAssets"});
+        termRecord.appendName({parentCategoryName, "returnOnInvestedOperatingCapital_goodWill"});
+        termRecord.appendName({parentCategoryName, "returnOnInvestedOperatingCapital_otherAssets"});
+        termRecord.appendName({parentCategoryName, "returnOnInvestedOperatingCapital_operatingIncome"});
+        termRecord.appendName({parentCategoryName, "returnOnInvestedOperatingCapital_taxRate"});
+        termRecord.appendName({parentCategoryName, "returnOnInvestedOperatingCapital_afterTaxOperatingIncome"});
+        termRecord.appendName({parentCategoryName, "returnOnInvestedOperatingCapital"});
+
+        termRecord.appendValue(netWorkingCapital);
+        termRecord.appendValue(propertyPlantEquipmentNet);
+        termRecord.appendValue(intangibleAssets);
+        termRecord.appendValue(goodWill);
+        termRecord.appendValue(otherAssets);
+        termRecord.appendValue(operatingIncome);
+        termRecord.appendValue(taxRate);
+        termRecord.appendValue(afterTaxOperatingIncome);
+        termRecord.appendValue(returnOnInvestedCapital);
       }
 
       return returnOnInvestedCapital;
@@ -921,8 +1296,7 @@ class FinancialAnalysisFunctions {
                                     bool appendTermRecord,
                                     const std::string &parentCategoryName,
                                     bool setNansToMissingValue,
-                                    std::vector< std::string> &termNames,
-                                    std::vector< double > &termValues){
+                                    DataStructures::TermRecord &termRecord){
 
 
       double debtBookValue = debtInfo.totalDebtEstimate;      
@@ -975,31 +1349,23 @@ class FinancialAnalysisFunctions {
       }
 
       if(appendTermRecord){
-        termNames.push_back(parentCategoryName
-          +"returnOnInvestedFinancialCapital_debtBookValue");
-        termNames.push_back(parentCategoryName
-          +"returnOnInvestedFinancialCapital_otherLongTermLiabilities");
-        termNames.push_back(parentCategoryName
-          +"returnOnInvestedFinancialCapital_totalStockholderEquity");
-        termNames.push_back(parentCategoryName
-          +"returnOnInvestedFinancialCapital_cash");
-        termNames.push_back(parentCategoryName
-          +"returnOnInvestedFinancialCapital_operatingIncome");
-        termNames.push_back(parentCategoryName
-          +"returnOnInvestedFinancialCapital_taxRate");
-        termNames.push_back(parentCategoryName
-          +"returnOnInvestedFinancialCapital_afterTaxOperatingIncome");
-        termNames.push_back(parentCategoryName
-          +"returnOnInvestedFinancialCapital");
-
-        termValues.push_back(debtBookValue);
-        termValues.push_back(std::nan("1"));
-        termValues.push_back(totalStockholderEquity);
-        termValues.push_back(cash);
-        termValues.push_back(operatingIncome);
-        termValues.push_back(taxRate);
-        termValues.push_back(afterTaxOperatingIncome);
-        termValues.push_back(returnOnInvestedCapital);
+        termRecord.appendName({parentCategoryName, "returnOnInvestedFinancialCapital_debtBookValue"});
+        termRecord.appendName({parentCategoryName, "returnOnInvestedFinancialCapital_otherLongTermLiabilities"});
+        termRecord.appendName({parentCategoryName, "returnOnInvestedFinancialCapital_totalStockholderEquity"});
+        termRecord.appendName({parentCategoryName, "returnOnInvestedFinancialCapital_cash"});
+        termRecord.appendName({parentCategoryName, "returnOnInvestedFinancialCapital_operatingIncome"});
+        termRecord.appendName({parentCategoryName, "returnOnInvestedFinancialCapital_taxRate"});
+        termRecord.appendName({parentCategoryName, "returnOnInvestedFinancialCapital_afterTaxOperatingIncome"});
+        termRecord.appendName({parentCategoryName, "returnOnInvestedFinancialCapital"});
+
+        termRecord.appendValue(debtBookValue);
+        termRecord.appendValue(std::nan("1"));
+        termRecord.appendValue(totalStockholderEquity);
+        termRecord.appendValue(cash);
+        termRecord.appendValue(operatingIncome);
+        termRecord.appendValue(taxRate);
+        termRecord.appendValue(afterTaxOperatingIncome);
+        termRecord.appendValue(returnOnInvestedCapital);
       }
 
       return returnOnInvestedCapital;
@@ -1014,8 +1380,7 @@ class FinancialAnalysisFunctions {
                                     bool appendTermRecord,
                                     const std::string &parentCategoryName,
                                     bool setNansToMissingValue,
-                                    std::vector< std::string> &termNames,
-                                    std::vector< double > &termValues){
+                                    DataStructures::TermRecord &termRecord){
 
       double totalStockholderEquity = JsonFunctions::getJsonFloat(
         jsonData[FIN][BAL][timeUnit][dateSet.dates[0].c_str()]
@@ -1040,13 +1405,13 @@ class FinancialAnalysisFunctions {
 
 
       if(appendTermRecord){
-        termNames.push_back(parentCategoryName+"returnOnEquity_netIncome");
-        termNames.push_back(parentCategoryName+"returnOnEquity_totalStockholderEquity");
-        termNames.push_back(parentCategoryName+"returnOnEquity");
+        termRecord.appendName({parentCategoryName, "returnOnEquity_netIncome"});
+        termRecord.appendName({parentCategoryName, "returnOnEquity_totalStockholderEquity"});
+        termRecord.appendName({parentCategoryName, "returnOnEquity"});
 
-        termValues.push_back(netIncome);
-        termValues.push_back(totalStockholderEquity);
-        termValues.push_back(returnOnEquity);
+        termRecord.appendValue(netIncome);
+        termRecord.appendValue(totalStockholderEquity);
+        termRecord.appendValue(returnOnEquity);
       }
 
       if(returnOnEquity < 0){
@@ -1062,8 +1427,7 @@ class FinancialAnalysisFunctions {
                                     bool appendTermRecord,
                                     const std::string &parentCategoryName,
                                     bool setNansToMissingValue,
-                                    std::vector< std::string> &termNames,
-                                    std::vector< double > &termValues){
+                                    DataStructures::TermRecord &termRecord){
       // Return On Invested Capital
       //  Source: 
       // https://www.investopedia.com/terms/r/returnoninvestmentcapital.asp
@@ -1097,13 +1461,13 @@ class FinancialAnalysisFunctions {
       }
 
       if(appendTermRecord){
-        termNames.push_back(parentCategoryName+"retentionRatio_netIncome");
-        termNames.push_back(parentCategoryName+"retentionRatio_dividendsPaid");
-        termNames.push_back(parentCategoryName+"retentionRatio");
+        termRecord.appendName({parentCategoryName, "retentionRatio_netIncome"});
+        termRecord.appendName({parentCategoryName, "retentionRatio_dividendsPaid"});
+        termRecord.appendName({parentCategoryName, "retentionRatio"});
 
-        termValues.push_back(netIncome);
-        termValues.push_back(dividendsPaid);
-        termValues.push_back(retentionRatio);
+        termRecord.appendValue(netIncome);
+        termRecord.appendValue(dividendsPaid);
+        termRecord.appendValue(retentionRatio);
 
       }
 
@@ -1122,8 +1486,7 @@ class FinancialAnalysisFunctions {
                                      const char *timeUnit,
                                      bool appendTermRecord,
                                      double setNansToMissingValue,
-                                     std::vector< std::string> &termNames,
-                                     std::vector< double > &termValues){
+                                     DataStructures::TermRecord &termRecord){
 
       double netIncome =  sumFundamentalDataOverDates(
           jsonData,FIN,CF,timeUnit,dateSet,"netIncome",
@@ -1151,13 +1514,13 @@ class FinancialAnalysisFunctions {
       }
 
       if(appendTermRecord){
-        termNames.push_back("returnOnAssets_netIncome");
-        termNames.push_back("returnOnAssets_totalAssets");
-        termNames.push_back("returnOnAssets");
+        termRecord.appendName("returnOnAssets_netIncome");
+        termRecord.appendName("returnOnAssets_totalAssets");
+        termRecord.appendName("returnOnAssets");
 
-        termValues.push_back(netIncome);
-        termValues.push_back(totalAssets);
-        termValues.push_back(returnOnAssets);
+        termRecord.appendValue(netIncome);
+        termRecord.appendValue(totalAssets);
+        termRecord.appendValue(returnOnAssets);
       }
 
       return returnOnAssets;
@@ -1174,8 +1537,7 @@ class FinancialAnalysisFunctions {
                                   const char *timeUnit,
                                   bool appendTermRecord,
                                   bool setNansToMissingValue,
-                                  std::vector< std::string> &termNames,
-                                  std::vector< double > &termValues){
+                                  DataStructures::TermRecord &termRecord){
       
       double totalRevenue = 
         sumFundamentalDataOverDates(
@@ -1200,13 +1562,13 @@ class FinancialAnalysisFunctions {
       }
 
       if(appendTermRecord){
-        termNames.push_back("grossMargin_totalRevenue");
-        termNames.push_back("grossMargin_costOfRevenue");
-        termNames.push_back("grossMargin");
+        termRecord.appendName("grossMargin_totalRevenue");
+        termRecord.appendName("grossMargin_costOfRevenue");
+        termRecord.appendName("grossMargin");
 
-        termValues.push_back(totalRevenue);
-        termValues.push_back(costOfRevenue);
-        termValues.push_back(grossMargin);
+        termRecord.appendValue(totalRevenue);
+        termRecord.appendValue(costOfRevenue);
+        termRecord.appendValue(grossMargin);
       }
 
       return grossMargin;
@@ -1221,8 +1583,7 @@ class FinancialAnalysisFunctions {
                                      const char *timeUnit,
                                      bool appendTermRecord,
                                      bool setNansToMissingValue,
-                                     std::vector< std::string> &termNames,
-                                     std::vector< double > &termValues){
+                                     DataStructures::TermRecord &termRecord){
 
       double operatingIncome = 
         sumFundamentalDataOverDates(
@@ -1247,13 +1608,13 @@ class FinancialAnalysisFunctions {
       }      
 
       if(appendTermRecord){
-        termNames.push_back("operatingMargin_operatingIncome");
-        termNames.push_back("operatingMargin_totalRevenue");
-        termNames.push_back("operatingMargin");
+        termRecord.appendName("operatingMargin_operatingIncome");
+        termRecord.appendName("operatingMargin_totalRevenue");
+        termRecord.appendName("operatingMargin");
 
-        termValues.push_back(operatingIncome);
-        termValues.push_back(totalRevenue);
-        termValues.push_back(operatingMargin);
+        termRecord.appendValue(operatingIncome);
+        termRecord.appendValue(totalRevenue);
+        termRecord.appendValue(operatingMargin);
       }
 
       return operatingMargin;
@@ -1264,14 +1625,10 @@ class FinancialAnalysisFunctions {
      * https://corporatefinanceinstitute.com/resources/accounting/cash-conversion-ratio/
     */
     static double calcCashConversionRatio(
-                    const nlohmann::ordered_json &jsonData, 
-                    const DateFunctions::DateSetTTM &dateSet,
-                    const char *timeUnit,
+                    MetricGraph &metricGraph,
                     double taxRate,
                     bool appendTermRecord,
-                    bool setNansToMissingValue,
-                    std::vector< std::string> &termNames,
-                    std::vector< double > &termValues){
+                    DataStructures::TermRecord &termRecord){
       /*
         Free cash flow is not reported in the 10-Q that I'm working through,
         but it does appear in EOD's data. The formula suggested from 
@@ -1335,20 +1692,15 @@ class FinancialAnalysisFunctions {
       */
 
       std::string categoryName("cashFlowConversionRatio_");
-      double freeCashFlow =  calcFreeCashFlow(  jsonData,
-                                                dateSet,
-                                                timeUnit, 
+      bool setNansToMissingValue = metricGraph.setNansToMissingValue;
+
+      double freeCashFlow =  calcFreeCashFlow(  metricGraph,
                                                 taxRate, 
                                                 appendTermRecord,
                                                 categoryName, 
-                                                setNansToMissingValue,
-                                                termNames, 
-                                                termValues);
+                                                termRecord);
 
-      double netIncome = 
-        sumFundamentalDataOverDates(
-            jsonData,FIN,IS,timeUnit,dateSet,
-            "netIncome", setNansToMissingValue);
+      double netIncome = getMetric(metricGraph, METRIC_NET_INCOME_IS);
 
 
       double cashFlowConversionRatio = (freeCashFlow)/netIncome;
@@ -1363,11 +1715,11 @@ class FinancialAnalysisFunctions {
       }
 
       if(appendTermRecord){
-        termNames.push_back(categoryName+"netIncome");
-        termNames.push_back("cashFlowConversionRatio");
+        termRecord.appendName({categoryName, "netIncome"});
+        termRecord.appendName("cashFlowConversionRatio");
 
-        termValues.push_back(netIncome);
-        termValues.push_back(cashFlowConversionRatio);
+        termRecord.appendValue(netIncome);
+        termRecord.appendValue(cashFlowConversionRatio);
       }
 
       return cashFlowConversionRatio;
@@ -1385,8 +1737,7 @@ class FinancialAnalysisFunctions {
                                     const DataStructures::DebtInfo &debtInfo,                               
                                     bool appendTermRecord,
                                     bool setNansToMissingValue,
-                                    std::vector< std::string> &termNames,
-                                    std::vector< double > &termValues){
+                                    DataStructures::TermRecord &termRecord){
 
                                 
       double totalStockholderEquity =  
@@ -1411,13 +1762,13 @@ class FinancialAnalysisFunctions {
       }    
 
       if(appendTermRecord){
-        termNames.push_back("debtToCapitalizationRatio_totalDebtEstimate");
-        termNames.push_back("debtToCapitalizationRatio_totalStockholderEquity");
-        termNames.push_back("debtToCapitalizationRatio");
+        termRecord.appendName("debtToCapitalizationRatio_totalDebtEstimate");
+        termRecord.appendName("debtToCapitalizationRatio_totalStockholderEquity");
+        termRecord.appendName("debtToCapitalizationRatio");
 
-        termValues.push_back(debtInfo.totalDebtEstimate);
-        termValues.push_back(totalStockholderEquity);
-        termValues.push_back(debtToCapitalizationRatio);
+        termRecord.appendValue(debtInfo.totalDebtEstimate);
+        termRecord.appendValue(totalStockholderEquity);
+        termRecord.appendValue(debtToCapitalizationRatio);
       }
 
       return debtToCapitalizationRatio;                    
@@ -1428,33 +1779,18 @@ class FinancialAnalysisFunctions {
      https://www.investopedia.com/terms/i/interestcoverageratio.asp
     */
     static double calcInterestCover(
-                          const nlohmann::ordered_json &jsonData, 
-                          const DateFunctions::DateSetTTM &dateSet,
+                          MetricGraph &metricGraph,
                           double defaultInterestCover,
-                          const nlohmann::ordered_json &jsonDefaultSpread,
-                          const char *timeUnit,                                    
+                const ReferenceDataFunctions::DefaultSpreadTable &defaultSpreads,
                           bool appendTermRecord,                                    
-                          bool setNansToMissingValue,
-                          std::vector< std::string> &termNames,
-                          std::vector< double > &termValues){
+                          DataStructures::TermRecord &termRecord){
 
                                       
-      double operatingIncome = 
-        sumFundamentalDataOverDates(jsonData,FIN,IS,timeUnit,dateSet,
-                                  "operatingIncome",setNansToMissingValue);
-
-      double interestExpense = 
-        sumFundamentalDataOverDates(jsonData,FIN,IS,timeUnit,dateSet,
-                                  "interestExpense",setNansToMissingValue);
-
-      int tableSize = jsonDefaultSpread["US"]["default_spread"].size();
+      double operatingIncome = getMetric(metricGraph,METRIC_OPERATING_INCOME);
+      double interestExpense = getMetric(metricGraph,METRIC_INTEREST_EXPENSE);
 
-      double interestCoverLowestValue = JsonFunctions::getJsonFloat(
-            jsonDefaultSpread["US"]["default_spread"].at(0).at(0),
-            setNansToMissingValue);
-      double interestCoverHighestValue = JsonFunctions::getJsonFloat(
-            jsonDefaultSpread["US"]["default_spread"].at(tableSize-1).at(1),
-            setNansToMissingValue);
+      double interestCoverHighestValue = ReferenceDataFunctions::
+          getInterestCoverHighestValue(defaultSpreads);
 
 
       double interestCover= std::nan("1");
@@ -1462,7 +1798,7 @@ class FinancialAnalysisFunctions {
       if(   JsonFunctions::isJsonFloatValid(operatingIncome)
          && JsonFunctions::isJsonFloatValid(interestExpense)){
           if(std::abs(interestExpense) > 0){
-            interestCover = operatingIncome/interestExpense;
+            interestCover = getMetric(metricGraph,METRIC_INTEREST_COVER);
           }else{
             interestCover = interestCoverHighestValue;
           }
@@ -1476,13 +1812,13 @@ class FinancialAnalysisFunctions {
       }      
 
       if(appendTermRecord){
-        termNames.push_back("interestCover_operatingIncome");
-        termNames.push_back("interestCover_interestExpense");
-        termNames.push_back("interestCover");
+        termRecord.appendName("interestCover_operatingIncome");
+        termRecord.appendName("interestCover_interestExpense");
+        termRecord.appendName("interestCover");
 
-        termValues.push_back(operatingIncome);
-        termValues.push_back(interestExpense);
-        termValues.push_back(interestCover);
+        termRecord.appendValue(operatingIncome);
+        termRecord.appendValue(interestExpense);
+        termRecord.appendValue(interestCover);
       }
 
       if(std::isinf(interestCover)){
@@ -1495,26 +1831,20 @@ class FinancialAnalysisFunctions {
 
     //==========================================================================
     static double calcDefaultSpread(
-                    const nlohmann::ordered_json &jsonData, 
-                    const DateFunctions::DateSetTTM &dateSet,
-                    const char *timeUnit,
+                    MetricGraph &metricGraph,
                     double meanInterestCover,
-                    const nlohmann::ordered_json &jsonDefaultSpread,
+                const ReferenceDataFunctions::DefaultSpreadTable &defaultSpreads,
                     bool appendTermRecord,
-                    bool setNansToMissingValue,
-                    std::vector< std::string> &termNames,
-                    std::vector< double > &termValues){
+                    DataStructures::TermRecord &termRecord){
+
+        bool setNansToMissingValue = metricGraph.setNansToMissingValue;
 
         double interestCover = FinancialAnalysisFunctions::
-          calcInterestCover(jsonData,
-                            dateSet,
+          calcInterestCover(metricGraph,
                             meanInterestCover,
-                            jsonDefaultSpread,
-                            timeUnit,
+                            defaultSpreads,
                             appendTermRecord,
-                            setNansToMissingValue,
-                            termNames,
-                            termValues);
+                            termRecord);
 
         if(!JsonFunctions::isJsonFloatValid(interestCover)){
           interestCover = meanInterestCover;
@@ -1524,62 +1854,9 @@ class FinancialAnalysisFunctions {
           return std::nan("1");
         }
 
-        double defaultSpread = std::nan("1");
-        if(setNansToMissingValue){
-          defaultSpread = JsonFunctions::MISSING_VALUE;
-        }
-
-        bool found=false;
-        unsigned int i=0;        
-        int tableSize = jsonDefaultSpread["US"]["default_spread"].size();
-
-        double interestCoverLowestValue = JsonFunctions::getJsonFloat(
-              jsonDefaultSpread["US"]["default_spread"].at(0).at(0),
-              setNansToMissingValue);
-        double interestCoverHighestValue = JsonFunctions::getJsonFloat(
-              jsonDefaultSpread["US"]["default_spread"].at(tableSize-1).at(1),
-              setNansToMissingValue);
-
-        if(interestCover < interestCoverLowestValue 
-          && JsonFunctions::isJsonFloatValid(interestCoverLowestValue)){
-          defaultSpread = JsonFunctions::getJsonFloat(
-                jsonDefaultSpread["US"]["default_spread"].at(0).at(2),
-                setNansToMissingValue);
-        
-        }else if(interestCover > interestCoverHighestValue
-                 && JsonFunctions::isJsonFloatValid(interestCoverHighestValue)){
-          defaultSpread = JsonFunctions::getJsonFloat(
-                jsonDefaultSpread["US"]["default_spread"].at(tableSize-1).at(2),
-                setNansToMissingValue);          
-        
-        }else{        
-          while(found == false 
-                && i < tableSize){
-            
-            double interestCoverLowerBound = JsonFunctions::getJsonFloat(
-                jsonDefaultSpread["US"]["default_spread"].at(i).at(0),
-                setNansToMissingValue);
-            double interestCoverUpperBound = JsonFunctions::getJsonFloat(
-                jsonDefaultSpread["US"]["default_spread"].at(i).at(1),
-                setNansToMissingValue);
-            double defaultSpreadIntervalValue = JsonFunctions::getJsonFloat(
-                jsonDefaultSpread["US"]["default_spread"].at(i).at(2),
-                setNansToMissingValue);
-
-
-            if(    JsonFunctions::isJsonFloatValid(interestCoverLowerBound)
-                && JsonFunctions::isJsonFloatValid(interestCoverUpperBound)
-                && JsonFunctions::isJsonFloatValid(defaultSpreadIntervalValue)){
-
-              if(interestCover >= interestCoverLowerBound
-              && interestCover <= interestCoverUpperBound){
-                defaultSpread = defaultSpreadIntervalValue;
-                found=true;
-              }
-            }
-            ++i;
-          } 
-        }
+        double defaultSpread = ReferenceDataFunctions::
+          getDefaultSpread(defaultSpreads, interestCover, 
+                           setNansToMissingValue);
 
         if(std::isnan(defaultSpread) || std::isinf(defaultSpread) 
            || !JsonFunctions::isJsonFloatValid(defaultSpread)){
@@ -1604,40 +1881,33 @@ class FinancialAnalysisFunctions {
           std::abort();
         }       
 
-        termNames.push_back("defaultSpread_interestCover");
-        termNames.push_back("defaultSpread");
-        termValues.push_back(interestCover);
-        termValues.push_back(defaultSpread);
+        termRecord.appendName("defaultSpread_interestCover");
+        termRecord.appendName("defaultSpread");
+        termRecord.appendValue(interestCover);
+        termRecord.appendValue(defaultSpread);
 
         return defaultSpread;
     };
 
 
     //==========================================================================
-    static double calcFreeCashFlow( const nlohmann::ordered_json &jsonData, 
-                                    const DateFunctions::DateSetTTM &dateSet,
-                                    const char *timeUnit,
+    static double calcFreeCashFlow( MetricGraph &metricGraph,
                                     double taxRate,
                                     bool appendTermRecord,
                                     std::string parentCategoryName,
-                                    bool setNansToMissingValue,
-                                    std::vector< std::string> &termNames,
-                                    std::vector< double > &termValues){
+                                    DataStructures::TermRecord &termRecord){
+
+      bool setNansToMissingValue = metricGraph.setNansToMissingValue;
 
-      
       //Investopedia definition
       //https://www.investopedia.com/terms/f/freecashflow.asp
 
       double totalCashFromOperatingActivities = 
-        sumFundamentalDataOverDates(
-            jsonData,FIN,CF,timeUnit,dateSet,
-            "totalCashFromOperatingActivities", setNansToMissingValue);                    
+        getMetric(metricGraph, METRIC_TOTAL_CASH_FROM_OPERATING_ACTIVITIES);
 
       //Sometimes this is not reported. I would rather this get computed
       double interestExpense = 
-        sumFundamentalDataOverDates(
-            jsonData,FIN,IS,timeUnit,dateSet,
-            "interestExpense", true);  
+        getMetric(metricGraph, METRIC_INTEREST_EXPENSE, true);
 
       std::string resultName(parentCategoryName);
       resultName.append("freeCashFlow_");                    
@@ -1645,9 +1915,7 @@ class FinancialAnalysisFunctions {
       double taxShieldOnInterestExpense = interestExpense*taxRate;
 
       double capitalExpenditures = 
-        sumFundamentalDataOverDates(
-            jsonData,FIN,CF,timeUnit,dateSet,
-            "capitalExpenditures", setNansToMissingValue);    
+        getMetric(metricGraph, METRIC_CAPITAL_EXPENDITURES);
 
       double freeCashFlow = 
           totalCashFromOperatingActivities
@@ -1656,9 +1924,7 @@ class FinancialAnalysisFunctions {
           - capitalExpenditures;
 
       double freeCashFlowEOD = 
-        sumFundamentalDataOverDates(
-            jsonData,FIN,CF,timeUnit,dateSet,
-            "freeCashFlow", setNansToMissingValue); 
+        getMetric(metricGraph, METRIC_FREE_CASH_FLOW_EOD);
 
 
       double freeCashFlowReturned = freeCashFlow;
@@ -1684,23 +1950,23 @@ class FinancialAnalysisFunctions {
 
       if(appendTermRecord){
         
-        termNames.push_back(resultName + "totalCashFromOperatingActivities");
-        termNames.push_back(resultName + "interestExpense");
-        termNames.push_back(resultName + "taxRate");
-        termNames.push_back(resultName + "taxShieldOnInterestExpense");
-        termNames.push_back(resultName + "capitalExpenditures");
-        termNames.push_back(resultName + "freeCashFlow");
-        termNames.push_back(resultName + "freeCashFlowEOD");
-        termNames.push_back(parentCategoryName+"freeCashFlow");
-
-        termValues.push_back(totalCashFromOperatingActivities);
-        termValues.push_back(interestExpense);
-        termValues.push_back(taxRate);
-        termValues.push_back(taxShieldOnInterestExpense);
-        termValues.push_back(capitalExpenditures);
-        termValues.push_back(freeCashFlow);
-        termValues.push_back(freeCashFlowEOD);
-        termValues.push_back(freeCashFlowReturned);
+        termRecord.appendName({resultName, "totalCashFromOperatingActivities"});
+        termRecord.appendName({resultName, "interestExpense"});
+        termRecord.appendName({resultName, "taxRate"});
+        termRecord.appendName({resultName, "taxShieldOnInterestExpense"});
+        termRecord.appendName({resultName, "capitalExpenditures"});
+        termRecord.appendName({resultName, "freeCashFlow"});
+        termRecord.appendName({resultName, "freeCashFlowEOD"});
+        termRecord.appendName({parentCategoryName, "freeCashFlow"});
+
+        termRecord.appendValue(totalCashFromOperatingActivities);
+        termRecord.appendValue(interestExpense);
+        termRecord.appendValue(taxRate);
+        termRecord.appendValue(taxShieldOnInterestExpense);
+        termRecord.appendValue(capitalExpenditures);
+        termRecord.appendValue(freeCashFlow);
+        termRecord.appendValue(freeCashFlowEOD);
+        termRecord.appendValue(freeCashFlowReturned);
  
       }
 
@@ -1710,92 +1976,24 @@ class FinancialAnalysisFunctions {
 
     //==========================================================================
     static double calcNetCapitalExpenditures(
-                      const nlohmann::ordered_json &jsonData, 
-                      const DateFunctions::DateSetTTM &dateSet,
-                      const DateFunctions::DateSetTTM &previousDateSet,
-                      const char *timeUnit,
+                      MetricGraph &metricGraph,
                       bool appendTermRecord,
                       const std::string &parentCategoryName,
-                      bool setNansToMissingValue,
                       bool ignoreDepreciation,
-                      std::vector< std::string> &termNames,
-                      std::vector< double > &termValues){
-      /*
-      Problem: the depreciation field in EOD's json data is often null
-      Solution: Since Damodran's formula for net capital expenditures is
+                      DataStructures::TermRecord &termRecord){
 
-      net capital expenditures =  capital expenditure - depreciation  [a]
+      //The capital expenditures are estimated from the change in plant,
+      //property, and equipment when they are not reported: see
+      //evaluateCapitalExpendituresEstimate
+      bool setNansToMissingValue = metricGraph.setNansToMissingValue;
 
-      where capital expendature is the change in plant, property and equipment
-      from the previous year we can instead use:
+      double capitalExpenditures = 
+        getMetric(metricGraph, METRIC_CAPITAL_EXPENDITURES_ESTIMATE);
 
-      capital expenditure = PPE - PPE_previousYear
-
-      References
-        https://www.investopedia.com/terms/c/capitalexpenditure.asp
-
-        Damodaran, A.(2011). The Little Book of Valuation. Wiley.
-      */
-
-
-      double capitalExpenditures = 
-        sumFundamentalDataOverDates(
-          jsonData,FIN,CF,timeUnit,dateSet,"capitalExpenditures",
-          setNansToMissingValue);
-
-      double plantPropertyEquipment=0;
-      double plantPropertyEquipmentPrevious=0;
-      double changeInPlantPropertyEquipment = 0;
-
-      if(!JsonFunctions::isJsonFloatValid(capitalExpenditures)){
-
-        //Append the first interval of the previous data set to make it 
-        //possible to evaluate the change in quantities associated with 
-        //every entry in dataSet        
-        DateFunctions::DateSetTTM dateSetAnalysis(dateSet);
-        dateSetAnalysis.appendDate(previousDateSet.dates[0],
-                                   previousDateSet.days[0]);
-
-        capitalExpenditures=0.;
-
-        for(int indexPrevious=1; 
-          indexPrevious < dateSetAnalysis.dates.size();++indexPrevious){
-
-          int index = indexPrevious-1;
-          double weight = dateSetAnalysis.weights[index];
-          double weightPrevious = dateSetAnalysis.weights[indexPrevious];
-
-          //Use an alternative method to calculate capital expenditures
-          plantPropertyEquipment = 
-            JsonFunctions::getJsonFloat(
-              jsonData[FIN][BAL][timeUnit][dateSetAnalysis.dates[index].c_str()]
-              ["propertyPlantEquipment"], setNansToMissingValue);
-          plantPropertyEquipment *= weight;
-
-          plantPropertyEquipmentPrevious = 
-            JsonFunctions::getJsonFloat(
-              jsonData[FIN][BAL][timeUnit][dateSetAnalysis.dates[indexPrevious].c_str()]
-              ["propertyPlantEquipment"], setNansToMissingValue);
-          plantPropertyEquipmentPrevious *= weightPrevious;
+      double changeInPlantPropertyEquipment = 
+        getMetric(metricGraph, METRIC_CHANGE_IN_PLANT_PROPERTY_EQUIPMENT);
 
-          //If one of the PPE's is populated copy it over to the PPE that is
-          //nan: this is a better approximation of the PPE than 0.
-          if(   JsonFunctions::isJsonFloatValid(plantPropertyEquipment) 
-            && JsonFunctions::isJsonFloatValid(plantPropertyEquipmentPrevious)){
-            changeInPlantPropertyEquipment +=
-                    ( plantPropertyEquipment
-                     -plantPropertyEquipmentPrevious);                                         
-          } 
-          capitalExpenditures  += (changeInPlantPropertyEquipment); 
-
-        }              
-      }
-
-
-      double depreciation = 
-          sumFundamentalDataOverDates(
-            jsonData,FIN,CF,timeUnit,dateSet,"depreciation",
-            setNansToMissingValue);
+      double depreciation = getMetric(metricGraph, METRIC_DEPRECIATION);
 
       if(ignoreDepreciation){
         depreciation=0.;
@@ -1813,19 +2011,15 @@ class FinancialAnalysisFunctions {
       }
 
       if(appendTermRecord){
-        termNames.push_back(parentCategoryName 
-          + "netCapitalExpenditures_changeInPlantPropertyEquipment");
-        termNames.push_back(parentCategoryName 
-          + "netCapitalExpenditures_capitalExpenditures");
-        termNames.push_back(parentCategoryName 
-          + "netCapitalExpenditures_depreciation");
-        termNames.push_back(parentCategoryName 
-          + "netCapitalExpenditures");
+        termRecord.appendName({parentCategoryName, "netCapitalExpenditures_changeInPlantPropertyEquipment"});
+        termRecord.appendName({parentCategoryName, "netCapitalExpenditures_capitalExpenditures"});
+        termRecord.appendName({parentCategoryName, "netCapitalExpenditures_depreciation"});
+        termRecord.appendName({parentCategoryName, "netCapitalExpenditures"});
 
-        termValues.push_back(changeInPlantPropertyEquipment);     
-        termValues.push_back(capitalExpenditures);
-        termValues.push_back(depreciation);     
-        termValues.push_back(netCapitalExpenditures);
+        termRecord.appendValue(changeInPlantPropertyEquipment);     
+        termRecord.appendValue(capitalExpenditures);
+        termRecord.appendValue(depreciation);     
+        termRecord.appendValue(netCapitalExpenditures);
       }
 
       return netCapitalExpenditures;
@@ -1833,142 +2027,30 @@ class FinancialAnalysisFunctions {
 
     //==========================================================================
     static double calcChangeInNonCashWorkingCapital(
-                        const nlohmann::ordered_json &jsonData, 
-                        const DateFunctions::DateSetTTM &dateSet,
-                        const DateFunctions::DateSetTTM &previousDateSet,
-                        const char *timeUnit,
+                        MetricGraph &metricGraph,
                         bool appendTermRecord,
                         const std::string &parentCategoryName,
-                        bool setNansToMissingValue,
-                        std::vector< std::string> &termNames,
-                        std::vector< double > &termValues){
-      /*
-        Problem: Damodran's FCFE needs change in non-cash working capital, but
-                 this quantity is not really reported by EOD. 
-
-        Solution: calculate the change in non-cash working capital directly 
-                  using the suggestions in Ch. 3 of Damodran
-
-        change non-cash working capital = (inventory-inventoryPrevious)
-                                        + (netReceivables-netReceivablesPrevious)
-                                        - (accountsPayable-accountsPayablePrevious)
-
-      */
-
-      bool isInputValid=true;
-
-      //Append the first interval of the previous data set to make it 
-      //possible to evaluate the change in quantities associated with 
-      //every entry in dataSet
-      DateFunctions::DateSetTTM dateSetAnalysis(dateSet);
-      dateSetAnalysis.appendDate(previousDateSet.dates[0],
-                                previousDateSet.days[0]);
-    
-      double changeInNonCashWorkingCapital = 0.;
-      double changeInInventory          = 0.;
-      double changeInReceivables        = 0.;
-      double changeInAccountsPayable    = 0.;
-      bool changeInInventoryAdded       = false;
-      bool changeInReceivablesAdded     = false;
-      bool changeInAccountsPayableAdded = false;
-
-      for(int indexPrevious=1; 
-          indexPrevious < dateSetAnalysis.dates.size();++indexPrevious){
-
-        int index = indexPrevious-1;
-
-
-        std::string date         = dateSetAnalysis.dates[index];
-        std::string datePrevious = dateSetAnalysis.dates[indexPrevious];
-
-        //Inventory, receivables, and accounts payable are quantities that
-        //do not accumulate over the year. I'm not going to use the
-        //weights associated with each date to scale the inventory, for example,
-        //for reporting periods that span more than a quarter.
-        //
-        //double weight = dateSetAnalysis.weights[index];
-        //double weightPrevious = dateSetAnalysis.weights[indexPrevious];
-
-        double inventory =  
-          JsonFunctions::getJsonFloat(      
-            jsonData[FIN][BAL][timeUnit][date.c_str()]["inventory"],
-            setNansToMissingValue);
-        //inventory *= weight;
-
-        double inventoryPrevious = 
-          JsonFunctions::getJsonFloat(  
-            jsonData[FIN][BAL][timeUnit][datePrevious.c_str()]["inventory"],
-            setNansToMissingValue);
-        //inventoryPrevious *= weightPrevious;
-
-        double netReceivables =
-          JsonFunctions::getJsonFloat(  
-            jsonData[FIN][BAL][timeUnit][date.c_str()]["netReceivables"],
-            setNansToMissingValue);
-        //netReceivables *= weight;
-
-        double netReceivablesPrevious = 
-          JsonFunctions::getJsonFloat(  
-            jsonData[FIN][BAL][timeUnit][datePrevious.c_str()]["netReceivables"],
-            setNansToMissingValue);
-        //netReceivablesPrevious *= weightPrevious;
-
-        double accountsPayable =
-          JsonFunctions::getJsonFloat(  
-            jsonData[FIN][BAL][timeUnit][date.c_str()]["accountsPayable"],
-            setNansToMissingValue);
-        //accountsPayable *= weight;
-
-        double accountsPayablePrevious = 
-          JsonFunctions::getJsonFloat(  
-            jsonData[FIN][BAL][timeUnit][datePrevious.c_str()]["accountsPayable"],
-            setNansToMissingValue);
-        //accountsPayablePrevious *= weightPrevious;
-
-        //There are a number of companies that produce software or a service
-        //and so never have any inventory to report.
-        if(    JsonFunctions::isJsonFloatValid(  inventory)
-            && JsonFunctions::isJsonFloatValid(  inventoryPrevious)){
-          changeInInventory += (inventory-inventoryPrevious);
-          changeInNonCashWorkingCapital += (inventory-inventoryPrevious);
-          changeInInventoryAdded       = true;
-        }
+                        DataStructures::TermRecord &termRecord){
 
-        if(    JsonFunctions::isJsonFloatValid(  netReceivables         )
-            && JsonFunctions::isJsonFloatValid(  netReceivablesPrevious )){
-          changeInReceivables += (netReceivables-netReceivablesPrevious);
-          changeInNonCashWorkingCapital += (netReceivables-netReceivablesPrevious);
-          changeInReceivablesAdded     = true;
-        }
-
-        if(    JsonFunctions::isJsonFloatValid(  accountsPayable        )
-            && JsonFunctions::isJsonFloatValid(  accountsPayablePrevious)){
-          changeInAccountsPayable += -1.0*(accountsPayable-accountsPayablePrevious);       
-          changeInNonCashWorkingCapital += -1.0*(accountsPayable-accountsPayablePrevious);
-          changeInAccountsPayableAdded = true;
-        }
-
-      }
+      //See evaluateChangeInNonCashWorkingCapital
+      double changeInNonCashWorkingCapital = 
+        getMetric(metricGraph, METRIC_CHANGE_IN_NON_CASH_WORKING_CAPITAL);
           
       if(appendTermRecord){
 
-        termNames.push_back(parentCategoryName 
-        + "changeInNonCashWorkingCapital_changeInInventory");
+        termRecord.appendName({parentCategoryName, "changeInNonCashWorkingCapital_changeInInventory"});
 
-        termNames.push_back(parentCategoryName 
-          + "changeInNonCashWorkingCapital_changeInNetReceivables");
+        termRecord.appendName({parentCategoryName, "changeInNonCashWorkingCapital_changeInNetReceivables"});
 
-        termNames.push_back(parentCategoryName 
-          + "changeInNonCashWorkingCapital_changeInAccountsPayable");
+        termRecord.appendName({parentCategoryName, "changeInNonCashWorkingCapital_changeInAccountsPayable"});
 
-        termValues.push_back(changeInInventory);
-        termValues.push_back(changeInReceivables);
-        termValues.push_back(changeInAccountsPayable);
+        termRecord.appendValue(getMetric(metricGraph, METRIC_CHANGE_IN_INVENTORY));
+        termRecord.appendValue(getMetric(metricGraph, METRIC_CHANGE_IN_NET_RECEIVABLES));
+        termRecord.appendValue(getMetric(metricGraph, METRIC_CHANGE_IN_ACCOUNTS_PAYABLE));
 
-        termNames.push_back(parentCategoryName 
-          + "changeInNonCashWorkingCapital");
+        termRecord.appendName({parentCategoryName, "changeInNonCashWorkingCapital"});
 
-        termValues.push_back(changeInNonCashWorkingCapital);   
+        termRecord.appendValue(changeInNonCashWorkingCapital);   
       }  
 
       return changeInNonCashWorkingCapital;
@@ -1995,53 +2077,32 @@ class FinancialAnalysisFunctions {
       Damodaran, A.(2011). The Little Book of Valuation. Wiley.
     */
     static double calcFreeCashFlowToEquity(
-                            const nlohmann::ordered_json &jsonData, 
-                            const DateFunctions::DateSetTTM &dateSet,
-                            const DateFunctions::DateSetTTM &previousDateSet,
-                            const char *timeUnit,
+                            MetricGraph &metricGraph,
                             const DataStructures::DebtInfo &debtInfo,
                             const DataStructures::DebtInfo &previousDebtInfo,
                             bool appendTermRecord,
-                            bool setNansToMissingValue,
-                            std::vector< std::string> &termNames,
-                            std::vector< double > &termValues){
+                            DataStructures::TermRecord &termRecord){
 
-      
+      bool setNansToMissingValue = metricGraph.setNansToMissingValue;
       std::string parentName = "freeCashFlowToEquity_";
       
-      double netIncome = 
-        sumFundamentalDataOverDates(
-          jsonData,FIN,CF,timeUnit,dateSet,"netIncome",
-          setNansToMissingValue);
+      double netIncome = getMetric(metricGraph, METRIC_NET_INCOME_CF);
 
-      double depreciation = 
-        sumFundamentalDataOverDates(
-          jsonData,FIN,CF,timeUnit,dateSet,"depreciation",
-          setNansToMissingValue);
+      double depreciation = getMetric(metricGraph, METRIC_DEPRECIATION);
 
       bool ignoreDepreciation=false;
       double netCapitalExpenditures = 
-        calcNetCapitalExpenditures( jsonData, 
-                                    dateSet,
-                                    previousDateSet,
-                                    timeUnit,
+        calcNetCapitalExpenditures( metricGraph,
                                     appendTermRecord,
                                     parentName,
-                                    setNansToMissingValue,
                                     ignoreDepreciation,
-                                    termNames,
-                                    termValues);
+                                    termRecord);
 
       double changeInNonCashWorkingCapital = 
-        calcChangeInNonCashWorkingCapital( jsonData, 
-                                    dateSet,
-                                    previousDateSet,
-                                    timeUnit,
+        calcChangeInNonCashWorkingCapital( metricGraph,
                                     appendTermRecord,
                                     parentName,
-                                    setNansToMissingValue,
-                                    termNames,
-                                    termValues);                                    
+                                    termRecord);                                    
       /*
         Problem: the change in cash due to debt is not something that EOD 
                  reports, though in the case of 3M 2007 10-K this value is
@@ -2103,24 +2164,24 @@ class FinancialAnalysisFunctions {
 
 
       if(appendTermRecord){
-        termNames.push_back("freeCashFlowToEquity_netIncome");
-        termNames.push_back("freeCashFlowToEquity_depreciation");
-        termNames.push_back("freeCashFlowToEquity_netCapitalExpenditures");
-        termNames.push_back("freeCashFlowToEquity_changeInNonCashWorkingCapital");
-        termNames.push_back("freeCashFlowToEquity_debt");
-        termNames.push_back("freeCashFlowToEquity_previousDebt");
-        termNames.push_back("freeCashFlowToEquity_changeInDebt");
-        termNames.push_back("freeCashFlowToEquity");
-
-        termValues.push_back(netIncome);
-        termValues.push_back(depreciation);
-        termValues.push_back(netCapitalExpenditures); 
-        termValues.push_back(changeInNonCashWorkingCapital); 
-        termValues.push_back(totalDebt);
-        termValues.push_back(previousTotalDebt);
-        termValues.push_back(changeInDebt);
-
-        termValues.push_back(freeCashFlowToEquity);
+        termRecord.appendName("freeCashFlowToEquity_netIncome");
+        termRecord.appendName("freeCashFlowToEquity_depreciation");
+        termRecord.appendName("freeCashFlowToEquity_netCapitalExpenditures");
+        termRecord.appendName("freeCashFlowToEquity_changeInNonCashWorkingCapital");
+        termRecord.appendName("freeCashFlowToEquity_debt");
+        termRecord.appendName("freeCashFlowToEquity_previousDebt");
+        termRecord.appendName("freeCashFlowToEquity_changeInDebt");
+        termRecord.appendName("freeCashFlowToEquity");
+
+        termRecord.appendValue(netIncome);
+        termRecord.appendValue(depreciation);
+        termRecord.appendValue(netCapitalExpenditures); 
+        termRecord.appendValue(changeInNonCashWorkingCapital); 
+        termRecord.appendValue(totalDebt);
+        termRecord.appendValue(previousTotalDebt);
+        termRecord.appendValue(changeInDebt);
+
+        termRecord.appendValue(freeCashFlowToEquity);
       }
 
       return freeCashFlowToEquity;
@@ -2136,20 +2197,19 @@ class FinancialAnalysisFunctions {
                     const char *timeUnit,   
                     bool appendTermRecord,
                     bool setNansToMissingValue,
-                    std::vector< std::string> &termNames,
-                    std::vector< double > &termValues)                    
+                    DataStructures::TermRecord &termRecord)                    
     {
 
       double acquirersMultiple = enterpriseValue/operatingEarnings;
 
       if(appendTermRecord){
-        termNames.push_back("acquirersMultiple_operatingEarnings");
-        termNames.push_back("acquirersMultiple_enterpriseValue");
-        termNames.push_back("acquirersMultiple");
+        termRecord.appendName("acquirersMultiple_operatingEarnings");
+        termRecord.appendName("acquirersMultiple_enterpriseValue");
+        termRecord.appendName("acquirersMultiple");
 
-        termValues.push_back(operatingEarnings);
-        termValues.push_back(enterpriseValue);
-        termValues.push_back(acquirersMultiple);
+        termRecord.appendValue(operatingEarnings);
+        termRecord.appendValue(enterpriseValue);
+        termRecord.appendValue(acquirersMultiple);
       }
 
       return acquirersMultiple;
@@ -2164,8 +2224,7 @@ class FinancialAnalysisFunctions {
                     const char *timeUnit,   
                     bool appendTermRecord,
                     bool setNansToMissingValue,
-                    std::vector< std::string> &termNames,
-                    std::vector< double > &termValues){
+                    DataStructures::TermRecord &termRecord){
 
       std::string parentName = "operatingEarnings";
       
@@ -2195,17 +2254,17 @@ class FinancialAnalysisFunctions {
                                   - depreciationAndAmortization;
 
       if(appendTermRecord){
-        termNames.push_back(parentName+"_totalRevenue");
-        termNames.push_back(parentName+"_costOfRevenue");
-        termNames.push_back(parentName+"_sellingGeneralAdministrative");
-        termNames.push_back(parentName+"_depreciationAndAmortization");
-        termNames.push_back(parentName);
+        termRecord.appendName({parentName, "_totalRevenue"});
+        termRecord.appendName({parentName, "_costOfRevenue"});
+        termRecord.appendName({parentName, "_sellingGeneralAdministrative"});
+        termRecord.appendName({parentName, "_depreciationAndAmortization"});
+        termRecord.appendName(parentName);
 
-        termValues.push_back(totalRevenue);
-        termValues.push_back(costOfRevenue);
-        termValues.push_back(sellingGeneralAdministrative);
-        termValues.push_back(depreciationAndAmortization);
-        termValues.push_back(operatingEarnings);
+        termRecord.appendValue(totalRevenue);
+        termRecord.appendValue(costOfRevenue);
+        termRecord.appendValue(sellingGeneralAdministrative);
+        termRecord.appendValue(depreciationAndAmortization);
+        termRecord.appendValue(operatingEarnings);
       }
 
       return operatingEarnings;
@@ -2218,49 +2277,32 @@ class FinancialAnalysisFunctions {
      not included.
      * */
     static double calcOwnersEarnings(
-                    const nlohmann::ordered_json &jsonData, 
-                    const DateFunctions::DateSetTTM &dateSet,
-                    const DateFunctions::DateSetTTM &previousDateSet,
-                    const char *timeUnit,   
+                    MetricGraph &metricGraph,
                     bool appendTermRecord,
-                    bool setNansToMissingValue,
-                    std::vector< std::string> &termNames,
-                    std::vector< double > &termValues){
+                    DataStructures::TermRecord &termRecord){
 
+      bool setNansToMissingValue = metricGraph.setNansToMissingValue;
     
       //Definition from Ch. 3 of Damodaran (page 40/172 22%)     
       //Damodaran (2011). The little book of valuation    
 
-      double netIncome = 
-        sumFundamentalDataOverDates(
-          jsonData,FIN,CF,timeUnit,dateSet,"netIncome",
-          setNansToMissingValue);
+      double netIncome = getMetric(metricGraph, METRIC_NET_INCOME_CF);
 
       std::string parentName = "ownersEarnings_";
 
       bool ignoreDepreciation=false;
       double netCapitalExpenditures = 
-        calcNetCapitalExpenditures( jsonData, 
-                                    dateSet,
-                                    previousDateSet,
-                                    timeUnit,
+        calcNetCapitalExpenditures( metricGraph,
                                     appendTermRecord,
                                     parentName,
-                                    setNansToMissingValue,
                                     ignoreDepreciation,
-                                    termNames,
-                                    termValues);
+                                    termRecord);
 
       double changeInNonCashWorkingCapital = 
-        calcChangeInNonCashWorkingCapital( jsonData, 
-                                    dateSet,
-                                    previousDateSet,
-                                    timeUnit,
+        calcChangeInNonCashWorkingCapital( metricGraph,
                                     appendTermRecord,
                                     parentName,
-                                    setNansToMissingValue,
-                                    termNames,
-                                    termValues);  
+                                    termRecord);  
 
       double ownersEarnings =  
           netIncome
@@ -2280,11 +2322,11 @@ class FinancialAnalysisFunctions {
       }           
 
       if(appendTermRecord){
-        termNames.push_back("ownersEarnings_netIncome");
-        termNames.push_back("ownersEarnings");
+        termRecord.appendName("ownersEarnings_netIncome");
+        termRecord.appendName("ownersEarnings");
 
-        termValues.push_back(netIncome);
-        termValues.push_back(ownersEarnings);
+        termRecord.appendValue(netIncome);
+        termRecord.appendValue(ownersEarnings);
       }
 
       return ownersEarnings;
@@ -2293,24 +2335,17 @@ class FinancialAnalysisFunctions {
 
     //==========================================================================
     static double calcReinvestmentRate(
-                    const nlohmann::ordered_json &jsonData, 
-                    const DateFunctions::DateSetTTM &dateSet,
-                    const DateFunctions::DateSetTTM &previousDateSet,  
-                    const char *timeUnit,
+                    MetricGraph &metricGraph,
                     double taxRate,
                     bool appendTermRecord,
                     const std::string &parentCategoryName,
-                    bool setNansToMissingValue,
-                    std::vector< std::string> &termNames,
-                    std::vector< double > &termValues){
+                    DataStructures::TermRecord &termRecord){
 
+      bool setNansToMissingValue = metricGraph.setNansToMissingValue;
     
       //Damodaran definition (page 40/172 22%)     
       
-      double operatingIncome = 
-        sumFundamentalDataOverDates(
-          jsonData,FIN,IS,timeUnit,dateSet,"operatingIncome",
-          setNansToMissingValue);
+      double operatingIncome = getMetric(metricGraph, METRIC_OPERATING_INCOME);
 
 
       std::string parentName = parentCategoryName;
@@ -2321,27 +2356,17 @@ class FinancialAnalysisFunctions {
 
       bool ignoreDepreciation=false;
       double netCapitalExpenditures = 
-        calcNetCapitalExpenditures( jsonData, 
-                                    dateSet,
-                                    previousDateSet,
-                                    timeUnit,
+        calcNetCapitalExpenditures( metricGraph,
                                     appendTermRecord,
                                     parentName,
-                                    setNansToMissingValue,
                                     ignoreDepreciation,
-                                    termNames,
-                                    termValues);
+                                    termRecord);
 
       double changeInNonCashWorkingCapital = 
-        calcChangeInNonCashWorkingCapital( jsonData, 
-                                    dateSet,
-                                    previousDateSet,
-                                    timeUnit,
+        calcChangeInNonCashWorkingCapital( metricGraph,
                                     appendTermRecord,
                                     parentName,
-                                    setNansToMissingValue,
-                                    termNames,
-                                    termValues);          
+                                    termRecord);          
 
       double reinvestmentRate =  
         (netCapitalExpenditures+changeInNonCashWorkingCapital
@@ -2361,19 +2386,15 @@ class FinancialAnalysisFunctions {
 
       if(appendTermRecord){
 
-        termNames.push_back(parentCategoryName 
-          + "reinvestmentRate_operatingIncome");
-        termNames.push_back(parentCategoryName 
-          + "reinvestmentRate_taxRate");
-        termNames.push_back(parentCategoryName 
-          + "reinvestmentRate_afterTaxOperatingIncome");
-        termNames.push_back(parentCategoryName 
-          + "reinvestmentRate");
+        termRecord.appendName({parentCategoryName, "reinvestmentRate_operatingIncome"});
+        termRecord.appendName({parentCategoryName, "reinvestmentRate_taxRate"});
+        termRecord.appendName({parentCategoryName, "reinvestmentRate_afterTaxOperatingIncome"});
+        termRecord.appendName({parentCategoryName, "reinvestmentRate"});
 
-        termValues.push_back(operatingIncome);
-        termValues.push_back(taxRate);
-        termValues.push_back(afterTaxOperatingIncome);
-        termValues.push_back(reinvestmentRate);
+        termRecord.appendValue(operatingIncome);
+        termRecord.appendValue(taxRate);
+        termRecord.appendValue(afterTaxOperatingIncome);
+        termRecord.appendValue(reinvestmentRate);
       }
 
       return reinvestmentRate;
@@ -2381,21 +2402,15 @@ class FinancialAnalysisFunctions {
 
     //==========================================================================
     static double calcFreeCashFlowToFirm(
-                    const nlohmann::ordered_json &jsonData, 
-                    DateFunctions::DateSetTTM &dateSet,
-                    DateFunctions::DateSetTTM &previousDateSet,                                     
-                    const char *timeUnit,
+                    MetricGraph &metricGraph,
                     double taxRate,
                     bool appendTermRecord,
-                    bool setNansToMissingValue,
-                    std::vector< std::string> &termNames,
-                    std::vector< double > &termValues){
+                    DataStructures::TermRecord &termRecord){
 
+      bool setNansToMissingValue = metricGraph.setNansToMissingValue;
 
       double operatingIncome = 
-        sumFundamentalDataOverDates(
-            jsonData,FIN,IS,timeUnit,dateSet,
-            "operatingIncome",true);
+        getMetric(metricGraph, METRIC_OPERATING_INCOME, true);
 
       double afterTaxOperatingIncome = operatingIncome*(1-taxRate);            
 
@@ -2403,16 +2418,11 @@ class FinancialAnalysisFunctions {
 
       std::string parentCategoryName("freeCashFlowToFirm_");
 
-      double reinvestmentRate = calcReinvestmentRate(jsonData,
-                                                    dateSet,
-                                                    previousDateSet,
-                                                    timeUnit,
+      double reinvestmentRate = calcReinvestmentRate(metricGraph,
                                                     taxRate,
                                                     appendTermRecord,
                                                     parentCategoryName,
-                                                    setNansToMissingValue,
-                                                    termNames,
-                                                    termValues);
+                                                    termRecord);
                                                     
       double freeCashFlowToFirm =  
         afterTaxOperatingIncome
@@ -2429,15 +2439,15 @@ class FinancialAnalysisFunctions {
       }
 
       if(appendTermRecord){
-        termNames.push_back(resultName + "operatingIncome");
-        termNames.push_back(resultName + "taxRate");
-        termNames.push_back(resultName + "afterTaxOperatingIncome");
-        termNames.push_back("freeCashFlowToFirm");
+        termRecord.appendName({resultName, "operatingIncome"});
+        termRecord.appendName({resultName, "taxRate"});
+        termRecord.appendName({resultName, "afterTaxOperatingIncome"});
+        termRecord.appendName("freeCashFlowToFirm");
 
-        termValues.push_back(operatingIncome);
-        termValues.push_back(taxRate);
-        termValues.push_back(afterTaxOperatingIncome);
-        termValues.push_back(freeCashFlowToFirm);
+        termRecord.appendValue(operatingIncome);
+        termRecord.appendValue(taxRate);
+        termRecord.appendValue(afterTaxOperatingIncome);
+        termRecord.appendValue(freeCashFlowToFirm);
 
       }
 
@@ -2459,26 +2469,23 @@ class FinancialAnalysisFunctions {
      *                    
     */
     static double calcResidualCashFlow(
-        const nlohmann::ordered_json &jsonData, 
-        const DateFunctions::DateSetTTM &dateSet,
-        const char *timeUnit,
+        MetricGraph &metricGraph,
         double costOfEquityAsAPercentage,
         std::vector< DateFunctions::DateSetTTM > &datesToAverageCapitalExpenditures,
         bool appendTermRecord,
-        bool setNansToMissingValue,
-        std::vector< std::string> &termNames,
-        std::vector< double > &termValues){
+        DataStructures::TermRecord &termRecord){
+
+      const nlohmann::ordered_json &jsonData = *metricGraph.fundamentalData;
+      const DateFunctions::DateSetTTM &dateSet = *metricGraph.dateSet;
+      const char *timeUnit = metricGraph.timeUnit.c_str();
+      bool setNansToMissingValue = metricGraph.setNansToMissingValue;
 
       double totalCashFromOperatingActivities = 
-        sumFundamentalDataOverDates(
-          jsonData,FIN,CF,timeUnit,dateSet,"totalCashFromOperatingActivities",
-          setNansToMissingValue);
+        getMetric(metricGraph, METRIC_TOTAL_CASH_FROM_OPERATING_ACTIVITIES);
 
       //Not all firms actually have a research and development entry
       double researchDevelopment = 
-        sumFundamentalDataOverDates(
-          jsonData,FIN,IS,timeUnit,dateSet,"researchDevelopment",
-          true);  
+        getMetric(metricGraph, METRIC_RESEARCH_DEVELOPMENT, true);
       
       //Extract the mean capital expenditure for the list of dates given
       double capitalExpenditureMean = 0;     
@@ -2535,21 +2542,21 @@ class FinancialAnalysisFunctions {
       }
 
       if(appendTermRecord){
-        termNames.push_back("residualCashFlow_totalStockholderEquity");
-        termNames.push_back("residualCashFlow_costOfEquityAsAPercentage");
-        termNames.push_back("residualCashFlow_costOfEquity");
-        termNames.push_back("residualCashFlow_totalCashFromOperatingActivities");
-        termNames.push_back("residualCashFlow_researchDevelopment");
-        termNames.push_back("residualCashFlow_capitalExpenditureMean");
-        termNames.push_back("residualCashFlow");
-
-        termValues.push_back(totalStockholderEquity);
-        termValues.push_back(costOfEquityAsAPercentage);
-        termValues.push_back(costOfEquity);
-        termValues.push_back(totalCashFromOperatingActivities);
-        termValues.push_back(researchDevelopment);
-        termValues.push_back(capitalExpenditureMean);
-        termValues.push_back(residualCashFlow);
+        termRecord.appendName("residualCashFlow_totalStockholderEquity");
+        termRecord.appendName("residualCashFlow_costOfEquityAsAPercentage");
+        termRecord.appendName("residualCashFlow_costOfEquity");
+        termRecord.appendName("residualCashFlow_totalCashFromOperatingActivities");
+        termRecord.appendName("residualCashFlow_researchDevelopment");
+        termRecord.appendName("residualCashFlow_capitalExpenditureMean");
+        termRecord.appendName("residualCashFlow");
+
+        termRecord.appendValue(totalStockholderEquity);
+        termRecord.appendValue(costOfEquityAsAPercentage);
+        termRecord.appendValue(costOfEquity);
+        termRecord.appendValue(totalCashFromOperatingActivities);
+        termRecord.appendValue(researchDevelopment);
+        termRecord.appendValue(capitalExpenditureMean);
+        termRecord.appendValue(residualCashFlow);
       }
 
       return residualCashFlow;
@@ -2566,8 +2573,7 @@ class FinancialAnalysisFunctions {
           bool appendTermRecord,                                      
           const std::string &parentCategoryName,
           bool setNansToMissingValue,
-          std::vector< std::string> &termNames,
-          std::vector< double > &termValues){
+          DataStructures::TermRecord &termRecord){
 
       double debtBookValue = debtInfo.longTermDebt;      
       if(!JsonFunctions::isJsonFloatValid(debtBookValue)){
@@ -2628,21 +2634,21 @@ class FinancialAnalysisFunctions {
       }
 
       if(appendTermRecord){
-        termNames.push_back(parentCategoryName+"enterpriseValue_debtBookValue");
-        termNames.push_back(parentCategoryName+"enterpriseValue_cashAndEquivalentsEntry");
-        termNames.push_back(parentCategoryName+"enterpriseValue_cashAndEquivalents");
-        termNames.push_back(parentCategoryName+"enterpriseValue_cash");
-        termNames.push_back(parentCategoryName+"enterpriseValue_marketCapitalization");
-        termNames.push_back(parentCategoryName+"enterpriseValue_minorityInterest");
-        termNames.push_back(parentCategoryName+"enterpriseValue");
-
-        termValues.push_back(debtBookValue);
-        termValues.push_back(cashAndEquivalentsEntry);
-        termValues.push_back(cashAndEquivalents);
-        termValues.push_back(cash);
-        termValues.push_back(marketCapitalization);
-        termValues.push_back(minorityInterest);
-        termValues.push_back(enterpriseValue);      
+        termRecord.appendName({parentCategoryName, "enterpriseValue_debtBookValue"});
+        termRecord.appendName({parentCategoryName, "enterpriseValue_cashAndEquivalentsEntry"});
+        termRecord.appendName({parentCategoryName, "enterpriseValue_cashAndEquivalents"});
+        termRecord.appendName({parentCategoryName, "enterpriseValue_cash"});
+        termRecord.appendName({parentCategoryName, "enterpriseValue_marketCapitalization"});
+        termRecord.appendName({parentCategoryName, "enterpriseValue_minorityInterest"});
+        termRecord.appendName({parentCategoryName, "enterpriseValue"});
+
+        termRecord.appendValue(debtBookValue);
+        termRecord.appendValue(cashAndEquivalentsEntry);
+        termRecord.appendValue(cashAndEquivalents);
+        termRecord.appendValue(cash);
+        termRecord.appendValue(marketCapitalization);
+        termRecord.appendValue(minorityInterest);
+        termRecord.appendValue(enterpriseValue);      
       }
 
       return enterpriseValue;
@@ -2693,22 +2699,20 @@ class FinancialAnalysisFunctions {
       From William Priest's book 
     */
     static double calcShareholderYield(
-          const nlohmann::ordered_json &fundamentalData, 
-          const nlohmann::ordered_json &historicalData,
-          const DateFunctions::DateSetTTM &dateSet,
-          const DateFunctions::DateSetTTM &previousDateSet,
-          const char *timeUnit, 
-          const char *timeUnitOS,
+          MetricGraph &metricGraph,
           const DataStructures::DebtInfo &debtInfo,
           const DataStructures::DebtInfo &previousDebtInfo,
           double costOfCapital,
           bool appendTermRecord,                                      
           const std::string &parentCategoryName,
-          bool setNansToMissingValue,
-          std::vector< std::string> &termNames,
-          std::vector< double > &termValues){
+          DataStructures::TermRecord &termRecord){
 
-      
+        const nlohmann::ordered_json &fundamentalData = 
+          *metricGraph.fundamentalData;
+        const nlohmann::ordered_json &historicalData = 
+          *metricGraph.historicalData;
+        const DateFunctions::DateSetTTM &dateSet = *metricGraph.dateSet;
+        const char *timeUnit = metricGraph.timeUnit.c_str();
 
         double dividendsPaid = 0;        
         //
@@ -2730,15 +2734,11 @@ class FinancialAnalysisFunctions {
         // Share buybacks
         //
 
-        double outstandingShares =  getOutstandingSharesClosestToDate(
-                                      fundamentalData,
-                                      dateSet.dates[0],
-                                      timeUnitOS);
+        double outstandingShares =  
+          getMetric(metricGraph, METRIC_OUTSTANDING_SHARES);
 
-        double outstandingSharesPrevious = getOutstandingSharesClosestToDate(
-                                              fundamentalData,
-                                              previousDateSet.dates[0],
-                                              timeUnitOS);
+        double outstandingSharesPrevious = 
+          getMetric(metricGraph, METRIC_OUTSTANDING_SHARES_PREVIOUS);
                                               
         double changeInOutstandingShares = outstandingShares
                                  - outstandingSharesPrevious;
@@ -2751,24 +2751,13 @@ class FinancialAnalysisFunctions {
         //
         double sharePriceAvg = 0.;
         int sharePriceCount = 0;
-        int indexA = FinancialAnalysisFunctions::
-                    calcIndexOfClosestDateInHistoricalData(
-                          dateSet.dates[0],
-                          "%Y-%m-%d",
-                          historicalData,
-                          "%Y-%m-%d",
-                          false);
-        int indexB = FinancialAnalysisFunctions::
-                      calcIndexOfClosestDateInHistoricalData(
-                          previousDateSet.dates[0],
-                          "%Y-%m-%d",
-                          historicalData,
-                          "%Y-%m-%d",
-                          false);
+        int indexA = static_cast<int>(
+                      getMetric(metricGraph, METRIC_HISTORICAL_INDEX));
+        int indexB = static_cast<int>(
+                      getMetric(metricGraph, METRIC_HISTORICAL_INDEX_PREVIOUS));
         for (int i=indexB; i<indexA;++i){
           double stockPrice = getHistoricalDataInFundamentalUnit(
                                 historicalData[i]["adjusted_close"],
-                                fundamentalData,
                                 false);            
           //double stockPrice = JsonFunctions::getJsonFloat(
           //    historicalData[i]["adjusted_close"],false);
@@ -2790,18 +2779,11 @@ class FinancialAnalysisFunctions {
         double changeInDebt =  debtInfo.longTermDebtEstimate
                               -previousDebtInfo.longTermDebtEstimate;
 
-        int index = FinancialAnalysisFunctions::
-                      calcIndexOfClosestDateInHistoricalData(
-                        dateSet.dates[0],
-                        "%Y-%m-%d",
-                        historicalData,
-                        "%Y-%m-%d",
-                        false);
+        int index = indexA;
 
         double stockPrice = 
           getHistoricalDataInFundamentalUnit(
             historicalData[index]["adjusted_close"],
-            fundamentalData,
             false);
 
         //double stockPrice = JsonFunctions::getJsonFloat(
@@ -2829,35 +2811,35 @@ class FinancialAnalysisFunctions {
         if(appendTermRecord){
           std::string resultName(parentCategoryName);
           resultName.append("shareholderYield_");            
-          termNames.push_back(resultName + "sharePrice");
-          termNames.push_back(resultName + "outstandingShares");
-          termNames.push_back(resultName + "marketCapitalization");
+          termRecord.appendName({resultName, "sharePrice"});
+          termRecord.appendName({resultName, "outstandingShares"});
+          termRecord.appendName({resultName, "marketCapitalization"});
 
-          termNames.push_back(resultName + "dividendsPaid");
-          termNames.push_back(resultName + "dividendYield");
+          termRecord.appendName({resultName, "dividendsPaid"});
+          termRecord.appendName({resultName, "dividendYield"});
 
-          termNames.push_back(resultName + "changeInOutstandingShares");
-          termNames.push_back(resultName + "shareBuybackYield");
+          termRecord.appendName({resultName, "changeInOutstandingShares"});
+          termRecord.appendName({resultName, "shareBuybackYield"});
 
-          termNames.push_back(resultName + "changeInDebt");
-          termNames.push_back(resultName + "debtPaybackYield");
+          termRecord.appendName({resultName, "changeInDebt"});
+          termRecord.appendName({resultName, "debtPaybackYield"});
 
-          termNames.push_back(parentCategoryName + "shareholderYield");
+          termRecord.appendName({parentCategoryName, "shareholderYield"});
 
-          termValues.push_back(stockPrice);
-          termValues.push_back(outstandingShares);
-          termValues.push_back(marketCap);
+          termRecord.appendValue(stockPrice);
+          termRecord.appendValue(outstandingShares);
+          termRecord.appendValue(marketCap);
 
-          termValues.push_back(dividendsPaid);
-          termValues.push_back(dividendYield);
+          termRecord.appendValue(dividendsPaid);
+          termRecord.appendValue(dividendYield);
 
-          termValues.push_back(changeInOutstandingShares);
-          termValues.push_back(shareBuyBackYield);
+          termRecord.appendValue(changeInOutstandingShares);
+          termRecord.appendValue(shareBuyBackYield);
 
-          termValues.push_back(changeInDebt);
-          termValues.push_back(debtPaybackYield);
+          termRecord.appendValue(changeInDebt);
+          termRecord.appendValue(debtPaybackYield);
 
-          termValues.push_back(shareHolderYield);
+          termRecord.appendValue(shareHolderYield);
 
         }            
 
@@ -2882,31 +2864,30 @@ class FinancialAnalysisFunctions {
                     bool appendTermRecord,
                     bool setNansToMissingValue,
                     const std::string &parentName,
-                    std::vector< std::string> &termNames,
-                    std::vector< double > &termValues){
+                    DataStructures::TermRecord &termRecord){
 
 
       
       if(appendTermRecord){
-        termNames.push_back(parentName+"riskFreeRate");
-        termNames.push_back(parentName+"costOfCapital");
-        termValues.push_back(riskFreeRate);
-        termValues.push_back(costOfCapital);
+        termRecord.appendName({parentName, "riskFreeRate"});
+        termRecord.appendName({parentName, "costOfCapital"});
+        termRecord.appendValue(riskFreeRate);
+        termRecord.appendValue(costOfCapital);
       }
 
 
       if(appendTermRecord){
-          termNames.push_back(parentName+"taxRate");
-          termNames.push_back(parentName+"reinvestmentRate");
-          termNames.push_back(parentName+"returnOnCapitalDeployed");
-          termNames.push_back(parentName+"organicGrowth");
-          termNames.push_back(parentName+"afterTaxOperatingIncomeGrowth");
-
-          termValues.push_back(taxRate);
-          termValues.push_back(reinvestmentRate);
-          termValues.push_back(returnOnCapitalDeployed);
-          termValues.push_back(organicGrowth);
-          termValues.push_back(afterTaxOperatingIncomeGrowth);
+          termRecord.appendName({parentName, "taxRate"});
+          termRecord.appendName({parentName, "reinvestmentRate"});
+          termRecord.appendName({parentName, "returnOnCapitalDeployed"});
+          termRecord.appendName({parentName, "organicGrowth"});
+          termRecord.appendName({parentName, "afterTaxOperatingIncomeGrowth"});
+
+          termRecord.appendValue(taxRate);
+          termRecord.appendValue(reinvestmentRate);
+          termRecord.appendValue(returnOnCapitalDeployed);
+          termRecord.appendValue(organicGrowth);
+          termRecord.appendValue(afterTaxOperatingIncomeGrowth);
     
       }
       
@@ -2927,11 +2908,11 @@ class FinancialAnalysisFunctions {
         operatingIncome*(1.0-taxRate);
 
       if(appendTermRecord){
-        termNames.push_back(parentName+"operatingIncome");
-        termNames.push_back(parentName+"afterTaxOperatingIncome");
+        termRecord.appendName({parentName, "operatingIncome"});
+        termRecord.appendName({parentName, "afterTaxOperatingIncome"});
 
-        termValues.push_back(operatingIncome);
-        termValues.push_back(afterTaxOperatingIncome);
+        termRecord.appendValue(operatingIncome);
+        termRecord.appendValue(afterTaxOperatingIncome);
       }
 
 
@@ -2955,19 +2936,19 @@ class FinancialAnalysisFunctions {
           std::stringstream sstreamName;
           sstreamName.str(std::string());
           sstreamName << parentName+"afterTaxOperatingIncome_"<< i;
-          termNames.push_back(sstreamName.str());
+          termRecord.appendName(sstreamName.str());
 
           sstreamName.str(std::string());
           sstreamName << parentName+"reinvestment_"<< i;
-          termNames.push_back(sstreamName.str());          
+          termRecord.appendName(sstreamName.str());          
 
           sstreamName.str(std::string());
           sstreamName << parentName+"freeCashFlowToFirm_"<< i;
-          termNames.push_back(sstreamName.str());
+          termRecord.appendName(sstreamName.str());
 
-          termValues.push_back(afterTaxOperatingIncomeVector[i]);
-          termValues.push_back(reinvestmentVector[i]);
-          termValues.push_back(freeCashFlowToFirmVector[i]);
+          termRecord.appendValue(afterTaxOperatingIncomeVector[i]);
+          termRecord.appendValue(reinvestmentVector[i]);
+          termRecord.appendValue(freeCashFlowToFirmVector[i]);
         }
       }
 
@@ -3008,21 +2989,21 @@ class FinancialAnalysisFunctions {
 
 
       if(appendTermRecord){
-        termNames.push_back(parentName+"terminalValue_afterTaxOperatingIncome");
-        termNames.push_back(parentName+"terminalValue_riskFreeRate");
-        termNames.push_back(parentName+"terminalValue_reinvestmentRateStableGrowth");
-        termNames.push_back(parentName+"terminalValue_costOfCapital");
-        termNames.push_back(parentName+"terminalValue_costOfCapitalMature");
-        termNames.push_back(parentName+"terminalValue");
-        termNames.push_back(parentName+"presentValueOfFutureCashFlows");        
+        termRecord.appendName({parentName, "terminalValue_afterTaxOperatingIncome"});
+        termRecord.appendName({parentName, "terminalValue_riskFreeRate"});
+        termRecord.appendName({parentName, "terminalValue_reinvestmentRateStableGrowth"});
+        termRecord.appendName({parentName, "terminalValue_costOfCapital"});
+        termRecord.appendName({parentName, "terminalValue_costOfCapitalMature"});
+        termRecord.appendName({parentName, "terminalValue"});
+        termRecord.appendName({parentName, "presentValueOfFutureCashFlows"});        
         
-        termValues.push_back(terminalAfterTaxOperatingIncome);
-        termValues.push_back(riskFreeRate);
-        termValues.push_back(reinvestmentRateStableGrowth);
-        termValues.push_back(costOfCapital);
-        termValues.push_back(costOfCapitalMature);
-        termValues.push_back(terminalValue);
-        termValues.push_back(presentValueOfFutureCashFlows);
+        termRecord.appendValue(terminalAfterTaxOperatingIncome);
+        termRecord.appendValue(riskFreeRate);
+        termRecord.appendValue(reinvestmentRateStableGrowth);
+        termRecord.appendValue(costOfCapital);
+        termRecord.appendValue(costOfCapitalMature);
+        termRecord.appendValue(terminalValue);
+        termRecord.appendValue(presentValueOfFutureCashFlows);
 
       }
 
@@ -3054,27 +3035,27 @@ class FinancialAnalysisFunctions {
       //Ratio: price to value
       if(appendTermRecord){
 
-        termNames.push_back(parentName+"cash");
-        termNames.push_back(parentName+"crossHolding");
-        termNames.push_back(parentName+"totalDebtEstimate");
-        termNames.push_back(parentName+"longTermDebtEstimate");
-        termNames.push_back(parentName+"totalDebtEstimateEntry");
-        termNames.push_back(parentName+"potentialLiabilities");
-        termNames.push_back(parentName+"stockOptionValuation");
-        termNames.push_back(parentName+"presentValue");
-        termNames.push_back(parentName+"marketCapitalization");
-        termNames.push_back(parentName.substr(0,parentName.size()-1));
-
-        termValues.push_back(cash);
-        termValues.push_back(crossHoldings);          
-        termValues.push_back(debtInfo.totalDebtEstimate);
-        termValues.push_back(debtInfo.longTermDebtEstimate);
-        termValues.push_back(totalDebtEstimateEntry);        
-        termValues.push_back(potentialLiabilities);
-        termValues.push_back(optionValue);
-        termValues.push_back(presentValue);
-        termValues.push_back(marketCapitalization);
-        termValues.push_back(priceToValue);
+        termRecord.appendName({parentName, "cash"});
+        termRecord.appendName({parentName, "crossHolding"});
+        termRecord.appendName({parentName, "totalDebtEstimate"});
+        termRecord.appendName({parentName, "longTermDebtEstimate"});
+        termRecord.appendName({parentName, "totalDebtEstimateEntry"});
+        termRecord.appendName({parentName, "potentialLiabilities"});
+        termRecord.appendName({parentName, "stockOptionValuation"});
+        termRecord.appendName({parentName, "presentValue"});
+        termRecord.appendName({parentName, "marketCapitalization"});
+        termRecord.appendName(parentName.substr(0,parentName.size()-1));
+
+        termRecord.appendValue(cash);
+        termRecord.appendValue(crossHoldings);          
+        termRecord.appendValue(debtInfo.totalDebtEstimate);
+        termRecord.appendValue(debtInfo.longTermDebtEstimate);
+        termRecord.appendValue(totalDebtEstimateEntry);        
+        termRecord.appendValue(potentialLiabilities);
+        termRecord.appendValue(optionValue);
+        termRecord.appendValue(presentValue);
+        termRecord.appendValue(marketCapitalization);
+        termRecord.appendValue(priceToValue);
 
       }
 
@@ -3084,6 +3065,322 @@ class FinancialAnalysisFunctions {
 
     };
 
+    //==========================================================================
+    /*
+      A set of scenarios of calcPriceToValueUsingDamodaranDiscountedCashflowModel
+      stored as a structure of arrays: entry i of each vector belongs to 
+      scenario i. The terminalGrowth plays the role of the riskFreeRate in 
+      the terminal value of the scalar model.
+    */
+    struct DiscountedCashFlowScenarios{
+      std::vector< double > costOfCapital;
+      std::vector< double > costOfCapitalMature;
+      std::vector< double > afterTaxOperatingIncomeGrowth;
+      std::vector< double > terminalGrowth;
+      std::vector< int >    numberOfYearsOfGrowth;
+      std::vector< double > presentValueOfFutureCashFlows;
+      std::vector< double > priceToValue;
+
+      size_t size() const {
+        return costOfCapital.size();
+      };
+
+      void clear(){
+        costOfCapital.clear();
+        costOfCapitalMature.clear();
+        afterTaxOperatingIncomeGrowth.clear();
+        terminalGrowth.clear();
+        numberOfYearsOfGrowth.clear();
+        presentValueOfFutureCashFlows.clear();
+        priceToValue.clear();
+      };
+    };
+
+    //==========================================================================
+    /*
+      Fills scenariosUpd with every combination of the offsets to the cost of
+      capital, growth, and terminal growth, and the years of growth. The 
+      scenarios are ordered with the cost of capital varying slowest and the
+      terminal growth varying fastest. The cost of capital offsets are 
+      applied to both the cost of capital and the mature cost of capital.
+    */
+    static void createDiscountedCashFlowScenarioGrid(
+                  double costOfCapital,
+                  double costOfCapitalMature,
+                  double afterTaxOperatingIncomeGrowth,
+                  double terminalGrowth,
+                  const std::vector< double > &costOfCapitalOffsets,
+                  const std::vector< double > &growthOffsets,
+                  const std::vector< int > &numberOfYearsOfGrowth,
+                  const std::vector< double > &terminalGrowthOffsets,
+                  DiscountedCashFlowScenarios &scenariosUpd){
+
+      scenariosUpd.clear();
+      size_t numberOfScenarios = costOfCapitalOffsets.size()
+                                *growthOffsets.size()
+                                *numberOfYearsOfGrowth.size()
+                                *terminalGrowthOffsets.size();
+      scenariosUpd.costOfCapital.reserve(numberOfScenarios);
+      scenariosUpd.costOfCapitalMature.reserve(numberOfScenarios);
+      scenariosUpd.afterTaxOperatingIncomeGrowth.reserve(numberOfScenarios);
+      scenariosUpd.terminalGrowth.reserve(numberOfScenarios);
+      scenariosUpd.numberOfYearsOfGrowth.reserve(numberOfScenarios);
+
+      for(auto const &costOfCapitalOffset : costOfCapitalOffsets){
+        for(auto const &growthOffset : growthOffsets){
+          for(auto const &years : numberOfYearsOfGrowth){
+            for(auto const &terminalGrowthOffset : terminalGrowthOffsets){
+              scenariosUpd.costOfCapital.push_back(
+                costOfCapital+costOfCapitalOffset);
+              scenariosUpd.costOfCapitalMature.push_back(
+                costOfCapitalMature+costOfCapitalOffset);
+              scenariosUpd.afterTaxOperatingIncomeGrowth.push_back(
+                afterTaxOperatingIncomeGrowth+growthOffset);
+              scenariosUpd.terminalGrowth.push_back(
+                terminalGrowth+terminalGrowthOffset);
+              scenariosUpd.numberOfYearsOfGrowth.push_back(years);
+            }
+          }
+        }
+      }
+    };
+
+    //==========================================================================
+    /*
+      Evaluates the present value of the future cash flows of every scenario
+      using the same model as 
+      calcPriceToValueUsingDamodaranDiscountedCashflowModel. The loop over 
+      the scenarios is innermost and has no branches so that it can be 
+      vectorized: the growth and discount factors are accumulated by 
+      multiplication rather than with std::pow, and scenarios that have 
+      fewer years of growth than the longest scenario are masked out.
+    */
+    static void calcDiscountedCashFlowScenarios(
+                  double afterTaxOperatingIncome,
+                  double reinvestmentRate,
+                  DiscountedCashFlowScenarios &scenariosUpd){
+
+      size_t n = scenariosUpd.size();
+      scenariosUpd.presentValueOfFutureCashFlows.assign(n,0.);
+
+      const double *costOfCapital  = scenariosUpd.costOfCapital.data();
+      const double *costOfCapitalMature 
+                                   = scenariosUpd.costOfCapitalMature.data();
+      const double *growth = scenariosUpd.afterTaxOperatingIncomeGrowth.data();
+      const double *terminalGrowth = scenariosUpd.terminalGrowth.data();
+      const int    *years          = scenariosUpd.numberOfYearsOfGrowth.data();
+      double *presentValue = scenariosUpd.presentValueOfFutureCashFlows.data();
+
+      int maximumYears = 0;
+      for(size_t i=0; i<n; ++i){
+        maximumYears = std::max(maximumYears,years[i]);
+      }
+
+      std::vector< double > growthStep(n), discountStep(n);
+      std::vector< double > growthFactor(n,1.0), discountFactor(n,1.0);
+      std::vector< double > terminalGrowthFactor(n,1.0);
+      std::vector< double > terminalDiscountFactor(n,1.0);
+      for(size_t i=0; i<n; ++i){
+        growthStep[i]   = 1.0+growth[i];
+        discountStep[i] = 1.0/(1.0+costOfCapital[i]);
+      }
+
+      //Sum of the discounted growth factors over the years of growth
+      for(int year=1; year <= maximumYears; ++year){
+        for(size_t i=0; i<n; ++i){
+          growthFactor[i]   *= growthStep[i];
+          discountFactor[i] *= discountStep[i];
+          double isActive   = (year <= years[i]) ? 1.0 : 0.0;
+          double isTerminal = (year == years[i]) ? 1.0 : 0.0;
+          presentValue[i] += isActive*growthFactor[i]*discountFactor[i];
+          terminalGrowthFactor[i] += 
+            isTerminal*(growthFactor[i]-terminalGrowthFactor[i]);
+          terminalDiscountFactor[i] += 
+            isTerminal*(discountFactor[i]-terminalDiscountFactor[i]);
+        }
+      }
+
+      double freeCashFlowToFirm = afterTaxOperatingIncome
+                                 *(1.0-reinvestmentRate);
+      for(size_t i=0; i<n; ++i){
+        double reinvestmentRateStableGrowth = 
+          terminalGrowth[i]/costOfCapitalMature[i];
+        double terminalValue = 
+          (afterTaxOperatingIncome*terminalGrowthFactor[i]
+            *(1.0+terminalGrowth[i])
+            *(1.0-reinvestmentRateStableGrowth)
+          )/(costOfCapitalMature[i]-terminalGrowth[i]);
+        presentValue[i] = freeCashFlowToFirm*presentValue[i]
+                         +terminalValue*terminalDiscountFactor[i];
+      }
+    };
+
+    //==========================================================================
+    /*
+      Evaluates the price to value ratio of
+      calcPriceToValueUsingDamodaranDiscountedCashflowModel over a grid of
+      scenarios, so that the sensitivity of the valuation to its assumptions
+      can be examined without re-running the calculation. The scenarios
+      must have been created (e.g. with createDiscountedCashFlowScenarioGrid)
+      before this function is called.
+    */
+    static void calcPriceToValueSurfaceUsingDamodaranDiscountedCashflowModel(
+                    const nlohmann::ordered_json &jsonData, 
+                    const DateFunctions::DateSetTTM &dateSet,
+                    const char *timeUnit,   
+                    const DataStructures::DebtInfo &debtInfo,
+                    double taxRate,
+                    double reinvestmentRate,
+                    double returnOnCapitalDeployed,
+                    double marketCapitalization,
+                    bool setNansToMissingValue,
+                    DiscountedCashFlowScenarios &scenariosUpd){
+
+      double operatingIncome = 
+        sumFundamentalDataOverDates(
+          jsonData,FIN,IS,timeUnit,dateSet,"operatingIncome",
+          setNansToMissingValue);
+
+      double afterTaxOperatingIncome = operatingIncome*(1.0-taxRate);
+
+      calcDiscountedCashFlowScenarios(afterTaxOperatingIncome,
+                                      reinvestmentRate,
+                                      scenariosUpd);
+
+      //Market value adjustments, as in the scalar model
+      double cash = JsonFunctions::getJsonFloat(
+        jsonData[FIN][BAL][timeUnit][dateSet.dates[0].c_str()]["cash"],
+        true);
+
+      double crossHoldings        = JsonFunctions::MISSING_VALUE;
+      double potentialLiabilities = JsonFunctions::MISSING_VALUE;
+      double optionValue          = JsonFunctions::MISSING_VALUE;      
+
+      double totalDebtEstimateEntry=debtInfo.totalDebtEstimate;
+      if(!JsonFunctions::isJsonFloatValid(totalDebtEstimateEntry)){
+        totalDebtEstimateEntry=debtInfo.longTermDebtEstimate;
+      }
+
+      double adjustment = cash 
+                        + crossHoldings
+                        - totalDebtEstimateEntry
+                        - potentialLiabilities
+                        - optionValue;
+
+      bool validInputs =   
+           JsonFunctions::isJsonFloatValid( reinvestmentRate)
+        && JsonFunctions::isJsonFloatValid( returnOnCapitalDeployed)
+        && JsonFunctions::isJsonFloatValid( operatingIncome)
+        && JsonFunctions::isJsonFloatValid( taxRate);
+
+      double missingValue = std::nan("1");
+      if(setNansToMissingValue){
+        missingValue = JsonFunctions::MISSING_VALUE;
+      }
+
+      size_t n = scenariosUpd.size();
+      scenariosUpd.priceToValue.resize(n);
+      for(size_t i=0; i<n; ++i){
+        if(!validInputs){
+          scenariosUpd.presentValueOfFutureCashFlows[i] = missingValue;
+        }
+        scenariosUpd.priceToValue[i] = marketCapitalization
+          /(scenariosUpd.presentValueOfFutureCashFlows[i] + adjustment);
+      }
+    };
+
+    //==========================================================================
+    /*
+      Running sums of the valid daily trading volumes of historicalData over
+      [firstIndex, firstIndex+volume.size()-1) so that the average volume 
+      over any window within this range costs two subtractions:
+
+        volume[i] : the sum of the valid volumes in [firstIndex, firstIndex+i)
+        count[i]  : the number of valid volumes in [firstIndex, firstIndex+i)
+    */
+    struct TradingVolumeSums{
+      int firstIndex;
+      std::vector< double > volume;
+      std::vector< double > count;
+      TradingVolumeSums():firstIndex(0){};
+    };
+
+    //==========================================================================
+    static void createTradingVolumeSums(
+                  const nlohmann::ordered_json &historicalData,
+                  int indexA,
+                  int indexB,
+                  TradingVolumeSums &sumsUpd){
+
+      sumsUpd.firstIndex = indexA;
+      int n = std::max(indexB-indexA,0);
+      sumsUpd.volume.resize(n+1);
+      sumsUpd.count.resize(n+1);
+      sumsUpd.volume[0]=0.;
+      sumsUpd.count[0]=0.;
+
+      for(int i=0; i<n; ++i){
+        double dailyVolume = JsonFunctions::getJsonFloat(
+                              historicalData.at(indexA+i)["volume"]);
+        sumsUpd.volume[i+1] = sumsUpd.volume[i];
+        sumsUpd.count[i+1]  = sumsUpd.count[i];
+        if(JsonFunctions::isJsonFloatValid(dailyVolume)){
+          sumsUpd.volume[i+1] += dailyVolume;
+          sumsUpd.count[i+1]  += 1.0;
+        }
+      }
+    };
+
+    //==========================================================================
+    /*
+      The average of the valid daily trading volumes in [indexA, indexB). 
+      The window must lie within the range of the sums. Returns nan if there
+      are no valid volumes in the window.
+    */
+    static double calcAverageTradingVolume(const TradingVolumeSums &sums,
+                                           int indexA,
+                                           int indexB){
+      int a = indexA - sums.firstIndex;
+      int b = indexB - sums.firstIndex;
+      double volume = sums.volume[b]-sums.volume[a];
+      double count  = sums.count[b] -sums.count[a];
+      return volume/count;
+    };
+
+    //==========================================================================
+    /*
+      The indices [indexA, indexB) of the most recent 
+      daysToAverageTradingVolumeOver entries of historicalData, which may be
+      in ascending or descending order of date.
+    */
+    static void getTradingVolumeWindow(
+                  const nlohmann::ordered_json &historicalData,
+                  int daysToAverageTradingVolumeOver,
+                  int &indexAUpd,
+                  int &indexBUpd){
+
+      int index = static_cast<int>(historicalData.size());
+      index--;
+
+      std::string dateStart,dateEnd;
+      JsonFunctions::getJsonString(historicalData.at(0)["date"],dateStart);
+      JsonFunctions::getJsonString(historicalData.at(index)["date"],dateEnd);
+
+      double dateStartNum = DateFunctions::convertToFractionalYear(dateStart);
+      double dateEndNum = DateFunctions::convertToFractionalYear(dateEnd);
+
+      if(dateEndNum > dateStartNum){
+        indexBUpd = index;
+        indexAUpd = indexBUpd-daysToAverageTradingVolumeOver;
+        if(indexAUpd < 0){
+          indexAUpd=0;
+        }
+      }else{
+        indexAUpd = 0;
+        indexBUpd = std::min(daysToAverageTradingVolumeOver,index+1);
+      }
+    };
+
     /*
       This is a metric inspired by a chapter in Daniel Gladiš book Hidden
       Investment Treasures. In the chapter he noted the following facts
@@ -3116,44 +3413,56 @@ class FinancialAnalysisFunctions {
       https://etfdb.com/compare/market-cap/
     */
     //calcFundLiquidityIndex
-    static double calcStockLiquidityRelativeToFundHoldings(
-          const std::string &fundKeyWord,
+    //
+    // The holdings of every fund family are summed in a single pass over the 
+    // funds using a matcher built from the keywords of all of the families 
+    // (see StringFunctions::createKeywordMatcher). Keyword i of the matcher 
+    // belongs to fundFamilies[i].
+    static void calcStockLiquidityRelativeToFundHoldings(
+          const std::vector< DataStructures::FundLiquidityFamily > 
+            &fundFamilies,
+          const StringFunctions::KeywordMatcher &fundKeyWordMatcher,
           const nlohmann::ordered_json &fundamentalData, 
           const nlohmann::ordered_json &historicalData,
-          int daysToAverageTradingVolumeOver,
-          const char *timeUnit, 
           bool setNansToMissingValue,
-          const std::string &parentName,
           nlohmann::ordered_json &liqudityMetricJson){
 
+      size_t numberOfFamilies = fundFamilies.size();
 
-      double totalFundShares        = std::nan("1");
-      double avgDailyTradingVolume  = std::nan("1");
-      double liqudityIndex          = std::nan("1");
-
+      double initialValue = std::nan("1");
       if(setNansToMissingValue){
-        totalFundShares       = JsonFunctions::MISSING_VALUE;
-        avgDailyTradingVolume = JsonFunctions::MISSING_VALUE;
-        liqudityIndex         = JsonFunctions::MISSING_VALUE;
+        initialValue = JsonFunctions::MISSING_VALUE;
       }
+      std::vector< double > totalFundShares(numberOfFamilies,initialValue);
+      std::vector< double > avgDailyTradingVolume(numberOfFamilies,
+                                                  initialValue);
+      std::vector< double > liqudityIndex(numberOfFamilies,initialValue);
       
       //
       // Evaluate the total number of shares held by funds that contain
-      // the keyword in their name.
+      // the keyword of each family in their name.
       //
       if(fundamentalData[HLDRS].contains(std::string(FNDS))){
+        std::string fundName;
+        std::vector< bool > keyWordFound;
         for(auto& el: fundamentalData[HLDRS][FNDS]){
-          std::string fundName;
           JsonFunctions::getJsonString(el["name"],fundName);
-          size_t idxKeyWord = fundName.find(fundKeyWord); 
-          if(idxKeyWord != std::string::npos){
-            double currentShares = 
-              JsonFunctions::getJsonFloat(el["currentShares"]);
-            if(JsonFunctions::isJsonFloatValid(currentShares)){
-              if(std::isnan(totalFundShares)){
-                totalFundShares=currentShares;
+          size_t numberFound = StringFunctions::findKeywords(
+                                  fundKeyWordMatcher,fundName,keyWordFound);
+          if(numberFound == 0){
+            continue;
+          }
+          double currentShares = 
+            JsonFunctions::getJsonFloat(el["currentShares"]);
+          if(!JsonFunctions::isJsonFloatValid(currentShares)){
+            continue;
+          }
+          for(size_t i=0; i<numberOfFamilies; ++i){
+            if(keyWordFound[i]){
+              if(std::isnan(totalFundShares[i])){
+                totalFundShares[i]=currentShares;
               }else{
-                totalFundShares+=currentShares;
+                totalFundShares[i]+=currentShares;
               }
             }
           }
@@ -3161,68 +3470,47 @@ class FinancialAnalysisFunctions {
       }
 
       //
-      // Evaluate the average daily trading volume
+      // Evaluate the average daily trading volume. The windows of all of the
+      // families end at the same day and so are covered by one set of sums.
       //
-      if( daysToAverageTradingVolumeOver > 0){
-
-        int index = static_cast<int>(historicalData.size());
-        index--;
-
-        std::string dateStart,dateEnd;
-        JsonFunctions::getJsonString(historicalData.at(0)["date"],dateStart);
-        JsonFunctions::getJsonString(historicalData.at(index)["date"],dateEnd);
-
-        double dateStartNum = DateFunctions::convertToFractionalYear(dateStart);
-        double dateEndNum = DateFunctions::convertToFractionalYear(dateEnd);
+      int maxDaysToAverageTradingVolumeOver = 0;
+      for(auto const &family : fundFamilies){
+        maxDaysToAverageTradingVolumeOver = 
+          std::max(maxDaysToAverageTradingVolumeOver,
+                   family.daysToAverageTradingVolumeOver);
+      }
 
+      if(maxDaysToAverageTradingVolumeOver > 0){
         int indexA = 0;
         int indexB = 0;
-        if(dateEndNum > dateStartNum){
-          indexB = index;
-          indexA = indexB-daysToAverageTradingVolumeOver;
-          if(indexA < 0){
-            indexA=0;
+        getTradingVolumeWindow(historicalData,
+                               maxDaysToAverageTradingVolumeOver,
+                               indexA,indexB);
+        TradingVolumeSums volumeSums;
+        createTradingVolumeSums(historicalData,indexA,indexB,volumeSums);
+
+        for(size_t i=0; i<numberOfFamilies; ++i){
+          int days = fundFamilies[i].daysToAverageTradingVolumeOver;
+          if(days > 0){
+            getTradingVolumeWindow(historicalData,days,indexA,indexB);
+            avgDailyTradingVolume[i] = 
+              calcAverageTradingVolume(volumeSums,indexA,indexB);
+            liqudityIndex[i] = avgDailyTradingVolume[i] / totalFundShares[i];
           }
-        }else{
-          indexA = 0;
-          indexB = daysToAverageTradingVolumeOver;
         }
+      }
 
-
-        double count = 0.;
-        double volume = 0.;
-        for(int index = indexA; index < indexB; ++index){
-          double dailyVolume = 
-            JsonFunctions::getJsonFloat(historicalData.at(index)["volume"]);
-          if(JsonFunctions::isJsonFloatValid(dailyVolume)){
-            volume+=dailyVolume;
-            count = count+1.0;
-          }
-        }
-        avgDailyTradingVolume = volume/count;
-
-        liqudityIndex = avgDailyTradingVolume / totalFundShares;
-
-      }
-
-      liqudityMetricJson[parentName+"totalFundShares"]
-        =totalFundShares;
-      liqudityMetricJson[parentName+"averageDailyTradingVolumeDays"]
-        =daysToAverageTradingVolumeOver;
-      liqudityMetricJson[parentName+"averageDailyTradingVolume"]
-        =avgDailyTradingVolume;
-      liqudityMetricJson[parentName+"liquidityIndex"]
-        =liqudityIndex;
-
-      //if(appendTermRecord){
-      //  termNames.push_back(parentName+"totalFundShares");
-      //  termNames.push_back(parentName+"averageDailyTradingVolume");
-      //  termNames.push_back(parentName+"liquidityIndex");
-      //  termValues.push_back(totalFundShares);
-      //  termValues.push_back(avgDailyTradingVolume);
-      //  termValues.push_back(liqudityIndex);
-      //}      
-      return liqudityIndex;
+      for(size_t i=0; i<numberOfFamilies; ++i){
+        const std::string &parentName = fundFamilies[i].name;
+        liqudityMetricJson[parentName+"totalFundShares"]
+          =totalFundShares[i];
+        liqudityMetricJson[parentName+"averageDailyTradingVolumeDays"]
+          =fundFamilies[i].daysToAverageTradingVolumeOver;
+        liqudityMetricJson[parentName+"averageDailyTradingVolume"]
+          =avgDailyTradingVolume[i];
+        liqudityMetricJson[parentName+"liquidityIndex"]
+          =liqudityIndex[i];
+      }
 
     };
 
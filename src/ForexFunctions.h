@@ -0,0 +1,485 @@
+//SPDX-FileCopyrightText: 2023 Matthew Millard millard.matthew@gmail.com
+//SPDX-License-Identifier: MIT
+
+#ifndef FOREX_FUNCTIONS
+#define FOREX_FUNCTIONS
+
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+#include <iostream>
+#include <filesystem>
+#include <nlohmann/json.hpp>
+
+#include "date.h"
+#include "JsonFunctions.h"
+
+/*
+  Functions to express a ticker's historical prices in the currency that its
+  fundamental data is reported in.
+
+  A price can differ from the fundamental data in two ways:
+
+  1. The price is quoted in a sub-unit of a currency (e.g. GBX, pence
+     sterling, on the London exchange). The sub-units and their scale are
+     listed in currency-units.json.
+
+  2. The price is quoted in a different currency (e.g. a German listing of
+     a US company). The exchange rates come from the EOD FOREX files
+     downloaded by fetch into the forex folder. There are two kinds:
+
+     - CCY.FOREX.json    : the number of CCY per USD (e.g. EUR.FOREX)
+     - AAABBB.FOREX.json : the number of BBB per AAA (e.g. EURGBP.FOREX)
+
+  The exchange rate series are loaded from the forex folder the first time
+  that they are needed and are then kept in a ForexStore as (day, rate)
+  arrays, which can be shared between threads. The conversion of a ticker
+  (the sub-unit scale and the exchange rate series to use) is worked out
+  once in a PriceConversion and is then applied to the whole price history
+  in one pass.
+*/
+class ForexFunctions {
+
+  public:
+
+    //==========================================================================
+    /*
+      @param days : the number of days since 1970-01-01, in ascending order
+      @param rates : the closing exchange rate on each day
+      @param filePath : the file the series was read from
+      @param valid : false if the file does not exist or has no valid rates
+    */
+    struct ForexSeries{
+      std::vector< int32_t > days;
+      std::vector< double > rates;
+      std::string filePath;
+      bool valid;
+      ForexSeries():valid(false){};
+    };
+
+    //==========================================================================
+    /*
+      A price currency that is a fraction of another currency, e.g. GBX
+      with currency GBP and scale 0.01
+    */
+    struct CurrencySubUnit{
+      std::string currency;
+      double scale;
+      CurrencySubUnit():scale(1.0){};
+    };
+
+    //==========================================================================
+    /*
+      The exchange rate series, keyed by their FOREX code (e.g. EUR or
+      EURGBP). The series are loaded on first use: getForexSeries can be
+      called from several threads at once, and the series it returns are
+      never modified afterwards.
+    */
+    struct ForexStore{
+      std::string forexFolder;
+      std::map< std::string, CurrencySubUnit > subUnits;
+      std::map< std::string, ForexSeries > series;
+      std::mutex seriesLock;
+    };
+
+    //==========================================================================
+    /*
+      How to convert the prices of one ticker into the fundamental currency:
+
+        fundamental price = price * scale * rate(day)
+
+      where rate(day) = numerator(day) / denominator(day), and a missing
+      (nullptr) series counts as 1. If both series are nullptr no exchange
+      rate is needed.
+
+      @param valid : false if the currencies differ and there is no FOREX
+                     data to convert between them
+    */
+    struct PriceConversion{
+      std::string priceCurrency;
+      std::string fundamentalCurrency;
+      double scale;
+      const ForexSeries *numerator;
+      const ForexSeries *denominator;
+      bool valid;
+      PriceConversion():
+        scale(1.0),
+        numerator(nullptr),
+        denominator(nullptr),
+        valid(true){};
+    };
+
+    //==========================================================================
+    /*
+      Converts a date in the format %Y-%m-%d to the number of days since
+      1970-01-01. Returns false if the date cannot be read.
+    */
+    static bool convertToDays(const std::string &dateStr, int32_t &daysUpd){
+      if(dateStr.size() < 10 || dateStr[4] != '-' || dateStr[7] != '-'){
+        return false;
+      }
+      int fields[3] = {0,0,0};
+      const int starts[3]  = {0,5,8};
+      const int lengths[3] = {4,2,2};
+      for(int i=0; i<3; ++i){
+        for(int j=starts[i]; j<starts[i]+lengths[i]; ++j){
+          if(dateStr[j] < '0' || dateStr[j] > '9'){
+            return false;
+          }
+          fields[i] = fields[i]*10 + (dateStr[j]-'0');
+        }
+      }
+      date::year_month_day ymd{date::year(fields[0]),
+                               date::month(static_cast<unsigned>(fields[1])),
+                               date::day(static_cast<unsigned>(fields[2]))};
+      if(!ymd.ok()){
+        return false;
+      }
+      daysUpd = static_cast<int32_t>(date::sys_days(ymd).time_since_epoch()
+                                                         .count());
+      return true;
+    };
+
+    //==========================================================================
+    /*
+      Creates an empty store that reads from forexFolder, and reads the
+      currency sub-units from the contents of currency-units.json.
+    */
+    static void createForexStore(const std::string &forexFolder,
+                                 const nlohmann::ordered_json &currencyUnits,
+                                 ForexStore &storeUpd){
+      storeUpd.forexFolder = forexFolder;
+      storeUpd.subUnits.clear();
+      storeUpd.series.clear();
+
+      for(auto const &el : currencyUnits){
+        if(!el.contains("StockPriceCurrencyCode") || !el.contains("Currency")
+            || !el.contains("StockPriceToCurrencyScale")){
+          continue;
+        }
+        std::string code;
+        CurrencySubUnit subUnit;
+        JsonFunctions::getJsonString(el["StockPriceCurrencyCode"],code);
+        JsonFunctions::getJsonString(el["Currency"],subUnit.currency);
+        subUnit.scale =
+          JsonFunctions::getJsonFloat(el["StockPriceToCurrencyScale"]);
+        if(code.length() > 0 && JsonFunctions::isJsonFloatValid(subUnit.scale)){
+          storeUpd.subUnits[code] = subUnit;
+        }
+      }
+    };
+
+    //==========================================================================
+    /*
+      Reads an EOD FOREX file: an array of entries that each have a date and
+      a close (or adjusted_close). Entries without a valid positive rate are
+      skipped.
+    */
+    static void loadForexSeries(const std::string &filePath,
+                                ForexSeries &seriesUpd){
+      seriesUpd = ForexSeries();
+      seriesUpd.filePath = filePath;
+
+      if(!std::filesystem::exists(filePath)){
+        return;
+      }
+
+      nlohmann::ordered_json forexData;
+      if(!JsonFunctions::loadJsonFile(filePath, forexData, false)
+          || !forexData.is_array()){
+        return;
+      }
+
+      std::vector< std::pair< int32_t, double > > entries;
+      entries.reserve(forexData.size());
+      for(auto const &el : forexData){
+        if(!el.contains("date")){
+          continue;
+        }
+        std::string dateStr;
+        JsonFunctions::getJsonString(el["date"],dateStr);
+        int32_t day;
+        if(!convertToDays(dateStr,day)){
+          continue;
+        }
+        double rate = std::nan("1");
+        if(el.contains("close")){
+          rate = JsonFunctions::getJsonFloat(el["close"]);
+        }
+        if(!(rate > 0.) && el.contains("adjusted_close")){
+          rate = JsonFunctions::getJsonFloat(el["adjusted_close"]);
+        }
+        if(rate > 0. && std::isfinite(rate)){
+          entries.push_back(std::make_pair(day,rate));
+        }
+      }
+
+      std::stable_sort(entries.begin(),entries.end(),
+        [](const std::pair< int32_t, double > &a,
+           const std::pair< int32_t, double > &b){
+          return a.first < b.first;
+        });
+
+      seriesUpd.days.resize(entries.size());
+      seriesUpd.rates.resize(entries.size());
+      for(size_t i=0; i<entries.size(); ++i){
+        seriesUpd.days[i]  = entries[i].first;
+        seriesUpd.rates[i] = entries[i].second;
+      }
+      seriesUpd.valid = !entries.empty();
+    };
+
+    //==========================================================================
+    /*
+      Returns the series of a FOREX code (e.g. EUR or EURGBP), loading it
+      from the forex folder if this is the first request for it. Returns
+      nullptr if there is no valid data for the code.
+    */
+    static const ForexSeries* getForexSeries(ForexStore &store,
+                                             const std::string &code){
+      if(store.forexFolder.length() == 0 || code.length() == 0){
+        return nullptr;
+      }
+
+      std::lock_guard< std::mutex > lock(store.seriesLock);
+      auto iter = store.series.find(code);
+      if(iter == store.series.end()){
+        std::string filePath = store.forexFolder;
+        if(filePath.back() != '/'){
+          filePath.push_back('/');
+        }
+        filePath.append(code);
+        filePath.append(".FOREX.json");
+        iter = store.series.emplace(code, ForexSeries()).first;
+        loadForexSeries(filePath, iter->second);
+      }
+      return iter->second.valid ? &(iter->second) : nullptr;
+    };
+
+    //==========================================================================
+    /*
+      The most recent rate on or before day, or nan if the series starts
+      after day.
+    */
+    static double getRateAsOf(const ForexSeries &series, int32_t day){
+      auto iter = std::upper_bound(series.days.begin(),series.days.end(),day);
+      if(iter == series.days.begin()){
+        return std::nan("1");
+      }
+      return series.rates[std::distance(series.days.begin(),iter)-1];
+    };
+
+    //==========================================================================
+    /*
+      The most recent rate on or before each of the days. Runs of ascending
+      days are looked up by moving a cursor forward rather than by a search.
+    */
+    static void getRatesAsOf(const ForexSeries &series,
+                             const std::vector< int32_t > &days,
+                             std::vector< double > &ratesUpd){
+      ratesUpd.resize(days.size());
+      size_t n = series.days.size();
+      size_t cursor = 0; //index of the first series day after days[i-1]
+      for(size_t i=0; i<days.size(); ++i){
+        if(i == 0 || days[i] < days[i-1]){
+          cursor = std::distance(series.days.begin(),
+                    std::upper_bound(series.days.begin(),
+                                     series.days.end(),days[i]));
+        }else{
+          while(cursor < n && series.days[cursor] <= days[i]){
+            ++cursor;
+          }
+        }
+        ratesUpd[i] = (cursor > 0) ? series.rates[cursor-1] : std::nan("1");
+      }
+    };
+
+    //==========================================================================
+    /*
+      Works out how to convert the prices of a ticker into the currency of
+      its fundamental data. The price currency is General:CurrencyCode and
+      the fundamental currency is the currency_symbol of the balance sheet.
+      If either is missing the prices are assumed to be in the fundamental
+      currency already.
+
+      The exchange rate is taken, in order of preference, from the direct
+      pair (PRICEFUND), the inverse pair (FUNDPRICE), or by way of the USD
+      rates of each currency.
+    */
+    static void createPriceConversion(
+                  ForexStore &store,
+                  const nlohmann::ordered_json &fundamentalData,
+                  PriceConversion &conversionUpd){
+
+      conversionUpd = PriceConversion();
+
+      if(fundamentalData.contains("General")
+          && fundamentalData["General"].contains("CurrencyCode")){
+        JsonFunctions::getJsonString(fundamentalData["General"]["CurrencyCode"],
+                                     conversionUpd.priceCurrency);
+      }
+      if(fundamentalData.contains("Financials")
+          && fundamentalData["Financials"].contains("Balance_Sheet")
+          && fundamentalData["Financials"]["Balance_Sheet"]
+                            .contains("currency_symbol")){
+        JsonFunctions::getJsonString(
+          fundamentalData["Financials"]["Balance_Sheet"]["currency_symbol"],
+          conversionUpd.fundamentalCurrency);
+      }
+
+      if(   conversionUpd.priceCurrency.length() == 0
+         || conversionUpd.fundamentalCurrency.length() == 0
+         || conversionUpd.priceCurrency.compare(
+              conversionUpd.fundamentalCurrency) == 0){
+        return;
+      }
+
+      //A price reported in a fraction of a currency
+      std::string currency = conversionUpd.priceCurrency;
+      auto subUnit = store.subUnits.find(currency);
+      if(subUnit != store.subUnits.end()){
+        conversionUpd.scale = subUnit->second.scale;
+        currency = subUnit->second.currency;
+      }
+
+      const std::string &fundamentalCurrency
+        = conversionUpd.fundamentalCurrency;
+
+      if(currency.compare(fundamentalCurrency) == 0){
+        return;
+      }
+
+      const ForexSeries *direct =
+        getForexSeries(store, currency + fundamentalCurrency);
+      if(direct != nullptr){
+        conversionUpd.numerator = direct;
+        return;
+      }
+
+      const ForexSeries *inverse =
+        getForexSeries(store, fundamentalCurrency + currency);
+      if(inverse != nullptr){
+        conversionUpd.denominator = inverse;
+        return;
+      }
+
+      //rate = (fundamental currency per USD) / (price currency per USD)
+      const ForexSeries *fundamentalPerUsd = nullptr;
+      const ForexSeries *pricePerUsd = nullptr;
+      bool validFundamental = true;
+      bool validPrice = true;
+      if(fundamentalCurrency.compare("USD") != 0){
+        fundamentalPerUsd = getForexSeries(store, fundamentalCurrency);
+        validFundamental = (fundamentalPerUsd != nullptr);
+      }
+      if(currency.compare("USD") != 0){
+        pricePerUsd = getForexSeries(store, currency);
+        validPrice = (pricePerUsd != nullptr);
+      }
+
+      conversionUpd.numerator   = fundamentalPerUsd;
+      conversionUpd.denominator = pricePerUsd;
+      conversionUpd.valid       = validFundamental && validPrice;
+    };
+
+    //==========================================================================
+    static bool isIdentity(const PriceConversion &conversion){
+      return conversion.scale == 1.0
+          && conversion.numerator == nullptr
+          && conversion.denominator == nullptr;
+    };
+
+    //==========================================================================
+    /*
+      The paths of the FOREX files that the conversion uses
+    */
+    static void getForexFilePaths(const PriceConversion &conversion,
+                                  std::vector< std::string > &filePathsUpd){
+      filePathsUpd.clear();
+      if(conversion.numerator != nullptr){
+        filePathsUpd.push_back(conversion.numerator->filePath);
+      }
+      if(conversion.denominator != nullptr){
+        filePathsUpd.push_back(conversion.denominator->filePath);
+      }
+    };
+
+    //==========================================================================
+    /*
+      The factor that converts a price on each of the days into the
+      fundamental currency. The factor is nan on days that precede the
+      FOREX data.
+    */
+    static void calcConversionFactors(const PriceConversion &conversion,
+                                      const std::vector< int32_t > &days,
+                                      std::vector< double > &factorsUpd){
+      factorsUpd.assign(days.size(), conversion.scale);
+      std::vector< double > rates;
+      if(conversion.numerator != nullptr){
+        getRatesAsOf(*conversion.numerator, days, rates);
+        for(size_t i=0; i<days.size(); ++i){
+          factorsUpd[i] *= rates[i];
+        }
+      }
+      if(conversion.denominator != nullptr){
+        getRatesAsOf(*conversion.denominator, days, rates);
+        for(size_t i=0; i<days.size(); ++i){
+          factorsUpd[i] /= rates[i];
+        }
+      }
+    };
+
+    //==========================================================================
+    /*
+      Converts the open, high, low, close, and adjusted_close prices of an
+      EOD historical price file into the fundamental currency. Prices on
+      days that have no exchange rate are set to null.
+    */
+    static void applyPriceConversion(const PriceConversion &conversion,
+                                     nlohmann::ordered_json &historicalDataUpd){
+
+      if(isIdentity(conversion) || !historicalDataUpd.is_array()){
+        return;
+      }
+
+      std::vector< int32_t > days(historicalDataUpd.size(),
+                                  std::numeric_limits< int32_t >::min());
+      std::string dateStr;
+      size_t i=0;
+      for(auto const &el : historicalDataUpd){
+        if(el.contains("date")){
+          JsonFunctions::getJsonString(el["date"],dateStr);
+          convertToDays(dateStr,days[i]);
+        }
+        ++i;
+      }
+
+      std::vector< double > factors;
+      calcConversionFactors(conversion, days, factors);
+
+      const char* priceFields[5] =
+        {"open","high","low","close","adjusted_close"};
+
+      i=0;
+      for(auto &el : historicalDataUpd){
+        for(const char* field : priceFields){
+          if(el.contains(field) && el[field].is_number()){
+            double value = el[field].get<double>()*factors[i];
+            if(std::isfinite(value)){
+              el[field] = value;
+            }else{
+              el[field] = nullptr;
+            }
+          }
+        }
+        ++i;
+      }
+    };
+
+};
+
+#endif
@@ -0,0 +1,103 @@
+//SPDX-FileCopyrightText: 2023 Matthew Millard millard.matthew@gmail.com
+//SPDX-License-Identifier: MIT
+
+#ifndef HASH_FUNCTIONS
+#define HASH_FUNCTIONS
+
+#include <string>
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <vector>
+
+
+/*
+  64-bit FNV-1a hashes of strings and files. These are used to detect
+  whether an input has changed, and to assign tickers to shards, and so the
+  value has to be the same on every machine and from one run to the next.
+  std::hash does not guarantee this.
+*/
+class HashFunctions {
+
+  public:
+
+    static constexpr uint64_t FNV_OFFSET = 14695981039346656037ULL;
+    static constexpr uint64_t FNV_PRIME  = 1099511628211ULL;
+
+    //==========================================================================
+    static uint64_t appendToHash(uint64_t hash, const char *data, size_t size){
+      for(size_t i=0; i<size; ++i){
+        hash ^= static_cast<uint64_t>(static_cast<unsigned char>(data[i]));
+        hash *= FNV_PRIME;
+      }
+      return hash;
+    };
+
+    //==========================================================================
+    static uint64_t appendToHash(uint64_t hash, const std::string &text){
+      return appendToHash(hash, text.c_str(), text.length());
+    };
+
+    //==========================================================================
+    static uint64_t appendToHash(uint64_t hash, double value){
+      return appendToHash(hash, reinterpret_cast<const char*>(&value),
+                          sizeof(double));
+    };
+
+    //==========================================================================
+    static uint64_t appendToHash(uint64_t hash, 
+                                 const std::vector< double > &values){
+      hash = appendToHash(hash, static_cast<double>(values.size()));
+      return appendToHash(hash, reinterpret_cast<const char*>(values.data()),
+                          values.size()*sizeof(double));
+    };
+
+    //==========================================================================
+    static uint64_t appendToHash(uint64_t hash, 
+                                 const std::vector< std::string > &values){
+      for(auto const &value : values){
+        hash = appendToHash(hash, value);
+        hash = appendToHash(hash, "\n", 1);
+      }
+      return hash;
+    };
+
+    //==========================================================================
+    static uint64_t calcStableHash(const std::string &text){
+      return appendToHash(FNV_OFFSET, text);
+    };
+
+    //==========================================================================
+    /*
+      Hashes the contents of a file. Returns false if the file cannot be
+      opened.
+    */
+    static bool calcFileHash(const std::string &filePath, uint64_t &hashUpd){
+      std::ifstream fileStream(filePath, std::ios::in | std::ios::binary);
+      if(!fileStream.is_open()){
+        return false;
+      }
+      uint64_t hash = FNV_OFFSET;
+      std::vector< char > buffer(1 << 16);
+      while(fileStream){
+        fileStream.read(buffer.data(), buffer.size());
+        std::streamsize n = fileStream.gcount();
+        if(n > 0){
+          hash = appendToHash(hash, buffer.data(), static_cast<size_t>(n));
+        }
+      }
+      hashUpd = hash;
+      return true;
+    };
+
+    //==========================================================================
+    static std::string convertHashToString(uint64_t hash){
+      std::stringstream ss;
+      ss << std::hex << std::setw(16) << std::setfill('0') << hash;
+      return ss.str();
+    };
+
+};
+
+#endif
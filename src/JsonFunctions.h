@@ -4,7 +4,11 @@
 #ifndef JSON_FUNCTIONS
 #define JSON_FUNCTIONS
 
+#include <map>
 #include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
 #include <nlohmann/json.hpp>
 #include <stdlib.h>
 #include <numeric>
@@ -12,6 +16,7 @@
 //#include <chrono>
 #include "date.h"
 #include "DateFunctions.h"
+#include "PrefetchFunctions.h"
 
 class JsonFunctions {
 
@@ -56,21 +61,113 @@ class JsonFunctions {
     }
 
 
+//==============================================================================
+/*
+  The sections of a json file that are kept when it is loaded. A section is
+  a path of member names separated by '.': "Earnings.History" keeps the 
+  History member of Earnings and no other member of Earnings. A filter 
+  that has no sections keeps everything.
+*/
+    struct SectionFilter{
+      bool keepAll;
+      std::map< std::string, SectionFilter > members;
+      SectionFilter():keepAll(true){};
+    };
+
+//==============================================================================
+    static void createSectionFilter(const std::vector< std::string > &sections,
+                                    SectionFilter &filterUpd){
+      filterUpd = SectionFilter();
+      filterUpd.keepAll = sections.empty();
+
+      for(auto const &section : sections){
+        std::vector< std::string > path;
+        std::stringstream sectionStream(section);
+        std::string member;
+        while(std::getline(sectionStream,member,'.')){
+          path.push_back(member);
+        }
+
+        SectionFilter *node = &filterUpd;
+        for(size_t i=0; i<path.size() && !node->keepAll; ++i){
+          bool added = (node->members.count(path[i]) == 0);
+          SectionFilter &child = node->members[path[i]];
+          if(i+1 == path.size()){
+            child.keepAll = true;
+            child.members.clear();
+          }else if(added){
+            child.keepAll = false;
+          }
+          node = &child;
+        }
+      }
+    };
+
+//==============================================================================
+/*
+  Parses a json document (a stream or a string) and keeps only the sections
+  in filter. The members that are not in the filter are read past by the 
+  parser but are never stored, and so cost neither memory nor the time to 
+  build them.
+*/
+    template< typename InputType >
+    static nlohmann::ordered_json parseJsonSections(InputType &&input,
+                                              const SectionFilter &filter){
+      using json = nlohmann::ordered_json;
+
+      //filters[d] is the filter of the value whose members are at depth d+1.
+      //nullptr keeps everything.
+      std::vector< const SectionFilter* > filters(2,nullptr);
+      filters[0] = filter.keepAll ? nullptr : &filter;
+
+      json::parser_callback_t callback = 
+        [&filters](int depth, json::parse_event_t event, json &parsed){
+          size_t level = static_cast<size_t>(depth);
+          if(filters.size() < level+2){
+            filters.resize(level+2,nullptr);
+          }
+          if(event == json::parse_event_t::key){
+            const SectionFilter *parent = filters[level-1];
+            filters[level] = nullptr;
+            if(parent == nullptr){
+              return true;
+            }
+            auto iter = parent->members.find(
+                          parsed.get_ref<const std::string&>());
+            if(iter == parent->members.end()){
+              return false;
+            }
+            if(!iter->second.keepAll){
+              filters[level] = &iter->second;
+            }
+          }else if(event == json::parse_event_t::array_start){
+            //The elements of an array share the filter of the array
+            filters[level+1] = filters[level];
+          }
+          return true;
+        };
+
+      return json::parse(std::forward<InputType>(input),callback);
+    };
+
 //==============================================================================
     static bool loadJsonFile(const std::string &fileName, 
                              const std::string &folder,
                              nlohmann::ordered_json &jsonData,
-                             bool verbose){
+                             bool verbose,
+                             const SectionFilter *sections=nullptr){
        std::stringstream ss;
        ss << folder << fileName;                              
-       return loadJsonFile(ss.str(),jsonData,verbose);
+       return loadJsonFile(ss.str(),jsonData,verbose,sections);
 
     }
 
 //==============================================================================
+    //Optional: sections, nullptr to load the entire file
     static bool loadJsonFile(const std::string &fullFilePath,
                              nlohmann::ordered_json &jsonData,
-                             bool verbose){
+                             bool verbose,
+                             const SectionFilter *sections=nullptr){
 
       bool success=true;
       std::string filePath = fullFilePath;
@@ -81,8 +178,23 @@ class JsonFunctions {
         }else if(filePath.substr(filePath.length()-5,5).compare(".json") != 0){
           filePath.append(".json");
         }
-        std::ifstream inputJsonFileStream(filePath.c_str());
-        jsonData = nlohmann::ordered_json::parse(inputJsonFileStream);
+        //The file may already have been read by a prefetching thread
+        const std::string *prefetchedFile = 
+          PrefetchFunctions::getPrefetchedFile(filePath);
+        if(prefetchedFile != nullptr){
+          if(sections != nullptr){
+            jsonData = parseJsonSections(*prefetchedFile,*sections);
+          }else{
+            jsonData = nlohmann::ordered_json::parse(*prefetchedFile);
+          }
+        }else{
+          std::ifstream inputJsonFileStream(filePath.c_str());
+          if(sections != nullptr){
+            jsonData = parseJsonSections(inputJsonFileStream,*sections);
+          }else{
+            jsonData = nlohmann::ordered_json::parse(inputJsonFileStream);
+          }
+        }
 
         if(jsonData.empty()){
           success=false;
@@ -0,0 +1,486 @@
+//SPDX-FileCopyrightText: 2023 Matthew Millard millard.matthew@gmail.com
+//SPDX-License-Identifier: MIT
+
+#ifndef METRIC_SELECTION_FUNCTIONS
+#define METRIC_SELECTION_FUNCTIONS
+
+#include <string>
+#include <vector>
+#include <sstream>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <filesystem>
+#include <nlohmann/json.hpp>
+
+#include "JsonFunctions.h"
+
+/*
+  calculate evaluates a number of families of metrics: discounted cash flow
+  valuations, growth models, William Priest's dividend metrics, etc. Most
+  screens only read a handful of these. The functions here are used to
+  select the families that calculate evaluates, either by name, or by
+  scanning the filter, ranking, and weighting fields of screen configuration
+  files for the calculateData fields that they read.
+
+  The core metrics (cost of capital, returns on capital, margins, cash flows,
+  enterprise value, acquirer's multiple, shareholder yield) are cheap, are
+  needed by many of the other families, and are always evaluated.
+*/
+class MetricSelectionFunctions {
+
+  public:
+
+    enum MetricFamily{
+      FAMILY_DCF=0,
+      FAMILY_ATOI_GROWTH,
+      FAMILY_DCF_EMPIRICAL,
+      FAMILY_PRICE_MODEL,
+      FAMILY_EQUITY_GROWTH,
+      FAMILY_EPS_GROWTH,
+      FAMILY_GROSS_PROFIT_GROWTH,
+      FAMILY_FCF_GROWTH,
+      FAMILY_REVENUE_GROWTH,
+      FAMILY_FINANCIAL_RATIOS,
+      FAMILY_EPS_VALUATION,
+      FAMILY_FCF_VALUATION,
+      FAMILY_DIVIDENDS,
+      FAMILY_LIQUIDITY,
+      FAMILY_MONTE_CARLO,
+      NUMBER_OF_FAMILIES
+    };
+
+    static constexpr const char* CORE = "core";
+    static constexpr const char* ALL  = "all";
+
+    //==========================================================================
+    /*
+      @param name : the name used on the command line
+      @param termNames : the names of the metric_data and
+                         price_to_value_current fields written by this family.
+                         A field matches if it is equal to one of these names
+                         or begins with one of these names followed by '_'
+      @param sections : the top level fields of calculate's output that are
+                        written by this family
+      @param dependencies : the families that must also be evaluated
+    */
+    struct MetricFamilyDefinition{
+      MetricFamily id;
+      const char* name;
+      std::vector< std::string > termNames;
+      std::vector< std::string > sections;
+      std::vector< MetricFamily > dependencies;
+    };
+
+    //==========================================================================
+    struct MetricSelection{
+      bool allSelected;
+      std::vector< bool > isSelected;
+      //The calculateData fields that the selection was derived from
+      std::vector< std::string > fields;
+      MetricSelection():
+        allSelected(true),
+        isSelected(NUMBER_OF_FAMILIES,true){};
+    };
+
+    //==========================================================================
+    static const std::vector< MetricFamilyDefinition >&
+        getMetricFamilyDefinitions(){
+
+      static const std::vector< MetricFamilyDefinition > definitions = {
+        {FAMILY_DCF, "dcf",
+          {"priceToValue"},
+          {"price_to_value_surface"},
+          {}},
+        {FAMILY_ATOI_GROWTH, "atoi_growth",
+          {"atoiEmpirical","atoiEmpiricalAvg"},
+          {"atoi_growth_model_avg","atoi_growth_model_recent"},
+          {}},
+        {FAMILY_DCF_EMPIRICAL, "dcf_empirical",
+          {"priceToValueEmpirical","priceToValueEmpiricalAvg"},
+          {},
+          {FAMILY_ATOI_GROWTH}},
+        {FAMILY_PRICE_MODEL, "price_model",
+          {},
+          {"price_growth_model"},
+          {}},
+        {FAMILY_EQUITY_GROWTH, "equity_growth",
+          {"equityEmpiricalModel","equityEmpiricalModelAvg"},
+          {"equity_growth_model_avg","equity_growth_model_recent"},
+          {}},
+        {FAMILY_EPS_GROWTH, "eps_growth",
+          {"epsEmpiricalModel","epsEmpiricalModelAvg"},
+          {"eps_growth_model_avg","eps_growth_model_recent"},
+          {}},
+        {FAMILY_GROSS_PROFIT_GROWTH, "gross_profit_growth",
+          {"grossProfitEmpiricalModel","grossProfitEmpiricalModelAvg"},
+          {"grossProfit_growth_model_avg","grossProfit_growth_model_recent"},
+          {}},
+        {FAMILY_FCF_GROWTH, "fcf_growth",
+          {"fcfEmpiricalModel","fcfEmpiricalModelAvg"},
+          {"fcf_growth_model_avg","fcf_growth_model_recent"},
+          {}},
+        {FAMILY_REVENUE_GROWTH, "revenue_growth",
+          {"revenueEmpiricalModel","revenueEmpiricalModelAvg"},
+          {"revenue_growth_model_avg","revenue_growth_model_recent"},
+          {}},
+        {FAMILY_FINANCIAL_RATIOS, "financial_ratios",
+          {"financialRatios"},
+          {},
+          {}},
+        {FAMILY_EPS_VALUATION, "eps_valuation",
+          {"priceToValueEpsGrowth"},
+          {},
+          {FAMILY_EQUITY_GROWTH, FAMILY_FINANCIAL_RATIOS}},
+        {FAMILY_FCF_VALUATION, "fcf_valuation",
+          {"priceToValueRevenueToFcf","priceToValueRevenueToFcfAvg"},
+          {"revenue_to_fcf_model_avg","revenue_to_fcf_model_recent"},
+          {FAMILY_REVENUE_GROWTH}},
+        {FAMILY_DIVIDENDS, "dividends",
+          {"PriestDividendMetrics"},
+          {"dividend_yield_growth_model","dividend_yield_growth_model_avg",
+           "dividends_paid_growth_model_avg",
+           "dividends_paid_growth_model_recent"},
+          {FAMILY_FCF_GROWTH}},
+        {FAMILY_LIQUIDITY, "liquidity",
+          {},
+          {"fund_liquidity_index"},
+          {}},
+        {FAMILY_MONTE_CARLO, "monte_carlo",
+          {},
+          {"price_to_value_distribution"},
+          {FAMILY_FCF_VALUATION}},
+      };
+      return definitions;
+    };
+
+    //==========================================================================
+    static bool isSelected(const MetricSelection &selection,
+                           MetricFamily family){
+      return selection.isSelected[family];
+    };
+
+    //==========================================================================
+    static void clearSelection(MetricSelection &selectionUpd){
+      selectionUpd.allSelected = false;
+      selectionUpd.isSelected.assign(NUMBER_OF_FAMILIES,false);
+      selectionUpd.fields.clear();
+    };
+
+    //==========================================================================
+    static void selectAll(MetricSelection &selectionUpd){
+      selectionUpd.allSelected = true;
+      selectionUpd.isSelected.assign(NUMBER_OF_FAMILIES,true);
+    };
+
+    //==========================================================================
+    static void selectFamily(MetricFamily family,
+                             MetricSelection &selectionUpd){
+      if(selectionUpd.isSelected[family]){
+        return;
+      }
+      selectionUpd.isSelected[family] = true;
+      for(auto const &dependency :
+            getMetricFamilyDefinitions()[family].dependencies){
+        selectFamily(dependency,selectionUpd);
+      }
+      selectionUpd.allSelected =
+        std::all_of(selectionUpd.isSelected.begin(),
+                    selectionUpd.isSelected.end(),
+                    [](bool value){return value;});
+    };
+
+    //==========================================================================
+    /*
+      Selects a family by name. Returns false if the name is unknown.
+    */
+    static bool selectFamily(const std::string &name,
+                             MetricSelection &selectionUpd){
+      if(name.compare(CORE)==0){
+        return true;
+      }
+      if(name.compare(ALL)==0){
+        selectAll(selectionUpd);
+        return true;
+      }
+      for(auto const &definition : getMetricFamilyDefinitions()){
+        if(name.compare(definition.name)==0){
+          selectFamily(definition.id,selectionUpd);
+          return true;
+        }
+      }
+      return false;
+    };
+
+    //==========================================================================
+    static bool isTermName(const std::string &fieldName,
+                           const std::string &termName){
+      return (fieldName.compare(0,termName.size(),termName)==0
+              && (fieldName.size()==termName.size()
+                  || fieldName[termName.size()]=='_'));
+    };
+
+    //==========================================================================
+    /*
+      Selects the families that are needed to write a field of calculate's
+      output. Returns false if the field is not one that calculate writes,
+      in which case every family is selected.
+
+      @param field : the address of the field, e.g.
+                     ["metric_data","priceToValueEmpiricalAvg"]
+    */
+    static bool selectField(const std::vector< std::string > &field,
+                            MetricSelection &selectionUpd){
+
+      if(field.size()==0){
+        return true;
+      }
+
+      std::string fieldText;
+      for(auto const &part : field){
+        if(fieldText.length()>0){
+          fieldText.append(":");
+        }
+        fieldText.append(part);
+      }
+      if(std::find(selectionUpd.fields.begin(),selectionUpd.fields.end(),
+                   fieldText) == selectionUpd.fields.end()){
+        selectionUpd.fields.push_back(fieldText);
+      }
+
+      const std::string &section = field[0];
+
+      if(section.compare("data_recency")==0
+        || section.compare("country_data")==0){
+        return true;
+      }
+
+      if(section.compare("annual_milestones")==0){
+        if(field.size() > 1
+          && (field[1].find("dividend") != std::string::npos
+              || field[1].find("freecashflow") != std::string::npos)){
+          selectFamily(FAMILY_DIVIDENDS,selectionUpd);
+        }
+        return true;
+      }
+
+      if(section.compare("metric_data")==0
+        || section.compare("price_to_value_current")==0){
+        if(field.size() < 2){
+          selectAll(selectionUpd);
+          return true;
+        }
+
+        //Pick the family with the longest matching term name, so that
+        //priceToValueEmpirical_ is not mistaken for priceToValue_
+        const MetricFamilyDefinition *match = nullptr;
+        size_t matchLength = 0;
+        for(auto const &definition : getMetricFamilyDefinitions()){
+          for(auto const &termName : definition.termNames){
+            if(termName.size() > matchLength 
+                && isTermName(field[1],termName)){
+              match = &definition;
+              matchLength = termName.size();
+            }
+          }
+        }
+
+        if(match != nullptr){
+          selectFamily(match->id,selectionUpd);
+        }else if(section.compare("price_to_value_current")==0){
+          //The price, market capitalization, enterprise value, and
+          //acquirer's multiple fields are only written along with the
+          //discounted cash flow valuation
+          selectFamily(FAMILY_DCF,selectionUpd);
+        }
+        //Otherwise this is a core metric
+        return true;
+      }
+
+      for(auto const &definition : getMetricFamilyDefinitions()){
+        for(auto const &sectionName : definition.sections){
+          if(section.compare(sectionName)==0){
+            selectFamily(definition.id,selectionUpd);
+            return true;
+          }
+        }
+      }
+
+      selectAll(selectionUpd);
+      return false;
+    };
+
+    //==========================================================================
+    /*
+      Selects the families needed by the calculateData fields of the filter,
+      ranking, and weighting entries of a screen configuration.
+    */
+    static void selectScreenConfigFields(
+                  const nlohmann::ordered_json &screenConfig,
+                  const std::string &screenConfigName,
+                  MetricSelection &selectionUpd){
+
+      std::vector< const nlohmann::ordered_json* > entries;
+      for(auto const &sectionName : {"filter","ranking"}){
+        if(screenConfig.contains(sectionName)){
+          for(auto const &item : screenConfig[sectionName].items()){
+            entries.push_back(&item.value());
+          }
+        }
+      }
+      if(screenConfig.contains("weighting")){
+        entries.push_back(&screenConfig["weighting"]);
+      }
+
+      for(auto const &entry : entries){
+        if(!entry->contains("folder") || !entry->contains("field")){
+          continue;
+        }
+        std::string folder;
+        JsonFunctions::getJsonString((*entry)["folder"],folder);
+        if(folder.compare("calculateData") != 0){
+          continue;
+        }
+        std::vector< std::string > field;
+        for(auto const &fieldEntry : (*entry)["field"]){
+          std::string fieldName;
+          JsonFunctions::getJsonString(fieldEntry,fieldName);
+          field.push_back(fieldName);
+        }
+        bool known = selectField(field,selectionUpd);
+        if(!known){
+          std::cout << "Warning: " << screenConfigName
+                    << " reads the calculateData field "
+                    << selectionUpd.fields.back()
+                    << " which is not associated with any metric. Every "
+                    << "metric will be evaluated." << std::endl;
+        }
+      }
+    };
+
+    //==========================================================================
+    /*
+      Sets the metric selection from the argument of calculate's --metrics
+      option, which can be
+
+      - a comma separated list of family names (e.g. dcf,eps_growth)
+      - a metric requirements file: a json file with a "metrics" array of
+        family names, as written by writeMetricRequirements
+      - a screen configuration file
+      - a folder of screen configuration files
+
+      Returns false if a name or a file could not be read.
+    */
+    static bool loadMetricSelection(const std::string &argument,
+                                    MetricSelection &selectionUpd,
+                                    bool verbose){
+      if(argument.length()==0){
+        selectAll(selectionUpd);
+        return true;
+      }
+
+      clearSelection(selectionUpd);
+
+      std::error_code errorCode;
+      std::vector< std::string > fileNames;
+      if(std::filesystem::is_directory(argument,errorCode)){
+        for(auto const &file :
+              std::filesystem::directory_iterator(argument,errorCode)){
+          if(file.path().extension().string().compare(".json")==0){
+            fileNames.push_back(file.path().string());
+          }
+        }
+        std::sort(fileNames.begin(),fileNames.end());
+      }else if(std::filesystem::is_regular_file(argument,errorCode)){
+        fileNames.push_back(argument);
+      }
+
+      if(fileNames.size()==0){
+        std::stringstream ss(argument);
+        std::string name;
+        while(std::getline(ss,name,',')){
+          if(name.length()==0){
+            continue;
+          }
+          if(!selectFamily(name,selectionUpd)){
+            std::cerr << "Error: " << name << " is not a metric family."
+                      << " Use one of: " << getFamilyNames() << std::endl;
+            return false;
+          }
+        }
+        return true;
+      }
+
+      for(auto const &fileName : fileNames){
+        nlohmann::ordered_json config;
+        bool loaded = JsonFunctions::loadJsonFile(fileName,config,verbose);
+        if(!loaded){
+          std::cerr << "Error: could not read " << fileName << std::endl;
+          return false;
+        }
+        if(config.contains("metrics")){
+          for(auto const &entry : config["metrics"]){
+            std::string name;
+            JsonFunctions::getJsonString(entry,name);
+            if(!selectFamily(name,selectionUpd)){
+              std::cerr << "Error: " << name << " in " << fileName
+                        << " is not a metric family." << std::endl;
+              return false;
+            }
+          }
+        }else{
+          selectScreenConfigFields(config,fileName,selectionUpd);
+        }
+      }
+      return true;
+    };
+
+    //==========================================================================
+    static std::string getFamilyNames(){
+      std::string names(CORE);
+      for(auto const &definition : getMetricFamilyDefinitions()){
+        names.append(",");
+        names.append(definition.name);
+      }
+      return names;
+    };
+
+    //==========================================================================
+    static std::string getSelectedFamilyNames(
+                        const MetricSelection &selection){
+      if(selection.allSelected){
+        return std::string(ALL);
+      }
+      std::string names(CORE);
+      for(auto const &definition : getMetricFamilyDefinitions()){
+        if(selection.isSelected[definition.id]){
+          names.append(",");
+          names.append(definition.name);
+        }
+      }
+      return names;
+    };
+
+    //==========================================================================
+    static void writeMetricRequirements(const std::string &fileName,
+                                        const MetricSelection &selection){
+      nlohmann::ordered_json requirements;
+      std::vector< std::string > names;
+      names.push_back(CORE);
+      for(auto const &definition : getMetricFamilyDefinitions()){
+        if(selection.isSelected[definition.id]){
+          names.push_back(definition.name);
+        }
+      }
+      requirements["metrics"] = names;
+      requirements["fields"]  = selection.fields;
+
+      std::ofstream outputFileStream(fileName,
+          std::ios_base::trunc | std::ios_base::out);
+      outputFileStream << requirements.dump(2);
+      outputFileStream.close();
+    };
+
+};
+
+#endif
@@ -0,0 +1,368 @@
+//SPDX-FileCopyrightText: 2023 Matthew Millard millard.matthew@gmail.com
+//SPDX-License-Identifier: MIT
+
+#ifndef MONTE_CARLO_FUNCTIONS
+#define MONTE_CARLO_FUNCTIONS
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "DataStructures.h"
+#include "HashFunctions.h"
+#include "ParallelFunctions.h"
+
+/*
+  A Monte Carlo version of the discounted free-cash-flow valuation. Rather
+  than evaluating the valuation at a handful of growth rates, the revenue
+  growth, free-cash-flow margin, cost of capital, and terminal growth rate of
+  each path are drawn from the ticker's own history, and the percentiles of
+  the resulting price-to-value ratios are reported.
+
+  The random numbers come from a counter-based generator (Philox4x32-10,
+  Salmon et al. 2011): the numbers of a path are a function of the ticker's
+  stream key and the path index alone. The paths can then be evaluated in any
+  order, on any number of threads, and the result is the same.
+*/
+class MonteCarloFunctions {
+
+  public:
+
+    //==========================================================================
+    struct EmpiricalDistribution{
+      std::vector< double > sortedValues;
+    };
+
+    //==========================================================================
+    /*
+      The empirical distributions that the terms of a path are drawn from
+    */
+    struct DiscountedCashFlowDistributions{
+      EmpiricalDistribution revenueGrowth;
+      EmpiricalDistribution freeCashFlowMargin;
+      EmpiricalDistribution costOfCapital;
+      EmpiricalDistribution terminalGrowth;
+    };
+
+    //==========================================================================
+    /*
+      @param numberOfPaths : the number of paths to evaluate
+      @param numberOfYearsOfGrowth : the number of years that the revenue
+                    grows at the sampled rate before the terminal value
+      @param pathsPerBlock : the number of paths given to a thread at a time
+      @param numberOfThreads : the number of threads used to evaluate the
+                    paths. The result does not depend on this.
+      @param streamKey : the key of the random number stream.
+    */
+    struct MonteCarloSettings{
+      int numberOfPaths;
+      int numberOfYearsOfGrowth;
+      int pathsPerBlock;
+      int numberOfThreads;
+      uint64_t streamKey;
+      MonteCarloSettings():
+        numberOfPaths(0),
+        numberOfYearsOfGrowth(0),
+        pathsPerBlock(4096),
+        numberOfThreads(1),
+        streamKey(0){};
+    };
+
+    //==========================================================================
+    /*
+      @param priceToValue : the price-to-value at each of the Percentiles.
+                  Paths with a present value that is not positive have an
+                  infinite price-to-value.
+      @param numberOfValidPaths : paths with a cost of capital that does not
+                  exceed the terminal growth rate have no terminal value and
+                  are not counted
+      @param probabilityUndervalued : the fraction of valid paths with a
+                  price-to-value less than 1
+      @param probabilityPositiveValue : the fraction of valid paths with a
+                  positive present value
+    */
+    struct MonteCarloValuation{
+      int numberOfPaths;
+      int numberOfValidPaths;
+      std::vector< double > priceToValue;
+      double probabilityUndervalued;
+      double probabilityPositiveValue;
+      MonteCarloValuation():
+        numberOfPaths(0),
+        numberOfValidPaths(0),
+        probabilityUndervalued(std::nan("1")),
+        probabilityPositiveValue(std::nan("1")){};
+    };
+
+    //==========================================================================
+    static constexpr uint32_t PHILOX_M0 = 0xD2511F53;
+    static constexpr uint32_t PHILOX_M1 = 0xCD9E8D57;
+    static constexpr uint32_t PHILOX_W0 = 0x9E3779B9;
+    static constexpr uint32_t PHILOX_W1 = 0xBB67AE85;
+    static constexpr int PHILOX_ROUNDS  = 10;
+
+    //==========================================================================
+    /*
+      Philox4x32-10: maps a 128 bit counter and a 64 bit key to 128 random
+      bits.
+    */
+    static void calcPhilox4x32(const uint32_t counter[4],
+                               uint64_t key,
+                               uint32_t randomBitsUpd[4]){
+
+      uint32_t c0 = counter[0];
+      uint32_t c1 = counter[1];
+      uint32_t c2 = counter[2];
+      uint32_t c3 = counter[3];
+      uint32_t k0 = static_cast<uint32_t>(key);
+      uint32_t k1 = static_cast<uint32_t>(key >> 32);
+
+      for(int i=0; i<PHILOX_ROUNDS; ++i){
+        uint64_t product0 = static_cast<uint64_t>(PHILOX_M0)*c0;
+        uint64_t product1 = static_cast<uint64_t>(PHILOX_M1)*c2;
+        uint32_t hi0 = static_cast<uint32_t>(product0 >> 32);
+        uint32_t lo0 = static_cast<uint32_t>(product0);
+        uint32_t hi1 = static_cast<uint32_t>(product1 >> 32);
+        uint32_t lo1 = static_cast<uint32_t>(product1);
+        c0 = hi1 ^ c1 ^ k0;
+        c1 = lo1;
+        c2 = hi0 ^ c3 ^ k1;
+        c3 = lo0;
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+      }
+      randomBitsUpd[0]=c0;
+      randomBitsUpd[1]=c1;
+      randomBitsUpd[2]=c2;
+      randomBitsUpd[3]=c3;
+    };
+
+    //==========================================================================
+    /*
+      Maps 32 random bits to a uniform number in the open interval (0,1)
+    */
+    static double convertToUniform(uint32_t randomBits){
+      return (static_cast<double>(randomBits) + 0.5)*(1.0/4294967296.0);
+    };
+
+    //==========================================================================
+    /*
+      The stream key of a ticker. Each ticker has its own stream so that the
+      result of a ticker does not depend on which other tickers are evaluated
+    */
+    static uint64_t calcStreamKey(const std::string &name, uint64_t seed){
+      uint64_t hash = HashFunctions::calcStableHash(name);
+      return HashFunctions::appendToHash(hash,
+                reinterpret_cast<const char*>(&seed), sizeof(uint64_t));
+    };
+
+    //==========================================================================
+    /*
+      Copies the finite values of data into a sorted empirical distribution.
+      Returns false if there are none.
+    */
+    static bool createEmpiricalDistribution(const std::vector< double > &data,
+                                      EmpiricalDistribution &distributionUpd){
+      distributionUpd.sortedValues.clear();
+      for(auto const &value : data){
+        if(std::isfinite(value)){
+          distributionUpd.sortedValues.push_back(value);
+        }
+      }
+      std::sort(distributionUpd.sortedValues.begin(),
+                distributionUpd.sortedValues.end());
+      return !distributionUpd.sortedValues.empty();
+    };
+
+    //==========================================================================
+    /*
+      The inverse of the empirical cumulative distribution, interpolated
+      linearly between the sorted values in the same way as the percentiles of
+      NumericalFunctions::extractSummaryStatistics.
+
+      @param u : a uniform number in (0,1)
+    */
+    static double sampleEmpiricalDistribution(
+                    const EmpiricalDistribution &distribution, double u){
+
+      const std::vector< double > &values = distribution.sortedValues;
+      if(values.size() == 1){
+        return values[0];
+      }
+      double idx = u*static_cast<double>(values.size()-1);
+      size_t indexA = static_cast<size_t>(std::floor(idx));
+      if(indexA+1 >= values.size()){
+        return values.back();
+      }
+      double weightB = idx - static_cast<double>(indexA);
+      return values[indexA] + weightB*(values[indexA+1]-values[indexA]);
+    };
+
+    //==========================================================================
+    /*
+      Percentiles of the sorted values. Unlike extractSummaryStatistics, a
+      percentile that falls exactly on a sorted value is not interpolated so
+      that infinite values do not produce nans.
+    */
+    static double calcPercentileOfSortedValues(
+                    const std::vector< double > &sortedValues,
+                    double percentile){
+      double idx = percentile*static_cast<double>(sortedValues.size()-1);
+      size_t indexA = static_cast<size_t>(std::floor(idx));
+      double weightB = idx - static_cast<double>(indexA);
+      if(weightB <= 0. || indexA+1 >= sortedValues.size()){
+        return sortedValues[indexA];
+      }
+      if(std::isinf(sortedValues[indexA+1])){
+        return sortedValues[indexA+1];
+      }
+      return sortedValues[indexA]*(1.0-weightB)
+            + sortedValues[indexA+1]*weightB;
+    };
+
+    //==========================================================================
+    /*
+      Evaluates numberOfPaths discounted free-cash-flow valuations. Each path
+      draws a revenue growth rate (g), a free-cash-flow margin (m), a cost of
+      capital (r) and a terminal growth rate (gt) from the distributions:
+
+        fcf(j)  = revenue*(1+g)^j*m                        j = 1 ... n
+        value   = sum_j fcf(j)/(1+r)^j
+                + fcf(n)*(1+gt)/((r-gt)*(1+r)^n)
+        priceToValue = marketCapitalization / value
+
+      The paths are dealt out to the threads in blocks. Path i always uses
+      the random numbers of counter i and so the priceToValue of every path,
+      and the percentiles, do not depend on the number of threads.
+
+      Returns false if one of the distributions is empty or if there are no
+      valid paths.
+    */
+    static bool calcPriceToValueDistributionUsingDiscountedFreeCashFlow(
+                  double revenue,
+                  double marketCapitalization,
+                  const DiscountedCashFlowDistributions &distributions,
+                  const MonteCarloSettings &settings,
+                  MonteCarloValuation &valuationUpd){
+
+      valuationUpd = MonteCarloValuation();
+      valuationUpd.numberOfPaths = settings.numberOfPaths;
+
+      if(   distributions.revenueGrowth.sortedValues.empty()
+         || distributions.freeCashFlowMargin.sortedValues.empty()
+         || distributions.costOfCapital.sortedValues.empty()
+         || distributions.terminalGrowth.sortedValues.empty()
+         || !std::isfinite(revenue)
+         || !std::isfinite(marketCapitalization)
+         || settings.numberOfPaths < 1
+         || settings.numberOfYearsOfGrowth < 1){
+        return false;
+      }
+
+      size_t numberOfPaths = static_cast<size_t>(settings.numberOfPaths);
+      size_t pathsPerBlock = static_cast<size_t>(
+                              std::max(1,settings.pathsPerBlock));
+      size_t numberOfBlocks = (numberOfPaths + pathsPerBlock - 1)
+                              / pathsPerBlock;
+      int numberOfYears = settings.numberOfYearsOfGrowth;
+
+      std::vector< double > priceToValue(numberOfPaths);
+
+      auto evaluateBlock = [&](size_t indexBlock, int){
+        size_t indexStart = indexBlock*pathsPerBlock;
+        size_t indexEnd   = std::min(indexStart+pathsPerBlock, numberOfPaths);
+
+        for(size_t i=indexStart; i<indexEnd; ++i){
+          uint32_t counter[4] = {static_cast<uint32_t>(i),
+                                 static_cast<uint32_t>(
+                                  static_cast<uint64_t>(i) >> 32),
+                                 0,0};
+          uint32_t randomBits[4];
+          calcPhilox4x32(counter, settings.streamKey, randomBits);
+
+          double growth = sampleEmpiricalDistribution(
+            distributions.revenueGrowth, convertToUniform(randomBits[0]));
+          double margin = sampleEmpiricalDistribution(
+            distributions.freeCashFlowMargin, convertToUniform(randomBits[1]));
+          double costOfCapital = sampleEmpiricalDistribution(
+            distributions.costOfCapital, convertToUniform(randomBits[2]));
+          double terminalGrowth = sampleEmpiricalDistribution(
+            distributions.terminalGrowth, convertToUniform(randomBits[3]));
+
+          if(costOfCapital <= terminalGrowth){
+            priceToValue[i] = std::nan("1");
+            continue;
+          }
+
+          double growthFactor   = 1.0;
+          double discountFactor = 1.0;
+          double fcf            = 0.;
+          double presentValue   = 0.;
+          for(int j=0; j<numberOfYears; ++j){
+            growthFactor   *= (1.0+growth);
+            discountFactor *= (1.0+costOfCapital);
+            fcf = revenue*growthFactor*margin;
+            presentValue += fcf/discountFactor;
+          }
+          presentValue += fcf*(1.0+terminalGrowth)
+                        /((costOfCapital-terminalGrowth)*discountFactor);
+
+          if(presentValue > 0.){
+            priceToValue[i] = marketCapitalization/presentValue;
+          }else{
+            priceToValue[i] = std::numeric_limits<double>::infinity();
+          }
+        }
+      };
+
+      ParallelFunctions::runWorkStealingLoop(numberOfBlocks,
+                                             settings.numberOfThreads,
+                                             false,
+                                             evaluateBlock);
+
+      //The nans of the invalid paths are removed before sorting
+      std::vector< double > validPriceToValue;
+      validPriceToValue.reserve(numberOfPaths);
+      int numberUndervalued = 0;
+      int numberPositive    = 0;
+      for(auto const &value : priceToValue){
+        if(!std::isnan(value)){
+          validPriceToValue.push_back(value);
+          if(!std::isinf(value)){
+            ++numberPositive;
+            if(value < 1.0){
+              ++numberUndervalued;
+            }
+          }
+        }
+      }
+
+      valuationUpd.numberOfValidPaths =
+        static_cast<int>(validPriceToValue.size());
+
+      if(validPriceToValue.empty()){
+        return false;
+      }
+
+      std::sort(validPriceToValue.begin(),validPriceToValue.end());
+
+      for(size_t i = 0; i < PercentileIndices::NUM_PERCENTILES; ++i){
+        valuationUpd.priceToValue.push_back(
+          calcPercentileOfSortedValues(validPriceToValue,Percentiles[i]));
+      }
+
+      double numberValid = static_cast<double>(validPriceToValue.size());
+      valuationUpd.probabilityUndervalued =
+        static_cast<double>(numberUndervalued)/numberValid;
+      valuationUpd.probabilityPositiveValue =
+        static_cast<double>(numberPositive)/numberValid;
+
+      return true;
+    };
+
+};
+
+#endif
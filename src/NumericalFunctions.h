@@ -9,13 +9,17 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <algorithm>
+#include <array>
 #include <sstream>
 #include <numeric>
-#include <boost/math/statistics/linear_regression.hpp>
 
 #include "DataStructures.h"
 #include "DateFunctions.h"
 #include "FinancialAnalysisFunctions.h"
+#include "HashFunctions.h"
+#include "RegressionFunctions.h"
+#include "ProfilingFunctions.h"
+#include "ArenaFunctions.h"
 
 
 
@@ -49,63 +53,131 @@ class NumericalFunctions {
       return idx;
     };  
 
+    //==========================================================================
+    /*
+      Partially orders values[begin,end) so that values[k] holds the value it
+      would have if values were sorted, for every k in the sorted and unique 
+      ranks [rankBegin,rankEnd). Each selection splits the range in two, so 
+      selecting m ranks costs O(n log m) rather than the O(n log n) of a sort.
+    */
+    static void selectOrderStatistics(
+                  std::vector< double > &values,
+                  size_t begin,
+                  size_t end,
+                  const size_t *rankBegin,
+                  const size_t *rankEnd){
+
+      if(rankBegin == rankEnd || begin >= end){
+        return;
+      }
+      const size_t *rankMiddle = rankBegin + (rankEnd-rankBegin)/2;
+      size_t k = *rankMiddle;
+      std::nth_element(values.begin()+begin,
+                       values.begin()+k,
+                       values.begin()+end);
+      selectOrderStatistics(values, begin, k, rankBegin, rankMiddle);
+      selectOrderStatistics(values, k+1, end, rankMiddle+1, rankEnd);
+    };
+
+    //==========================================================================
+    /*
+      Selects the order statistics used by extractSummaryStatistics: the 
+      min, the max, and the two values on either side of each percentile
+      and the median.
+    */
+    static void selectSummaryStatistics(std::vector< double > &values){
+      size_t n = values.size();
+      if(n == 0){
+        return;
+      }
+      std::array< size_t, 2*(PercentileIndices::NUM_PERCENTILES+1)+2 > ranks;
+      size_t numberOfRanks = 0;
+      ranks[numberOfRanks++] = 0;
+      ranks[numberOfRanks++] = n-1;
+      for(size_t i = 0; i <= PercentileIndices::NUM_PERCENTILES; ++i){
+        double p = (i < PercentileIndices::NUM_PERCENTILES) ? Percentiles[i]
+                                                            : 0.5;
+        double idx = p*(n-1);
+        ranks[numberOfRanks++] = static_cast<size_t>(std::floor(idx));
+        ranks[numberOfRanks++] = static_cast<size_t>(std::ceil(idx));
+      }
+      std::sort(ranks.begin(),ranks.begin()+numberOfRanks);
+      numberOfRanks = std::distance(ranks.begin(),
+                        std::unique(ranks.begin(),
+                                    ranks.begin()+numberOfRanks));
+
+      selectOrderStatistics(values, 0, n, 
+                            ranks.data(), ranks.data()+numberOfRanks);
+    };
+
     //==========================================================================
     // Note: These summary statistics are interpolated so that this method
     //     will give a sensible response with 1 data point or many.
+    //
+    // Long vectors are not sorted: only the order statistics that are 
+    // needed are selected (see selectSummaryStatistics). The percentiles
+    // are identical to those of a full sort. The data is copied into 
+    // scratchUpd, which can be reused between calls to avoid an allocation
+    // per call.
     static bool extractSummaryStatistics(const std::vector< double > &data, 
-                      DataStructures::SummaryStatistics &summary){
+                      DataStructures::SummaryStatistics &summary,
+                      std::vector< double > &scratchUpd){
 
       bool validSummaryStatistics = true;                      
 
       if(data.size() > 0){
-        std::vector<double> dataCopy(data);
-        //for(size_t i=0; i<data.size();++i){
-        //  dataCopy.push_back(data[i]);
-        //}
+        scratchUpd.assign(data.begin(),data.end());
+        size_t n = scratchUpd.size();
 
         summary.current = std::nan("-1");
 
-        std::sort(dataCopy.begin(),dataCopy.end());
+        //Short vectors, which are the most common, are quicker to sort
+        const size_t maximumSizeToSort = 256;
+        if(n <= maximumSizeToSort){
+          std::sort(scratchUpd.begin(),scratchUpd.end());
+        }else{
+          selectSummaryStatistics(scratchUpd);
+        }
 
-        summary.min = dataCopy[0];
-        summary.max = dataCopy[dataCopy.size()-1];
+        summary.min = scratchUpd[0];
+        summary.max = scratchUpd[n-1];
         summary.median=0;
         summary.mean = 0;
 
-        if(dataCopy.size() > 1){
+        if(n > 1){
 
           for(size_t i = 0; i < PercentileIndices::NUM_PERCENTILES; ++i){
-            double idx = Percentiles[i]*(dataCopy.size()-1);
+            double idx = Percentiles[i]*(n-1);
             int indexA = std::floor(idx);
             int indexB = std::ceil(idx);
             double weightB = idx - static_cast<double>(indexA);
             double weightA = 1.0-weightB;
-            double valueA = dataCopy[indexA];
-            double valueB = dataCopy[indexB];
+            double valueA = scratchUpd[indexA];
+            double valueB = scratchUpd[indexB];
             double value = valueA*weightA + valueB*weightB;
             summary.percentiles.push_back(value);
           }
 
-          double idx = 0.5*(dataCopy.size()-1);
+          double idx = 0.5*(n-1);
           int indexA = std::floor(idx);
           int indexB = std::ceil(idx);
           double weightB = idx - static_cast<double>(indexA);
           double weightA = 1.0-weightB;
-          double valueA = dataCopy[indexA];
-          double valueB = dataCopy[indexB];
+          double valueA = scratchUpd[indexA];
+          double valueB = scratchUpd[indexB];
           summary.median = valueA*weightA + valueB*weightB;           
 
-          for(size_t i=0; i<dataCopy.size();++i){
-            summary.mean+=dataCopy[i];
+          for(size_t i=0; i<n;++i){
+            summary.mean+=scratchUpd[i];
           }
-          summary.mean = summary.mean / static_cast<double>(dataCopy.size());
+          summary.mean = summary.mean / static_cast<double>(n);
 
         }else{
           for(size_t i = 0; i < PercentileIndices::NUM_PERCENTILES; ++i){
-            summary.percentiles.push_back(dataCopy[0]);
+            summary.percentiles.push_back(scratchUpd[0]);
           }
-          summary.mean = dataCopy[0];
-          summary.median=dataCopy[0];
+          summary.mean = scratchUpd[0];
+          summary.median=scratchUpd[0];
           validSummaryStatistics=false;
         }
       }else{
@@ -114,6 +186,41 @@ class NumericalFunctions {
       return validSummaryStatistics;
     };
     //==========================================================================
+    static bool extractSummaryStatistics(const std::vector< double > &data, 
+                      DataStructures::SummaryStatistics &summary){
+      std::vector< double > scratch;
+      return extractSummaryStatistics(data, summary, scratch);
+    };
+    //==========================================================================
+    /*
+      Evaluates the summary statistics of several columns of data, sharing 
+      one scratch buffer between them.
+
+      @param columns : the data of each column
+      @param summariesUpd : the summary statistics of each column
+      @param validUpd : the return value of extractSummaryStatistics for 
+                        each column
+    */
+    static void extractSummaryStatistics(
+                  const std::vector< const std::vector< double >* > &columns,
+                  std::vector< DataStructures::SummaryStatistics > &summariesUpd,
+                  std::vector< bool > &validUpd){
+
+      size_t maxSize = 0;
+      for(size_t i=0; i<columns.size(); ++i){
+        maxSize = std::max(maxSize, columns[i]->size());
+      }
+      std::vector< double > scratch;
+      scratch.reserve(maxSize);
+
+      summariesUpd.assign(columns.size(), DataStructures::SummaryStatistics());
+      validUpd.assign(columns.size(), false);
+      for(size_t i=0; i<columns.size(); ++i){
+        validUpd[i] = extractSummaryStatistics(*columns[i], summariesUpd[i],
+                                               scratch);
+      }
+    };
+    //==========================================================================
     static void mapToPercentiles(const std::vector<double> &x,  
                          std::vector<double> &xPercentiles){
 
@@ -257,16 +364,12 @@ class NumericalFunctions {
                   const std::vector< double > &y,
                   double minXPeriodOfCyclicalFit,
                   DataStructures::EmpiricalGrowthModel &modelUpd){
+      ProfilingFunctions::ScopedTimer timer("fit_cyclical_model");
 
 
       if(x.size()==y.size() && x.size()>2){
-        std::vector< double > xN(x.size());
-        std::vector< double > yM(y.size());
-
-        //copy over y
-        for(size_t i=0; i<y.size();++i){
-          yM[i]=y[i];
-        }
+        std::pmr::memory_resource *scratch = ArenaFunctions::getResource();
+        ArenaFunctions::ScratchVector< double > xN(x.size(),scratch);
 
         double xSpan = std::abs(x.back()-x.front());
         if(xSpan < 0){
@@ -291,32 +394,51 @@ class NumericalFunctions {
         modelUpd.parameters.resize(2*n);
         int indexParameters=0;
 
+        //The integral of the dot products is evaluated using the trapezoidal
+        //method. Each sample's share of the integral is the same for every
+        //harmonic, and so y is weighted once here.
+        size_t m = xN.size();
+        ArenaFunctions::ScratchVector< double > yWeighted(m,scratch);
+        for(size_t j=0; j<m; ++j){
+          double dxPrevious = (j > 0)   ? (x[j]-x[j-1]) : 0.;
+          double dxNext     = (j+1 < m) ? (x[j+1]-x[j]) : 0.;
+          yWeighted[j] = 0.5*(dxPrevious+dxNext)*y[j];
+        }
+
+        //The basis functions sin(xN*2*pi*w) and cos(xN*2*pi*w) of harmonic
+        //w+1 are evaluated from those of harmonic w using the angle-addition
+        //identities so that sin and cos are only evaluated once per sample.
+        ArenaFunctions::ScratchVector< double > 
+          sin1(m,scratch), cos1(m,scratch), sinW(m,scratch), cosW(m,scratch);
+        for(size_t j=0; j<m; ++j){
+          sin1[j] = std::sin(xN[j]*2.0*M_PI);
+          cos1[j] = std::cos(xN[j]*2.0*M_PI);
+          sinW[j] = sin1[j];
+          cosW[j] = cos1[j];
+        }
+
         for(int i=0; i<n; ++i){
-          double w = static_cast<double>(i+1.0);
-          
-          std::vector< double > yDotSin(x.size());
-          std::vector< double > yDotCos(x.size());
 
-          //Evaluate the dot product between 
+          //Evaluate the integral of the dot product between 
           // y and 
-          // sin(xN*2*pi*2) and 
-          // cos(xN*2*pi*2)
-
-          for(int j=0; j<xN.size();++j){
-            double sinTerm = std::sin(xN[j]*2.0*M_PI*w);
-            double cosTerm = std::cos(xN[j]*2.0*M_PI*w);
-            yDotSin[j] = y[j]*sinTerm;
-            yDotCos[j] = y[j]*cosTerm;
-          }
-
-          //Evaluate the integral of the dot products. Here I'm just going to 
-          //use the trapezoidal method
+          // sin(xN*2*pi*w) and 
+          // cos(xN*2*pi*w)
           double intYDotSin=0;
           double intYDotCos=0;
-          for(int j=1; j<xN.size();++j){
-            double dx = x[j]-x[j-1];
-            intYDotSin += 0.5*(yDotSin[j]+yDotSin[j-1])*dx;
-            intYDotCos += 0.5*(yDotCos[j]+yDotCos[j-1])*dx;
+          if(i == 0){
+            for(size_t j=0; j<m; ++j){
+              intYDotSin += yWeighted[j]*sinW[j];
+              intYDotCos += yWeighted[j]*cosW[j];
+            }
+          }else{
+            for(size_t j=0; j<m; ++j){
+              double sinTerm = sinW[j]*cos1[j] + cosW[j]*sin1[j];
+              double cosTerm = cosW[j]*cos1[j] - sinW[j]*sin1[j];
+              sinW[j] = sinTerm;
+              cosW[j] = cosTerm;
+              intYDotSin += yWeighted[j]*sinTerm;
+              intYDotCos += yWeighted[j]*cosTerm;
+            }
           }
           double cYSin = (2.0/xSpan)*intYDotSin;
           double cYCos = (2.0/xSpan)*intYDotCos;
@@ -326,14 +448,9 @@ class NumericalFunctions {
           modelUpd.parameters[indexParameters] = cYCos;
           ++indexParameters;
 
-          //Update the residual and fitting vector
-          for(int j=0; j<yM.size();++j){
-            double sinTerm = std::sin(xN[j]*2.0*M_PI*w);
-            double cosTerm = std::cos(xN[j]*2.0*M_PI*w);
-            yM[j]         = yM[j] 
-                            - cYSin*sinTerm - cYCos*cosTerm;
-            modelUpd.y[j] = modelUpd.y[j]  
-                            + cYSin*sinTerm + cYCos*cosTerm;
+          //Update the fitting vector
+          for(size_t j=0; j<m; ++j){
+            modelUpd.y[j] += cYSin*sinW[j] + cYCos*cosW[j];
           }
 
         }
@@ -439,6 +556,7 @@ class NumericalFunctions {
                   const std::vector< double > &y,
                   bool forceZeroSlope,
                   DataStructures::EmpiricalGrowthModel &modelUpd){
+      ProfilingFunctions::ScopedTimer timer("fit_linear_growth_model");
 
       if(x.size() == y.size() && x.size() > 2){
         //Remove the bias on x
@@ -468,21 +586,10 @@ class NumericalFunctions {
 
 
         }else{
-          try{
-          auto [y0Fit, dydwFit, r2Fit] = 
-            boost::math::statistics::
-            simple_ordinary_least_squares_with_R_squared(w,y);        
-
-            y0Mdl     = static_cast<double>(y0Fit);
-            dydwMdl   = static_cast<double>(dydwFit);
-            y1Mdl     = y0Mdl + dydwMdl*modelUpd.duration;
-
-          }catch(const std::domain_error& ex){
-            y0Mdl   = std::nan("1");
-            dydwMdl = std::nan("1");
-            y1Mdl   = std::nan("1");
-          }
-
+          //The coefficients are nan if all of the x values are the same
+          double r2Fit;
+          RegressionFunctions::fitStraightLine(w,y,y0Mdl,dydwMdl,r2Fit);
+          y1Mdl     = y0Mdl + dydwMdl*modelUpd.duration;
         }
             
 
@@ -602,6 +709,7 @@ class NumericalFunctions {
                   const std::vector< double > &y,
                   double maxProportionOfNegativeValues,
                   DataStructures::EmpiricalGrowthModel &modelUpd){
+      ProfilingFunctions::ScopedTimer timer("fit_exponential_growth_model");
 
       //Remove the bias on x
       if(x.size()==y.size() && x.size() > 2){
@@ -615,8 +723,8 @@ class NumericalFunctions {
         }      
 
         //Go through and count the y entries < 1
-        std::vector< double > z;
-        z.resize(y.size());
+        ArenaFunctions::ScratchVector< double > z(y.size(),
+                                                  ArenaFunctions::getResource());
         
         modelUpd.validFitting=true;
         modelUpd.outlierCount=0;
@@ -651,9 +759,8 @@ class NumericalFunctions {
           } 
 
           //Fit with all of the data
-          auto [z0Mdl, dzdwMdl, logZR2] = 
-            boost::math::statistics::
-              simple_ordinary_least_squares_with_R_squared(w,logZ);
+          double z0Mdl, dzdwMdl, logZR2;
+          RegressionFunctions::fitStraightLine(w,logZ,z0Mdl,dzdwMdl,logZR2);
               
           double growth       = std::exp( dzdwMdl )-1.0;
           double y0Mdl        = std::exp( z0Mdl );
@@ -700,30 +807,358 @@ class NumericalFunctions {
       }
 
     };
+    //==========================================================================
+    /*
+      The validity and R2 of the linear and exponential models of a window
+      of data, which is all that is needed to choose the baseline of the
+      model that is fitted to the window. These are the same values that
+      fitLinearGrowthModel and fitExponentialGrowthModel would produce.
+    */
+    struct EmpiricalGrowthModelCandidates{
+      bool linearValid;
+      double linearR2;
+      bool exponentialValid;
+      double exponentialR2;
+      EmpiricalGrowthModelCandidates():
+        linearValid(false),
+        linearR2(std::nan("1")),
+        exponentialValid(false),
+        exponentialR2(std::nan("1")){};
+    };
+    //==========================================================================
+    /*
+      Evaluates the linear and exponential model candidates of every window
+      of (x,y) without copying the windows. The straight lines through y and
+      log(y) of every window are fitted in one pass using
+      RegressionFunctions::fitStraightLinesOverWindows. Only the R2 of the
+      exponential model, which is evaluated in the units of y, needs a pass
+      over the samples of each window.
+
+      As in fitExponentialGrowthModel, y values less than 1 are treated as
+      outliers and are set to 1 before the logarithm is taken.
+    */
+    static void calcEmpiricalGrowthModelCandidates(
+                  const std::vector< double > &x,
+                  const std::vector< double > &y,
+                  const std::vector< RegressionFunctions::IndexRange > &windows,
+                  double maxProportionOfNegativeValues,
+                  bool forceZeroSlope,
+                  std::vector< EmpiricalGrowthModelCandidates > &candidatesUpd){
+      ProfilingFunctions::ScopedTimer timer("calc_growth_model_candidates");
+
+      if(x.size() != y.size()){
+        std::cerr << "Error: calcEmpiricalGrowthModelCandidates x and y "
+                  << "must have the same length" << std::endl;
+        std::abort();
+      }
+
+      std::vector< double > logZ(y.size());
+      ArenaFunctions::ScratchVector< size_t > outlierCount(y.size()+1,0,
+                                                ArenaFunctions::getResource());
+      for(size_t i=0; i<y.size(); ++i){
+        bool outlier = (y[i] < 1.0);
+        logZ[i] = outlier ? 0. : std::log(y[i]);
+        outlierCount[i+1] = outlierCount[i] + (outlier ? 1 : 0);
+      }
+
+      std::vector< std::vector< RegressionFunctions::StraightLineFit > > fits;
+      RegressionFunctions::fitStraightLinesOverWindows(
+        x, {&y, &logZ}, windows, fits);
+
+      candidatesUpd.clear();
+      candidatesUpd.resize(windows.size());
+
+      for(size_t k=0; k<windows.size(); ++k){
+        const RegressionFunctions::StraightLineFit &linearFit = fits[0][k];
+        const RegressionFunctions::StraightLineFit &logFit    = fits[1][k];
+        EmpiricalGrowthModelCandidates &candidates = candidatesUpd[k];
+
+        size_t n = windows[k].end - windows[k].begin;
+        if(n <= 2){
+          continue;
+        }
+
+        candidates.linearValid = true;
+        if(forceZeroSlope){
+          candidates.linearR2 = 1.0 - linearFit.totalSumOfSquares
+                                    / linearFit.totalSumOfSquares;
+        }else{
+          candidates.linearR2 = linearFit.r2;
+        }
+
+        double invalidEntryProportion =
+            static_cast<double>(outlierCount[windows[k].end]
+                               -outlierCount[windows[k].begin])
+          / static_cast<double>(n);
+
+        if(invalidEntryProportion <= maxProportionOfNegativeValues){
+          double residualSumOfSquares = 0.;
+          for(size_t i=windows[k].begin; i<windows[k].end; ++i){
+            double yMdl = std::exp(logFit.yMean
+                                  +logFit.dydx*(x[i]-logFit.xMean));
+            double t0 = y[i]-yMdl;
+            residualSumOfSquares += t0*t0;
+          }
+          candidates.exponentialValid = true;
+          candidates.exponentialR2 =
+            1.0 - residualSumOfSquares/linearFit.totalSumOfSquares;
+        }
+      }
+    };
+    //==========================================================================
+    static void calcEmpiricalGrowthModelCandidates(
+                  const std::vector< double > &x,
+                  const std::vector< double > &y,
+                  double maxProportionOfNegativeValues,
+                  bool forceZeroSlope,
+                  EmpiricalGrowthModelCandidates &candidatesUpd){
+
+      std::vector< EmpiricalGrowthModelCandidates > candidates;
+      calcEmpiricalGrowthModelCandidates(x, y,
+        {RegressionFunctions::IndexRange(0,x.size())},
+        maxProportionOfNegativeValues, forceZeroSlope, candidates);
+      candidatesUpd = candidates[0];
+    };
+    //==========================================================================
+    /*
+      A key that identifies a model fit: the name of the fitting method, the
+      data, and the settings that affect the fit.
+    */
+    static uint64_t calcEmpiricalGrowthModelKey(
+                  const char* fittingMethod,
+                  const std::vector< double > &x,
+                  const std::vector< double > &y,
+                  const DataStructures::EmpiricalGrowthSettings &settings,
+                  bool forceZeroSlopeOnLinearModel)
+    {
+      uint64_t key = HashFunctions::calcStableHash(fittingMethod);
+      key = HashFunctions::appendToHash(key, x);
+      key = HashFunctions::appendToHash(key, y);
+      key = HashFunctions::appendToHash(key, 
+              static_cast<double>(settings.typeOfEmpiricalModel));
+      key = HashFunctions::appendToHash(key, 
+              settings.maxOutlierProportionInEmpiricalModel);
+      key = HashFunctions::appendToHash(key, settings.minCycleDurationInYears);
+      key = HashFunctions::appendToHash(key, 
+              settings.exponentialModelR2Preference);
+      key = HashFunctions::appendToHash(key, 
+              forceZeroSlopeOnLinearModel ? 1.0 : 0.0);
+      return key;
+    };
+
+    //==========================================================================
+    static bool getCachedEmpiricalGrowthModel(
+                  DataStructures::EmpiricalGrowthModelCache &modelCache,
+                  uint64_t key,
+                  bool &validFittingUpd,
+                  DataStructures::EmpiricalGrowthModel &modelUpd)
+    {
+      auto fit = modelCache.fits.find(key);
+      if(fit == modelCache.fits.end()){
+        fit = modelCache.previousFits.find(key);
+        if(fit == modelCache.previousFits.end()){
+          return false;
+        }
+        modelCache.fits[key] = fit->second;
+        ++modelCache.numberOfReusedFits;
+      }
+      validFittingUpd = fit->second.validFitting;
+      modelUpd        = fit->second.model;
+      return true;
+    };
+
+    //==========================================================================
+    static void storeEmpiricalGrowthModel(
+                  DataStructures::EmpiricalGrowthModelCache &modelCache,
+                  uint64_t key,
+                  bool validFitting,
+                  const DataStructures::EmpiricalGrowthModel &model)
+    {
+      DataStructures::EmpiricalGrowthModelCacheEntry entry;
+      entry.validFitting = validFitting;
+      entry.model        = model;
+      modelCache.fits[key] = entry;
+      ++modelCache.numberOfNewFits;
+    };
+
+    //==========================================================================
+    // Doubles are written as numbers, except for nan and inf which json
+    // cannot represent, so that a model is read back exactly as it was fitted
+    //==========================================================================
+    static nlohmann::ordered_json convertDoubleToJson(double value){
+      if(std::isnan(value)){
+        return "nan";
+      }
+      if(std::isinf(value)){
+        return (value > 0 ? "inf" : "-inf");
+      }
+      return value;
+    };
+
+    //==========================================================================
+    static double convertJsonToDouble(const nlohmann::ordered_json &value){
+      if(value.is_string()){
+        std::string text = value.get<std::string>();
+        if(text.compare("inf")==0){
+          return std::numeric_limits<double>::infinity();
+        }
+        if(text.compare("-inf")==0){
+          return -std::numeric_limits<double>::infinity();
+        }
+        return std::nan("1");
+      }
+      return value.get<double>();
+    };
+
+    //==========================================================================
+    static nlohmann::ordered_json convertVectorToJson(
+                                    const std::vector< double > &values){
+      nlohmann::ordered_json valuesJson = nlohmann::ordered_json::array();
+      for(auto const &value : values){
+        valuesJson.push_back(convertDoubleToJson(value));
+      }
+      return valuesJson;
+    };
+
+    //==========================================================================
+    static void convertJsonToVector(const nlohmann::ordered_json &valuesJson,
+                                    std::vector< double > &valuesUpd){
+      valuesUpd.clear();
+      for(auto const &value : valuesJson){
+        valuesUpd.push_back(convertJsonToDouble(value));
+      }
+    };
+
+    //==========================================================================
+    static void convertEmpiricalGrowthModelToJson(
+                  const DataStructures::EmpiricalGrowthModel &model,
+                  nlohmann::ordered_json &modelJsonUpd)
+    {
+      modelJsonUpd = nlohmann::ordered_json::object();
+      modelJsonUpd["modelType"]    = model.modelType;
+      modelJsonUpd["duration"]     = convertDoubleToJson(model.duration);
+      modelJsonUpd["annualGrowthRateOfTrendline"] = 
+        convertDoubleToJson(model.annualGrowthRateOfTrendline);
+      modelJsonUpd["r2"]           = convertDoubleToJson(model.r2);
+      modelJsonUpd["r2Trendline"]  = convertDoubleToJson(model.r2Trendline);
+      modelJsonUpd["r2Cyclic"]     = convertDoubleToJson(model.r2Cyclic);
+      modelJsonUpd["validFitting"] = model.validFitting;
+      modelJsonUpd["outlierCount"] = model.outlierCount;
+      modelJsonUpd["parameters"]   = convertVectorToJson(model.parameters);
+      modelJsonUpd["x"]            = convertVectorToJson(model.x);
+      modelJsonUpd["y"]            = convertVectorToJson(model.y);
+      modelJsonUpd["yTrendline"]   = convertVectorToJson(model.yTrendline);
+      modelJsonUpd["yCyclic"]      = convertVectorToJson(model.yCyclic);
+      modelJsonUpd["yCyclicData"]  = convertVectorToJson(model.yCyclicData);
+      modelJsonUpd["yCyclicNorm"]  = convertVectorToJson(model.yCyclicNorm);
+      modelJsonUpd["yCyclicNormData"] = 
+        convertVectorToJson(model.yCyclicNormData);
+      modelJsonUpd["yCyclicNormDataPercentiles"] = 
+        convertVectorToJson(model.yCyclicNormDataPercentiles);
+    };
+
+    //==========================================================================
+    static void convertJsonToEmpiricalGrowthModel(
+                  const nlohmann::ordered_json &modelJson,
+                  DataStructures::EmpiricalGrowthModel &modelUpd)
+    {
+      modelUpd = DataStructures::EmpiricalGrowthModel();
+      modelUpd.modelType    = modelJson.at("modelType").get<int>();
+      modelUpd.duration     = convertJsonToDouble(modelJson.at("duration"));
+      modelUpd.annualGrowthRateOfTrendline = 
+        convertJsonToDouble(modelJson.at("annualGrowthRateOfTrendline"));
+      modelUpd.r2           = convertJsonToDouble(modelJson.at("r2"));
+      modelUpd.r2Trendline  = convertJsonToDouble(modelJson.at("r2Trendline"));
+      modelUpd.r2Cyclic     = convertJsonToDouble(modelJson.at("r2Cyclic"));
+      modelUpd.validFitting = modelJson.at("validFitting").get<bool>();
+      modelUpd.outlierCount = modelJson.at("outlierCount").get<int>();
+      convertJsonToVector(modelJson.at("parameters"),  modelUpd.parameters);
+      convertJsonToVector(modelJson.at("x"),           modelUpd.x);
+      convertJsonToVector(modelJson.at("y"),           modelUpd.y);
+      convertJsonToVector(modelJson.at("yTrendline"),  modelUpd.yTrendline);
+      convertJsonToVector(modelJson.at("yCyclic"),     modelUpd.yCyclic);
+      convertJsonToVector(modelJson.at("yCyclicData"), modelUpd.yCyclicData);
+      convertJsonToVector(modelJson.at("yCyclicNorm"), modelUpd.yCyclicNorm);
+      convertJsonToVector(modelJson.at("yCyclicNormData"),
+                          modelUpd.yCyclicNormData);
+      convertJsonToVector(modelJson.at("yCyclicNormDataPercentiles"),
+                          modelUpd.yCyclicNormDataPercentiles);
+    };
+
+    //==========================================================================
+    // Writes the fits used in this run, so that fits which are no longer
+    // needed are dropped.
+    //==========================================================================
+    static void convertEmpiricalGrowthModelCacheToJson(
+                  const DataStructures::EmpiricalGrowthModelCache &modelCache,
+                  nlohmann::ordered_json &cacheJsonUpd)
+    {
+      cacheJsonUpd = nlohmann::ordered_json::object();
+      for(auto const &fit : modelCache.fits){
+        nlohmann::ordered_json entryJson;
+        entryJson["validFitting"] = fit.second.validFitting;
+        convertEmpiricalGrowthModelToJson(fit.second.model,entryJson["model"]);
+        cacheJsonUpd[HashFunctions::convertHashToString(fit.first)] = entryJson;
+      }
+    };
+
+    //==========================================================================
+    static void convertJsonToEmpiricalGrowthModelCache(
+                  const nlohmann::ordered_json &cacheJson,
+                  DataStructures::EmpiricalGrowthModelCache &modelCacheUpd)
+    {
+      modelCacheUpd.previousFits.clear();
+      for(auto const &fit : cacheJson.items()){
+        uint64_t key = std::stoull(fit.key(),nullptr,16);
+        DataStructures::EmpiricalGrowthModelCacheEntry entry;
+        entry.validFitting = fit.value().at("validFitting").get<bool>();
+        convertJsonToEmpiricalGrowthModel(fit.value().at("model"),entry.model);
+        modelCacheUpd.previousFits[key] = entry;
+      }
+    };
+
     //==========================================================================    
     static void fitToModelWithLowestR2Error(
                   const std::vector< double > &x,
                   const std::vector< double > &y,
                   const DataStructures::EmpiricalGrowthSettings &settings,
-                  DataStructures::EmpiricalGrowthModel &modelUpd)
+                  DataStructures::EmpiricalGrowthModel &modelUpd,
+                  const EmpiricalGrowthModelCandidates *candidates=nullptr)
     {
+      ProfilingFunctions::ScopedTimer timer("fit_model_with_lowest_r2_error");
+
+      //If a model cache is in use modelUpd must be default constructed
+      uint64_t modelKey = 0;
+      if(settings.modelCache != nullptr){
+        modelKey = calcEmpiricalGrowthModelKey("fitToModelWithLowestR2Error",
+                      x, y, settings, settings.forceZeroSlopeOnLinearModel);
+        bool validFitting = false;
+        if(getCachedEmpiricalGrowthModel(*settings.modelCache, modelKey,
+                                          validFitting, modelUpd)){
+          return;
+        }
+      }
 
       if(    x.size() >= 2 && (x.size()==y.size())){
 
         bool validFitting = false;
           
         if(settings.typeOfEmpiricalModel==-1){
-          DataStructures::EmpiricalGrowthModel exponentialModel, linearModel;
-
-          fitExponentialGrowthModel(x,y,
-                        settings.maxOutlierProportionInEmpiricalModel,
-                        exponentialModel);
-
-          fitLinearGrowthModel(x,y,settings.forceZeroSlopeOnLinearModel,
-                                linearModel);
+          //The candidates can be evaluated ahead of time for many windows
+          //of data at once using calcEmpiricalGrowthModelCandidates
+          EmpiricalGrowthModelCandidates windowCandidates;
+          if(candidates != nullptr){
+            windowCandidates = *candidates;
+          }else{
+            calcEmpiricalGrowthModelCandidates(x,y,
+                          settings.maxOutlierProportionInEmpiricalModel,
+                          settings.forceZeroSlopeOnLinearModel,
+                          windowCandidates);
+          }
 
           validFitting = 
-              (exponentialModel.validFitting || linearModel.validFitting);
+              (windowCandidates.exponentialValid 
+            || windowCandidates.linearValid);
 
           int modelType = -1;
           int linearModelType = 
@@ -734,19 +1169,20 @@ class NumericalFunctions {
 
           //A linear model is used unless the exponential model
           //is both valid and has a higher R2
-          if(exponentialModel.validFitting==true){
+          if(windowCandidates.exponentialValid){
             double exponentialModelR2Upd = 
-              exponentialModel.r2 + settings.exponentialModelR2Preference;
-            if(exponentialModelR2Upd > linearModel.r2 
-                || !linearModel.validFitting){
+              windowCandidates.exponentialR2 
+              + settings.exponentialModelR2Preference;
+            if(exponentialModelR2Upd > windowCandidates.linearR2 
+                || !windowCandidates.linearValid){
               modelType=static_cast<int>(
                   EmpiricalGrowthModelTypes::ExponentialModel);
-            }else if(exponentialModelR2Upd < linearModel.r2 
-                  && linearModel.validFitting){
+            }else if(exponentialModelR2Upd < windowCandidates.linearR2 
+                  && windowCandidates.linearValid){
               modelType = 
                 static_cast<int>(EmpiricalGrowthModelTypes::LinearModel);
             }
-          }else if(linearModel.validFitting){
+          }else if(windowCandidates.linearValid){
             modelType = 
               static_cast<int>(EmpiricalGrowthModelTypes::LinearModel);
           }
@@ -816,6 +1252,11 @@ class NumericalFunctions {
           };
         }      
       }
+
+      if(settings.modelCache != nullptr){
+        storeEmpiricalGrowthModel(*settings.modelCache, modelKey,
+                                  modelUpd.validFitting, modelUpd);
+      }
     };
 
 
@@ -920,7 +1361,6 @@ class NumericalFunctions {
         double stockPrice = 
           FinancialAnalysisFunctions::getHistoricalDataInFundamentalUnit(
             historicalData[indexHistoricalData]["adjusted_close"],
-            fundamentalData,
             setNansToMissingValue);
             
         //double stockPrice = 
@@ -1262,7 +1702,6 @@ class NumericalFunctions {
             adjustedClosePrice = 
               FinancialAnalysisFunctions::getHistoricalDataInFundamentalUnit(
                 historicalData[ indexHistoricalData ]["adjusted_close"],
-                fundamentalData,
                 setNansToMissingValue);
 
             //adjustedClosePrice = JsonFunctions::getJsonFloat(
@@ -1272,7 +1711,6 @@ class NumericalFunctions {
             closePrice = 
               FinancialAnalysisFunctions::getHistoricalDataInFundamentalUnit(
                 historicalData[ indexHistoricalData ]["close"],
-                fundamentalData,
                 setNansToMissingValue);
 
             //closePrice = JsonFunctions::getJsonFloat(
@@ -1604,6 +2042,7 @@ class NumericalFunctions {
                   DataStructures::MetricGrowthDataSet &metricGrowthRateUpd,
                   const DataStructures::EmpiricalGrowthSettings &settings)
     {   
+      ProfilingFunctions::ScopedTimer timer("extract_time_series_growth_rates");
       if(dateV.size()!=dateNumV.size() || dateV.size()!=valueV.size()){
         std::cout << "Error : dateV, dateNumV, and valueV must all have the "
                   << "same size."
@@ -1624,32 +2063,21 @@ class NumericalFunctions {
         settings.exponentialModelR2Preference;  
                                   
       //
-      // Extract the growth values for an interval of length 
-      // growthIntervalInYears
+      // Find the sub interval of length growthIntervalInYears that starts 
+      // at each date. Each interval spans a contiguous range of indices
       //
+      std::vector< RegressionFunctions::IndexRange > windows;
+
       int indexDate = -1;
-      //validDate=true;
       int indexDateMax = static_cast<int>(dateNumV.size());
 
-      //(indexDate+1) < indexLastCommonDate 
-
-      while(     indexDate < indexDateMax 
+      while(     (indexDate+1) < indexDateMax 
               && dateNumV.size() >= 2
               && ((settings.calcOneGrowthRateForAllData && indexDate == -1) 
                     || !settings.calcOneGrowthRateForAllData)){
 
         ++indexDate;
 
-
-        std::vector< double > dateSubV; //date sub vector
-        std::vector< double > valueSubV; //after-tax operating income sub vector
-
-        //
-        // Extract the sub interval
-        //
-        dateSubV.push_back(dateNumV[indexDate]);
-        valueSubV.push_back(valueV[indexDate]);
-
         int indexDateStart=indexDate+1;
         bool foundStartDate=false;
 
@@ -1661,23 +2089,53 @@ class NumericalFunctions {
         while(  !foundStartDate 
               && indexDateStart < indexDateMax){
             
-
-
-            double timeSpan      = dateSubV[0] - dateNumV[indexDateStart]; 
+            double timeSpan      = dateNumV[indexDate] 
+                                 - dateNumV[indexDateStart]; 
             double timeSpanError = timeSpan-growthIntervalInYears;
 
             if( ((timeSpanError < maxYearError) 
                   && !settings.calcOneGrowthRateForAllData) 
               || (settings.calcOneGrowthRateForAllData 
                   && timeSpan <= settings.growthIntervalInYears) ){
-              dateSubV.push_back(dateNumV[indexDateStart]);
-              valueSubV.push_back(valueV[indexDateStart]);
+              ++indexDateStart;
             }else{
               foundStartDate = true;
             }       
-            ++indexDateStart;
         }
 
+        if(   (indexDateStart-indexDate) >= 2
+           && (foundStartDate || settings.calcOneGrowthRateForAllData)){
+          windows.push_back(RegressionFunctions::IndexRange(
+                              static_cast<size_t>(indexDate),
+                              static_cast<size_t>(indexDateStart)));
+        }
+      }
+
+      //
+      // The candidate linear and exponential models of every interval are 
+      // evaluated in one pass using running sums
+      //
+      std::vector< EmpiricalGrowthModelCandidates > candidates;
+      if(settings.typeOfEmpiricalModel==-1){
+        calcEmpiricalGrowthModelCandidates(dateNumV, valueV, windows,
+          settings.maxOutlierProportionInEmpiricalModel,
+          forceZeroSlopeOnLinearModel, candidates);
+      }
+
+      for(size_t indexWindow=0; indexWindow < windows.size(); ++indexWindow){
+
+        indexDate = static_cast<int>(windows[indexWindow].begin);
+
+        //
+        // Extract the sub interval
+        //
+        std::vector< double > dateSubV( 
+          dateNumV.begin()+windows[indexWindow].begin,
+          dateNumV.begin()+windows[indexWindow].end);
+        std::vector< double > valueSubV(
+          valueV.begin()+windows[indexWindow].begin,
+          valueV.begin()+windows[indexWindow].end);
+
         //
         // Fit each of the models to the data and choose the most appropriate
         // model using the following criteria
@@ -1688,60 +2146,62 @@ class NumericalFunctions {
         //  Exponential + cyclical model, if R2 exp.+cyclical >= exp. + 0.10
         //
 
-        if(    dateSubV.size() >= 2 
-           && (dateSubV.size()==valueSubV.size())
-           && (foundStartDate || settings.calcOneGrowthRateForAllData)){
-        
-          //Order dateSubV so that it proceeds from the earliest date to the 
-          //latest date
-          if(dateSubV.front() > dateSubV.back()){
-            std::reverse(dateSubV.begin(),dateSubV.end());
-            std::reverse(valueSubV.begin(),valueSubV.end());
-          }
-
-          DataStructures::EmpiricalGrowthModel empModel;
-          bool validFitting = false;
+        //Order dateSubV so that it proceeds from the earliest date to the 
+        //latest date
+        if(dateSubV.front() > dateSubV.back()){
+          std::reverse(dateSubV.begin(),dateSubV.end());
+          std::reverse(valueSubV.begin(),valueSubV.end());
+        }
 
-          if(settings.typeOfEmpiricalModel==-1){
-            DataStructures::EmpiricalGrowthModel exponentialModel, linearModel;
+        DataStructures::EmpiricalGrowthModel empModel;
+        bool validFitting = false;
 
-            fitExponentialGrowthModel(dateSubV,valueSubV,
-                        settings.maxOutlierProportionInEmpiricalModel,
-                        exponentialModel);
+        uint64_t modelKey = 0;
+        bool modelFound = false;
+        if(settings.modelCache != nullptr){
+          modelKey = calcEmpiricalGrowthModelKey(
+                        "extractTimeSeriesGrowthRates", dateSubV, valueSubV,
+                        settings, forceZeroSlopeOnLinearModel);
+          modelFound = getCachedEmpiricalGrowthModel(*settings.modelCache,
+                          modelKey, validFitting, empModel);
+        }
 
-            fitLinearGrowthModel(dateSubV,valueSubV,forceZeroSlopeOnLinearModel,
-                                linearModel);
+        if(!modelFound){
+          if(settings.typeOfEmpiricalModel==-1){
+            const EmpiricalGrowthModelCandidates &windowCandidates = 
+              candidates[indexWindow];
 
             validFitting = 
-              (exponentialModel.validFitting || linearModel.validFitting);
+              (windowCandidates.exponentialValid 
+            || windowCandidates.linearValid);
 
             int modelType = -1;
             int linearModelType = 
               static_cast<int>(EmpiricalGrowthModelTypes::LinearModel);
             int exponentialModelType = 
               static_cast<int>(EmpiricalGrowthModelTypes::ExponentialModel);
-            
+          
 
             //A linear model is used unless the exponential model
             //is both valid and has a higher R2
-            if(exponentialModel.validFitting==true){
-              
+            if(windowCandidates.exponentialValid){
+            
               modelType=static_cast<int>(
                           EmpiricalGrowthModelTypes::ExponentialModel);              
-              
+            
               double exponentialModelR2Upd = 
-                exponentialModel.r2
+                windowCandidates.exponentialR2
                 + preferenceForAnExponentialModel;
-              if(exponentialModelR2Upd > linearModel.r2 
-                  || !linearModel.validFitting){
+              if(exponentialModelR2Upd > windowCandidates.linearR2 
+                  || !windowCandidates.linearValid){
                 modelType=static_cast<int>(
                     EmpiricalGrowthModelTypes::ExponentialModel);
               }else{
                 modelType = 
                   static_cast<int>(EmpiricalGrowthModelTypes::LinearModel);  
               }
-              
-            }else if(linearModel.validFitting){
+            
+            }else if(windowCandidates.linearValid){
               modelType = 
                 static_cast<int>(EmpiricalGrowthModelTypes::LinearModel);
             }
@@ -1811,22 +2271,27 @@ class NumericalFunctions {
             };
           }
 
-          if(validFitting){
+          if(settings.modelCache != nullptr){
+            storeEmpiricalGrowthModel(*settings.modelCache, modelKey,
+                                      validFitting, empModel);
+          }
+        }
 
-            //
-            // Store the model results
-            //
-            if(valueSubV.size() > 0 && dateSubV.size() > 0){
-
-              metricGrowthRateUpd.dates.push_back(dateV[indexDate]);              
-              metricGrowthRateUpd.datesNumerical.push_back(dateNumV[indexDate]);
-              metricGrowthRateUpd.metricGrowthRate.push_back(
-                empModel.annualGrowthRateOfTrendline);
-              metricGrowthRateUpd.metricValue.push_back(valueSubV.back());
-              metricGrowthRateUpd.model.push_back(empModel);
-            } 
+        if(validFitting){
+
+          //
+          // Store the model results
+          //
+          if(valueSubV.size() > 0 && dateSubV.size() > 0){
+
+            metricGrowthRateUpd.dates.push_back(dateV[indexDate]);              
+            metricGrowthRateUpd.datesNumerical.push_back(dateNumV[indexDate]);
+            metricGrowthRateUpd.metricGrowthRate.push_back(
+              empModel.annualGrowthRateOfTrendline);
+            metricGrowthRateUpd.metricValue.push_back(valueSubV.back());
+            metricGrowthRateUpd.model.push_back(empModel);
           } 
-        }
+        } 
       }
     };
 
@@ -1841,6 +2306,7 @@ class NumericalFunctions {
           bool quarterlyTTMAnalysis,
           const DataStructures::EmpiricalGrowthSettings &settings)
     {
+      ProfilingFunctions::ScopedTimer timer("extract_atoi_growth_rates");
       //    bool approximateReinvestmentRate,
       //    int maxDayErrorTTM,
       //    double growthIntervalInYears,
@@ -1935,11 +2401,18 @@ class NumericalFunctions {
 
 
         if(validDateSet){
-          double operatingIncome = 
-            FinancialAnalysisFunctions::
-              sumFundamentalDataOverDates(fundamentalData,FIN,IS,
-                                          timePeriod.c_str(),dateSetTTM,
-                                          "operatingIncome",true);
+          FinancialAnalysisFunctions::MetricGraph metricGraph;
+          FinancialAnalysisFunctions::resetMetricGraph(fundamentalData,
+                                                      nullptr,
+                                                      dateSetTTM,
+                                                      &previousDateSet,
+                                                      timePeriod.c_str(),
+                                                      nullptr,
+                                                      true,
+                                                      metricGraph);
+
+          double operatingIncome = FinancialAnalysisFunctions::getMetric(
+              metricGraph, FinancialAnalysisFunctions::METRIC_OPERATING_INCOME);
           
           if(JsonFunctions::isJsonFloatValid(operatingIncome)){
           
@@ -1953,8 +2426,7 @@ class NumericalFunctions {
 
             bool appendTermRecord=false;
             bool setNansToMissingValue=true;
-            std::vector< std::string > termNames;
-            std::vector< double > termValues;
+            DataStructures::TermRecord termRecord;
 
             std::string parentName("");
 
@@ -1970,8 +2442,7 @@ class NumericalFunctions {
                                             parentName,
                                             setNansToMissingValue,
                                             ignoreDepreciation,
-                                            termNames,
-                                            termValues);            
+                                            termRecord);            
 
             ignoreDepreciation=false;
             double netCapitalExpenditures = 
@@ -1984,8 +2455,7 @@ class NumericalFunctions {
                                           parentName,
                                           setNansToMissingValue,
                                           ignoreDepreciation,
-                                          termNames,
-                                          termValues);
+                                          termRecord);
 
             double changeInNonCashWorkingCapital = 
               FinancialAnalysisFunctions::
@@ -1996,8 +2466,7 @@ class NumericalFunctions {
                                                     appendTermRecord,
                                                     parentName,
                                                     setNansToMissingValue,
-                                                    termNames,
-                                                    termValues); 
+                                                    termRecord); 
                                                                 
             double rrEntry = (netCapitalExpenditures
                         +changeInNonCashWorkingCapital)
@@ -2005,16 +2474,11 @@ class NumericalFunctions {
             */
 
             double rrEntry = FinancialAnalysisFunctions::
-                              calcReinvestmentRate( fundamentalData,
-                                                    dateSetTTM,
-                                                    previousDateSet,
-                                                    timePeriod.c_str(),
+                              calcReinvestmentRate( metricGraph,
                                                     taxRate,
                                                     appendTermRecord,
                                                     parentName,
-                                                    setNansToMissingValue,
-                                                    termNames,
-                                                    termValues);
+                                                    termRecord);
             
             FinancialAnalysisFunctions::getDebtInfo(fundamentalData,
                                                     timePeriod.c_str(),
@@ -2022,8 +2486,7 @@ class NumericalFunctions {
                                                     debtInfo,
                                                     appendTermRecord,
                                                     parentName,
-                                                    termNames,
-                                                    termValues,
+                                                    termRecord,
                                                     setNansToMissingValue);                                                  
 
 
@@ -2037,8 +2500,7 @@ class NumericalFunctions {
                                   appendTermRecord,
                                   parentName,
                                   setNansToMissingValue,
-                                  termNames,
-                                  termValues);                                                    
+                                  termRecord);                                                    
 
             bool dateEntryValid = JsonFunctions::isJsonFloatValid(dateEntry);
             bool rrEntryValid   = JsonFunctions::isJsonFloatValid(rrEntry);
@@ -2059,58 +2521,83 @@ class NumericalFunctions {
       }
       
       //
-      //Extract the growth values for an interval with 
-      //growthIntervalInYears in it
+      //Find the interval with growthIntervalInYears in it that starts at 
+      //each date. Each interval spans a contiguous range of indices
       //
+      std::vector< RegressionFunctions::IndexRange > windows;
+
       indexDate = -1;
-      validDateSet=true;
       int indexDateMax = static_cast<int>(rrV.size());
 
       while( (indexDate+1) < indexLastCommonDate 
-              && indexDate < indexDateMax 
+              && (indexDate+1) < indexDateMax 
               && rrV.size() >= 2
-              && validDateSet
               && ((settings.calcOneGrowthRateForAllData && indexDate == -1) 
                     || !settings.calcOneGrowthRateForAllData)){
 
         ++indexDate;
 
-        std::vector< double > dateSubV; //date sub vector
-        std::vector< double > atoiSubV; // after-tax operating income sub vector
-        std::vector< double > rrSubV; //rate of return sub vector
-        std::vector< double > rocdSubV; //return on capital deployed sub vector
-
-        //
-        //Extract the sub interval
-        //
-        dateSubV.push_back(dateNumV[indexDate]);
-        atoiSubV.push_back(atoiV[indexDate]);
-        rrSubV.push_back(rrV[indexDate]);
-        rocdSubV.push_back(rocdV[indexDate]);
-
         int indexDateStart=indexDate+1;
         bool foundStartDate=false;
-   
 
         while(  !foundStartDate 
               && indexDateStart < indexLastCommonDate 
               && indexDateStart < indexDateMax){
             
-            double timeSpan      = dateSubV[0] - dateNumV[indexDateStart]; 
+            double timeSpan      = dateNumV[indexDate] 
+                                 - dateNumV[indexDateStart]; 
             double timeSpanError = timeSpan-settings.growthIntervalInYears;
 
             if( timeSpanError < maxYearErrorTTM ){
-              dateSubV.push_back(dateNumV[indexDateStart]);
-              atoiSubV.push_back(atoiV[indexDateStart]);
-              rrSubV.push_back(rrV[indexDateStart]); 
-              rocdSubV.push_back(rocdV[indexDateStart]);
+              ++indexDateStart;
             }else{
               foundStartDate = true;
             }       
-            ++indexDateStart;
+        }
 
+        if(   (indexDateStart-indexDate) >= 2
+           && (foundStartDate || settings.calcOneGrowthRateForAllData)){
+          windows.push_back(RegressionFunctions::IndexRange(
+                              static_cast<size_t>(indexDate),
+                              static_cast<size_t>(indexDateStart)));
         }
+      }
+
+      //
+      //The candidate linear and exponential models of every interval are 
+      //evaluated in one pass using running sums
+      //
+      std::vector< EmpiricalGrowthModelCandidates > atoiCandidates;
+      std::vector< EmpiricalGrowthModelCandidates > rrCandidates;
+      std::vector< EmpiricalGrowthModelCandidates > rocdCandidates;
+      if(settings.typeOfEmpiricalModel==-1){
+        calcEmpiricalGrowthModelCandidates(dateNumV, atoiV, windows,
+          settings.maxOutlierProportionInEmpiricalModel,
+          settings.forceZeroSlopeOnLinearModel, atoiCandidates);
+        calcEmpiricalGrowthModelCandidates(dateNumV, rrV, windows,
+          settings.maxOutlierProportionInEmpiricalModel,
+          settings.forceZeroSlopeOnLinearModel, rrCandidates);
+        calcEmpiricalGrowthModelCandidates(dateNumV, rocdV, windows,
+          settings.maxOutlierProportionInEmpiricalModel,
+          settings.forceZeroSlopeOnLinearModel, rocdCandidates);
+      }
 
+      for(size_t indexWindow=0; indexWindow < windows.size(); ++indexWindow){
+
+        const RegressionFunctions::IndexRange &window = windows[indexWindow];
+        indexDate = static_cast<int>(window.begin);
+
+        //
+        //Extract the sub interval
+        //
+        std::vector< double > dateSubV(dateNumV.begin()+window.begin,
+                                       dateNumV.begin()+window.end);
+        std::vector< double > atoiSubV(atoiV.begin()+window.begin,
+                                       atoiV.begin()+window.end);
+        std::vector< double > rrSubV(rrV.begin()+window.begin,
+                                     rrV.begin()+window.end);
+        std::vector< double > rocdSubV(rocdV.begin()+window.begin,
+                                       rocdV.begin()+window.end);
 
         //
         //Fit each of the models to the data and choose the most appropriate
@@ -2123,8 +2610,7 @@ class NumericalFunctions {
         //
         //
         if(    dateSubV.size() >= 2 
-           && (dateSubV.size()==atoiSubV.size())
-           && (foundStartDate || settings.calcOneGrowthRateForAllData)){
+           && (dateSubV.size()==atoiSubV.size())){
 
           //Order dateSubV so that it proceeds from the earliest date to the 
           //latest date
@@ -2143,19 +2629,25 @@ class NumericalFunctions {
               dateSubV,
               atoiSubV,
               settings,
-              atoiModel);
+              atoiModel,
+              atoiCandidates.empty() ? nullptr 
+                                     : &atoiCandidates[indexWindow]);
 
           fitToModelWithLowestR2Error(
               dateSubV,
               rrSubV,
               settings,
-              rrModel);
+              rrModel,
+              rrCandidates.empty() ? nullptr 
+                                   : &rrCandidates[indexWindow]);
 
           fitToModelWithLowestR2Error(
               dateSubV,
               rocdSubV,
               settings,
-              rocdModel);
+              rocdModel,
+              rocdCandidates.empty() ? nullptr 
+                                     : &rocdCandidates[indexWindow]);
 
           bool validFitting = (atoiModel.validFitting  
                             && rrModel.validFitting
@@ -2376,8 +2868,7 @@ class NumericalFunctions {
             bool appendTermRecord,
             bool setNansToMissingValue,
             const std::string &parentName,
-            std::vector< std::string> &termNames,
-            std::vector< double > &termValues,
+            DataStructures::TermRecord &termRecord,
             std::vector< DataStructures::PriceToValueSummary > &pvSummary)                                      
     {
 
@@ -2433,21 +2924,21 @@ class NumericalFunctions {
 
 
         if(appendTermRecord){
-          termNames.push_back(parentName+"marketCapitalization");
-          termValues.push_back(marketCapitalization);
+          termRecord.appendName({parentName, "marketCapitalization"});
+          termRecord.appendValue(marketCapitalization);
 
-          termNames.push_back(parentName+"discountRate");
-          termValues.push_back(discountRate);
+          termRecord.appendName({parentName, "discountRate"});
+          termRecord.appendValue(discountRate);
 
-          termNames.push_back(parentName+"years_of_growth");
-          termValues.push_back(numberOfYearsOfGrowth);
+          termRecord.appendName({parentName, "years_of_growth"});
+          termRecord.appendValue(numberOfYearsOfGrowth);
 
-          termNames.push_back(parentName+"revenue");
-          termValues.push_back(revenue0);
+          termRecord.appendName({parentName, "revenue"});
+          termRecord.appendValue(revenue0);
 
           for(int i=0; i<revenueGrowthVariation.size();++i){
-            termNames.push_back(parentName+"revenueGrowth"+nameMod[i]);
-            termValues.push_back(revenueGrowthVariation[i]);
+            termRecord.appendName({parentName, "revenueGrowth", nameMod[i]});
+            termRecord.appendValue(revenueGrowthVariation[i]);
           }
         }
 
@@ -2467,25 +2958,25 @@ class NumericalFunctions {
           if(idxR2F >= 0){
             if(revenueToFcfModel.model[idxR2F].parameters.size()==3){
               added=true;
-              termNames.push_back(parentName+"revenueToFcfModel_x0");
-              termValues.push_back(revenueToFcfModel.model[idxR2F].parameters[0]);
-              termNames.push_back(parentName+"revenueToFcfModel_y0");
-              termValues.push_back(revenueToFcfModel.model[idxR2F].parameters[1]);
-              termNames.push_back(parentName+"revenueToFcfModel_dydx");
-              termValues.push_back(revenueToFcfModel.model[idxR2F].parameters[2]);
-              termNames.push_back(parentName+"revenueToFcfModel_r2");
-              termValues.push_back(revenueToFcfModel.model[idxR2F].r2);
+              termRecord.appendName({parentName, "revenueToFcfModel_x0"});
+              termRecord.appendValue(revenueToFcfModel.model[idxR2F].parameters[0]);
+              termRecord.appendName({parentName, "revenueToFcfModel_y0"});
+              termRecord.appendValue(revenueToFcfModel.model[idxR2F].parameters[1]);
+              termRecord.appendName({parentName, "revenueToFcfModel_dydx"});
+              termRecord.appendValue(revenueToFcfModel.model[idxR2F].parameters[2]);
+              termRecord.appendName({parentName, "revenueToFcfModel_r2"});
+              termRecord.appendValue(revenueToFcfModel.model[idxR2F].r2);
             }
           }
           if(!added){
-            termNames.push_back(parentName+"revenueToFcfModel_x0");
-            termValues.push_back(std::nan("1"));
-            termNames.push_back(parentName+"revenueToFcfModel_y0");
-            termValues.push_back(std::nan("1"));
-            termNames.push_back(parentName+"revenueToFcfModel_dydx");
-            termValues.push_back(std::nan("1"));
-            termNames.push_back(parentName+"revenueToFcfModel_r2");
-            termValues.push_back(std::nan("1"));
+            termRecord.appendName({parentName, "revenueToFcfModel_x0"});
+            termRecord.appendValue(std::nan("1"));
+            termRecord.appendName({parentName, "revenueToFcfModel_y0"});
+            termRecord.appendValue(std::nan("1"));
+            termRecord.appendName({parentName, "revenueToFcfModel_dydx"});
+            termRecord.appendValue(std::nan("1"));
+            termRecord.appendName({parentName, "revenueToFcfModel_r2"});
+            termRecord.appendValue(std::nan("1"));
           }
         }
                                       
@@ -2511,17 +3002,16 @@ class NumericalFunctions {
             double discountedFcf = (fcf/discountFactor);
             cumFcf += discountedFcf;
             if(appendTermRecord){  
-              std::stringstream ss;
-              ss << j;
-              termNames.push_back(parentName+"revenue"+nameMod[i]+"_"+ss.str());
-              termNames.push_back(parentName+"fcf"+nameMod[i]+"_"+ss.str());
-              termNames.push_back(parentName+"discount_factor"+nameMod[i]+"_"+ss.str());
-              termNames.push_back(parentName+"fcf_present_value"+nameMod[i]+"_"+ss.str());
-
-              termValues.push_back(revenue);
-              termValues.push_back(fcf);
-              termValues.push_back(discountFactor);
-              termValues.push_back(discountedFcf);
+              std::string yearIndex = std::to_string(j);
+              termRecord.appendName({parentName, "revenue", nameMod[i], "_", yearIndex});
+              termRecord.appendName({parentName, "fcf", nameMod[i], "_", yearIndex});
+              termRecord.appendName({parentName, "discount_factor", nameMod[i], "_", yearIndex});
+              termRecord.appendName({parentName, "fcf_present_value", nameMod[i], "_", yearIndex});
+
+              termRecord.appendValue(revenue);
+              termRecord.appendValue(fcf);
+              termRecord.appendValue(discountFactor);
+              termRecord.appendValue(discountedFcf);
             }
           }
           //Assume that the company continues to produce the same free cash flow
@@ -2543,14 +3033,14 @@ class NumericalFunctions {
           pvSummary[i].date                 = dateSet.dates[0];
 
           if(appendTermRecord){
-            termNames.push_back(parentName+"cumulative_fcf_present_value"+nameMod[i]);
-            termValues.push_back(cumFcf);
-            termNames.push_back(parentName+"terminal_fcf_present_value"+nameMod[i]);
-            termValues.push_back(cumFcfTerminal);
-            termNames.push_back(parentName+"present_value"+nameMod[i]);
-            termValues.push_back(totalFcf);
-            termNames.push_back(parentName+"price_to_value"+nameMod[i]);
-            termValues.push_back(priceToValue);
+            termRecord.appendName({parentName, "cumulative_fcf_present_value", nameMod[i]});
+            termRecord.appendValue(cumFcf);
+            termRecord.appendName({parentName, "terminal_fcf_present_value", nameMod[i]});
+            termRecord.appendValue(cumFcfTerminal);
+            termRecord.appendName({parentName, "present_value", nameMod[i]});
+            termRecord.appendValue(totalFcf);
+            termRecord.appendName({parentName, "price_to_value", nameMod[i]});
+            termRecord.appendValue(priceToValue);
           }
         }
 
@@ -2571,8 +3061,7 @@ class NumericalFunctions {
                     bool appendTermRecord,
                     bool setNansToMissingValue,
                     const std::string &parentName,
-                    std::vector< std::string> &termNames,
-                    std::vector< double > &termValues,
+                    DataStructures::TermRecord &termRecord,
                     std::vector< DataStructures::PriceToValueSummary> &pvSummary)                                      
     {
 
@@ -2597,14 +3086,19 @@ class NumericalFunctions {
 
         double eps0 = financialRatios.eps[idxFR];
 
-        DataStructures::SummaryStatistics growthStats;
-        extractSummaryStatistics(equityGrowthModel.metricGrowthRate,growthStats);
-
-        DataStructures::SummaryStatistics dividendYieldStats;
-        extractSummaryStatistics(financialRatios.dividendYield,dividendYieldStats);
+        std::vector< DataStructures::SummaryStatistics > summaryStats;
+        std::vector< bool > validSummaryStats;
+        extractSummaryStatistics({&equityGrowthModel.metricGrowthRate,
+                                  &financialRatios.dividendYield,
+                                  &financialRatios.pe},
+                                  summaryStats, validSummaryStats);
 
-        DataStructures::SummaryStatistics peStats;                           
-        extractSummaryStatistics(financialRatios.pe,peStats);
+        const DataStructures::SummaryStatistics &growthStats 
+          = summaryStats[0];
+        const DataStructures::SummaryStatistics &dividendYieldStats
+          = summaryStats[1];
+        const DataStructures::SummaryStatistics &peStats
+          = summaryStats[2];
 
         double growth=equityGrowthModel.metricGrowthRate[idxGM];
         double dividendYield = financialRatios.dividendYield[idxFR];
@@ -2640,20 +3134,20 @@ class NumericalFunctions {
                 }                
                 if(appendTermRecord){
                     nameMod="";
-                    termNames.push_back(parentName+"sharePrice");
-                    termNames.push_back(parentName+"eps");
-                    termNames.push_back(parentName+"equityGrowth");
-                    termNames.push_back(parentName+"dividendYield");
-                    termNames.push_back(parentName+"pe");
-                    termNames.push_back(parentName+"discountRate");
-                    termNames.push_back(parentName+"years");
-                    termValues.push_back(financialRatios.adjustedClosePrice[idxFR]);
-                    termValues.push_back(eps0);
-                    termValues.push_back(growthVariation[i]);
-                    termValues.push_back(dividendYieldVariation[i]);
-                    termValues.push_back(peVariation[i]);
-                    termValues.push_back(discountRate);
-                    termValues.push_back(numberOfYearsForTerminalValuation);
+                    termRecord.appendName({parentName, "sharePrice"});
+                    termRecord.appendName({parentName, "eps"});
+                    termRecord.appendName({parentName, "equityGrowth"});
+                    termRecord.appendName({parentName, "dividendYield"});
+                    termRecord.appendName({parentName, "pe"});
+                    termRecord.appendName({parentName, "discountRate"});
+                    termRecord.appendName({parentName, "years"});
+                    termRecord.appendValue(financialRatios.adjustedClosePrice[idxFR]);
+                    termRecord.appendValue(eps0);
+                    termRecord.appendValue(growthVariation[i]);
+                    termRecord.appendValue(dividendYieldVariation[i]);
+                    termRecord.appendValue(peVariation[i]);
+                    termRecord.appendValue(discountRate);
+                    termRecord.appendValue(numberOfYearsForTerminalValuation);
                 }
               } break;
             case 1:
@@ -2673,16 +3167,16 @@ class NumericalFunctions {
 
                 if(appendTermRecord){
                     nameMod="_P25";
-                    termNames.push_back(parentName+"sharePrice"+nameMod);
-                    termNames.push_back(parentName+"eps"+nameMod);
-                    termNames.push_back(parentName+"equityGrowth"+nameMod);
-                    termNames.push_back(parentName+"dividendYield"+nameMod);
-                    termNames.push_back(parentName+"pe"+nameMod);
-                    termValues.push_back(financialRatios.adjustedClosePrice[idxFR]);
-                    termValues.push_back(eps0);
-                    termValues.push_back(growthVariation[i]);
-                    termValues.push_back(dividendYieldVariation[i]);
-                    termValues.push_back(peVariation[i]);
+                    termRecord.appendName({parentName, "sharePrice", nameMod});
+                    termRecord.appendName({parentName, "eps", nameMod});
+                    termRecord.appendName({parentName, "equityGrowth", nameMod});
+                    termRecord.appendName({parentName, "dividendYield", nameMod});
+                    termRecord.appendName({parentName, "pe", nameMod});
+                    termRecord.appendValue(financialRatios.adjustedClosePrice[idxFR]);
+                    termRecord.appendValue(eps0);
+                    termRecord.appendValue(growthVariation[i]);
+                    termRecord.appendValue(dividendYieldVariation[i]);
+                    termRecord.appendValue(peVariation[i]);
 
                 }
 
@@ -2704,16 +3198,16 @@ class NumericalFunctions {
 
                 if(appendTermRecord){
                     nameMod="_P50";
-                    termNames.push_back(parentName+"sharePrice"+nameMod);
-                    termNames.push_back(parentName+"eps"+nameMod);
-                    termNames.push_back(parentName+"equityGrowth"+nameMod);
-                    termNames.push_back(parentName+"dividendYield"+nameMod);
-                    termNames.push_back(parentName+"pe"+nameMod);
-                    termValues.push_back(financialRatios.adjustedClosePrice[idxFR]);
-                    termValues.push_back(eps0);
-                    termValues.push_back(growthVariation[i]);
-                    termValues.push_back(dividendYieldVariation[i]);
-                    termValues.push_back(peVariation[i]);
+                    termRecord.appendName({parentName, "sharePrice", nameMod});
+                    termRecord.appendName({parentName, "eps", nameMod});
+                    termRecord.appendName({parentName, "equityGrowth", nameMod});
+                    termRecord.appendName({parentName, "dividendYield", nameMod});
+                    termRecord.appendName({parentName, "pe", nameMod});
+                    termRecord.appendValue(financialRatios.adjustedClosePrice[idxFR]);
+                    termRecord.appendValue(eps0);
+                    termRecord.appendValue(growthVariation[i]);
+                    termRecord.appendValue(dividendYieldVariation[i]);
+                    termRecord.appendValue(peVariation[i]);
                 }
 
               } break;
@@ -2735,16 +3229,16 @@ class NumericalFunctions {
 
                 if(appendTermRecord){
                     nameMod="_P75";
-                    termNames.push_back(parentName+"sharePrice"+nameMod);
-                    termNames.push_back(parentName+"eps"+nameMod);
-                    termNames.push_back(parentName+"equityGrowth"+nameMod);
-                    termNames.push_back(parentName+"dividendYield"+nameMod);
-                    termNames.push_back(parentName+"pe"+nameMod);
-                    termValues.push_back(financialRatios.adjustedClosePrice[idxFR]);
-                    termValues.push_back(eps0);
-                    termValues.push_back(growthVariation[i]);
-                    termValues.push_back(dividendYieldVariation[i]);
-                    termValues.push_back(peVariation[i]);
+                    termRecord.appendName({parentName, "sharePrice", nameMod});
+                    termRecord.appendName({parentName, "eps", nameMod});
+                    termRecord.appendName({parentName, "equityGrowth", nameMod});
+                    termRecord.appendName({parentName, "dividendYield", nameMod});
+                    termRecord.appendName({parentName, "pe", nameMod});
+                    termRecord.appendValue(financialRatios.adjustedClosePrice[idxFR]);
+                    termRecord.appendValue(eps0);
+                    termRecord.appendValue(growthVariation[i]);
+                    termRecord.appendValue(dividendYieldVariation[i]);
+                    termRecord.appendValue(peVariation[i]);
                 }
 
               } break;
@@ -2770,24 +3264,23 @@ class NumericalFunctions {
 
             //The details are only outputted for the nominal case
             if(appendTermRecord && i == 0){
-              std::stringstream ss;
-              ss << j;
-              termNames.push_back(parentName+"eps"+nameMod+"_"+ss.str());
-              termNames.push_back(parentName+"dividend"+nameMod+"_"+ss.str());
-              termNames.push_back(parentName+"discount_factor"+nameMod+"_"+ss.str());
-              termNames.push_back(parentName+"dividend_present_value"+nameMod+"_"+ss.str());
-
-              termValues.push_back(eps);
-              termValues.push_back(dividend);
-              termValues.push_back(discountFactor);
-              termValues.push_back(presentValue);            
+              std::string yearIndex = std::to_string(j);
+              termRecord.appendName({parentName, "eps", nameMod, "_", yearIndex});
+              termRecord.appendName({parentName, "dividend", nameMod, "_", yearIndex});
+              termRecord.appendName({parentName, "discount_factor", nameMod, "_", yearIndex});
+              termRecord.appendName({parentName, "dividend_present_value", nameMod, "_", yearIndex});
+
+              termRecord.appendValue(eps);
+              termRecord.appendValue(dividend);
+              termRecord.appendValue(discountFactor);
+              termRecord.appendValue(presentValue);            
             }
             
           }
 
           if(appendTermRecord){
-            termNames.push_back(parentName+"cumulative_dividend_present_value"+nameMod);
-            termValues.push_back(cumPresentValue[i]);
+            termRecord.appendName({parentName, "cumulative_dividend_present_value", nameMod});
+            termRecord.appendValue(cumPresentValue[i]);
           }
 
           double epsTerminal = eps0*std::pow(1.0+growthVariation[i],
@@ -2802,16 +3295,16 @@ class NumericalFunctions {
           double terminalPresentValue = terminalValue / terminalDiscount;       
 
           if(appendTermRecord){
-            termNames.push_back(parentName+"terminal_eps"+nameMod);
-            termValues.push_back(epsTerminal);  
-            termNames.push_back(parentName+"terminal_pe"+nameMod);
-            termValues.push_back(peVariation[i]);  
-            termNames.push_back(parentName+"terminal_value"+nameMod);
-            termValues.push_back(terminalValue);  
-            termNames.push_back(parentName+"terminal_discount"+nameMod);
-            termValues.push_back(terminalDiscount);        
-            termNames.push_back(parentName+"terminal_present_value"+nameMod);
-            termValues.push_back(terminalPresentValue);
+            termRecord.appendName({parentName, "terminal_eps", nameMod});
+            termRecord.appendValue(epsTerminal);  
+            termRecord.appendName({parentName, "terminal_pe", nameMod});
+            termRecord.appendValue(peVariation[i]);  
+            termRecord.appendName({parentName, "terminal_value", nameMod});
+            termRecord.appendValue(terminalValue);  
+            termRecord.appendName({parentName, "terminal_discount", nameMod});
+            termRecord.appendValue(terminalDiscount);        
+            termRecord.appendName({parentName, "terminal_present_value", nameMod});
+            termRecord.appendValue(terminalPresentValue);
           }
 
 
@@ -2819,8 +3312,8 @@ class NumericalFunctions {
 
 
           if(appendTermRecord){
-            termNames.push_back(parentName+"total_present_value"+nameMod);
-            termValues.push_back(cumPresentValue[i]);
+            termRecord.appendName({parentName, "total_present_value", nameMod});
+            termRecord.appendValue(cumPresentValue[i]);
           }
 
 
@@ -2837,8 +3330,8 @@ class NumericalFunctions {
 
           //Compute the price to value ratio
           if(appendTermRecord){
-            termNames.push_back(parentName+"price_to_value"+nameMod);
-            termValues.push_back(priceToValue[i]);
+            termRecord.appendName({parentName, "price_to_value", nameMod});
+            termRecord.appendValue(priceToValue[i]);
           }
         }
       }
@@ -3026,8 +3519,7 @@ class NumericalFunctions {
         const DataStructures::MetricGrowthDataSet &metricGrowthData,        
         const std::string nameToPrepend,
         double maxDateErrorInYearsInEmpiricalData,
-        std::vector< std::string > &termNames,
-        std::vector< double > &termValues)
+        DataStructures::TermRecord &termRecord)
     {
       
       if(metricGrowthData.datesNumerical.size()>0){
@@ -3043,8 +3535,7 @@ class NumericalFunctions {
                 metricGrowthData,
                 nameToPrepend,
                 maxDateErrorInYearsInEmpiricalData,
-                termNames,
-                termValues);
+                termRecord);
               
       }
     };
@@ -3055,8 +3546,7 @@ class NumericalFunctions {
         const DataStructures::MetricGrowthDataSet &metricGrowthData,        
         const std::string nameToPrepend,
         double maxDateErrorInYearsInEmpiricalData,
-        std::vector< std::string > &termNames,
-        std::vector< double > &termValues)
+        DataStructures::TermRecord &termRecord)
     {
 
       if(metricGrowthData.datesNumerical.size()>0){
@@ -3071,26 +3561,26 @@ class NumericalFunctions {
                           -dateInYears;
         if(std::abs(dateError) < maxDateErrorInYearsInEmpiricalData){
 
-          termNames.push_back(nameToPrepend+"date");
-          termValues.push_back(metricGrowthData.datesNumerical[index]);
+          termRecord.appendName({nameToPrepend, "date"});
+          termRecord.appendValue(metricGrowthData.datesNumerical[index]);
 
-          termNames.push_back(nameToPrepend+"value");
-          termValues.push_back(metricGrowthData.metricValue[index]);
+          termRecord.appendName({nameToPrepend, "value"});
+          termRecord.appendValue(metricGrowthData.metricValue[index]);
 
-          termNames.push_back(nameToPrepend+"growth");
-          termValues.push_back(metricGrowthData.metricGrowthRate[index]);
+          termRecord.appendName({nameToPrepend, "growth"});
+          termRecord.appendValue(metricGrowthData.metricGrowthRate[index]);
 
-          termNames.push_back(nameToPrepend+"r2");
-          termValues.push_back(metricGrowthData.model[index].r2);
+          termRecord.appendName({nameToPrepend, "r2"});
+          termRecord.appendValue(metricGrowthData.model[index].r2);
 
-          termNames.push_back(nameToPrepend+"r2Trendline");
-          termValues.push_back(metricGrowthData.model[index].r2Trendline);
+          termRecord.appendName({nameToPrepend, "r2Trendline"});
+          termRecord.appendValue(metricGrowthData.model[index].r2Trendline);
 
-          termNames.push_back(nameToPrepend+"r2Cyclic");
-          termValues.push_back(metricGrowthData.model[index].r2Cyclic);
+          termRecord.appendName({nameToPrepend, "r2Cyclic"});
+          termRecord.appendValue(metricGrowthData.model[index].r2Cyclic);
 
-          termNames.push_back(nameToPrepend+"ModelType");
-          termValues.push_back(metricGrowthData.model[index].modelType);
+          termRecord.appendName({nameToPrepend, "ModelType"});
+          termRecord.appendValue(metricGrowthData.model[index].modelType);
         }
       }
     };
@@ -3102,65 +3592,56 @@ class NumericalFunctions {
         double dateInYears,
         double costOfCapitalMature,
         const std::string nameToPrepend,
-        std::vector< std::string > &termNames,
-        std::vector< double > &termValues)
+        DataStructures::TermRecord &termRecord)
     {
 
 
 
-      termNames.push_back(nameToPrepend+"AfterTaxOperatingIncomeGrowth");
-      termValues.push_back(
-          empiricalGrowthData.afterTaxOperatingIncomeGrowth[index]);
+      termRecord.appendName({nameToPrepend, "AfterTaxOperatingIncomeGrowth"});
+      termRecord.appendValue(empiricalGrowthData.afterTaxOperatingIncomeGrowth[index]);
 
-      termNames.push_back(nameToPrepend+"r2");
-      termValues.push_back(
-          empiricalGrowthData.afterTaxOperatingIncomeModel[index].r2); 
+      termRecord.appendName({nameToPrepend, "r2"});
+      termRecord.appendValue(empiricalGrowthData.afterTaxOperatingIncomeModel[index].r2); 
 
-      termNames.push_back(nameToPrepend+"r2Trendline");
-      termValues.push_back(
-          empiricalGrowthData.afterTaxOperatingIncomeModel[index].r2Trendline); 
+      termRecord.appendName({nameToPrepend, "r2Trendline"});
+      termRecord.appendValue(empiricalGrowthData.afterTaxOperatingIncomeModel[index].r2Trendline); 
 
-      termNames.push_back(nameToPrepend+"r2Cyclic");
-      termValues.push_back(
-          empiricalGrowthData.afterTaxOperatingIncomeModel[index].r2Cyclic); 
+      termRecord.appendName({nameToPrepend, "r2Cyclic"});
+      termRecord.appendValue(empiricalGrowthData.afterTaxOperatingIncomeModel[index].r2Cyclic); 
 
-      termNames.push_back(nameToPrepend+"ModelType");
-      termValues.push_back(
-          empiricalGrowthData.afterTaxOperatingIncomeModel[index].modelType); 
+      termRecord.appendName({nameToPrepend, "ModelType"});
+      termRecord.appendValue(empiricalGrowthData.afterTaxOperatingIncomeModel[index].modelType); 
 
-      termNames.push_back(nameToPrepend+"ReinvestmentRateMean");
-      termValues.push_back(empiricalGrowthData.reinvestmentRate[index]);
+      termRecord.appendName({nameToPrepend, "ReinvestmentRateMean"});
+      termRecord.appendValue(empiricalGrowthData.reinvestmentRate[index]);
 
-      termNames.push_back(nameToPrepend+"ReinvestmentRateStandardDeviation");
-      termValues.push_back(empiricalGrowthData.reinvestmentRateSD[index]);
+      termRecord.appendName({nameToPrepend, "ReinvestmentRateStandardDeviation"});
+      termRecord.appendValue(empiricalGrowthData.reinvestmentRateSD[index]);
 
-      termNames.push_back(nameToPrepend+"ReturnOnCapitalDeployed");
-      termValues.push_back(empiricalGrowthData.returnOnCapitalDeployed[index]);
+      termRecord.appendName({nameToPrepend, "ReturnOnCapitalDeployed"});
+      termRecord.appendValue(empiricalGrowthData.returnOnCapitalDeployed[index]);
 
-      termNames.push_back(nameToPrepend+"ReturnOnCapitalDeployedStandardDeviation");
-      termValues.push_back(empiricalGrowthData.returnOnCapitalDeployedSD[index]);
+      termRecord.appendName({nameToPrepend, "ReturnOnCapitalDeployedStandardDeviation"});
+      termRecord.appendValue(empiricalGrowthData.returnOnCapitalDeployedSD[index]);
 
 
-      termNames.push_back(nameToPrepend
-                          +"ReturnOnInvestedCapitalLessCostOfCapital");
+      termRecord.appendName({nameToPrepend, "ReturnOnInvestedCapitalLessCostOfCapital"});
 
       double roicEmpLCC = empiricalGrowthData.returnOnCapitalDeployed[index]
                           -costOfCapitalMature;          
 
-      termValues.push_back(roicEmpLCC);
+      termRecord.appendValue(roicEmpLCC);
 
-      termNames.push_back(nameToPrepend+"Duration");
-      termValues.push_back(
-          empiricalGrowthData.afterTaxOperatingIncomeModel[index].duration); 
+      termRecord.appendName({nameToPrepend, "Duration"});
+      termRecord.appendValue(empiricalGrowthData.afterTaxOperatingIncomeModel[index].duration); 
 
-      termNames.push_back(nameToPrepend+"ModelDateError");
+      termRecord.appendName({nameToPrepend, "ModelDateError"});
       double dateError = 
         dateInYears - empiricalGrowthData.datesNumerical[index];
-      termValues.push_back(dateError); 
+      termRecord.appendValue(dateError); 
 
-      termNames.push_back(nameToPrepend+"OutlierCount");
-      termValues.push_back(
-          empiricalGrowthData.afterTaxOperatingIncomeModel[index].outlierCount); 
+      termRecord.appendName({nameToPrepend, "OutlierCount"});
+      termRecord.appendValue(empiricalGrowthData.afterTaxOperatingIncomeModel[index].outlierCount); 
 
     };   
     //==========================================================================
@@ -3198,7 +3679,6 @@ class NumericalFunctions {
         double recentAdjustedClosePrice =
           FinancialAnalysisFunctions::getHistoricalDataInFundamentalUnit(
             historicalData[ index ]["adjusted_close"],
-            fundamentalData,
             false);
 
         //double recentAdjustedClosePrice 
@@ -3284,7 +3764,6 @@ class NumericalFunctions {
         pvUpd.recentAdjustedClosePrice  =
           FinancialAnalysisFunctions::getHistoricalDataInFundamentalUnit(
             historicalData[ index ]["adjusted_close"],
-            fundamentalData,
             false);         
 
         //pvUpd.recentAdjustedClosePrice 
@@ -3331,6 +3810,7 @@ class NumericalFunctions {
                     DataStructures::EmpiricalRelationModel &revenueFcfModel,
                     DataStructures::EmpiricalRelationModel &revenueFcfModelAvg)
     {
+      ProfilingFunctions::ScopedTimer timer("fit_revenue_to_fcf_models");
       revenueFcfModel.interval    = growthIntervalInYears;
       revenueFcfModelAvg.interval = growthIntervalInYearsAll;
 
@@ -0,0 +1,275 @@
+//SPDX-FileCopyrightText: 2023 Matthew Millard millard.matthew@gmail.com
+//SPDX-License-Identifier: MIT
+
+#ifndef PARALLEL_FUNCTIONS
+#define PARALLEL_FUNCTIONS
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <streambuf>
+#include <memory>
+#include <atomic>
+#include <exception>
+
+
+class ParallelFunctions {
+
+  public:
+
+    //==========================================================================
+    /*
+      A stream buffer that is installed on std::cout and std::cerr while a
+      batch of tasks is running on several threads. Each worker thread points
+      the buffer at the log of the task that it is currently working on so
+      that the console output of the tasks (including the output of the
+      functions in FinancialAnalysisFunctions and NumericalFunctions) does not
+      get interleaved. Output written by a thread that is not running a task
+      is passed through to the original stream buffer.
+    */
+    class TaskStreamBuffer : public std::streambuf {
+      public:
+        TaskStreamBuffer(std::streambuf *original, bool isErrorStream)
+          :original(original),isErrorStream(isErrorStream){};
+
+        std::streambuf *original;
+        bool isErrorStream;
+
+        static std::stringbuf*& taskOutput(){
+          thread_local std::stringbuf *output = nullptr;
+          return output;
+        };
+        static std::stringbuf*& taskError(){
+          thread_local std::stringbuf *error = nullptr;
+          return error;
+        };
+
+      protected:
+        std::streambuf* target(){
+          std::stringbuf *taskBuffer =
+            isErrorStream ? taskError() : taskOutput();
+          if(taskBuffer != nullptr){
+            return taskBuffer;
+          }
+          return original;
+        };
+
+        int overflow(int c) override {
+          if(c == traits_type::eof()){
+            return traits_type::not_eof(c);
+          }
+          return target()->sputc(static_cast<char>(c));
+        };
+
+        std::streamsize xsputn(const char *s, std::streamsize n) override {
+          return target()->sputn(s,n);
+        };
+
+        int sync() override {
+          if(target() == original){
+            return original->pubsync();
+          }
+          return 0;
+        };
+    };
+
+    //==========================================================================
+    struct TaskLog{
+      std::stringbuf output;
+      std::stringbuf error;
+      bool done;
+      TaskLog():done(false){};
+    };
+
+    //==========================================================================
+    /*
+      Evaluates task(index, threadIndex) for every index in [0,numberOfTasks)
+      using numberOfThreads threads.
+
+      The tasks are dealt out to the threads in contiguous blocks. Each thread
+      works through its own block from the front, and when its block is empty
+      it steals the last task from the block of one of the other threads. This
+      keeps every thread busy even when some tasks (e.g. tickers with a long
+      price history) take much longer than others.
+
+      When captureConsoleOutput is true the console output of each task is
+      buffered and written to std::cout/std::cerr in task order as soon as all
+      of the previous tasks have finished. The console output is then
+      identical no matter how many threads are used.
+
+      If numberOfThreads is 1 the tasks are evaluated in order on the calling
+      thread and nothing is buffered.
+
+      If a task throws, the threads stop taking new tasks and the first 
+      exception is rethrown on the calling thread once every thread has
+      finished.
+    */
+    static void runWorkStealingLoop(
+                  size_t numberOfTasks,
+                  int numberOfThreads,
+                  bool captureConsoleOutput,
+                  const std::function<void(size_t,int)> &task)
+    {
+      if(numberOfTasks == 0){
+        return;
+      }
+
+      if(numberOfThreads < 1){
+        numberOfThreads = static_cast<int>(std::thread::hardware_concurrency());
+        if(numberOfThreads < 1){
+          numberOfThreads = 1;
+        }
+      }
+      if(static_cast<size_t>(numberOfThreads) > numberOfTasks){
+        numberOfThreads = static_cast<int>(numberOfTasks);
+      }
+
+      if(numberOfThreads == 1){
+        for(size_t i=0; i<numberOfTasks; ++i){
+          task(i,0);
+        }
+        return;
+      }
+
+      //Deal the tasks out in contiguous blocks
+      std::vector< std::deque< size_t > > queues(numberOfThreads);
+      std::vector< std::unique_ptr< std::mutex > > queueLocks;
+      for(int i=0; i<numberOfThreads; ++i){
+        queueLocks.push_back(std::make_unique< std::mutex >());
+      }
+      size_t blockSize = numberOfTasks / numberOfThreads;
+      size_t remainder = numberOfTasks % numberOfThreads;
+      size_t index = 0;
+      for(int i=0; i<numberOfThreads; ++i){
+        size_t n = blockSize + (static_cast<size_t>(i) < remainder ? 1 : 0);
+        for(size_t j=0; j<n; ++j){
+          queues[i].push_back(index);
+          ++index;
+        }
+      }
+
+      //Console capture
+      std::vector< TaskLog > taskLogs;
+      std::mutex logLock;
+      size_t nextLogToWrite = 0;
+      std::streambuf *coutOriginal = std::cout.rdbuf();
+      std::streambuf *cerrOriginal = std::cerr.rdbuf();
+      TaskStreamBuffer coutBuffer(coutOriginal,false);
+      TaskStreamBuffer cerrBuffer(cerrOriginal,true);
+
+      if(captureConsoleOutput){
+        taskLogs = std::vector< TaskLog >(numberOfTasks);
+        std::cout.flush();
+        std::cerr.flush();
+        std::cout.rdbuf(&coutBuffer);
+        std::cerr.rdbuf(&cerrBuffer);
+      }
+
+      auto popTask = [&](int threadIndex, size_t &taskIndex)->bool{
+        {
+          std::lock_guard< std::mutex > lock(*queueLocks[threadIndex]);
+          if(!queues[threadIndex].empty()){
+            taskIndex = queues[threadIndex].front();
+            queues[threadIndex].pop_front();
+            return true;
+          }
+        }
+        for(int i=1; i<numberOfThreads; ++i){
+          int victim = (threadIndex + i) % numberOfThreads;
+          std::lock_guard< std::mutex > lock(*queueLocks[victim]);
+          if(!queues[victim].empty()){
+            taskIndex = queues[victim].back();
+            queues[victim].pop_back();
+            return true;
+          }
+        }
+        return false;
+      };
+
+      auto writeFinishedLogs = [&](){
+        while(nextLogToWrite < numberOfTasks && taskLogs[nextLogToWrite].done){
+          std::string text = taskLogs[nextLogToWrite].output.str();
+          coutOriginal->sputn(text.c_str(),text.size());
+          text = taskLogs[nextLogToWrite].error.str();
+          cerrOriginal->sputn(text.c_str(),text.size());
+          taskLogs[nextLogToWrite].output.str(std::string());
+          taskLogs[nextLogToWrite].error.str(std::string());
+          ++nextLogToWrite;
+        }
+        coutOriginal->pubsync();
+        cerrOriginal->pubsync();
+      };
+
+      std::exception_ptr firstException;
+      std::mutex exceptionLock;
+      std::atomic< bool > failed(false);
+
+      auto worker = [&](int threadIndex){
+        size_t taskIndex = 0;
+        while(!failed.load() && popTask(threadIndex,taskIndex)){
+          if(captureConsoleOutput){
+            TaskStreamBuffer::taskOutput() = &taskLogs[taskIndex].output;
+            TaskStreamBuffer::taskError()  = &taskLogs[taskIndex].error;
+          }
+
+          //An exception that escaped the thread would call std::terminate
+          try{
+            task(taskIndex,threadIndex);
+          }catch(...){
+            std::lock_guard< std::mutex > lock(exceptionLock);
+            if(!firstException){
+              firstException = std::current_exception();
+            }
+            failed.store(true);
+          }
+
+          if(captureConsoleOutput){
+            TaskStreamBuffer::taskOutput() = nullptr;
+            TaskStreamBuffer::taskError()  = nullptr;
+            std::lock_guard< std::mutex > lock(logLock);
+            taskLogs[taskIndex].done=true;
+            writeFinishedLogs();
+          }
+        }
+      };
+
+      std::vector< std::thread > threads;
+      for(int i=0; i<numberOfThreads; ++i){
+        threads.push_back(std::thread(worker,i));
+      }
+      for(auto &thread : threads){
+        thread.join();
+      }
+
+      if(captureConsoleOutput){
+        //The tasks after a failure are not evaluated, and so the logs of 
+        //the tasks that did finish are written out past the gaps
+        if(failed.load()){
+          for(size_t i=nextLogToWrite; i<numberOfTasks; ++i){
+            if(taskLogs[i].done){
+              std::string text = taskLogs[i].output.str();
+              coutOriginal->sputn(text.c_str(),text.size());
+              text = taskLogs[i].error.str();
+              cerrOriginal->sputn(text.c_str(),text.size());
+            }
+          }
+          coutOriginal->pubsync();
+          cerrOriginal->pubsync();
+        }
+        std::cout.rdbuf(coutOriginal);
+        std::cerr.rdbuf(cerrOriginal);
+      }
+
+      if(firstException){
+        std::rethrow_exception(firstException);
+      }
+    };
+
+};
+
+#endif
@@ -0,0 +1,352 @@
+//SPDX-FileCopyrightText: 2023 Matthew Millard millard.matthew@gmail.com
+//SPDX-License-Identifier: MIT
+
+#ifndef PREFETCH_FUNCTIONS
+#define PREFETCH_FUNCTIONS
+
+#include <map>
+#include <cerrno>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <filesystem>
+#include <functional>
+#include <condition_variable>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+/*
+  Functions to read the files of the next few tasks of a loop (e.g. the
+  fundamental, historical, and calculate files of the next tickers) on
+  background I/O threads while the current task is being computed.
+
+  The loop body binds the thread to its task with a TaskScope. While the
+  scope exists JsonFunctions::loadJsonFile, and anything else that calls
+  getPrefetchedFile, is served from memory rather than from the disk. A file
+  that was not prefetched is read as usual, and so a prefetcher never
+  changes what is loaded, only when.
+*/
+class PrefetchFunctions {
+
+  public:
+
+    //==========================================================================
+    //Path names are compared in this form
+    static std::string normalizePath(const std::string &path){
+      return std::filesystem::path(path).lexically_normal().string();
+    };
+
+    //==========================================================================
+    /*
+      Asks the kernel to start reading path into the page cache, without
+      waiting for it.
+    */
+    static void adviseWillNeed(const std::string &path){
+      int fd = open(path.c_str(), O_RDONLY);
+      if(fd < 0){
+        return;
+      }
+      posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+      close(fd);
+    };
+
+    //==========================================================================
+    static bool readFile(const std::string &path, std::string &contentsUpd){
+      contentsUpd.clear();
+      int fd = open(path.c_str(), O_RDONLY);
+      if(fd < 0){
+        return false;
+      }
+      posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+      struct stat fileStatus;
+      if(fstat(fd,&fileStatus) != 0){
+        close(fd);
+        return false;
+      }
+      contentsUpd.resize(static_cast<size_t>(fileStatus.st_size));
+
+      size_t bytesRead = 0;
+      while(bytesRead < contentsUpd.size()){
+        ssize_t n = read(fd, &contentsUpd[bytesRead],
+                         contentsUpd.size()-bytesRead);
+        if(n < 0 && errno == EINTR){
+          continue;
+        }
+        if(n <= 0){
+          break;
+        }
+        bytesRead += static_cast<size_t>(n);
+      }
+      close(fd);
+      contentsUpd.resize(bytesRead);
+      return (bytesRead == static_cast<size_t>(fileStatus.st_size));
+    };
+
+    //==========================================================================
+    /*
+      A bounded queue of tasks whose files are read by numberOfIoThreads
+      threads. When a consumer starts task i the files of the tasks
+      i+1 ... i+lookAhead are queued, as long as no more than
+      lookAhead*numberOfConsumers tasks are queued or held in memory.
+
+      A task that is still waiting in the queue when its consumer asks for
+      its files is taken off the queue and its files are read by the
+      consumer. A task that is being read is waited for.
+
+      The prefetcher must not be used across a fork: the I/O threads are
+      not copied into the child.
+    */
+    class FilePrefetcher{
+
+      public:
+
+        //@param getTaskFiles : the paths of the files of task i
+        //@param lookAhead    : 0 disables prefetching
+        FilePrefetcher(
+            size_t numberOfTasks,
+            const std::function<void(size_t,std::vector<std::string>&)>
+              &getTaskFiles,
+            size_t lookAhead,
+            int numberOfConsumers,
+            int numberOfIoThreads):
+          getTaskFiles(getTaskFiles),
+          numberOfTasks(numberOfTasks),
+          lookAhead(lookAhead),
+          capacity(lookAhead*static_cast<size_t>(
+                                std::max(numberOfConsumers,1))),
+          scheduled(numberOfTasks,0),
+          stop(false){
+
+          if(lookAhead == 0){
+            return;
+          }
+          numberOfIoThreads = std::max(numberOfIoThreads,1);
+          for(int i=0; i<numberOfIoThreads; ++i){
+            ioThreads.emplace_back([this](){readQueuedTasks();});
+          }
+        };
+
+        ~FilePrefetcher(){
+          {
+            std::lock_guard< std::mutex > lock(taskLock);
+            stop = true;
+          }
+          queueChanged.notify_all();
+          for(auto &ioThread : ioThreads){
+            ioThread.join();
+          }
+        };
+
+        //======================================================================
+        void startTask(size_t taskIndex){
+          if(lookAhead == 0 || taskIndex >= numberOfTasks){
+            return;
+          }
+          std::lock_guard< std::mutex > lock(taskLock);
+          scheduled[taskIndex] = 1;
+          size_t last = std::min(numberOfTasks, taskIndex+1+lookAhead);
+          for(size_t i=taskIndex+1; i<last && tasks.size()<capacity; ++i){
+            if(scheduled[i] != 0){
+              continue;
+            }
+            scheduled[i] = 1;
+            TaskFiles &task = tasks[i];
+            std::vector< std::string > paths;
+            getTaskFiles(i,paths);
+            for(auto const &path : paths){
+              task.files.push_back(
+                std::make_pair(normalizePath(path),std::string()));
+              task.loaded.push_back(false);
+            }
+            queue.push_back(i);
+          }
+          queueChanged.notify_all();
+        };
+
+        //======================================================================
+        /*
+          Returns the contents of path if it was prefetched for taskIndex,
+          otherwise nullptr. The contents stay valid until finishTask.
+        */
+        const std::string* getFile(size_t taskIndex, const std::string &path){
+          if(lookAhead == 0){
+            return nullptr;
+          }
+          std::unique_lock< std::mutex > lock(taskLock);
+          auto iter = tasks.find(taskIndex);
+          if(iter == tasks.end()){
+            return nullptr;
+          }
+          if(iter->second.state == QUEUED){
+            queue.erase(std::remove(queue.begin(),queue.end(),taskIndex),
+                        queue.end());
+            tasks.erase(iter);
+            return nullptr;
+          }
+          taskRead.wait(lock,[&](){
+            iter = tasks.find(taskIndex);
+            return (iter == tasks.end() || iter->second.state == READ);
+          });
+          if(iter == tasks.end()){
+            return nullptr;
+          }
+          std::string normalizedPath = normalizePath(path);
+          const TaskFiles &task = iter->second;
+          for(size_t i=0; i<task.files.size(); ++i){
+            if(task.loaded[i] && task.files[i].first == normalizedPath){
+              return &task.files[i].second;
+            }
+          }
+          return nullptr;
+        };
+
+        //======================================================================
+        //Releases the files of taskIndex
+        void finishTask(size_t taskIndex){
+          if(lookAhead == 0){
+            return;
+          }
+          {
+            std::lock_guard< std::mutex > lock(taskLock);
+            auto iter = tasks.find(taskIndex);
+            if(iter != tasks.end()){
+              if(iter->second.state == QUEUED){
+                queue.erase(std::remove(queue.begin(),queue.end(),taskIndex),
+                            queue.end());
+              }
+              tasks.erase(iter);
+            }
+          }
+          taskRead.notify_all();
+          //There is room in the queue again
+          queueChanged.notify_all();
+        };
+
+      private:
+
+        enum TaskState{
+          QUEUED = 0,
+          READING,
+          READ
+        };
+
+        struct TaskFiles{
+          TaskState state;
+          //(normalized path, contents)
+          std::vector< std::pair< std::string, std::string > > files;
+          std::vector< bool > loaded;
+          TaskFiles():state(QUEUED){};
+        };
+
+        //======================================================================
+        void readQueuedTasks(){
+          std::unique_lock< std::mutex > lock(taskLock);
+          while(true){
+            queueChanged.wait(lock,[&](){return stop || !queue.empty();});
+            if(stop){
+              return;
+            }
+            size_t taskIndex = queue.front();
+            queue.pop_front();
+            auto iter = tasks.find(taskIndex);
+            if(iter == tasks.end() || iter->second.state != QUEUED){
+              continue;
+            }
+            iter->second.state = READING;
+            TaskFiles task = std::move(iter->second);
+            lock.unlock();
+
+            //The kernel can read all of the files of the task at once
+            for(auto const &file : task.files){
+              adviseWillNeed(file.first);
+            }
+            for(size_t i=0; i<task.files.size(); ++i){
+              task.loaded[i] = readFile(task.files[i].first,
+                                        task.files[i].second);
+            }
+
+            lock.lock();
+            iter = tasks.find(taskIndex);
+            if(iter != tasks.end()){
+              iter->second.files  = std::move(task.files);
+              iter->second.loaded = std::move(task.loaded);
+              iter->second.state  = READ;
+            }
+            taskRead.notify_all();
+          }
+        };
+
+        std::function<void(size_t,std::vector<std::string>&)> getTaskFiles;
+        size_t numberOfTasks;
+        size_t lookAhead;
+        size_t capacity;
+        std::vector< unsigned char > scheduled;
+        std::map< size_t, TaskFiles > tasks;
+        std::deque< size_t > queue;
+        std::mutex taskLock;
+        std::condition_variable queueChanged;
+        std::condition_variable taskRead;
+        std::vector< std::thread > ioThreads;
+        bool stop;
+    };
+
+    //==========================================================================
+    struct CurrentTask{
+      FilePrefetcher *prefetcher;
+      size_t taskIndex;
+    };
+
+    static CurrentTask& getCurrentTask(){
+      thread_local CurrentTask currentTask = {nullptr,0};
+      return currentTask;
+    };
+
+    //==========================================================================
+    /*
+      Binds the calling thread to taskIndex of prefetcher (which can be
+      nullptr) and starts prefetching the tasks that follow it. The files of
+      the task are released when the scope ends.
+    */
+    class TaskScope{
+      public:
+        TaskScope(FilePrefetcher *prefetcher, size_t taskIndex):
+          previous(getCurrentTask()){
+          if(prefetcher != nullptr){
+            prefetcher->startTask(taskIndex);
+          }
+          getCurrentTask() = {prefetcher,taskIndex};
+        };
+        ~TaskScope(){
+          CurrentTask &currentTask = getCurrentTask();
+          if(currentTask.prefetcher != nullptr){
+            currentTask.prefetcher->finishTask(currentTask.taskIndex);
+          }
+          currentTask = previous;
+        };
+      private:
+        CurrentTask previous;
+    };
+
+    //==========================================================================
+    /*
+      The contents of path if it was prefetched for the task of the calling
+      thread, otherwise nullptr.
+    */
+    static const std::string* getPrefetchedFile(const std::string &path){
+      CurrentTask &currentTask = getCurrentTask();
+      if(currentTask.prefetcher == nullptr){
+        return nullptr;
+      }
+      return currentTask.prefetcher->getFile(currentTask.taskIndex,path);
+    };
+
+};
+
+#endif
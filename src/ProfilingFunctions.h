@@ -0,0 +1,353 @@
+//SPDX-FileCopyrightText: 2023 Matthew Millard millard.matthew@gmail.com
+//SPDX-License-Identifier: MIT
+
+#ifndef PROFILING_FUNCTIONS
+#define PROFILING_FUNCTIONS
+
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <utility>
+#include <iostream>
+#include <algorithm>
+
+#include <unistd.h>
+
+#include <nlohmann/json.hpp>
+
+/*
+  Timers and counters that record where the time of a batch of tickers goes.
+  Nothing is recorded, and the timers do not read the clock, unless
+  profiling has been enabled and the calling thread is inside a TickerScope.
+
+  The time of each phase is inclusive: a fit that is timed inside of a
+  timed phase counts towards both.
+*/
+class ProfilingFunctions {
+
+  public:
+
+    //==========================================================================
+    //start and duration are in microseconds from the start of the profile
+    struct Event{
+      const char *name;
+      long long start;
+      long long duration;
+    };
+
+    struct TickerProfile{
+      std::string ticker;
+      int threadIndex;
+      long long start;
+      long long duration;
+      std::vector< Event > events;
+      std::vector< std::pair< const char*, double > > counters;
+      TickerProfile():
+        threadIndex(0),
+        start(0),
+        duration(0){};
+    };
+
+    struct Profile{
+      bool enabled;
+      std::chrono::steady_clock::time_point origin;
+      std::mutex lock;
+      std::vector< TickerProfile > tickers;
+      Profile():enabled(false){};
+    };
+
+    //==========================================================================
+    static Profile& getProfile(){
+      static Profile profile;
+      return profile;
+    };
+
+    //The ticker that the calling thread is evaluating, or nullptr
+    static TickerProfile*& currentTicker(){
+      thread_local TickerProfile *ticker = nullptr;
+      return ticker;
+    };
+
+    static int getThreadIndex(){
+      static std::atomic< int > numberOfThreads(0);
+      thread_local int threadIndex = numberOfThreads.fetch_add(1);
+      return threadIndex;
+    };
+
+    //==========================================================================
+    static void enable(){
+      Profile &profile = getProfile();
+      profile.origin  = std::chrono::steady_clock::now();
+      profile.enabled = true;
+    };
+
+    static bool isEnabled(){
+      return getProfile().enabled;
+    };
+
+    static long long now(){
+      return std::chrono::duration_cast< std::chrono::microseconds >(
+              std::chrono::steady_clock::now()-getProfile().origin).count();
+    };
+
+    //==========================================================================
+    /*
+      Everything timed and counted by the calling thread while this object
+      exists is attributed to ticker.
+    */
+    class TickerScope{
+      public:
+        TickerScope(const std::string &ticker):active(false){
+          if(!isEnabled() || currentTicker() != nullptr){
+            return;
+          }
+          active = true;
+          profile.ticker      = ticker;
+          profile.threadIndex = getThreadIndex();
+          profile.start       = now();
+          currentTicker()     = &profile;
+        };
+        ~TickerScope(){
+          if(!active){
+            return;
+          }
+          profile.duration = now()-profile.start;
+          currentTicker()  = nullptr;
+          Profile &global = getProfile();
+          std::lock_guard< std::mutex > lock(global.lock);
+          global.tickers.push_back(std::move(profile));
+        };
+      private:
+        bool active;
+        TickerProfile profile;
+    };
+
+    //==========================================================================
+    /*
+      Times the scope that it is declared in as the phase name. name must
+      be a string literal.
+    */
+    class ScopedTimer{
+      public:
+        ScopedTimer(const char *name):name(name),ticker(currentTicker()){
+          if(ticker != nullptr){
+            start = now();
+          }
+        };
+        ~ScopedTimer(){
+          if(ticker != nullptr){
+            ticker->events.push_back({name,start,now()-start});
+          }
+        };
+      private:
+        const char *name;
+        TickerProfile *ticker;
+        long long start;
+    };
+
+    //==========================================================================
+    /*
+      Times a sequence of phases in a long function: next ends the current
+      phase and starts the next one, and the last phase ends when the timer
+      goes out of scope (or stop is called).
+    */
+    class PhaseTimer{
+      public:
+        PhaseTimer():name(nullptr),ticker(currentTicker()),start(0){};
+        ~PhaseTimer(){
+          stop();
+        };
+        void next(const char *phaseName){
+          if(ticker == nullptr){
+            return;
+          }
+          long long time = now();
+          if(name != nullptr){
+            ticker->events.push_back({name,start,time-start});
+          }
+          name  = phaseName;
+          start = time;
+        };
+        void stop(){
+          if(ticker == nullptr || name == nullptr){
+            return;
+          }
+          ticker->events.push_back({name,start,now()-start});
+          name = nullptr;
+        };
+      private:
+        const char *name;
+        TickerProfile *ticker;
+        long long start;
+    };
+
+    //==========================================================================
+    static void addCount(const char *name, double count){
+      TickerProfile *ticker = currentTicker();
+      if(ticker != nullptr){
+        ticker->counters.push_back({name,count});
+      }
+    };
+
+    //==========================================================================
+    struct PhaseSummary{
+      double seconds;
+      double maxSeconds;
+      long long calls;
+      std::string maxTicker;
+      PhaseSummary():
+        seconds(0.),
+        maxSeconds(0.),
+        calls(0){};
+    };
+
+    //==========================================================================
+    /*
+      Writes the profile of every ticker, and the totals of each phase and
+      counter over all of the tickers, to profilePath. The same events are
+      written to tracePath in the Chrome trace-event format, which can be
+      opened in chrome://tracing or https://ui.perfetto.dev.
+    */
+    static bool writeProfile(const std::string &profilePath,
+                             const std::string &tracePath){
+
+      Profile &profile = getProfile();
+      std::lock_guard< std::mutex > lock(profile.lock);
+
+      std::vector< TickerProfile* > tickers;
+      for(auto &ticker : profile.tickers){
+        tickers.push_back(&ticker);
+      }
+      std::sort(tickers.begin(),tickers.end(),
+        [](const TickerProfile *a, const TickerProfile *b){
+          return a->duration > b->duration;});
+
+      std::map< std::string, PhaseSummary > phases;
+      std::map< std::string, double > counters;
+      nlohmann::ordered_json tickersJson = nlohmann::ordered_json::array();
+      double totalTickerSeconds = 0.;
+
+      for(auto const *ticker : tickers){
+        std::map< std::string, PhaseSummary > tickerPhases;
+        for(auto const &event : ticker->events){
+          PhaseSummary &summary = tickerPhases[event.name];
+          summary.seconds += static_cast<double>(event.duration)*1e-6;
+          summary.calls   += 1;
+        }
+        std::map< std::string, double > tickerCounters;
+        for(auto const &counter : ticker->counters){
+          tickerCounters[counter.first] += counter.second;
+          counters[counter.first]       += counter.second;
+        }
+
+        nlohmann::ordered_json tickerJson;
+        double tickerSeconds = static_cast<double>(ticker->duration)*1e-6;
+        totalTickerSeconds += tickerSeconds;
+        tickerJson["ticker"]  = ticker->ticker;
+        tickerJson["seconds"] = tickerSeconds;
+        nlohmann::ordered_json tickerPhasesJson;
+        for(auto const &entry : tickerPhases){
+          tickerPhasesJson[entry.first]["seconds"] = entry.second.seconds;
+          tickerPhasesJson[entry.first]["calls"]   = entry.second.calls;
+
+          PhaseSummary &summary = phases[entry.first];
+          summary.seconds += entry.second.seconds;
+          summary.calls   += entry.second.calls;
+          if(entry.second.seconds > summary.maxSeconds){
+            summary.maxSeconds = entry.second.seconds;
+            summary.maxTicker  = ticker->ticker;
+          }
+        }
+        tickerJson["phases"]   = tickerPhasesJson;
+        tickerJson["counters"] = tickerCounters;
+        tickersJson.push_back(tickerJson);
+      }
+
+      //The phases, from the most to the least time consuming
+      std::vector< std::pair< std::string, PhaseSummary > >
+        sortedPhases(phases.begin(),phases.end());
+      std::sort(sortedPhases.begin(),sortedPhases.end(),
+        [](const std::pair< std::string, PhaseSummary > &a,
+           const std::pair< std::string, PhaseSummary > &b){
+          return a.second.seconds > b.second.seconds;});
+
+      nlohmann::ordered_json phasesJson;
+      for(auto const &entry : sortedPhases){
+        nlohmann::ordered_json phaseJson;
+        phaseJson["seconds"]      = entry.second.seconds;
+        phaseJson["calls"]        = entry.second.calls;
+        phaseJson["mean_seconds"] = entry.second.seconds
+          / static_cast<double>(std::max(entry.second.calls,1LL));
+        phaseJson["fraction_of_ticker_time"] =
+          (totalTickerSeconds > 0.) ?
+            entry.second.seconds/totalTickerSeconds : 0.;
+        phaseJson["max_seconds_per_ticker"] = entry.second.maxSeconds;
+        phaseJson["max_ticker"]   = entry.second.maxTicker;
+        phasesJson[entry.first]   = phaseJson;
+      }
+
+      nlohmann::ordered_json profileJson;
+      profileJson["seconds"]            = static_cast<double>(now())*1e-6;
+      profileJson["number_of_tickers"]  = tickers.size();
+      profileJson["ticker_seconds"]     = totalTickerSeconds;
+      profileJson["phases"]             = phasesJson;
+      profileJson["counters"]           = counters;
+      profileJson["tickers"]            = tickersJson;
+
+      std::ofstream profileFile(profilePath,
+          std::ios_base::trunc | std::ios_base::out);
+      if(!profileFile.is_open()){
+        std::cerr << "Warning: could not write the profile "
+                  << profilePath << std::endl;
+        return false;
+      }
+      profileFile << profileJson.dump(2);
+      profileFile.close();
+
+      //Chrome trace-event format: complete (X) events in microseconds
+      int pid = static_cast<int>(getpid());
+      std::ofstream traceFile(tracePath,
+          std::ios_base::trunc | std::ios_base::out);
+      if(!traceFile.is_open()){
+        std::cerr << "Warning: could not write the trace "
+                  << tracePath << std::endl;
+        return false;
+      }
+      traceFile << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+      bool first = true;
+      for(auto const &ticker : profile.tickers){
+        nlohmann::ordered_json event;
+        event["name"] = ticker.ticker;
+        event["cat"]  = "ticker";
+        event["ph"]   = "X";
+        event["ts"]   = ticker.start;
+        event["dur"]  = ticker.duration;
+        event["pid"]  = pid;
+        event["tid"]  = ticker.threadIndex;
+        traceFile << (first ? "\n" : ",\n") << event.dump();
+        first = false;
+        for(auto const &phase : ticker.events){
+          nlohmann::ordered_json phaseEvent;
+          phaseEvent["name"] = phase.name;
+          phaseEvent["cat"]  = "phase";
+          phaseEvent["ph"]   = "X";
+          phaseEvent["ts"]   = phase.start;
+          phaseEvent["dur"]  = phase.duration;
+          phaseEvent["pid"]  = pid;
+          phaseEvent["tid"]  = ticker.threadIndex;
+          phaseEvent["args"]["ticker"] = ticker.ticker;
+          traceFile << ",\n" << phaseEvent.dump();
+        }
+      }
+      traceFile << "\n]}\n";
+      traceFile.close();
+      return true;
+    };
+
+};
+
+#endif
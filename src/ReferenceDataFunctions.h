@@ -0,0 +1,970 @@
+//SPDX-FileCopyrightText: 2023 Matthew Millard millard.matthew@gmail.com
+//SPDX-License-Identifier: MIT
+
+#ifndef REFERENCE_DATA_FUNCTIONS
+#define REFERENCE_DATA_FUNCTIONS
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <filesystem>
+#include <unistd.h>
+#include <nlohmann/json.hpp>
+
+#include "date.h"
+#include "JsonFunctions.h"
+#include "HashFunctions.h"
+
+/*
+  The reference tables that are shared by every ticker: the corporate tax
+  rates by country and year, the country risk table, the default spread
+  table, and the 10 year bond yields.
+
+  These are parsed once into indexed structures so that a lookup does not
+  have to scan the table:
+
+  - the country risk records are indexed by ISO2 and ISO3 code
+  - the tax rates are stored as a country x year matrix, with the countries
+    indexed by ISO2 code and the year found using a binary search
+  - the default spreads are stored as a table of sorted intervals of
+    interest cover that is searched using a binary search
+  - the bond yields are indexed by day, and the days between two records
+    are linearly interpolated
+
+  The tables can be written to (and read from) a binary snapshot, which
+  records a hash of the files that the tables were parsed from, so that the
+  json and csv files only have to be parsed when they change.
+*/
+class ReferenceDataFunctions {
+
+  public:
+
+    //==========================================================================
+    struct TaxFoundationDataSet{
+      std::vector< int > index;
+      std::vector< int > year;
+      std::vector< std::string > CountryISO2;
+      std::vector< std::string > CountryISO3;
+      std::vector< std::string > continent;
+      std::vector< std::string > country;
+      std::vector< std::vector < double > > taxTable;
+    };
+
+    //==========================================================================
+    struct CountryRiskDataSet{
+      std::string Country;
+      std::string CountryISO2;
+      std::string CountryISO3;
+      double PRS;
+      double defaultSpread;
+      double ERP;
+      double taxRate;
+      double CRP;
+      double inflation_2019_2023;
+      double inflation_2024_2028;
+      double riskFreeRate;
+
+      CountryRiskDataSet():
+        PRS(std::nan("1")),
+        defaultSpread(std::nan("1")),
+        ERP(std::nan("1")),
+        taxRate(std::nan("1")),
+        CRP(std::nan("1")),
+        inflation_2019_2023(std::nan("1")),
+        inflation_2024_2028(std::nan("1")),
+        riskFreeRate(std::nan("1")){}
+    };
+
+    //==========================================================================
+    struct CountryRiskTable{
+      std::vector< CountryRiskDataSet > countries;
+      std::unordered_map< std::string, size_t > indexOfISO2;
+      std::unordered_map< std::string, size_t > indexOfISO3;
+    };
+
+    //==========================================================================
+    struct TaxRateTable{
+      std::vector< int > years;                 //ascending
+      std::vector< std::string > countryISO2;
+      std::vector< std::string > countryISO3;
+      std::vector< double > taxRates;           //country-major: in percent
+      std::unordered_map< std::string, size_t > indexOfISO2;
+    };
+
+    //==========================================================================
+    struct DefaultSpreadTable{
+      //Every row of the table
+      std::vector< double > interestCoverLowerBound;
+      std::vector< double > interestCoverUpperBound;
+      std::vector< double > defaultSpread;
+      //Only the rows with valid entries
+      std::vector< double > validLowerBound;
+      std::vector< double > validUpperBound;
+      std::vector< double > validDefaultSpread;
+      bool sortedIntervals;
+      DefaultSpreadTable():sortedIntervals(false){};
+    };
+
+    //==========================================================================
+    struct BondYieldTable{
+      //The records in the order that they appear in the file
+      std::vector< std::string > dates;
+      std::vector< double > yields;           //in percent
+      std::vector< int > isNumeric;           //1: the entry is a number
+      //Indexed by the number of days since firstDay
+      int firstDay;
+      std::vector< int > recordIndexByDay;    //-1: no record on this day
+      std::vector< double > yieldByDay;       //interpolated between records
+      BondYieldTable():firstDay(0){};
+    };
+
+    //==========================================================================
+    struct ReferenceTables{
+      bool usingTaxTable;
+      TaxRateTable taxRates;
+      DefaultSpreadTable defaultSpreads;
+      std::string defaultSpreadDate;
+      BondYieldTable bondYields;
+      bool validRiskTable;
+      CountryRiskTable countryRisk;
+      std::string countryRiskDate;
+      ReferenceTables():
+        usingTaxTable(false),
+        validRiskTable(false){};
+    };
+
+    static constexpr uint64_t SNAPSHOT_MAGIC   = 0x5245464441544131ULL;
+    static constexpr uint32_t SNAPSHOT_VERSION = 1;
+
+    //==========================================================================
+    static bool loadTaxFoundationDataSet(const std::string &fileName,
+                                         TaxFoundationDataSet &dataSet){
+
+      bool validFormat=false;
+
+      std::ifstream file(fileName);
+
+      if(file.is_open()){
+        validFormat=true;
+        std::string line;
+        std::string entry;
+
+        //First line is the header: check entries + read in years
+        std::getline(file,line);
+
+        std::size_t idx0=0;
+        std::size_t idx1=0;
+        int column = 0;
+        std::vector< double > dataRow;
+        dataRow.clear();
+
+        idx1 = line.find_first_of(',',idx0);
+        entry = line.substr(idx0,idx1-idx0);
+
+        do{
+            if(column <= 4){
+              switch(column){
+                case 1:{
+                    if(entry.compare("iso_2") != 0){
+                      validFormat=false;
+                    }
+                }break;
+                case 2:{
+                  if(entry.compare("iso_3") != 0){
+                      validFormat=false;
+                  }
+                } break;
+                case 3:{
+                  if(entry.compare("continent") != 0){
+                      validFormat=false;
+                  }
+                }break;
+                case 4:{
+                  if(entry.compare("country") != 0){
+                      validFormat=false;
+                  }
+                }break;
+              };
+            }else{
+              if(entry.compare("NA") == 0){
+                dataSet.year.push_back(-1);
+                validFormat=false;
+              }else{
+                dataSet.year.push_back(std::stoi(entry));
+              }
+            }
+
+            idx0 = idx1+1;
+            idx1 = line.find_first_of(',',idx0);
+            entry = line.substr(idx0,idx1-idx0);
+
+            ++column;
+        }while(    idx0 !=  std::string::npos
+                && idx1 !=  std::string::npos
+                && validFormat);
+
+
+        //Read in the data table
+        while(std::getline(file,line) && validFormat){
+
+            idx0=0;
+            idx1=0;
+            dataRow.clear();
+            column = 0;
+            idx1 = line.find_first_of(',',idx0);
+            entry = line.substr(idx0,idx1-idx0);
+
+            do{
+
+
+              if(column <= 4){
+                switch(column){
+                  case 0:{
+                      dataSet.index.push_back(std::stoi(entry));
+                  } break;
+                  case 1:{
+                      dataSet.CountryISO2.push_back(entry);
+                  }break;
+                  case 2:{
+                    dataSet.CountryISO3.push_back(entry);
+                  } break;
+                  case 3:{
+                    dataSet.continent.push_back(entry);
+                  }break;
+                  case 4:{
+                    dataSet.country.push_back(entry);
+                  }break;
+                };
+              }else{
+                if(entry.compare("NA") == 0){
+                  dataRow.push_back(std::nan("1"));
+                }else{
+                  dataRow.push_back(std::stod(entry));
+                }
+              }
+              idx0 = idx1+1;
+              idx1 = line.find_first_of(',',idx0);
+              entry = line.substr(idx0,idx1-idx0);
+
+              if(entry.find_first_of('"') != std::string::npos){
+                //Opening bracket
+                idx1 = line.find_first_of('"',idx0);
+                //Closing bracket
+                idx1 = line.find_first_of('"',idx1+1);
+                //Final comma
+                idx1 = line.find_first_of(',',idx1);
+                entry = line.substr(idx0,idx1-idx0);
+              }
+
+              ++column;
+            }while( idx0 !=  std::string::npos && idx1 !=  std::string::npos );
+
+            dataSet.taxTable.push_back(dataRow);
+
+
+        }
+        file.close();
+      }else{
+       std::cout << " Warning: Reverting to default tax rate. Failed to "
+                 << " read in " << fileName << std::endl;
+      }
+
+      return validFormat;
+    };
+
+    //==========================================================================
+    /*
+      Copies the Tax Foundation data set into a country x year matrix. The
+      years must be in ascending order so that they can be searched with a
+      binary search.
+    */
+    static bool buildTaxRateTable(const TaxFoundationDataSet &dataSet,
+                                  TaxRateTable &tableUpd){
+      tableUpd = TaxRateTable();
+
+      if(!std::is_sorted(dataSet.year.begin(),dataSet.year.end())){
+        std::cout << "Warning: the years in the corporate tax rate table are "
+                  << "not in ascending order" << std::endl;
+        return false;
+      }
+
+      size_t numberOfYears = dataSet.year.size();
+      tableUpd.years = dataSet.year;
+      tableUpd.countryISO2 = dataSet.CountryISO2;
+      tableUpd.countryISO3 = dataSet.CountryISO3;
+      tableUpd.taxRates.resize(dataSet.taxTable.size()*numberOfYears,
+                               std::nan("1"));
+
+      for(size_t i=0; i < dataSet.taxTable.size(); ++i){
+        size_t n = std::min(numberOfYears, dataSet.taxTable[i].size());
+        for(size_t j=0; j<n; ++j){
+          tableUpd.taxRates[i*numberOfYears + j] = dataSet.taxTable[i][j];
+        }
+      }
+      indexTaxRateTable(tableUpd);
+      return true;
+    };
+
+    //==========================================================================
+    static void indexTaxRateTable(TaxRateTable &tableUpd){
+      tableUpd.indexOfISO2.clear();
+      for(size_t i=0; i<tableUpd.countryISO2.size(); ++i){
+        //The first entry of a country is used, as before
+        tableUpd.indexOfISO2.insert({tableUpd.countryISO2[i],i});
+      }
+    };
+
+    //==========================================================================
+    /*
+      Returns the tax rate (in percent) of the most recent year that is not
+      later than year, and not earlier than yearMin, that has an entry. If
+      the year is not in the table the closest later year is used. NaN is
+      returned if the country is not in the table or if there is no entry.
+    */
+    static double getTaxRate(const TaxRateTable &table,
+                             const std::string &countryISO2,
+                             int year,
+                             int yearMin){
+
+      double taxRate = std::numeric_limits<double>::quiet_NaN();
+
+      auto country = table.indexOfISO2.find(countryISO2);
+      if(country == table.indexOfISO2.end() || table.years.size()==0){
+        return taxRate;
+      }
+      size_t indexCountry = country->second;
+      int numberOfYears = static_cast<int>(table.years.size());
+
+      int indexYearMin = static_cast<int>(
+        std::lower_bound(table.years.begin(),table.years.end(),yearMin)
+        -table.years.begin());
+      indexYearMin = std::min(indexYearMin, numberOfYears-1);
+
+      int indexYear = static_cast<int>(
+        std::lower_bound(table.years.begin()+indexYearMin,
+                         table.years.end(),year)
+        -table.years.begin());
+      indexYear = std::min(indexYear, numberOfYears-1);
+
+      //Scan backwards from the most recent acceptable year to year min
+      //and return the first valid tax rate
+      if(indexYear > 0 && indexYearMin > 0){
+        const double *taxRates =
+          &table.taxRates[indexCountry*table.years.size()];
+        int index = indexYear;
+        taxRate = taxRates[index];
+        while( std::isnan(taxRate) && index > indexYearMin){
+          --index;
+          taxRate = taxRates[index];
+        }
+      }
+
+      return taxRate;
+    };
+
+    //==========================================================================
+    static void loadCountryRiskTable(
+                  const nlohmann::ordered_json &riskByCountryData,
+                  CountryRiskTable &tableUpd){
+
+      tableUpd = CountryRiskTable();
+      if(!riskByCountryData.contains("data")){
+        return;
+      }
+
+      for(auto &riskEntry : riskByCountryData["data"]){
+        CountryRiskDataSet riskTable;
+
+        JsonFunctions::getJsonString(riskEntry["CountryISO2"],
+                                    riskTable.CountryISO2);
+
+        JsonFunctions::getJsonString(riskEntry["CountryISO3"],
+                                    riskTable.CountryISO3);
+
+        JsonFunctions::getJsonString(riskEntry["Country"],
+                                    riskTable.Country);
+
+        riskTable.PRS
+              = JsonFunctions::getJsonFloat(
+                  riskEntry["PRS"]);
+
+        riskTable.defaultSpread
+              = JsonFunctions::getJsonFloat(
+                  riskEntry["defaultSpread"])*0.01;
+
+        riskTable.ERP
+              = JsonFunctions::getJsonFloat(
+                  riskEntry["ERP"])*0.01;
+
+        riskTable.taxRate
+              = JsonFunctions::getJsonFloat(
+                  riskEntry["taxRate"])*0.01;
+
+        riskTable.CRP
+              = JsonFunctions::getJsonFloat(
+                  riskEntry["CRP"])*0.01;
+
+        riskTable.inflation_2019_2023
+              = JsonFunctions::getJsonFloat(
+                  riskEntry["inflation_2019_2023"])*0.01;
+
+        riskTable.inflation_2024_2028
+              = JsonFunctions::getJsonFloat(
+                  riskEntry["inflation_2024_2028"])*0.01;
+
+        riskTable.riskFreeRate
+              = JsonFunctions::getJsonFloat(
+                  riskEntry["riskFreeRate"])*0.01;
+
+        tableUpd.countries.push_back(riskTable);
+      }
+      indexCountryRiskTable(tableUpd);
+    };
+
+    //==========================================================================
+    static void indexCountryRiskTable(CountryRiskTable &tableUpd){
+      tableUpd.indexOfISO2.clear();
+      tableUpd.indexOfISO3.clear();
+      for(size_t i=0; i<tableUpd.countries.size(); ++i){
+        //The first entry of a country is used, as before
+        tableUpd.indexOfISO2.insert({tableUpd.countries[i].CountryISO2,i});
+        tableUpd.indexOfISO3.insert({tableUpd.countries[i].CountryISO3,i});
+      }
+    };
+
+    //==========================================================================
+    static const CountryRiskDataSet* findCountryByISO2(
+                                        const CountryRiskTable &table,
+                                        const std::string &countryISO2){
+      auto country = table.indexOfISO2.find(countryISO2);
+      if(country == table.indexOfISO2.end()){
+        return nullptr;
+      }
+      return &table.countries[country->second];
+    };
+
+    //==========================================================================
+    static const CountryRiskDataSet* findCountryByISO3(
+                                        const CountryRiskTable &table,
+                                        const std::string &countryISO3){
+      auto country = table.indexOfISO3.find(countryISO3);
+      if(country == table.indexOfISO3.end()){
+        return nullptr;
+      }
+      return &table.countries[country->second];
+    };
+
+    //==========================================================================
+    /*
+      Reads the ["US"]["default_spread"] table: each row is an interval of
+      interest cover (lower bound, upper bound) and the default spread of
+      that interval. Returns false if the table is empty.
+    */
+    static bool loadDefaultSpreadTable(
+                  const nlohmann::ordered_json &jsonDefaultSpread,
+                  bool setNansToMissingValue,
+                  DefaultSpreadTable &tableUpd){
+
+      tableUpd = DefaultSpreadTable();
+
+      if(!jsonDefaultSpread.contains("US")
+        || !jsonDefaultSpread["US"].contains("default_spread")
+        || jsonDefaultSpread["US"]["default_spread"].size()==0){
+        return false;
+      }
+
+      for(auto &row : jsonDefaultSpread["US"]["default_spread"]){
+        tableUpd.interestCoverLowerBound.push_back(
+          JsonFunctions::getJsonFloat(row.at(0),setNansToMissingValue));
+        tableUpd.interestCoverUpperBound.push_back(
+          JsonFunctions::getJsonFloat(row.at(1),setNansToMissingValue));
+        tableUpd.defaultSpread.push_back(
+          JsonFunctions::getJsonFloat(row.at(2),setNansToMissingValue));
+      }
+      indexDefaultSpreadTable(tableUpd);
+      return true;
+    };
+
+    //==========================================================================
+    static void indexDefaultSpreadTable(DefaultSpreadTable &tableUpd){
+      tableUpd.validLowerBound.clear();
+      tableUpd.validUpperBound.clear();
+      tableUpd.validDefaultSpread.clear();
+
+      for(size_t i=0; i<tableUpd.defaultSpread.size(); ++i){
+        if(    JsonFunctions::isJsonFloatValid(tableUpd.interestCoverLowerBound[i])
+            && JsonFunctions::isJsonFloatValid(tableUpd.interestCoverUpperBound[i])
+            && JsonFunctions::isJsonFloatValid(tableUpd.defaultSpread[i])){
+          tableUpd.validLowerBound.push_back(tableUpd.interestCoverLowerBound[i]);
+          tableUpd.validUpperBound.push_back(tableUpd.interestCoverUpperBound[i]);
+          tableUpd.validDefaultSpread.push_back(tableUpd.defaultSpread[i]);
+        }
+      }
+
+      //The binary search is only used if the intervals are in order and do
+      //not overlap (other than at their end points)
+      tableUpd.sortedIntervals = true;
+      for(size_t i=0; i<tableUpd.validLowerBound.size(); ++i){
+        if(tableUpd.validLowerBound[i] > tableUpd.validUpperBound[i]){
+          tableUpd.sortedIntervals = false;
+        }
+        if(i > 0 && tableUpd.validUpperBound[i-1] > tableUpd.validLowerBound[i]){
+          tableUpd.sortedIntervals = false;
+        }
+      }
+    };
+
+    //==========================================================================
+    static double getInterestCoverLowestValue(const DefaultSpreadTable &table){
+      return table.interestCoverLowerBound.front();
+    };
+
+    //==========================================================================
+    static double getInterestCoverHighestValue(const DefaultSpreadTable &table){
+      return table.interestCoverUpperBound.back();
+    };
+
+    //==========================================================================
+    /*
+      Returns the default spread of the first interval that contains the
+      interest cover. Interest covers below (above) the table take the
+      spread of the first (last) row. If no interval contains the interest
+      cover NaN (or the missing value) is returned.
+    */
+    static double getDefaultSpread(const DefaultSpreadTable &table,
+                                   double interestCover,
+                                   bool setNansToMissingValue){
+
+      double defaultSpread = std::nan("1");
+      if(setNansToMissingValue){
+        defaultSpread = JsonFunctions::MISSING_VALUE;
+      }
+
+      double interestCoverLowestValue  = getInterestCoverLowestValue(table);
+      double interestCoverHighestValue = getInterestCoverHighestValue(table);
+
+      if(interestCover < interestCoverLowestValue
+        && JsonFunctions::isJsonFloatValid(interestCoverLowestValue)){
+        return table.defaultSpread.front();
+      }
+      if(interestCover > interestCoverHighestValue
+        && JsonFunctions::isJsonFloatValid(interestCoverHighestValue)){
+        return table.defaultSpread.back();
+      }
+
+      if(table.sortedIntervals){
+        auto upper = std::lower_bound(table.validUpperBound.begin(),
+                                      table.validUpperBound.end(),
+                                      interestCover);
+        size_t i = static_cast<size_t>(upper-table.validUpperBound.begin());
+        if(i < table.validUpperBound.size()
+            && interestCover >= table.validLowerBound[i]){
+          defaultSpread = table.validDefaultSpread[i];
+        }
+      }else{
+        for(size_t i=0; i<table.validLowerBound.size(); ++i){
+          if(interestCover >= table.validLowerBound[i]
+            && interestCover <= table.validUpperBound[i]){
+            defaultSpread = table.validDefaultSpread[i];
+            break;
+          }
+        }
+      }
+      return defaultSpread;
+    };
+
+    //==========================================================================
+    static int convertDateToDayNumber(const std::string &dateString){
+      std::istringstream dateStream(dateString);
+      dateStream.exceptions(std::ios::failbit);
+      date::sys_days day;
+      dateStream >> date::parse("%Y-%m-%d",day);
+      return day.time_since_epoch().count();
+    };
+
+    //==========================================================================
+    /*
+      Reads the ["US"]["10y_bond_yield"] table (date : yield in percent) and
+      indexes it by day. Returns false if the table is empty.
+    */
+    static bool loadBondYieldTable(const nlohmann::ordered_json &jsonBondYield,
+                                   bool setNansToMissingValue,
+                                   BondYieldTable &tableUpd){
+      tableUpd = BondYieldTable();
+
+      if(!jsonBondYield.contains("US")
+        || !jsonBondYield["US"].contains("10y_bond_yield")
+        || jsonBondYield["US"]["10y_bond_yield"].size()==0){
+        return false;
+      }
+
+      for(auto &el : jsonBondYield["US"]["10y_bond_yield"].items()){
+        tableUpd.dates.push_back(el.key());
+        double yield = std::nan("1");
+        int isNumeric = 1;
+        try{
+          yield = JsonFunctions::getJsonFloat(el.value(),setNansToMissingValue);
+        }catch( std::invalid_argument const& ex){
+          isNumeric = 0;
+        }
+        tableUpd.yields.push_back(yield);
+        tableUpd.isNumeric.push_back(isNumeric);
+      }
+      indexBondYieldTable(tableUpd);
+      return true;
+    };
+
+    //==========================================================================
+    static void indexBondYieldTable(BondYieldTable &tableUpd){
+
+      std::vector< int > days(tableUpd.dates.size());
+      for(size_t i=0; i<tableUpd.dates.size(); ++i){
+        days[i] = convertDateToDayNumber(tableUpd.dates[i]);
+      }
+      int firstDay = *std::min_element(days.begin(),days.end());
+      int lastDay  = *std::max_element(days.begin(),days.end());
+
+      tableUpd.firstDay = firstDay;
+      tableUpd.recordIndexByDay.assign(lastDay-firstDay+1,-1);
+      tableUpd.yieldByDay.assign(lastDay-firstDay+1,std::nan("1"));
+
+      for(size_t i=0; i<days.size(); ++i){
+        tableUpd.recordIndexByDay[days[i]-firstDay] = static_cast<int>(i);
+        tableUpd.yieldByDay[days[i]-firstDay] = tableUpd.yields[i];
+      }
+
+      //Linearly interpolate between neighbouring numeric records
+      int previousDay = -1;
+      for(int day=0; day < static_cast<int>(tableUpd.yieldByDay.size()); ++day){
+        int index = tableUpd.recordIndexByDay[day];
+        if(index < 0 || tableUpd.isNumeric[index]==0
+                     || std::isnan(tableUpd.yields[index])){
+          continue;
+        }
+        if(previousDay >= 0 && day-previousDay > 1){
+          double y0 = tableUpd.yieldByDay[previousDay];
+          double y1 = tableUpd.yieldByDay[day];
+          double span = static_cast<double>(day-previousDay);
+          for(int j=previousDay+1; j<day; ++j){
+            if(tableUpd.recordIndexByDay[j] < 0){
+              double t = static_cast<double>(j-previousDay)/span;
+              tableUpd.yieldByDay[j] = y0 + t*(y1-y0);
+            }
+          }
+        }
+        previousDay = day;
+      }
+    };
+
+    //==========================================================================
+    /*
+      Returns the index of the record on this date, or -1 if there is no
+      record on this date.
+    */
+    static int getBondYieldRecordIndex(const BondYieldTable &table,
+                                       const std::string &dateString){
+      int day = convertDateToDayNumber(dateString) - table.firstDay;
+      if(day < 0 || day >= static_cast<int>(table.recordIndexByDay.size())){
+        return -1;
+      }
+      return table.recordIndexByDay[day];
+    };
+
+    //==========================================================================
+    /*
+      Returns the bond yield (in percent) on this date, linearly
+      interpolated between the neighbouring records. NaN is returned for
+      dates outside of the table.
+    */
+    static double getBondYield(const BondYieldTable &table,
+                               const std::string &dateString){
+      int day = convertDateToDayNumber(dateString) - table.firstDay;
+      if(day < 0 || day >= static_cast<int>(table.yieldByDay.size())){
+        return std::nan("1");
+      }
+      return table.yieldByDay[day];
+    };
+
+    //==========================================================================
+    // Binary snapshot
+    //==========================================================================
+    template< typename T >
+    static void writeValue(std::ofstream &stream, const T &value){
+      stream.write(reinterpret_cast<const char*>(&value),sizeof(T));
+    };
+
+    template< typename T >
+    static bool readValue(std::ifstream &stream, T &valueUpd){
+      stream.read(reinterpret_cast<char*>(&valueUpd),sizeof(T));
+      return static_cast<bool>(stream);
+    };
+
+    //==========================================================================
+    /*
+      The number of bytes between the read position and the end of the
+      stream. The counts read from a snapshot are checked against this before
+      anything is allocated, so that a truncated or corrupt snapshot is
+      rejected (and the tables are built again) rather than causing an
+      enormous allocation.
+    */
+    static uint64_t getRemainingBytes(std::ifstream &stream){
+      std::streampos position = stream.tellg();
+      if(position < 0){
+        return 0;
+      }
+      stream.seekg(0,std::ios::end);
+      std::streampos end = stream.tellg();
+      stream.seekg(position);
+      if(end < position){
+        return 0;
+      }
+      return static_cast<uint64_t>(end-position);
+    };
+
+    template< typename T >
+    static void writeVector(std::ofstream &stream, const std::vector< T > &values){
+      writeValue(stream, static_cast<uint64_t>(values.size()));
+      stream.write(reinterpret_cast<const char*>(values.data()),
+                   values.size()*sizeof(T));
+    };
+
+    template< typename T >
+    static bool readVector(std::ifstream &stream, std::vector< T > &valuesUpd){
+      uint64_t n=0;
+      if(!readValue(stream,n)){
+        return false;
+      }
+      if(n > getRemainingBytes(stream)/sizeof(T)){
+        stream.setstate(std::ios::failbit);
+        return false;
+      }
+      valuesUpd.resize(n);
+      stream.read(reinterpret_cast<char*>(valuesUpd.data()),n*sizeof(T));
+      return static_cast<bool>(stream);
+    };
+
+    static void writeString(std::ofstream &stream, const std::string &text){
+      writeValue(stream, static_cast<uint64_t>(text.size()));
+      stream.write(text.data(),text.size());
+    };
+
+    static bool readString(std::ifstream &stream, std::string &textUpd){
+      uint64_t n=0;
+      if(!readValue(stream,n)){
+        return false;
+      }
+      if(n > getRemainingBytes(stream)){
+        stream.setstate(std::ios::failbit);
+        return false;
+      }
+      textUpd.resize(n);
+      stream.read(&textUpd[0],n);
+      return static_cast<bool>(stream);
+    };
+
+    static void writeStringVector(std::ofstream &stream,
+                                  const std::vector< std::string > &values){
+      writeValue(stream, static_cast<uint64_t>(values.size()));
+      for(auto const &value : values){
+        writeString(stream,value);
+      }
+    };
+
+    static bool readStringVector(std::ifstream &stream,
+                                 std::vector< std::string > &valuesUpd){
+      uint64_t n=0;
+      if(!readValue(stream,n)){
+        return false;
+      }
+      //Each string is stored with (at least) its 8 byte length
+      if(n > getRemainingBytes(stream)/sizeof(uint64_t)){
+        stream.setstate(std::ios::failbit);
+        return false;
+      }
+      valuesUpd.resize(n);
+      for(auto &value : valuesUpd){
+        if(!readString(stream,value)){
+          return false;
+        }
+      }
+      return true;
+    };
+
+    //==========================================================================
+    /*
+      A hash of the files that the tables are parsed from, and of the option
+      that changes how missing values are parsed. A snapshot is only used if
+      this matches the hash stored in the snapshot.
+    */
+    static uint64_t calcSourceHash(const std::vector< std::string > &filePaths,
+                                   bool setNansToMissingValue){
+      uint64_t hash = HashFunctions::FNV_OFFSET;
+      for(auto const &filePath : filePaths){
+        uint64_t fileHash = 0;
+        if(HashFunctions::calcFileHash(filePath,fileHash)){
+          hash = HashFunctions::appendToHash(hash,
+                    HashFunctions::convertHashToString(fileHash));
+        }else{
+          hash = HashFunctions::appendToHash(hash, std::string("missing"));
+        }
+      }
+      hash = HashFunctions::appendToHash(hash,
+                static_cast<double>(setNansToMissingValue));
+      return hash;
+    };
+
+    //==========================================================================
+    static bool writeSnapshot(const std::string &snapshotPath,
+                              uint64_t sourceHash,
+                              const ReferenceTables &tables){
+
+      //Several processes (e.g. shards) can write the same snapshot
+      std::string temporaryPath(snapshotPath);
+      temporaryPath.append(".tmp");
+      temporaryPath.append(std::to_string(getpid()));
+
+      std::ofstream stream(temporaryPath,
+          std::ios::out | std::ios::binary | std::ios::trunc);
+      if(!stream.is_open()){
+        return false;
+      }
+
+      writeValue(stream, SNAPSHOT_MAGIC);
+      writeValue(stream, SNAPSHOT_VERSION);
+      writeValue(stream, sourceHash);
+
+      writeValue(stream, static_cast<int>(tables.usingTaxTable));
+      writeVector(stream, tables.taxRates.years);
+      writeStringVector(stream, tables.taxRates.countryISO2);
+      writeStringVector(stream, tables.taxRates.countryISO3);
+      writeVector(stream, tables.taxRates.taxRates);
+
+      writeVector(stream, tables.defaultSpreads.interestCoverLowerBound);
+      writeVector(stream, tables.defaultSpreads.interestCoverUpperBound);
+      writeVector(stream, tables.defaultSpreads.defaultSpread);
+      writeString(stream, tables.defaultSpreadDate);
+
+      writeStringVector(stream, tables.bondYields.dates);
+      writeVector(stream, tables.bondYields.yields);
+      writeVector(stream, tables.bondYields.isNumeric);
+
+      writeValue(stream, static_cast<int>(tables.validRiskTable));
+      writeValue(stream, static_cast<uint64_t>(tables.countryRisk.countries.size()));
+      for(auto const &country : tables.countryRisk.countries){
+        writeString(stream, country.Country);
+        writeString(stream, country.CountryISO2);
+        writeString(stream, country.CountryISO3);
+        writeValue(stream, country.PRS);
+        writeValue(stream, country.defaultSpread);
+        writeValue(stream, country.ERP);
+        writeValue(stream, country.taxRate);
+        writeValue(stream, country.CRP);
+        writeValue(stream, country.inflation_2019_2023);
+        writeValue(stream, country.inflation_2024_2028);
+        writeValue(stream, country.riskFreeRate);
+      }
+      writeString(stream, tables.countryRiskDate);
+
+      bool success = static_cast<bool>(stream);
+      stream.close();
+      std::error_code errorCode;
+      if(success){
+        std::filesystem::rename(temporaryPath, snapshotPath, errorCode);
+        success = !errorCode;
+      }
+      if(!success){
+        std::filesystem::remove(temporaryPath, errorCode);
+      }
+      return success;
+    };
+
+    //==========================================================================
+    /*
+      Reads a snapshot written by writeSnapshot. Returns false if the file
+      does not exist, was written by a different version, was made from
+      different source files, or is truncated.
+    */
+    static bool readSnapshot(const std::string &snapshotPath,
+                             uint64_t sourceHash,
+                             ReferenceTables &tablesUpd){
+
+      std::ifstream stream(snapshotPath, std::ios::in | std::ios::binary);
+      if(!stream.is_open()){
+        return false;
+      }
+
+      uint64_t magic = 0;
+      uint32_t version = 0;
+      uint64_t snapshotSourceHash = 0;
+      if(!readValue(stream,magic) || magic != SNAPSHOT_MAGIC
+        || !readValue(stream,version) || version != SNAPSHOT_VERSION
+        || !readValue(stream,snapshotSourceHash)
+        || snapshotSourceHash != sourceHash){
+        return false;
+      }
+
+      ReferenceTables tables;
+      int flag = 0;
+      bool valid = readValue(stream, flag);
+      tables.usingTaxTable = (flag != 0);
+      valid = valid && readVector(stream, tables.taxRates.years);
+      valid = valid && readStringVector(stream, tables.taxRates.countryISO2);
+      valid = valid && readStringVector(stream, tables.taxRates.countryISO3);
+      valid = valid && readVector(stream, tables.taxRates.taxRates);
+
+      valid = valid && readVector(stream,
+                        tables.defaultSpreads.interestCoverLowerBound);
+      valid = valid && readVector(stream,
+                        tables.defaultSpreads.interestCoverUpperBound);
+      valid = valid && readVector(stream, tables.defaultSpreads.defaultSpread);
+      valid = valid && readString(stream, tables.defaultSpreadDate);
+
+      valid = valid && readStringVector(stream, tables.bondYields.dates);
+      valid = valid && readVector(stream, tables.bondYields.yields);
+      valid = valid && readVector(stream, tables.bondYields.isNumeric);
+
+      valid = valid && readValue(stream, flag);
+      tables.validRiskTable = (flag != 0);
+      uint64_t numberOfCountries = 0;
+      valid = valid && readValue(stream, numberOfCountries);
+      for(uint64_t i=0; i<numberOfCountries && valid; ++i){
+        CountryRiskDataSet country;
+        valid = valid && readString(stream, country.Country);
+        valid = valid && readString(stream, country.CountryISO2);
+        valid = valid && readString(stream, country.CountryISO3);
+        valid = valid && readValue(stream, country.PRS);
+        valid = valid && readValue(stream, country.defaultSpread);
+        valid = valid && readValue(stream, country.ERP);
+        valid = valid && readValue(stream, country.taxRate);
+        valid = valid && readValue(stream, country.CRP);
+        valid = valid && readValue(stream, country.inflation_2019_2023);
+        valid = valid && readValue(stream, country.inflation_2024_2028);
+        valid = valid && readValue(stream, country.riskFreeRate);
+        tables.countryRisk.countries.push_back(country);
+      }
+      valid = valid && readString(stream, tables.countryRiskDate);
+
+      if(!valid || tables.defaultSpreads.defaultSpread.size()==0
+                || tables.bondYields.dates.size()==0){
+        return false;
+      }
+
+      indexTaxRateTable(tables.taxRates);
+      indexDefaultSpreadTable(tables.defaultSpreads);
+      indexBondYieldTable(tables.bondYields);
+      indexCountryRiskTable(tables.countryRisk);
+
+      tablesUpd = std::move(tables);
+      return true;
+    };
+
+};
+
+#endif
@@ -0,0 +1,407 @@
+//SPDX-FileCopyrightText: 2023 Matthew Millard millard.matthew@gmail.com
+//SPDX-License-Identifier: MIT
+
+#ifndef REGRESSION_FUNCTIONS
+#define REGRESSION_FUNCTIONS
+
+#include <cmath>
+#include <vector>
+#include <iostream>
+#include <algorithm>
+#include <Eigen/Dense>
+
+/*
+  Linear least-squares fits using Eigen. A problem is described by a basis
+  (the design matrix A, one column per basis function) and one or more
+  series of observations (the columns of Y). The basis is decomposed once
+  and the decomposition is used to solve for every series, so fitting many
+  series that share the same sample points (e.g. a metric and its logarithm,
+  or several metrics over the same window of dates) costs little more than
+  fitting one. The decomposition can also be kept and reused directly.
+
+  The coefficients, the residuals, and the R2 of every series are returned
+  together. R2 is evaluated in the same way as NumericalFunctions::calcR2.
+*/
+class RegressionFunctions {
+
+  public:
+
+    //==========================================================================
+    /*
+      The column pivoting QR decomposition of a basis
+    */
+    struct LeastSquaresDecomposition{
+      Eigen::ColPivHouseholderQR< Eigen::MatrixXd > qr;
+      bool valid;
+      LeastSquaresDecomposition():valid(false){};
+    };
+
+    //==========================================================================
+    /*
+      @param coefficients : one column of coefficients per series
+      @param residuals : Y - A*coefficients
+      @param r2 : the coefficient of determination of each series
+      @param valid : false if the basis is rank deficient (e.g. all of the
+                     sample points are the same) or the sizes do not agree
+    */
+    struct LeastSquaresSolution{
+      Eigen::MatrixXd coefficients;
+      Eigen::MatrixXd residuals;
+      Eigen::VectorXd r2;
+      bool valid;
+      LeastSquaresSolution():valid(false){};
+    };
+
+    //==========================================================================
+    /*
+      The basis 1, (x-x0), (x-x0)^2, ... (x-x0)^order
+    */
+    static void createPolynomialBasis(const std::vector< double > &x,
+                                      double x0,
+                                      int order,
+                                      Eigen::MatrixXd &basisUpd){
+      basisUpd.resize(x.size(),order+1);
+      for(size_t i=0; i<x.size(); ++i){
+        double w    = x[i]-x0;
+        double term = 1.0;
+        for(int j=0; j<=order; ++j){
+          basisUpd(i,j) = term;
+          term *= w;
+        }
+      }
+    };
+
+    //==========================================================================
+    /*
+      Copies several series of the same length into the columns of a matrix
+    */
+    static void createObservationMatrix(
+                  const std::vector< const std::vector< double >* > &series,
+                  Eigen::MatrixXd &observationsUpd){
+      size_t n = series.empty() ? 0 : series[0]->size();
+      observationsUpd.resize(n,series.size());
+      for(size_t j=0; j<series.size(); ++j){
+        for(size_t i=0; i<n; ++i){
+          observationsUpd(i,j) = (*series[j])[i];
+        }
+      }
+    };
+
+    //==========================================================================
+    static void decompose(const Eigen::MatrixXd &basis,
+                          LeastSquaresDecomposition &decompositionUpd){
+      decompositionUpd.qr.compute(basis);
+      decompositionUpd.valid =
+        (basis.rows() >= basis.cols())
+        && (decompositionUpd.qr.rank() == basis.cols());
+    };
+
+    //==========================================================================
+    /*
+      Solves min |A*c - y| for every column y of observations using a
+      decomposition of A made by decompose.
+    */
+    static bool solve(const Eigen::MatrixXd &basis,
+                      const LeastSquaresDecomposition &decomposition,
+                      const Eigen::MatrixXd &observations,
+                      LeastSquaresSolution &solutionUpd){
+
+      solutionUpd.valid = decomposition.valid
+                          && observations.rows() == basis.rows();
+      if(!solutionUpd.valid){
+        return false;
+      }
+
+      solutionUpd.coefficients = decomposition.qr.solve(observations);
+      solutionUpd.residuals    = observations
+                               - basis*solutionUpd.coefficients;
+
+      solutionUpd.r2.resize(observations.cols());
+      for(Eigen::Index j=0; j<observations.cols(); ++j){
+        double mean = observations.col(j).mean();
+        double totalSumOfSquares =
+          (observations.col(j).array()-mean).square().sum();
+        double residualSumOfSquares =
+          solutionUpd.residuals.col(j).squaredNorm();
+        solutionUpd.r2(j) = 1.0 - residualSumOfSquares/totalSumOfSquares;
+      }
+      return true;
+    };
+
+    //==========================================================================
+    /*
+      Decomposes the basis and solves for every column of observations
+    */
+    static bool solve(const Eigen::MatrixXd &basis,
+                      const Eigen::MatrixXd &observations,
+                      LeastSquaresSolution &solutionUpd){
+      LeastSquaresDecomposition decomposition;
+      decompose(basis, decomposition);
+      return solve(basis, decomposition, observations, solutionUpd);
+    };
+
+    //==========================================================================
+    /*
+      Fits y = y0 + dydw*w to each of the series, all of which are sampled at
+      w. Returns false if the fit is not possible (fewer than 2 points, or all
+      of the w values are the same), in which case the coefficients are set
+      to nan.
+
+      The straight line basis is orthogonal once w is centered, and so its
+      decomposition is just the mean and the sum of squares of w. This is
+      evaluated once and shared by every series, and is much cheaper than a
+      general QR decomposition for the short series that most fits use.
+    */
+    static bool fitStraightLines(
+                  const std::vector< double > &w,
+                  const std::vector< const std::vector< double >* > &series,
+                  std::vector< double > &y0Upd,
+                  std::vector< double > &dydwUpd,
+                  std::vector< double > &r2Upd){
+
+      Eigen::Index n = static_cast<Eigen::Index>(w.size());
+      Eigen::Map< const Eigen::ArrayXd > wA(w.data(), n);
+
+      double wMean = (n > 0) ? wA.mean() : 0.;
+      double sumOfSquaresW = (wA - wMean).square().sum();
+
+      bool valid = (n > 1) && (sumOfSquaresW > 0.);
+
+      y0Upd.resize(series.size());
+      dydwUpd.resize(series.size());
+      r2Upd.resize(series.size());
+      for(size_t j=0; j<series.size(); ++j){
+        if(valid && static_cast<Eigen::Index>(series[j]->size()) == n){
+          fitStraightLineCentered(wA, wMean, sumOfSquaresW, *series[j],
+                                  y0Upd[j], dydwUpd[j], r2Upd[j]);
+        }else{
+          y0Upd[j]   = std::nan("1");
+          dydwUpd[j] = std::nan("1");
+          r2Upd[j]   = std::nan("1");
+        }
+      }
+      return valid;
+    };
+
+    //==========================================================================
+    static bool fitStraightLine(const std::vector< double > &w,
+                                const std::vector< double > &y,
+                                double &y0Upd,
+                                double &dydwUpd,
+                                double &r2Upd){
+
+      Eigen::Index n = static_cast<Eigen::Index>(w.size());
+      Eigen::Map< const Eigen::ArrayXd > wA(w.data(), n);
+
+      double wMean = (n > 0) ? wA.mean() : 0.;
+      double sumOfSquaresW = (wA - wMean).square().sum();
+
+      bool valid = (n > 1) && (sumOfSquaresW > 0.) 
+                && (static_cast<Eigen::Index>(y.size()) == n);
+      if(valid){
+        fitStraightLineCentered(wA, wMean, sumOfSquaresW, y,
+                                y0Upd, dydwUpd, r2Upd);
+      }else{
+        y0Upd   = std::nan("1");
+        dydwUpd = std::nan("1");
+        r2Upd   = std::nan("1");
+      }
+      return valid;
+    };
+
+    //==========================================================================
+    static void fitStraightLineCentered(
+                  const Eigen::Map< const Eigen::ArrayXd > &wA,
+                  double wMean,
+                  double sumOfSquaresW,
+                  const std::vector< double > &y,
+                  double &y0Upd,
+                  double &dydwUpd,
+                  double &r2Upd){
+
+      Eigen::Map< const Eigen::ArrayXd > yA(y.data(), wA.size());
+      double yMean = yA.mean();
+      double dydw  = ((wA - wMean)*(yA - yMean)).sum()/sumOfSquaresW;
+      double residualSumOfSquares = 
+        ((yA - yMean) - dydw*(wA - wMean)).square().sum();
+      double totalSumOfSquares = (yA - yMean).square().sum();
+
+      y0Upd   = yMean - dydw*wMean;
+      dydwUpd = dydw;
+      r2Upd   = 1.0 - residualSumOfSquares/totalSumOfSquares;
+    };
+
+    //==========================================================================
+    /*
+      The samples [begin,end) of a window
+    */
+    struct IndexRange{
+      size_t begin;
+      size_t end;
+      IndexRange():begin(0),end(0){};
+      IndexRange(size_t beginIndex, size_t endIndex):
+        begin(beginIndex),end(endIndex){};
+    };
+
+    //==========================================================================
+    /*
+      The straight line y = yMean + dydx*(x-xMean) fitted to one window
+
+      @param numberOfPoints : the number of samples in the window
+      @param xMean, yMean : the mean of x and y over the window
+      @param dydx : the slope, nan if all of the x values are the same
+      @param r2 : the coefficient of determination
+      @param totalSumOfSquares : the sum of (y-yMean)^2 over the window
+    */
+    struct StraightLineFit{
+      size_t numberOfPoints;
+      double xMean;
+      double yMean;
+      double dydx;
+      double r2;
+      double totalSumOfSquares;
+      StraightLineFit():
+        numberOfPoints(0),
+        xMean(std::nan("1")),
+        yMean(std::nan("1")),
+        dydx(std::nan("1")),
+        r2(std::nan("1")),
+        totalSumOfSquares(std::nan("1")){};
+    };
+
+    //==========================================================================
+    /*
+      Fits a straight line to each of the series over each of the windows of
+      samples. Rather than copying each window and fitting it from scratch,
+      the sums of x, x^2, y, xy, and y^2 are updated as samples enter and
+      leave the window, so all of the windows are fitted in one pass when
+      both ends of the windows move in one direction (e.g. a window of a
+      fixed duration that slides over a time series).
+
+      To limit the round-off that builds up as samples are added and removed
+      the sums are evaluated relative to the first sample in the window, and
+      are recomputed from scratch once every sample that was in the window
+      at the last recomputation has left it. This keeps the cost at O(N).
+      The sums are also recomputed if a window moves backwards.
+
+      @param x : the sample points
+      @param series : one or more series sampled at x
+      @param windows : the windows of samples to fit
+      @param fitsUpd : fitsUpd[j][k] is the fit of series j over window k
+    */
+    static void fitStraightLinesOverWindows(
+                  const std::vector< double > &x,
+                  const std::vector< const std::vector< double >* > &series,
+                  const std::vector< IndexRange > &windows,
+                  std::vector< std::vector< StraightLineFit > > &fitsUpd){
+
+      size_t m = series.size();
+      for(size_t j=0; j<m; ++j){
+        if(series[j]->size() != x.size()){
+          std::cerr << "Error: fitStraightLinesOverWindows: each series must "
+                    << "have the same length as x" << std::endl;
+          std::abort();
+        }
+      }
+      for(size_t k=0; k<windows.size(); ++k){
+        if(windows[k].begin > windows[k].end || windows[k].end > x.size()){
+          std::cerr << "Error: fitStraightLinesOverWindows: window " << k
+                    << " is outside of x" << std::endl;
+          std::abort();
+        }
+      }
+
+      fitsUpd.assign(m, std::vector< StraightLineFit >(windows.size()));
+
+      double xRef   = 0.;
+      double sumX   = 0.;
+      double sumXX  = 0.;
+      std::vector< double > yRef(m,0.), sumY(m,0.), sumXY(m,0.), sumYY(m,0.);
+
+      size_t begin = 0;
+      size_t end   = 0;
+      size_t indexOfNextRecompute = 0;
+
+      for(size_t k=0; k<windows.size(); ++k){
+        const IndexRange &window = windows[k];
+
+        bool recompute =  window.begin < begin
+                       || window.end   < end
+                       || window.begin >= indexOfNextRecompute;
+
+        if(recompute){
+          begin = window.begin;
+          end   = window.begin;
+          indexOfNextRecompute = window.end;
+          if(window.begin < x.size()){
+            xRef = x[window.begin];
+          }
+          sumX  = 0.;
+          sumXX = 0.;
+          for(size_t j=0; j<m; ++j){
+            yRef[j]  = (window.begin < x.size()) ? (*series[j])[window.begin]
+                                                 : 0.;
+            sumY[j]  = 0.;
+            sumXY[j] = 0.;
+            sumYY[j] = 0.;
+          }
+        }
+
+        for(size_t i=end; i<window.end; ++i){
+          double dx = x[i]-xRef;
+          sumX  += dx;
+          sumXX += dx*dx;
+          for(size_t j=0; j<m; ++j){
+            double dy = (*series[j])[i]-yRef[j];
+            sumY[j]  += dy;
+            sumXY[j] += dx*dy;
+            sumYY[j] += dy*dy;
+          }
+        }
+        for(size_t i=begin; i<window.begin; ++i){
+          double dx = x[i]-xRef;
+          sumX  -= dx;
+          sumXX -= dx*dx;
+          for(size_t j=0; j<m; ++j){
+            double dy = (*series[j])[i]-yRef[j];
+            sumY[j]  -= dy;
+            sumXY[j] -= dx*dy;
+            sumYY[j] -= dy*dy;
+          }
+        }
+        begin = window.begin;
+        end   = window.end;
+
+        size_t n = end-begin;
+        if(n == 0){
+          continue;
+        }
+
+        double nD   = static_cast<double>(n);
+        double xMean = sumX/nD;
+        double sumOfSquaresX = std::max(0., sumXX - sumX*xMean);
+
+        for(size_t j=0; j<m; ++j){
+          double yMean = sumY[j]/nD;
+          double sumOfProductsXY = sumXY[j] - sumX*yMean;
+          double totalSumOfSquares = std::max(0., sumYY[j] - sumY[j]*yMean);
+
+          double dydx = (sumOfSquaresX > 0.) ? sumOfProductsXY/sumOfSquaresX
+                                             : std::nan("1");
+          double residualSumOfSquares =
+            std::max(0., totalSumOfSquares - dydx*sumOfProductsXY);
+
+          StraightLineFit &fit  = fitsUpd[j][k];
+          fit.numberOfPoints    = n;
+          fit.xMean             = xRef + xMean;
+          fit.yMean             = yRef[j] + yMean;
+          fit.dydx              = dydx;
+          fit.r2                = 1.0 - residualSumOfSquares/totalSumOfSquares;
+          fit.totalSumOfSquares = totalSumOfSquares;
+        }
+      }
+    };
+
+};
+
+#endif
@@ -0,0 +1,224 @@
+//SPDX-FileCopyrightText: 2023 Matthew Millard millard.matthew@gmail.com
+//SPDX-License-Identifier: MIT
+
+#ifndef RESAMPLING_FUNCTIONS
+#define RESAMPLING_FUNCTIONS
+
+#include <cmath>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+/*
+  Functions to reduce the number of points in a time series (e.g. a daily
+  price history) before a model is fitted to it. A series can be reduced to
+  one point per week or month, or to a fixed number of points that preserves
+  its shape using the Largest-Triangle-Three-Buckets (LTTB) method of
+  Steinarsson (2013, Downsampling Time Series for Visual Representation,
+  MSc thesis, University of Iceland).
+
+  The functions return the indices of the points that are kept so that any
+  number of vectors that share the same x can be reduced in the same way.
+*/
+class ResamplingFunctions {
+
+  public:
+
+    /*
+      none    : every point
+      weekly  : the first point of each week
+      monthly : the first point of each month
+      lttb    : every point, reduced to maximumNumberOfPoints using LTTB
+    */
+    enum ResamplingMethod{
+      RESAMPLE_NONE=0,
+      RESAMPLE_WEEKLY,
+      RESAMPLE_MONTHLY,
+      RESAMPLE_LTTB,
+      NUMBER_OF_RESAMPLING_METHODS
+    };
+
+    //==========================================================================
+    /*
+      @param method : the method used to reduce the series
+      @param maximumNumberOfPoints : if the resampled series still has more
+                      points than this it is reduced to this many points
+                      using LTTB. Set to 0 for no limit.
+    */
+    struct ResamplingSettings{
+      ResamplingMethod method;
+      int maximumNumberOfPoints;
+      ResamplingSettings():
+        method(RESAMPLE_NONE),
+        maximumNumberOfPoints(0){};
+    };
+
+    //==========================================================================
+    static const char* getResamplingMethodName(ResamplingMethod method){
+      switch(method){
+        case RESAMPLE_WEEKLY:  return "weekly";
+        case RESAMPLE_MONTHLY: return "monthly";
+        case RESAMPLE_LTTB:    return "lttb";
+        default:               return "none";
+      }
+    };
+
+    //==========================================================================
+    /*
+      Returns false if name is not one of none, weekly, monthly, or lttb
+    */
+    static bool parseResamplingMethod(const std::string &name,
+                                      ResamplingMethod &methodUpd){
+      for(int i=0; i<NUMBER_OF_RESAMPLING_METHODS; ++i){
+        ResamplingMethod method = static_cast<ResamplingMethod>(i);
+        if(name.compare(getResamplingMethodName(method))==0){
+          methodUpd = method;
+          return true;
+        }
+      }
+      return false;
+    };
+
+    //==========================================================================
+    /*
+      Keeps the first point of each period, and the last point of the series.
+      The x values are in fractional years and must be in ascending order.
+
+      @param periodsPerYear : 52 for weekly, 12 for monthly
+    */
+    static void resampleByPeriod(const std::vector< double > &x,
+                                 double periodsPerYear,
+                                 std::vector< size_t > &indicesUpd){
+      indicesUpd.clear();
+      if(x.empty()){
+        return;
+      }
+      double previousPeriod = std::floor(x[0]*periodsPerYear);
+      indicesUpd.push_back(0);
+      for(size_t i=1; i<x.size(); ++i){
+        double period = std::floor(x[i]*periodsPerYear);
+        if(period != previousPeriod){
+          indicesUpd.push_back(i);
+          previousPeriod = period;
+        }
+      }
+      if(indicesUpd.back() != x.size()-1){
+        indicesUpd.push_back(x.size()-1);
+      }
+    };
+
+    //==========================================================================
+    /*
+      Largest-Triangle-Three-Buckets: the first and last points are kept and
+      the rest are divided into numberOfPoints-2 buckets. From each bucket
+      the point that forms the largest triangle with the point kept from the
+      previous bucket and the average of the next bucket is kept.
+
+      @param indices : the candidate points, in ascending order of x
+    */
+    static void resampleUsingLargestTriangleThreeBuckets(
+                  const std::vector< double > &x,
+                  const std::vector< double > &y,
+                  const std::vector< size_t > &indices,
+                  int numberOfPoints,
+                  std::vector< size_t > &indicesUpd){
+
+      size_t n = indices.size();
+      if(numberOfPoints < 3 || static_cast<size_t>(numberOfPoints) >= n){
+        indicesUpd = indices;
+        return;
+      }
+
+      std::vector< size_t > selected;
+      selected.reserve(numberOfPoints);
+
+      double bucketSize = static_cast<double>(n-2)
+                        / static_cast<double>(numberOfPoints-2);
+
+      size_t a = 0;
+      selected.push_back(indices[0]);
+
+      for(int i=0; i<numberOfPoints-2; ++i){
+        size_t averageStart = static_cast<size_t>(
+                                std::floor((i+1)*bucketSize)) + 1;
+        size_t averageEnd   = std::min(n, static_cast<size_t>(
+                                std::floor((i+2)*bucketSize)) + 1);
+        double xAverage = 0.;
+        double yAverage = 0.;
+        for(size_t j=averageStart; j<averageEnd; ++j){
+          xAverage += x[indices[j]];
+          yAverage += y[indices[j]];
+        }
+        double count = static_cast<double>(averageEnd-averageStart);
+        xAverage /= count;
+        yAverage /= count;
+
+        size_t bucketStart = static_cast<size_t>(std::floor(i*bucketSize)) + 1;
+        size_t bucketEnd   = static_cast<size_t>(
+                                std::floor((i+1)*bucketSize)) + 1;
+
+        double xA = x[indices[a]];
+        double yA = y[indices[a]];
+        double maxArea = -1.0;
+        size_t maxIndex = bucketStart;
+        for(size_t j=bucketStart; j<bucketEnd; ++j){
+          double area = std::abs( (xA-xAverage)*(y[indices[j]]-yA)
+                                 -(xA-x[indices[j]])*(yAverage-yA));
+          if(area > maxArea){
+            maxArea  = area;
+            maxIndex = j;
+          }
+        }
+        selected.push_back(indices[maxIndex]);
+        a = maxIndex;
+      }
+
+      selected.push_back(indices[n-1]);
+      indicesUpd = selected;
+    };
+
+    //==========================================================================
+    /*
+      Returns the indices of the points of (x,y) that are kept by settings.
+    */
+    static void resample(const std::vector< double > &x,
+                         const std::vector< double > &y,
+                         const ResamplingSettings &settings,
+                         std::vector< size_t > &indicesUpd){
+
+      std::vector< size_t > indices;
+      switch(settings.method){
+        case RESAMPLE_WEEKLY:
+          resampleByPeriod(x,52.0,indices);
+          break;
+        case RESAMPLE_MONTHLY:
+          resampleByPeriod(x,12.0,indices);
+          break;
+        default:
+          indices.resize(x.size());
+          for(size_t i=0; i<x.size(); ++i){
+            indices[i]=i;
+          }
+      }
+
+      if(settings.maximumNumberOfPoints > 0){
+        resampleUsingLargestTriangleThreeBuckets(
+          x,y,indices,settings.maximumNumberOfPoints,indicesUpd);
+      }else{
+        indicesUpd = indices;
+      }
+    };
+
+    //==========================================================================
+    static void selectIndices(const std::vector< double > &data,
+                              const std::vector< size_t > &indices,
+                              std::vector< double > &dataUpd){
+      dataUpd.resize(indices.size());
+      for(size_t i=0; i<indices.size(); ++i){
+        dataUpd[i] = data[indices[i]];
+      }
+    };
+
+};
+
+#endif
@@ -304,6 +304,7 @@ class ScreenerFunctions {
         std::vector< double > metricVector;
         std::vector< date::sys_days > dateVector;
         std::vector< DataStructures::SummaryStatistics> percentileVector;
+        std::vector< double > summaryScratch;
         double weight=1.0;
 
         nlohmann::ordered_json targetJsonTable;
@@ -488,7 +489,8 @@ class ScreenerFunctions {
           }                                  
           DataStructures::SummaryStatistics percentileSummary;
           NumericalFunctions::extractSummaryStatistics(metricData,
-                                                      percentileSummary); 
+                                                      percentileSummary,
+                                                      summaryScratch); 
           percentileSummary.current = targetMetricValue;                                                    
 
           if(smallestDayError <= maxTargetDateErrorInDays || !isDateSeries){
@@ -0,0 +1,206 @@
+//SPDX-FileCopyrightText: 2023 Matthew Millard millard.matthew@gmail.com
+//SPDX-License-Identifier: MIT
+
+#ifndef SERVICE_FUNCTIONS
+#define SERVICE_FUNCTIONS
+
+#include <cerrno>
+#include <cstring>
+#include <set>
+#include <string>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <iostream>
+#include <functional>
+#include <condition_variable>
+
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+/*
+  Functions to run a service that answers requests sent over a Unix domain
+  socket. A request is one line of text and the reply to it is one line of
+  text. A client can send any number of requests over one connection, and
+  the connections are served at the same time, each on its own thread.
+*/
+class ServiceFunctions {
+
+  public:
+
+    //==========================================================================
+    /*
+      Returns the file descriptor of a socket that is listening at
+      socketPath, or -1 if the socket could not be created. A file that is
+      already at socketPath (e.g. left by a service that was killed) is
+      removed.
+    */
+    static int createListeningSocket(const std::string &socketPath){
+
+      sockaddr_un address;
+      std::memset(&address,0,sizeof(address));
+      address.sun_family = AF_UNIX;
+      if(socketPath.size() >= sizeof(address.sun_path)){
+        std::cerr << "Error: the socket path is longer than "
+                  << sizeof(address.sun_path)-1 << " characters: "
+                  << socketPath << std::endl;
+        return -1;
+      }
+      std::strncpy(address.sun_path,socketPath.c_str(),
+                   sizeof(address.sun_path)-1);
+
+      int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+      if(fd < 0){
+        return -1;
+      }
+      unlink(socketPath.c_str());
+      if(bind(fd,reinterpret_cast<sockaddr*>(&address),sizeof(address)) != 0
+         || listen(fd,SOMAXCONN) != 0){
+        std::cerr << "Error: could not listen on " << socketPath
+                  << ": " << std::strerror(errno) << std::endl;
+        close(fd);
+        return -1;
+      }
+      return fd;
+    };
+
+    //==========================================================================
+    /*
+      Reads the next line (without the newline) from fd into lineUpd, using
+      bufferUpd to keep what has been read past the end of the line. Returns
+      false when the connection has been closed and no line is left.
+    */
+    static bool readLine(int fd, std::string &bufferUpd,
+                         std::string &lineUpd){
+      while(true){
+        size_t end = bufferUpd.find('\n');
+        if(end != std::string::npos){
+          lineUpd = bufferUpd.substr(0,end);
+          bufferUpd.erase(0,end+1);
+          return true;
+        }
+        char chunk[4096];
+        ssize_t n = read(fd,chunk,sizeof(chunk));
+        if(n < 0 && errno == EINTR){
+          continue;
+        }
+        if(n <= 0){
+          if(bufferUpd.empty()){
+            return false;
+          }
+          lineUpd.swap(bufferUpd);
+          bufferUpd.clear();
+          return true;
+        }
+        bufferUpd.append(chunk,static_cast<size_t>(n));
+      }
+    };
+
+    //==========================================================================
+    /*
+      Writes all of text to the socket fd. A client that has already closed
+      its end makes this return false rather than raise SIGPIPE, which would
+      end the whole service.
+    */
+    static bool writeAll(int fd, const std::string &text){
+      size_t written = 0;
+      while(written < text.size()){
+        ssize_t n = send(fd,text.data()+written,text.size()-written,
+                         MSG_NOSIGNAL);
+        if(n < 0 && errno == EINTR){
+          continue;
+        }
+        if(n <= 0){
+          return false;
+        }
+        written += static_cast<size_t>(n);
+      }
+      return true;
+    };
+
+    //==========================================================================
+    /*
+      Serves requests at socketPath until a request sets stopUpd to true in
+      handleRequest. Each reply is followed by a newline, so a reply must not
+      contain one. When the service is stopped the connections that are 
+      still open are shut down for reading: a request that is being 
+      evaluated still gets its reply, but no further requests are read.
+
+      @param handleRequest : returns the reply to a request. It is called
+                             from several threads at once.
+    */
+    static bool runUnixSocketService(
+          const std::string &socketPath,
+          const std::function<std::string(const std::string&,bool&)>
+            &handleRequest){
+
+      int listenFd = createListeningSocket(socketPath);
+      if(listenFd < 0){
+        return false;
+      }
+
+      std::atomic< bool > stop(false);
+      std::mutex connectionLock;
+      std::condition_variable connectionsClosed;
+      int numberOfConnections = 0;
+      std::set< int > openConnections;
+
+      while(!stop.load()){
+        int connectionFd = accept(listenFd,nullptr,nullptr);
+        if(connectionFd < 0){
+          if(errno == EINTR || errno == ECONNABORTED){
+            continue;
+          }
+          break;
+        }
+
+        {
+          std::lock_guard< std::mutex > lock(connectionLock);
+          ++numberOfConnections;
+          openConnections.insert(connectionFd);
+        }
+
+        std::thread([&,connectionFd](){
+          std::string buffer;
+          std::string request;
+          while(readLine(connectionFd,buffer,request)){
+            if(request.empty()){
+              continue;
+            }
+            bool stopRequested = false;
+            std::string reply = handleRequest(request,stopRequested);
+            reply.push_back('\n');
+            if(!writeAll(connectionFd,reply)){
+              break;
+            }
+            if(stopRequested){
+              stop.store(true);
+              //Wakes the accept call in the main loop
+              shutdown(listenFd,SHUT_RDWR);
+            }
+          }
+          std::lock_guard< std::mutex > lock(connectionLock);
+          //Removed before it is closed so that the descriptor, which can be
+          //reused once closed, is never shut down by the main loop
+          openConnections.erase(connectionFd);
+          close(connectionFd);
+          --numberOfConnections;
+          connectionsClosed.notify_all();
+        }).detach();
+      }
+
+      //An idle client would otherwise keep the service running forever
+      std::unique_lock< std::mutex > lock(connectionLock);
+      for(int connectionFd : openConnections){
+        shutdown(connectionFd,SHUT_RD);
+      }
+      connectionsClosed.wait(lock,[&](){return numberOfConnections == 0;});
+      close(listenFd);
+      unlink(socketPath.c_str());
+      return true;
+    };
+
+};
+
+#endif
@@ -0,0 +1,342 @@
+//SPDX-FileCopyrightText: 2023 Matthew Millard millard.matthew@gmail.com
+//SPDX-License-Identifier: MIT
+
+#ifndef SHARD_FUNCTIONS
+#define SHARD_FUNCTIONS
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <filesystem>
+#include <nlohmann/json.hpp>
+
+#include "date.h"
+#include "JsonFunctions.h"
+#include "HashFunctions.h"
+
+/*
+  Functions to split a universe of tickers across several processes (or
+  machines) and to record what each of those processes did.
+
+  A ticker is assigned to a shard using a hash of its name (or of a shard
+  key, such as the name of the listing whose data it is evaluated with), so
+  every process that sees the same set of files assigns each ticker to the 
+  same shard without having to talk to the others. Each process writes a manifest that
+  lists the tickers that it processed, skipped, or failed on, and the
+  mergeShards tool combines these manifests and checks that every ticker
+  was covered exactly once.
+*/
+class ShardFunctions {
+
+  public:
+
+    static constexpr const char* PROCESSED = "processed";
+    static constexpr const char* SKIPPED   = "skipped";
+    static constexpr const char* FAILED    = "failed";
+    static constexpr const char* UNCHANGED = "unchanged";
+
+    //==========================================================================
+    struct ShardSettings{
+      bool enabled;
+      int index;  //1, 2, ..., count
+      int count;
+      ShardSettings():
+        enabled(false),
+        index(1),
+        count(1){};
+    };
+
+    //==========================================================================
+    struct ShardManifestEntry{
+      std::string ticker;
+      //The name that was hashed to assign the ticker to a shard, if this is
+      //not the ticker itself
+      std::string shardKey;
+      std::string status;
+      double elapsedTimeInSeconds;
+      int passedScreen; //-1 if the ticker did not pass a screen
+      ShardManifestEntry():
+        elapsedTimeInSeconds(0.),
+        passedScreen(-1){};
+    };
+
+    //==========================================================================
+    struct ShardManifest{
+      std::string toolName;
+      ShardSettings shard;
+      size_t universeSize;
+      uint64_t universeHash;
+      bool hasScreenResults;
+      std::string startTime;
+      double elapsedTimeInSeconds;
+      std::vector< ShardManifestEntry > entries;
+      ShardManifest():
+        universeSize(0),
+        universeHash(0),
+        hasScreenResults(false),
+        elapsedTimeInSeconds(0.){};
+    };
+
+    //==========================================================================
+    static std::string getTickerName(const std::string &fileName){
+      std::string ticker(fileName);
+      size_t idx = ticker.rfind(".json");
+      if(idx != std::string::npos && idx+5 == ticker.length()){
+        ticker = ticker.substr(0,idx);
+      }
+      return ticker;
+    };
+
+    //==========================================================================
+    static int getShardIndex(const std::string &fileName, int shardCount){
+      uint64_t hash = 
+        HashFunctions::calcStableHash(getTickerName(fileName));
+      return static_cast<int>(hash % static_cast<uint64_t>(shardCount)) + 1;
+    };
+
+    //==========================================================================
+    static bool isInShard(const std::string &fileName,
+                          const ShardSettings &shard){
+      if(!shard.enabled){
+        return true;
+      }
+      return (getShardIndex(fileName,shard.count) == shard.index);
+    };
+
+    //==========================================================================
+    /*
+      Parses a shard argument of the form i/N where 1 <= i <= N. An empty
+      string means that sharding is not used.
+    */
+    static bool parseShardSettings(const std::string &shardArgument,
+                                   ShardSettings &shard){
+      shard = ShardSettings();
+      if(shardArgument.length()==0){
+        return true;
+      }
+
+      size_t idx = shardArgument.find('/');
+      if(idx == std::string::npos){
+        return false;
+      }
+      try{
+        size_t n=0;
+        shard.index = std::stoi(shardArgument.substr(0,idx),&n);
+        if(n != idx){
+          return false;
+        }
+        std::string countStr = shardArgument.substr(idx+1);
+        shard.count = std::stoi(countStr,&n);
+        if(n != countStr.length()){
+          return false;
+        }
+      }catch(const std::exception &e){
+        return false;
+      }
+
+      if(shard.count < 1 || shard.index < 1 || shard.index > shard.count){
+        return false;
+      }
+      shard.enabled=true;
+      return true;
+    };
+
+    //==========================================================================
+    /*
+      An order-independent fingerprint of the full (unsharded) list of
+      tickers. Every shard records this so that mergeShards can check that
+      all of the shards were run over the same universe.
+    */
+    static uint64_t calcUniverseHash(const std::vector< std::string > &fileNames){
+      uint64_t hash = 0;
+      for(auto const &fileName : fileNames){
+        hash ^= HashFunctions::calcStableHash(getTickerName(fileName));
+      }
+      return hash;
+    };
+
+    //==========================================================================
+    static std::string getManifestFileName(const std::string &toolName,
+                                           const ShardSettings &shard){
+      std::string fileName(toolName);
+      fileName.append("_shard_");
+      fileName.append(std::to_string(shard.index));
+      fileName.append("_of_");
+      fileName.append(std::to_string(shard.count));
+      fileName.append(".json");
+      return fileName;
+    };
+
+    //==========================================================================
+    /*
+      Splits the list of files into those that belong to this shard and
+      initializes the manifest. If sharding is not enabled every file is
+      kept.
+
+      @param shardKeysUpd : Optional: nullptr. The name to hash in place of
+                            each file name, so that files that must be 
+                            processed together (e.g. the listings that share
+                            a primary) land in the same shard. It is 
+                            filtered along with fileNames.
+    */
+    static void selectShard(const std::string &toolName,
+                            const ShardSettings &shard,
+                            std::vector< std::string > &fileNames,
+                            ShardManifest &manifest,
+                            std::vector< std::string > *shardKeysUpd=nullptr){
+
+      manifest = ShardManifest();
+      manifest.toolName     = toolName;
+      manifest.shard        = shard;
+      manifest.universeSize = fileNames.size();
+      manifest.universeHash = calcUniverseHash(fileNames);
+
+      auto now = std::chrono::system_clock::now();
+      manifest.startTime = date::format("%Y-%m-%dT%H:%M:%S",
+                        date::floor<std::chrono::seconds>(now));
+
+      if(!shard.enabled){
+        return;
+      }
+
+      std::vector< std::string > shardFileNames;
+      std::vector< std::string > shardKeys;
+      for(size_t i=0; i<fileNames.size(); ++i){
+        const std::string &key = 
+          (shardKeysUpd != nullptr) ? (*shardKeysUpd)[i] : fileNames[i];
+        if(isInShard(key,shard)){
+          shardFileNames.push_back(fileNames[i]);
+          shardKeys.push_back(key);
+        }
+      }
+      fileNames = shardFileNames;
+      if(shardKeysUpd != nullptr){
+        *shardKeysUpd = shardKeys;
+      }
+    };
+
+    //==========================================================================
+    static void convertManifestToJson(const ShardManifest &manifest,
+                                      nlohmann::ordered_json &manifestJson){
+      manifestJson.clear();
+      manifestJson["tool"]            = manifest.toolName;
+      manifestJson["shard_index"]     = manifest.shard.index;
+      manifestJson["shard_count"]     = manifest.shard.count;
+      manifestJson["universe_size"]   = manifest.universeSize;
+      manifestJson["universe_hash"]   = 
+        HashFunctions::convertHashToString(manifest.universeHash);
+      manifestJson["start_time"]      = manifest.startTime;
+      manifestJson["elapsed_seconds"] = manifest.elapsedTimeInSeconds;
+
+      int numberProcessed = 0;
+      int numberSkipped   = 0;
+      int numberUnchanged = 0;
+      int numberFailed    = 0;
+      nlohmann::ordered_json tickersJson = nlohmann::ordered_json::array();
+      for(auto const &entry : manifest.entries){
+        if(entry.status.length()==0){
+          continue;
+        }
+        nlohmann::ordered_json entryJson;
+        entryJson["ticker"]  = entry.ticker;
+        if(entry.shardKey.length() > 0 && entry.shardKey != entry.ticker){
+          entryJson["shard_key"] = entry.shardKey;
+        }
+        entryJson["status"]  = entry.status;
+        entryJson["seconds"] = entry.elapsedTimeInSeconds;
+        if(manifest.hasScreenResults){
+          entryJson["passed_screen"] = entry.passedScreen;
+        }
+        tickersJson.push_back(entryJson);
+
+        if(entry.status == PROCESSED){
+          ++numberProcessed;
+        }else if(entry.status == SKIPPED){
+          ++numberSkipped;
+        }else if(entry.status == UNCHANGED){
+          ++numberUnchanged;
+        }else if(entry.status == FAILED){
+          ++numberFailed;
+        }
+      }
+      manifestJson["summary"]["processed"] = numberProcessed;
+      manifestJson["summary"]["skipped"]   = numberSkipped;
+      manifestJson["summary"]["unchanged"] = numberUnchanged;
+      manifestJson["summary"]["failed"]    = numberFailed;
+      manifestJson["tickers"] = tickersJson;
+    };
+
+    //==========================================================================
+    static bool writeManifest(const std::string &manifestFolder,
+                              const ShardManifest &manifest,
+                              bool verbose){
+
+      std::filesystem::path manifestPath(manifestFolder);
+      manifestPath.append(getManifestFileName(manifest.toolName,
+                                              manifest.shard));
+
+      nlohmann::ordered_json manifestJson;
+      convertManifestToJson(manifest,manifestJson);
+
+      std::ofstream outputFileStream(manifestPath,
+          std::ios_base::trunc | std::ios_base::out);
+      if(!outputFileStream.is_open()){
+        std::cerr << "Error: could not write the shard manifest "
+                  << manifestPath.string() << std::endl;
+        return false;
+      }
+      outputFileStream << manifestJson.dump(2);
+      outputFileStream.close();
+
+      if(verbose){
+        std::cout << "Wrote the shard manifest " << manifestPath.string()
+                  << std::endl;
+      }
+      return true;
+    };
+
+    //==========================================================================
+    /*
+      Reads the list of tickers that passed a screen from a (merged) manifest
+      written by a screener tool. The tickers are returned in alphabetical
+      order so that the report does not depend on how the work was sharded.
+    */
+    static bool readScreenedTickers(const std::string &manifestPath,
+                                    int screenIndex,
+                                    std::vector< std::string > &fileNames,
+                                    int &numberOfTickersInManifest,
+                                    bool verbose){
+      fileNames.clear();
+      numberOfTickersInManifest=0;
+      nlohmann::ordered_json manifestJson;
+      bool loaded = JsonFunctions::loadJsonFile(manifestPath, manifestJson,
+                                                verbose);
+      if(!loaded || !manifestJson.contains("tickers")){
+        return false;
+      }
+      numberOfTickersInManifest = static_cast<int>(manifestJson["tickers"].size());
+      for(auto &entry : manifestJson["tickers"]){
+        if(!entry.contains("passed_screen") || !entry.contains("ticker")){
+          continue;
+        }
+        std::string status;
+        JsonFunctions::getJsonString(entry["status"],status);
+        int passedScreen = entry["passed_screen"].get<int>();
+        if(status == PROCESSED && passedScreen == screenIndex){
+          std::string fileName;
+          JsonFunctions::getJsonString(entry["ticker"],fileName);
+          fileName.append(".json");
+          fileNames.push_back(fileName);
+        }
+      }
+      std::sort(fileNames.begin(),fileNames.end());
+      return true;
+    };
+
+};
+
+#endif
@@ -7,6 +7,9 @@
 #include <string>
 #include <stdlib.h>
 #include <regex>
+#include <vector>
+#include <array>
+#include <deque>
 
 #include <boost/algorithm/string/classification.hpp> // Include boost::for is_any_of
 #include <boost/algorithm/string/split.hpp> // Include for boost::split
@@ -210,6 +213,118 @@ class StringFunctions {
       
     };    
 
+    //==========================================================================
+    /*
+      An Aho-Corasick automaton that finds every one of a set of keywords in a
+      text in a single pass over the text. The transitions of each state are
+      stored for all 256 characters so that the search does not have to
+      follow failure links.
+
+      transitions : the next state for each state and character
+      keywords    : the indices of the keywords that end at each state
+    */
+    struct KeywordMatcher{
+      std::vector< std::array< int, 256 > > transitions;
+      std::vector< std::vector< size_t > > keywords;
+      size_t numberOfKeywords;
+      KeywordMatcher():numberOfKeywords(0){};
+    };
+
+    //==========================================================================
+    static void createKeywordMatcher(const std::vector< std::string > &keywords,
+                                     KeywordMatcher &matcherUpd){
+
+      matcherUpd.transitions.clear();
+      matcherUpd.keywords.clear();
+      matcherUpd.numberOfKeywords = keywords.size();
+
+      std::array< int, 256 > noTransitions;
+      noTransitions.fill(-1);
+      matcherUpd.transitions.push_back(noTransitions);
+      matcherUpd.keywords.push_back(std::vector< size_t >());
+
+      //The trie of the keywords
+      for(size_t i=0; i<keywords.size(); ++i){
+        int state = 0;
+        for(unsigned char c : keywords[i]){
+          if(matcherUpd.transitions[state][c] < 0){
+            matcherUpd.transitions[state][c] = 
+              static_cast<int>(matcherUpd.transitions.size());
+            matcherUpd.transitions.push_back(noTransitions);
+            matcherUpd.keywords.push_back(std::vector< size_t >());
+          }
+          state = matcherUpd.transitions[state][c];
+        }
+        matcherUpd.keywords[state].push_back(i);
+      }
+
+      //The failure links, visited breadth first, are folded into the 
+      //transitions and keyword lists
+      std::vector< int > failure(matcherUpd.transitions.size(),0);
+      std::deque< int > queue;
+      for(int c=0; c<256; ++c){
+        int next = matcherUpd.transitions[0][c];
+        if(next < 0){
+          matcherUpd.transitions[0][c] = 0;
+        }else{
+          failure[next] = 0;
+          queue.push_back(next);
+        }
+      }
+      while(!queue.empty()){
+        int state = queue.front();
+        queue.pop_front();
+        const std::vector< size_t > &inherited = 
+          matcherUpd.keywords[failure[state]];
+        matcherUpd.keywords[state].insert(matcherUpd.keywords[state].end(),
+                                          inherited.begin(),inherited.end());
+        for(int c=0; c<256; ++c){
+          int next = matcherUpd.transitions[state][c];
+          if(next < 0){
+            matcherUpd.transitions[state][c] = 
+              matcherUpd.transitions[failure[state]][c];
+          }else{
+            failure[next] = matcherUpd.transitions[failure[state]][c];
+            queue.push_back(next);
+          }
+        }
+      }
+    };
+
+    //==========================================================================
+    /*
+      Sets foundUpd[i] to true if keyword i appears in text, which is the 
+      same as text.find(keywords[i]) != std::string::npos. Returns the number
+      of keywords that were found.
+    */
+    static size_t findKeywords(const KeywordMatcher &matcher,
+                               const std::string &text,
+                               std::vector< bool > &foundUpd){
+
+      foundUpd.assign(matcher.numberOfKeywords,false);
+      if(matcher.transitions.empty()){
+        return 0;
+      }
+
+      //An empty keyword is found in every text
+      size_t numberFound = 0;
+      for(auto const &index : matcher.keywords[0]){
+        foundUpd[index] = true;
+        ++numberFound;
+      }
+      int state = 0;
+      for(unsigned char c : text){
+        state = matcher.transitions[state][c];
+        for(auto const &index : matcher.keywords[state]){
+          if(!foundUpd[index]){
+            foundUpd[index] = true;
+            ++numberFound;
+          }
+        }
+      }
+      return numberFound;
+    };
+
 };
 
 
@@ -0,0 +1,526 @@
+//SPDX-FileCopyrightText: 2023 Matthew Millard millard.matthew@gmail.com
+//SPDX-License-Identifier: MIT
+
+#ifndef SUPERVISOR_FUNCTIONS
+#define SUPERVISOR_FUNCTIONS
+
+#include <cerrno>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <new>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <functional>
+#include <filesystem>
+
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#include <nlohmann/json.hpp>
+
+/*
+  Functions to evaluate a batch of tasks in forked worker processes so that
+  a task that crashes (e.g. by calling std::abort) takes down its worker and
+  not the whole batch, and to keep a journal of the tasks that have finished
+  so that a batch that is stopped can be resumed.
+*/
+class SupervisorFunctions {
+
+  public:
+
+    //==========================================================================
+    /*
+      A task whose worker process exited before the task was finished.
+
+      exitCode  : the exit code of the worker, or -1 if it was killed
+      signal    : the signal that killed the worker, or 0
+      error     : everything the task wrote to stderr
+    */
+    struct WorkerFailure{
+      size_t taskIndex;
+      int exitCode;
+      int signal;
+      std::string error;
+      WorkerFailure():
+        taskIndex(0),
+        exitCode(-1),
+        signal(0){};
+    };
+
+    //==========================================================================
+    /*
+      The queue shared by the workers: next is the next task to hand out and
+      current[i] is the task that worker i is working on (or -1). The header
+      and the current array live in one block of memory that is mapped into
+      every worker: the array starts after the header and has one entry per
+      worker. The atomics are constructed in place in this block, and so
+      they have to be lock free to work across processes.
+    */
+    struct SharedTaskQueueHeader{
+      std::atomic< size_t > next;
+    };
+
+    struct SharedTaskQueue{
+      SharedTaskQueueHeader *header;
+      std::atomic< long long > *current;
+      int numberOfWorkers;
+      void *memory;
+      size_t memorySize;
+      SharedTaskQueue():
+        header(nullptr),
+        current(nullptr),
+        numberOfWorkers(0),
+        memory(nullptr),
+        memorySize(0){};
+    };
+
+    static_assert(std::atomic< size_t >::is_always_lock_free,
+                  "The shared task queue needs lock free atomics");
+    static_assert(std::atomic< long long >::is_always_lock_free,
+                  "The shared task queue needs lock free atomics");
+
+    //==========================================================================
+    static void createSharedTaskQueue(int numberOfWorkers,
+                                      SharedTaskQueue &queueUpd){
+
+      size_t alignment  = alignof(std::atomic< long long >);
+      size_t arrayOffset= ((sizeof(SharedTaskQueueHeader)+alignment-1)
+                            /alignment)*alignment;
+      size_t memorySize = arrayOffset
+        + sizeof(std::atomic< long long >)*static_cast<size_t>(numberOfWorkers);
+
+      void *memory = mmap(nullptr, memorySize, PROT_READ | PROT_WRITE,
+                          MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+      if(memory == MAP_FAILED){
+        std::cerr << "Error: could not create the queue shared by the "
+                  << "worker processes" << std::endl;
+        std::abort();
+      }
+
+      queueUpd.memory          = memory;
+      queueUpd.memorySize      = memorySize;
+      queueUpd.numberOfWorkers = numberOfWorkers;
+      queueUpd.header = new (memory) SharedTaskQueueHeader();
+      queueUpd.header->next.store(0);
+
+      char *arrayMemory = static_cast<char*>(memory) + arrayOffset;
+      queueUpd.current =
+        reinterpret_cast< std::atomic< long long >* >(arrayMemory);
+      for(int i=0; i<numberOfWorkers; ++i){
+        new (arrayMemory + sizeof(std::atomic< long long >)*i)
+          std::atomic< long long >(-1);
+      }
+    };
+
+    //==========================================================================
+    static void destroySharedTaskQueue(SharedTaskQueue &queueUpd){
+      if(queueUpd.memory == nullptr){
+        return;
+      }
+      for(int i=0; i<queueUpd.numberOfWorkers; ++i){
+        queueUpd.current[i].~atomic();
+      }
+      queueUpd.header->~SharedTaskQueueHeader();
+      munmap(queueUpd.memory,queueUpd.memorySize);
+      queueUpd = SharedTaskQueue();
+    };
+
+    //==========================================================================
+    static const char* getSignalName(int signal){
+      switch(signal){
+        case SIGABRT: return "SIGABRT";
+        case SIGSEGV: return "SIGSEGV";
+        case SIGFPE:  return "SIGFPE";
+        case SIGBUS:  return "SIGBUS";
+        case SIGILL:  return "SIGILL";
+        case SIGKILL: return "SIGKILL";
+        case SIGTERM: return "SIGTERM";
+        default:      return "signal";
+      }
+    };
+
+    //==========================================================================
+    static std::string getWorkerErrorFilePath(const std::string &scratchFolder,
+                                              int workerIndex){
+      return ( std::filesystem::path(scratchFolder)
+             / ("worker_"+std::to_string(workerIndex)+".stderr") ).string();
+    };
+
+    //==========================================================================
+    /*
+      The loop run by a worker: tasks are taken from the queue until it is
+      empty. The stderr of the worker is written to its own file, which is
+      emptied before each task, so that the error output of a task that
+      crashes can be read by the supervisor. The error output of the tasks
+      that finish is copied to the original stderr.
+    */
+    [[noreturn]] static void runWorker(
+                  SharedTaskQueue *queue,
+                  size_t numberOfTasks,
+                  int workerIndex,
+                  const std::string &scratchFolder,
+                  const std::function<void(size_t)> &task){
+
+      std::string errorFilePath =
+        getWorkerErrorFilePath(scratchFolder,workerIndex);
+      int originalErrorFd = dup(STDERR_FILENO);
+      int errorFd = open(errorFilePath.c_str(),
+                         O_RDWR | O_CREAT | O_TRUNC, 0644);
+      if(errorFd >= 0){
+        dup2(errorFd,STDERR_FILENO);
+        close(errorFd);
+      }
+
+      while(true){
+        size_t taskIndex = queue->header->next.fetch_add(1);
+        if(taskIndex >= numberOfTasks){
+          break;
+        }
+        queue->current[workerIndex].store(static_cast<long long>(taskIndex));
+        if(ftruncate(STDERR_FILENO,0) == 0){
+          lseek(STDERR_FILENO,0,SEEK_SET);
+        }
+
+        task(taskIndex);
+
+        std::cout.flush();
+        std::cerr.flush();
+        queue->current[workerIndex].store(-1);
+
+        //Pass the error output of the task on to the console
+        off_t errorSize = lseek(STDERR_FILENO,0,SEEK_END);
+        if(errorSize > 0 && originalErrorFd >= 0){
+          std::string error(static_cast<size_t>(errorSize),'\0');
+          if(pread(STDERR_FILENO,&error[0],error.size(),0) > 0){
+            ssize_t written = write(originalErrorFd,error.data(),error.size());
+            (void)written;
+          }
+        }
+      }
+      std::cout.flush();
+      _exit(0);
+    };
+
+    //==========================================================================
+    static pid_t startWorker(SharedTaskQueue *queue,
+                             size_t numberOfTasks,
+                             int workerIndex,
+                             const std::string &scratchFolder,
+                             const std::function<void(size_t)> &task){
+      std::cout.flush();
+      std::cerr.flush();
+      pid_t pid = fork();
+      if(pid == 0){
+        runWorker(queue,numberOfTasks,workerIndex,scratchFolder,task);
+      }
+      if(pid < 0){
+        std::cerr << "Error: could not start worker process "
+                  << workerIndex << std::endl;
+        std::abort();
+      }
+      return pid;
+    };
+
+    //==========================================================================
+    /*
+      Evaluates task(index) for every index in [0,numberOfTasks) using
+      numberOfWorkers forked processes that take the tasks from a shared
+      queue. When a worker exits while it is working on a task (a crash, a
+      call to std::abort, or a non-zero exit) the task is recorded in
+      failuresUpd, along with its error output, and a new worker is started
+      in its place.
+
+      The workers are copies of the calling process, so the task can read
+      anything that was set up before this function was called, but anything
+      the task writes stays in the worker: results have to be passed back
+      through files (e.g. appendJournalEntry).
+
+      @param scratchFolder : the folder that the error output of each worker
+                             is written to
+    */
+    static void runSupervisedLoop(
+                  size_t numberOfTasks,
+                  int numberOfWorkers,
+                  const std::string &scratchFolder,
+                  const std::function<void(size_t)> &task,
+                  std::vector< WorkerFailure > &failuresUpd){
+
+      failuresUpd.clear();
+      if(numberOfTasks == 0){
+        return;
+      }
+      if(numberOfWorkers < 1){
+        numberOfWorkers = 1;
+      }
+      if(static_cast<size_t>(numberOfWorkers) > numberOfTasks){
+        numberOfWorkers = static_cast<int>(numberOfTasks);
+      }
+
+      std::filesystem::create_directories(scratchFolder);
+
+      SharedTaskQueue sharedQueue;
+      createSharedTaskQueue(numberOfWorkers,sharedQueue);
+      SharedTaskQueue *queue = &sharedQueue;
+
+      std::vector< pid_t > workers(numberOfWorkers,-1);
+      int numberOfRunningWorkers = 0;
+      for(int i=0; i<numberOfWorkers; ++i){
+        workers[i] = startWorker(queue,numberOfTasks,i,scratchFolder,task);
+        ++numberOfRunningWorkers;
+      }
+
+      while(numberOfRunningWorkers > 0){
+        int status = 0;
+        pid_t pid = waitpid(-1,&status,0);
+        if(pid < 0){
+          if(errno == EINTR){
+            continue;
+          }
+          break;
+        }
+
+        int workerIndex = -1;
+        for(int i=0; i<numberOfWorkers; ++i){
+          if(workers[i] == pid){
+            workerIndex = i;
+          }
+        }
+        if(workerIndex < 0){
+          continue;
+        }
+        workers[workerIndex] = -1;
+        --numberOfRunningWorkers;
+
+        bool exitedNormally = WIFEXITED(status) && WEXITSTATUS(status)==0;
+        long long taskIndex = queue->current[workerIndex].load();
+
+        if(!exitedNormally && taskIndex >= 0){
+          WorkerFailure failure;
+          failure.taskIndex = static_cast<size_t>(taskIndex);
+          if(WIFEXITED(status)){
+            failure.exitCode = WEXITSTATUS(status);
+          }
+          if(WIFSIGNALED(status)){
+            failure.signal = WTERMSIG(status);
+          }
+          std::ifstream errorFile(
+            getWorkerErrorFilePath(scratchFolder,workerIndex));
+          failure.error.assign(std::istreambuf_iterator<char>(errorFile),
+                               std::istreambuf_iterator<char>());
+          std::cerr << failure.error;
+          failuresUpd.push_back(failure);
+          queue->current[workerIndex].store(-1);
+        }
+
+        if(!exitedNormally && queue->header->next.load() < numberOfTasks){
+          workers[workerIndex] =
+            startWorker(queue,numberOfTasks,workerIndex,scratchFolder,task);
+          ++numberOfRunningWorkers;
+        }
+      }
+
+      destroySharedTaskQueue(sharedQueue);
+      for(int i=0; i<numberOfWorkers; ++i){
+        std::error_code errorCode;
+        std::filesystem::remove(getWorkerErrorFilePath(scratchFolder,i),
+                                errorCode);
+      }
+      //Only removed if it is empty
+      std::error_code errorCode;
+      std::filesystem::remove(scratchFolder,errorCode);
+    };
+
+    //==========================================================================
+    static std::string readWholeFile(int fd){
+      std::string contents;
+      off_t size = lseek(fd,0,SEEK_END);
+      if(size <= 0){
+        return contents;
+      }
+      contents.resize(static_cast<size_t>(size));
+      size_t bytesRead = 0;
+      while(bytesRead < contents.size()){
+        ssize_t n = pread(fd,&contents[bytesRead],contents.size()-bytesRead,
+                          static_cast<off_t>(bytesRead));
+        if(n < 0 && errno == EINTR){
+          continue;
+        }
+        if(n <= 0){
+          break;
+        }
+        bytesRead += static_cast<size_t>(n);
+      }
+      contents.resize(bytesRead);
+      return contents;
+    };
+
+    //==========================================================================
+    /*
+      Evaluates task in a forked copy of the calling process, so that a task
+      that crashes takes down the copy and not the caller, and returns the
+      string that task returned in resultUpd. Everything the task writes to 
+      stdout and stderr is returned in outputUpd. Returns false, with the 
+      exit code and signal in failureUpd, if the copy exited before the task
+      finished.
+
+      Unlike runSupervisedLoop this can be called from several threads at 
+      once. The result and output are passed back through temporary files 
+      rather than pipes: a pipe would also be inherited by the copies forked
+      by the other threads, and would not be closed until they exit.
+    */
+    static bool runIsolatedTask(const std::function<std::string()> &task,
+                                std::string &resultUpd,
+                                std::string &outputUpd,
+                                WorkerFailure &failureUpd){
+
+      resultUpd.clear();
+      outputUpd.clear();
+      failureUpd = WorkerFailure();
+
+      FILE *resultFile = std::tmpfile();
+      FILE *outputFile = std::tmpfile();
+      if(resultFile == nullptr || outputFile == nullptr){
+        if(resultFile != nullptr){
+          std::fclose(resultFile);
+        }
+        if(outputFile != nullptr){
+          std::fclose(outputFile);
+        }
+        failureUpd.error = "could not create the temporary files of the task";
+        return false;
+      }
+      int resultFd = fileno(resultFile);
+      int outputFd = fileno(outputFile);
+
+      std::cout.flush();
+      std::cerr.flush();
+      pid_t pid = fork();
+      if(pid == 0){
+        dup2(outputFd,STDOUT_FILENO);
+        dup2(outputFd,STDERR_FILENO);
+        std::string result = task();
+        std::cout.flush();
+        std::cerr.flush();
+        std::fflush(stdout);
+        size_t written = 0;
+        while(written < result.size()){
+          ssize_t n = write(resultFd,result.data()+written,
+                            result.size()-written);
+          if(n < 0 && errno == EINTR){
+            continue;
+          }
+          if(n <= 0){
+            _exit(1);
+          }
+          written += static_cast<size_t>(n);
+        }
+        _exit(0);
+      }
+
+      bool finished = false;
+      if(pid < 0){
+        failureUpd.error = "could not start the process of the task";
+      }else{
+        int status = 0;
+        while(waitpid(pid,&status,0) < 0 && errno == EINTR){
+        }
+        finished = WIFEXITED(status) && WEXITSTATUS(status)==0;
+        if(WIFEXITED(status)){
+          failureUpd.exitCode = WEXITSTATUS(status);
+        }
+        if(WIFSIGNALED(status)){
+          failureUpd.signal = WTERMSIG(status);
+        }
+        outputUpd = readWholeFile(outputFd);
+        if(finished){
+          resultUpd = readWholeFile(resultFd);
+        }else{
+          failureUpd.error = outputUpd;
+        }
+      }
+
+      std::fclose(resultFile);
+      std::fclose(outputFile);
+      return finished;
+    };
+
+    //==========================================================================
+    /*
+      The journal is a file with one json object per line. The first line
+      holds the hash of the run that wrote it, and each following line is
+      appended when a task finishes. The lines are written with a single
+      call to write on a file opened with O_APPEND, so several processes can
+      append to the same journal.
+    */
+    static bool appendJournalEntry(const std::string &journalPath,
+                                   const nlohmann::ordered_json &entry){
+      std::string line = entry.dump();
+      line.push_back('\n');
+      int fd = open(journalPath.c_str(), O_WRONLY | O_APPEND | O_CREAT, 0644);
+      if(fd < 0){
+        return false;
+      }
+      ssize_t written = write(fd,line.data(),line.size());
+      close(fd);
+      return (written == static_cast<ssize_t>(line.size()));
+    };
+
+    //==========================================================================
+    /*
+      Reads the entries of the journal at journalPath if it was written by a
+      run with the same runHash, and otherwise starts a new journal. A line
+      that is incomplete (the run was stopped while it was being written) is
+      ignored. Returns the number of entries that were read.
+    */
+    static size_t openJournal(const std::string &journalPath,
+                              const std::string &runHash,
+                              std::vector< nlohmann::ordered_json > &entriesUpd){
+
+      entriesUpd.clear();
+
+      bool resume = false;
+      std::ifstream journalFile(journalPath);
+      if(journalFile.is_open()){
+        std::string line;
+        bool firstLine = true;
+        while(std::getline(journalFile,line)){
+          nlohmann::ordered_json entry =
+            nlohmann::ordered_json::parse(line,nullptr,false);
+          if(entry.is_discarded() || !entry.is_object()){
+            continue;
+          }
+          if(firstLine){
+            firstLine = false;
+            resume = entry.contains("run_hash")
+                  && entry["run_hash"].is_string()
+                  && entry["run_hash"].get<std::string>() == runHash;
+            if(!resume){
+              break;
+            }
+            continue;
+          }
+          entriesUpd.push_back(entry);
+        }
+        journalFile.close();
+      }
+
+      if(!resume){
+        entriesUpd.clear();
+        std::ofstream newJournal(journalPath,
+            std::ios_base::trunc | std::ios_base::out);
+        nlohmann::ordered_json header;
+        header["run_hash"] = runHash;
+        newJournal << header.dump() << '\n';
+      }
+      return entriesUpd.size();
+    };
+
+};
+
+#endif
@@ -6,6 +6,9 @@
 #include <string>
 #include <cmath>
 #include <limits>
+#include <algorithm>
+#include <set>
+#include <unistd.h>
 
 #include <boost/math/statistics/linear_regression.hpp>
 
@@ -20,6 +23,19 @@
 #include "NumericalFunctions.h"
 #include "JsonFunctions.h"
 #include "DateFunctions.h"
+#include "ParallelFunctions.h"
+#include "ShardFunctions.h"
+#include "HashFunctions.h"
+#include "ReferenceDataFunctions.h"
+#include "MetricSelectionFunctions.h"
+#include "MonteCarloFunctions.h"
+#include "ResamplingFunctions.h"
+#include "ForexFunctions.h"
+#include "SupervisorFunctions.h"
+#include "ServiceFunctions.h"
+#include "ProfilingFunctions.h"
+#include "ArenaFunctions.h"
+#include "PrefetchFunctions.h"
 
 //============================================================================
 struct AnnualMilestoneDataSet{
@@ -33,40 +49,94 @@ struct AnnualMilestoneDataSet{
 };
 
 //============================================================================
-struct TaxFoundationDataSet{
-  std::vector< int > index;
-  std::vector< int > year;
-  std::vector< std::string > CountryISO2;
-  std::vector< std::string > CountryISO3;
-  std::vector< std::string > continent;
-  std::vector< std::string > country;
-  std::vector< std::vector < double > > taxTable; 
+struct CalculateSettings{
+  std::string fundamentalFolder;
+  std::string historicalFolder;
+  std::string analyseFolder;
+  std::string validFileExtension;
+  std::string timePeriod;
+  bool quarterlyTTMAnalysis;
+  bool verbose;
+  bool setNansToMissingValue;
+  bool appendTermRecord;
+  DataStructures::CalculationConfiguration cc;
+  int acceptableBackwardsYearErrorForTaxRate;
+  int maxDayErrorHistoricalData;
+  int maxDayErrorBondYieldData;
+  int maxDayErrorTTM;
+  int maxDayErrorOutstandingShareData;
+  double maxProportionOfOutliersInExpModel;
+  double minPriceAllowedInPriceModel;
+  double minCycleTimeInYears;
+  double exponentialModelR2Preference;
+  double maxDateErrorInYearsInEmpiricalData;
+  std::vector< double > peMarketVariationUpperBound;
+  bool incremental;
+  bool reusePreviousResults;
+  std::string stateFolder;
+  std::string calculationHash;
+  //Empty unless the quarterly TTM analysis is also written, to this folder
+  std::string ttmAnalyseFolder;
+  MetricSelectionFunctions::MetricSelection metrics;
+  int monteCarloThreads;
+  ResamplingFunctions::ResamplingSettings priceModelResampling;
+};
+
+//============================================================================
+// The inputs of a ticker as they are once they have been loaded and their
+// prices converted. This lets a ticker be analysed for a second time period
+// without reading and parsing its files again. The call that uses the 
+// inputs moves them out of the cache, and so each load serves one more call.
+//============================================================================
+struct TickerInputCache{
+  bool loaded;
+  bool validInput;
+  std::string fileName;
+  std::string tickerName;
+  nlohmann::ordered_json fundamentalData;
+  nlohmann::ordered_json historicalData;
+  std::vector< std::string > inputFilePaths;
+  TickerInputCache():
+    loaded(false),
+    validInput(false){};
 };
+
 //============================================================================
-struct CountryRiskDataSet{
-  std::string Country;
-  std::string CountryISO2;
-  std::string CountryISO3;
-  double PRS;
-  double defaultSpread;
-  double ERP;
-  double taxRate;
-  double CRP;
-  double inflation_2019_2023;
-  double inflation_2024_2028;
-  double riskFreeRate;
-
-  CountryRiskDataSet():
-    PRS(std::nan("1")),
-    defaultSpread(std::nan("1")),
-    ERP(std::nan("1")),
-    taxRate(std::nan("1")),
-    CRP(std::nan("1")),
-    inflation_2019_2023(std::nan("1")),
-    inflation_2024_2028(std::nan("1")),
-    riskFreeRate(std::nan("1")){}
+// Tabular data that is shared by every ticker. This is loaded once, before
+// any ticker is evaluated, and is only read afterwards so that it can be
+// shared between threads.
+//============================================================================
+struct ReferenceDataSet{
+  ReferenceDataFunctions::ReferenceTables tables;
+  ReferenceDataFunctions::CountryRiskDataSet homeRiskTable;
+  double defaultInflationRate;
+  ForexFunctions::ForexStore *forexStore; //Loads FOREX series on first use
+  //Finds the keywords of cc.fund_liquidity_families in the fund names
+  StringFunctions::KeywordMatcher fundKeyWordMatcher;
+  //The FUNDAMENTAL_SECTIONS that are parsed from each fundamental file
+  JsonFunctions::SectionFilter fundamentalSections;
+  ReferenceDataSet():
+    defaultInflationRate(0.),
+    forexStore(nullptr){};
 };
 
+//============================================================================
+// The sections of a fundamental file that are read by calculate. The rest
+// (e.g. Holders.Institutions, ESGScores, AnalystRatings, SplitsDividends, 
+// and Earnings.Trend) can be large and are skipped while the file is 
+// parsed. A section that calculateTicker starts to read has to be added 
+// here, otherwise it will appear to be missing from every file.
+//============================================================================
+const std::vector< std::string > FUNDAMENTAL_SECTIONS = {
+  "General",
+  "Technicals",
+  "Valuation",
+  "Financials",
+  "Earnings.History",
+  "Earnings.Annual",
+  "outstandingShares",
+  "Holders.Funds"};
+
 
 
 
@@ -282,7 +352,7 @@ bool extractAnalysisDates(
       DataStructures::AnalysisDates &analysisDates,
       const nlohmann::ordered_json &fundamentalData,
       const nlohmann::ordered_json &historicalData,
-      const nlohmann::ordered_json &bondData,
+      const std::vector< std::string > &bondDates,
       const std::string &timePeriod,
       const std::string &timePeriodOutstandingShares,
       int maxDayErrorHistoricalData,
@@ -436,9 +506,7 @@ bool extractAnalysisDates(
     }  
     validDates = (validDates && analysisDates.historical.size() > 0);
     
-    for(auto& el : bondData.items()){
-      analysisDates.bond.push_back(el.key());
-    }
+    analysisDates.bond = bondDates;
     validDates = (validDates && analysisDates.bond.size() > 0);
 
     analysisDates.recentHistoricalDate 
@@ -716,87 +784,10 @@ bool extractAnalysisDates(
 
 };
 
-//============================================================================
-double getTaxRateFromTable(
-        const std::string& countryISO2, 
-        int year, 
-        int yearMin, 
-        const TaxFoundationDataSet &taxDataSet)
-{
-
-  double taxRate = std::numeric_limits<double>::quiet_NaN();                              
-
-  //Get the country index
-  bool foundCountry=false;
-  int indexCountry = 0;
-  while(indexCountry < taxDataSet.CountryISO3.size() && !foundCountry ){
-    if(countryISO2.compare(taxDataSet.CountryISO2[indexCountry])==0){
-      foundCountry=true;
-    }else{
-      ++indexCountry;
-    }
-  }  
-
-  int indexYearMin  = -1;
-  int indexYear     = -1;
-
-  if(foundCountry){
-    //Get the closest index to yearMin
-    int index         = 0;
-    int err           = 1;
-
-    int errYear       = std::numeric_limits<int>::max();
-
-    while(index < taxDataSet.year.size() && err > 0 ){
-      err = yearMin - taxDataSet.year[index];
-      if(err < errYear ){
-        errYear = err;
-        indexYearMin = index;
-      }else{
-        ++index;
-      }
-    }  
-    //Get the closest index to year
-    index     = indexYearMin;
-    err       = 1;
-    errYear   = std::numeric_limits<int>::max();
-
-    while(index < taxDataSet.year.size() && err > 0 ){
-      err = year - taxDataSet.year[index];
-      if(err < errYear ){
-        errYear = err;
-        indexYear = index;
-      }else{
-        ++index;
-      }
-    }  
-  }
-
-  //Scan backwards from the most recent acceptable year to year min
-  //and return the first valid tax rate
-  if(foundCountry && (indexYear > 0 && indexYearMin > 0)){
-    bool validIndex=true;
-
-    int index = indexYear;
-    taxRate = taxDataSet.taxTable[indexCountry][index];
-    while( std::isnan(taxRate) && index > indexYearMin && validIndex){
-      --index;
-      if(index < 0){
-        validIndex = false;
-      }else{
-        taxRate = taxDataSet.taxTable[indexCountry][index];   
-      }
-    }
-    
-  }
-
-  return taxRate;
-
-};
 //============================================================================
 double calcAverageTaxRate(  const DataStructures::AnalysisDates &analysisDates,
                             const std::string& countryISO2, 
-                            const TaxFoundationDataSet &corpWorldTaxTable,
+              const ReferenceDataFunctions::TaxRateTable &corpWorldTaxTable,
                             double defaultTaxRate,                            
                             int maxYearErrorTaxRateTable,
                             bool quarterlyTTMAnalysis,
@@ -843,8 +834,8 @@ double calcAverageTaxRate(  const DataStructures::AnalysisDates &analysisDates,
     for(unsigned int j=0; j<dateSet.dates.size();++j){
       int year  = std::stoi(dateSet.dates[j].substr(0,4));
       int yearMin = year-maxYearErrorTaxRateTable;
-      double taxRateDate = getTaxRateFromTable(countryISO2, year, yearMin, 
-                                    corpWorldTaxTable);
+      double taxRateDate = ReferenceDataFunctions::getTaxRate(
+                            corpWorldTaxTable, countryISO2, year, yearMin);
       taxRate += taxRateDate*dateSet.weightsNormalized[j];
     }
     taxRate = taxRate*0.01;                                   
@@ -867,146 +858,12 @@ double calcAverageTaxRate(  const DataStructures::AnalysisDates &analysisDates,
 
 };
 
-//============================================================================
-bool loadTaxFoundationDataSet(std::string &fileName, 
-                              TaxFoundationDataSet &dataSet){
-
-  bool validFormat=false;                                  
-  std::ifstream file(fileName);
-
-  if(file.is_open()){
-    validFormat=true;
-    std::string line;
-    std::string entry;
-
-    //First line is the header: check entries + read in years    
-    std::getline(file,line); 
-
-    std::size_t idx0=0;
-    std::size_t idx1=0;
-    int column = 0;
-    std::vector< double > dataRow;
-    dataRow.clear();
-
-    idx1 = line.find_first_of(',',idx0);
-    entry = line.substr(idx0,idx1-idx0);
-
-    do{
-        if(column <= 4){
-          switch(column){
-            case 1:{
-                if(entry.compare("iso_2") != 0){
-                  validFormat=false;
-                }
-            }break;
-            case 2:{
-              if(entry.compare("iso_3") != 0){
-                  validFormat=false;
-              }
-            } break;
-            case 3:{
-              if(entry.compare("continent") != 0){
-                  validFormat=false;
-              }
-            }break;
-            case 4:{
-              if(entry.compare("country") != 0){
-                  validFormat=false;
-              }                
-            }break;
-          };
-        }else{
-          if(entry.compare("NA") == 0){
-            dataSet.year.push_back(-1);
-            validFormat=false;
-          }else{
-            dataSet.year.push_back(std::stoi(entry));
-          }
-        }
-
-        idx0 = idx1+1;
-        idx1 = line.find_first_of(',',idx0);
-        entry = line.substr(idx0,idx1-idx0);
-
-        ++column;
-    }while(    idx0 !=  std::string::npos 
-            && idx1 !=  std::string::npos 
-            && validFormat);
-
-
-    //Read in the data table
-    while(std::getline(file,line) && validFormat){
-
-        idx0=0;
-        idx1=0;
-        dataRow.clear();
-        column = 0;
-        idx1 = line.find_first_of(',',idx0);
-        entry = line.substr(idx0,idx1-idx0);
-
-        do{
-
-
-          if(column <= 4){
-            switch(column){
-              case 0:{
-                  dataSet.index.push_back(std::stoi(entry));
-              } break;
-              case 1:{
-                  dataSet.CountryISO2.push_back(entry);
-              }break;
-              case 2:{
-                dataSet.CountryISO3.push_back(entry);
-              } break;
-              case 3:{
-                dataSet.continent.push_back(entry);
-              }break;
-              case 4:{
-                dataSet.country.push_back(entry);                
-              }break;
-            };
-          }else{
-            if(entry.compare("NA") == 0){
-              dataRow.push_back(std::nan("1"));
-            }else{
-              dataRow.push_back(std::stod(entry));
-            }
-          }
-          idx0 = idx1+1;
-          idx1 = line.find_first_of(',',idx0);
-          entry = line.substr(idx0,idx1-idx0);
-
-          if(entry.find_first_of('"') != std::string::npos){
-            //Opening bracket
-            idx1 = line.find_first_of('"',idx0);
-            //Closing bracket
-            idx1 = line.find_first_of('"',idx1+1);
-            //Final comma
-            idx1 = line.find_first_of(',',idx1);
-            entry = line.substr(idx0,idx1-idx0);
-          }
-
-          ++column;
-        }while( idx0 !=  std::string::npos && idx1 !=  std::string::npos );
-
-        dataSet.taxTable.push_back(dataRow);
-
-
-    }
-    file.close();
-  }else{
-   std::cout << " Warning: Reverting to default tax rate. Failed to " 
-             << " read in " << fileName << std::endl; 
-  }
-
-  return validFormat;
-};
 //============================================================================
 double calcAverageInterestCover(  
           const DataStructures::AnalysisDates &analysisDates,
           const nlohmann::ordered_json &fundamentalData,
           double defaultInterestCover,
-          const nlohmann::ordered_json &jsonDefaultSpread,
+          const ReferenceDataFunctions::DefaultSpreadTable &defaultSpreads,
           const std::string &timePeriod,
           bool quarterlyTTMAnalysis,
           int maxDayErrorTTM,
@@ -1023,6 +880,8 @@ double calcAverageInterestCover(
 
   bool appendTermRecordLocal=false;
 
+  FinancialAnalysisFunctions::MetricGraph metricGraph;
+  DataStructures::TermRecord localTermRecord;
 
   while( (indexDate+1) < analysisDates.common.size() && validDateSet){
 
@@ -1045,19 +904,23 @@ double calcAverageInterestCover(
       break;
     }
 
-    std::vector<std::string> localTermNames;
-    std::vector<double> localTermValues;
+    localTermRecord.clear();
+
+    FinancialAnalysisFunctions::resetMetricGraph(fundamentalData,
+                                                nullptr,
+                                                dateSet,
+                                                nullptr,
+                                                timePeriod.c_str(),
+                                                nullptr,
+                                                setNansToMissingValue,
+                                                metricGraph);
 
     double interestCover = FinancialAnalysisFunctions::
-        calcInterestCover(fundamentalData,
-                          dateSet,
+        calcInterestCover(metricGraph,
                           defaultInterestCover,
-                          jsonDefaultSpread,
-                          timePeriod.c_str(),
+                          defaultSpreads,
                           appendTermRecord,
-                          setNansToMissingValue,
-                          localTermNames,
-                          localTermValues);
+                          localTermRecord);
                   
     meanInterestCover += interestCover;                          
     meanInterestCoverEntryCount += 1.0; 
@@ -1069,6 +932,289 @@ double calcAverageInterestCover(
   return meanInterestCover;
 
 };
+//============================================================================
+/*
+  Writes the price to value ratios of a grid of discounted cash flow 
+  scenarios (see createDiscountedCashFlowScenarioGrid) as a nested array
+  indexed by [costOfCapital][growth][yearsOfGrowth][terminalGrowth].
+*/
+nlohmann::ordered_json convertPriceToValueSurfaceToJson(
+    const std::string &date,
+    const FinancialAnalysisFunctions::DiscountedCashFlowScenarios &scenarios,
+    double costOfCapital,
+    double afterTaxOperatingIncomeGrowth,
+    double terminalGrowth,
+    const DataStructures::CalculationConfiguration &cc){
+
+  const std::vector< double > &costOfCapitalOffsets 
+    = cc.dcf_scenario_cost_of_capital_offsets;
+  const std::vector< double > &growthOffsets 
+    = cc.dcf_scenario_growth_offsets;
+  const std::vector< int > &yearsOfGrowth 
+    = cc.dcf_scenario_years_of_growth;
+  const std::vector< double > &terminalGrowthOffsets 
+    = cc.dcf_scenario_terminal_growth_offsets;
+
+  nlohmann::ordered_json surface;
+  surface["date"] = date;
+
+  std::vector< double > costOfCapitalAxis, growthAxis, terminalGrowthAxis;
+  for(auto const &offset : costOfCapitalOffsets){
+    costOfCapitalAxis.push_back(costOfCapital+offset);
+  }
+  for(auto const &offset : growthOffsets){
+    growthAxis.push_back(afterTaxOperatingIncomeGrowth+offset);
+  }
+  for(auto const &offset : terminalGrowthOffsets){
+    terminalGrowthAxis.push_back(terminalGrowth+offset);
+  }
+  surface["costOfCapital"]                 = costOfCapitalAxis;
+  surface["afterTaxOperatingIncomeGrowth"] = growthAxis;
+  surface["numberOfYearsOfGrowth"]         = yearsOfGrowth;
+  surface["terminalGrowth"]                = terminalGrowthAxis;
+
+  size_t index = 0;
+  nlohmann::ordered_json priceToValue = nlohmann::ordered_json::array();
+  for(size_t i=0; i<costOfCapitalOffsets.size(); ++i){
+    nlohmann::ordered_json growthEntry = nlohmann::ordered_json::array();
+    for(size_t j=0; j<growthOffsets.size(); ++j){
+      nlohmann::ordered_json yearsEntry = nlohmann::ordered_json::array();
+      for(size_t k=0; k<yearsOfGrowth.size(); ++k){
+        nlohmann::ordered_json terminalEntry 
+          = nlohmann::ordered_json::array();
+        for(size_t l=0; l<terminalGrowthOffsets.size(); ++l){
+          terminalEntry.push_back(scenarios.priceToValue[index]);
+          ++index;
+        }
+        yearsEntry.push_back(terminalEntry);
+      }
+      growthEntry.push_back(yearsEntry);
+    }
+    priceToValue.push_back(growthEntry);
+  }
+  surface["priceToValue"] = priceToValue;
+
+  return surface;
+};
+
+//============================================================================
+/*
+  Evaluates the Monte Carlo discounted free-cash-flow valuation of the most
+  recent date in metricData. The revenue growth rates and free-cash-flow
+  margins are taken from the revenue growth and revenue-to-free-cash-flow
+  models, and the cost of capital and terminal growth rates (the risk free
+  rate) from every date in metricData.
+*/
+nlohmann::ordered_json calcPriceToValueDistributionJson(
+    const nlohmann::ordered_json &metricData,
+    const DataStructures::MetricGrowthDataSet &revenueGrowthModel,
+    const DataStructures::EmpiricalRelationModel &revenueFcfModel,
+    const std::string &streamName,
+    const CalculateSettings &settings){
+
+  nlohmann::ordered_json distributionJson;
+
+  if(metricData.empty() || revenueGrowthModel.datesNumerical.empty()
+     || settings.cc.monte_carlo_number_of_paths < 1){
+    return distributionJson;
+  }
+
+  std::string date = metricData.begin().key();
+  const nlohmann::ordered_json &recentData = metricData.begin().value();
+
+  double marketCapitalization = std::nan("1");
+  if(recentData.contains("costOfCapital_marketCapitalization")){
+    marketCapitalization = JsonFunctions::getJsonFloat(
+                            recentData["costOfCapital_marketCapitalization"]);
+  }
+
+  int idxRGM = DateFunctions::getIndexClosestToDate(
+                  DateFunctions::convertToFractionalYear(date),
+                  revenueGrowthModel.datesNumerical);
+  double revenue = revenueGrowthModel.metricValue[idxRGM];
+
+  std::vector< double > freeCashFlowMargin;
+  for(size_t i=0; i<revenueFcfModel.x.size(); ++i){
+    if(revenueFcfModel.x[i] > 0.){
+      freeCashFlowMargin.push_back(revenueFcfModel.y[i]/revenueFcfModel.x[i]);
+    }
+  }
+
+  std::vector< double > costOfCapital, terminalGrowth;
+  for(auto const &entry : metricData){
+    if(entry.contains("costOfCapital")){
+      double value = JsonFunctions::getJsonFloat(entry["costOfCapital"]);
+      if(JsonFunctions::isJsonFloatValid(value)){
+        costOfCapital.push_back(value);
+      }
+    }
+    if(entry.contains("costOfEquityAsAPercentage_riskFreeRate")){
+      double value = JsonFunctions::getJsonFloat(
+                      entry["costOfEquityAsAPercentage_riskFreeRate"]);
+      if(JsonFunctions::isJsonFloatValid(value)){
+        terminalGrowth.push_back(value);
+      }
+    }
+  }
+
+  MonteCarloFunctions::DiscountedCashFlowDistributions distributions;
+  MonteCarloFunctions::createEmpiricalDistribution(
+      revenueGrowthModel.metricGrowthRate, distributions.revenueGrowth);
+  MonteCarloFunctions::createEmpiricalDistribution(
+      freeCashFlowMargin, distributions.freeCashFlowMargin);
+  MonteCarloFunctions::createEmpiricalDistribution(
+      costOfCapital, distributions.costOfCapital);
+  MonteCarloFunctions::createEmpiricalDistribution(
+      terminalGrowth, distributions.terminalGrowth);
+
+  MonteCarloFunctions::MonteCarloSettings monteCarloSettings;
+  monteCarloSettings.numberOfPaths   = settings.cc.monte_carlo_number_of_paths;
+  monteCarloSettings.numberOfYearsOfGrowth
+                                     = settings.cc.number_of_years_of_growth;
+  monteCarloSettings.numberOfThreads = settings.monteCarloThreads;
+  monteCarloSettings.streamKey       = MonteCarloFunctions::calcStreamKey(
+          streamName, static_cast<uint64_t>(settings.cc.monte_carlo_seed));
+
+  MonteCarloFunctions::MonteCarloValuation valuation;
+  bool valid = MonteCarloFunctions::
+    calcPriceToValueDistributionUsingDiscountedFreeCashFlow(
+      revenue,
+      marketCapitalization,
+      distributions,
+      monteCarloSettings,
+      valuation);
+
+  if(!valid){
+    return distributionJson;
+  }
+
+  std::vector< double > percentiles(Percentiles,
+                                    Percentiles+NUM_PERCENTILES);
+
+  distributionJson["date"]                  = date;
+  distributionJson["number_of_paths"]       = valuation.numberOfPaths;
+  distributionJson["number_of_valid_paths"] = valuation.numberOfValidPaths;
+  distributionJson["seed"]                  = settings.cc.monte_carlo_seed;
+  distributionJson["revenue"]               = revenue;
+  distributionJson["market_capitalization"] = marketCapitalization;
+  distributionJson["number_of_years_of_growth"]
+    = settings.cc.number_of_years_of_growth;
+  distributionJson["number_of_samples"]["revenue_growth"]
+    = distributions.revenueGrowth.sortedValues.size();
+  distributionJson["number_of_samples"]["free_cash_flow_margin"]
+    = distributions.freeCashFlowMargin.sortedValues.size();
+  distributionJson["number_of_samples"]["cost_of_capital"]
+    = distributions.costOfCapital.sortedValues.size();
+  distributionJson["number_of_samples"]["terminal_growth"]
+    = distributions.terminalGrowth.sortedValues.size();
+  distributionJson["percentiles"]           = percentiles;
+  distributionJson["price_to_value"]        = valuation.priceToValue;
+  distributionJson["probability_undervalued"]
+    = valuation.probabilityUndervalued;
+  distributionJson["probability_positive_value"]
+    = valuation.probabilityPositiveValue;
+
+  return distributionJson;
+};
+
+//============================================================================
+/*
+  Fits a cyclical model with either an exponential or a linear baseline to
+  the price history: whichever baseline fits best.
+*/
+void fitPriceModel(const std::vector< double > &datesHistorical,
+                   const std::vector< double > &priceHistorical,
+                   double minCycleTimeInYears,
+                   double maxProportionOfOutliersInExpModel,
+                   DataStructures::EmpiricalGrowthModel &priceModelUpd){
+
+  DataStructures::EmpiricalGrowthModel linearPriceModel;
+  DataStructures::EmpiricalGrowthModel exponentialPriceModel;
+
+  bool forceZeroSlope=false;
+  NumericalFunctions::fitLinearGrowthModel(
+      datesHistorical,priceHistorical,forceZeroSlope,linearPriceModel);
+
+  NumericalFunctions::fitCyclicalModelWithExponentialBaseline(
+                            datesHistorical, 
+                            priceHistorical,
+                            minCycleTimeInYears,
+                            maxProportionOfOutliersInExpModel,
+                            exponentialPriceModel);
+
+
+  if(exponentialPriceModel.validFitting && linearPriceModel.validFitting){
+    if(exponentialPriceModel.r2 > linearPriceModel.r2){
+      priceModelUpd = exponentialPriceModel;
+    }else{
+      NumericalFunctions::fitCyclicalModelWithLinearBaseline(
+                           datesHistorical,
+                           priceHistorical,
+                           minCycleTimeInYears,
+                           forceZeroSlope,
+                           priceModelUpd);
+    }
+  }else{
+    if(exponentialPriceModel.validFitting){
+      priceModelUpd = exponentialPriceModel;
+    }else if(linearPriceModel.validFitting){
+      NumericalFunctions::fitCyclicalModelWithLinearBaseline(
+                           datesHistorical,
+                           priceHistorical,
+                           minCycleTimeInYears,
+                           forceZeroSlope,
+                           priceModelUpd);
+    }
+  }
+};
+
+//============================================================================
+/*
+  Compares the price model fitted to a resampled price history with the model
+  fitted to the full price history at the dates that were kept. The errors
+  are relative to the full resolution fit.
+*/
+nlohmann::ordered_json calcPriceModelResamplingErrorJson(
+    const DataStructures::EmpiricalGrowthModel &priceModel,
+    const DataStructures::EmpiricalGrowthModel &priceModelFullResolution,
+    const std::vector< size_t > &indicesResampled,
+    double &maximumRelativeErrorUpd){
+
+  nlohmann::ordered_json errorJson;
+  maximumRelativeErrorUpd = std::nan("1");
+
+  if(   !priceModel.validFitting 
+     || !priceModelFullResolution.validFitting
+     || priceModel.y.size() != indicesResampled.size()
+     || indicesResampled.empty()){
+    return errorJson;
+  }
+
+  double maximumRelativeError = 0.;
+  double sumSquaredRelativeError = 0.;
+  for(size_t i=0; i<indicesResampled.size(); ++i){
+    double yFull = priceModelFullResolution.y[indicesResampled[i]];
+    double relativeError = std::abs(priceModel.y[i]-yFull)/std::abs(yFull);
+    maximumRelativeError = std::max(maximumRelativeError,relativeError);
+    sumSquaredRelativeError += relativeError*relativeError;
+  }
+  double rmsRelativeError = std::sqrt(sumSquaredRelativeError
+                            /static_cast<double>(indicesResampled.size()));
+
+  maximumRelativeErrorUpd = maximumRelativeError;
+
+  errorJson["maximum_relative_error"] = maximumRelativeError;
+  errorJson["rms_relative_error"]     = rmsRelativeError;
+  errorJson["r2"]                     = priceModel.r2;
+  errorJson["r2_full_resolution"]     = priceModelFullResolution.r2;
+  errorJson["annual_growth_rate_of_trendline"] = 
+    priceModel.annualGrowthRateOfTrendline;
+  errorJson["annual_growth_rate_of_trendline_full_resolution"] = 
+    priceModelFullResolution.annualGrowthRateOfTrendline;
+
+  return errorJson;
+};
+
 //============================================================================
 double calcLastValidDateIndex(
           const DataStructures::AnalysisDates &analysisDates,
@@ -1123,9 +1269,9 @@ double calcLastValidDateIndex(
 
 //============================================================================
 double getTaxRate(std::string &date, 
-                  const CountryRiskDataSet &riskTable,
+                  const ReferenceDataFunctions::CountryRiskDataSet &riskTable,
                   const std::string& countryISO2, 
-                  const TaxFoundationDataSet &corpWorldTaxTable,
+                  const ReferenceDataFunctions::TaxRateTable &corpWorldTaxTable,
                   double meanTaxRate,
                   double defaultTaxRate,
                   int acceptableBackwardsYearErrorForTaxRate,
@@ -1139,8 +1285,8 @@ double getTaxRate(std::string &date,
   if(usingTaxTable){
     int year  = std::stoi(date.substr(0,4));
     int yearMin = year-acceptableBackwardsYearErrorForTaxRate;
-    taxRate = getTaxRateFromTable(countryISO2, year, yearMin, 
-                                  corpWorldTaxTable);
+    taxRate = ReferenceDataFunctions::getTaxRate(corpWorldTaxTable, 
+                                                 countryISO2, year, yearMin);
     taxRate = taxRate*0.01;  //convert from percent to decimal                                     
     if(std::isnan(taxRate)){
       taxRate=meanTaxRate;    
@@ -1165,886 +1311,1124 @@ double getTaxRate(std::string &date,
 };
 
 
+//============================================================================
+// The calculation manifest records the inputs that were used to produce
+// each output file:
+//
+//  - a hash of the CalculationConfiguration fields and calculate's settings
+//  - a hash of the reference tables (default spread, bond yield, tax, and
+//    country risk tables)
+//  - for each ticker file, the path, size, modification time, and content
+//    hash of the fundamental and historical files that were read.
+//
+// A ticker is only evaluated again if one of these has changed. The size and
+// modification time are checked first so that files that have not been 
+// touched do not have to be read: the content hash is only evaluated when
+// these differ (e.g. when fetch has re-written a file with the same data).
+//
+// Increment this when a change to the calculation should invalidate every
+// existing output.
+//============================================================================
+const int CALCULATION_MANIFEST_VERSION = 1;
 
 //============================================================================
-int main (int argc, char* argv[]) {
+std::string calcConfigurationHash(const CalculateSettings &settings){
+
+  const DataStructures::CalculationConfiguration &cc = settings.cc;
+
+  std::stringstream ss;
+  ss << std::setprecision(17);
+  ss << CALCULATION_MANIFEST_VERSION              << '\n'
+     << settings.timePeriod                       << '\n'
+     << settings.quarterlyTTMAnalysis             << '\n'
+     << settings.setNansToMissingValue            << '\n'
+     << settings.appendTermRecord                 << '\n'
+     << settings.acceptableBackwardsYearErrorForTaxRate << '\n'
+     << settings.maxDayErrorHistoricalData        << '\n'
+     << settings.maxDayErrorBondYieldData         << '\n'
+     << settings.maxDayErrorTTM                   << '\n'
+     << settings.maxDayErrorOutstandingShareData  << '\n'
+     << settings.maxProportionOfOutliersInExpModel<< '\n'
+     << settings.minPriceAllowedInPriceModel      << '\n'
+     << settings.minCycleTimeInYears              << '\n'
+     << settings.exponentialModelR2Preference     << '\n'
+     << settings.maxDateErrorInYearsInEmpiricalData << '\n';
+  //Only added when it is used so that existing manifests stay valid
+  if(settings.ttmAnalyseFolder.length()>0){
+    ss << "ttm_output" << '\n';
+  }
+  for(auto const &value : settings.cc.dcf_scenario_cost_of_capital_offsets){
+    ss << value << '\n';
+  }
+  for(auto const &value : settings.cc.dcf_scenario_growth_offsets){
+    ss << value << '\n';
+  }
+  for(auto const &value : settings.cc.dcf_scenario_years_of_growth){
+    ss << value << '\n';
+  }
+  for(auto const &value : settings.cc.dcf_scenario_terminal_growth_offsets){
+    ss << value << '\n';
+  }
+  for(auto const &value : settings.peMarketVariationUpperBound){
+    ss << value << '\n';
+  }
+  ss << cc.monte_carlo_number_of_paths            << '\n'
+     << cc.monte_carlo_seed                       << '\n'
+     << cc.price_model_resampling_method          << '\n'
+     << cc.price_model_resampling_maximum_number_of_points << '\n'
+     << cc.price_model_resampling_error_report    << '\n'
+     << cc.price_model_resampling_maximum_relative_error   << '\n';
+  for(auto const &family : cc.fund_liquidity_families){
+    ss << family.name << '\n'
+       << family.keyword << '\n'
+       << family.daysToAverageTradingVolumeOver << '\n';
+  }
+  //Only included when a subset is selected so that the manifests written
+  //before metrics could be selected remain valid
+  if(!settings.metrics.allSelected){
+    ss << MetricSelectionFunctions::getSelectedFamilyNames(settings.metrics)
+       << '\n';
+  }
+  ss << cc.default_interest_cover                 << '\n'
+     << cc.default_tax_rate                       << '\n'
+     << cc.default_risk_free_rate                 << '\n'
+     << cc.default_beta                           << '\n'
+     << cc.equity_risk_premium_usa                << '\n'
+     << cc.discount_rate                          << '\n'
+     << cc.mature_firm_fraction_debt_to_capital   << '\n'
+     << cc.number_of_years_to_average_capital_expenditures << '\n'
+     << cc.number_of_years_of_growth              << '\n'
+     << cc.number_of_years_used_in_growth_rate_calculation << '\n'
+     << cc.max_day_error                          << '\n';
+
+  return HashFunctions::convertHashToString(
+            HashFunctions::calcStableHash(ss.str()));
+};
 
-  std::string exchangeCode;
-  std::string fundamentalFolder;
-  std::string historicalFolder;
-  std::string forexFolder;
-  std::string configurationFile;
-  std::string eodFolder;
-  std::string analyseFolder;
-  std::string timePeriod;
-  std::string singleFileToEvaluate;
+//============================================================================
+std::string calcReferenceDataHash(
+              const DataStructures::CalculationConfiguration &cc,
+              const std::string &nameOfHomeCountryISO3,
+              double defaultInflationRate){
+
+  std::vector< std::string > referenceFiles;
+  referenceFiles.push_back(cc.default_spread_json_file);
+  referenceFiles.push_back(cc.bond_yield_json_file);
+  referenceFiles.push_back(cc.world_corporate_tax_rate_csv_file);
+  referenceFiles.push_back(cc.equity_risk_premium_by_country_json_file);
+  referenceFiles.push_back(cc.currency_units_json_file);
+
+  std::stringstream ss;
+  ss << std::setprecision(17);
+  for(auto const &filePath : referenceFiles){
+    uint64_t fileHash=0;
+    if(HashFunctions::calcFileHash(filePath,fileHash)){
+      ss << HashFunctions::convertHashToString(fileHash) << '\n';
+    }else{
+      ss << "missing" << '\n';
+    }
+  }
+  ss << nameOfHomeCountryISO3 << '\n';
+  ss << defaultInflationRate << '\n';
 
-  bool quarterlyTTMAnalysis;
-  bool relaxedCalculation;
-  
-  DataStructures::CalculationConfiguration cc;
+  return HashFunctions::convertHashToString(
+            HashFunctions::calcStableHash(ss.str()));
+};
 
-  nlohmann::ordered_json currencyUnits;
-  std::string nameOfHomeCountryISO3;
+//============================================================================
+void recordInputFile(const std::string &filePath,
+                     nlohmann::ordered_json &inputRecordUpd){
 
+  inputRecordUpd.clear();
+  inputRecordUpd["path"] = filePath;
 
-  bool verbose;
+  std::error_code errorCode;
+  if(!std::filesystem::exists(filePath,errorCode)){
+    inputRecordUpd["hash"] = "missing";
+    return;
+  }
 
-  try{
-    TCLAP::CmdLine cmd("The command will analyze fundamental and end-of-data"
-    "data (from https://eodhistoricaldata.com/) and "
-    "write the results of the calculation to a json file in an output directory"
-    ,' ', "0.0");
+  uint64_t fileHash=0;
+  HashFunctions::calcFileHash(filePath,fileHash);
+  inputRecordUpd["hash"] = HashFunctions::convertHashToString(fileHash);
+  inputRecordUpd["size"] = std::filesystem::file_size(filePath,errorCode);
+  inputRecordUpd["time"] = static_cast<long long>(
+    std::filesystem::last_write_time(filePath,errorCode)
+      .time_since_epoch().count());
+};
 
+//============================================================================
+bool isInputFileUnchanged(const nlohmann::ordered_json &previousRecord,
+                          nlohmann::ordered_json &inputRecordUpd){
 
-    TCLAP::ValueArg<std::string> fundamentalFolderInput("f",
-      "fundamental_data_folder_path", 
-      "The path to the folder that contains the fundamental data json files from "
-      "https://eodhistoricaldata.com/ to analyze",
-      true,"","string");
-    cmd.add(fundamentalFolderInput);
+  std::string filePath;
+  std::string previousHash;
+  JsonFunctions::getJsonString(previousRecord.at("path"),filePath);
+  JsonFunctions::getJsonString(previousRecord.at("hash"),previousHash);
 
-    TCLAP::ValueArg<std::string> historicalFolderInput("p",
-      "historical_data_folder_path", 
-      "The path to the folder that contains the historical (price)"
-      " data json files from https://eodhistoricaldata.com/ to analyze",
-      true,"","string");
-    cmd.add(historicalFolderInput);
+  inputRecordUpd = previousRecord;
 
-    TCLAP::ValueArg<std::string> forexFolderInput("r",
-      "forex_data_folder_path", 
-      "The path to the folder that contains the FOREX"
-      " data json files from https://eodhistoricaldata.com/",
-      true,"","string");
-    cmd.add(forexFolderInput);
+  std::error_code errorCode;
+  bool fileExists = std::filesystem::exists(filePath,errorCode);
+  if(previousHash.compare("missing")==0 || !fileExists){
+    return (previousHash.compare("missing")==0 && !fileExists);
+  }
 
+  //Fast path: the file has not been touched
+  uintmax_t size = std::filesystem::file_size(filePath,errorCode);
+  long long time = static_cast<long long>(
+    std::filesystem::last_write_time(filePath,errorCode)
+      .time_since_epoch().count());
 
-    TCLAP::ValueArg<std::string> configurationFileInput("c",
-      "configuration_file_input", 
-      "The path to the json file that contains default parameter settings"
-      " and paths to tabular data (defaultSpreadTable, bondYieldTable, "
-      " tax-rates-around-the-world, and the countryRisk table).",
-      true,"","string");
-    cmd.add(configurationFileInput);    
+  if(previousRecord.contains("size") && previousRecord.contains("time")){
+    if(previousRecord["size"].get<uintmax_t>() == size
+       && previousRecord["time"].get<long long>() == time){
+      return true;
+    }
+  }
 
-    TCLAP::ValueArg<std::string> singleFileToEvaluateInput("i",
-      "single_ticker_name", 
-      "To evaluate a single ticker only, set the ticker name here.",
-      false,"","string");
-    cmd.add(singleFileToEvaluateInput);
+  //Slow path: the file has been touched, check the contents
+  recordInputFile(filePath,inputRecordUpd);
+  std::string hash;
+  JsonFunctions::getJsonString(inputRecordUpd["hash"],hash);
+  return (hash.compare(previousHash)==0);
+};
 
-    TCLAP::ValueArg<std::string> exchangeCodeInput("x","exchange_code", 
-      "The exchange code. For example: US",
-      false,"","string");
-    cmd.add(exchangeCodeInput);  
-     
+//============================================================================
+// True if the inputs of a ticker have not changed since previousEntry was
+// recorded and its output files still exist.
+//
+// ttmAnalyseFolder : empty unless the quarterly TTM analysis is also written,
+//                    in which case its output (ttm_output) is checked too.
+//============================================================================
+bool isTickerUnchanged(const nlohmann::ordered_json &previousEntry,
+                       const std::string &analyseFolder,
+                       const std::string &ttmAnalyseFolder,
+                       nlohmann::ordered_json &entryUpd){
+
+  entryUpd = previousEntry;
+  if(!previousEntry.contains("inputs") || !previousEntry.contains("output")){
+    return false;
+  }
+  if(ttmAnalyseFolder.length()>0 && !previousEntry.contains("ttm_output")){
+    return false;
+  }
 
-    TCLAP::ValueArg<std::string> nameOfHomeCountryISO3Input("n",
-      "iso3_name_of_home_country", 
-      "Name of your home country in ISO3 format (e.g. USA for the"
-      " United States of America, DEU for Germany, etc)",
-      false,"","string");
-    cmd.add(nameOfHomeCountryISO3Input);  
+  std::string outputFileName;
+  JsonFunctions::getJsonString(previousEntry["output"],outputFileName);
+  if(outputFileName.length()>0){
+    std::error_code errorCode;
+    if(!std::filesystem::exists(analyseFolder+outputFileName,errorCode)){
+      return false;
+    }
+  }
 
-    TCLAP::SwitchArg relaxedCalculationInput("l","relaxed",
-      "Relaxed calculation: nulls for some values (short term debt,"
-      " research and development, dividends, depreciation) are set to "
-      " zero, while substitute calculations are used to replace "
-      " null values (shortLongDebt replaced with longDebt)", false);
-    cmd.add(relaxedCalculationInput); 
+  if(ttmAnalyseFolder.length()>0){
+    std::string ttmOutputFileName;
+    JsonFunctions::getJsonString(previousEntry["ttm_output"],
+                                 ttmOutputFileName);
+    std::error_code errorCode;
+    if(ttmOutputFileName.length()>0 
+      && !std::filesystem::exists(ttmAnalyseFolder+ttmOutputFileName,
+                                  errorCode)){
+      return false;
+    }
+  }
 
-    TCLAP::SwitchArg quarterlyTTMAnalysisInput("q","trailing_twelve_months",
-      "Analyze trailing twelve moneths using quarterly data.", false);
-    cmd.add(quarterlyTTMAnalysisInput); 
+  nlohmann::ordered_json inputs = nlohmann::ordered_json::array();
+  for(auto const &previousRecord : previousEntry["inputs"]){
+    nlohmann::ordered_json inputRecord;
+    if(!isInputFileUnchanged(previousRecord,inputRecord)){
+      return false;
+    }
+    inputs.push_back(inputRecord);
+  }
+  entryUpd["inputs"] = inputs;
+  return true;
+};
 
-    TCLAP::ValueArg<std::string> analyseFolderOutput("o","output_folder_path", 
-      "The path to the folder that will contain the output json files "
-      "produced by these calculations",
-      true,"","string");
-    cmd.add(analyseFolderOutput);
+//============================================================================
+// In incremental mode a state file is kept for each output file. It records
+//
+//  - a hash of everything that every date of metric_data depends on: the
+//    quantities that are evaluated using all of the data (beta, tax rate,
+//    interest cover, financial ratios, dividend information) and the growth
+//    models that are fitted across the dates.
+//  - for each date, a hash of the inputs that only that date depends on:
+//    the financial statement entries of the date, of the previous period and
+//    of the trailing periods, the outstanding shares, the historical (price)
+//    data around the date, the bond yield, the equity risk premium and 
+//    inflation. A new report therefore only invalidates the dates whose 
+//    periods include it, unless it also changes one of the models.
+//  - the empirical growth models that were fitted, keyed by the data they 
+//    were fitted to.
+//
+// A date of metric_data is copied from the previous output file if neither
+// hash has changed, and a growth model is only fitted again if its data has
+// changed.
+//============================================================================
+const int INCREMENTAL_STATE_VERSION = 2;
+
+struct IncrementalState{
+  std::string contextHash;
+  nlohmann::ordered_json dates;
+  DataStructures::EmpiricalGrowthModelCache modelCache;
+  IncrementalState():
+    dates(nlohmann::ordered_json::object()){};
+};
 
+//============================================================================
+bool loadIncrementalState(const std::string &stateFilePath,
+                          IncrementalState &stateUpd){
+  stateUpd = IncrementalState();
 
-    TCLAP::SwitchArg verboseInput("v","verbose",
-      "Verbose output printed to screen", false);
-    cmd.add(verboseInput);    
+  std::error_code errorCode;
+  if(!std::filesystem::exists(stateFilePath,errorCode)){
+    return false;
+  }
 
-    cmd.parse(argc,argv);
+  nlohmann::ordered_json stateJson;
+  bool loaded = JsonFunctions::loadJsonFile(stateFilePath, stateJson, false);
+  if(!loaded || !stateJson.contains("context_hash") 
+             || !stateJson.contains("dates")
+             || !stateJson.contains("model_fits")){
+    return false;
+  }
 
-    fundamentalFolder     = fundamentalFolderInput.getValue();
-    historicalFolder      = historicalFolderInput.getValue();
-    forexFolder           = forexFolderInput.getValue();
-    configurationFile     = configurationFileInput.getValue();
+  JsonFunctions::getJsonString(stateJson["context_hash"],stateUpd.contextHash);
+  stateUpd.dates = stateJson["dates"];
+  NumericalFunctions::convertJsonToEmpiricalGrowthModelCache(
+      stateJson["model_fits"],stateUpd.modelCache);
+  return true;
+};
 
-    singleFileToEvaluate  = singleFileToEvaluateInput.getValue();
-    exchangeCode          = exchangeCodeInput.getValue();    
-    analyseFolder         = analyseFolderOutput.getValue();
-    quarterlyTTMAnalysis  = quarterlyTTMAnalysisInput.getValue();
-    nameOfHomeCountryISO3 = nameOfHomeCountryISO3Input.getValue(); 
+//============================================================================
+// The temporary file that filePath is written to before it is moved into 
+// place. Listings that share a primary write the same output file, from 
+// several threads of one process (told apart by tickerNumber) or from 
+// several shard processes at once (told apart by the process id).
+//============================================================================
+std::string getTemporaryFilePath(const std::string &filePath,
+                                 int tickerNumber){
+  std::string temporaryFilePath(filePath);
+  temporaryFilePath.append(".tmp");
+  temporaryFilePath.append(std::to_string(getpid()));
+  temporaryFilePath.append("_");
+  temporaryFilePath.append(std::to_string(tickerNumber));
+  return temporaryFilePath;
+};
 
-    relaxedCalculation    = relaxedCalculationInput.getValue() ;
-    verbose               = verboseInput.getValue();
+//============================================================================
+void writeIncrementalState(const std::string &stateFilePath,
+                           int tickerNumber,
+                           const IncrementalState &state){
+
+  nlohmann::ordered_json stateJson;
+  stateJson["context_hash"] = state.contextHash;
+  stateJson["dates"]        = state.dates;
+  NumericalFunctions::convertEmpiricalGrowthModelCacheToJson(
+      state.modelCache,stateJson["model_fits"]);
+
+  std::string temporaryFilePath = 
+    getTemporaryFilePath(stateFilePath,tickerNumber);
+
+  std::ofstream stateFileStream(temporaryFilePath,
+      std::ios_base::trunc | std::ios_base::out);
+  stateFileStream << stateJson;
+  stateFileStream.close();
+  std::filesystem::rename(temporaryFilePath, stateFilePath);
+};
 
-    if(quarterlyTTMAnalysis){
-      timePeriod          = Q;
-    }else{
-      timePeriod          = Y;
-    }   
-    
-    cc.load(configurationFile);
+//============================================================================
+uint64_t appendEmpiricalGrowthModelToHash(
+            uint64_t hash,
+            const DataStructures::EmpiricalGrowthModel &model){
+
+  hash = HashFunctions::appendToHash(hash, 
+            static_cast<double>(model.modelType));
+  hash = HashFunctions::appendToHash(hash, model.duration);
+  hash = HashFunctions::appendToHash(hash, model.annualGrowthRateOfTrendline);
+  hash = HashFunctions::appendToHash(hash, model.r2);
+  hash = HashFunctions::appendToHash(hash, model.r2Trendline);
+  hash = HashFunctions::appendToHash(hash, model.r2Cyclic);
+  hash = HashFunctions::appendToHash(hash, 
+            static_cast<double>(model.validFitting));
+  hash = HashFunctions::appendToHash(hash, 
+            static_cast<double>(model.outlierCount));
+  hash = HashFunctions::appendToHash(hash, model.parameters);
+  hash = HashFunctions::appendToHash(hash, model.x);
+  hash = HashFunctions::appendToHash(hash, model.y);
+  hash = HashFunctions::appendToHash(hash, model.yCyclicNormDataPercentiles);
+  return hash;
+};
 
+//============================================================================
+uint64_t appendMetricGrowthDataSetToHash(
+            uint64_t hash,
+            const DataStructures::MetricGrowthDataSet &growthModel){
+
+  hash = HashFunctions::appendToHash(hash, growthModel.dates);
+  hash = HashFunctions::appendToHash(hash, growthModel.datesNumerical);
+  hash = HashFunctions::appendToHash(hash, growthModel.metricValue);
+  hash = HashFunctions::appendToHash(hash, growthModel.metricGrowthRate);
+  for(auto const &model : growthModel.model){
+    hash = appendEmpiricalGrowthModelToHash(hash, model);
+  }
+  return hash;
+};
 
-    if(verbose){
-      std::cout << "  Fundamental Data Folder" << std::endl;
-      std::cout << "    " << fundamentalFolder << std::endl;
+//============================================================================
+uint64_t appendEmpiricalGrowthDataSetToHash(
+            uint64_t hash,
+            const DataStructures::EmpiricalGrowthDataSet &growthData){
+
+  hash = HashFunctions::appendToHash(hash, growthData.dates);
+  hash = HashFunctions::appendToHash(hash, growthData.datesNumerical);
+  hash = HashFunctions::appendToHash(hash, 
+            growthData.afterTaxOperatingIncomeGrowth);
+  hash = HashFunctions::appendToHash(hash, growthData.reinvestmentRate);
+  hash = HashFunctions::appendToHash(hash, growthData.reinvestmentRateSD);
+  hash = HashFunctions::appendToHash(hash, growthData.returnOnCapitalDeployed);
+  hash = HashFunctions::appendToHash(hash, 
+            growthData.returnOnCapitalDeployedSD);
+  hash = HashFunctions::appendToHash(hash, growthData.organicGrowth);
+  for(auto const &model : growthData.afterTaxOperatingIncomeModel){
+    hash = appendEmpiricalGrowthModelToHash(hash, model);
+  }
+  for(auto const &model : growthData.reinvestmentRateModel){
+    hash = appendEmpiricalGrowthModelToHash(hash, model);
+  }
+  for(auto const &model : growthData.returnOnCapitalDeployedModel){
+    hash = appendEmpiricalGrowthModelToHash(hash, model);
+  }
+  return hash;
+};
 
-      std::cout << "  Historical Data Folder" << std::endl;
-      std::cout << "    " << historicalFolder << std::endl;
-      
-      std::cout << "  Configuration File" << std::endl;
-      std::cout << "    " << configurationFile << std::endl;
+//============================================================================
+uint64_t appendEmpiricalRelationModelToHash(
+            uint64_t hash,
+            const DataStructures::EmpiricalRelationModel &relationModel){
+
+  hash = HashFunctions::appendToHash(hash, relationModel.date);
+  hash = HashFunctions::appendToHash(hash, relationModel.dateModel);
+  hash = HashFunctions::appendToHash(hash, relationModel.x);
+  hash = HashFunctions::appendToHash(hash, relationModel.y);
+  hash = HashFunctions::appendToHash(hash, 
+            static_cast<double>(relationModel.interval));
+  for(auto const &model : relationModel.model){
+    hash = appendEmpiricalGrowthModelToHash(hash, model);
+  }
+  return hash;
+};
 
-      std::cout << "  Exchange Code" << std::endl;
-      std::cout << "    " << exchangeCode << std::endl;
+//============================================================================
+// The hash of the inputs that every date depends on. The financial 
+// statements themselves are not included: each date hashes the entries that
+// it reads (calcDateHash), and the models that are fitted to the statements
+// of every date are included here instead.
+//============================================================================
+std::string calcTickerContextHash(
+    const std::string &calculationHash,
+    const nlohmann::ordered_json &fundamentalData,
+    const std::string &countryISO2,
+    double betaUnlevered,
+    double meanTaxRate,
+    double meanInterestCover,
+    const DataStructures::FinancialRatios &financialRatios,
+    const DataStructures::DividendInfo &dividendInfo,
+    const std::vector< const DataStructures::MetricGrowthDataSet* > 
+      &growthModels,
+    const std::vector< const DataStructures::EmpiricalGrowthDataSet* > 
+      &empiricalGrowthData,
+    const std::vector< const DataStructures::EmpiricalRelationModel* > 
+      &relationModels){
+
+  uint64_t hash = HashFunctions::calcStableHash(calculationHash);
+  hash = HashFunctions::appendToHash(hash, 
+            static_cast<double>(INCREMENTAL_STATE_VERSION));
+
+  if(fundamentalData.contains(GEN) 
+      && fundamentalData[GEN].contains("CurrencyCode")){
+    hash = HashFunctions::appendToHash(hash,
+              fundamentalData[GEN]["CurrencyCode"].dump());
+  }
 
-      std::cout << "  Single file name to evaluate" << std::endl;
-      std::cout << "    " << singleFileToEvaluate << std::endl;
+  hash = HashFunctions::appendToHash(hash, countryISO2);
+  hash = HashFunctions::appendToHash(hash, betaUnlevered);
+  hash = HashFunctions::appendToHash(hash, meanTaxRate);
+  hash = HashFunctions::appendToHash(hash, meanInterestCover);
+
+  hash = HashFunctions::appendToHash(hash, financialRatios.dates);
+  hash = HashFunctions::appendToHash(hash, financialRatios.datesNumerical);
+  hash = HashFunctions::appendToHash(hash, financialRatios.adjustedClosePrice);
+  hash = HashFunctions::appendToHash(hash, financialRatios.outstandingShares);
+  hash = HashFunctions::appendToHash(hash, financialRatios.marketCapitalization);
+  hash = HashFunctions::appendToHash(hash, financialRatios.dividendYield);
+  hash = HashFunctions::appendToHash(hash, financialRatios.eps);
+  hash = HashFunctions::appendToHash(hash, financialRatios.pe);
+  hash = HashFunctions::appendToHash(hash, financialRatios.epsGaap);
+  hash = HashFunctions::appendToHash(hash, financialRatios.peGaap);
+  hash = HashFunctions::appendToHash(hash, financialRatios.operationalLeverage);
+  hash = HashFunctions::appendToHash(hash, financialRatios.freeCashFlowLeverage);
+  hash = HashFunctions::appendToHash(hash, financialRatios.earningsLeverage);
+
+  hash = HashFunctions::appendToHash(hash, dividendInfo.dates);
+  hash = HashFunctions::appendToHash(hash, dividendInfo.datesNumerical);
+  hash = HashFunctions::appendToHash(hash, dividendInfo.dividendsPaid);
+  hash = HashFunctions::appendToHash(hash, dividendInfo.stockPrice);
+  hash = HashFunctions::appendToHash(hash, dividendInfo.dividendYield);
+  hash = HashFunctions::appendToHash(hash, dividendInfo.dividendPayoutRatio);
+  hash = HashFunctions::appendToHash(hash, 
+            dividendInfo.dividendFreeCashFlowRatio);
+  hash = HashFunctions::appendToHash(hash, dividendInfo.freeCashFlowTrailing);
+  hash = HashFunctions::appendToHash(hash, dividendInfo.dividendsTrailing);
+  hash = HashFunctions::appendToHash(hash, 
+            dividendInfo.freeCashFlowLessDividendsTrailing);
+  hash = HashFunctions::appendToHash(hash, 
+            dividendInfo.freeCashFlowYieldTrailingAverage);
+  hash = HashFunctions::appendToHash(hash, 
+            dividendInfo.freeCashFlowLessDividendsYieldTrailingAverage);
+  hash = HashFunctions::appendToHash(hash, 
+            dividendInfo.dividendPayoutRatioTrailingAverage);
+  hash = HashFunctions::appendToHash(hash, 
+            dividendInfo.dividendFreeCashFlowRatioTrailingAverage);
+  hash = HashFunctions::appendToHash(hash, 
+            static_cast<double>(dividendInfo.yearsWithADividend));
+  hash = HashFunctions::appendToHash(hash, 
+            dividendInfo.fractionOfYearsWithDividendIncreases);
+  hash = HashFunctions::appendToHash(hash, 
+            dividendInfo.fractionOfYearsWithDividends);
+  hash = HashFunctions::appendToHash(hash, 
+            dividendInfo.fractionOfYearsWithCancelledDividends);
+  hash = HashFunctions::appendToHash(hash, 
+            dividendInfo.fractionOfYearsWithPositiveFreeCashFlowTrailing);
+  hash = HashFunctions::appendToHash(hash, 
+      dividendInfo.fractionOfYearsWithPositiveFreeCashFlowLessDividendsTrailing);
+  hash = HashFunctions::appendToHash(hash, dividendInfo.meanDividendYield);
+  hash = HashFunctions::appendToHash(hash, dividendInfo.meanFreeCashFlowYield);
+  hash = HashFunctions::appendToHash(hash, 
+            dividendInfo.meanFreeCashFlowLessDividendsYield);
+  hash = HashFunctions::appendToHash(hash, 
+            dividendInfo.meanDividendPayoutRatio);
+  hash = HashFunctions::appendToHash(hash, 
+            dividendInfo.meanDividendFreeCashFlowRatio);
+
+  for(auto const &growthModel : growthModels){
+    hash = appendMetricGrowthDataSetToHash(hash, *growthModel);
+  }
+  for(auto const &growthData : empiricalGrowthData){
+    hash = appendEmpiricalGrowthDataSetToHash(hash, *growthData);
+  }
+  for(auto const &relationModel : relationModels){
+    hash = appendEmpiricalRelationModelToHash(hash, *relationModel);
+  }
 
-      std::cout << "  Name of home country (ISO3)" << std::endl;
-      std::cout << "    " << nameOfHomeCountryISO3 << std::endl;
+  return HashFunctions::convertHashToString(hash);
+};
 
-      std::cout << "  Output Folder" << std::endl;
-      std::cout << "    " << analyseFolder << std::endl;
+//============================================================================
+uint64_t appendStatementEntriesToHash(
+            uint64_t hash,
+            const nlohmann::ordered_json &fundamentalData,
+            const char *timePeriod,
+            const DateFunctions::DateSetTTM &dateSet){
+
+  hash = HashFunctions::appendToHash(hash, 
+            static_cast<double>(dateSet.dates.size()));
+  for(size_t i=0; i<dateSet.dates.size(); ++i){
+    hash = HashFunctions::appendToHash(hash, dateSet.dates[i]);
+    hash = HashFunctions::appendToHash(hash, dateSet.weights[i]);
+  }
 
-      std::cout << "  Analyze TTM using Quarterly Data" << std::endl;
-      std::cout << "    " << quarterlyTTMAnalysis << std::endl;
+  if(!fundamentalData.contains(FIN)){
+    return hash;
+  }
+  for(auto const &section : fundamentalData[FIN].items()){
+    hash = HashFunctions::appendToHash(hash, section.key());
+    if(!section.value().contains(timePeriod)){
+      continue;
+    }
+    const nlohmann::ordered_json &entries = section.value()[timePeriod];
+    for(auto const &entryDate : dateSet.dates){
+      auto entry = entries.find(entryDate);
+      if(entry != entries.end()){
+        hash = HashFunctions::appendToHash(hash, entry->dump());
+      }else{
+        hash = HashFunctions::appendToHash(hash, "\n", 1);
+      }
+    }
+  }
+  return hash;
+};
 
-      std::cout << "  Verbose" << std::endl;
-      std::cout << "    " << verbose << std::endl;
+//============================================================================
+// The hash of the inputs that only this date depends on: the financial 
+// statement entries of its TTM period, of the previous period, and of the 
+// trailing periods, the outstanding shares, the market data, and the 
+// historical (price) data around the date.
+//============================================================================
+std::string calcDateHash(
+    const std::string &contextHash,
+    const std::string &date,
+    const nlohmann::ordered_json &fundamentalData,
+    const char *timePeriod,
+    const DateFunctions::DateSetTTM &dateSet,
+    const DateFunctions::DateSetTTM &previousDateSet,
+    const std::vector< DateFunctions::DateSetTTM > &trailingPastPeriods,
+    double outstandingShares,
+    double outstandingSharesPrevious,
+    double equityRiskPremium,
+    double inflation,
+    const std::string &bondYieldDate,
+    double bondYield,
+    const nlohmann::ordered_json &historicalData,
+    const std::vector< int > &historicalIndices){
+
+  uint64_t hash = HashFunctions::calcStableHash(contextHash);
+  hash = HashFunctions::appendToHash(hash, date);
+
+  hash = appendStatementEntriesToHash(hash,fundamentalData,timePeriod,dateSet);
+  hash = appendStatementEntriesToHash(hash,fundamentalData,timePeriod,
+                                      previousDateSet);
+  hash = HashFunctions::appendToHash(hash, 
+            static_cast<double>(trailingPastPeriods.size()));
+  for(auto const &pastDateSet : trailingPastPeriods){
+    hash = appendStatementEntriesToHash(hash,fundamentalData,timePeriod,
+                                        pastDateSet);
+  }
+  hash = HashFunctions::appendToHash(hash, outstandingShares);
+  hash = HashFunctions::appendToHash(hash, outstandingSharesPrevious);
+
+  hash = HashFunctions::appendToHash(hash, equityRiskPremium);
+  hash = HashFunctions::appendToHash(hash, inflation);
+  hash = HashFunctions::appendToHash(hash, bondYieldDate);
+  hash = HashFunctions::appendToHash(hash, bondYield);
+
+  //The historical data between the earliest and latest entry used, and one
+  //entry past the latest so that a change in the closest entry is detected
+  int indexFirst = static_cast<int>(historicalData.size());
+  int indexLast  = -1;
+  for(auto const &index : historicalIndices){
+    hash = HashFunctions::appendToHash(hash, static_cast<double>(index));
+    indexFirst = std::min(indexFirst, index);
+    indexLast  = std::max(indexLast, index);
+  }
+  indexFirst = std::max(indexFirst, 0);
+  indexLast  = std::min(indexLast+1, 
+                        static_cast<int>(historicalData.size())-1);
+  for(int i=indexFirst; i<=indexLast; ++i){
+    hash = HashFunctions::appendToHash(hash, historicalData[i].dump());
+  }
 
+  return HashFunctions::convertHashToString(hash);
+};
 
-      std::cout << "----------------------------------------" << std::endl;
-      std::cout << "  Configuration file contents" << std::endl;
-      std::cout << "----------------------------------------" << std::endl;
+//============================================================================
+// Evaluates a single ticker and writes the analysis to the output folder.
+// Returns true if the analysis was written. This function only reads the
+// settings and reference data, and so it can be called from several threads
+// at once.
+//
+// The paths of the files that were read, and the name of the output file,
+// are returned so that the inputs can be recorded in the calculation 
+// manifest.
+//
+// analysisUpd //Optional: nullptr to write the analysis to the output 
+//               folder, otherwise the analysis is returned here and nothing
+//               is written.
+//
+// inputCacheUpd //Optional: nullptr to load the inputs. Otherwise the inputs
+//                 are taken from the cache if it has been filled, and are 
+//                 loaded and stored in the cache if it has not.
+//============================================================================
+bool calculateTicker(const std::string &tickerFileName,
+                     int tickerNumber,
+                     const CalculateSettings &settings,
+                     const ReferenceDataSet &referenceData,
+                     std::vector< std::string > &inputFilePathsUpd,
+                     std::string &outputFileNameUpd,
+                     nlohmann::ordered_json *analysisUpd=nullptr,
+                     TickerInputCache *inputCacheUpd=nullptr){
+
+  inputFilePathsUpd.clear();
+  outputFileNameUpd.clear();
+
+  const std::string &fundamentalFolder  = settings.fundamentalFolder;
+  const std::string &historicalFolder   = settings.historicalFolder;
+  const std::string &analyseFolder      = settings.analyseFolder;
+  const std::string &validFileExtension = settings.validFileExtension;
+  std::string timePeriod(settings.timePeriod);
+  const DataStructures::CalculationConfiguration &cc = settings.cc;
+
+  bool quarterlyTTMAnalysis   = settings.quarterlyTTMAnalysis;
+  bool verbose                = settings.verbose;
+  bool setNansToMissingValue  = settings.setNansToMissingValue;
+  bool appendTermRecord       = settings.appendTermRecord;
+
+  int acceptableBackwardsYearErrorForTaxRate 
+    = settings.acceptableBackwardsYearErrorForTaxRate;
+  int maxDayErrorHistoricalData       = settings.maxDayErrorHistoricalData;
+  int maxDayErrorBondYieldData        = settings.maxDayErrorBondYieldData;
+  int maxDayErrorTTM                  = settings.maxDayErrorTTM;
+  int maxDayErrorOutstandingShareData = settings.maxDayErrorOutstandingShareData;
+
+  double maxProportionOfOutliersInExpModel 
+    = settings.maxProportionOfOutliersInExpModel;
+  double minPriceAllowedInPriceModel  = settings.minPriceAllowedInPriceModel;
+  double minCycleTimeInYears          = settings.minCycleTimeInYears;
+  double exponentialModelR2Preference = settings.exponentialModelR2Preference;
+  double maxDateErrorInYearsInEmpiricalData 
+    = settings.maxDateErrorInYearsInEmpiricalData;
+  const std::vector< double > &peMarketVariationUpperBound 
+    = settings.peMarketVariationUpperBound;
+
+  bool usingTaxTable = referenceData.tables.usingTaxTable;
+  const ReferenceDataFunctions::TaxRateTable &corpWorldTaxTable 
+    = referenceData.tables.taxRates;
+  const ReferenceDataFunctions::DefaultSpreadTable &defaultSpreads 
+    = referenceData.tables.defaultSpreads;
+  const ReferenceDataFunctions::BondYieldTable &bondYields 
+    = referenceData.tables.bondYields;
+  bool validRiskTable = referenceData.tables.validRiskTable;
+  const ReferenceDataFunctions::CountryRiskTable &countryRiskTable 
+    = referenceData.tables.countryRisk;
+  const ReferenceDataFunctions::CountryRiskDataSet &homeRiskTable 
+    = referenceData.homeRiskTable;
+  double defaultInflationRate = referenceData.defaultInflationRate;
+
+  //The families of metrics to evaluate. The core metrics are always 
+  //evaluated.
+  using MSF = MetricSelectionFunctions;
+  const MSF::MetricSelection &metrics = settings.metrics;
+  bool evaluateDcf          = MSF::isSelected(metrics,MSF::FAMILY_DCF);
+  bool evaluateAtoiGrowth   = MSF::isSelected(metrics,MSF::FAMILY_ATOI_GROWTH);
+  bool evaluateDcfEmpirical = MSF::isSelected(metrics,MSF::FAMILY_DCF_EMPIRICAL);
+  bool evaluatePriceModel   = MSF::isSelected(metrics,MSF::FAMILY_PRICE_MODEL);
+  bool evaluateEquityGrowth = MSF::isSelected(metrics,MSF::FAMILY_EQUITY_GROWTH);
+  bool evaluateEpsGrowth    = MSF::isSelected(metrics,MSF::FAMILY_EPS_GROWTH);
+  bool evaluateGrossProfitGrowth 
+    = MSF::isSelected(metrics,MSF::FAMILY_GROSS_PROFIT_GROWTH);
+  bool evaluateFcfGrowth    = MSF::isSelected(metrics,MSF::FAMILY_FCF_GROWTH);
+  bool evaluateRevenueGrowth= MSF::isSelected(metrics,MSF::FAMILY_REVENUE_GROWTH);
+  bool evaluateFinancialRatios 
+    = MSF::isSelected(metrics,MSF::FAMILY_FINANCIAL_RATIOS);
+  bool evaluateEpsValuation = MSF::isSelected(metrics,MSF::FAMILY_EPS_VALUATION);
+  bool evaluateFcfValuation = MSF::isSelected(metrics,MSF::FAMILY_FCF_VALUATION);
+  bool evaluateDividends    = MSF::isSelected(metrics,MSF::FAMILY_DIVIDENDS);
+  bool evaluateLiquidity    = MSF::isSelected(metrics,MSF::FAMILY_LIQUIDITY);
+  bool evaluateMonteCarlo   = MSF::isSelected(metrics,MSF::FAMILY_MONTE_CARLO);
+
+  DataStructures::TermRecord termRecord;
+
+  bool validInput = true;
+
+  //The time spent in each phase is recorded when profiling is enabled
+  ProfilingFunctions::PhaseTimer phaseTimer;
+  phaseTimer.next("load_fundamental_data");
 
-      std::cout << "  Default Spread Json File" << std::endl;
-      std::cout << "    " << cc.default_spread_json_file << std::endl;
+  //==========================================================================
+  //Load the (primary) fundamental ticker file
+  //==========================================================================
+  std::string fileName(tickerFileName);
+  size_t lastIndex = fileName.find_last_of(".");
+  std::string tickerName = fileName.substr(0,lastIndex);
+  std::size_t foundExtension = fileName.find(validFileExtension);
+
+  nlohmann::ordered_json fundamentalData;
+  nlohmann::ordered_json historicalData;
+
+  bool loadInputs = (inputCacheUpd == nullptr || !inputCacheUpd->loaded);
+
+  if(!loadInputs){
+    fileName          = inputCacheUpd->fileName;
+    tickerName        = inputCacheUpd->tickerName;
+    validInput        = inputCacheUpd->validInput;
+    fundamentalData   = std::move(inputCacheUpd->fundamentalData);
+    historicalData    = std::move(inputCacheUpd->historicalData);
+    inputFilePathsUpd = inputCacheUpd->inputFilePaths;
+    inputCacheUpd->loaded = false;
+
+  }else if( foundExtension != std::string::npos ){
+      std::string primaryTickerName("");
+      
+      FinancialAnalysisFunctions::getPrimaryTickerName(fundamentalFolder, 
+                                          fileName,
+                                          primaryTickerName);
+      inputFilePathsUpd.push_back(fundamentalFolder+fileName);
 
-      std::cout << "  Bond Yield Json File" << std::endl;
-      std::cout << "    " << cc.bond_yield_json_file << std::endl;
+      if(verbose){
+        std::cout << tickerNumber << "." << '\t' << fileName << std::endl;
+        if(primaryTickerName.compare(tickerName) != 0){
+          std::cout << "  " << '\t' << primaryTickerName 
+                    << " (PrimaryTicker) " << std::endl;
+        }
+      }
 
-      std::cout << "  Corporate tax rate file from https://taxfoundation.org"
-                << std:: endl;
-      std::cout << "    " << cc.world_corporate_tax_rate_csv_file << std::endl;
+      //Try to load the primary ticker
+      if(validInput && primaryTickerName.length()>0){
+        std::string primaryFileName = primaryTickerName;
+        primaryFileName.append(".json");
+        if(primaryFileName.compare(fileName) != 0){
+          inputFilePathsUpd.push_back(fundamentalFolder+primaryFileName);
+        }
+        validInput = JsonFunctions::loadJsonFile(primaryFileName, 
+                      fundamentalFolder, fundamentalData, verbose,
+                      &referenceData.fundamentalSections);
+        if(validInput){
+          fileName = primaryFileName;
+          tickerName = primaryTickerName;
+        }else{
+          std::cout << "    Skipping: could not load fundamental data" << std::endl;     
+        }                    
+      }
 
-      std::cout << "  Risk by country" << std::endl;
-      std::cout << "    " << cc.equity_risk_premium_by_country_json_file 
-                          << std::endl;
+      //If the primary ticker doesn't load (or exist) then use the file
+      //from the local exchange
+      if(!validInput || primaryTickerName.length()==0){
+        validInput = JsonFunctions::loadJsonFile(fileName, fundamentalFolder, 
+                                                fundamentalData, verbose,
+                                          &referenceData.fundamentalSections);
+        if(verbose){
+          if(validInput){
+            std::cout << "  Proceeding with "<< tickerName 
+                      << " : " << primaryTickerName 
+                      << " failed to load " << std::endl;
 
-      std::cout << "  Default interest cover value" << std::endl;
-      std::cout << "    " << cc.default_interest_cover << std::endl;
-      
-      std::cout << "  Default tax rate" << std::endl;
-      std::cout << "    " << cc.default_tax_rate << std::endl;
+          }else{
+            std::cout << "  Skipping: both " 
+                      << tickerName << " and " << primaryTickerName
+                      << " failed to load" << std::endl;
+          }
+        }
+        
+        if(!validInput){
+          std::cout << "    Skipping: could not load fundamental data" << std::endl;
+        }           
+      }
 
-      std::cout << "  Annual default risk free rate" << std::endl;
-      std::cout << "    " << cc.default_risk_free_rate << std::endl;
+  }else{
+    //Skip: this file doesn't have an extension
+    validInput = false;      
+  }
 
-      std::cout << "  Default beta value" << std::endl;
-      std::cout << "    " << cc.default_beta << std::endl;
+  //Extract the list of entry dates for the fundamental data
+  //std::vector< std::string > datesFundamental;
+  //std::vector< std::string > datesOutstandingShares;
+  std::string timePeriodOS(timePeriod);
+  if(timePeriodOS.compare(Y)==0){
+    timePeriodOS = A;
+  }
 
-      std::cout << "  Equity risk premium (U.S.A.)" << std::endl;
-      std::cout << "    " << cc.equity_risk_premium_usa << std::endl;
+  //Extract the countryName and ISO
+  std::string countryName;
+  std::string countryISO2;
+  std::string companyName("");
+  if(validInput){
+    JsonFunctions::getJsonString(fundamentalData[GEN]["CountryName"],
+                                 countryName);
+    JsonFunctions::getJsonString(fundamentalData[GEN]["CountryISO"],
+                                 countryISO2);
+    JsonFunctions::getJsonString(fundamentalData[GEN]["Name"],
+                                 companyName);  
+    
+    if(verbose){
+      std::cout << '\t' << companyName << std::endl;
+    }
 
-      std::cout << "  Assumed mature firm fraction of debt to capital" << std::endl;
-      std::cout << "    " << cc.mature_firm_fraction_debt_to_capital << std::endl;
+    //if(!fundamentalData[GEN].contains("IsDelisted")){
+    //  validInput=false;
+    //  if(verbose){
+    //    std::cout << "    Skipping: isDelisted field does not exist." << std::endl;
+    //  }
+    //}else{
+    if(fundamentalData[GEN].contains("IsDelisted")){
+      bool isDelisted = 
+        JsonFunctions::getJsonBool(fundamentalData[GEN]["IsDelisted"]);
+      if(isDelisted){
+        validInput = false;
+        if(verbose){
+          std::cout << "    Skipping: ticker has been delisted." << std::endl;
+        }
+      }
+    }                                  
+  }
 
-      std::cout << "  Number of years of growth in the DCM valuation " 
-                << std::endl;
-      std::cout << "    " << cc.number_of_years_of_growth 
-                << std::endl;
+  //==========================================================================
+  //Load the (primary) historical (price) file
+  //==========================================================================
+  phaseTimer.next("load_historical_data");
+  if(validInput && loadInputs){
+    inputFilePathsUpd.push_back(historicalFolder+fileName);
+    validInput=JsonFunctions::loadJsonFile(fileName, historicalFolder, 
+                                          historicalData, verbose);
+    if(!validInput){
+      std::cout << "    Skipping: could not load historical data" << std::endl;
+    }                                            
+  }
+  ProfilingFunctions::addCount("historical_price_entries",
+                               static_cast<double>(historicalData.size()));
 
-      std::cout << "  Number of years of data used to evaluate growth rates " 
-                << std::endl;
-      std::cout << "    " << cc.number_of_years_used_in_growth_rate_calculation 
-                << std::endl;
+  //==========================================================================
+  //Express the historical prices in the currency of the fundamental data
+  //==========================================================================
+  phaseTimer.next("forex_conversion");
+  if(validInput && loadInputs && referenceData.forexStore != nullptr){
+    ForexFunctions::PriceConversion priceConversion;
+    ForexFunctions::createPriceConversion(*referenceData.forexStore,
+                                          fundamentalData,
+                                          priceConversion);
+    if(!priceConversion.valid){
+      validInput = false;
+      std::cout << "    Skipping: no FOREX data to convert prices from "
+                << priceConversion.priceCurrency << " to "
+                << priceConversion.fundamentalCurrency << std::endl;
+    }else{
+      std::vector< std::string > forexFilePaths;
+      ForexFunctions::getForexFilePaths(priceConversion, forexFilePaths);
+      for(auto const &forexFilePath : forexFilePaths){
+        inputFilePathsUpd.push_back(forexFilePath);
+      }
+      ForexFunctions::applyPriceConversion(priceConversion, historicalData);
+    }
+  }
 
-      std::cout << "  TO DO: Update code to use  number_of_years_used_in"
-                   "_growth_rate_calculation" 
-                << std::endl;
+  //The analysis below modifies its copy of the inputs (e.g. missing fields 
+  //are added as nulls) and so the cache gets a copy of the inputs as they
+  //are before the analysis starts
+  if(loadInputs && inputCacheUpd != nullptr){
+    inputCacheUpd->loaded          = true;
+    inputCacheUpd->validInput      = validInput;
+    inputCacheUpd->fileName        = fileName;
+    inputCacheUpd->tickerName      = tickerName;
+    inputCacheUpd->fundamentalData = fundamentalData;
+    inputCacheUpd->historicalData  = historicalData;
+    inputCacheUpd->inputFilePaths  = inputFilePathsUpd;
+  }
 
+  phaseTimer.next("date_alignment");
+  std::vector< std::string > datesBondYields;
+  
+  DataStructures::AnalysisDates analysisDates;
+  bool allowRepeatedDates=false;
 
-      std::cout << "  Maximum number of days in error allowed for tabular " 
-                << "data of bond yields and historical stock prices " 
-                << std::endl;                
-      std::cout << "    " << cc.max_day_error 
-                << std::endl;    
+  if(validInput){   
 
-      std::cout << "  Using relaxed calculations?" << std::endl;
-      std::cout << relaxedCalculation << std::endl;
+    bool validDates= 
+      extractAnalysisDates(
+        analysisDates,
+        fundamentalData,
+        historicalData,
+        bondYields.dates,
+        timePeriod,
+        timePeriodOS,
+        maxDayErrorHistoricalData,
+        maxDayErrorOutstandingShareData,
+        maxDayErrorBondYieldData,
+        allowRepeatedDates);    
 
+    bool sufficientData=true;
+    if(analysisDates.durationInYears < cc.number_of_years_of_growth){
+      sufficientData=false;
     }
-  } catch (TCLAP::ArgException &e)  // catch exceptions
-	{ 
-    std::cerr << "error: "    << e.error() 
-              << " for arg "  << e.argId() << std::endl; 
-  }
+    int minNumberOfEntries = 
+      std::max(static_cast<int>(
+                std::round(cc.number_of_years_of_growth*0.5)),
+              3);
 
-  double dateToday = DateFunctions::getTodaysDate();
+    if(analysisDates.common.size() < minNumberOfEntries){
+      sufficientData=false;
+    }
 
-  int acceptableBackwardsYearErrorForTaxRate = 5;
-  //This defines how far back in time data from the tax table can be taken
-  //to approximate the tax of this year.
+    if(!sufficientData){
+      std::cout << "    Skipping: insufficient data. Only "
+                << analysisDates.durationInYears
+                << " years of data available available over "
+                << analysisDates.common.size()
+                << " entries."
+                << std::endl;
+    }
 
+    validInput = (validInput && validDates && sufficientData);
+    if(verbose && !validDates){
+      std::cout << "    Skipping: no valid dates" << std::endl;
+    }
+  }
 
-  int maxDayErrorHistoricalData = cc.max_day_error; 
-  // Historical data has a resolution of 1 day
-  
-  int maxDayErrorBondYieldData  = cc.max_day_error; 
-  // Bond yield data has a resolution of 1 month
+  //==========================================================================
+  //
+  // Process these files, if all of the inputs are valid
+  //
+  //==========================================================================
+  nlohmann::ordered_json analysis;
+  if(validInput){
+
+    std::vector< DateFunctions::DateSetTTM > trailingPastPeriods;
+    std::string previousTimePeriod("");
+    DateFunctions::DateSetTTM previousDateSet;
+    //std::vector< std::string > previousDateSet;
+    //std::vector< double > previousDateSetWeight;
+    unsigned int entryCount = 0;
+
+    //========================================================================
+    //Incremental mode: load the state of the previous run
+    //========================================================================
+    IncrementalState previousState;
+    IncrementalState currentState;
+    nlohmann::ordered_json previousMetricData;
+    bool reusePreviousRecords = false;
+    int numberOfReusedRecords = 0;
+
+    if(settings.incremental && settings.reusePreviousResults){
+      bool loaded = loadIncrementalState(settings.stateFolder+fileName,
+                                         previousState);
+      if(loaded){
+        currentState.modelCache.previousFits = 
+          previousState.modelCache.previousFits;
+      }
+    }
 
-  int maxDayErrorTTM = cc.max_day_error;
+    //========================================================================
+    //Calculate 
+    //  average tax rate
+    //  average interest cover    
+    //========================================================================
+    phaseTimer.next("tax_rate_and_interest_cover");
+    std::vector< std::string > tmpNames;
+    std::vector< double > tempValues;
 
-  int maxDayErrorOutstandingShareData = 365; 
 
-  //In extractEmpiricalAfterTaxOperatingIncomeGrowthRates an exponential growth model is fit to
-  //data. Such a model requires that the input data (after tax operating income
-  // in this case) must be greater than 1. Here a certain proportion of the
-  // data is allowed to be less than 1. These values are set to 1, so that
-  // the low values (approximately) still influence the fit.
-  //
-  // 4/4/2025 As the decision of which model to choose is based on the R2
-  //          between the model and the original data, it does not really
-  //          make sense to set an upper limit on maxProportionOfOutliersInExpModel
-  double maxProportionOfOutliersInExpModel = 1.0;
+    //This assumes that the beta is the same for all time. This is 
+    //obviously wrong, but I only have one data point for beta from EOD's
+    //data.      
+    //
+    double betaUnlevered = 
+      JsonFunctions::getJsonFloat(fundamentalData[TECH]["Beta"]);
+    if(std::isnan(betaUnlevered)){
+      betaUnlevered=cc.default_beta;
+    }
 
-  double minPriceAllowedInPriceModel=2.0;
+    //========================================================================
+    // Evaluate the average tax rate and interest cover
+    //========================================================================
+
+    double meanTaxRate = 0.;
+    if(usingTaxTable){        
+      meanTaxRate=
+      calcAverageTaxRate( analysisDates,
+                          countryISO2, 
+                          corpWorldTaxTable,
+                          cc.default_tax_rate,                            
+                          acceptableBackwardsYearErrorForTaxRate,
+                          quarterlyTTMAnalysis,
+                          cc.max_day_error);        
 
-  // When fitting cyclic models, the period of smallest allowable cycle is 
-  // defined by this term
-  double minCycleTimeInYears = 1.0;
+    }else{
+      meanTaxRate=cc.default_tax_rate;
+    }
 
-  // In order to accept a more complex cyclic model, it should provide at least
-  // this amount of improvement in R2
-  double exponentialModelR2Preference=0.25;
 
-  //This date error is over 1 year to accomodate for firms that only
-  //report financial data on an annual basis
-  double maxDateErrorInYearsInEmpiricalData = 1.5;
+    double meanInterestCover = 
+      calcAverageInterestCover(  
+        analysisDates,
+        fundamentalData,
+        cc.default_interest_cover,
+        defaultSpreads,
+        timePeriod,
+        quarterlyTTMAnalysis,
+        maxDayErrorTTM,
+        setNansToMissingValue,
+        appendTermRecord);
 
-  std::vector< double > peMarketVariationUpperBound(3);
-  peMarketVariationUpperBound[0]=10;
-  peMarketVariationUpperBound[1]=15;
-  peMarketVariationUpperBound[2]=30;
 
-  //2024/8/4 
-  //  Note: some fields used in the functions in the FinanacialToolkit
-  //  will replace nan's with a coded MISSING_NUMBER. Why?
-  //  Some reports are getting trashed by nans in fields that should 
-  //  actually be nan. For example, META is not a business that has inventory
-  //  and so this is not reported. Naturally when inventory doesn't
-  //  appear, or is set to nan, it then turns the results of all
-  //  analysis done using this term to nan. And this, unfortunately,
-  //  later means that these securities are ignored in later analysis.
+    //========================================================================
+    // Evaluate the last valid index
+    //========================================================================
 
-  bool setNansToMissingValue                  = relaxedCalculation;
+    int indexLastCommonDate = 
+      calcLastValidDateIndex(
+          analysisDates,
+          quarterlyTTMAnalysis,
+          maxDayErrorTTM);
+
+      //======================================================================
+      //Evaluate the equity risk premium for this country.
+      //======================================================================
+      ReferenceDataFunctions::CountryRiskDataSet riskTable;        
+      bool riskTableFound=false;
+
+      double equityRiskPremium=cc.equity_risk_premium_usa;
+      double inflation = defaultInflationRate;
+
+      if(validRiskTable){
+        const ReferenceDataFunctions::CountryRiskDataSet *countryRisk = 
+          ReferenceDataFunctions::findCountryByISO2(countryRiskTable,
+                                                    countryISO2);
+        if(countryRisk != nullptr){
+          riskTable = *countryRisk;
+          riskTableFound=true;
+        }
+      }
 
+    //=======================================================================
+    //  Extract empirical growth rates from the time series of
+    //  after tax operating income
+    //======================================================================= 
+    phaseTimer.next("growth_models");
+    int indexDate = -1;
 
-  //When this is true all intermediate values of a calculation are saved
-  //and written to file to permit manual inspection.  
-  bool appendTermRecord                       = true;
-  std::vector< std::string >  termNames;
-  std::vector< double >       termValues;  
+    std::vector< double > taxRateRecord;
 
-  std::vector< std::string > vectorNames;
-  std::vector< std::vector< double > > vectorValues;
+    while( evaluateAtoiGrowth && (indexDate+1) < indexLastCommonDate ){
+        ++indexDate;
 
-  bool loadSingleTicker=false;
-  if(singleFileToEvaluate.size() > 0){
-    loadSingleTicker = true;
-  }
+      double taxRate = 
+        getTaxRate( analysisDates.common[indexDate],
+                    riskTable,
+                    countryISO2,
+                    corpWorldTaxTable,
+                    meanTaxRate,
+                    cc.default_tax_rate,
+                    acceptableBackwardsYearErrorForTaxRate,
+                    usingTaxTable,
+                    riskTableFound);
+
+      taxRateRecord.push_back(taxRate);                      
+    }
 
-  std::string validFileExtension = exchangeCode;
-  validFileExtension.append(".json");
 
-  auto startingDirectory = std::filesystem::current_path();
-  std::filesystem::current_path(fundamentalFolder);
+    //Evaluate the growth rate using all of the data available
+    DataStructures::EmpiricalGrowthDataSet empiricalGrowthDataAll;
 
-  unsigned int count=0;
+    double growthIntervalInYears = 
+      static_cast<double>(cc.number_of_years_of_growth);
 
-  //============================================================================
-  // Load the curency unit table
-  //============================================================================
-  bool validConfigCurrencyUnitsFile 
-        = JsonFunctions::loadJsonFile(cc.currency_units_json_file,
-                                      currencyUnits, verbose);                                                    
-  
-  if(!validConfigCurrencyUnitsFile){
-    std::cerr << "Error: could not load the configration file " 
-              <<  configurationFile << std::endl;
-    std::abort();
-  }  
-  
-  //============================================================================
-  // Load the corporate tax rate table
-  //============================================================================
-  bool usingTaxTable=false;
-  TaxFoundationDataSet corpWorldTaxTable;
-  if(cc.world_corporate_tax_rate_csv_file.length() > 0){
-    usingTaxTable=true;
-    bool validFormat = 
-      loadTaxFoundationDataSet(cc.world_corporate_tax_rate_csv_file,
-                               corpWorldTaxTable);
-
-    if(!validFormat){
-      usingTaxTable=false;
-      std::cout << "Warning: could not load the world corporate tax rate file "
-                << cc.world_corporate_tax_rate_csv_file << std::endl;
-      std::cout << "Reverting to the default rate " << std::endl;
+    double totalNumberOfYearsInDataSet = 
+      DateFunctions::convertToFractionalYear(analysisDates.common.front())
+    - DateFunctions::convertToFractionalYear(analysisDates.common.back());
+          
+    double growthIntervalInYearsAll = 
+      std::max(totalNumberOfYearsInDataSet-growthIntervalInYears,
+               2.0*growthIntervalInYears);
+
+
+    DataStructures::EmpiricalGrowthSettings atoiGrowthMdlSettings;
+
+
+    atoiGrowthMdlSettings.maxDateErrorInDays = maxDayErrorTTM;
+    atoiGrowthMdlSettings.growthIntervalInYears = totalNumberOfYearsInDataSet;
+    atoiGrowthMdlSettings.maxOutlierProportionInEmpiricalModel 
+      = maxProportionOfOutliersInExpModel;
+    atoiGrowthMdlSettings.minCycleDurationInYears = minCycleTimeInYears;
+    atoiGrowthMdlSettings.exponentialModelR2Preference 
+      = exponentialModelR2Preference;
+    atoiGrowthMdlSettings.calcOneGrowthRateForAllData=true;
+    atoiGrowthMdlSettings.typeOfEmpiricalModel= -1;
+    atoiGrowthMdlSettings.forceZeroSlopeOnLinearModel=false;
+    if(settings.incremental){
+      atoiGrowthMdlSettings.modelCache = &currentState.modelCache;
     }
-  }
-  //============================================================================
-  // Load the default spread array 
-  //============================================================================
-  using json = nlohmann::ordered_json;    
-
-  std::ifstream defaultSpreadFileStream(cc.default_spread_json_file.c_str());
-  json jsonDefaultSpread = 
-    nlohmann::ordered_json::parse(defaultSpreadFileStream);
-  //std::cout << jsonDefaultSpread.at(1).at(2);
-  if(verbose){
-    std::cout << std::endl;
-    std::cout << "default spread table" << std::endl;
-    std::cout << '\t'
-              << "Interest Coverage Interval" 
-              << '\t'
-              << '\t' 
-              << "default spread" << std::endl;
-    for(auto &row: jsonDefaultSpread["US"]["default_spread"].items()){
-      for(auto &ele: row.value()){
-        std::cout << '\t' << ele << '\t';
-      }
-      std::cout << std::endl;
-    }
-  }
-
-  //============================================================================
-  // Load the 10 year bond yield table 
-  // Note: 1. Right now I only have historical data for the US, and so I'm
-  //          approximating the bond yield of all countries using US data.
-  //          This is probably approximately correct for wealthy developed
-  //          countries that have access to international markets, but is 
-  //          terrible for countries outside of this group.
-  //       
-  //============================================================================
-  using json = nlohmann::ordered_json;    
-
-  std::ifstream bondYieldFileStream(cc.bond_yield_json_file.c_str());
-  json jsonBondYield = nlohmann::ordered_json::parse(bondYieldFileStream);
-
-  if(verbose){
-    std::size_t numberOfEntries = jsonBondYield["US"]["10y_bond_yield"].size();
-    std::string startKey = jsonBondYield["US"]["10y_bond_yield"].begin().key();
-    std::string endKey = (--jsonBondYield["US"]["10y_bond_yield"].end()).key();
-    std::cout << std::endl;
-    std::cout << "bond yield table with " 
-              << numberOfEntries
-              << " entries from "
-              << startKey
-              << " to "
-              << endKey
-              << std::endl;
-    std::cout << "  Warning**" << std::endl; 
-    std::cout << "    The 10 year bond yields from the US are being used to " 
-              << std::endl;          
-    std::cout << "    approximate the bond yields for countries that do not"
-              << std::endl; 
-    std::cout << "    appear in Prof. Damodaran's country risk tables."
-              << std::endl;               
-    std::cout << "    This will not make sense for a business in a country"
-              << std::endl; 
-    std::cout << "    with a risk free rate that differs substantially from"    
-              << std::endl; 
-    std::cout << "    the US."    
-              << std::endl; 
-    std::cout << std::endl;
-  }
-
-  //==========================================================================
-  //Load the equity risk premium by country table
-  //==========================================================================
-  nlohmann::ordered_json riskByCountryData;
-
-  bool validRiskTable = JsonFunctions::loadJsonFile( 
-                                cc.equity_risk_premium_by_country_json_file, 
-                                riskByCountryData, 
-                                verbose);
-
-  if(validRiskTable && verbose){
-    std::cout << std::endl;
-    std::cout << "Loaded the equity-risk-premium by country table: "
-              << std::endl;
-  }                                
-  
-  if(!validRiskTable && verbose){
-    std::cout << std::endl;
-    std::cout << "Error: failed to load the equity-risk-premium by country table:"
-              << cc.equity_risk_premium_by_country_json_file
-              << std::endl;
-  }                                
-
-  //
-  // Get the risk table entry for the home country
-  //
-  
-  double defaultInflationRate = 0.;
-  CountryRiskDataSet homeRiskTable;
-  bool homeRiskTableFound=false;
-
-  if(validRiskTable){
-    for(auto &riskEntry : riskByCountryData["data"]){
-      std::string erpCountryISO3;
-      JsonFunctions::getJsonString(riskEntry["CountryISO3"],
-                                      erpCountryISO3);    
-      if(nameOfHomeCountryISO3.compare(erpCountryISO3)==0){
-          homeRiskTable.CountryISO3=erpCountryISO3;
-
-          JsonFunctions::getJsonString(riskEntry["CountryISO2"],
-                                      homeRiskTable.CountryISO2);
-
-          JsonFunctions::getJsonString(riskEntry["Country"],
-                                      homeRiskTable.Country);
-
-          homeRiskTable.PRS  
-                = JsonFunctions::getJsonFloat(
-                    riskEntry["PRS"]);
-
-          homeRiskTable.defaultSpread 
-                = JsonFunctions::getJsonFloat(
-                    riskEntry["defaultSpread"])*0.01;
-
-          homeRiskTable.ERP 
-                = JsonFunctions::getJsonFloat(
-                    riskEntry["ERP"])*0.01;
-
-          homeRiskTable.taxRate 
-                = JsonFunctions::getJsonFloat(
-                    riskEntry["taxRate"])*0.01;
-
-          homeRiskTable.CRP 
-                = JsonFunctions::getJsonFloat(
-                    riskEntry["CRP"])*0.01;
-
-          homeRiskTable.inflation_2019_2023 
-                = JsonFunctions::getJsonFloat(
-                    riskEntry["inflation_2019_2023"])*0.01;                   
-          homeRiskTable.inflation_2024_2028 
-          
-                = JsonFunctions::getJsonFloat(
-                    riskEntry["inflation_2024_2028"])*0.01;
-
-          homeRiskTable.riskFreeRate 
-                = JsonFunctions::getJsonFloat(
-                    riskEntry["riskFreeRate"])*0.01;                                                      
-          homeRiskTableFound=true;
-
-          break;
-      }                                        
-    }
-  }
-
-  if(homeRiskTableFound){
-    if(dateToday >= 2024){
-      defaultInflationRate = homeRiskTable.inflation_2024_2028;
-    }else{
-      defaultInflationRate = homeRiskTable.inflation_2019_2023;
-    }
-  }
-
-  //============================================================================
-  //
-  // Evaluate every file in the fundamental folder
-  //
-  //============================================================================  
-  int validFileCount=0;
-  for ( const auto & entry 
-          : std::filesystem::directory_iterator(fundamentalFolder)){
-
-
-    bool validInput = true;
-
-    //==========================================================================
-    //Load the (primary) fundamental ticker file
-    //==========================================================================
-    std::string fileName=entry.path().filename();
-
-    if(loadSingleTicker){
-      fileName  = singleFileToEvaluate;
-      size_t idx = singleFileToEvaluate.find(".json");
-      if(idx == std::string::npos){
-        fileName.append(".json");
-      }
-    }
-    size_t lastIndex = fileName.find_last_of(".");
-    std::string tickerName = fileName.substr(0,lastIndex);
-    std::size_t foundExtension = fileName.find(validFileExtension);
-
-    nlohmann::ordered_json fundamentalData;
-
-    if( foundExtension != std::string::npos ){
-        std::string primaryTickerName("");
-        
-        FinancialAnalysisFunctions::getPrimaryTickerName(fundamentalFolder, 
-                                            fileName,
-                                            primaryTickerName);
-
-        ++validFileCount;                                            
-        if(verbose){
-          std::cout << validFileCount << "." << '\t' << fileName << std::endl;
-          if(primaryTickerName.compare(tickerName) != 0){
-            std::cout << "  " << '\t' << primaryTickerName 
-                      << " (PrimaryTicker) " << std::endl;
-          }
-        }
-
-        //Try to load the primary ticker
-        if(validInput && primaryTickerName.length()>0){
-          std::string primaryFileName = primaryTickerName;
-          primaryFileName.append(".json");
-          validInput = JsonFunctions::loadJsonFile(primaryFileName, 
-                        fundamentalFolder, fundamentalData, verbose);
-          if(validInput){
-            fileName = primaryFileName;
-            tickerName = primaryTickerName;
-          }else{
-            std::cout << "    Skipping: could not load fundamental data" << std::endl;     
-          }                    
-        }
-
-        //If the primary ticker doesn't load (or exist) then use the file
-        //from the local exchange
-        if(!validInput || primaryTickerName.length()==0){
-          validInput = JsonFunctions::loadJsonFile(fileName, fundamentalFolder, 
-                                                  fundamentalData, verbose);
-          if(verbose){
-            if(validInput){
-              std::cout << "  Proceeding with "<< tickerName 
-                        << " : " << primaryTickerName 
-                        << " failed to load " << std::endl;
-
-            }else{
-              std::cout << "  Skipping: both " 
-                        << tickerName << " and " << primaryTickerName
-                        << " failed to load" << std::endl;
-            }
-          }
-          
-          if(!validInput){
-            std::cout << "    Skipping: could not load fundamental data" << std::endl;
-          }           
-        }
-
-    }else{
-      //Skip: this file doesn't have an extension
-      validInput = false;      
-    }
-
-    //Extract the list of entry dates for the fundamental data
-    //std::vector< std::string > datesFundamental;
-    //std::vector< std::string > datesOutstandingShares;
-    std::string timePeriodOS(timePeriod);
-    if(timePeriodOS.compare(Y)==0){
-      timePeriodOS = A;
-    }
-
-    //Extract the countryName and ISO
-    std::string countryName;
-    std::string countryISO2;
-    std::string companyName("");
-    if(validInput){
-      JsonFunctions::getJsonString(fundamentalData[GEN]["CountryName"],
-                                   countryName);
-      JsonFunctions::getJsonString(fundamentalData[GEN]["CountryISO"],
-                                   countryISO2);
-      JsonFunctions::getJsonString(fundamentalData[GEN]["Name"],
-                                   companyName);  
-      
-      if(verbose){
-        std::cout << '\t' << companyName << std::endl;
-      }
-
-      //if(!fundamentalData[GEN].contains("IsDelisted")){
-      //  validInput=false;
-      //  if(verbose){
-      //    std::cout << "    Skipping: isDelisted field does not exist." << std::endl;
-      //  }
-      //}else{
-      if(fundamentalData[GEN].contains("IsDelisted")){
-        bool isDelisted = 
-          JsonFunctions::getJsonBool(fundamentalData[GEN]["IsDelisted"]);
-        if(isDelisted){
-          validInput = false;
-          if(verbose){
-            std::cout << "    Skipping: ticker has been delisted." << std::endl;
-          }
-        }
-      }                                  
-    }
-
-    //==========================================================================
-    //Load the (primary) historical (price) file
-    //==========================================================================
-    nlohmann::ordered_json historicalData;
-    if(validInput){
-      validInput=JsonFunctions::loadJsonFile(fileName, historicalFolder, 
-                                            historicalData, verbose);
-      if(!validInput){
-        std::cout << "    Skipping: could not load historical data" << std::endl;
-      }                                            
-    }
-
-    std::vector< std::string > datesBondYields;
-    
-    DataStructures::AnalysisDates analysisDates;
-    bool allowRepeatedDates=false;
-
-    if(validInput){   
-
-      bool validDates= 
-        extractAnalysisDates(
-          analysisDates,
-          fundamentalData,
-          historicalData,
-          jsonBondYield["US"]["10y_bond_yield"],
-          timePeriod,
-          timePeriodOS,
-          maxDayErrorHistoricalData,
-          maxDayErrorOutstandingShareData,
-          maxDayErrorBondYieldData,
-          allowRepeatedDates);    
-
-      bool sufficientData=true;
-      if(analysisDates.durationInYears < cc.number_of_years_of_growth){
-        sufficientData=false;
-      }
-      int minNumberOfEntries = 
-        std::max(static_cast<int>(
-                  std::round(cc.number_of_years_of_growth*0.5)),
-                3);
-
-      if(analysisDates.common.size() < minNumberOfEntries){
-        sufficientData=false;
-      }
-
-      if(!sufficientData){
-        std::cout << "    Skipping: insufficient data. Only "
-                  << analysisDates.durationInYears
-                  << " years of data available available over "
-                  << analysisDates.common.size()
-                  << " entries."
-                  << std::endl;
-      }
-
-      validInput = (validInput && validDates && sufficientData);
-      if(verbose && !validDates){
-        std::cout << "    Skipping: no valid dates" << std::endl;
-      }
-    }
-
-    //==========================================================================
-    //
-    // Process these files, if all of the inputs are valid
-    //
-    //==========================================================================
-    nlohmann::ordered_json analysis;
-    if(validInput){
-
-      std::vector< DateFunctions::DateSetTTM > trailingPastPeriods;
-      std::string previousTimePeriod("");
-      DateFunctions::DateSetTTM previousDateSet;
-      //std::vector< std::string > previousDateSet;
-      //std::vector< double > previousDateSetWeight;
-      unsigned int entryCount = 0;
-
-      //========================================================================
-      //Calculate 
-      //  average tax rate
-      //  average interest cover    
-      //========================================================================
-      std::vector< std::string > tmpNames;
-      std::vector< double > tempValues;
-
-
-      //This assumes that the beta is the same for all time. This is 
-      //obviously wrong, but I only have one data point for beta from EOD's
-      //data.      
-      //
-      double betaUnlevered = 
-        JsonFunctions::getJsonFloat(fundamentalData[TECH]["Beta"]);
-      if(std::isnan(betaUnlevered)){
-        betaUnlevered=cc.default_beta;
-      }
-
-      //========================================================================
-      // Evaluate the average tax rate and interest cover
-      //========================================================================
-
-      double meanTaxRate = 0.;
-      if(usingTaxTable){        
-        meanTaxRate=
-        calcAverageTaxRate( analysisDates,
-                            countryISO2, 
-                            corpWorldTaxTable,
-                            cc.default_tax_rate,                            
-                            acceptableBackwardsYearErrorForTaxRate,
-                            quarterlyTTMAnalysis,
-                            cc.max_day_error);        
-
-      }else{
-        meanTaxRate=cc.default_tax_rate;
-      }
-
-
-      double meanInterestCover = 
-        calcAverageInterestCover(  
-          analysisDates,
-          fundamentalData,
-          cc.default_interest_cover,
-          jsonDefaultSpread,
-          timePeriod,
-          quarterlyTTMAnalysis,
-          maxDayErrorTTM,
-          setNansToMissingValue,
-          appendTermRecord);
-
-
-      //========================================================================
-      // Evaluate the last valid index
-      //========================================================================
-
-      int indexLastCommonDate = 
-        calcLastValidDateIndex(
-            analysisDates,
-            quarterlyTTMAnalysis,
-            maxDayErrorTTM);
-
-        //======================================================================
-        //Evaluate the equity risk premium for this country.
-        //======================================================================
-        CountryRiskDataSet riskTable;        
-        bool riskTableFound=false;
-
-        double equityRiskPremium=cc.equity_risk_premium_usa;
-        double inflation = defaultInflationRate;
-
-        if(validRiskTable){
-          for(auto &riskEntry : riskByCountryData["data"]){
-            std::string erpCountryISO2;
-            JsonFunctions::getJsonString(riskEntry["CountryISO2"],erpCountryISO2);
-            if(countryISO2.compare(erpCountryISO2)==0){
-
-              riskTable.CountryISO2=erpCountryISO2;
-
-              JsonFunctions::getJsonString(riskEntry["CountryISO3"],
-                                          riskTable.CountryISO3);
-
-              JsonFunctions::getJsonString(riskEntry["Country"],
-                                          riskTable.Country);
-
-              riskTable.PRS  
-                    = JsonFunctions::getJsonFloat(
-                        riskEntry["PRS"]);
-
-              riskTable.defaultSpread 
-                    = JsonFunctions::getJsonFloat(
-                        riskEntry["defaultSpread"])*0.01;
-
-              riskTable.ERP 
-                    = JsonFunctions::getJsonFloat(
-                        riskEntry["ERP"])*0.01;
-
-              riskTable.taxRate 
-                    = JsonFunctions::getJsonFloat(
-                        riskEntry["taxRate"])*0.01;
-
-              riskTable.CRP 
-                    = JsonFunctions::getJsonFloat(
-                        riskEntry["CRP"])*0.01;
-
-              riskTable.inflation_2019_2023 
-                    = JsonFunctions::getJsonFloat(
-                        riskEntry["inflation_2019_2023"])*0.01;                   
-              riskTable.inflation_2024_2028 
-              
-                    = JsonFunctions::getJsonFloat(
-                        riskEntry["inflation_2024_2028"])*0.01;
-
-              riskTable.riskFreeRate 
-                    = JsonFunctions::getJsonFloat(
-                        riskEntry["riskFreeRate"])*0.01;                                                      
-              riskTableFound=true;
-
-              break;
-            }
-          }
-
-
-        }
-
-      //=======================================================================
-      //  Extract empirical growth rates from the time series of
-      //  after tax operating income
-      //======================================================================= 
-      int indexDate = -1;
-
-      std::vector< double > taxRateRecord;
-
-      while( (indexDate+1) < indexLastCommonDate ){
-          ++indexDate;
-
-        double taxRate = 
-          getTaxRate( analysisDates.common[indexDate],
-                      riskTable,
-                      countryISO2,
-                      corpWorldTaxTable,
-                      meanTaxRate,
-                      cc.default_tax_rate,
-                      acceptableBackwardsYearErrorForTaxRate,
-                      usingTaxTable,
-                      riskTableFound);
-
-        taxRateRecord.push_back(taxRate);                      
-      }
-
-
-      //Evaluate the growth rate using all of the data available
-      DataStructures::EmpiricalGrowthDataSet empiricalGrowthDataAll;
-
-      double growthIntervalInYears = 
-        static_cast<double>(cc.number_of_years_of_growth);
-
-      double totalNumberOfYearsInDataSet = 
-        DateFunctions::convertToFractionalYear(analysisDates.common.front())
-      - DateFunctions::convertToFractionalYear(analysisDates.common.back());
-            
-      double growthIntervalInYearsAll = 
-        std::max(totalNumberOfYearsInDataSet-growthIntervalInYears,
-                 2.0*growthIntervalInYears);
-
-
-      DataStructures::EmpiricalGrowthSettings atoiGrowthMdlSettings;
-
-
-      atoiGrowthMdlSettings.maxDateErrorInDays = maxDayErrorTTM;
-      atoiGrowthMdlSettings.growthIntervalInYears = totalNumberOfYearsInDataSet;
-      atoiGrowthMdlSettings.maxOutlierProportionInEmpiricalModel 
-        = maxProportionOfOutliersInExpModel;
-      atoiGrowthMdlSettings.minCycleDurationInYears = minCycleTimeInYears;
-      atoiGrowthMdlSettings.exponentialModelR2Preference 
-        = exponentialModelR2Preference;
-      atoiGrowthMdlSettings.calcOneGrowthRateForAllData=true;
-      atoiGrowthMdlSettings.typeOfEmpiricalModel= -1;
-      atoiGrowthMdlSettings.forceZeroSlopeOnLinearModel=false;
 
+    if(evaluateAtoiGrowth){
       NumericalFunctions::extractEmpiricalAfterTaxOperatingIncomeGrowthRates(
                                   empiricalGrowthDataAll,            
                                   fundamentalData,
@@ -2054,22 +2438,24 @@ int main (int argc, char* argv[]) {
                                   indexLastCommonDate,
                                   quarterlyTTMAnalysis,
                                   atoiGrowthMdlSettings);  
+    }
 
-      if(empiricalGrowthDataAll.afterTaxOperatingIncomeModel.size()>0){
-        if(empiricalGrowthDataAll.afterTaxOperatingIncomeModel[0].validFitting){
-          atoiGrowthMdlSettings.typeOfEmpiricalModel 
-            = empiricalGrowthDataAll.afterTaxOperatingIncomeModel[0].modelType;
-        }
+    if(empiricalGrowthDataAll.afterTaxOperatingIncomeModel.size()>0){
+      if(empiricalGrowthDataAll.afterTaxOperatingIncomeModel[0].validFitting){
+        atoiGrowthMdlSettings.typeOfEmpiricalModel 
+          = empiricalGrowthDataAll.afterTaxOperatingIncomeModel[0].modelType;
       }
-      //Evaluate the growth rate data over the same relatively short
-      //period of time that is used for the growth period during
-      //the valution (5 years)
-      DataStructures::EmpiricalGrowthDataSet empiricalGrowthData;
-      
+    }
+    //Evaluate the growth rate data over the same relatively short
+    //period of time that is used for the growth period during
+    //the valution (5 years)
+    DataStructures::EmpiricalGrowthDataSet empiricalGrowthData;
+    
 
-      atoiGrowthMdlSettings.growthIntervalInYears=growthIntervalInYears;
-      atoiGrowthMdlSettings.calcOneGrowthRateForAllData=false;
+    atoiGrowthMdlSettings.growthIntervalInYears=growthIntervalInYears;
+    atoiGrowthMdlSettings.calcOneGrowthRateForAllData=false;
 
+    if(evaluateAtoiGrowth){
       NumericalFunctions::extractEmpiricalAfterTaxOperatingIncomeGrowthRates(
                                   empiricalGrowthData,            
                                   fundamentalData,
@@ -2079,13 +2465,18 @@ int main (int argc, char* argv[]) {
                                   indexLastCommonDate,
                                   quarterlyTTMAnalysis,
                                   atoiGrowthMdlSettings);
+    }
 
-      //======================================================================= 
-      //
-      // Fit an empirical model to the price history
-      //
-      //=======================================================================
-      
+    //======================================================================= 
+    //
+    // Fit an empirical model to the price history
+    //
+    //=======================================================================
+    
+    DataStructures::EmpiricalGrowthModel priceModel;
+    nlohmann::ordered_json priceModelResamplingJson;
+
+    if(evaluatePriceModel){
       std::vector<double> datesHistorical;
       std::vector<double> priceHistorical;
 
@@ -2098,9 +2489,8 @@ int main (int argc, char* argv[]) {
         price = FinancialAnalysisFunctions::
                 getHistoricalDataInFundamentalUnit(
                   el["adjusted_close"],
-                  fundamentalData,
                   false);
-        
+      
         if(price > minPriceAllowedInPriceModel){      
           double dateNumerical = DateFunctions::convertToFractionalYear(dateStr);          
           datesHistorical.push_back(dateNumerical);
@@ -2110,116 +2500,135 @@ int main (int argc, char* argv[]) {
 
 
 
-      DataStructures::EmpiricalGrowthModel linearPriceModel;
-      DataStructures::EmpiricalGrowthModel exponentialPriceModel;
-      DataStructures::EmpiricalGrowthModel priceModel;
+      const ResamplingFunctions::ResamplingSettings &resampling 
+        = settings.priceModelResampling;
 
-      bool forceZeroSlope=false;
-      NumericalFunctions::fitLinearGrowthModel(
-          datesHistorical,priceHistorical,forceZeroSlope,linearPriceModel);
-
-      NumericalFunctions::fitCyclicalModelWithExponentialBaseline(
-                                datesHistorical, 
-                                priceHistorical,
-                                minCycleTimeInYears,
-                                maxProportionOfOutliersInExpModel,
-                                exponentialPriceModel);
-
-
-      if(exponentialPriceModel.validFitting && linearPriceModel.validFitting){
-       if(exponentialPriceModel.r2 > linearPriceModel.r2){
-          NumericalFunctions::fitCyclicalModelWithExponentialBaseline(
-                                datesHistorical, 
-                                priceHistorical,
-                                minCycleTimeInYears,
-                                maxProportionOfOutliersInExpModel,
-                                priceModel);        
-        }else{
-          NumericalFunctions::fitCyclicalModelWithLinearBaseline(
-                               datesHistorical,
-                               priceHistorical,
-                               minCycleTimeInYears,
-                               forceZeroSlope,
-                               priceModel);
-        }
+      if(resampling.method == ResamplingFunctions::RESAMPLE_NONE
+         && resampling.maximumNumberOfPoints < 1){
+        fitPriceModel(datesHistorical,
+                      priceHistorical,
+                      minCycleTimeInYears,
+                      maxProportionOfOutliersInExpModel,
+                      priceModel);
       }else{
-        if(exponentialPriceModel.validFitting){
-          NumericalFunctions::fitCyclicalModelWithExponentialBaseline(
-                                datesHistorical, 
-                                priceHistorical,
-                                minCycleTimeInYears,
-                                maxProportionOfOutliersInExpModel,
-                                priceModel);
-
-        }else if(linearPriceModel.validFitting){
-          NumericalFunctions::fitCyclicalModelWithLinearBaseline(
-                               datesHistorical,
-                               priceHistorical,
-                               minCycleTimeInYears,
-                               forceZeroSlope,
-                               priceModel);
+        std::vector< size_t > indicesResampled;
+        ResamplingFunctions::resample(datesHistorical,
+                                      priceHistorical,
+                                      resampling,
+                                      indicesResampled);
+
+        std::vector< double > datesResampled, priceResampled;
+        ResamplingFunctions::selectIndices(datesHistorical,
+                                           indicesResampled,
+                                           datesResampled);
+        ResamplingFunctions::selectIndices(priceHistorical,
+                                           indicesResampled,
+                                           priceResampled);
+        fitPriceModel(datesResampled,
+                      priceResampled,
+                      minCycleTimeInYears,
+                      maxProportionOfOutliersInExpModel,
+                      priceModel);
+
+        priceModelResamplingJson["method"] = 
+          ResamplingFunctions::getResamplingMethodName(resampling.method);
+        priceModelResamplingJson["maximum_number_of_points"] = 
+          resampling.maximumNumberOfPoints;
+        priceModelResamplingJson["number_of_points"] = 
+          datesHistorical.size();
+        priceModelResamplingJson["number_of_points_resampled"] = 
+          datesResampled.size();
+
+        if(cc.price_model_resampling_error_report){
+          DataStructures::EmpiricalGrowthModel priceModelFullResolution;
+          fitPriceModel(datesHistorical,
+                        priceHistorical,
+                        minCycleTimeInYears,
+                        maxProportionOfOutliersInExpModel,
+                        priceModelFullResolution);
+
+          double maximumRelativeError = std::nan("1");
+          priceModelResamplingJson["error"] = 
+            calcPriceModelResamplingErrorJson(priceModel,
+                                              priceModelFullResolution,
+                                              indicesResampled,
+                                              maximumRelativeError);
+
+          //NaN comparisons are false: a failed comparison is out of bounds
+          bool withinBound = (maximumRelativeError 
+                    <= cc.price_model_resampling_maximum_relative_error);
+          priceModelResamplingJson["within_bound"] = withinBound;
+          if(!withinBound){
+            priceModel = priceModelFullResolution;
+          }
+          priceModelResamplingJson["full_resolution_fit_used"] = !withinBound;
         }
       }
+    }
+
+    //=======================================================================
+    /*
+      Extract the growth rates for the Rule Number 1 investing Big 5 criteria
+      from Phil Town's book Rule #1: The simple strategy for successful 
+      investing 
       
-      //=======================================================================
-      /*
-        Extract the growth rates for the Rule Number 1 investing Big 5 criteria
-        from Phil Town's book Rule #1: The simple strategy for successful 
-        investing 
-        
-        1.* roic
-              I have a function for this and this is recorded. I do not need to
-              do anything
-        2.  equity
-             eod: Financials:Balance_Sheet:time:totalStockholderEquity
-        3.  earnings per share
-              Earnings:Annual:epsActual
-        4.  sales/gross profit
-              Income_Statement:grossProfit
-        5.  cash flow
-              Cash_Flow:time:freeCashFlow
-        
-        *Do not need to compute the growth rate of the roic
-      */
-      //=======================================================================
-      DataStructures::MetricGrowthDataSet equityGrowthModel, 
-                                              equityGrowthModelAvg;
-      //bool includeTimeUnitInAddress = true;
-      //calcOneGrowthRateForAllData = false;
-
-      DataStructures::EmpiricalGrowthSettings empGrowthSettings;
-      empGrowthSettings.maxDateErrorInDays            = maxDayErrorTTM;
-      empGrowthSettings.growthIntervalInYears         = growthIntervalInYears;
-      empGrowthSettings.maxOutlierProportionInEmpiricalModel
-                      = maxProportionOfOutliersInExpModel;
-      empGrowthSettings.minCycleDurationInYears       = minCycleTimeInYears;
-      empGrowthSettings.exponentialModelR2Preference 
-                      = exponentialModelR2Preference;
-      empGrowthSettings.calcOneGrowthRateForAllData   = false;        
-      empGrowthSettings.includeTimeUnitInAddress      = true;
-      empGrowthSettings.typeOfEmpiricalModel          = -1;
-      
-      DataStructures::DateSpan fundamentalDateSpan;
-     
-      extractOldestNewestReportedDates(fundamentalData,fundamentalDateSpan);
+      1.* roic
+            I have a function for this and this is recorded. I do not need to
+            do anything
+      2.  equity
+           eod: Financials:Balance_Sheet:time:totalStockholderEquity
+      3.  earnings per share
+            Earnings:Annual:epsActual
+      4.  sales/gross profit
+            Income_Statement:grossProfit
+      5.  cash flow
+            Cash_Flow:time:freeCashFlow
       
-      empGrowthSettings.newestValidDate = fundamentalDateSpan.newestDateNum;
-      empGrowthSettings.oldestValidDate = fundamentalDateSpan.oldestDateNum;
+      *Do not need to compute the growth rate of the roic
+    */
+    //=======================================================================
+    DataStructures::MetricGrowthDataSet equityGrowthModel, 
+                                            equityGrowthModelAvg;
+    //bool includeTimeUnitInAddress = true;
+    //calcOneGrowthRateForAllData = false;
+
+    DataStructures::EmpiricalGrowthSettings empGrowthSettings;
+    empGrowthSettings.maxDateErrorInDays            = maxDayErrorTTM;
+    empGrowthSettings.growthIntervalInYears         = growthIntervalInYears;
+    empGrowthSettings.maxOutlierProportionInEmpiricalModel
+                    = maxProportionOfOutliersInExpModel;
+    empGrowthSettings.minCycleDurationInYears       = minCycleTimeInYears;
+    empGrowthSettings.exponentialModelR2Preference 
+                    = exponentialModelR2Preference;
+    empGrowthSettings.calcOneGrowthRateForAllData   = false;        
+    empGrowthSettings.includeTimeUnitInAddress      = true;
+    empGrowthSettings.typeOfEmpiricalModel          = -1;
+    if(settings.incremental){
+      empGrowthSettings.modelCache = &currentState.modelCache;
+    }
+    
+    DataStructures::DateSpan fundamentalDateSpan;
+   
+    extractOldestNewestReportedDates(fundamentalData,fundamentalDateSpan);
+    
+    empGrowthSettings.newestValidDate = fundamentalDateSpan.newestDateNum;
+    empGrowthSettings.oldestValidDate = fundamentalDateSpan.oldestDateNum;
 
-      //I'm not fitting to all of the data any more, because I'm seeing this 
-      //common case 
-      //
-      //- One growth model nicely fits data from the first half of 
-      //  companies life
+    //I'm not fitting to all of the data any more, because I'm seeing this 
+    //common case 
+    //
+    //- One growth model nicely fits data from the first half of 
+    //  companies life
 
-      //- Another growth model nicely fits data from the second half of a 
-      //  companies life
-      //- No single model fits the entire span well.
-      //
-      // Given that I care more about most recent data, I'm revising the 
-      // average to be 2x longer than the growth interval in years 
-      // so 10 years with my current settings
+    //- Another growth model nicely fits data from the second half of a 
+    //  companies life
+    //- No single model fits the entire span well.
+    //
+    // Given that I care more about most recent data, I'm revising the 
+    // average to be 2x longer than the growth interval in years 
+    // so 10 years with my current settings
 
+    if(evaluateEquityGrowth){
       NumericalFunctions::extractFundamentalDataMetricGrowthRates(
         fundamentalData,
         FIN,
@@ -2228,10 +2637,12 @@ int main (int argc, char* argv[]) {
         "totalStockholderEquity",
         equityGrowthModel,
         empGrowthSettings);
+    }
 
-      empGrowthSettings.calcOneGrowthRateForAllData=true;
-      empGrowthSettings.growthIntervalInYears = growthIntervalInYearsAll;
+    empGrowthSettings.calcOneGrowthRateForAllData=true;
+    empGrowthSettings.growthIntervalInYears = growthIntervalInYearsAll;
 
+    if(evaluateEquityGrowth){
       NumericalFunctions::extractFundamentalDataMetricGrowthRates(
         fundamentalData,
         FIN,
@@ -2240,15 +2651,17 @@ int main (int argc, char* argv[]) {
         "totalStockholderEquity",
         equityGrowthModelAvg,
         empGrowthSettings);
+    }
 
 
-      DataStructures::MetricGrowthDataSet epsGrowthModel, 
-                                          epsGrowthModelAvg;
+    DataStructures::MetricGrowthDataSet epsGrowthModel, 
+                                        epsGrowthModelAvg;
 
-      empGrowthSettings.includeTimeUnitInAddress      = false;
-      empGrowthSettings.calcOneGrowthRateForAllData   = false;  
-      empGrowthSettings.growthIntervalInYears         = growthIntervalInYears;    
+    empGrowthSettings.includeTimeUnitInAddress      = false;
+    empGrowthSettings.calcOneGrowthRateForAllData   = false;  
+    empGrowthSettings.growthIntervalInYears         = growthIntervalInYears;    
 
+    if(evaluateEpsGrowth){
       NumericalFunctions::extractFundamentalDataMetricGrowthRates(
         fundamentalData,
         EARN,
@@ -2257,9 +2670,11 @@ int main (int argc, char* argv[]) {
         "epsActual",
         epsGrowthModel,
         empGrowthSettings);
+    }
 
-      empGrowthSettings.calcOneGrowthRateForAllData=true;      
-      empGrowthSettings.growthIntervalInYears      = growthIntervalInYearsAll;    
+    empGrowthSettings.calcOneGrowthRateForAllData=true;      
+    empGrowthSettings.growthIntervalInYears      = growthIntervalInYearsAll;    
+    if(evaluateEpsGrowth){
       NumericalFunctions::extractFundamentalDataMetricGrowthRates(
         fundamentalData,
         EARN,
@@ -2268,15 +2683,17 @@ int main (int argc, char* argv[]) {
         "epsActual",
         epsGrowthModelAvg,
         empGrowthSettings);
+    }
 
 
-      DataStructures::MetricGrowthDataSet grossProfitGrowthModel,
-                                              grossProfitGrowthModelAvg;
+    DataStructures::MetricGrowthDataSet grossProfitGrowthModel,
+                                            grossProfitGrowthModelAvg;
 
-      empGrowthSettings.includeTimeUnitInAddress=true;
-      empGrowthSettings.calcOneGrowthRateForAllData=false;      
-      empGrowthSettings.growthIntervalInYears         = growthIntervalInYears;    
+    empGrowthSettings.includeTimeUnitInAddress=true;
+    empGrowthSettings.calcOneGrowthRateForAllData=false;      
+    empGrowthSettings.growthIntervalInYears         = growthIntervalInYears;    
 
+    if(evaluateGrossProfitGrowth){
       NumericalFunctions::extractFundamentalDataMetricGrowthRates(
         fundamentalData,
         FIN,
@@ -2285,10 +2702,12 @@ int main (int argc, char* argv[]) {
         "grossProfit",
         grossProfitGrowthModel,
         empGrowthSettings);
+    }
 
-      empGrowthSettings.calcOneGrowthRateForAllData=true;      
-      empGrowthSettings.growthIntervalInYears        = growthIntervalInYearsAll;    
+    empGrowthSettings.calcOneGrowthRateForAllData=true;      
+    empGrowthSettings.growthIntervalInYears        = growthIntervalInYearsAll;    
 
+    if(evaluateGrossProfitGrowth){
       NumericalFunctions::extractFundamentalDataMetricGrowthRates(
         fundamentalData,
         FIN,
@@ -2297,14 +2716,16 @@ int main (int argc, char* argv[]) {
         "grossProfit",
         grossProfitGrowthModelAvg,
         empGrowthSettings);
+    }
 
-      DataStructures::MetricGrowthDataSet fcfGrowthModel, 
-                                              fcfGrowthModelAvg;
+    DataStructures::MetricGrowthDataSet fcfGrowthModel, 
+                                            fcfGrowthModelAvg;
 
-      empGrowthSettings.includeTimeUnitInAddress=true;
-      empGrowthSettings.calcOneGrowthRateForAllData=false;      
-      empGrowthSettings.growthIntervalInYears         = growthIntervalInYears;    
+    empGrowthSettings.includeTimeUnitInAddress=true;
+    empGrowthSettings.calcOneGrowthRateForAllData=false;      
+    empGrowthSettings.growthIntervalInYears         = growthIntervalInYears;    
 
+    if(evaluateFcfGrowth){
       NumericalFunctions::extractFundamentalDataMetricGrowthRates(
         fundamentalData,
         FIN,
@@ -2313,10 +2734,12 @@ int main (int argc, char* argv[]) {
         "freeCashFlow",
         fcfGrowthModel,
         empGrowthSettings);
+    }
 
-      empGrowthSettings.calcOneGrowthRateForAllData=true;    
-      empGrowthSettings.growthIntervalInYears      = growthIntervalInYearsAll;    
+    empGrowthSettings.calcOneGrowthRateForAllData=true;    
+    empGrowthSettings.growthIntervalInYears      = growthIntervalInYearsAll;    
 
+    if(evaluateFcfGrowth){
       NumericalFunctions::extractFundamentalDataMetricGrowthRates(
         fundamentalData,
         FIN,
@@ -2325,14 +2748,16 @@ int main (int argc, char* argv[]) {
         "freeCashFlow",
         fcfGrowthModelAvg,
         empGrowthSettings);
+    }
 
-      DataStructures::MetricGrowthDataSet revenueGrowthModel, 
-                                              revenueGrowthModelAvg;
+    DataStructures::MetricGrowthDataSet revenueGrowthModel, 
+                                            revenueGrowthModelAvg;
 
-      empGrowthSettings.includeTimeUnitInAddress=true;
-      empGrowthSettings.calcOneGrowthRateForAllData=false;      
-      empGrowthSettings.growthIntervalInYears         = growthIntervalInYears;    
+    empGrowthSettings.includeTimeUnitInAddress=true;
+    empGrowthSettings.calcOneGrowthRateForAllData=false;      
+    empGrowthSettings.growthIntervalInYears         = growthIntervalInYears;    
 
+    if(evaluateRevenueGrowth){
       NumericalFunctions::extractFundamentalDataMetricGrowthRates(
         fundamentalData,
         FIN,
@@ -2341,10 +2766,12 @@ int main (int argc, char* argv[]) {
         "totalRevenue",
         revenueGrowthModel,
         empGrowthSettings);
+    }
 
-      empGrowthSettings.calcOneGrowthRateForAllData=true;    
-      empGrowthSettings.growthIntervalInYears      = growthIntervalInYearsAll;    
+    empGrowthSettings.calcOneGrowthRateForAllData=true;    
+    empGrowthSettings.growthIntervalInYears      = growthIntervalInYearsAll;    
 
+    if(evaluateRevenueGrowth){
       NumericalFunctions::extractFundamentalDataMetricGrowthRates(
         fundamentalData,
         FIN,
@@ -2353,12 +2780,14 @@ int main (int argc, char* argv[]) {
         "totalRevenue",
         revenueGrowthModelAvg,
         empGrowthSettings);
+    }
 
-      //
-      //MarketCapitalizationSummaryData
-      //
-      DataStructures::FinancialRatios financialRatios;
-      
+    //
+    //MarketCapitalizationSummaryData
+    //
+    DataStructures::FinancialRatios financialRatios;
+    
+    if(evaluateFinancialRatios){
       NumericalFunctions::extractFinancialRatios(
                           fundamentalData,
                           historicalData,
@@ -2369,29 +2798,33 @@ int main (int argc, char* argv[]) {
                           maxDayErrorOutstandingShareData,
                           quarterlyTTMAnalysis,
                           financialRatios);
+    }
 
-      //
-      // Metrics related to William Priest's 
-      //  Free-cash-flow and Shareholder yield screener
-      //
+    //
+    // Metrics related to William Priest's 
+    //  Free-cash-flow and Shareholder yield screener
+    //
 
-      DataStructures::AnalysisDates analysisDatesYearly;
+    DataStructures::AnalysisDates analysisDatesYearly;
+    if(evaluateDividends || evaluateFcfValuation){
       bool validDates= 
         extractAnalysisDates(
           analysisDatesYearly,
           fundamentalData,
           historicalData,
-          jsonBondYield["US"]["10y_bond_yield"],
+          bondYields.dates,
           Y,
           A,
           maxDayErrorHistoricalData,
           maxDayErrorOutstandingShareData,
           maxDayErrorBondYieldData,
           allowRepeatedDates);  
+    }
 
-      DataStructures::DividendInfo dividendInfo;
-      int yearsToAverageFCFLessDividends=3;
+    DataStructures::DividendInfo dividendInfo;
+    int yearsToAverageFCFLessDividends=3;
 
+    if(evaluateDividends){
       NumericalFunctions::extractDividendInfo(
                             fundamentalData,
                             historicalData,
@@ -2400,45 +2833,53 @@ int main (int argc, char* argv[]) {
                             A,
                             yearsToAverageFCFLessDividends,
                             dividendInfo);
-      
-      //
-      // Dividends Yield Growth
-      //                            
-      DataStructures::MetricGrowthDataSet dividendsYieldGrowthModel, 
-                                        dividendsYieldGrowthModelAvg;
+    }else{
+      dividendInfo.clear();
+    }
+    
+    //
+    // Dividends Yield Growth
+    //                            
+    DataStructures::MetricGrowthDataSet dividendsYieldGrowthModel, 
+                                      dividendsYieldGrowthModelAvg;
 
-      empGrowthSettings.includeTimeUnitInAddress    = true;
-      empGrowthSettings.calcOneGrowthRateForAllData = false;      
-      empGrowthSettings.growthIntervalInYears       = growthIntervalInYears;    
+    empGrowthSettings.includeTimeUnitInAddress    = true;
+    empGrowthSettings.calcOneGrowthRateForAllData = false;      
+    empGrowthSettings.growthIntervalInYears       = growthIntervalInYears;    
 
+    if(evaluateDividends){
       NumericalFunctions::extractTimeSeriesGrowthRates(
                               dividendInfo.dates,
                               dividendInfo.datesNumerical,
                               dividendInfo.dividendYield,
                               dividendsYieldGrowthModel,
                               empGrowthSettings);
+    }
 
-      empGrowthSettings.calcOneGrowthRateForAllData=true;    
-      empGrowthSettings.growthIntervalInYears      = growthIntervalInYearsAll;                                 
+    empGrowthSettings.calcOneGrowthRateForAllData=true;    
+    empGrowthSettings.growthIntervalInYears      = growthIntervalInYearsAll;                                 
 
+    if(evaluateDividends){
       NumericalFunctions::extractTimeSeriesGrowthRates(
                               dividendInfo.dates,
                               dividendInfo.datesNumerical,
                               dividendInfo.dividendYield,
                               dividendsYieldGrowthModelAvg,
                               empGrowthSettings);
-      
+    }
+    
 
-      //
-      // Dividends Paid Growth
-      //                            
-      DataStructures::MetricGrowthDataSet dividendsPaidGrowthModel, 
-                                        dividendsPaidGrowthModelAvg;
+    //
+    // Dividends Paid Growth
+    //                            
+    DataStructures::MetricGrowthDataSet dividendsPaidGrowthModel, 
+                                      dividendsPaidGrowthModelAvg;
 
-      empGrowthSettings.includeTimeUnitInAddress=true;
-      empGrowthSettings.calcOneGrowthRateForAllData=false;      
-      empGrowthSettings.growthIntervalInYears         = growthIntervalInYears;    
+    empGrowthSettings.includeTimeUnitInAddress=true;
+    empGrowthSettings.calcOneGrowthRateForAllData=false;      
+    empGrowthSettings.growthIntervalInYears         = growthIntervalInYears;    
 
+    if(evaluateDividends){
       NumericalFunctions::extractFundamentalDataMetricGrowthRates(
         fundamentalData,
         FIN,
@@ -2447,10 +2888,12 @@ int main (int argc, char* argv[]) {
         "dividendsPaid",
         dividendsPaidGrowthModel,
         empGrowthSettings);
+    }
 
-      empGrowthSettings.calcOneGrowthRateForAllData=true;    
-      empGrowthSettings.growthIntervalInYears      = growthIntervalInYearsAll;    
+    empGrowthSettings.calcOneGrowthRateForAllData=true;    
+    empGrowthSettings.growthIntervalInYears      = growthIntervalInYearsAll;    
 
+    if(evaluateDividends){
       NumericalFunctions::extractFundamentalDataMetricGrowthRates(
         fundamentalData,
         FIN,
@@ -2459,13 +2902,16 @@ int main (int argc, char* argv[]) {
         "dividendsPaid",
         dividendsPaidGrowthModelAvg,
         empGrowthSettings);
+    }
 
-      //=======================================================================
-      // Fit models to revenue vs free cash flow
-      //=======================================================================
+    //=======================================================================
+    // Fit models to revenue vs free cash flow
+    //=======================================================================
 
 
-      DataStructures::EmpiricalRelationModel revenueFcfModel,revenueFcfModelAvg;
+    phaseTimer.next("revenue_fcf_models");
+    DataStructures::EmpiricalRelationModel revenueFcfModel,revenueFcfModelAvg;
+    if(evaluateFcfValuation){
       NumericalFunctions::fitRevenueToFreeCashFlowModels( 
                               fundamentalData, 
                               analysisDatesYearly,
@@ -2473,958 +2919,1027 @@ int main (int argc, char* argv[]) {
                               growthIntervalInYearsAll,
                               revenueFcfModel,
                               revenueFcfModelAvg);
+    }
 
 
-      //=======================================================================
-      //
-      // Create and set the first values in annualMilestones
-      //
-      //=======================================================================
-      
-      AnnualMilestoneDataSet annualMilestones;
-
-      std::string ipoDate;
-      JsonFunctions::getJsonString(
-          fundamentalData["General"]["IPODate"],ipoDate);
-
-      double ipoDateNumerical = 
-        DateFunctions::convertToFractionalYear(ipoDate);
-      double firstRecordDate = 
-        DateFunctions::convertToFractionalYear(analysisDates.common.front());
-      double lastRecordDate = 
-        DateFunctions::convertToFractionalYear(analysisDates.common.back());
-
-      double recentDate = 
-        (firstRecordDate > lastRecordDate )? firstRecordDate:lastRecordDate;
+    //=======================================================================
+    //
+    // Create and set the first values in annualMilestones
+    //
+    //=======================================================================
+    
+    AnnualMilestoneDataSet annualMilestones;
 
-      annualMilestones.yearsSinceIPO = recentDate-ipoDateNumerical;
-      annualMilestones.yearsOnRecord = std::abs(firstRecordDate-lastRecordDate);
+    std::string ipoDate;
+    JsonFunctions::getJsonString(
+        fundamentalData["General"]["IPODate"],ipoDate);
 
+    double ipoDateNumerical = 
+      DateFunctions::convertToFractionalYear(ipoDate);
+    double firstRecordDate = 
+      DateFunctions::convertToFractionalYear(analysisDates.common.front());
+    double lastRecordDate = 
+      DateFunctions::convertToFractionalYear(analysisDates.common.back());
 
+    double recentDate = 
+      (firstRecordDate > lastRecordDate )? firstRecordDate:lastRecordDate;
 
-      //=======================================================================
-      //
-      //  Calculate the metrics for every data entry in the file
-      //
-      //======================================================================= 
+    annualMilestones.yearsSinceIPO = recentDate-ipoDateNumerical;
+    annualMilestones.yearsOnRecord = std::abs(firstRecordDate-lastRecordDate);
 
-      nlohmann::ordered_json metricAnalysisJson;
 
-      indexDate         = -1;
-      bool validDateSet = true;
 
-      std::vector< DataStructures::RecentPriceToValue > recentPriceToValue;
-      DataStructures::ValuationMetricSummary valuationMetricSummary; 
+    //=======================================================================
+    //
+    //  Calculate the metrics for every data entry in the file
+    //
+    //======================================================================= 
+
+    phaseTimer.next("metrics_per_date");
+    ProfilingFunctions::addCount("analysis_dates",
+      static_cast<double>(indexLastCommonDate));
+
+    nlohmann::ordered_json metricAnalysisJson;
+
+    indexDate         = -1;
+    bool validDateSet = true;
+
+    std::vector< DataStructures::RecentPriceToValue > recentPriceToValue;
+    DataStructures::ValuationMetricSummary valuationMetricSummary; 
+    nlohmann::ordered_json priceToValueSurfaceJson;
+
+    //The terms shared between the metrics of a date are evaluated once
+    FinancialAnalysisFunctions::MetricGraph metricGraph;
+
+    //The records of the previous run can only be reused if all of the 
+    //inputs shared by every date are unchanged
+    if(settings.incremental){
+      currentState.contextHash = 
+        calcTickerContextHash(settings.calculationHash,
+                              fundamentalData,
+                              countryISO2,
+                              betaUnlevered,
+                              meanTaxRate,
+                              meanInterestCover,
+                              financialRatios,
+                              dividendInfo,
+                              { &equityGrowthModel, &equityGrowthModelAvg,
+                                &epsGrowthModel, &epsGrowthModelAvg,
+                                &grossProfitGrowthModel, 
+                                &grossProfitGrowthModelAvg,
+                                &fcfGrowthModel, &fcfGrowthModelAvg,
+                                &revenueGrowthModel, &revenueGrowthModelAvg,
+                                &dividendsYieldGrowthModel,
+                                &dividendsYieldGrowthModelAvg,
+                                &dividendsPaidGrowthModel,
+                                &dividendsPaidGrowthModelAvg },
+                              { &empiricalGrowthData, &empiricalGrowthDataAll },
+                              { &revenueFcfModel, &revenueFcfModelAvg });
+
+      if(settings.reusePreviousResults 
+          && previousState.contextHash.compare(currentState.contextHash)==0){
+        nlohmann::ordered_json previousAnalysis;
+        std::error_code errorCode;
+        if(std::filesystem::exists(analyseFolder+fileName,errorCode)){
+          bool loaded = JsonFunctions::loadJsonFile(analyseFolder+fileName, 
+                                                    previousAnalysis, false);
+          if(loaded && previousAnalysis.contains("metric_data")){
+            previousMetricData = previousAnalysis["metric_data"];
+            reusePreviousRecords = true;
+          }
+        }
+      }
+    }
 
-      while( (indexDate+1) < indexLastCommonDate && validDateSet){
+    while( (indexDate+1) < indexLastCommonDate && validDateSet){
 
-        ++indexDate;
-        std::string date = analysisDates.common[indexDate]; 
-        double dateDouble = DateFunctions::convertToFractionalYear(date);
+      ++indexDate;
 
-        int dateYear = static_cast<int>( std::floor(dateDouble) );
+      //The phases of each date are timed separately
+      ProfilingFunctions::PhaseTimer datePhaseTimer;
+      datePhaseTimer.next("date_ttm_extraction");
+      std::string date = analysisDates.common[indexDate]; 
+      double dateDouble = DateFunctions::convertToFractionalYear(date);
 
-                
-        //The set of dates used for the TTM analysis
-        //std::vector < std::string > dateSet;
-        //std::vector < double > dateSetWeight;
-        DateFunctions::DateSetTTM dateSet;
-      
+      int dateYear = static_cast<int>( std::floor(dateDouble) );
 
-        validDateSet = 
-          DateFunctions::extractTTM(indexDate,
-                                    analysisDates.common,
-                                    "%Y-%m-%d",
-                                    dateSet,
-                                    maxDayErrorTTM,
-                                    quarterlyTTMAnalysis); 
-          
-        if(!validDateSet){
-          break;
-        }    
-         
-             
-        //======================================================================
-        //Update the list of previous time periods
-        //======================================================================        
-
-        //Check if we have enough data to get the previous time period
-        int indexPrevious = indexDate+static_cast<int>(dateSet.dates.size());        
-
-        //Fetch the previous TTM
-        previousTimePeriod = analysisDates.common[indexPrevious];
-        previousDateSet.clear();
-
-        validDateSet = DateFunctions::extractTTM(indexPrevious,
-                                                  analysisDates.common,
-                                                  "%Y-%m-%d",
-                                                  previousDateSet,
-                                                  maxDayErrorTTM,
-                                                  quarterlyTTMAnalysis); 
-        if(!validDateSet){
-          break;
-        }     
+              
+      //The set of dates used for the TTM analysis
+      //std::vector < std::string > dateSet;
+      //std::vector < double > dateSetWeight;
+      DateFunctions::DateSetTTM dateSet;
+    
 
+      validDateSet = 
+        DateFunctions::extractTTM(indexDate,
+                                  analysisDates.common,
+                                  "%Y-%m-%d",
+                                  dateSet,
+                                  maxDayErrorTTM,
+                                  quarterlyTTMAnalysis); 
+        
+      if(!validDateSet){
+        break;
+      }    
+       
+           
+      //======================================================================
+      //Update the list of previous time periods
+      //======================================================================        
+
+      //Check if we have enough data to get the previous time period
+      int indexPrevious = indexDate+static_cast<int>(dateSet.dates.size());        
+
+      //Fetch the previous TTM
+      previousTimePeriod = analysisDates.common[indexPrevious];
+      previousDateSet.clear();
+
+      validDateSet = DateFunctions::extractTTM(indexPrevious,
+                                                analysisDates.common,
+                                                "%Y-%m-%d",
+                                                previousDateSet,
+                                                maxDayErrorTTM,
+                                                quarterlyTTMAnalysis); 
+      if(!validDateSet){
+        break;
+      }     
+
+      FinancialAnalysisFunctions::resetMetricGraph(fundamentalData,
+                                                  &historicalData,
+                                                  dateSet,
+                                                  &previousDateSet,
+                                                  timePeriod.c_str(),
+                                                  timePeriodOS.c_str(),
+                                                  setNansToMissingValue,
+                                                  metricGraph);
+
+      termRecord.clear();
+
+      //======================================================================
+      //Update the list of past periods
+      //======================================================================        
+      for(size_t i=0; i<trailingPastPeriods.size();++i){
+        trailingPastPeriods[i].clear();
+      }
+      trailingPastPeriods.clear();
+
+      bool sufficentPastPeriods=true;
+      int indexPastPeriods = indexDate;
+      bool validPreviousDateSet = true;
+
+      for(unsigned int i=0; 
+                       i<(cc.number_of_years_to_average_capital_expenditures); 
+                     ++i)
+      {
+
+        //std::vector< std::string > pastDateSet;
+        //std::vector< double > pastDateSetWeight;
+        DateFunctions::DateSetTTM pastDateSet;
+
+        if(validPreviousDateSet){
+          if(quarterlyTTMAnalysis 
+            || (indexPastPeriods < analysisDates.common.size())){
+            validPreviousDateSet = 
+              DateFunctions::extractTTM(indexPastPeriods,
+                                        analysisDates.common,
+                                        "%Y-%m-%d",
+                                        pastDateSet,
+                                        maxDayErrorTTM,
+                                        quarterlyTTMAnalysis);
+          }else{
+            if(indexPastPeriods >= analysisDates.common.size()){
+              validPreviousDateSet=false;
+            }
+          }           
+        }
+        if(validPreviousDateSet){
+          trailingPastPeriods.push_back(pastDateSet);
+          indexPastPeriods += pastDateSet.dates.size();
+        }
 
-        termNames.clear();
-        termValues.clear();
+      }
 
-        //======================================================================
-        //Update the list of past periods
-        //======================================================================        
-        for(size_t i=0; i<trailingPastPeriods.size();++i){
-          trailingPastPeriods[i].clear();
+     
+      
+      //======================================================================
+      //Update the risk premium using the risk table, if it exists
+      //======================================================================
+      
+      if(validRiskTable){
+        //Calculate the country-specific equity risk premium
+        if(riskTableFound && !std::isnan(riskTable.CRP)){
+          equityRiskPremium = riskTable.CRP + cc.equity_risk_premium_usa;
         }
-        trailingPastPeriods.clear();
-
-        bool sufficentPastPeriods=true;
-        int indexPastPeriods = indexDate;
-        bool validPreviousDateSet = true;
-
-        for(unsigned int i=0; 
-                         i<(cc.number_of_years_to_average_capital_expenditures); 
-                       ++i)
-        {
-
-          //std::vector< std::string > pastDateSet;
-          //std::vector< double > pastDateSetWeight;
-          DateFunctions::DateSetTTM pastDateSet;
-
-          if(validPreviousDateSet){
-            if(quarterlyTTMAnalysis 
-              || (indexPastPeriods < analysisDates.common.size())){
-              validPreviousDateSet = 
-                DateFunctions::extractTTM(indexPastPeriods,
-                                          analysisDates.common,
-                                          "%Y-%m-%d",
-                                          pastDateSet,
-                                          maxDayErrorTTM,
-                                          quarterlyTTMAnalysis);
-            }else{
-              if(indexPastPeriods >= analysisDates.common.size()){
-                validPreviousDateSet=false;
-              }
-            }           
+
+        //It would be nice to replace this with a historical table of
+        //inflation data by country.
+        if(riskTableFound){
+          if(dateYear >= 2024 && !std::isnan(riskTable.inflation_2024_2028)){
+            inflation = riskTable.inflation_2024_2028;
           }
-          if(validPreviousDateSet){
-            trailingPastPeriods.push_back(pastDateSet);
-            indexPastPeriods += pastDateSet.dates.size();
+          if(dateYear < 2024 && !std::isnan(riskTable.inflation_2019_2023)){
+            inflation = riskTable.inflation_2019_2023;
           }
+        }        
+      }
 
-        }
+      //======================================================================
+      //Incremental mode: reuse the record of the previous run if none of 
+      //the inputs of this date have changed. The most recent date is always
+      //evaluated because it is also used for the current valuation metrics.
+      //======================================================================
+      std::string dateHash;
+      if(settings.incremental){
+        std::vector< int > historicalIndices;
+        historicalIndices.push_back(
+          static_cast<int>(analysisDates.indicesHistorical[indexDate]));
+        historicalIndices.push_back(static_cast<int>(
+          FinancialAnalysisFunctions::getMetric(metricGraph,
+            FinancialAnalysisFunctions::METRIC_HISTORICAL_INDEX)));
+        historicalIndices.push_back(static_cast<int>(
+          FinancialAnalysisFunctions::getMetric(metricGraph,
+            FinancialAnalysisFunctions::METRIC_HISTORICAL_INDEX_PREVIOUS)));
 
-       
-        
-        //======================================================================
-        //Update the risk premium using the risk table, if it exists
-        //======================================================================
-        
-        if(validRiskTable){
-          //Calculate the country-specific equity risk premium
-          if(riskTableFound && !std::isnan(riskTable.CRP)){
-            equityRiskPremium = riskTable.CRP + cc.equity_risk_premium_usa;
-          }
+        int indexBondYield = analysisDates.indicesBond[indexDate];
 
-          //It would be nice to replace this with a historical table of
-          //inflation data by country.
-          if(riskTableFound){
-            if(dateYear >= 2024 && !std::isnan(riskTable.inflation_2024_2028)){
-              inflation = riskTable.inflation_2024_2028;
-            }
-            if(dateYear < 2024 && !std::isnan(riskTable.inflation_2019_2023)){
-              inflation = riskTable.inflation_2019_2023;
+        dateHash = calcDateHash(currentState.contextHash,
+                                date,
+                                fundamentalData,
+                                timePeriod.c_str(),
+                                dateSet,
+                                previousDateSet,
+                                trailingPastPeriods,
+                                FinancialAnalysisFunctions::getMetric(
+                                  metricGraph,
+                                  FinancialAnalysisFunctions::
+                                    METRIC_OUTSTANDING_SHARES),
+                                FinancialAnalysisFunctions::getMetric(
+                                  metricGraph,
+                                  FinancialAnalysisFunctions::
+                                    METRIC_OUTSTANDING_SHARES_PREVIOUS),
+                                equityRiskPremium,
+                                inflation,
+                                analysisDates.bond[indexBondYield],
+                                bondYields.yields[indexBondYield],
+                                historicalData,
+                                historicalIndices);
+
+        if(reusePreviousRecords && indexDate > 0 
+            && previousState.dates.contains(date)
+            && previousMetricData.contains(date)){
+          std::string previousDateHash;
+          JsonFunctions::getJsonString(previousState.dates[date]["hash"],
+                                       previousDateHash);
+          if(previousDateHash.compare(dateHash)==0){
+            if(analysisDates.isAnnualReport[indexDate] 
+                && previousState.dates[date]["value_created"].get<bool>()){
+              ++annualMilestones.yearsOfPositiveValueCreation;
             }
-          }        
+            metricAnalysisJson[date] = previousMetricData[date];
+            currentState.dates[date] = previousState.dates[date];
+            ProfilingFunctions::addCount("dates_reused",1.0);
+            ++numberOfReusedRecords;
+            ++entryCount;
+            continue;
+          }
         }
+      }
 
-        //======================================================================
-        //Evaluate the risk free rate as the yield on a 10 year US bond
-        //  It would be ideal, of course, to have the bond yields in the
-        //  home country of the stock. I have not yet endevoured to find this
-        //  information. Since US bonds are internationally traded
-        //  (in London and Tokyo) this is perhaps not a horrible approximation.
-        //======================================================================
-        int indexBondYield = analysisDates.indicesBond[indexDate];
-        std::string closestBondYieldDate= analysisDates.bond[indexBondYield]; 
-
-        double bondYield = std::nan("1");
-        try{
-          bondYield = JsonFunctions::getJsonFloat(
-              jsonBondYield["US"]["10y_bond_yield"][closestBondYieldDate],
-              setNansToMissingValue); 
-          bondYield = bondYield * (0.01); //Convert from percent to decimal form      
-        }catch( std::invalid_argument const& ex){
-          std::cout << " Bond yield record (" << closestBondYieldDate << ")"
-                    << " is missing a value. Reverting to the default"
-                    << " risk free rate."
-                    << std::endl;
-          bondYield=cc.default_risk_free_rate;
-        }        
+      ProfilingFunctions::addCount("dates_evaluated",1.0);
+      datePhaseTimer.next("date_cost_of_capital");
+
+      //======================================================================
+      //Evaluate the risk free rate as the yield on a 10 year US bond
+      //  It would be ideal, of course, to have the bond yields in the
+      //  home country of the stock. I have not yet endevoured to find this
+      //  information. Since US bonds are internationally traded
+      //  (in London and Tokyo) this is perhaps not a horrible approximation.
+      //======================================================================
+      int indexBondYield = analysisDates.indicesBond[indexDate];
+      std::string closestBondYieldDate= analysisDates.bond[indexBondYield]; 
+
+      double bondYield = std::nan("1");
+      if(bondYields.isNumeric[indexBondYield] != 0){
+        bondYield = bondYields.yields[indexBondYield];
+        bondYield = bondYield * (0.01); //Convert from percent to decimal form      
+      }else{
+        std::cout << " Bond yield record (" << closestBondYieldDate << ")"
+                  << " is missing a value. Reverting to the default"
+                  << " risk free rate."
+                  << std::endl;
+        bondYield=cc.default_risk_free_rate;
+      }        
 
-        double riskFreeRate = bondYield;
-        
+      double riskFreeRate = bondYield;
+      
 
-        //Calculate the country specific defaultSpread
-        if(riskTableFound && !std::isnan(riskTable.riskFreeRate)){
-          riskFreeRate = riskTable.riskFreeRate;        
-        }
+      //Calculate the country specific defaultSpread
+      if(riskTableFound && !std::isnan(riskTable.riskFreeRate)){
+        riskFreeRate = riskTable.riskFreeRate;        
+      }
 
-        //======================================================================
-        //Evaluate the cost of debt
-        //======================================================================
-        double interestCover = 
-          FinancialAnalysisFunctions::calcInterestCover(
-                                        fundamentalData,
-                                        dateSet,
-                                        cc.default_interest_cover,
-                                        jsonDefaultSpread,
-                                        timePeriod.c_str(),
-                                        appendTermRecord,
-                                        setNansToMissingValue,
-                                        termNames,
-                                        termValues);
+      //======================================================================
+      //Evaluate the cost of debt
+      //======================================================================
+      double interestCover = 
+        FinancialAnalysisFunctions::calcInterestCover(
+                                      metricGraph,
+                                      cc.default_interest_cover,
+                                      defaultSpreads,
+                                      appendTermRecord,
+                                      termRecord);
+
+      double defaultSpread = FinancialAnalysisFunctions::
+          calcDefaultSpread(metricGraph,
+                            interestCover,
+                            defaultSpreads,
+                            appendTermRecord,
+                            termRecord);
 
-        double defaultSpread = FinancialAnalysisFunctions::
-            calcDefaultSpread(fundamentalData,
-                              dateSet,
-                              timePeriod.c_str(),
-                              interestCover,
-                              jsonDefaultSpread,
-                              appendTermRecord,
-                              setNansToMissingValue,
-                              termNames,
-                              termValues);
 
+      //Calculate the country specific defaultSpread
+      if(riskTableFound && !std::isnan(riskTable.defaultSpread)){
+        defaultSpread += riskTable.defaultSpread;        
+      }
 
-        //Calculate the country specific defaultSpread
-        if(riskTableFound && !std::isnan(riskTable.defaultSpread)){
-          defaultSpread += riskTable.defaultSpread;        
+      std::string parentName = "afterTaxCostOfDebt_";
+      
+      //======================================================================
+      //Get the tax rate
+      //======================================================================
+
+      double taxRate = 
+        getTaxRate( analysisDates.common[indexDate],
+                    riskTable,
+                    countryISO2,
+                    corpWorldTaxTable,
+                    meanTaxRate,
+                    cc.default_tax_rate,
+                    acceptableBackwardsYearErrorForTaxRate,
+                    usingTaxTable,
+                    riskTableFound);        
+ 
+      //======================================================================
+      //Evaluate the cost of debt
+      //======================================================================
+
+      double afterTaxCostOfDebt = (riskFreeRate+defaultSpread)*(1.0-taxRate);
+
+      //Adjust for inflation
+      //Using Table 31 from Damodaran, "Country risk: determinants, measures
+      //and implications - The 2024 Edition".
+
+      //afterTaxCostOfDebt = 
+      //(1.0 + afterTaxCostOfDebt)*(
+      //    (1.0+inflation)/(1.0+defaultInflationRate))
+      //    -1.0;
+
+
+
+      termRecord.appendName("afterTaxCostOfDebt_riskFreeRate");
+      termRecord.appendName("afterTaxCostOfDebt_defaultSpread");
+      termRecord.appendName("afterTaxCostOfDebt_taxRate");  
+      termRecord.appendName("afterTaxCostOfDebt");
+      
+      termRecord.appendValue(riskFreeRate);
+      termRecord.appendValue(defaultSpread);
+      termRecord.appendValue(taxRate);
+      termRecord.appendValue(afterTaxCostOfDebt);
+
+      //======================================================================
+      //Evaluate short, long, and total debt
+      //======================================================================
+      DataStructures::DebtInfo debtInfo, previousDebtInfo;
+      std::string debtParentName = "debt_";
+      std::string previousDebtParentName = "previousDebt_";
+
+      FinancialAnalysisFunctions::getDebtInfo(fundamentalData,
+                                              timePeriod.c_str(),
+                                              dateSet.dates[0].c_str(),
+                                              debtInfo,
+                                              appendTermRecord,
+                                              debtParentName,
+                                              termRecord,
+                                              setNansToMissingValue);
+      
+      FinancialAnalysisFunctions::getDebtInfo(fundamentalData,
+                                              timePeriod.c_str(),
+                                              previousDateSet.dates[0].c_str(),
+                                              previousDebtInfo,
+                                              appendTermRecord,
+                                              previousDebtParentName,
+                                              termRecord,
+                                              setNansToMissingValue);
+      
+      //======================================================================
+      //Evaluate the current total short and long term debt
+      //======================================================================
+      //double longTermDebt = 
+      //  JsonFunctions::getJsonFloat(
+      //    fundamentalData[FIN][BAL][timePeriod.c_str()][date.c_str()]
+      //                   ["longTermDebt"]);
+
+
+      //======================================================================        
+      //Evaluate the current market capitalization
+      //======================================================================
+      //dateSet.dates[0] is the date of this record
+      double outstandingShares = 
+        FinancialAnalysisFunctions::getMetric(metricGraph,
+          FinancialAnalysisFunctions::METRIC_OUTSTANDING_SHARES);
+      /*
+      double outstandingShares = std::nan("1");
+      int smallestDateDifference=std::numeric_limits<int>::max();        
+      std::string closestDate("");
+      for(auto& el : fundamentalData[OS][timePeriodOS.c_str()]){
+        std::string dateOS("");
+        JsonFunctions::getJsonString(el["dateFormatted"],dateOS);         
+        int dateDifference = 
+          DateFunctions::calcDifferenceInDaysBetweenTwoDates(
+            date,"%Y-%m-%d",dateOS,"%Y-%m-%d");
+        if(std::abs(dateDifference)<smallestDateDifference){
+          closestDate = dateOS;
+          smallestDateDifference=std::abs(dateDifference);
+          outstandingShares = JsonFunctions::getJsonFloat(el["shares"]);
         }
+      }
+      */
 
-        std::string parentName = "afterTaxCostOfDebt_";
-        
-        //======================================================================
-        //Get the tax rate
-        //======================================================================
-
-        double taxRate = 
-          getTaxRate( analysisDates.common[indexDate],
-                      riskTable,
-                      countryISO2,
-                      corpWorldTaxTable,
-                      meanTaxRate,
-                      cc.default_tax_rate,
-                      acceptableBackwardsYearErrorForTaxRate,
-                      usingTaxTable,
-                      riskTableFound);        
-   
-        //======================================================================
-        //Evaluate the cost of debt
-        //======================================================================
+      unsigned int indexHistoricalData = 
+        analysisDates.indicesHistorical[indexDate];   
+
+      std::string closestHistoricalDate= 
+        analysisDates.historical[indexHistoricalData]; 
+
+      double adjustedClosePrice = std::nan("1");
+      double closePrice = std::nan("1");
+      try{
+        adjustedClosePrice = 
+          FinancialAnalysisFunctions::
+            getHistoricalDataInFundamentalUnit(
+              historicalData[ indexHistoricalData ]["adjusted_close"],
+              setNansToMissingValue);
+        closePrice = 
+          FinancialAnalysisFunctions::
+            getHistoricalDataInFundamentalUnit(
+              historicalData[ indexHistoricalData ]["close"],
+              setNansToMissingValue);          
+
+        //adjustedClosePrice = JsonFunctions::getJsonFloat(
+        //            historicalData[ indexHistoricalData ]["adjusted_close"],
+        //            setNansToMissingValue); 
+        //closePrice = JsonFunctions::getJsonFloat(
+        //            historicalData[ indexHistoricalData ]["close"],
+        //            setNansToMissingValue);                       
+
+      }catch( std::invalid_argument const& ex){
+        std::cout << " Historical record (" << closestHistoricalDate << ")"
+                  << " is missing an opening share price."
+                  << std::endl;
+      }
 
-        double afterTaxCostOfDebt = (riskFreeRate+defaultSpread)*(1.0-taxRate);
+      double marketCapitalization = 
+        adjustedClosePrice*outstandingShares;
+
+
+      //======================================================================
+      //Evaluate the cost of equity
+      //======================================================================        
+      double beta = betaUnlevered*(1.0 + 
+        (1.0-taxRate)*(debtInfo.longTermDebtEstimate/marketCapitalization));
+
+
+      double annualCostOfEquityAsAPercentage = 
+        riskFreeRate + equityRiskPremium*beta;
+
+      //Adjust for inflation
+      //Using Table 31 from Damodaran, "Country risk: determinants, measures
+      //and implications - The 2024 Edition".
+      double costOfEquityAsAPercentageNoInflation = 
+                annualCostOfEquityAsAPercentage; 
+
+      annualCostOfEquityAsAPercentage = 
+        (1.0+annualCostOfEquityAsAPercentage)
+        *((1.0+inflation)/(1.0+defaultInflationRate)) - 1.0;
+
+       double costOfEquityAsAPercentage=annualCostOfEquityAsAPercentage;
+      //if(quarterlyTTMAnalysis){
+      //  costOfEquityAsAPercentage = costOfEquityAsAPercentage/4.0;
+      //}        
+
+      termRecord.appendName("costOfEquityAsAPercentage_riskFreeRate");
+      termRecord.appendName("costOfEquityAsAPercentage_equityRiskPremium");
+      termRecord.appendName("costOfEquityAsAPercentage_betaUnlevered");
+      termRecord.appendName("costOfEquityAsAPercentage_taxRate");
+      termRecord.appendName("costOfEquityAsAPercentage_inflationReference");
+      termRecord.appendName("costOfEquityAsAPercentage_inflation");          
+      termRecord.appendName("costOfEquityAsAPercentage_longTermDebt");
+      termRecord.appendName("costOfEquityAsAPercentage_adjustedClose");
+      termRecord.appendName("costOfEquityAsAPercentage_outstandingShares");
+      termRecord.appendName("costOfEquityAsAPercentage_marketCapitalization");
+      termRecord.appendName("costOfEquityAsAPercentage_beta");
+      termRecord.appendName("costOfEquityAsAPercentage_noInflation");
+      termRecord.appendName("costOfEquityAsAPercentage");
+
+      termRecord.appendValue(riskFreeRate);
+      termRecord.appendValue(equityRiskPremium);
+      termRecord.appendValue(betaUnlevered);
+      termRecord.appendValue(taxRate);
+      termRecord.appendValue(defaultInflationRate);
+      termRecord.appendValue(inflation);
+      termRecord.appendValue(debtInfo.longTermDebtEstimate);
+      termRecord.appendValue(adjustedClosePrice);
+      termRecord.appendValue(outstandingShares);
+      termRecord.appendValue(marketCapitalization);
+      termRecord.appendValue(beta);
+      termRecord.appendValue(costOfEquityAsAPercentageNoInflation);
+      termRecord.appendValue(costOfEquityAsAPercentage);
+
+
+
+      //======================================================================        
+      //Evaluate a weighted cost of capital
+      //======================================================================        
+
+      double costOfCapital = 
+        (costOfEquityAsAPercentage*marketCapitalization
+        +afterTaxCostOfDebt*debtInfo.longTermDebtEstimate)
+        /(marketCapitalization+debtInfo.longTermDebtEstimate);
+
+
+      termRecord.appendName("costOfCapital_longTermDebt");
+      termRecord.appendName("costOfCapital_outstandingShares");
+      termRecord.appendName("costOfCapital_adjustedClose");
+      termRecord.appendName("costOfCapital_marketCapitalization");
+      termRecord.appendName("costOfCapital_costOfEquityAsAPercentage");
+      termRecord.appendName("costOfCapital_afterTaxCostOfDebt");
+    termRecord.appendName("costOfCapital");
+
+      termRecord.appendValue(debtInfo.longTermDebtEstimate);
+      termRecord.appendValue(outstandingShares);
+      termRecord.appendValue(adjustedClosePrice);
+      termRecord.appendValue(marketCapitalization);
+      termRecord.appendValue(costOfEquityAsAPercentage);
+      termRecord.appendValue(afterTaxCostOfDebt);
+      termRecord.appendValue(costOfCapital);
+
+
+      //As companies mature they use cheaper forms of capital: debt.
+      double costOfCapitalMature = 
+        (costOfEquityAsAPercentage*(1-cc.mature_firm_fraction_debt_to_capital) 
+        + afterTaxCostOfDebt*cc.mature_firm_fraction_debt_to_capital);
+
+      if(costOfCapitalMature > costOfCapital){
+        costOfCapitalMature=costOfCapital;
+      }
 
-        //Adjust for inflation
-        //Using Table 31 from Damodaran, "Country risk: determinants, measures
-        //and implications - The 2024 Edition".
+      termRecord.appendName("costOfCapitalMature_matureFirmDebtCapitalFraction");
+      termRecord.appendName("costOfCapitalMature_costOfEquityAsAPercentage");
+      termRecord.appendName("costOfCapitalMature_afterTaxCostOfDebt");
+      termRecord.appendName("costOfCapitalMature");
 
-        //afterTaxCostOfDebt = 
-        //(1.0 + afterTaxCostOfDebt)*(
-        //    (1.0+inflation)/(1.0+defaultInflationRate))
-        //    -1.0;
+      termRecord.appendValue(cc.mature_firm_fraction_debt_to_capital);
+      termRecord.appendValue(costOfEquityAsAPercentage);
+      termRecord.appendValue(afterTaxCostOfDebt);        
+      termRecord.appendValue(costOfCapitalMature);
 
+      datePhaseTimer.next("date_financial_ratios");
 
+      //======================================================================
+      // Write some of the financial ratios
+      //======================================================================
+      double dateRecent = 
+        DateFunctions::convertToFractionalYear(dateSet.dates[0]);
+      bool validFinancialRatios = financialRatios.datesNumerical.size() > 0;
 
-        termNames.push_back("afterTaxCostOfDebt_riskFreeRate");
-        termNames.push_back("afterTaxCostOfDebt_defaultSpread");
-        termNames.push_back("afterTaxCostOfDebt_taxRate");  
-        termNames.push_back("afterTaxCostOfDebt");
-        
-        termValues.push_back(riskFreeRate);
-        termValues.push_back(defaultSpread);
-        termValues.push_back(taxRate);
-        termValues.push_back(afterTaxCostOfDebt);
-
-        //======================================================================
-        //Evaluate short, long, and total debt
-        //======================================================================
-        DataStructures::DebtInfo debtInfo, previousDebtInfo;
-        std::string debtParentName = "debt_";
-        std::string previousDebtParentName = "previousDebt_";
-
-        FinancialAnalysisFunctions::getDebtInfo(fundamentalData,
-                                                timePeriod.c_str(),
-                                                dateSet.dates[0].c_str(),
-                                                debtInfo,
-                                                appendTermRecord,
-                                                debtParentName,
-                                                termNames,
-                                                termValues,
-                                                setNansToMissingValue);
-        
-        FinancialAnalysisFunctions::getDebtInfo(fundamentalData,
-                                                timePeriod.c_str(),
-                                                previousDateSet.dates[0].c_str(),
-                                                previousDebtInfo,
-                                                appendTermRecord,
-                                                previousDebtParentName,
-                                                termNames,
-                                                termValues,
-                                                setNansToMissingValue);
-        
-        //======================================================================
-        //Evaluate the current total short and long term debt
-        //======================================================================
-        //double longTermDebt = 
-        //  JsonFunctions::getJsonFloat(
-        //    fundamentalData[FIN][BAL][timePeriod.c_str()][date.c_str()]
-        //                   ["longTermDebt"]);
-
-
-        //======================================================================        
-        //Evaluate the current market capitalization
-        //======================================================================
-        double outstandingShares = 
-          FinancialAnalysisFunctions::getOutstandingSharesClosestToDate(
-              fundamentalData, 
-              date,
-              timePeriodOS.c_str());
-        /*
-        double outstandingShares = std::nan("1");
-        int smallestDateDifference=std::numeric_limits<int>::max();        
-        std::string closestDate("");
-        for(auto& el : fundamentalData[OS][timePeriodOS.c_str()]){
-          std::string dateOS("");
-          JsonFunctions::getJsonString(el["dateFormatted"],dateOS);         
-          int dateDifference = 
-            DateFunctions::calcDifferenceInDaysBetweenTwoDates(
-              date,"%Y-%m-%d",dateOS,"%Y-%m-%d");
-          if(std::abs(dateDifference)<smallestDateDifference){
-            closestDate = dateOS;
-            smallestDateDifference=std::abs(dateDifference);
-            outstandingShares = JsonFunctions::getJsonFloat(el["shares"]);
-          }
+    
+      if(validFinancialRatios){
+        int idxFR = DateFunctions::getIndexClosestToDate(dateRecent,
+                                    financialRatios.datesNumerical);
+
+        termRecord.appendName("financialRatios_dividendYield");
+        termRecord.appendName("financialRatios_operationalLeverage");
+        termRecord.appendName("financialRatios_pe");
+        termRecord.appendValue(financialRatios.dividendYield[idxFR]);
+        termRecord.appendValue(financialRatios.operationalLeverage[idxFR]);
+        termRecord.appendValue(financialRatios.pe[idxFR]);  
+                                          
+      }
+
+      //======================================================================
+      // Write data needed to implement William Priest's dividend info
+      // screener
+      //======================================================================
+
+      bool validDividendInfo = dividendInfo.datesNumerical.size()>0;
+
+      if(validDividendInfo){
+        int idxDI = DateFunctions::getIndexClosestToDate(dateRecent,
+                                      dividendInfo.datesNumerical);
+
+        int idxDYG = DateFunctions::getIndexClosestToDate(dateRecent,
+                                    dividendsYieldGrowthModel.datesNumerical);
+
+        int idxDIG = DateFunctions::getIndexClosestToDate(dateRecent,
+                                    dividendsPaidGrowthModel.datesNumerical);
+
+        int idxFCFG = DateFunctions::getIndexClosestToDate(dateRecent,
+                                    fcfGrowthModel.datesNumerical);
+
+        termRecord.appendName("PriestDividendMetrics_dividendYield");
+        termRecord.appendName("PriestDividendMetrics_dividendYieldGrowth");
+        termRecord.appendName("PriestDividendMetrics_dividendYieldGrowthAvg");
+        termRecord.appendName("PriestDividendMetrics_dividendsPaidGrowth");
+        termRecord.appendName("PriestDividendMetrics_dividendsPaidGrowthAvg");
+        termRecord.appendName("PriestDividendMetrics_dividendPayoutRatio");
+        termRecord.appendName("PriestDividendMetrics_dividendPayoutRatioTrailingAverage");
+        termRecord.appendName("PriestDividendMetrics_freeCashFlowGrowth");
+        termRecord.appendName("PriestDividendMetrics_freeCashFlowGrowthAvg");
+        termRecord.appendName("PriestDividendMetrics_freeCashFlowYieldTrailingAverage");
+        termRecord.appendName("PriestDividendMetrics_freeCashFlowLessDividendsYieldTrailingAverage");
+        termRecord.appendName("PriestDividendMetrics_dividendFreeCashFlowRatio");
+        termRecord.appendName("PriestDividendMetrics_dividendFreeCashFlowRatioTrailingAverage");
+
+        if(idxDI >=0){
+          termRecord.appendValue(dividendInfo.dividendYield[idxDI]);
+        }else{
+          termRecord.appendValue(std::nan("1"));
+        }
+        if(idxDYG >= 0){
+          termRecord.appendValue(dividendsYieldGrowthModel.metricGrowthRate[idxDYG]);
+        }else{
+          termRecord.appendValue(std::nan("1"));
+        }
+        if(dividendsYieldGrowthModelAvg.metricGrowthRate.size()>=1){
+          termRecord.appendValue(dividendsYieldGrowthModelAvg.metricGrowthRate[0]);
+        }else{
+          termRecord.appendValue(std::nan("1"));
+        }
+        if(idxDIG >= 0){
+          termRecord.appendValue(dividendsPaidGrowthModel.metricGrowthRate[idxDIG]);
+        }else{
+          termRecord.appendValue(std::nan("1"));
+        }
+        if(dividendsPaidGrowthModelAvg.metricGrowthRate.size()>=1){
+          termRecord.appendValue(dividendsPaidGrowthModelAvg.metricGrowthRate[0]);
+        }else{
+          termRecord.appendValue(std::nan("1"));
+        }
+        if(idxDI >= 0){
+          termRecord.appendValue(dividendInfo.dividendPayoutRatio[idxDI]);            
+        }else{
+          termRecord.appendValue(std::nan("1"));
+        }
+        if(idxDI >= 0){
+          termRecord.appendValue(dividendInfo.dividendPayoutRatioTrailingAverage[idxDI]);
+        }else{
+          termRecord.appendValue(std::nan("1"));
+        }
+        if(idxFCFG >= 0){
+          termRecord.appendValue(fcfGrowthModel.metricGrowthRate[idxFCFG]);
+        }else{
+          termRecord.appendValue(std::nan("1"));
+        }
+        if(fcfGrowthModelAvg.metricGrowthRate.size()>=1){
+          termRecord.appendValue(fcfGrowthModelAvg.metricGrowthRate[0]);
+        }else{
+          termRecord.appendValue(std::nan("1"));            
         }
-        */
+        if(idxDI >= 0){
+          termRecord.appendValue(dividendInfo.freeCashFlowYieldTrailingAverage[idxDI]);            
+          termRecord.appendValue(dividendInfo.freeCashFlowLessDividendsYieldTrailingAverage[idxDI]);
+          termRecord.appendValue(dividendInfo.dividendFreeCashFlowRatio[idxDI]);
+          termRecord.appendValue(dividendInfo.dividendFreeCashFlowRatioTrailingAverage[idxDI]);
 
-        unsigned int indexHistoricalData = 
-          analysisDates.indicesHistorical[indexDate];   
+        }else{
+          termRecord.appendValue(std::nan("1"));            
+          termRecord.appendValue(std::nan("1"));            
+          termRecord.appendValue(std::nan("1"));            
+          termRecord.appendValue(std::nan("1"));            
+        }
 
-        std::string closestHistoricalDate= 
-          analysisDates.historical[indexHistoricalData]; 
+      }
 
-        double adjustedClosePrice = std::nan("1");
-        double closePrice = std::nan("1");
-        try{
-          adjustedClosePrice = 
-            FinancialAnalysisFunctions::
-              getHistoricalDataInFundamentalUnit(
-                historicalData[ indexHistoricalData ]["adjusted_close"],
-                fundamentalData,
-                setNansToMissingValue);
-          closePrice = 
-            FinancialAnalysisFunctions::
-              getHistoricalDataInFundamentalUnit(
-                historicalData[ indexHistoricalData ]["close"],
-                fundamentalData,
-                setNansToMissingValue);          
-
-          //adjustedClosePrice = JsonFunctions::getJsonFloat(
-          //            historicalData[ indexHistoricalData ]["adjusted_close"],
-          //            setNansToMissingValue); 
-          //closePrice = JsonFunctions::getJsonFloat(
-          //            historicalData[ indexHistoricalData ]["close"],
-          //            setNansToMissingValue);                       
-
-        }catch( std::invalid_argument const& ex){
-          std::cout << " Historical record (" << closestHistoricalDate << ")"
-                    << " is missing an opening share price."
-                    << std::endl;
-        }
+      datePhaseTimer.next("date_metrics");
 
-        double marketCapitalization = 
-          adjustedClosePrice*outstandingShares;
-
-
-        //======================================================================
-        //Evaluate the cost of equity
-        //======================================================================        
-        double beta = betaUnlevered*(1.0 + 
-          (1.0-taxRate)*(debtInfo.longTermDebtEstimate/marketCapitalization));
-
-
-        double annualCostOfEquityAsAPercentage = 
-          riskFreeRate + equityRiskPremium*beta;
-
-        //Adjust for inflation
-        //Using Table 31 from Damodaran, "Country risk: determinants, measures
-        //and implications - The 2024 Edition".
-        double costOfEquityAsAPercentageNoInflation = 
-                  annualCostOfEquityAsAPercentage; 
-
-        annualCostOfEquityAsAPercentage = 
-          (1.0+annualCostOfEquityAsAPercentage)
-          *((1.0+inflation)/(1.0+defaultInflationRate)) - 1.0;
-
-         double costOfEquityAsAPercentage=annualCostOfEquityAsAPercentage;
-        //if(quarterlyTTMAnalysis){
-        //  costOfEquityAsAPercentage = costOfEquityAsAPercentage/4.0;
-        //}        
-
-        termNames.push_back("costOfEquityAsAPercentage_riskFreeRate");
-        termNames.push_back("costOfEquityAsAPercentage_equityRiskPremium");
-        termNames.push_back("costOfEquityAsAPercentage_betaUnlevered");
-        termNames.push_back("costOfEquityAsAPercentage_taxRate");
-        termNames.push_back("costOfEquityAsAPercentage_inflationReference");
-        termNames.push_back("costOfEquityAsAPercentage_inflation");          
-        termNames.push_back("costOfEquityAsAPercentage_longTermDebt");
-        termNames.push_back("costOfEquityAsAPercentage_adjustedClose");
-        termNames.push_back("costOfEquityAsAPercentage_outstandingShares");
-        termNames.push_back("costOfEquityAsAPercentage_marketCapitalization");
-        termNames.push_back("costOfEquityAsAPercentage_beta");
-        termNames.push_back("costOfEquityAsAPercentage_noInflation");
-        termNames.push_back("costOfEquityAsAPercentage");
-
-        termValues.push_back(riskFreeRate);
-        termValues.push_back(equityRiskPremium);
-        termValues.push_back(betaUnlevered);
-        termValues.push_back(taxRate);
-        termValues.push_back(defaultInflationRate);
-        termValues.push_back(inflation);
-        termValues.push_back(debtInfo.longTermDebtEstimate);
-        termValues.push_back(adjustedClosePrice);
-        termValues.push_back(outstandingShares);
-        termValues.push_back(marketCapitalization);
-        termValues.push_back(beta);
-        termValues.push_back(costOfEquityAsAPercentageNoInflation);
-        termValues.push_back(costOfEquityAsAPercentage);
-
-
-
-        //======================================================================        
-        //Evaluate a weighted cost of capital
-        //======================================================================        
-
-        double costOfCapital = 
-          (costOfEquityAsAPercentage*marketCapitalization
-          +afterTaxCostOfDebt*debtInfo.longTermDebtEstimate)
-          /(marketCapitalization+debtInfo.longTermDebtEstimate);
-
-
-        termNames.push_back("costOfCapital_longTermDebt");
-        termNames.push_back("costOfCapital_outstandingShares");
-        termNames.push_back("costOfCapital_adjustedClose");
-        termNames.push_back("costOfCapital_marketCapitalization");
-        termNames.push_back("costOfCapital_costOfEquityAsAPercentage");
-        termNames.push_back("costOfCapital_afterTaxCostOfDebt");
-      termNames.push_back("costOfCapital");
-
-        termValues.push_back(debtInfo.longTermDebtEstimate);
-        termValues.push_back(outstandingShares);
-        termValues.push_back(adjustedClosePrice);
-        termValues.push_back(marketCapitalization);
-        termValues.push_back(costOfEquityAsAPercentage);
-        termValues.push_back(afterTaxCostOfDebt);
-        termValues.push_back(costOfCapital);
-
-
-        //As companies mature they use cheaper forms of capital: debt.
-        double costOfCapitalMature = 
-          (costOfEquityAsAPercentage*(1-cc.mature_firm_fraction_debt_to_capital) 
-          + afterTaxCostOfDebt*cc.mature_firm_fraction_debt_to_capital);
-
-        if(costOfCapitalMature > costOfCapital){
-          costOfCapitalMature=costOfCapital;
-        }
+      //======================================================================
+      //Evaluate the metrics
+      //  At the moment residual cash flow and the company's valuation are
+      //  most of interest. The remaining metrics are useful, however, and so,
+      //  have been included.
+      //======================================================================        
+      std::string emptyParentName("");
 
-        termNames.push_back("costOfCapitalMature_matureFirmDebtCapitalFraction");
-        termNames.push_back("costOfCapitalMature_costOfEquityAsAPercentage");
-        termNames.push_back("costOfCapitalMature_afterTaxCostOfDebt");
-        termNames.push_back("costOfCapitalMature");
+      double totalStockHolderEquity =  
+        FinancialAnalysisFunctions::sumFundamentalDataOverDates(
+          fundamentalData,FIN,BAL,timePeriod.c_str(),dateSet,
+          "totalStockholderEquity", setNansToMissingValue);
 
-        termValues.push_back(cc.mature_firm_fraction_debt_to_capital);
-        termValues.push_back(costOfEquityAsAPercentage);
-        termValues.push_back(afterTaxCostOfDebt);        
-        termValues.push_back(costOfCapitalMature);
+      double roicOp = FinancialAnalysisFunctions::
+        calcReturnOnInvestedOperatingCapital(
+            fundamentalData,
+            dateSet,
+            timePeriod.c_str(),
+            taxRate,
+            appendTermRecord, 
+            emptyParentName,
+            setNansToMissingValue,
+            termRecord);
+      double roicOpLessCostOfCapital = roicOp - costOfCapitalMature;  
+      termRecord.appendName("returnOnInvestedOperatingCapitalLessCostOfCapital");
+      termRecord.appendValue(roicOpLessCostOfCapital); 
 
-        //======================================================================
-        // Write some of the financial ratios
-        //======================================================================
-        double dateRecent = 
-          DateFunctions::convertToFractionalYear(dateSet.dates[0]);
-        bool validFinancialRatios = financialRatios.datesNumerical.size() > 0;
 
-      
-        if(validFinancialRatios){
-          int idxFR = DateFunctions::getIndexClosestToDate(dateRecent,
-                                      financialRatios.datesNumerical);
-
-          termNames.push_back("financialRatios_dividendYield");
-          termNames.push_back("financialRatios_operationalLeverage");
-          termNames.push_back("financialRatios_pe");
-          termValues.push_back(financialRatios.dividendYield[idxFR]);
-          termValues.push_back(financialRatios.operationalLeverage[idxFR]);
-          termValues.push_back(financialRatios.pe[idxFR]);  
-                                            
-        }
 
-        //======================================================================
-        // Write data needed to implement William Priest's dividend info
-        // screener
-        //======================================================================
-
-        bool validDividendInfo = dividendInfo.datesNumerical.size()>0;
-
-        if(validDividendInfo){
-          int idxDI = DateFunctions::getIndexClosestToDate(dateRecent,
-                                        dividendInfo.datesNumerical);
-
-          int idxDYG = DateFunctions::getIndexClosestToDate(dateRecent,
-                                      dividendsYieldGrowthModel.datesNumerical);
-
-          int idxDIG = DateFunctions::getIndexClosestToDate(dateRecent,
-                                      dividendsPaidGrowthModel.datesNumerical);
-
-          int idxFCFG = DateFunctions::getIndexClosestToDate(dateRecent,
-                                      fcfGrowthModel.datesNumerical);
-
-          termNames.push_back("PriestDividendMetrics_dividendYield");
-          termNames.push_back("PriestDividendMetrics_dividendYieldGrowth");
-          termNames.push_back("PriestDividendMetrics_dividendYieldGrowthAvg");
-          termNames.push_back("PriestDividendMetrics_dividendsPaidGrowth");
-          termNames.push_back("PriestDividendMetrics_dividendsPaidGrowthAvg");
-          termNames.push_back("PriestDividendMetrics_dividendPayoutRatio");
-          termNames.push_back("PriestDividendMetrics_dividendPayoutRatioTrailingAverage");
-          termNames.push_back("PriestDividendMetrics_freeCashFlowGrowth");
-          termNames.push_back("PriestDividendMetrics_freeCashFlowGrowthAvg");
-          termNames.push_back("PriestDividendMetrics_freeCashFlowYieldTrailingAverage");
-          termNames.push_back("PriestDividendMetrics_freeCashFlowLessDividendsYieldTrailingAverage");
-          termNames.push_back("PriestDividendMetrics_dividendFreeCashFlowRatio");
-          termNames.push_back("PriestDividendMetrics_dividendFreeCashFlowRatioTrailingAverage");
-
-          if(idxDI >=0){
-            termValues.push_back(dividendInfo.dividendYield[idxDI]);
-          }else{
-            termValues.push_back(std::nan("1"));
-          }
-          if(idxDYG >= 0){
-            termValues.push_back(dividendsYieldGrowthModel.metricGrowthRate[idxDYG]);
-          }else{
-            termValues.push_back(std::nan("1"));
-          }
-          if(dividendsYieldGrowthModelAvg.metricGrowthRate.size()>=1){
-            termValues.push_back(dividendsYieldGrowthModelAvg.metricGrowthRate[0]);
-          }else{
-            termValues.push_back(std::nan("1"));
-          }
-          if(idxDIG >= 0){
-            termValues.push_back(dividendsPaidGrowthModel.metricGrowthRate[idxDIG]);
-          }else{
-            termValues.push_back(std::nan("1"));
-          }
-          if(dividendsPaidGrowthModelAvg.metricGrowthRate.size()>=1){
-            termValues.push_back(dividendsPaidGrowthModelAvg.metricGrowthRate[0]);
-          }else{
-            termValues.push_back(std::nan("1"));
-          }
-          if(idxDI >= 0){
-            termValues.push_back(dividendInfo.dividendPayoutRatio[idxDI]);            
-          }else{
-            termValues.push_back(std::nan("1"));
-          }
-          if(idxDI >= 0){
-            termValues.push_back(dividendInfo.dividendPayoutRatioTrailingAverage[idxDI]);
-          }else{
-            termValues.push_back(std::nan("1"));
-          }
-          if(idxFCFG >= 0){
-            termValues.push_back(fcfGrowthModel.metricGrowthRate[idxFCFG]);
-          }else{
-            termValues.push_back(std::nan("1"));
-          }
-          if(fcfGrowthModelAvg.metricGrowthRate.size()>=1){
-            termValues.push_back(fcfGrowthModelAvg.metricGrowthRate[0]);
-          }else{
-            termValues.push_back(std::nan("1"));            
-          }
-          if(idxDI >= 0){
-            termValues.push_back(dividendInfo.freeCashFlowYieldTrailingAverage[idxDI]);            
-            termValues.push_back(dividendInfo.freeCashFlowLessDividendsYieldTrailingAverage[idxDI]);
-            termValues.push_back(dividendInfo.dividendFreeCashFlowRatio[idxDI]);
-            termValues.push_back(dividendInfo.dividendFreeCashFlowRatioTrailingAverage[idxDI]);
 
-          }else{
-            termValues.push_back(std::nan("1"));            
-            termValues.push_back(std::nan("1"));            
-            termValues.push_back(std::nan("1"));            
-            termValues.push_back(std::nan("1"));            
-          }
+      double returnOnCapitalDeployed = FinancialAnalysisFunctions::
+        calcReturnOnCapitalDeployed(  debtInfo,
+                                      fundamentalData,
+                                      dateSet,
+                                      timePeriod.c_str(), 
+                                      taxRate,
+                                      appendTermRecord, 
+                                      emptyParentName,
+                                      setNansToMissingValue,
+                                      termRecord);
 
-        }
+      double returnOnCapitalDeployedLessCostOfCapital 
+        = returnOnCapitalDeployed - costOfCapitalMature;  
 
-        //======================================================================
-        //Evaluate the metrics
-        //  At the moment residual cash flow and the company's valuation are
-        //  most of interest. The remaining metrics are useful, however, and so,
-        //  have been included.
-        //======================================================================        
-        std::string emptyParentName("");
-
-        double totalStockHolderEquity =  
-          FinancialAnalysisFunctions::sumFundamentalDataOverDates(
-            fundamentalData,FIN,BAL,timePeriod.c_str(),dateSet,
-            "totalStockholderEquity", setNansToMissingValue);
-
-        double roicOp = FinancialAnalysisFunctions::
-          calcReturnOnInvestedOperatingCapital(
-              fundamentalData,
-              dateSet,
-              timePeriod.c_str(),
-              taxRate,
-              appendTermRecord, 
-              emptyParentName,
-              setNansToMissingValue,
-              termNames, 
-              termValues);
-        double roicOpLessCostOfCapital = roicOp - costOfCapitalMature;  
-        termNames.push_back("returnOnInvestedOperatingCapitalLessCostOfCapital");
-        termValues.push_back(roicOpLessCostOfCapital); 
+      termRecord.appendName("returnOnCapitalDeployedLessCostOfCapital");
+      termRecord.appendValue(returnOnCapitalDeployedLessCostOfCapital);                                           
 
+      double grossMargin = FinancialAnalysisFunctions::
+        calcGrossMargin(  fundamentalData,
+                          dateSet,
+                          timePeriod.c_str(),
+                          appendTermRecord,
+                          setNansToMissingValue,
+                          termRecord);
 
+      double operatingMargin = FinancialAnalysisFunctions::
+        calcOperatingMargin(  fundamentalData,
+                              dateSet,
+                              timePeriod.c_str(), 
+                              appendTermRecord,
+                              setNansToMissingValue,
+                              termRecord);          
 
+      double cashConversion = FinancialAnalysisFunctions::
+        calcCashConversionRatio(  metricGraph,
+                                  taxRate,
+                                  appendTermRecord,
+                                  termRecord);
 
-        double returnOnCapitalDeployed = FinancialAnalysisFunctions::
-          calcReturnOnCapitalDeployed(  debtInfo,
-                                        fundamentalData,
+      double debtToCapital = FinancialAnalysisFunctions::
+        calcDebtToCapitalizationRatio(  fundamentalData,
                                         dateSet,
-                                        timePeriod.c_str(), 
-                                        taxRate,
-                                        appendTermRecord, 
-                                        emptyParentName,
+                                        timePeriod.c_str(),
+                                        debtInfo,
+                                        appendTermRecord,
                                         setNansToMissingValue,
-                                        termNames, 
-                                        termValues);
+                                        termRecord);
 
-        double returnOnCapitalDeployedLessCostOfCapital 
-          = returnOnCapitalDeployed - costOfCapitalMature;  
+      double ownersEarnings = FinancialAnalysisFunctions::
+        calcOwnersEarnings( metricGraph,
+                            appendTermRecord, 
+                            termRecord);  
 
-        termNames.push_back("returnOnCapitalDeployedLessCostOfCapital");
-        termValues.push_back(returnOnCapitalDeployedLessCostOfCapital);                                           
+      double residualCashFlow = std::nan("1");
 
-        double grossMargin = FinancialAnalysisFunctions::
-          calcGrossMargin(  fundamentalData,
-                            dateSet,
-                            timePeriod.c_str(),
-                            appendTermRecord,
-                            setNansToMissingValue,
-                            termNames,
-                            termValues);
+      if(trailingPastPeriods.size() > 0){
 
-        double operatingMargin = FinancialAnalysisFunctions::
-          calcOperatingMargin(  fundamentalData,
-                                dateSet,
-                                timePeriod.c_str(), 
+        residualCashFlow = FinancialAnalysisFunctions::
+          calcResidualCashFlow( metricGraph,
+                                costOfEquityAsAPercentage,
+                                trailingPastPeriods,
                                 appendTermRecord,
-                                setNansToMissingValue,
-                                termNames,
-                                termValues);          
-
-        double cashConversion = FinancialAnalysisFunctions::
-          calcCashConversionRatio(  fundamentalData,
-                                    dateSet,
-                                    timePeriod.c_str(), 
-                                    taxRate,
-                                    appendTermRecord,
-                                    setNansToMissingValue,
-                                    termNames,
-                                    termValues);
-
-        double debtToCapital = FinancialAnalysisFunctions::
-          calcDebtToCapitalizationRatio(  fundamentalData,
-                                          dateSet,
-                                          timePeriod.c_str(),
-                                          debtInfo,
-                                          appendTermRecord,
-                                          setNansToMissingValue,
-                                          termNames,
-                                          termValues);
+                                termRecord);
+      }
+      //
+      //Residual cash flow to enterprise value
+      //
 
-        double ownersEarnings = FinancialAnalysisFunctions::
-          calcOwnersEarnings( fundamentalData, 
-                              dateSet, 
-                              previousDateSet,
+      double enterpriseValue = FinancialAnalysisFunctions::
+          calcEnterpriseValue(fundamentalData, 
+                              marketCapitalization, 
+                              dateSet,
                               timePeriod.c_str(),
-                              appendTermRecord, 
+                              debtInfo,
+                              appendTermRecord,                                
+                              emptyParentName,
                               setNansToMissingValue,
-                              termNames, 
-                              termValues);  
+                              termRecord);
 
-        double residualCashFlow = std::nan("1");
-
-        if(trailingPastPeriods.size() > 0){
-
-          residualCashFlow = FinancialAnalysisFunctions::
-            calcResidualCashFlow( fundamentalData,
-                                  dateSet,
-                                  timePeriod.c_str(),
-                                  costOfEquityAsAPercentage,
-                                  trailingPastPeriods,
-                                  appendTermRecord,
-                                  setNansToMissingValue,
-                                  termNames,
-                                  termValues);
-        }
-        //
-        //Residual cash flow to enterprise value
-        //
+      double residualCashFlowToEnterpriseValue = 
+        residualCashFlow/enterpriseValue;
 
-        double enterpriseValue = FinancialAnalysisFunctions::
-            calcEnterpriseValue(fundamentalData, 
-                                marketCapitalization, 
-                                dateSet,
-                                timePeriod.c_str(),
-                                debtInfo,
-                                appendTermRecord,                                
-                                emptyParentName,
-                                setNansToMissingValue,
-                                termNames,
-                                termValues);
-
-        double residualCashFlowToEnterpriseValue = 
-          residualCashFlow/enterpriseValue;
-
-        if(   !JsonFunctions::isJsonFloatValid(residualCashFlow) 
-           || !JsonFunctions::isJsonFloatValid(enterpriseValue)){
-          if(setNansToMissingValue){
-            residualCashFlowToEnterpriseValue = JsonFunctions::MISSING_VALUE;
-          }else{
-            residualCashFlowToEnterpriseValue = std::nan("1");
-          }
+      if(   !JsonFunctions::isJsonFloatValid(residualCashFlow) 
+         || !JsonFunctions::isJsonFloatValid(enterpriseValue)){
+        if(setNansToMissingValue){
+          residualCashFlowToEnterpriseValue = JsonFunctions::MISSING_VALUE;
+        }else{
+          residualCashFlowToEnterpriseValue = std::nan("1");
         }
+      }
 
-        if(appendTermRecord){
-          termNames.push_back("residualCashFlowToEnterpriseValue");
-          termValues.push_back(residualCashFlowToEnterpriseValue);
-        }        
+      if(appendTermRecord){
+        termRecord.appendName("residualCashFlowToEnterpriseValue");
+        termRecord.appendValue(residualCashFlowToEnterpriseValue);
+      }        
 
-        //
-        // The definition of EODs operatingIncome matches the definition of
-        // operatingEarnings in the book  'The Acquirer's Multiple' by 
-        // Tobias E. Carlisle
-        //
-        double operatingIncome = 
-          FinancialAnalysisFunctions::sumFundamentalDataOverDates(
-            fundamentalData,FIN,IS,timePeriod.c_str(),dateSet,
-            "operatingIncome", setNansToMissingValue);        
-        /*
-        double operatingEarnings = 
-          FinancialAnalysisFunctions::calcOperatingEarnings(
-                                        fundamentalData, 
-                                        dateSet, 
-                                        timePeriod.c_str(),
-                                        appendTermRecord,
-                                        setNansToMissingValue,
-                                        termNames, 
-                                        termValues);
-        */          
-
-        double acquirersMultiple = enterpriseValue/operatingIncome;
-        if(appendTermRecord){
-          termNames.push_back("acquirersMultiple_operatingIncome");
-          termNames.push_back("acquirersMultiple_enterpriseValue");
-          termNames.push_back("acquirersMultiple");
-
-          termValues.push_back(operatingIncome);
-          termValues.push_back(enterpriseValue);
-          termValues.push_back(acquirersMultiple);
-        }
+      //
+      // The definition of EODs operatingIncome matches the definition of
+      // operatingEarnings in the book  'The Acquirer's Multiple' by 
+      // Tobias E. Carlisle
+      //
+      double operatingIncome = 
+        FinancialAnalysisFunctions::getMetric(metricGraph,
+          FinancialAnalysisFunctions::METRIC_OPERATING_INCOME);
+      /*
+      double operatingEarnings = 
+        FinancialAnalysisFunctions::calcOperatingEarnings(
+                                      fundamentalData, 
+                                      dateSet, 
+                                      timePeriod.c_str(),
+                                      appendTermRecord,
+                                      setNansToMissingValue,
+                                      termRecord);
+      */          
+
+      double acquirersMultiple = enterpriseValue/operatingIncome;
+      if(appendTermRecord){
+        termRecord.appendName("acquirersMultiple_operatingIncome");
+        termRecord.appendName("acquirersMultiple_enterpriseValue");
+        termRecord.appendName("acquirersMultiple");
+
+        termRecord.appendValue(operatingIncome);
+        termRecord.appendValue(enterpriseValue);
+        termRecord.appendValue(acquirersMultiple);
+      }
 
 
 
-        double freeCashFlowToEquity=std::nan("1");
-        if(previousTimePeriod.length()>0){
-          freeCashFlowToEquity = FinancialAnalysisFunctions::
-            calcFreeCashFlowToEquity(fundamentalData, 
-                                     dateSet,
-                                     previousDateSet,
-                                     timePeriod.c_str(),
-                                     debtInfo,
-                                     previousDebtInfo,
-                                     appendTermRecord,
-                                     setNansToMissingValue,
-                                     termNames,
-                                     termValues);
-        }
+      double freeCashFlowToEquity=std::nan("1");
+      if(previousTimePeriod.length()>0){
+        freeCashFlowToEquity = FinancialAnalysisFunctions::
+          calcFreeCashFlowToEquity(metricGraph,
+                                   debtInfo,
+                                   previousDebtInfo,
+                                   appendTermRecord,
+                                   termRecord);
+      }
 
-        double freeCashFlowToFirm=std::nan("1");
-        freeCashFlowToFirm = FinancialAnalysisFunctions::
-          calcFreeCashFlowToFirm(fundamentalData, 
-                                 dateSet, 
-                                 previousDateSet, 
-                                 timePeriod.c_str(),
-                                 taxRate,
-                                 appendTermRecord,
-                                 setNansToMissingValue,
-                                 termNames, 
-                                 termValues);
-
-
-        double retentionRatio = FinancialAnalysisFunctions::
-            calcRetentionRatio(  fundamentalData, 
-                                 dateSet, 
-                                 timePeriod.c_str(),
-                                 appendTermRecord,
-                                 emptyParentName,
-                                 setNansToMissingValue,
-                                 termNames, 
-                                 termValues);
-        
-        double returnOnEquity = FinancialAnalysisFunctions::
-            calcReturnOnEquity(
-                                fundamentalData, 
-                                dateSet, 
-                                timePeriod.c_str(),
-                                appendTermRecord,
-                                emptyParentName,
-                                setNansToMissingValue,
-                                termNames, 
-                                termValues);
+      double freeCashFlowToFirm=std::nan("1");
+      freeCashFlowToFirm = FinancialAnalysisFunctions::
+        calcFreeCashFlowToFirm(metricGraph,
+                               taxRate,
+                               appendTermRecord,
+                               termRecord);
+
+
+      double retentionRatio = FinancialAnalysisFunctions::
+          calcRetentionRatio(  fundamentalData, 
+                               dateSet, 
+                               timePeriod.c_str(),
+                               appendTermRecord,
+                               emptyParentName,
+                               setNansToMissingValue,
+                               termRecord);
+      
+      double returnOnEquity = FinancialAnalysisFunctions::
+          calcReturnOnEquity(
+                              fundamentalData, 
+                              dateSet, 
+                              timePeriod.c_str(),
+                              appendTermRecord,
+                              emptyParentName,
+                              setNansToMissingValue,
+                              termRecord);
 
-        double returnOnEquityLessCostOfCapital 
-          = returnOnEquity - costOfCapitalMature;  
+      double returnOnEquityLessCostOfCapital 
+        = returnOnEquity - costOfCapitalMature;  
 
-        termNames.push_back("returnOnEquityLessCostOfCapital");
-        termValues.push_back(returnOnEquityLessCostOfCapital);  
+      termRecord.appendName("returnOnEquityLessCostOfCapital");
+      termRecord.appendValue(returnOnEquityLessCostOfCapital);  
 
-        double netIncomeGrowth = retentionRatio*returnOnEquity;                                
+      double netIncomeGrowth = retentionRatio*returnOnEquity;                                
 
-        if(appendTermRecord){
-          termNames.push_back("netIncomeGrowth");
-          termValues.push_back(netIncomeGrowth);
-        }
+      if(appendTermRecord){
+        termRecord.appendName("netIncomeGrowth");
+        termRecord.appendValue(netIncomeGrowth);
+      }
 
-        //
-        // Discounted Cashflow Valuation (using finanical inputs)
-        //
+      //
+      // Discounted Cashflow Valuation (using finanical inputs)
+      //
 
-        
-        double returnOnInvestedCapitalFinanical 
-                = FinancialAnalysisFunctions::
-                          calcReturnOnInvestedFinancialCapital(
-                            fundamentalData,
-                            dateSet,
-                            timePeriod.c_str(),
-                            taxRate,
-                            debtInfo,
-                            appendTermRecord, 
-                            emptyParentName,
-                            setNansToMissingValue,
-                            termNames, 
-                            termValues);
+      
+      double returnOnInvestedCapitalFinanical 
+              = FinancialAnalysisFunctions::
+                        calcReturnOnInvestedFinancialCapital(
+                          fundamentalData,
+                          dateSet,
+                          timePeriod.c_str(),
+                          taxRate,
+                          debtInfo,
+                          appendTermRecord, 
+                          emptyParentName,
+                          setNansToMissingValue,
+                          termRecord);
 
-        double roicFinLessCostOfCapital = 
-                returnOnInvestedCapitalFinanical 
-                - costOfCapitalMature;  
-        termNames.push_back("returnOnInvestedFinancialCapitalLessCostOfCapital");
-        termValues.push_back(roicFinLessCostOfCapital);                                    
+      double roicFinLessCostOfCapital = 
+              returnOnInvestedCapitalFinanical 
+              - costOfCapitalMature;  
+      termRecord.appendName("returnOnInvestedFinancialCapitalLessCostOfCapital");
+      termRecord.appendValue(roicFinLessCostOfCapital);                                    
 
-                                 
+                               
 
-        
-        double reinvestmentRate = 
-                FinancialAnalysisFunctions::
-                      calcReinvestmentRate( fundamentalData,
-                                            dateSet,
-                                            previousDateSet,
-                                            timePeriod.c_str(),
-                                            taxRate,
-                                            appendTermRecord,
-                                            emptyParentName,
-                                            setNansToMissingValue,
-                                            termNames,
-                                            termValues);
-
-        double organicGrowth=0.;
-
-        double afterTaxOperatingIncomeGrowth 
-          = reinvestmentRate*returnOnCapitalDeployed + organicGrowth;
-
-        termNames.push_back("afterTaxOperatingIncomeGrowth");
-        termValues.push_back(afterTaxOperatingIncomeGrowth); 
-
-
-
-        //William Price's shareholder yield
-        parentName = "";
-        double shareHolderYield =  
-                FinancialAnalysisFunctions::
-                  calcShareholderYield( fundamentalData, 
-                                        historicalData,
-                                        dateSet,
-                                        previousDateSet,
-                                        timePeriod.c_str(), 
-                                        timePeriodOS.c_str(),
-                                        debtInfo,
-                                        previousDebtInfo,
-                                        costOfCapital,
-                                        appendTermRecord,                                      
-                                        parentName,
-                                        setNansToMissingValue,
-                                        termNames,
-                                        termValues);
+      
+      double reinvestmentRate = 
+              FinancialAnalysisFunctions::
+                    calcReinvestmentRate( metricGraph,
+                                          taxRate,
+                                          appendTermRecord,
+                                          emptyParentName,
+                                          termRecord);
 
+      double organicGrowth=0.;
 
-        //Valuation metrics
-        if(indexDate ==0 ){
+      double afterTaxOperatingIncomeGrowth 
+        = reinvestmentRate*returnOnCapitalDeployed + organicGrowth;
 
-          double ebitda = 
-            JsonFunctions::getJsonFloat(fundamentalData["Valuation"]["EBITDA"]);
+      termRecord.appendName("afterTaxOperatingIncomeGrowth");
+      termRecord.appendValue(afterTaxOperatingIncomeGrowth); 
 
-          if(!JsonFunctions::isJsonFloatValid(ebitda) 
-             || std::abs(ebitda) < 1e-3){
-            ebitda = FinancialAnalysisFunctions::sumFundamentalDataOverDates(
-                        fundamentalData,FIN,IS,timePeriod.c_str(),dateSet,
-                        "ebitda", setNansToMissingValue); 
-          }
 
-          double freeCashFlow = 
-            FinancialAnalysisFunctions::sumFundamentalDataOverDates(
-              fundamentalData,FIN,CF,timePeriod.c_str(),dateSet,
-              "freeCashFlow", setNansToMissingValue); 
 
-          valuationMetricSummary.marketCapitalization=marketCapitalization;
-          valuationMetricSummary.enterpriseValue    = enterpriseValue;
-          valuationMetricSummary.freeCashFlow       = freeCashFlow;
-          valuationMetricSummary.ebitda             = ebitda;
-          valuationMetricSummary.operatingIncome    = operatingIncome;
-          valuationMetricSummary.acquirersMultiple  = acquirersMultiple;
-          valuationMetricSummary.residualCashFlow   = residualCashFlow;
+      //William Price's shareholder yield
+      parentName = "";
+      double shareHolderYield =  
+              FinancialAnalysisFunctions::
+                calcShareholderYield( metricGraph,
+                                      debtInfo,
+                                      previousDebtInfo,
+                                      costOfCapital,
+                                      appendTermRecord,                                      
+                                      parentName,
+                                      termRecord);
+
+
+      //Valuation metrics
+      if(indexDate ==0 ){
+
+        double ebitda = 
+          JsonFunctions::getJsonFloat(fundamentalData["Valuation"]["EBITDA"]);
+
+        if(!JsonFunctions::isJsonFloatValid(ebitda) 
+           || std::abs(ebitda) < 1e-3){
+          ebitda = FinancialAnalysisFunctions::sumFundamentalDataOverDates(
+                      fundamentalData,FIN,IS,timePeriod.c_str(),dateSet,
+                      "ebitda", setNansToMissingValue); 
+        }
 
-          valuationMetricSummary.enterpriseValueEOD = 
-            JsonFunctions::getJsonFloat(fundamentalData["Valuation"]["EnterpriseValue"]);
+        double freeCashFlow = 
+          FinancialAnalysisFunctions::getMetric(metricGraph,
+            FinancialAnalysisFunctions::METRIC_FREE_CASH_FLOW_EOD);
 
-          valuationMetricSummary.enterpriseValueEbitdaEOD = 
-            JsonFunctions::getJsonFloat(fundamentalData["Valuation"]["EnterpriseValueEbitda"]);
-          
-          if(!JsonFunctions::isJsonFloatValid(valuationMetricSummary.enterpriseValueEbitdaEOD)
-            || std::abs(valuationMetricSummary.enterpriseValueEbitdaEOD) < 1e-3){
-            valuationMetricSummary.enterpriseValueEbitdaEOD=
-              valuationMetricSummary.enterpriseValueEOD/valuationMetricSummary.ebitda;
-          }
+        valuationMetricSummary.marketCapitalization=marketCapitalization;
+        valuationMetricSummary.enterpriseValue    = enterpriseValue;
+        valuationMetricSummary.freeCashFlow       = freeCashFlow;
+        valuationMetricSummary.ebitda             = ebitda;
+        valuationMetricSummary.operatingIncome    = operatingIncome;
+        valuationMetricSummary.acquirersMultiple  = acquirersMultiple;
+        valuationMetricSummary.residualCashFlow   = residualCashFlow;
 
-          valuationMetricSummary.acquirersMultipleEOD = 
-              valuationMetricSummary.enterpriseValueEOD
-              /valuationMetricSummary.operatingIncome;
+        valuationMetricSummary.enterpriseValueEOD = 
+          JsonFunctions::getJsonFloat(fundamentalData["Valuation"]["EnterpriseValue"]);
 
-          bool success=NumericalFunctions::evaluateRecentValuationMetrics(
-                                              fundamentalData,
-                                              historicalData,
-                                              valuationMetricSummary);
-          
+        valuationMetricSummary.enterpriseValueEbitdaEOD = 
+          JsonFunctions::getJsonFloat(fundamentalData["Valuation"]["EnterpriseValueEbitda"]);
+        
+        if(!JsonFunctions::isJsonFloatValid(valuationMetricSummary.enterpriseValueEbitdaEOD)
+          || std::abs(valuationMetricSummary.enterpriseValueEbitdaEOD) < 1e-3){
+          valuationMetricSummary.enterpriseValueEbitdaEOD=
+            valuationMetricSummary.enterpriseValueEOD/valuationMetricSummary.ebitda;
         }
 
-        parentName="priceToValue_";
-
+        valuationMetricSummary.acquirersMultipleEOD = 
+            valuationMetricSummary.enterpriseValueEOD
+            /valuationMetricSummary.operatingIncome;
+
+        bool success=NumericalFunctions::evaluateRecentValuationMetrics(
+                                            fundamentalData,
+                                            historicalData,
+                                            valuationMetricSummary);
+        
+      }
+
+      datePhaseTimer.next("date_dcf");
+      if(evaluateDcf){
+        parentName="priceToValue_";
+
 
         //Valuation (discounted cash flow)
         double priceToValue = FinancialAnalysisFunctions::
@@ -3446,10 +3961,9 @@ int main (int argc, char* argv[]) {
               appendTermRecord,
               setNansToMissingValue,
               parentName,
-              termNames,
-              termValues);
+              termRecord);
 
-              
+            
 
         if(indexDate == 0){
           //recentPriceToValue;
@@ -3467,156 +3981,192 @@ int main (int argc, char* argv[]) {
           if(success){
             recentPriceToValue.push_back(pvUpd);
           }
-        }
 
-        //
-        // Empirical - recent average 
-        //
+          //The sensitivity of the valuation to its assumptions
+          FinancialAnalysisFunctions::DiscountedCashFlowScenarios scenarios;
+          FinancialAnalysisFunctions::createDiscountedCashFlowScenarioGrid(
+            costOfCapital,
+            costOfCapitalMature,
+            afterTaxOperatingIncomeGrowth,
+            riskFreeRate,
+            cc.dcf_scenario_cost_of_capital_offsets,
+            cc.dcf_scenario_growth_offsets,
+            cc.dcf_scenario_years_of_growth,
+            cc.dcf_scenario_terminal_growth_offsets,
+            scenarios);
+
+          FinancialAnalysisFunctions::
+            calcPriceToValueSurfaceUsingDamodaranDiscountedCashflowModel(
+              fundamentalData,
+              dateSet,
+              timePeriod.c_str(),
+              debtInfo,
+              taxRate,
+              reinvestmentRate,
+              returnOnCapitalDeployed,
+              marketCapitalization,
+              setNansToMissingValue,
+              scenarios);
+
+          priceToValueSurfaceJson = 
+            convertPriceToValueSurfaceToJson(date,
+                                             scenarios,
+                                             costOfCapital,
+                                             afterTaxOperatingIncomeGrowth,
+                                             riskFreeRate,
+                                             cc);
+        }
+      }
 
-        if(empiricalGrowthData.dates.size() > 0){
-          size_t indexGrowth = 
-          NumericalFunctions::getIndexOfEmpiricalGrowthDataSet(
-                                dateDouble,
-                                maxDateErrorInYearsInEmpiricalData,
-                                empiricalGrowthData);
+      //
+      // Empirical - recent average 
+      //
 
-          if(appendTermRecord 
-            && indexGrowth < empiricalGrowthData.datesNumerical.size()){
-            std::string nameToPrepend("atoiEmpirical_");
-
-            NumericalFunctions::appendEmpiricalAfterTaxOperatingIncomeGrowthDataSet(
-                  indexGrowth,      
-                  empiricalGrowthData,
-                  dateDouble,
-                  costOfCapitalMature,
-                  nameToPrepend,
-                  termNames,
-                  termValues);
-          }
+      if(empiricalGrowthData.dates.size() > 0){
+        size_t indexGrowth = 
+        NumericalFunctions::getIndexOfEmpiricalGrowthDataSet(
+                              dateDouble,
+                              maxDateErrorInYearsInEmpiricalData,
+                              empiricalGrowthData);
+
+        if(appendTermRecord 
+          && indexGrowth < empiricalGrowthData.datesNumerical.size()){
+          std::string nameToPrepend("atoiEmpirical_");
+
+          NumericalFunctions::appendEmpiricalAfterTaxOperatingIncomeGrowthDataSet(
+                indexGrowth,      
+                empiricalGrowthData,
+                dateDouble,
+                costOfCapitalMature,
+                nameToPrepend,
+                termRecord);
+        }
 
 
-          if(indexGrowth < empiricalGrowthData.datesNumerical.size()){
-            parentName="priceToValueEmpirical_";
+        if(evaluateDcfEmpirical
+            && indexGrowth < empiricalGrowthData.datesNumerical.size()){
+          parentName="priceToValueEmpirical_";
 
 
-            //Valuation (discounted cash flow) using empirical growth
-            double priceToValueEmpirical = 
-            FinancialAnalysisFunctions::
-                calcPriceToValueUsingDamodaranDiscountedCashflowModel(  
-                  fundamentalData,
-                  dateSet,
-                  timePeriod.c_str(),
-                  debtInfo,
-                  riskFreeRate,
-                  costOfCapital,
-                  costOfCapitalMature,
-                  taxRate,
-                  empiricalGrowthData.afterTaxOperatingIncomeGrowth[indexGrowth],
-                  empiricalGrowthData.reinvestmentRate[indexGrowth],
-                  empiricalGrowthData.returnOnCapitalDeployed[indexGrowth],
-                  empiricalGrowthData.organicGrowth[indexGrowth],
-                  marketCapitalization,
-                  cc.number_of_years_of_growth,
-                  appendTermRecord,
-                  setNansToMissingValue,
-                  parentName,
-                  termNames,
-                  termValues);
-
-            if(indexDate == 0){
-              //recentPriceToValue;
-              DataStructures::RecentPriceToValue pvUpd;
-              std::string fieldName = parentName.substr(0,parentName.size()-1);
-              bool success = NumericalFunctions::evaluateRecentPriceToValue(
-                                    fundamentalData,
-                                    historicalData,
-                                    adjustedClosePrice,
-                                    outstandingShares,
-                                    priceToValueEmpirical,
-                                    fieldName,
-                                    pvUpd);
-              if(success){
-                recentPriceToValue.push_back(pvUpd);
-              }
+          //Valuation (discounted cash flow) using empirical growth
+          double priceToValueEmpirical = 
+          FinancialAnalysisFunctions::
+              calcPriceToValueUsingDamodaranDiscountedCashflowModel(  
+                fundamentalData,
+                dateSet,
+                timePeriod.c_str(),
+                debtInfo,
+                riskFreeRate,
+                costOfCapital,
+                costOfCapitalMature,
+                taxRate,
+                empiricalGrowthData.afterTaxOperatingIncomeGrowth[indexGrowth],
+                empiricalGrowthData.reinvestmentRate[indexGrowth],
+                empiricalGrowthData.returnOnCapitalDeployed[indexGrowth],
+                empiricalGrowthData.organicGrowth[indexGrowth],
+                marketCapitalization,
+                cc.number_of_years_of_growth,
+                appendTermRecord,
+                setNansToMissingValue,
+                parentName,
+                termRecord);
+
+          if(indexDate == 0){
+            //recentPriceToValue;
+            DataStructures::RecentPriceToValue pvUpd;
+            std::string fieldName = parentName.substr(0,parentName.size()-1);
+            bool success = NumericalFunctions::evaluateRecentPriceToValue(
+                                  fundamentalData,
+                                  historicalData,
+                                  adjustedClosePrice,
+                                  outstandingShares,
+                                  priceToValueEmpirical,
+                                  fieldName,
+                                  pvUpd);
+            if(success){
+              recentPriceToValue.push_back(pvUpd);
             }
-
           }
+
         }
+      }
 
 
-        //
-        // Empirical - average all time years
-        //
-        if(empiricalGrowthDataAll.dates.size() == 1){   
+      //
+      // Empirical - average all time years
+      //
+      if(empiricalGrowthDataAll.dates.size() == 1){   
 
-          if(appendTermRecord 
-              && empiricalGrowthDataAll.datesNumerical.size()==1){
-            std::string nameToPrepend("atoiEmpiricalAvg_");
+        if(appendTermRecord 
+            && empiricalGrowthDataAll.datesNumerical.size()==1){
+          std::string nameToPrepend("atoiEmpiricalAvg_");
 
-            NumericalFunctions::appendEmpiricalAfterTaxOperatingIncomeGrowthDataSet(
-                                  0,      
-                                  empiricalGrowthDataAll,
-                                  dateDouble,
-                                  costOfCapitalMature,
-                                  nameToPrepend,
-                                  termNames,
-                                  termValues);
-          }
+          NumericalFunctions::appendEmpiricalAfterTaxOperatingIncomeGrowthDataSet(
+                                0,      
+                                empiricalGrowthDataAll,
+                                dateDouble,
+                                costOfCapitalMature,
+                                nameToPrepend,
+                                termRecord);
+        }
 
-          if(empiricalGrowthDataAll.datesNumerical.size()==1){
-            double roicEmpAvg = 
-              empiricalGrowthDataAll.afterTaxOperatingIncomeGrowth[0]
-              /empiricalGrowthDataAll.reinvestmentRate[0];
+        if(evaluateDcfEmpirical 
+            && empiricalGrowthDataAll.datesNumerical.size()==1){
+          double roicEmpAvg = 
+            empiricalGrowthDataAll.afterTaxOperatingIncomeGrowth[0]
+            /empiricalGrowthDataAll.reinvestmentRate[0];
 
-            parentName="priceToValueEmpiricalAvg_";
+          parentName="priceToValueEmpiricalAvg_";
 
-            //Valuation (discounted cash flow) using empirical growth
-            double priceToValueEmpiricalAvg = 
-              FinancialAnalysisFunctions::
-                calcPriceToValueUsingDamodaranDiscountedCashflowModel(  
-                  fundamentalData,
-                  dateSet,
-                  timePeriod.c_str(),
-                  debtInfo,
-                  riskFreeRate,
-                  costOfCapital,
-                  costOfCapitalMature,
-                  taxRate,
-                  empiricalGrowthDataAll.afterTaxOperatingIncomeGrowth[0],
-                  empiricalGrowthDataAll.reinvestmentRate[0],
-                  empiricalGrowthDataAll.returnOnCapitalDeployed[0],                
-                  empiricalGrowthDataAll.organicGrowth[0],
-                  marketCapitalization,   
-                  cc.number_of_years_of_growth,
-                  appendTermRecord,
-                  setNansToMissingValue,
-                  parentName,
-                  termNames,
-                  termValues);
-
-            if(indexDate == 0){
-              //recentPriceToValue;
-              DataStructures::RecentPriceToValue pvUpd;
-              std::string fieldName = parentName.substr(0,parentName.size()-1);
-              bool success = NumericalFunctions::evaluateRecentPriceToValue(
-                                    fundamentalData,
-                                    historicalData,
-                                    adjustedClosePrice,
-                                    outstandingShares,
-                                    priceToValueEmpiricalAvg,
-                                    fieldName,
-                                    pvUpd);
-              if(success){
-                recentPriceToValue.push_back(pvUpd);
-              }
-            }                  
-          }
+          //Valuation (discounted cash flow) using empirical growth
+          double priceToValueEmpiricalAvg = 
+            FinancialAnalysisFunctions::
+              calcPriceToValueUsingDamodaranDiscountedCashflowModel(  
+                fundamentalData,
+                dateSet,
+                timePeriod.c_str(),
+                debtInfo,
+                riskFreeRate,
+                costOfCapital,
+                costOfCapitalMature,
+                taxRate,
+                empiricalGrowthDataAll.afterTaxOperatingIncomeGrowth[0],
+                empiricalGrowthDataAll.reinvestmentRate[0],
+                empiricalGrowthDataAll.returnOnCapitalDeployed[0],                
+                empiricalGrowthDataAll.organicGrowth[0],
+                marketCapitalization,   
+                cc.number_of_years_of_growth,
+                appendTermRecord,
+                setNansToMissingValue,
+                parentName,
+                termRecord);
+
+          if(indexDate == 0){
+            //recentPriceToValue;
+            DataStructures::RecentPriceToValue pvUpd;
+            std::string fieldName = parentName.substr(0,parentName.size()-1);
+            bool success = NumericalFunctions::evaluateRecentPriceToValue(
+                                  fundamentalData,
+                                  historicalData,
+                                  adjustedClosePrice,
+                                  outstandingShares,
+                                  priceToValueEmpiricalAvg,
+                                  fieldName,
+                                  pvUpd);
+            if(success){
+              recentPriceToValue.push_back(pvUpd);
+            }
+          }                  
         }
+      }
+
+      datePhaseTimer.next("date_eps_valuation");
 
-        //
-        // Price-to-Value using EPS and EPS growth
-        //
-        std::vector< DataStructures::PriceToValueSummary > pvSummary;
+      //
+      // Price-to-Value using EPS and EPS growth
+      //
+      std::vector< DataStructures::PriceToValueSummary > pvSummary;
+      if(evaluateEpsValuation){
         parentName="priceToValueEpsGrowth_";
         NumericalFunctions::
           calcPriceToValueUsingEarningsPerShareGrowth(
@@ -3629,8 +4179,7 @@ int main (int argc, char* argv[]) {
             appendTermRecord,
             setNansToMissingValue,
             parentName,
-            termNames,
-            termValues,
+            termRecord,
             pvSummary);  
 
         if(indexDate == 0){
@@ -3650,12 +4199,16 @@ int main (int argc, char* argv[]) {
             }
           }
         }
-          
-        //
-        // Price-to-Value using free-cash-flow per share and
-        // free-cash-flow yield 
-        //
+      }
+
+      datePhaseTimer.next("date_fcf_valuation");
+
+      //
+      // Price-to-Value using free-cash-flow per share and
+      // free-cash-flow yield 
+      //
 
+      if(evaluateFcfValuation){
         parentName="priceToValueRevenueToFcf_";
         NumericalFunctions::
           calcPriceToValueUsingDiscountedFreeCashFlow(
@@ -3668,10 +4221,9 @@ int main (int argc, char* argv[]) {
             appendTermRecord,
             setNansToMissingValue,
             parentName,
-            termNames,
-            termValues,
+            termRecord,
             pvSummary);  
-            
+          
         if(indexDate == 0){
           //recentPriceToValue;
           for(size_t idxPV=0; idxPV < pvSummary.size();++idxPV){
@@ -3690,7 +4242,7 @@ int main (int argc, char* argv[]) {
           }
         }
 
-        
+      
         parentName="priceToValueRevenueToFcfAvg_";
         NumericalFunctions::
           calcPriceToValueUsingDiscountedFreeCashFlow(
@@ -3703,10 +4255,9 @@ int main (int argc, char* argv[]) {
             appendTermRecord,
             setNansToMissingValue,
             parentName,
-            termNames,
-            termValues, 
+            termRecord, 
             pvSummary);
-        
+      
         if(indexDate == 0){
           //The average contains the same value 4 times over
           DataStructures::RecentPriceToValue pvUpd;
@@ -3722,581 +4273,2487 @@ int main (int argc, char* argv[]) {
             recentPriceToValue.push_back(pvUpd);
           }
         }
+      }
+
+      datePhaseTimer.next("date_growth_records");
+
+      //
+      // Equity growth
+      //
+      NumericalFunctions::appendMetricGrowthDataSet(
+            dateDouble,              
+            equityGrowthModel,
+            std::string("equityEmpiricalModel_"),
+            maxDateErrorInYearsInEmpiricalData,
+            termRecord);
+
+      NumericalFunctions::appendMetricGrowthDataSetRecentDate(
+            equityGrowthModelAvg,
+            std::string("equityEmpiricalModelAvg_"),
+            maxDateErrorInYearsInEmpiricalData,
+            termRecord);
+
+      //
+      // Earnings per share growth
+      //
+      NumericalFunctions::appendMetricGrowthDataSet(
+            dateDouble,              
+            epsGrowthModel,
+            std::string("epsEmpiricalModel_"),
+            maxDateErrorInYearsInEmpiricalData,
+            termRecord);
+
+      NumericalFunctions::appendMetricGrowthDataSetRecentDate(
+            epsGrowthModelAvg,
+            std::string("epsEmpiricalModelAvg_"),
+            maxDateErrorInYearsInEmpiricalData,
+            termRecord);              
+
+      //
+      // Gross profit growth
+      //
+      NumericalFunctions::appendMetricGrowthDataSet(
+            dateDouble,              
+            grossProfitGrowthModel,
+            std::string("grossProfitEmpiricalModel_"),
+            maxDateErrorInYearsInEmpiricalData,
+            termRecord);
+
+      NumericalFunctions::appendMetricGrowthDataSetRecentDate(
+            grossProfitGrowthModelAvg,
+            std::string("grossProfitEmpiricalModelAvg_"),
+            maxDateErrorInYearsInEmpiricalData,
+            termRecord);
+      //
+      // Free cash flow
+      //
+      NumericalFunctions::appendMetricGrowthDataSet(
+            dateDouble,              
+            fcfGrowthModel,
+            std::string("fcfEmpiricalModel_"),
+            maxDateErrorInYearsInEmpiricalData,
+            termRecord);
+
+      NumericalFunctions::appendMetricGrowthDataSetRecentDate(
+            fcfGrowthModelAvg,
+            std::string("fcfEmpiricalModelAvg_"),
+            maxDateErrorInYearsInEmpiricalData,
+            termRecord);
+      //
+      // Sales
+      //
+      NumericalFunctions::appendMetricGrowthDataSet(
+            dateDouble,              
+            revenueGrowthModel,
+            std::string("revenueEmpiricalModel_"),
+            maxDateErrorInYearsInEmpiricalData,
+            termRecord);
+
+      NumericalFunctions::appendMetricGrowthDataSetRecentDate(
+            revenueGrowthModelAvg,
+            std::string("revenueEmpiricalModelAvg_"),
+            maxDateErrorInYearsInEmpiricalData,
+            termRecord);
+
+      //revenueGrowthModel
+      //revenueGrowthModelAvg              
+      //
+      //
+      //
+      nlohmann::ordered_json analysisEntry=nlohmann::ordered_json::object();
+      analysisEntry.push_back({"date", date});        
+      for(auto const &index : termRecord.order){
+        analysisEntry.push_back({std::string(termRecord.getName(index)),
+                                 termRecord.values[index]});
+      }
+
+      //
+      //annualMilestones
+      //
+      if(analysisDates.isAnnualReport[indexDate]){
+
+        double excessReturnOnInvestedCapital 
+          = returnOnCapitalDeployed-costOfCapital;
+
+        if((excessReturnOnInvestedCapital)>0){
+          ++annualMilestones.yearsOfPositiveValueCreation;
+        }
+      }
+
+
+      
+      if(settings.incremental){
+        currentState.dates[date]["hash"] = dateHash;
+        currentState.dates[date]["value_created"] = 
+          ((returnOnCapitalDeployed-costOfCapital) > 0);
+      }
+      
+      metricAnalysisJson[date]= analysisEntry;        
+      ++entryCount;
+    }
+
+    if(settings.incremental && verbose){
+      std::cout << "    Reused " << numberOfReusedRecords << " of " 
+                << entryCount << " records and " 
+                << currentState.modelCache.numberOfReusedFits << " of "
+                << ( currentState.modelCache.numberOfReusedFits
+                    +currentState.modelCache.numberOfNewFits)
+                << " model fits" << std::endl;
+    }
+
+    //
+    // Monte Carlo discounted free-cash-flow valuation
+    //
+    phaseTimer.next("monte_carlo");
+    nlohmann::ordered_json priceToValueDistributionJson;
+    if(evaluateMonteCarlo){
+      priceToValueDistributionJson = 
+        calcPriceToValueDistributionJson(metricAnalysisJson,
+                                         revenueGrowthModel,
+                                         revenueFcfModel,
+                                         fileName,
+                                         settings);
+    }
+
+    phaseTimer.next("liquidity");
+    nlohmann::ordered_json fundLiqudityMetricJson;
+    if(evaluateLiquidity){
+      FinancialAnalysisFunctions::
+        calcStockLiquidityRelativeToFundHoldings(
+          settings.cc.fund_liquidity_families,
+          referenceData.fundKeyWordMatcher,
+          fundamentalData,
+          historicalData,
+          setNansToMissingValue,
+          fundLiqudityMetricJson);
+    }
+
+    phaseTimer.next("report_assembly");
+    nlohmann::ordered_json dataDatesReport;
+    dataDatesReport["cash_flow"]         = analysisDates.recentCashFlowDate;
+    dataDatesReport["income_statement"]  = analysisDates.recentIncomeStatementDate;
+    dataDatesReport["balance_sheet"]     = analysisDates.recentBalanceSheetDate;
+    dataDatesReport["earnings"]          = analysisDates.recentEarningsHistoryDate;
+    dataDatesReport["outstanding_shares"]= analysisDates.recentOutstandingSharesDate;
+    dataDatesReport["historical_data"]   = analysisDates.recentHistoricalDate;
+    dataDatesReport["bond_rates_usa"]    = analysisDates.recentBondDate;    
+
+    dataDatesReport["default_spread_usa"]= referenceData.tables.defaultSpreadDate;
+    dataDatesReport["country_risk"]= referenceData.tables.countryRiskDate;
+    dataDatesReport["global_corporate_tax_rates_historical"]= "2023-12-31";
+
+
+    nlohmann::ordered_json stringDataReport;
+    stringDataReport["home_country"] = homeRiskTable.CountryISO3;
+    stringDataReport["firm_country"] = riskTable.CountryISO3;
+
+
+
+    nlohmann::ordered_json annualMilestoneReport;
+    annualMilestoneReport["years_since_IPO"] 
+      = annualMilestones.yearsSinceIPO;
+    annualMilestoneReport["years_reported"] 
+      = annualMilestones.yearsOnRecord;
+    annualMilestoneReport["years_value_created"] 
+      = annualMilestones.yearsOfPositiveValueCreation;
+    //The dividend milestones are only written if the dividends are evaluated
+    if(evaluateDividends){
+      annualMilestoneReport["years_with_dividend"] 
+        = dividendInfo.yearsWithADividend;
+      annualMilestoneReport["fraction_of_years_with_a_dividend"]
+        = dividendInfo.fractionOfYearsWithDividends;
+      annualMilestoneReport["fraction_of_years_with_a_dividend_increases"]
+        = dividendInfo.fractionOfYearsWithDividendIncreases;
+      annualMilestoneReport["mean_dividend_payout_ratio"]
+        = dividendInfo.meanDividendPayoutRatio;
+      annualMilestoneReport["mean_dividend_freecashflow_ratio"]
+        = dividendInfo.meanDividendFreeCashFlowRatio;
+      annualMilestoneReport["mean_dividend_yield"]
+        = dividendInfo.meanDividendYield;
+      if(dividendsYieldGrowthModelAvg.model.size()>=1){
+        annualMilestoneReport["mean_dividend_yield_growth"]
+          = dividendsYieldGrowthModelAvg.model[0].annualGrowthRateOfTrendline;
+      }else{
+        annualMilestoneReport["mean_dividend_yield_growth"]
+          = std::nan("1");
+      }
+      annualMilestoneReport["mean_freecashflow_yield"]
+        = dividendInfo.meanFreeCashFlowYield;
+      annualMilestoneReport["mean_freecashflow_less_dividend_yield"]
+        = dividendInfo.meanFreeCashFlowLessDividendsYield;
+    }
+
+      
+
+    //
+    // Recent valuation
+    //
+    nlohmann::ordered_json recentPriceToValueJson;
+
+    if(recentPriceToValue.size()>0){
+      recentPriceToValueJson["date"]
+        = recentPriceToValue[0].recentDate;
+      recentPriceToValueJson["price"] 
+        = recentPriceToValue[0].adjustedClosePrice;
+      recentPriceToValueJson["price_current"] 
+        = recentPriceToValue[0].recentAdjustedClosePrice;
+      recentPriceToValueJson["outstandingShares"] 
+        = recentPriceToValue[0].numberOfShares;
+      recentPriceToValueJson["outstandingShares_current"] 
+        = recentPriceToValue[0].recentNumberOfShares;
+      recentPriceToValueJson["marketCapitalization"] 
+        = recentPriceToValue[0].marketCapitalization;
+      recentPriceToValueJson["marketCapitalization_current"] 
+        = recentPriceToValue[0].recentMarketCapitalization;           
+      recentPriceToValueJson["scaleFactor"] 
+        = recentPriceToValue[0].scaleFactor;
+      recentPriceToValueJson["enterpriseValue"] 
+        = valuationMetricSummary.enterpriseValue;  
+      recentPriceToValueJson["enterpriseValue_current"] 
+        = valuationMetricSummary.enterpriseValueRecent;
+      recentPriceToValueJson["enterpriseValueEOD"] 
+        = valuationMetricSummary.enterpriseValueEOD;  
+      recentPriceToValueJson["enterpriseValueEOD_current"] 
+        = valuationMetricSummary.enterpriseValueEODRecent;  
+
+      recentPriceToValueJson["operatingIncome"] 
+        = valuationMetricSummary.operatingIncome;  
+      recentPriceToValueJson["ebitda"] 
+        = valuationMetricSummary.ebitda;  
+
+      recentPriceToValueJson["acquirersMultiple"] 
+        = valuationMetricSummary.acquirersMultiple;  
+      recentPriceToValueJson["acquirersMultiple_current"] 
+        = valuationMetricSummary.acquirersMultipleRecent;  
+
+      recentPriceToValueJson["acquirersMultipleEOD"] 
+        = valuationMetricSummary.acquirersMultipleEOD;  
+      recentPriceToValueJson["acquirersMultipleEOD_current"] 
+        = valuationMetricSummary.acquirersMultipleEODRecent;  
+
+      recentPriceToValueJson["enterpriseValueEbitdaEOD"] 
+        = valuationMetricSummary.enterpriseValueEbitdaEOD;  
+      recentPriceToValueJson["enterpriseValueEbitdaEOD_current"] 
+        = valuationMetricSummary.enterpriseValueEbitdaEODRecent;  
+
+      recentPriceToValueJson["acquirersMultipleAbs"] 
+        = std::abs(valuationMetricSummary.acquirersMultiple);  
+      recentPriceToValueJson["acquirersMultipleAbs_current"] 
+        = std::abs(valuationMetricSummary.acquirersMultipleRecent);  
+
+      recentPriceToValueJson["acquirersMultipleAbsEOD"] 
+        = std::abs(valuationMetricSummary.acquirersMultipleEOD);  
+      recentPriceToValueJson["acquirersMultipleAbsEOD_current"] 
+        = std::abs(valuationMetricSummary.acquirersMultipleEODRecent);  
+
+      recentPriceToValueJson["enterpriseValueEbitdaAbsEOD"] 
+        = std::abs(valuationMetricSummary.enterpriseValueEbitdaEOD);  
+      recentPriceToValueJson["enterpriseValueEbitdaAbsEOD_current"] 
+        = std::abs(valuationMetricSummary.enterpriseValueEbitdaEODRecent);  
+
+
+      //It can happen that the last date at which an FCF valuation method
+      //and an EPS method can be evaluated differs. In this case the
+      //scaleFactor will differ, and this isn't a problem. Each valuation 
+      //method just has its own set of reference dates and corresponding
+      //scaleFactors
+      /*
+      double scaleFactor = recentPriceToValue[0].scaleFactor;
+      for(size_t i=0; i< recentPriceToValue.size();++i){
+        if(std::abs(scaleFactor-recentPriceToValue[i].scaleFactor) > 1e-6){
+          std::cerr << "Error: Every current valuation calculation should "
+                    << "use the same scale factor: price_current/price, where"
+                    << "price is the price used in the valuation."
+                    << std::endl;
+          std::abort();
+        }
+      }
+      */
+
+      for(size_t i =0; i  < recentPriceToValue.size();++i){
+        std::string fieldName = recentPriceToValue[i].name;
+        recentPriceToValueJson[fieldName] 
+          = recentPriceToValue[i].priceToValue;
+
+        fieldName.append("_current");
+        recentPriceToValueJson[fieldName] 
+          = recentPriceToValue[i].recentPriceToValue;
+      }
+    }        
+    //
+    // dividend growth
+    //      
+    nlohmann::ordered_json dividendGrowthModelJson;
+    NumericalFunctions::appendMetricGrowthModelRecent(
+      dividendGrowthModelJson,
+      dividendsPaidGrowthModel,"");
+    
+    nlohmann::ordered_json dividendGrowthModelAvgJson;
+    if(dividendsPaidGrowthModelAvg.datesNumerical.size()>0){
+      NumericalFunctions::appendEmpiricalGrowthModelRecent(
+        dividendGrowthModelAvgJson,
+        dividendsPaidGrowthModelAvg.model[0],"");
+    }
+
+    //
+    // dividend yield growth
+    //      
+    nlohmann::ordered_json dividendYieldGrowthModelJson;
+    NumericalFunctions::appendMetricGrowthModelRecent(
+      dividendYieldGrowthModelJson,
+      dividendsYieldGrowthModel,"");
+    
+    nlohmann::ordered_json dividendYieldGrowthModelAvgJson;
+    if(dividendsYieldGrowthModelAvg.datesNumerical.size()>0){
+      NumericalFunctions::appendEmpiricalGrowthModelRecent(
+        dividendYieldGrowthModelAvgJson,
+        dividendsYieldGrowthModelAvg.model[0],"");
+    }
+
+    //
+    // growth of equity
+    //   equityGrowthModel   
+    //   equityGrowthModelAvg
+    //
+
+    nlohmann::ordered_json equityGrowthModelJson;
+    NumericalFunctions::appendMetricGrowthModelRecent(
+      equityGrowthModelJson,
+      equityGrowthModel,"");
+
+    nlohmann::ordered_json equityGrowthModelAvgJson;
+    if(equityGrowthModelAvg.datesNumerical.size() > 0){        
+      NumericalFunctions::appendEmpiricalGrowthModelRecent(
+          equityGrowthModelAvgJson,
+          equityGrowthModelAvg.model[0],"");
+    }
+
+    //
+    // growth of earnings per share
+    //    epsGrowthModel
+    //    epsGrowthModelAvg
+
+    nlohmann::ordered_json epsGrowthModelJson;
+    NumericalFunctions::appendMetricGrowthModelRecent(
+      epsGrowthModelJson,
+      epsGrowthModel,"");
+
+    nlohmann::ordered_json epsGrowthModelAvgJson;
+    if(epsGrowthModelAvg.datesNumerical.size() > 0){
+      NumericalFunctions::appendEmpiricalGrowthModelRecent(
+          epsGrowthModelAvgJson,
+          epsGrowthModelAvg.model[0],"");
+    }
+
+    //
+    // growth of gross profit
+    //    grossProfitGrowthModel
+    //    grossProfitGrowthModelAvg
+
+    nlohmann::ordered_json grossProfitGrowthModelJson;
+    NumericalFunctions::appendMetricGrowthModelRecent(
+      grossProfitGrowthModelJson,
+      grossProfitGrowthModel,"");
+
+    nlohmann::ordered_json grossProfitGrowthModelAvgJson;
+    if(grossProfitGrowthModelAvg.datesNumerical.size() > 0){
+      NumericalFunctions::appendEmpiricalGrowthModelRecent(
+          grossProfitGrowthModelAvgJson,
+          grossProfitGrowthModelAvg.model[0],"");
+    }
+
+
+    //
+    // growth of free cash flow
+    //    fcfGrowthModel 
+    //    fcfGrowthModelAvg
+
+    nlohmann::ordered_json fcfGrowthModelJson;
+    NumericalFunctions::appendMetricGrowthModelRecent(
+      fcfGrowthModelJson,
+      fcfGrowthModel,"");
+
+    nlohmann::ordered_json fcfGrowthModelAvgJson;
+    if(fcfGrowthModelAvg.datesNumerical.size() > 0){
+      NumericalFunctions::appendEmpiricalGrowthModelRecent(
+          fcfGrowthModelAvgJson,
+          fcfGrowthModelAvg.model[0],"");
+    }
+
+    //
+    // growth of revenue
+    //    revenueGrowthModel 
+    //    revenueGrowthModelAvg
+
+    nlohmann::ordered_json revenueGrowthModelJson;
+    NumericalFunctions::appendMetricGrowthModelRecent(
+      revenueGrowthModelJson,
+      revenueGrowthModel,"");
+
+    nlohmann::ordered_json revenueGrowthModelAvgJson;
+    if(revenueGrowthModelAvg.datesNumerical.size() > 0){
+      NumericalFunctions::appendEmpiricalGrowthModelRecent(
+          revenueGrowthModelAvgJson,
+          revenueGrowthModelAvg.model[0],"");
+    }      
+
+    //
+    // Avg empirical model
+    //
+
+    nlohmann::ordered_json atoiGrowthModelAverageJson;
+    if(empiricalGrowthDataAll.datesNumerical.size() > 0){
+      NumericalFunctions::appendEmpiricalGrowthModelRecent(
+          atoiGrowthModelAverageJson,
+          empiricalGrowthDataAll,"");
+    }
+
+    //
+    // Recent empirical data
+    //
+
+    nlohmann::ordered_json atoiGrowthModelRecentJson;      
+    if(empiricalGrowthData.datesNumerical.size()>0){
+      NumericalFunctions::appendEmpiricalGrowthModelRecent(
+          atoiGrowthModelRecentJson,
+          empiricalGrowthData,"");
+    }
+
+    //
+    // Append revenue to fcf model
+    //
+    //
+
+    nlohmann::ordered_json revenueFcfModelJson;
+    if(revenueFcfModel.dateModel.size()>0){
+      NumericalFunctions::appendEmpiricalGrowthModelRecent(
+        revenueFcfModelJson,
+        revenueFcfModel.model[0],"");
+    }
+
+    nlohmann::ordered_json revenueFcfModelAvgJson;
+    if(revenueFcfModelAvg.dateModel.size()>0){
+      NumericalFunctions::appendEmpiricalGrowthModelRecent(
+        revenueFcfModelAvgJson,
+        revenueFcfModelAvg.model[0],"");
+    }
+    //
+    // Pricing model
+    //
+          
+    //Downsample all outgoing data.
+    //Each year gets 12 data points + the last entry gets added
+    nlohmann::ordered_json priceGrowthModelJson;      
+    if(priceModel.x.size()>0){
+      DataStructures::EmpiricalGrowthModel priceModelDS;
+      int previousMonth=0;
+      double previousDate=0.;
+
+      //Copy over all the model meta-data
+      priceModelDS.modelType                   = priceModel.modelType                  ;  
+      priceModelDS.duration                    = priceModel.duration                   ;   
+      priceModelDS.annualGrowthRateOfTrendline = priceModel.annualGrowthRateOfTrendline;   
+      priceModelDS.r2                          = priceModel.r2                         ;   
+      priceModelDS.r2Trendline                 = priceModel.r2Trendline                ;  
+      priceModelDS.r2Cyclic                    = priceModel.r2Cyclic                   ;  
+      priceModelDS.validFitting                = priceModel.validFitting               ;     
+      priceModelDS.outlierCount                = priceModel.outlierCount               ; 
+      priceModelDS.parameters                  = priceModel.parameters                 ;   
+
+
+      for(size_t i=0; i<priceModel.x.size();++i){
+        int month = std::floor( (            priceModel.x[i]
+                                -std::floor(priceModel.x[i]))*12.0);
+        if(month != previousMonth){
+          priceModelDS.x.push_back(
+              priceModel.x[i]);
+          priceModelDS.y.push_back(
+              priceModel.y[i]);
+          priceModelDS.yTrendline.push_back(
+              priceModel.yTrendline[i]);
+          priceModelDS.yCyclic.push_back(
+              priceModel.yCyclic[i]);
+          priceModelDS.yCyclicData.push_back(
+              priceModel.yCyclicData[i]);
+          priceModelDS.yCyclicNorm.push_back(
+              priceModel.yCyclicNorm[i]);
+          priceModelDS.yCyclicNormData.push_back(
+              priceModel.yCyclicNormData[i]);
+          priceModelDS.yCyclicNormDataPercentiles.push_back(
+              priceModel.yCyclicNormDataPercentiles[i]);
+          previousDate = priceModel.x[i];
+        }  
+        previousMonth=month;                               
+      }
+
+      if(priceModel.x.back() !=  previousDate){
+          priceModelDS.x.push_back(
+              priceModel.x.back());
+          priceModelDS.y.push_back(
+              priceModel.y.back());
+          priceModelDS.yTrendline.push_back(
+              priceModel.yTrendline.back());
+          priceModelDS.yCyclic.push_back(
+              priceModel.yCyclic.back());    
+          priceModelDS.yCyclicData.push_back(
+              priceModel.yCyclicData.back());
+          priceModelDS.yCyclicNorm.push_back(
+              priceModel.yCyclicNorm.back());
+          priceModelDS.yCyclicNormData.push_back(
+              priceModel.yCyclicNormData.back());
+          priceModelDS.yCyclicNormDataPercentiles.push_back(
+              priceModel.yCyclicNormDataPercentiles.back());
+      }
+
+
+      NumericalFunctions::appendEmpiricalGrowthModelRecent(
+          priceGrowthModelJson,
+          priceModelDS,"");
+      if(!priceModelResamplingJson.empty()){
+        priceGrowthModelJson["resampling"] = priceModelResamplingJson;
+      }
+    }
+    //
+    // Package all three into a single json object
+    //
+    analysis["data_recency"] = dataDatesReport;
+    analysis["country_data"] = stringDataReport;
+    analysis["annual_milestones"] = annualMilestoneReport;
+    analysis["price_to_value_current"] = recentPriceToValueJson;
+    analysis["fund_liquidity_index"] = fundLiqudityMetricJson;
+    analysis["metric_data"]                     = metricAnalysisJson;
+    analysis["dividend_yield_growth_model"]     = dividendYieldGrowthModelJson;
+    analysis["dividend_yield_growth_model_avg"] = dividendYieldGrowthModelAvgJson;
+    analysis["dividends_paid_growth_model_avg"] = dividendGrowthModelAvgJson;
+    analysis["dividends_paid_growth_model_recent"] = dividendGrowthModelJson;
+    analysis["equity_growth_model_avg"]         = equityGrowthModelAvgJson;
+    analysis["equity_growth_model_recent"]      = equityGrowthModelJson;
+    analysis["eps_growth_model_avg"]            = epsGrowthModelAvgJson;
+    analysis["eps_growth_model_recent"]         = epsGrowthModelJson;
+    analysis["grossProfit_growth_model_avg"]    = grossProfitGrowthModelAvgJson;
+    analysis["grossProfit_growth_model_recent"] = grossProfitGrowthModelJson;
+    analysis["fcf_growth_model_avg"]            = fcfGrowthModelAvgJson;
+    analysis["fcf_growth_model_recent"]         = fcfGrowthModelJson;
+    analysis["revenue_growth_model_avg"]        = revenueGrowthModelAvgJson;
+    analysis["revenue_growth_model_recent"]     = revenueGrowthModelJson;
+
+    analysis["atoi_growth_model_avg"]     = atoiGrowthModelAverageJson;
+    analysis["atoi_growth_model_recent"]  = atoiGrowthModelRecentJson;
+    analysis["price_growth_model"]        = priceGrowthModelJson;
+
+    analysis["revenue_to_fcf_model_avg"]    = revenueFcfModelAvgJson;
+    analysis["revenue_to_fcf_model_recent"] = revenueFcfModelJson;
+    analysis["price_to_value_surface"]      = priceToValueSurfaceJson;
+    analysis["price_to_value_distribution"] = priceToValueDistributionJson;
+
+
+
+    std::string outputFilePath(analyseFolder);
+    std::string outputFileName(fileName.c_str());    
+    outputFilePath.append(outputFileName);
+
+    if(analysisUpd != nullptr){
+      *analysisUpd = std::move(analysis);
+      outputFileNameUpd = outputFileName;
+      return validInput;
+    }
+
+    //Several listings can share the same primary ticker, and so the same
+    //output file can be written by more than one thread or shard. Write to a
+    //temporary file and then move it into place so that the output file
+    //is never partially written.
+    phaseTimer.next("serialization");
+    std::string temporaryFilePath = 
+      getTemporaryFilePath(outputFilePath,tickerNumber);
+
+    std::ofstream outputFileStream(temporaryFilePath,
+        std::ios_base::trunc | std::ios_base::out);
+    outputFileStream << analysis;
+    outputFileStream.close();
+    std::filesystem::rename(temporaryFilePath, outputFilePath);
+    outputFileNameUpd = outputFileName;
+
+    if(settings.incremental){
+      writeIncrementalState(settings.stateFolder+outputFileName,
+                            tickerNumber, currentState);
+    }
+  }
+
+  return validInput;
+};
+
+
+
+//============================================================================
+// Returns the name of the fundamental file of the PrimaryTicker of 
+// tickerFileName. If there is no PrimaryTicker, or its file is not in the 
+// fundamental folder, the listing is evaluated using its own file and 
+// tickerFileName is returned.
+//============================================================================
+std::string getPrimaryFileName(const std::string &fundamentalFolder,
+                               const std::string &tickerFileName){
+
+  std::string primaryTickerName("");
+  FinancialAnalysisFunctions::getPrimaryTickerName(fundamentalFolder, 
+                                                   tickerFileName,
+                                                   primaryTickerName);
+  if(primaryTickerName.length()==0){
+    return tickerFileName;
+  }
+
+  std::string primaryFileName = primaryTickerName;
+  primaryFileName.append(".json");
+
+  std::error_code errorCode;
+  if(!std::filesystem::exists(fundamentalFolder+primaryFileName,errorCode)){
+    return tickerFileName;
+  }
+  return primaryFileName;
+};
+
+//============================================================================
+// Many listings (e.g. a US company on each of the German exchanges) share 
+// the same PrimaryTicker and are evaluated using the data of the primary, 
+// producing the same output file. The tickers are grouped by 
+// primaryFileNames so that each primary is evaluated once. Tickers with an
+// empty primaryFileName are not evaluated and are left out. The 
+// first listing of each group is the one that is evaluated: the primary 
+// itself, if it is in the list, otherwise the first listing by name.
+//============================================================================
+void groupListingsByPrimary(
+      const std::vector< std::string > &tickerFileNames,
+      const std::vector< std::string > &primaryFileNames,
+      std::vector< std::vector< size_t > > &listingGroupsUpd){
+
+  std::map< std::string, size_t > groupIndex;
+  listingGroupsUpd.clear();
+
+  for(size_t i=0; i<tickerFileNames.size(); ++i){
+    if(primaryFileNames[i].empty()){
+      continue;
+    }
+    auto iter = groupIndex.find(primaryFileNames[i]);
+    if(iter == groupIndex.end()){
+      groupIndex[primaryFileNames[i]] = listingGroupsUpd.size();
+      listingGroupsUpd.push_back(std::vector< size_t >(1,i));
+    }else{
+      listingGroupsUpd[iter->second].push_back(i);
+    }
+  }
+
+  for(auto &listings : listingGroupsUpd){
+    for(size_t i=1; i<listings.size(); ++i){
+      if(tickerFileNames[listings[i]].compare(
+                    primaryFileNames[listings[i]])==0){
+        std::swap(listings[0],listings[i]);
+        break;
+      }
+    }
+  }
+};
+
+//============================================================================
+// The record of a listing that was not evaluated because it shares its 
+// primary with the listing primaryTickerFileName. The inputs of the alias 
+// are its own fundamental file and the data of the primary, so that it is 
+// evaluated again if any of these change.
+//============================================================================
+void writeAliasRecord(const std::string &fundamentalFolder,
+                      const std::string &tickerFileName,
+                      const std::string &primaryTickerFileName,
+                      const nlohmann::ordered_json &primaryRecord,
+                      nlohmann::ordered_json &aliasRecordUpd){
+
+  aliasRecordUpd.clear();
+
+  //The fundamental file of the evaluated listing is only an input of the
+  //alias if that listing is the primary itself
+  std::string outputFileName;
+  JsonFunctions::getJsonString(primaryRecord["output"],outputFileName);
+  if(outputFileName.length()==0 && primaryRecord.contains("ttm_output")){
+    JsonFunctions::getJsonString(primaryRecord["ttm_output"],outputFileName);
+  }
+  std::string excludedFilePath("");
+  if(primaryTickerFileName.compare(outputFileName) != 0){
+    excludedFilePath = fundamentalFolder+primaryTickerFileName;
+  }
+
+  nlohmann::ordered_json inputs = nlohmann::ordered_json::array();
+  nlohmann::ordered_json inputRecord;
+  recordInputFile(fundamentalFolder+tickerFileName,inputRecord);
+  inputs.push_back(inputRecord);
+  for(auto const &primaryInput : primaryRecord["inputs"]){
+    std::string path;
+    JsonFunctions::getJsonString(primaryInput["path"],path);
+    if(path.compare(excludedFilePath) != 0){
+      inputs.push_back(primaryInput);
+    }
+  }
+
+  aliasRecordUpd["inputs"]   = inputs;
+  aliasRecordUpd["output"]   = primaryRecord["output"];
+  if(primaryRecord.contains("ttm_output")){
+    aliasRecordUpd["ttm_output"] = primaryRecord["ttm_output"];
+  }
+  aliasRecordUpd["alias_of"] = primaryTickerFileName;
+};
+
+//============================================================================
+// An entry of the journal: a ticker that has been evaluated, along with its
+// status, the time it took, and its record in the calculation manifest.
+//============================================================================
+nlohmann::ordered_json createJournalEntry(
+        const std::string &tickerFileName,
+        const ShardFunctions::ShardManifestEntry &manifestEntry,
+        const nlohmann::ordered_json &tickerRecord){
+
+  nlohmann::ordered_json entry;
+  entry["file"]    = tickerFileName;
+  entry["status"]  = manifestEntry.status;
+  entry["elapsed"] = manifestEntry.elapsedTimeInSeconds;
+  entry["record"]  = tickerRecord;
+  return entry;
+};
+
+//============================================================================
+// Copies a journal entry into the record and manifest entry of its ticker.
+// Returns false if the ticker is not one of the tickers of this run.
+//============================================================================
+bool restoreJournalEntry(
+        const nlohmann::ordered_json &entry,
+        const std::map< std::string, size_t > &tickerIndices,
+        std::vector< nlohmann::ordered_json > &tickerRecordsUpd,
+        std::vector< ShardFunctions::ShardManifestEntry > &manifestEntriesUpd,
+        size_t &indexTickerUpd){
+
+  if(!entry.contains("file") || !entry.contains("status")){
+    return false;
+  }
+  std::string fileName;
+  JsonFunctions::getJsonString(entry["file"],fileName);
+  auto iter = tickerIndices.find(fileName);
+  if(iter == tickerIndices.end()){
+    return false;
+  }
+  indexTickerUpd = iter->second;
+
+  std::string status;
+  JsonFunctions::getJsonString(entry["status"],status);
+  ShardFunctions::ShardManifestEntry &manifestEntry
+    = manifestEntriesUpd[indexTickerUpd];
+  manifestEntry.ticker = ShardFunctions::getTickerName(fileName);
+  if(status.compare(ShardFunctions::PROCESSED)==0){
+    manifestEntry.status = ShardFunctions::PROCESSED;
+  }else if(status.compare(ShardFunctions::SKIPPED)==0){
+    manifestEntry.status = ShardFunctions::SKIPPED;
+  }else{
+    manifestEntry.status = ShardFunctions::FAILED;
+  }
+  if(entry.contains("elapsed")){
+    manifestEntry.elapsedTimeInSeconds =
+      JsonFunctions::getJsonFloat(entry["elapsed"]);
+  }
+
+  tickerRecordsUpd[indexTickerUpd].clear();
+  if(entry.contains("record") && entry["record"].is_object()){
+    tickerRecordsUpd[indexTickerUpd] = entry["record"];
+  }
+  return true;
+};
+
+//============================================================================
+// Writes the tickers of the journal that failed to the failure manifest. If
+// no ticker failed the failure manifest of a previous run is removed.
+//============================================================================
+void writeFailureManifest(
+        const std::string &failureManifestPath,
+        const std::vector< nlohmann::ordered_json > &journalEntries){
+
+  nlohmann::ordered_json failures = nlohmann::ordered_json::array();
+  for(auto const &entry : journalEntries){
+    std::string status;
+    if(entry.contains("status")){
+      JsonFunctions::getJsonString(entry["status"],status);
+    }
+    if(status.compare(ShardFunctions::FAILED) != 0){
+      continue;
+    }
+    nlohmann::ordered_json failure;
+    failure["file"]      = entry["file"];
+    failure["exit_code"] = entry.contains("exit_code") ?
+                             entry["exit_code"] : nlohmann::ordered_json();
+    failure["signal"]    = entry.contains("signal") ?
+                             entry["signal"] : nlohmann::ordered_json();
+    failure["stderr"]    = entry.contains("error") ?
+                             entry["error"] : nlohmann::ordered_json("");
+    failures.push_back(failure);
+  }
+
+  std::error_code errorCode;
+  if(failures.empty()){
+    std::filesystem::remove(failureManifestPath,errorCode);
+    return;
+  }
+
+  nlohmann::ordered_json failureManifest;
+  failureManifest["failures"] = failures;
+  std::ofstream failureManifestStream(failureManifestPath,
+      std::ios_base::trunc | std::ios_base::out);
+  if(failureManifestStream.is_open()){
+    failureManifestStream << failureManifest.dump(2);
+    failureManifestStream.close();
+    std::cout << failures.size() << " tickers failed: see "
+              << failureManifestPath << std::endl;
+  }else{
+    std::cerr << "Warning: could not write the failure manifest "
+              << failureManifestPath << std::endl;
+  }
+};
+
+//============================================================================
+// Applies the settings of a service request to a copy of the settings of
+// the service. The request can contain
+//
+//  "trailing_twelve_months" : true to analyze the trailing twelve months
+//  "metrics"                : the argument of --metrics
+//  "configuration"          : fields that replace those of the configuration
+//                             file (e.g. "discount_rate"). The reference
+//                             files and the fund families cannot be replaced
+//                             because they are loaded once, when the service
+//                             starts.
+//
+// Returns false, with the reason in errorUpd, if the request is not valid.
+//============================================================================
+bool applyServiceRequestSettings(const nlohmann::ordered_json &request,
+                                 const nlohmann::ordered_json &configData,
+                                 CalculateSettings &settingsUpd,
+                                 std::string &errorUpd){
+
+  if(request.contains("trailing_twelve_months")){
+    settingsUpd.quarterlyTTMAnalysis =
+      JsonFunctions::getJsonBool(request["trailing_twelve_months"]);
+    settingsUpd.timePeriod = settingsUpd.quarterlyTTMAnalysis ? Q : Y;
+  }
+
+  if(request.contains("metrics")){
+    std::string metricsArgument;
+    JsonFunctions::getJsonString(request["metrics"],metricsArgument);
+    if(!MetricSelectionFunctions::loadMetricSelection(
+          metricsArgument,settingsUpd.metrics,false)){
+      errorUpd = "could not select the metrics from " + metricsArgument;
+      return false;
+    }
+  }
+
+  if(request.contains("configuration")){
+    const nlohmann::ordered_json &overrides = request["configuration"];
+    if(!overrides.is_object()){
+      errorUpd = "configuration must be an object";
+      return false;
+    }
+    const std::vector< std::string > fixedFields = {
+      "eod_toolkit_config_folder",
+      "default_spread_json_file",
+      "bond_yield_json_file",
+      "world_corporate_tax_rate_csv_file",
+      "equity_risk_premium_by_country_json_file",
+      "currency_units_json_file",
+      "fund_liquidity_index"};
+    for(auto const &field : fixedFields){
+      if(overrides.contains(field)){
+        errorUpd = field + " cannot be changed while the service is running";
+        return false;
+      }
+    }
+
+    nlohmann::ordered_json requestConfigData = configData;
+    requestConfigData.merge_patch(overrides);
+    settingsUpd.cc.loadFromJson(requestConfigData);
+
+    if(!ResamplingFunctions::parseResamplingMethod(
+          settingsUpd.cc.price_model_resampling_method,
+          settingsUpd.priceModelResampling.method)){
+      errorUpd = "the price_model_resampling method must be one of "
+                 "none, weekly, monthly, or lttb";
+      return false;
+    }
+    settingsUpd.priceModelResampling.maximumNumberOfPoints =
+      settingsUpd.cc.price_model_resampling_maximum_number_of_points;
+    settingsUpd.maxDayErrorHistoricalData = settingsUpd.cc.max_day_error;
+    settingsUpd.maxDayErrorBondYieldData  = settingsUpd.cc.max_day_error;
+    settingsUpd.maxDayErrorTTM            = settingsUpd.cc.max_day_error;
+  }
+  return true;
+};
+
+//============================================================================
+// Answers one request sent to the calculation service. A request is a json
+// object with the ticker to evaluate, e.g.
+//
+//  {"ticker":"AAPL.US", "write":false, "configuration":{"discount_rate":0.09}}
+//
+// (see applyServiceRequestSettings for the other fields). If write is true
+// the analysis is written to the output folder, otherwise it is returned in
+// the reply. Only a request that keeps the analysis settings of the service
+// can be written. The console output of the evaluation is returned in the log
+// field of the reply. {"command":"shutdown"} stops the service.
+//============================================================================
+std::string handleServiceRequest(const std::string &requestText,
+                                 const nlohmann::ordered_json &configData,
+                                 const CalculateSettings &serviceSettings,
+                                 const ReferenceDataSet &referenceData,
+                                 std::atomic< int > &requestCounter,
+                                 bool &stopUpd){
+
+  nlohmann::ordered_json reply;
+  nlohmann::ordered_json request =
+    nlohmann::ordered_json::parse(requestText,nullptr,false);
+
+  if(request.is_discarded() || !request.is_object()){
+    reply["status"] = "error";
+    reply["error"]  = "the request is not a json object";
+    return reply.dump();
+  }
+
+  if(request.contains("command")){
+    std::string command;
+    JsonFunctions::getJsonString(request["command"],command);
+    if(command.compare("shutdown")==0){
+      stopUpd = true;
+      reply["status"] = "stopping";
+    }else{
+      reply["status"] = "error";
+      reply["error"]  = "unknown command " + command;
+    }
+    return reply.dump();
+  }
+
+  std::string fileName;
+  if(request.contains("ticker")){
+    JsonFunctions::getJsonString(request["ticker"],fileName);
+  }
+  if(fileName.length()==0){
+    reply["status"] = "error";
+    reply["error"]  = "the request has no ticker";
+    return reply.dump();
+  }
+  //The ticker is a file name in the fundamental folder, never a path
+  if(fileName.find('/') != std::string::npos 
+      || fileName.find("..") != std::string::npos){
+    reply["status"] = "error";
+    reply["error"]  = "the ticker cannot contain / or ..";
+    return reply.dump();
+  }
+  if(fileName.find(".json") == std::string::npos){
+    fileName.append(".json");
+  }
+  reply["ticker"] = fileName;
+
+  CalculateSettings settings = serviceSettings;
+  std::string error;
+  if(!applyServiceRequestSettings(request,configData,settings,error)){
+    reply["status"] = "error";
+    reply["error"]  = error;
+    return reply.dump();
+  }
+
+  bool writeAnalysis = false;
+  if(request.contains("write")){
+    writeAnalysis = JsonFunctions::getJsonBool(request["write"]);
+  }
+
+  //The output folder holds the analysis made with the settings of the 
+  //service, and so a request that changes the analysis cannot write to it
+  bool changesAnalysis = 
+       settings.timePeriod.compare(serviceSettings.timePeriod) != 0
+    || request.contains("metrics")
+    || request.contains("configuration");
+  if(writeAnalysis && changesAnalysis){
+    reply["status"] = "error";
+    reply["error"]  = "write cannot be used with a request that changes "
+                      "trailing_twelve_months, metrics, or configuration";
+    return reply.dump();
+  }
+
+  //The ticker is evaluated in a forked copy of the service so that a ticker
+  //that crashes (e.g. calls std::abort) does not take down the service and
+  //the other requests that it is serving
+  int tickerNumber = requestCounter.fetch_add(1);
+  std::string result;
+  std::string log;
+  SupervisorFunctions::WorkerFailure failure;
+  bool finished = SupervisorFunctions::runIsolatedTask(
+    [&]() -> std::string {
+      nlohmann::ordered_json taskReply;
+      nlohmann::ordered_json analysis;
+      std::vector< std::string > inputFilePaths;
+      std::string outputFileName;
+      try{
+        ArenaFunctions::TickerScope tickerArena;
+        bool valid = calculateTicker(fileName,
+                                     tickerNumber,
+                                     settings,
+                                     referenceData,
+                                     inputFilePaths,
+                                     outputFileName,
+                                     writeAnalysis ? nullptr : &analysis);
+        taskReply["status"] = valid ? ShardFunctions::PROCESSED
+                                    : ShardFunctions::SKIPPED;
+        if(valid){
+          taskReply["output"] = outputFileName;
+          if(!writeAnalysis){
+            taskReply["analysis"] = std::move(analysis);
+          }
+        }
+      }catch(const std::exception &e){
+        taskReply["status"] = ShardFunctions::FAILED;
+        taskReply["error"]  = e.what();
+      }
+      return taskReply.dump();
+    },
+    result,
+    log,
+    failure);
+
+  nlohmann::ordered_json taskReply;
+  if(finished){
+    taskReply = nlohmann::ordered_json::parse(result,nullptr,false);
+  }
+  if(finished && taskReply.is_object()){
+    for(auto &item : taskReply.items()){
+      reply[item.key()] = std::move(item.value());
+    }
+  }else{
+    reply["status"] = ShardFunctions::FAILED;
+    std::string error("the evaluation of the ticker exited");
+    if(failure.signal != 0){
+      error.append(" with ");
+      error.append(SupervisorFunctions::getSignalName(failure.signal));
+    }else if(failure.exitCode >= 0){
+      error.append(" with exit code ");
+      error.append(std::to_string(failure.exitCode));
+    }
+    reply["error"] = error;
+  }
+  reply["log"] = log;
+
+  return reply.dump();
+};
+
+//============================================================================
+// Serves calculation requests at socketPath until it is sent a shutdown
+// command. The reference data is loaded once, before the service starts, and
+// the requests are evaluated at the same time, each in its own forked copy
+// of the service.
+//============================================================================
+bool runCalculationService(const std::string &socketPath,
+                           const std::string &configurationFile,
+                           const CalculateSettings &settings,
+                           const ReferenceDataSet &referenceData,
+                           bool verbose){
+
+  nlohmann::ordered_json configData;
+  JsonFunctions::loadJsonFile(configurationFile,configData,verbose);
+
+  std::cout << "Serving calculation requests at " << socketPath << std::endl;
+
+  std::atomic< int > requestCounter(1);
+  bool served = ServiceFunctions::runUnixSocketService(
+    socketPath,
+    [&](const std::string &requestText, bool &stopUpd) -> std::string {
+      return handleServiceRequest(requestText,configData,settings,
+                                  referenceData,requestCounter,stopUpd);
+    });
+
+  return served;
+};
+
+//============================================================================
+int main (int argc, char* argv[]) {
+
+  std::string exchangeCode;
+  std::string fundamentalFolder;
+  std::string historicalFolder;
+  std::string forexFolder;
+  std::string configurationFile;
+  std::string eodFolder;
+  std::string analyseFolder;
+  std::string ttmAnalyseFolder;
+  std::string timePeriod;
+  std::string singleFileToEvaluate;
+
+  bool quarterlyTTMAnalysis = false;
+  bool relaxedCalculation = false;
+  
+  DataStructures::CalculationConfiguration cc;
+
+  nlohmann::ordered_json currencyUnits;
+  std::string nameOfHomeCountryISO3;
+
+
+  bool verbose = false;
+  int numberOfThreads = 1;
+  int monteCarloThreads = 1;
+  int numberOfWorkers = 0;
+  std::string serviceSocketPath;
+  std::string profilePath;
+  int prefetchCount = 2;
+  ResamplingFunctions::ResamplingSettings priceModelResampling;
+  ShardFunctions::ShardSettings shard;
+  std::string manifestFolder;
+  std::string calculationManifestPath;
+  bool forceCalculation = false;
+  bool incrementalCalculation = false;
+  std::string referenceSnapshotPath;
+  std::string metricsArgument;
+  std::string metricRequirementsPath;
+
+  try{
+    TCLAP::CmdLine cmd("The command will analyze fundamental and end-of-data"
+    "data (from https://eodhistoricaldata.com/) and "
+    "write the results of the calculation to a json file in an output directory"
+    ,' ', "0.0");
+
+
+    TCLAP::ValueArg<std::string> fundamentalFolderInput("f",
+      "fundamental_data_folder_path", 
+      "The path to the folder that contains the fundamental data json files from "
+      "https://eodhistoricaldata.com/ to analyze",
+      true,"","string");
+    cmd.add(fundamentalFolderInput);
+
+    TCLAP::ValueArg<std::string> historicalFolderInput("p",
+      "historical_data_folder_path", 
+      "The path to the folder that contains the historical (price)"
+      " data json files from https://eodhistoricaldata.com/ to analyze",
+      true,"","string");
+    cmd.add(historicalFolderInput);
+
+    TCLAP::ValueArg<std::string> forexFolderInput("r",
+      "forex_data_folder_path", 
+      "The path to the folder that contains the FOREX"
+      " data json files from https://eodhistoricaldata.com/",
+      true,"","string");
+    cmd.add(forexFolderInput);
+
+
+    TCLAP::ValueArg<std::string> configurationFileInput("c",
+      "configuration_file_input", 
+      "The path to the json file that contains default parameter settings"
+      " and paths to tabular data (defaultSpreadTable, bondYieldTable, "
+      " tax-rates-around-the-world, and the countryRisk table).",
+      true,"","string");
+    cmd.add(configurationFileInput);    
+
+    TCLAP::ValueArg<std::string> singleFileToEvaluateInput("i",
+      "single_ticker_name", 
+      "To evaluate a single ticker only, set the ticker name here.",
+      false,"","string");
+    cmd.add(singleFileToEvaluateInput);
+
+    TCLAP::ValueArg<std::string> exchangeCodeInput("x","exchange_code", 
+      "The exchange code. For example: US",
+      false,"","string");
+    cmd.add(exchangeCodeInput);  
+     
+
+    TCLAP::ValueArg<std::string> nameOfHomeCountryISO3Input("n",
+      "iso3_name_of_home_country", 
+      "Name of your home country in ISO3 format (e.g. USA for the"
+      " United States of America, DEU for Germany, etc)",
+      false,"","string");
+    cmd.add(nameOfHomeCountryISO3Input);  
+
+    TCLAP::SwitchArg relaxedCalculationInput("l","relaxed",
+      "Relaxed calculation: nulls for some values (short term debt,"
+      " research and development, dividends, depreciation) are set to "
+      " zero, while substitute calculations are used to replace "
+      " null values (shortLongDebt replaced with longDebt)", false);
+    cmd.add(relaxedCalculationInput); 
+
+    TCLAP::SwitchArg quarterlyTTMAnalysisInput("q","trailing_twelve_months",
+      "Analyze trailing twelve moneths using quarterly data.", false);
+    cmd.add(quarterlyTTMAnalysisInput); 
+
+    TCLAP::ValueArg<std::string> analyseFolderOutput("o","output_folder_path", 
+      "The path to the folder that will contain the output json files "
+      "produced by these calculations",
+      true,"","string");
+    cmd.add(analyseFolderOutput);
+
+    TCLAP::ValueArg<std::string> ttmAnalyseFolderOutput("Q",
+      "ttm_output_folder_path", 
+      "Analyze both time periods in one run: each ticker is loaded once, "
+      "the yearly analysis is written to the output folder and the "
+      "quarterly TTM analysis to this folder. Cannot be used with -q, and "
+      "is not used in service mode.",
+      false,"","string");
+    cmd.add(ttmAnalyseFolderOutput);
+
+
+    TCLAP::ValueArg<int> numberOfThreadsInput("t","threads", 
+      "The number of tickers to evaluate at the same time. Set this to 0 "
+      "to use every available core.",
+      false,1,"int");
+    cmd.add(numberOfThreadsInput);
+
+    TCLAP::ValueArg<int> numberOfWorkersInput("w","workers", 
+      "Evaluate the tickers in this many worker processes instead of "
+      "threads. A ticker that crashes its worker (e.g. by calling abort) is "
+      "listed, with its error output, in the calculate_failures file named "
+      "after, and kept next to, the calculation manifest and the rest of "
+      "the tickers are "
+      "still evaluated. By default (0) the tickers are evaluated using "
+      "threads.",
+      false,0,"int");
+    cmd.add(numberOfWorkersInput);
+
+    TCLAP::ValueArg<std::string> serviceSocketInput("d","daemon", 
+      "Run as a service: load the reference data once and then evaluate "
+      "the tickers sent as requests to the Unix domain socket at this path, "
+      "instead of the tickers in the fundamental folder. Each request is a "
+      "line of json such as {\"ticker\":\"AAPL.US\",\"write\":false,"
+      "\"configuration\":{\"discount_rate\":0.09}} and is answered with a "
+      "line of json that contains the analysis (or the name of the output "
+      "file when write is true). {\"command\":\"shutdown\"} stops the "
+      "service.",
+      false,"","string");
+    cmd.add(serviceSocketInput);
+
+    TCLAP::ValueArg<int> monteCarloThreadsInput("j","monte_carlo_threads", 
+      "The number of threads used to evaluate the paths of the Monte Carlo "
+      "valuation of each ticker. Set this to 0 to use every available core. "
+      "The result does not depend on the number of threads.",
+      false,1,"int");
+    cmd.add(monteCarloThreadsInput);
+
+    TCLAP::ValueArg<std::string> shardInput("s","shard", 
+      "Evaluate only shard i of N (e.g. 2/8). Tickers are assigned to shards "
+      "using a hash of the name of their primary listing, so that the "
+      "listings that share a primary are evaluated by the same shard.",
+      false,"","string");
+    cmd.add(shardInput);
+
+    TCLAP::ValueArg<std::string> manifestFolderInput("m","manifest_folder", 
+      "The folder that the shard manifest is written to. By default this is "
+      "the current directory.",
+      false,"","string");
+    cmd.add(manifestFolderInput);
+
+    TCLAP::ValueArg<std::string> calculationManifestInput("k",
+      "calculation_manifest", 
+      "The file that records the inputs used to produce each output file. "
+      "Tickers whose inputs have not changed since the last run are not "
+      "evaluated again. By default this is "
+      "calculate_manifest_<exchange>_<output folder name>.json in the folder "
+      "that contains the output folder.",
+      false,"","string");
+    cmd.add(calculationManifestInput);
+
+    TCLAP::SwitchArg forceCalculationInput("u","force",
+      "Evaluate every ticker, even those whose inputs have not changed", 
+      false);
+    cmd.add(forceCalculationInput);    
+
+    TCLAP::SwitchArg incrementalCalculationInput("a","incremental",
+      "When the inputs of a ticker have changed, only evaluate the dates "
+      "whose inputs have changed and copy the rest from the previous output "
+      "file. Growth models are only fitted again if their data has changed. "
+      "The state needed to do this is kept in the calculate_state folder "
+      "named after, and kept next to, the calculation manifest.", 
+      false);
+    cmd.add(incrementalCalculationInput);    
+
+    TCLAP::ValueArg<std::string> referenceSnapshotInput("b",
+      "reference_snapshot", 
+      "The binary file that the parsed reference tables (tax rates, default "
+      "spreads, bond yields, and country risk) are written to. It is read "
+      "instead of the reference files when none of them have changed. By "
+      "default this is calculate_reference_data.bin next to the calculation "
+      "manifest.",
+      false,"","string");
+    cmd.add(referenceSnapshotInput);
+
+    TCLAP::ValueArg<std::string> metricsInput("e",
+      "metrics", 
+      "Evaluate only some of the metrics. This can be a comma separated list "
+      "of metric families (core, dcf, atoi_growth, dcf_empirical, "
+      "price_model, equity_growth, eps_growth, gross_profit_growth, "
+      "fcf_growth, revenue_growth, financial_ratios, eps_valuation, "
+      "fcf_valuation, dividends, liquidity, monte_carlo, all), a metric "
+      "requirements file, a screen configuration file, or a folder of screen "
+      "configuration "
+      "files. The metrics needed by the calculateData fields of the "
+      "screens are evaluated. The core metrics are always evaluated. By "
+      "default every metric is evaluated.",
+      false,"","string");
+    cmd.add(metricsInput);
+
+    TCLAP::ValueArg<std::string> metricRequirementsInput("g",
+      "metric_requirements_output", 
+      "Write the metric families selected with --metrics, and the screen "
+      "fields that they were derived from, to this json file. This file can "
+      "be passed to --metrics in later runs.",
+      false,"","string");
+    cmd.add(metricRequirementsInput);
+
+    TCLAP::ValueArg<int> prefetchInput("z","prefetch", 
+      "The number of tickers after the one that a thread is evaluating "
+      "whose fundamental and historical files are read ahead by background "
+      "I/O threads (0 to read each file when it is needed). Not used with "
+      "--workers.",
+      false,2,"int");
+    cmd.add(prefetchInput);
+
+    TCLAP::ValueArg<std::string> profileInput("y","profile", 
+      "Time the phases of the evaluation of each ticker and write the "
+      "times to this json file, along with the total and slowest ticker of "
+      "each phase. A trace that can be opened in chrome://tracing or "
+      "https://ui.perfetto.dev is written next to it with the suffix _trace. "
+      "The profile is not recorded when the tickers are evaluated in worker "
+      "processes (--workers).",
+      false,"","string");
+    cmd.add(profileInput);
+
+    TCLAP::SwitchArg verboseInput("v","verbose",
+      "Verbose output printed to screen", false);
+    cmd.add(verboseInput);    
+
+    cmd.parse(argc,argv);
+
+    fundamentalFolder     = fundamentalFolderInput.getValue();
+    historicalFolder      = historicalFolderInput.getValue();
+    forexFolder           = forexFolderInput.getValue();
+    configurationFile     = configurationFileInput.getValue();
+
+    singleFileToEvaluate  = singleFileToEvaluateInput.getValue();
+    exchangeCode          = exchangeCodeInput.getValue();    
+    analyseFolder         = analyseFolderOutput.getValue();
+    ttmAnalyseFolder      = ttmAnalyseFolderOutput.getValue();
+    quarterlyTTMAnalysis  = quarterlyTTMAnalysisInput.getValue();
+    nameOfHomeCountryISO3 = nameOfHomeCountryISO3Input.getValue(); 
+
+    relaxedCalculation    = relaxedCalculationInput.getValue() ;
+    verbose               = verboseInput.getValue();
+    numberOfThreads       = numberOfThreadsInput.getValue();
+    monteCarloThreads     = monteCarloThreadsInput.getValue();
+    numberOfWorkers       = numberOfWorkersInput.getValue();
+    serviceSocketPath     = serviceSocketInput.getValue();
+    profilePath           = profileInput.getValue();
+    prefetchCount         = prefetchInput.getValue();
+    manifestFolder        = manifestFolderInput.getValue();
+    calculationManifestPath = calculationManifestInput.getValue();
+    forceCalculation      = forceCalculationInput.getValue();
+    incrementalCalculation= incrementalCalculationInput.getValue();
+    referenceSnapshotPath = referenceSnapshotInput.getValue();
+    metricsArgument       = metricsInput.getValue();
+    metricRequirementsPath= metricRequirementsInput.getValue();
+
+    bool validShard = 
+      ShardFunctions::parseShardSettings(shardInput.getValue(),shard);
+    if(!validShard){
+      std::cerr << "Error: the shard must be of the form i/N with "
+                << "1 <= i <= N but is " << shardInput.getValue() 
+                << std::endl;
+      std::abort();
+    }
+
+    if(quarterlyTTMAnalysis){
+      timePeriod          = Q;
+    }else{
+      timePeriod          = Y;
+    }   
+
+    if(quarterlyTTMAnalysis && ttmAnalyseFolder.length()>0){
+      std::cerr << "Error: -q (trailing_twelve_months) cannot be used with "
+                << "-Q (ttm_output_folder_path): with -Q the yearly analysis "
+                << "is written to the output folder and the quarterly TTM "
+                << "analysis to " << ttmAnalyseFolder << std::endl;
+      std::abort();
+    }
+    
+    cc.load(configurationFile);
+
+    if(!ResamplingFunctions::parseResamplingMethod(
+          cc.price_model_resampling_method, priceModelResampling.method)){
+      std::cerr << "Error: the price_model_resampling method must be one of "
+                << "none, weekly, monthly, or lttb but is "
+                << cc.price_model_resampling_method << std::endl;
+      std::abort();
+    }
+    priceModelResampling.maximumNumberOfPoints = 
+      cc.price_model_resampling_maximum_number_of_points;
+
+
+    if(verbose){
+      std::cout << "  Fundamental Data Folder" << std::endl;
+      std::cout << "    " << fundamentalFolder << std::endl;
+
+      std::cout << "  Historical Data Folder" << std::endl;
+      std::cout << "    " << historicalFolder << std::endl;
+      
+      std::cout << "  Configuration File" << std::endl;
+      std::cout << "    " << configurationFile << std::endl;
+
+      std::cout << "  Exchange Code" << std::endl;
+      std::cout << "    " << exchangeCode << std::endl;
+
+      std::cout << "  Single file name to evaluate" << std::endl;
+      std::cout << "    " << singleFileToEvaluate << std::endl;
+
+      std::cout << "  Name of home country (ISO3)" << std::endl;
+      std::cout << "    " << nameOfHomeCountryISO3 << std::endl;
+
+      std::cout << "  Output Folder" << std::endl;
+      std::cout << "    " << analyseFolder << std::endl;
+
+      std::cout << "  Analyze TTM using Quarterly Data" << std::endl;
+      std::cout << "    " << quarterlyTTMAnalysis << std::endl;
+
+      if(ttmAnalyseFolder.length()>0){
+        std::cout << "  Quarterly TTM Output Folder" << std::endl;
+        std::cout << "    " << ttmAnalyseFolder << std::endl;
+      }
+
+      std::cout << "  Number of threads" << std::endl;
+      std::cout << "    " << numberOfThreads << std::endl;
+
+      std::cout << "  Number of worker processes" << std::endl;
+      std::cout << "    " << numberOfWorkers << std::endl;
+
+      std::cout << "  Number of tickers prefetched per thread" << std::endl;
+      std::cout << "    " << prefetchCount << std::endl;
+
+      if(profilePath.length()>0){
+        std::cout << "  Profile" << std::endl;
+        std::cout << "    " << profilePath << std::endl;
+      }
+
+      if(shard.enabled){
+        std::cout << "  Shard" << std::endl;
+        std::cout << "    " << shard.index << "/" << shard.count << std::endl;
+      }
+
+      std::cout << "  Calculation Manifest" << std::endl;
+      std::cout << "    " << calculationManifestPath << std::endl;
+
+      std::cout << "  Force" << std::endl;
+      std::cout << "    " << forceCalculation << std::endl;
+
+      std::cout << "  Incremental" << std::endl;
+      std::cout << "    " << incrementalCalculation << std::endl;
+
+      std::cout << "  Reference Snapshot" << std::endl;
+      std::cout << "    " << referenceSnapshotPath << std::endl;
+
+      std::cout << "  Metrics" << std::endl;
+      std::cout << "    " << metricsArgument << std::endl;
+
+      std::cout << "  Metric Requirements Output" << std::endl;
+      std::cout << "    " << metricRequirementsPath << std::endl;
+
+      std::cout << "  Verbose" << std::endl;
+      std::cout << "    " << verbose << std::endl;
+
+
+      std::cout << "----------------------------------------" << std::endl;
+      std::cout << "  Configuration file contents" << std::endl;
+      std::cout << "----------------------------------------" << std::endl;
+
+      std::cout << "  Default Spread Json File" << std::endl;
+      std::cout << "    " << cc.default_spread_json_file << std::endl;
+
+      std::cout << "  Bond Yield Json File" << std::endl;
+      std::cout << "    " << cc.bond_yield_json_file << std::endl;
+
+      std::cout << "  Corporate tax rate file from https://taxfoundation.org"
+                << std:: endl;
+      std::cout << "    " << cc.world_corporate_tax_rate_csv_file << std::endl;
+
+      std::cout << "  Risk by country" << std::endl;
+      std::cout << "    " << cc.equity_risk_premium_by_country_json_file 
+                          << std::endl;
+
+      std::cout << "  Default interest cover value" << std::endl;
+      std::cout << "    " << cc.default_interest_cover << std::endl;
+      
+      std::cout << "  Default tax rate" << std::endl;
+      std::cout << "    " << cc.default_tax_rate << std::endl;
+
+      std::cout << "  Annual default risk free rate" << std::endl;
+      std::cout << "    " << cc.default_risk_free_rate << std::endl;
+
+      std::cout << "  Default beta value" << std::endl;
+      std::cout << "    " << cc.default_beta << std::endl;
+
+      std::cout << "  Equity risk premium (U.S.A.)" << std::endl;
+      std::cout << "    " << cc.equity_risk_premium_usa << std::endl;
+
+      std::cout << "  Assumed mature firm fraction of debt to capital" << std::endl;
+      std::cout << "    " << cc.mature_firm_fraction_debt_to_capital << std::endl;
+
+      std::cout << "  Number of years of growth in the DCM valuation " 
+                << std::endl;
+      std::cout << "    " << cc.number_of_years_of_growth 
+                << std::endl;
+
+      std::cout << "  Number of years of data used to evaluate growth rates " 
+                << std::endl;
+      std::cout << "    " << cc.number_of_years_used_in_growth_rate_calculation 
+                << std::endl;
+
+      std::cout << "  TO DO: Update code to use  number_of_years_used_in"
+                   "_growth_rate_calculation" 
+                << std::endl;
+
+
+      std::cout << "  Maximum number of days in error allowed for tabular " 
+                << "data of bond yields and historical stock prices " 
+                << std::endl;                
+      std::cout << "    " << cc.max_day_error 
+                << std::endl;    
+
+      std::cout << "  Using relaxed calculations?" << std::endl;
+      std::cout << relaxedCalculation << std::endl;
+
+    }
+  } catch (TCLAP::ArgException &e)  // catch exceptions
+	{ 
+    std::cerr << "error: "    << e.error() 
+              << " for arg "  << e.argId() << std::endl; 
+  }
+
+  double dateToday = DateFunctions::getTodaysDate();
+
+  int acceptableBackwardsYearErrorForTaxRate = 5;
+  //This defines how far back in time data from the tax table can be taken
+  //to approximate the tax of this year.
+
+
+  int maxDayErrorHistoricalData = cc.max_day_error; 
+  // Historical data has a resolution of 1 day
+  
+  int maxDayErrorBondYieldData  = cc.max_day_error; 
+  // Bond yield data has a resolution of 1 month
+
+  int maxDayErrorTTM = cc.max_day_error;
+
+  int maxDayErrorOutstandingShareData = 365; 
+
+  //In extractEmpiricalAfterTaxOperatingIncomeGrowthRates an exponential growth model is fit to
+  //data. Such a model requires that the input data (after tax operating income
+  // in this case) must be greater than 1. Here a certain proportion of the
+  // data is allowed to be less than 1. These values are set to 1, so that
+  // the low values (approximately) still influence the fit.
+  //
+  // 4/4/2025 As the decision of which model to choose is based on the R2
+  //          between the model and the original data, it does not really
+  //          make sense to set an upper limit on maxProportionOfOutliersInExpModel
+  double maxProportionOfOutliersInExpModel = 1.0;
+
+  double minPriceAllowedInPriceModel=2.0;
+
+  // When fitting cyclic models, the period of smallest allowable cycle is 
+  // defined by this term
+  double minCycleTimeInYears = 1.0;
+
+  // In order to accept a more complex cyclic model, it should provide at least
+  // this amount of improvement in R2
+  double exponentialModelR2Preference=0.25;
+
+  //This date error is over 1 year to accomodate for firms that only
+  //report financial data on an annual basis
+  double maxDateErrorInYearsInEmpiricalData = 1.5;
+
+  std::vector< double > peMarketVariationUpperBound(3);
+  peMarketVariationUpperBound[0]=10;
+  peMarketVariationUpperBound[1]=15;
+  peMarketVariationUpperBound[2]=30;
+
+  //2024/8/4 
+  //  Note: some fields used in the functions in the FinanacialToolkit
+  //  will replace nan's with a coded MISSING_NUMBER. Why?
+  //  Some reports are getting trashed by nans in fields that should 
+  //  actually be nan. For example, META is not a business that has inventory
+  //  and so this is not reported. Naturally when inventory doesn't
+  //  appear, or is set to nan, it then turns the results of all
+  //  analysis done using this term to nan. And this, unfortunately,
+  //  later means that these securities are ignored in later analysis.
+
+  bool setNansToMissingValue                  = relaxedCalculation;
+
+
+  //When this is true all intermediate values of a calculation are saved
+  //and written to file to permit manual inspection.  
+  bool appendTermRecord                       = true;
+
+  std::vector< std::string > vectorNames;
+  std::vector< std::vector< double > > vectorValues;
+
+  bool loadSingleTicker=false;
+  if(singleFileToEvaluate.size() > 0){
+    loadSingleTicker = true;
+  }
 
-              
-        //
-        // Equity growth
-        //
-        NumericalFunctions::appendMetricGrowthDataSet(
-              dateDouble,              
-              equityGrowthModel,
-              std::string("equityEmpiricalModel_"),
-              maxDateErrorInYearsInEmpiricalData,
-              termNames,
-              termValues);
-
-        NumericalFunctions::appendMetricGrowthDataSetRecentDate(
-              equityGrowthModelAvg,
-              std::string("equityEmpiricalModelAvg_"),
-              maxDateErrorInYearsInEmpiricalData,
-              termNames,
-              termValues);
-
-        //
-        // Earnings per share growth
-        //
-        NumericalFunctions::appendMetricGrowthDataSet(
-              dateDouble,              
-              epsGrowthModel,
-              std::string("epsEmpiricalModel_"),
-              maxDateErrorInYearsInEmpiricalData,
-              termNames,
-              termValues);
-
-        NumericalFunctions::appendMetricGrowthDataSetRecentDate(
-              epsGrowthModelAvg,
-              std::string("epsEmpiricalModelAvg_"),
-              maxDateErrorInYearsInEmpiricalData,
-              termNames,
-              termValues);              
-
-        //
-        // Gross profit growth
-        //
-        NumericalFunctions::appendMetricGrowthDataSet(
-              dateDouble,              
-              grossProfitGrowthModel,
-              std::string("grossProfitEmpiricalModel_"),
-              maxDateErrorInYearsInEmpiricalData,
-              termNames,
-              termValues);
-
-        NumericalFunctions::appendMetricGrowthDataSetRecentDate(
-              grossProfitGrowthModelAvg,
-              std::string("grossProfitEmpiricalModelAvg_"),
-              maxDateErrorInYearsInEmpiricalData,
-              termNames,
-              termValues);
-        //
-        // Free cash flow
-        //
-        NumericalFunctions::appendMetricGrowthDataSet(
-              dateDouble,              
-              fcfGrowthModel,
-              std::string("fcfEmpiricalModel_"),
-              maxDateErrorInYearsInEmpiricalData,
-              termNames,
-              termValues);
-
-        NumericalFunctions::appendMetricGrowthDataSetRecentDate(
-              fcfGrowthModelAvg,
-              std::string("fcfEmpiricalModelAvg_"),
-              maxDateErrorInYearsInEmpiricalData,
-              termNames,
-              termValues);
-        //
-        // Sales
-        //
-        NumericalFunctions::appendMetricGrowthDataSet(
-              dateDouble,              
-              revenueGrowthModel,
-              std::string("revenueEmpiricalModel_"),
-              maxDateErrorInYearsInEmpiricalData,
-              termNames,
-              termValues);
-
-        NumericalFunctions::appendMetricGrowthDataSetRecentDate(
-              revenueGrowthModelAvg,
-              std::string("revenueEmpiricalModelAvg_"),
-              maxDateErrorInYearsInEmpiricalData,
-              termNames,
-              termValues);
-
-        //revenueGrowthModel
-        //revenueGrowthModelAvg              
-        //
-        //
-        //
-        nlohmann::ordered_json analysisEntry=nlohmann::ordered_json::object();
-        analysisEntry.push_back({"date", date});        
-        for( unsigned int i=0; i < termNames.size();++i){
-          analysisEntry.push_back({termNames[i],
-                                   termValues[i]});
-        }
+  std::string validFileExtension = exchangeCode;
+  validFileExtension.append(".json");
 
-        //
-        //annualMilestones
-        //
-        if(analysisDates.isAnnualReport[indexDate]){
+  auto startingDirectory = std::filesystem::current_path();
+  if(manifestFolder.length()==0){
+    manifestFolder = startingDirectory.string();
+  }else{
+    manifestFolder = std::filesystem::absolute(manifestFolder).string();
+  }
 
-          double excessReturnOnInvestedCapital 
-            = returnOnCapitalDeployed-costOfCapital;
+  if(calculationManifestPath.length()==0){
+    std::filesystem::path outputFolderPath(analyseFolder);
+    if(!outputFolderPath.has_filename()){
+      outputFolderPath = outputFolderPath.parent_path();
+    }
+    //Runs of one exchange into sibling output folders (e.g. a yearly and a 
+    //quarterly analysis) each have their own manifest
+    std::string manifestFileName("calculate_manifest_");
+    manifestFileName.append(exchangeCode);
+    manifestFileName.append("_");
+    manifestFileName.append(outputFolderPath.filename().string());
+    if(shard.enabled){
+      manifestFileName.append("_shard_");
+      manifestFileName.append(std::to_string(shard.index));
+      manifestFileName.append("_of_");
+      manifestFileName.append(std::to_string(shard.count));
+    }
+    manifestFileName.append(".json");
+    calculationManifestPath = 
+      (outputFolderPath.parent_path() / manifestFileName).string();
+  }
+  calculationManifestPath = 
+    std::filesystem::absolute(calculationManifestPath).string();
 
-          if((excessReturnOnInvestedCapital)>0){
-            ++annualMilestones.yearsOfPositiveValueCreation;
-          }
-        }
+  if(referenceSnapshotPath.length()==0){
+    referenceSnapshotPath = 
+      (std::filesystem::path(calculationManifestPath).parent_path() 
+        / "calculate_reference_data.bin").string();
+  }
+  referenceSnapshotPath = 
+    std::filesystem::absolute(referenceSnapshotPath).string();
+
+  //The journal, failure manifest, and worker scratch folder are kept next
+  //to the calculation manifest
+  std::filesystem::path manifestStem(calculationManifestPath);
+  std::string journalPath = 
+    (manifestStem.parent_path() 
+      / (manifestStem.stem().string()+"_journal.jsonl")).string();
+  std::string workerFolder = 
+    (manifestStem.parent_path() 
+      / (manifestStem.stem().string()+"_workers")).string();
+  std::string failureManifestName = manifestStem.stem().string();
+  StringFunctions::findAndReplaceString(failureManifestName,
+                                        "calculate_manifest",
+                                        "calculate_failures");
+  if(failureManifestName.compare(manifestStem.stem().string())==0){
+    failureManifestName.append("_failures");
+  }
+  std::string failureManifestPath = 
+    (manifestStem.parent_path() / (failureManifestName+".json")).string();
+
+  std::string stateFolder;
+  if(incrementalCalculation){
+    std::string stateFolderName = manifestStem.stem().string();
+    StringFunctions::findAndReplaceString(stateFolderName,
+                                          "calculate_manifest",
+                                          "calculate_state");
+    if(stateFolderName.compare(manifestStem.stem().string())==0){
+      stateFolderName.append("_state");
+    }
+    stateFolder = (manifestStem.parent_path() / stateFolderName).string();
+    std::filesystem::create_directories(stateFolder);
+    stateFolder.append("/");
+  }
+  //The quarterly TTM analysis of a ticker has its own state file
+  std::string ttmStateFolder;
+  if(incrementalCalculation && ttmAnalyseFolder.length()>0){
+    ttmStateFolder = stateFolder + "ttm";
+    std::filesystem::create_directories(ttmStateFolder);
+    ttmStateFolder.append("/");
+  }
+  //============================================================================
+  // Select the metrics to evaluate
+  //============================================================================
+  MetricSelectionFunctions::MetricSelection metricSelection;
+  bool validMetrics = MetricSelectionFunctions::
+    loadMetricSelection(metricsArgument, metricSelection, verbose);
+  if(!validMetrics){
+    std::cerr << "Error: could not select the metrics from " 
+              << metricsArgument << std::endl;
+    std::abort();
+  }
+  if(verbose || !metricSelection.allSelected){
+    std::cout << "Evaluating the metrics: " 
+              << MetricSelectionFunctions::
+                  getSelectedFamilyNames(metricSelection)
+              << std::endl;
+  }
+  if(metricRequirementsPath.length() > 0){
+    MetricSelectionFunctions::writeMetricRequirements(metricRequirementsPath,
+                                                      metricSelection);
+  }
 
+  std::filesystem::current_path(fundamentalFolder);
 
-        
-        metricAnalysisJson[date]= analysisEntry;        
-        ++entryCount;
+  //============================================================================
+  // Load the curency unit table
+  //============================================================================
+  bool validConfigCurrencyUnitsFile 
+        = JsonFunctions::loadJsonFile(cc.currency_units_json_file,
+                                      currencyUnits, verbose);                                                    
+  
+  if(!validConfigCurrencyUnitsFile){
+    std::cerr << "Error: could not load the configration file " 
+              <<  configurationFile << std::endl;
+    std::abort();
+  }  
+
+  //The FOREX series are read from forexFolder as they are needed
+  ForexFunctions::ForexStore forexStore;
+  ForexFunctions::createForexStore(forexFolder, currencyUnits, forexStore);
+  
+  //============================================================================
+  // Load the reference tables: the corporate tax rate table, the default 
+  // spread table, the 10 year bond yield table, and the equity risk premium
+  // by country table. 
+  //
+  // Note: 1. Right now I only have historical data for the US, and so I'm
+  //          approximating the bond yield of all countries using US data.
+  //          This is probably approximately correct for wealthy developed
+  //          countries that have access to international markets, but is 
+  //          terrible for countries outside of this group.
+  //
+  // The parsed tables are written to a binary snapshot, which is read 
+  // instead on the next run if none of these files have changed.
+  //============================================================================
+  ReferenceDataSet referenceData;
+  ReferenceDataFunctions::ReferenceTables &tables = referenceData.tables;
+
+  std::vector< std::string > referenceFiles;
+  referenceFiles.push_back(cc.world_corporate_tax_rate_csv_file);
+  referenceFiles.push_back(cc.default_spread_json_file);
+  referenceFiles.push_back(cc.bond_yield_json_file);
+  referenceFiles.push_back(cc.equity_risk_premium_by_country_json_file);
+  uint64_t referenceSourceHash = 
+    ReferenceDataFunctions::calcSourceHash(referenceFiles, 
+                                           setNansToMissingValue);
+
+  bool loadedSnapshot = 
+    ReferenceDataFunctions::readSnapshot(referenceSnapshotPath,
+                                         referenceSourceHash, tables);
+  if(loadedSnapshot && verbose){
+    std::cout << std::endl;
+    std::cout << "Loaded the reference tables from " 
+              << referenceSnapshotPath << std::endl;
+  }
+
+  if(!loadedSnapshot){
+
+    //Corporate tax rates
+    tables.usingTaxTable=false;
+    if(cc.world_corporate_tax_rate_csv_file.length() > 0){
+      tables.usingTaxTable=true;
+      ReferenceDataFunctions::TaxFoundationDataSet corpWorldTaxTable;
+      bool validFormat = ReferenceDataFunctions::
+        loadTaxFoundationDataSet(cc.world_corporate_tax_rate_csv_file,
+                                 corpWorldTaxTable);
+      if(validFormat){
+        validFormat = ReferenceDataFunctions::
+          buildTaxRateTable(corpWorldTaxTable, tables.taxRates);
       }
 
+      if(!validFormat){
+        tables.usingTaxTable=false;
+        std::cout << "Warning: could not load the world corporate tax rate file "
+                  << cc.world_corporate_tax_rate_csv_file << std::endl;
+        std::cout << "Reverting to the default rate " << std::endl;
+      }
+    }
 
-      nlohmann::ordered_json sp500LiqudityMetricJson;
-      std::string fundKeyWord(" 500");
-      int daysToAverageTradingVolumeOver=28; //trailing four weeks
-      std::string parentNameFund("sp500_");
-      double liquidityIndex = 
-        FinancialAnalysisFunctions::
-          calcStockLiquidityRelativeToFundHoldings(
-            fundKeyWord,
-            fundamentalData,
-            historicalData,
-            daysToAverageTradingVolumeOver,
-            timePeriod.c_str(),
-            setNansToMissingValue,
-            parentNameFund,
-            sp500LiqudityMetricJson);
-
-      nlohmann::ordered_json dataDatesReport;
-      dataDatesReport["cash_flow"]         = analysisDates.recentCashFlowDate;
-      dataDatesReport["income_statement"]  = analysisDates.recentIncomeStatementDate;
-      dataDatesReport["balance_sheet"]     = analysisDates.recentBalanceSheetDate;
-      dataDatesReport["earnings"]          = analysisDates.recentEarningsHistoryDate;
-      dataDatesReport["outstanding_shares"]= analysisDates.recentOutstandingSharesDate;
-      dataDatesReport["historical_data"]   = analysisDates.recentHistoricalDate;
-      dataDatesReport["bond_rates_usa"]    = analysisDates.recentBondDate;    
-
-      std::string defaultSpreadDate;
-      JsonFunctions::getJsonString(jsonDefaultSpread["US"]["access_date"],
-                                    defaultSpreadDate);
-      dataDatesReport["default_spread_usa"]= defaultSpreadDate;
-      
-      std::string riskByCountryDataDate;
+    //Default spreads
+    std::ifstream defaultSpreadFileStream(cc.default_spread_json_file.c_str());
+    nlohmann::ordered_json jsonDefaultSpread = 
+      nlohmann::ordered_json::parse(defaultSpreadFileStream);
+
+    bool validDefaultSpreadTable = ReferenceDataFunctions::
+      loadDefaultSpreadTable(jsonDefaultSpread, setNansToMissingValue,
+                             tables.defaultSpreads);
+    if(!validDefaultSpreadTable){
+      std::cerr << "Error: there is no [\"US\"][\"default_spread\"] table in "
+                << cc.default_spread_json_file << std::endl;
+      std::abort();
+    }
+    JsonFunctions::getJsonString(jsonDefaultSpread["US"]["access_date"],
+                                 tables.defaultSpreadDate);
+
+    //10 year bond yields
+    std::ifstream bondYieldFileStream(cc.bond_yield_json_file.c_str());
+    nlohmann::ordered_json jsonBondYield = 
+      nlohmann::ordered_json::parse(bondYieldFileStream);
+
+    bool validBondYieldTable = ReferenceDataFunctions::
+      loadBondYieldTable(jsonBondYield, setNansToMissingValue,
+                         tables.bondYields);
+    if(!validBondYieldTable){
+      std::cerr << "Error: there is no [\"US\"][\"10y_bond_yield\"] table in "
+                << cc.bond_yield_json_file << std::endl;
+      std::abort();
+    }
+
+    //Equity risk premium by country
+    nlohmann::ordered_json riskByCountryData;
+    tables.validRiskTable = JsonFunctions::loadJsonFile( 
+                                cc.equity_risk_premium_by_country_json_file, 
+                                riskByCountryData, 
+                                verbose);
+    if(tables.validRiskTable){
+      ReferenceDataFunctions::loadCountryRiskTable(riskByCountryData, 
+                                                   tables.countryRisk);
       JsonFunctions::getJsonString(riskByCountryData["compilation_date"],
-                                   riskByCountryDataDate);
-      dataDatesReport["country_risk"]= riskByCountryDataDate;
-      dataDatesReport["global_corporate_tax_rates_historical"]= "2023-12-31";
+                                   tables.countryRiskDate);
+    }
 
+    bool writtenSnapshot = 
+      ReferenceDataFunctions::writeSnapshot(referenceSnapshotPath,
+                                            referenceSourceHash, tables);
+    if(!writtenSnapshot){
+      std::cout << "Warning: could not write the reference table snapshot "
+                << referenceSnapshotPath << std::endl;
+    }
+  }
 
-      nlohmann::ordered_json stringDataReport;
-      stringDataReport["home_country"] = homeRiskTable.CountryISO3;
-      stringDataReport["firm_country"] = riskTable.CountryISO3;
+  if(verbose){
+    std::cout << std::endl;
+    std::cout << "default spread table" << std::endl;
+    std::cout << '\t'
+              << "Interest Coverage Interval" 
+              << '\t'
+              << '\t' 
+              << "default spread" << std::endl;
+    const ReferenceDataFunctions::DefaultSpreadTable &defaultSpreads 
+      = tables.defaultSpreads;
+    std::streamsize coutPrecision = std::cout.precision(15);
+    for(size_t i=0; i<defaultSpreads.defaultSpread.size(); ++i){
+      std::cout << '\t' << defaultSpreads.interestCoverLowerBound[i] << '\t'
+                << '\t' << defaultSpreads.interestCoverUpperBound[i] << '\t'
+                << '\t' << defaultSpreads.defaultSpread[i] << '\t'
+                << std::endl;
+    }
+    std::cout.precision(coutPrecision);
 
+    std::cout << std::endl;
+    std::cout << "bond yield table with " 
+              << tables.bondYields.dates.size()
+              << " entries from "
+              << tables.bondYields.dates.front()
+              << " to "
+              << tables.bondYields.dates.back()
+              << std::endl;
+    std::cout << "  Warning**" << std::endl; 
+    std::cout << "    The 10 year bond yields from the US are being used to " 
+              << std::endl;          
+    std::cout << "    approximate the bond yields for countries that do not"
+              << std::endl; 
+    std::cout << "    appear in Prof. Damodaran's country risk tables."
+              << std::endl;               
+    std::cout << "    This will not make sense for a business in a country"
+              << std::endl; 
+    std::cout << "    with a risk free rate that differs substantially from"    
+              << std::endl; 
+    std::cout << "    the US."    
+              << std::endl; 
+    std::cout << std::endl;
 
+    if(tables.validRiskTable){
+      std::cout << std::endl;
+      std::cout << "Loaded the equity-risk-premium by country table: "
+                << std::endl;
+    }else{
+      std::cout << std::endl;
+      std::cout << "Error: failed to load the equity-risk-premium by country table:"
+                << cc.equity_risk_premium_by_country_json_file
+                << std::endl;
+    }
+  }
 
-      nlohmann::ordered_json annualMilestoneReport;
-      annualMilestoneReport["years_since_IPO"] 
-        = annualMilestones.yearsSinceIPO;
-      annualMilestoneReport["years_reported"] 
-        = annualMilestones.yearsOnRecord;
-      annualMilestoneReport["years_value_created"] 
-        = annualMilestones.yearsOfPositiveValueCreation;
-      annualMilestoneReport["years_with_dividend"] 
-        = dividendInfo.yearsWithADividend;
-      annualMilestoneReport["fraction_of_years_with_a_dividend"]
-        = dividendInfo.fractionOfYearsWithDividends;
-      annualMilestoneReport["fraction_of_years_with_a_dividend_increases"]
-        = dividendInfo.fractionOfYearsWithDividendIncreases;
-      annualMilestoneReport["mean_dividend_payout_ratio"]
-        = dividendInfo.meanDividendPayoutRatio;
-      annualMilestoneReport["mean_dividend_freecashflow_ratio"]
-        = dividendInfo.meanDividendFreeCashFlowRatio;
-      annualMilestoneReport["mean_dividend_yield"]
-        = dividendInfo.meanDividendYield;
-      if(dividendsYieldGrowthModelAvg.model.size()>=1){
-        annualMilestoneReport["mean_dividend_yield_growth"]
-          = dividendsYieldGrowthModelAvg.model[0].annualGrowthRateOfTrendline;
-      }else{
-        annualMilestoneReport["mean_dividend_yield_growth"]
-          = std::nan("1");
-      }
-      annualMilestoneReport["mean_freecashflow_yield"]
-        = dividendInfo.meanFreeCashFlowYield;
-      annualMilestoneReport["mean_freecashflow_less_dividend_yield"]
-        = dividendInfo.meanFreeCashFlowLessDividendsYield;
+  //
+  // Get the risk table entry for the home country
+  //
+  double defaultInflationRate = 0.;
+  bool homeRiskTableFound=false;
 
-        
+  if(tables.validRiskTable){
+    const ReferenceDataFunctions::CountryRiskDataSet *homeCountryRisk = 
+      ReferenceDataFunctions::findCountryByISO3(tables.countryRisk,
+                                                nameOfHomeCountryISO3);
+    if(homeCountryRisk != nullptr){
+      referenceData.homeRiskTable = *homeCountryRisk;
+      homeRiskTableFound=true;
+    }
+  }
 
-      //
-      // Recent valuation
-      //
-      nlohmann::ordered_json recentPriceToValueJson;
-
-      if(recentPriceToValue.size()>0){
-        recentPriceToValueJson["date"]
-          = recentPriceToValue[0].recentDate;
-        recentPriceToValueJson["price"] 
-          = recentPriceToValue[0].adjustedClosePrice;
-        recentPriceToValueJson["price_current"] 
-          = recentPriceToValue[0].recentAdjustedClosePrice;
-        recentPriceToValueJson["outstandingShares"] 
-          = recentPriceToValue[0].numberOfShares;
-        recentPriceToValueJson["outstandingShares_current"] 
-          = recentPriceToValue[0].recentNumberOfShares;
-        recentPriceToValueJson["marketCapitalization"] 
-          = recentPriceToValue[0].marketCapitalization;
-        recentPriceToValueJson["marketCapitalization_current"] 
-          = recentPriceToValue[0].recentMarketCapitalization;           
-        recentPriceToValueJson["scaleFactor"] 
-          = recentPriceToValue[0].scaleFactor;
-        recentPriceToValueJson["enterpriseValue"] 
-          = valuationMetricSummary.enterpriseValue;  
-        recentPriceToValueJson["enterpriseValue_current"] 
-          = valuationMetricSummary.enterpriseValueRecent;
-        recentPriceToValueJson["enterpriseValueEOD"] 
-          = valuationMetricSummary.enterpriseValueEOD;  
-        recentPriceToValueJson["enterpriseValueEOD_current"] 
-          = valuationMetricSummary.enterpriseValueEODRecent;  
-
-        recentPriceToValueJson["operatingIncome"] 
-          = valuationMetricSummary.operatingIncome;  
-        recentPriceToValueJson["ebitda"] 
-          = valuationMetricSummary.ebitda;  
-
-        recentPriceToValueJson["acquirersMultiple"] 
-          = valuationMetricSummary.acquirersMultiple;  
-        recentPriceToValueJson["acquirersMultiple_current"] 
-          = valuationMetricSummary.acquirersMultipleRecent;  
-
-        recentPriceToValueJson["acquirersMultipleEOD"] 
-          = valuationMetricSummary.acquirersMultipleEOD;  
-        recentPriceToValueJson["acquirersMultipleEOD_current"] 
-          = valuationMetricSummary.acquirersMultipleEODRecent;  
-
-        recentPriceToValueJson["enterpriseValueEbitdaEOD"] 
-          = valuationMetricSummary.enterpriseValueEbitdaEOD;  
-        recentPriceToValueJson["enterpriseValueEbitdaEOD_current"] 
-          = valuationMetricSummary.enterpriseValueEbitdaEODRecent;  
-
-        recentPriceToValueJson["acquirersMultipleAbs"] 
-          = std::abs(valuationMetricSummary.acquirersMultiple);  
-        recentPriceToValueJson["acquirersMultipleAbs_current"] 
-          = std::abs(valuationMetricSummary.acquirersMultipleRecent);  
-
-        recentPriceToValueJson["acquirersMultipleAbsEOD"] 
-          = std::abs(valuationMetricSummary.acquirersMultipleEOD);  
-        recentPriceToValueJson["acquirersMultipleAbsEOD_current"] 
-          = std::abs(valuationMetricSummary.acquirersMultipleEODRecent);  
-
-        recentPriceToValueJson["enterpriseValueEbitdaAbsEOD"] 
-          = std::abs(valuationMetricSummary.enterpriseValueEbitdaEOD);  
-        recentPriceToValueJson["enterpriseValueEbitdaAbsEOD_current"] 
-          = std::abs(valuationMetricSummary.enterpriseValueEbitdaEODRecent);  
-
-
-        //It can happen that the last date at which an FCF valuation method
-        //and an EPS method can be evaluated differs. In this case the
-        //scaleFactor will differ, and this isn't a problem. Each valuation 
-        //method just has its own set of reference dates and corresponding
-        //scaleFactors
-        /*
-        double scaleFactor = recentPriceToValue[0].scaleFactor;
-        for(size_t i=0; i< recentPriceToValue.size();++i){
-          if(std::abs(scaleFactor-recentPriceToValue[i].scaleFactor) > 1e-6){
-            std::cerr << "Error: Every current valuation calculation should "
-                      << "use the same scale factor: price_current/price, where"
-                      << "price is the price used in the valuation."
-                      << std::endl;
-            std::abort();
-          }
-        }
-        */
+  if(homeRiskTableFound){
+    if(dateToday >= 2024){
+      defaultInflationRate = referenceData.homeRiskTable.inflation_2024_2028;
+    }else{
+      defaultInflationRate = referenceData.homeRiskTable.inflation_2019_2023;
+    }
+  }
+  referenceData.defaultInflationRate = defaultInflationRate;
+  referenceData.forexStore = &forexStore;
 
-        for(size_t i =0; i  < recentPriceToValue.size();++i){
-          std::string fieldName = recentPriceToValue[i].name;
-          recentPriceToValueJson[fieldName] 
-            = recentPriceToValue[i].priceToValue;
+  std::vector< std::string > fundKeyWords;
+  for(auto const &family : cc.fund_liquidity_families){
+    fundKeyWords.push_back(family.keyword);
+  }
+  StringFunctions::createKeywordMatcher(fundKeyWords,
+                                        referenceData.fundKeyWordMatcher);
+  JsonFunctions::createSectionFilter(FUNDAMENTAL_SECTIONS,
+                                     referenceData.fundamentalSections);
 
-          fieldName.append("_current");
-          recentPriceToValueJson[fieldName] 
-            = recentPriceToValue[i].recentPriceToValue;
-        }
-      }        
-      //
-      // dividend growth
-      //      
-      nlohmann::ordered_json dividendGrowthModelJson;
-      NumericalFunctions::appendMetricGrowthModelRecent(
-        dividendGrowthModelJson,
-        dividendsPaidGrowthModel,"");
-      
-      nlohmann::ordered_json dividendGrowthModelAvgJson;
-      if(dividendsPaidGrowthModelAvg.datesNumerical.size()>0){
-        NumericalFunctions::appendEmpiricalGrowthModelRecent(
-          dividendGrowthModelAvgJson,
-          dividendsPaidGrowthModelAvg.model[0],"");
-      }
+  //============================================================================
+  // The reference data is only read from this point onwards
+  //============================================================================
+  CalculateSettings settings;
+  settings.fundamentalFolder      = fundamentalFolder;
+  settings.historicalFolder       = historicalFolder;
+  settings.analyseFolder          = analyseFolder;
+  settings.validFileExtension     = validFileExtension;
+  settings.timePeriod             = timePeriod;
+  settings.quarterlyTTMAnalysis   = quarterlyTTMAnalysis;
+  settings.verbose                = verbose;
+  settings.setNansToMissingValue  = setNansToMissingValue;
+  settings.appendTermRecord       = appendTermRecord;
+  settings.cc                     = cc;
+  settings.acceptableBackwardsYearErrorForTaxRate 
+    = acceptableBackwardsYearErrorForTaxRate;
+  settings.maxDayErrorHistoricalData        = maxDayErrorHistoricalData;
+  settings.maxDayErrorBondYieldData         = maxDayErrorBondYieldData;
+  settings.maxDayErrorTTM                   = maxDayErrorTTM;
+  settings.maxDayErrorOutstandingShareData  = maxDayErrorOutstandingShareData;
+  settings.maxProportionOfOutliersInExpModel 
+    = maxProportionOfOutliersInExpModel;
+  settings.minPriceAllowedInPriceModel      = minPriceAllowedInPriceModel;
+  settings.minCycleTimeInYears              = minCycleTimeInYears;
+  settings.exponentialModelR2Preference     = exponentialModelR2Preference;
+  settings.maxDateErrorInYearsInEmpiricalData 
+    = maxDateErrorInYearsInEmpiricalData;
+  settings.peMarketVariationUpperBound      = peMarketVariationUpperBound;
+  settings.incremental                      = incrementalCalculation;
+  settings.reusePreviousResults             = 
+    (incrementalCalculation && !forceCalculation);
+  settings.stateFolder                      = stateFolder;
+  settings.ttmAnalyseFolder                 = ttmAnalyseFolder;
+  settings.metrics                          = metricSelection;
+  settings.monteCarloThreads                = monteCarloThreads;
+  settings.priceModelResampling             = priceModelResampling;
 
-      //
-      // dividend yield growth
-      //      
-      nlohmann::ordered_json dividendYieldGrowthModelJson;
-      NumericalFunctions::appendMetricGrowthModelRecent(
-        dividendYieldGrowthModelJson,
-        dividendsYieldGrowthModel,"");
-      
-      nlohmann::ordered_json dividendYieldGrowthModelAvgJson;
-      if(dividendsYieldGrowthModelAvg.datesNumerical.size()>0){
-        NumericalFunctions::appendEmpiricalGrowthModelRecent(
-          dividendYieldGrowthModelAvgJson,
-          dividendsYieldGrowthModelAvg.model[0],"");
+  //============================================================================
+  // Service mode: the tickers are sent as requests rather than read from the
+  // fundamental folder. The incremental state and manifests are not used.
+  //============================================================================
+  if(serviceSocketPath.length() > 0){
+    settings.incremental          = false;
+    settings.reusePreviousResults = false;
+    std::string configurationPath = 
+      (startingDirectory / configurationFile).string();
+    bool served = runCalculationService(serviceSocketPath, configurationPath,
+                                        settings, referenceData, verbose);
+    return served ? 0 : 1;
+  }
+
+  //============================================================================
+  //
+  // Evaluate every file in the fundamental folder
+  //
+  //============================================================================  
+  std::vector< std::string > tickerFileNames;
+
+  if(loadSingleTicker){
+    std::string fileName  = singleFileToEvaluate;
+    size_t idx = singleFileToEvaluate.find(".json");
+    if(idx == std::string::npos){
+      fileName.append(".json");
+    }
+    tickerFileNames.push_back(fileName);
+  }else{
+    for ( const auto & entry 
+            : std::filesystem::directory_iterator(fundamentalFolder)){
+      std::string fileName=entry.path().filename();
+      if(fileName.find(validFileExtension) != std::string::npos){
+        tickerFileNames.push_back(fileName);
       }
+    }
+    //Sort the files so that the tickers are numbered (and logged) in the
+    //same order from one run to the next
+    std::sort(tickerFileNames.begin(),tickerFileNames.end());
+  }
 
-      //
-      // growth of equity
-      //   equityGrowthModel   
-      //   equityGrowthModelAvg
-      //
+  //============================================================================
+  // The listings that share a primary are evaluated together and write the 
+  // same output file, and so they are assigned to a shard by the name of the
+  // primary rather than by their own name.
+  //============================================================================
+  std::vector< std::string > shardKeys;
+  if(shard.enabled){
+    shardKeys.resize(tickerFileNames.size());
+    ParallelFunctions::runWorkStealingLoop(
+      tickerFileNames.size(),
+      numberOfThreads,
+      false,
+      [&](size_t indexTicker, int){
+        const std::string &fileName = tickerFileNames[indexTicker];
+        try{
+          shardKeys[indexTicker] = 
+            getPrimaryFileName(fundamentalFolder,fileName);
+        }catch(const std::exception &e){
+          std::cerr << "Warning: " << fileName << ": could not find its "
+                    << "primary listing: " << e.what() << std::endl;
+          shardKeys[indexTicker] = fileName;
+        }
+      });
+  }
 
-      nlohmann::ordered_json equityGrowthModelJson;
-      NumericalFunctions::appendMetricGrowthModelRecent(
-        equityGrowthModelJson,
-        equityGrowthModel,"");
+  ShardFunctions::ShardManifest manifest;
+  ShardFunctions::selectShard("calculate",shard,tickerFileNames,manifest,
+                              shard.enabled ? &shardKeys : nullptr);
+  manifest.entries.resize(tickerFileNames.size());
 
-      nlohmann::ordered_json equityGrowthModelAvgJson;
-      if(equityGrowthModelAvg.datesNumerical.size() > 0){        
-        NumericalFunctions::appendEmpiricalGrowthModelRecent(
-            equityGrowthModelAvgJson,
-            equityGrowthModelAvg.model[0],"");
+  //============================================================================
+  // Load the calculation manifest from the previous run. If the configuration
+  // or the reference tables have changed every ticker is evaluated again.
+  //============================================================================
+  std::string configurationHash = calcConfigurationHash(settings);
+  std::string referenceDataHash = 
+    calcReferenceDataHash(cc,nameOfHomeCountryISO3,defaultInflationRate);
+  settings.calculationHash = configurationHash + referenceDataHash;
+
+  //With -Q each ticker is also analysed using quarterly TTM data
+  bool analyseBothPeriods = (ttmAnalyseFolder.length()>0);
+  CalculateSettings ttmSettings = settings;
+  ttmSettings.timePeriod            = Q;
+  ttmSettings.quarterlyTTMAnalysis  = true;
+  ttmSettings.analyseFolder         = ttmAnalyseFolder;
+  ttmSettings.stateFolder           = ttmStateFolder;
+  ttmSettings.calculationHash       = 
+    calcConfigurationHash(ttmSettings) + referenceDataHash;
+
+  nlohmann::ordered_json previousTickerRecords = nlohmann::ordered_json::object();
+  bool usePreviousManifest = false;
+
+  if(!forceCalculation 
+      && std::filesystem::exists(calculationManifestPath)){
+    nlohmann::ordered_json previousManifest;
+    bool loaded = JsonFunctions::loadJsonFile(calculationManifestPath,
+                                              previousManifest, verbose);
+    if(loaded && previousManifest.contains("configuration_hash")
+              && previousManifest.contains("reference_data_hash")
+              && previousManifest.contains("tickers")){
+      std::string previousConfigurationHash;
+      std::string previousReferenceDataHash;
+      JsonFunctions::getJsonString(previousManifest["configuration_hash"],
+                                   previousConfigurationHash);
+      JsonFunctions::getJsonString(previousManifest["reference_data_hash"],
+                                   previousReferenceDataHash);
+      if(previousConfigurationHash.compare(configurationHash)==0
+        && previousReferenceDataHash.compare(referenceDataHash)==0){
+        previousTickerRecords = previousManifest["tickers"];
+        usePreviousManifest = true;
+      }else if(verbose){
+        std::cout << "The configuration or the reference tables have changed "
+                  << "since the last run: every ticker will be evaluated" 
+                  << std::endl;
       }
+    }
+  }
 
-      //
-      // growth of earnings per share
-      //    epsGrowthModel
-      //    epsGrowthModelAvg
-
-      nlohmann::ordered_json epsGrowthModelJson;
-      NumericalFunctions::appendMetricGrowthModelRecent(
-        epsGrowthModelJson,
-        epsGrowthModel,"");
-
-      nlohmann::ordered_json epsGrowthModelAvgJson;
-      if(epsGrowthModelAvg.datesNumerical.size() > 0){
-        NumericalFunctions::appendEmpiricalGrowthModelRecent(
-            epsGrowthModelAvgJson,
-            epsGrowthModelAvg.model[0],"");
-      }
+  std::vector< nlohmann::ordered_json > tickerRecords(tickerFileNames.size());
 
-      //
-      // growth of gross profit
-      //    grossProfitGrowthModel
-      //    grossProfitGrowthModelAvg
-
-      nlohmann::ordered_json grossProfitGrowthModelJson;
-      NumericalFunctions::appendMetricGrowthModelRecent(
-        grossProfitGrowthModelJson,
-        grossProfitGrowthModel,"");
-
-      nlohmann::ordered_json grossProfitGrowthModelAvgJson;
-      if(grossProfitGrowthModelAvg.datesNumerical.size() > 0){
-        NumericalFunctions::appendEmpiricalGrowthModelRecent(
-            grossProfitGrowthModelAvgJson,
-            grossProfitGrowthModelAvg.model[0],"");
-      }
+  auto startTime = std::chrono::steady_clock::now();
 
+  //============================================================================
+  // The journal records each ticker as soon as it has been evaluated. If a
+  // run with the same configuration was stopped, the tickers in its journal
+  // are not evaluated again.
+  //============================================================================
+  std::map< std::string, size_t > tickerIndices;
+  for(size_t i=0; i<tickerFileNames.size(); ++i){
+    tickerIndices[tickerFileNames[i]] = i;
+  }
 
-      //
-      // growth of free cash flow
-      //    fcfGrowthModel 
-      //    fcfGrowthModelAvg
-
-      nlohmann::ordered_json fcfGrowthModelJson;
-      NumericalFunctions::appendMetricGrowthModelRecent(
-        fcfGrowthModelJson,
-        fcfGrowthModel,"");
-
-      nlohmann::ordered_json fcfGrowthModelAvgJson;
-      if(fcfGrowthModelAvg.datesNumerical.size() > 0){
-        NumericalFunctions::appendEmpiricalGrowthModelRecent(
-            fcfGrowthModelAvgJson,
-            fcfGrowthModelAvg.model[0],"");
+  std::vector< nlohmann::ordered_json > journalEntries;
+  SupervisorFunctions::openJournal(journalPath,settings.calculationHash,
+                                   journalEntries);
+  std::vector< bool > resumed(tickerFileNames.size(),false);
+  for(auto const &entry : journalEntries){
+    size_t indexTicker = 0;
+    if(restoreJournalEntry(entry,tickerIndices,tickerRecords,
+                           manifest.entries,indexTicker)){
+      resumed[indexTicker] = true;
+    }
+  }
+  if(verbose && !journalEntries.empty()){
+    std::cout << "Resuming: " << journalEntries.size() 
+              << " tickers were evaluated by a previous run that stopped" 
+              << std::endl;
+  }
+
+  //============================================================================
+  // Find the tickers that have to be evaluated, and the primary listing of
+  // each of them
+  //============================================================================
+  //Empty for the tickers that are unchanged or resumed
+  std::vector< std::string > primaryFileNames(tickerFileNames.size());
+
+  ParallelFunctions::runWorkStealingLoop(
+    tickerFileNames.size(),
+    numberOfThreads,
+    true,
+    [&](size_t indexTicker, int){
+      ShardFunctions::ShardManifestEntry &manifestEntry 
+        = manifest.entries[indexTicker];
+      manifestEntry.ticker = 
+        ShardFunctions::getTickerName(tickerFileNames[indexTicker]);
+      if(shard.enabled){
+        manifestEntry.shardKey = 
+          ShardFunctions::getTickerName(shardKeys[indexTicker]);
       }
 
-      //
-      // growth of revenue
-      //    revenueGrowthModel 
-      //    revenueGrowthModelAvg
-
-      nlohmann::ordered_json revenueGrowthModelJson;
-      NumericalFunctions::appendMetricGrowthModelRecent(
-        revenueGrowthModelJson,
-        revenueGrowthModel,"");
-
-      nlohmann::ordered_json revenueGrowthModelAvgJson;
-      if(revenueGrowthModelAvg.datesNumerical.size() > 0){
-        NumericalFunctions::appendEmpiricalGrowthModelRecent(
-            revenueGrowthModelAvgJson,
-            revenueGrowthModelAvg.model[0],"");
-      }      
+      if(resumed[indexTicker]){
+        return;
+      }
 
-      //
-      // Avg empirical model
-      //
+      const std::string &fileName = tickerFileNames[indexTicker];
+      nlohmann::ordered_json &tickerRecord = tickerRecords[indexTicker];
+
+      //A malformed record or file means that the ticker is evaluated, 
+      //using its own data, rather than that the batch stops
+      bool unchanged = false;
+      try{
+        if(usePreviousManifest && previousTickerRecords.contains(fileName)){
+          unchanged = isTickerUnchanged(previousTickerRecords.at(fileName),
+                                        analyseFolder, ttmAnalyseFolder,
+                                        tickerRecord);
+        }
+      }catch(const std::exception &e){
+        std::cerr << "Warning: " << fileName << ": could not read its record "
+                  << "in the calculation manifest: " << e.what() << std::endl;
+        tickerRecord.clear();
+        unchanged = false;
+      }
 
-      nlohmann::ordered_json atoiGrowthModelAverageJson;
-      if(empiricalGrowthDataAll.datesNumerical.size() > 0){
-        NumericalFunctions::appendEmpiricalGrowthModelRecent(
-            atoiGrowthModelAverageJson,
-            empiricalGrowthDataAll,"");
+      if(unchanged){
+        if(verbose){
+          std::cout << indexTicker+1 << "." << '\t' << fileName << '\t'
+                    << "unchanged" << std::endl;
+        }
+        manifestEntry.status = ShardFunctions::UNCHANGED;
+      }else{
+        try{
+          primaryFileNames[indexTicker] = shard.enabled 
+            ? shardKeys[indexTicker]
+            : getPrimaryFileName(fundamentalFolder,fileName);
+        }catch(const std::exception &e){
+          std::cerr << "Warning: " << fileName << ": could not find its "
+                    << "primary listing: " << e.what() << std::endl;
+          primaryFileNames[indexTicker] = fileName;
+        }
       }
+    });
 
-      //
-      // Recent empirical data
-      //
+  std::vector< std::vector< size_t > > listingGroups;
+  groupListingsByPrimary(tickerFileNames,primaryFileNames,listingGroups);
 
-      nlohmann::ordered_json atoiGrowthModelRecentJson;      
-      if(empiricalGrowthData.datesNumerical.size()>0){
-        NumericalFunctions::appendEmpiricalGrowthModelRecent(
-            atoiGrowthModelRecentJson,
-            empiricalGrowthData,"");
+  //============================================================================
+  // Evaluate the primary of each group once. The other listings of the group
+  // are recorded as aliases of the listing that was evaluated.
+  //============================================================================
+  auto evaluateListing = [&](size_t indexTicker, 
+                             std::string &outputFileNameUpd) -> bool {
+    ShardFunctions::ShardManifestEntry &manifestEntry 
+      = manifest.entries[indexTicker];
+    const std::string &fileName = tickerFileNames[indexTicker];
+    nlohmann::ordered_json &tickerRecord = tickerRecords[indexTicker];
+
+    auto tickerStartTime = std::chrono::steady_clock::now();
+
+    bool analysisWritten = false;
+    tickerRecord.clear();
+    outputFileNameUpd.clear();
+    ProfilingFunctions::TickerScope tickerScope(fileName);
+    try{
+      std::vector< std::string > inputFilePaths;
+      //The scratch data of the ticker is released when it is done
+      ArenaFunctions::TickerScope tickerArena;
+      TickerInputCache inputCache;
+      analysisWritten = 
+        calculateTicker(fileName,
+                        static_cast<int>(indexTicker)+1,
+                        settings,
+                        referenceData,
+                        inputFilePaths,
+                        outputFileNameUpd,
+                        nullptr,
+                        analyseBothPeriods ? &inputCache : nullptr);
+
+      //The quarterly TTM analysis uses the inputs that were loaded for the
+      //yearly analysis
+      std::string ttmOutputFileName;
+      if(analyseBothPeriods){
+        std::vector< std::string > ttmInputFilePaths;
+        bool ttmAnalysisWritten = 
+          calculateTicker(fileName,
+                          static_cast<int>(indexTicker)+1,
+                          ttmSettings,
+                          referenceData,
+                          ttmInputFilePaths,
+                          ttmOutputFileName,
+                          nullptr,
+                          &inputCache);
+        analysisWritten = (analysisWritten || ttmAnalysisWritten);
+      }
+      manifestEntry.status = analysisWritten ? 
+        ShardFunctions::PROCESSED : ShardFunctions::SKIPPED;
+
+      nlohmann::ordered_json inputs = nlohmann::ordered_json::array();
+      for(auto const &inputFilePath : inputFilePaths){
+        nlohmann::ordered_json inputRecord;
+        recordInputFile(inputFilePath,inputRecord);
+        inputs.push_back(inputRecord);
       }
+      tickerRecord["inputs"] = inputs;
+      tickerRecord["output"] = outputFileNameUpd;
+      if(analyseBothPeriods){
+        tickerRecord["ttm_output"] = ttmOutputFileName;
+        //The name of the listing that was evaluated, whichever of the two
+        //analyses was written
+        if(outputFileNameUpd.length()==0){
+          outputFileNameUpd = ttmOutputFileName;
+        }
+      }
+    }catch(const std::exception &e){
+      std::cerr << "Error: " << fileName 
+                << " failed: " << e.what() << std::endl;
+      manifestEntry.status = ShardFunctions::FAILED;
+      tickerRecord.clear();
+      analysisWritten = false;
+    }
 
-      //
-      // Append revenue to fcf model
-      //
-      //
+    std::chrono::duration<double> tickerElapsedTime = 
+      std::chrono::steady_clock::now()-tickerStartTime;
+    manifestEntry.elapsedTimeInSeconds = tickerElapsedTime.count();
+
+    SupervisorFunctions::appendJournalEntry(journalPath,
+      createJournalEntry(fileName,manifestEntry,tickerRecord));
+    return analysisWritten;
+  };
+
+  auto evaluateListingGroup = [&](size_t indexGroup){
+    const std::vector< size_t > &listings = listingGroups[indexGroup];
+    size_t indexPrimary = listings[0];
+
+    std::string outputFileName;
+    bool primaryWritten = evaluateListing(indexPrimary,outputFileName);
+
+    //If the primary could not be loaded each listing falls back to its
+    //own data, and so has to be evaluated separately
+    bool primaryEvaluated = primaryWritten 
+      && outputFileName.compare(primaryFileNames[indexPrimary])==0;
+
+    for(size_t i=1; i<listings.size(); ++i){
+      size_t indexTicker = listings[i];
+      if(!primaryEvaluated){
+        std::string listingOutputFileName;
+        evaluateListing(indexTicker,listingOutputFileName);
+        continue;
+      }
+      const std::string &fileName = tickerFileNames[indexTicker];
+      if(verbose){
+        std::cout << indexTicker+1 << "." << '\t' << fileName << '\t'
+                  << "alias of " << tickerFileNames[indexPrimary] 
+                  << std::endl;
+      }
+      writeAliasRecord(fundamentalFolder,
+                       fileName,
+                       tickerFileNames[indexPrimary],
+                       tickerRecords[indexPrimary],
+                       tickerRecords[indexTicker]);
+      manifest.entries[indexTicker].status = ShardFunctions::PROCESSED;
+      SupervisorFunctions::appendJournalEntry(journalPath,
+        createJournalEntry(fileName,manifest.entries[indexTicker],
+                           tickerRecords[indexTicker]));
+    }
+  };
+
+  //============================================================================
+  // Profiling: the phases of each ticker are timed from here on. The path is
+  // resolved against the starting directory because the working directory 
+  // is now the fundamental folder.
+  //============================================================================
+  std::string profileTracePath;
+  if(profilePath.length()>0){
+    std::filesystem::path profileFilePath = 
+      startingDirectory / std::filesystem::path(profilePath);
+    profilePath = profileFilePath.string();
+    profileTracePath = ( profileFilePath.parent_path() 
+      / (profileFilePath.stem().string()+"_trace.json") ).string();
+    if(numberOfWorkers > 0){
+      std::cerr << "Warning: the profile is not recorded when the tickers "
+                << "are evaluated in worker processes" << std::endl;
+    }else{
+      ProfilingFunctions::enable();
+    }
+  }
 
-      nlohmann::ordered_json revenueFcfModelJson;
-      if(revenueFcfModel.dateModel.size()>0){
-        NumericalFunctions::appendEmpiricalGrowthModelRecent(
-          revenueFcfModelJson,
-          revenueFcfModel.model[0],"");
+  if(numberOfWorkers > 0){
+    //Each group is evaluated in a worker process. A group whose worker 
+    //crashes is recorded as failed and the rest of the batch carries on. 
+    //The results are passed back through the journal.
+    std::vector< SupervisorFunctions::WorkerFailure > failures;
+    SupervisorFunctions::runSupervisedLoop(
+      listingGroups.size(),
+      numberOfWorkers,
+      workerFolder,
+      evaluateListingGroup,
+      failures);
+
+    SupervisorFunctions::openJournal(journalPath,settings.calculationHash,
+                                     journalEntries);
+    std::set< std::string > journaled;
+    for(auto const &entry : journalEntries){
+      size_t indexTicker = 0;
+      if(restoreJournalEntry(entry,tickerIndices,tickerRecords,
+                             manifest.entries,indexTicker)){
+        journaled.insert(tickerFileNames[indexTicker]);
       }
+    }
 
-      nlohmann::ordered_json revenueFcfModelAvgJson;
-      if(revenueFcfModelAvg.dateModel.size()>0){
-        NumericalFunctions::appendEmpiricalGrowthModelRecent(
-          revenueFcfModelAvgJson,
-          revenueFcfModelAvg.model[0],"");
+    for(auto const &failure : failures){
+      for(auto const &indexTicker : listingGroups[failure.taskIndex]){
+        const std::string &fileName = tickerFileNames[indexTicker];
+        if(journaled.count(fileName) > 0){
+          continue;
+        }
+        nlohmann::ordered_json entry;
+        entry["file"]      = fileName;
+        entry["status"]    = ShardFunctions::FAILED;
+        entry["exit_code"] = failure.exitCode;
+        entry["signal"]    = (failure.signal != 0) ?
+          SupervisorFunctions::getSignalName(failure.signal) : "";
+        entry["error"]     = failure.error;
+        SupervisorFunctions::appendJournalEntry(journalPath,entry);
+        size_t indexRestored = 0;
+        restoreJournalEntry(entry,tickerIndices,tickerRecords,
+                            manifest.entries,indexRestored);
+        std::cerr << "Error: " << fileName << " failed: the worker "
+                  << "evaluating it exited";
+        if(failure.signal != 0){
+          std::cerr << " with " 
+                    << SupervisorFunctions::getSignalName(failure.signal);
+        }
+        std::cerr << std::endl;
       }
-      //
-      // Pricing model
-      //
-            
-      //Downsample all outgoing data.
-      //Each year gets 12 data points + the last entry gets added
-      nlohmann::ordered_json priceGrowthModelJson;      
-      if(priceModel.x.size()>0){
-        DataStructures::EmpiricalGrowthModel priceModelDS;
-        int previousMonth=0;
-        double previousDate=0.;
-
-        //Copy over all the model meta-data
-        priceModelDS.modelType                   = priceModel.modelType                  ;  
-        priceModelDS.duration                    = priceModel.duration                   ;   
-        priceModelDS.annualGrowthRateOfTrendline = priceModel.annualGrowthRateOfTrendline;   
-        priceModelDS.r2                          = priceModel.r2                         ;   
-        priceModelDS.r2Trendline                 = priceModel.r2Trendline                ;  
-        priceModelDS.r2Cyclic                    = priceModel.r2Cyclic                   ;  
-        priceModelDS.validFitting                = priceModel.validFitting               ;     
-        priceModelDS.outlierCount                = priceModel.outlierCount               ; 
-        priceModelDS.parameters                  = priceModel.parameters                 ;   
-
-
-        for(size_t i=0; i<priceModel.x.size();++i){
-          int month = std::floor( (            priceModel.x[i]
-                                  -std::floor(priceModel.x[i]))*12.0);
-          if(month != previousMonth){
-            priceModelDS.x.push_back(
-                priceModel.x[i]);
-            priceModelDS.y.push_back(
-                priceModel.y[i]);
-            priceModelDS.yTrendline.push_back(
-                priceModel.yTrendline[i]);
-            priceModelDS.yCyclic.push_back(
-                priceModel.yCyclic[i]);
-            priceModelDS.yCyclicData.push_back(
-                priceModel.yCyclicData[i]);
-            priceModelDS.yCyclicNorm.push_back(
-                priceModel.yCyclicNorm[i]);
-            priceModelDS.yCyclicNormData.push_back(
-                priceModel.yCyclicNormData[i]);
-            priceModelDS.yCyclicNormDataPercentiles.push_back(
-                priceModel.yCyclicNormDataPercentiles[i]);
-            previousDate = priceModel.x[i];
-          }  
-          previousMonth=month;                               
+    }
+  }else{
+    //While a thread evaluates a group the files of the next groups in its 
+    //block are read by the I/O threads of the prefetcher
+    int numberOfConsumers = numberOfThreads;
+    if(numberOfConsumers < 1){
+      numberOfConsumers = 
+        std::max(static_cast<int>(std::thread::hardware_concurrency()),1);
+    }
+    PrefetchFunctions::FilePrefetcher prefetcher(
+      listingGroups.size(),
+      [&](size_t indexGroup, std::vector< std::string > &pathsUpd){
+        size_t indexPrimary = listingGroups[indexGroup][0];
+        const std::string &fileName = tickerFileNames[indexPrimary];
+        const std::string &primaryFileName = primaryFileNames[indexPrimary];
+        pathsUpd.push_back(fundamentalFolder+fileName);
+        if(primaryFileName.compare(fileName) != 0){
+          pathsUpd.push_back(fundamentalFolder+primaryFileName);
         }
+        pathsUpd.push_back(historicalFolder+primaryFileName);
+      },
+      static_cast<size_t>(std::max(prefetchCount,0)),
+      numberOfConsumers,
+      std::max(numberOfConsumers/4,1));
+
+    ParallelFunctions::runWorkStealingLoop(
+      listingGroups.size(),
+      numberOfThreads,
+      true,
+      [&](size_t indexGroup, int){
+        PrefetchFunctions::TaskScope prefetchedFiles(&prefetcher,indexGroup);
+        evaluateListingGroup(indexGroup);
+      });
+  }
 
-        if(priceModel.x.back() !=  previousDate){
-            priceModelDS.x.push_back(
-                priceModel.x.back());
-            priceModelDS.y.push_back(
-                priceModel.y.back());
-            priceModelDS.yTrendline.push_back(
-                priceModel.yTrendline.back());
-            priceModelDS.yCyclic.push_back(
-                priceModel.yCyclic.back());    
-            priceModelDS.yCyclicData.push_back(
-                priceModel.yCyclicData.back());
-            priceModelDS.yCyclicNorm.push_back(
-                priceModel.yCyclicNorm.back());
-            priceModelDS.yCyclicNormData.push_back(
-                priceModel.yCyclicNormData.back());
-            priceModelDS.yCyclicNormDataPercentiles.push_back(
-                priceModel.yCyclicNormDataPercentiles.back());
-        }
+  if(ProfilingFunctions::isEnabled()){
+    if(ProfilingFunctions::writeProfile(profilePath,profileTracePath)){
+      std::cout << "Profile written to " << profilePath << std::endl;
+    }
+  }
 
+  //============================================================================
+  // Tickers that crashed their worker, in this run or in the run that was
+  // resumed, are listed in the failure manifest along with their error 
+  // output.
+  //============================================================================
+  SupervisorFunctions::openJournal(journalPath,settings.calculationHash,
+                                   journalEntries);
+  writeFailureManifest(failureManifestPath,journalEntries);
 
-        NumericalFunctions::appendEmpiricalGrowthModelRecent(
-            priceGrowthModelJson,
-            priceModelDS,"");
-      }
-      //
-      // Package all three into a single json object
-      //
-      analysis["data_recency"] = dataDatesReport;
-      analysis["country_data"] = stringDataReport;
-      analysis["annual_milestones"] = annualMilestoneReport;
-      analysis["price_to_value_current"] = recentPriceToValueJson;
-      analysis["fund_liquidity_index"] = sp500LiqudityMetricJson;
-      analysis["metric_data"]                     = metricAnalysisJson;
-      analysis["dividend_yield_growth_model"]     = dividendYieldGrowthModelJson;
-      analysis["dividend_yield_growth_model_avg"] = dividendYieldGrowthModelAvgJson;
-      analysis["dividends_paid_growth_model_avg"] = dividendGrowthModelAvgJson;
-      analysis["dividends_paid_growth_model_recent"] = dividendGrowthModelJson;
-      analysis["equity_growth_model_avg"]         = equityGrowthModelAvgJson;
-      analysis["equity_growth_model_recent"]      = equityGrowthModelJson;
-      analysis["eps_growth_model_avg"]            = epsGrowthModelAvgJson;
-      analysis["eps_growth_model_recent"]         = epsGrowthModelJson;
-      analysis["grossProfit_growth_model_avg"]    = grossProfitGrowthModelAvgJson;
-      analysis["grossProfit_growth_model_recent"] = grossProfitGrowthModelJson;
-      analysis["fcf_growth_model_avg"]            = fcfGrowthModelAvgJson;
-      analysis["fcf_growth_model_recent"]         = fcfGrowthModelJson;
-      analysis["revenue_growth_model_avg"]        = revenueGrowthModelAvgJson;
-      analysis["revenue_growth_model_recent"]     = revenueGrowthModelJson;
-
-      analysis["atoi_growth_model_avg"]     = atoiGrowthModelAverageJson;
-      analysis["atoi_growth_model_recent"]  = atoiGrowthModelRecentJson;
-      analysis["price_growth_model"]        = priceGrowthModelJson;
-
-      analysis["revenue_to_fcf_model_avg"]    = revenueFcfModelAvgJson;
-      analysis["revenue_to_fcf_model_recent"] = revenueFcfModelJson;
-
-
-
-      std::string outputFilePath(analyseFolder);
-      std::string outputFileName(fileName.c_str());    
-      outputFilePath.append(outputFileName);
-
-      std::ofstream outputFileStream(outputFilePath,
-          std::ios_base::trunc | std::ios_base::out);
-      outputFileStream << analysis;
-      outputFileStream.close();
-    }
+  std::chrono::duration<double> elapsedTime = 
+    std::chrono::steady_clock::now()-startTime;
+  manifest.elapsedTimeInSeconds = elapsedTime.count();
 
-    ++count;
+  if(shard.enabled){
+    ShardFunctions::writeManifest(manifestFolder,manifest,verbose);
+  }
 
-    if(loadSingleTicker){
-      std::cout << "Done evaluating: " << singleFileToEvaluate << std::endl;
-      break;
+  //============================================================================
+  // Write the calculation manifest. The records of tickers that were not
+  // part of this run (e.g. when a single ticker is evaluated) are kept. 
+  // Tickers that failed have no record and so are evaluated again next time.
+  //============================================================================
+  nlohmann::ordered_json calculationManifest;
+  calculationManifest["version"]             = CALCULATION_MANIFEST_VERSION;
+  calculationManifest["configuration_hash"]  = configurationHash;
+  calculationManifest["reference_data_hash"] = referenceDataHash;
+  calculationManifest["tickers"]             = previousTickerRecords;
+  for(size_t i=0; i<tickerFileNames.size(); ++i){
+    if(tickerRecords[i].is_null() || tickerRecords[i].empty()){
+      calculationManifest["tickers"].erase(tickerFileNames[i]);
+    }else{
+      calculationManifest["tickers"][tickerFileNames[i]] = tickerRecords[i];
     }
   }
 
+  std::string calculationManifestTmpPath = calculationManifestPath;
+  calculationManifestTmpPath.append(".tmp");
+  std::ofstream calculationManifestStream(calculationManifestTmpPath,
+      std::ios_base::trunc | std::ios_base::out);
+  if(calculationManifestStream.is_open()){
+    calculationManifestStream << calculationManifest.dump(2);
+    calculationManifestStream.close();
+    std::filesystem::rename(calculationManifestTmpPath,
+                            calculationManifestPath);
+    //The run is complete and so is not resumed
+    std::error_code errorCode;
+    std::filesystem::remove(journalPath,errorCode);
+  }else{
+    std::cerr << "Warning: could not write the calculation manifest "
+              << calculationManifestPath << std::endl;
+  }
 
+  if(loadSingleTicker){
+    std::cout << "Done evaluating: " << singleFileToEvaluate << std::endl;
+  }
 
 
   //For each file in the list
@@ -23,6 +23,8 @@
 #include "PlottingFunctions.h"
 #include "ReportingFunctions.h"
 #include "ScreenerFunctions.h"
+#include "ShardFunctions.h"
+#include "PrefetchFunctions.h"
 
 struct TickerSet{
   std::vector< std::string > filtered;
@@ -799,7 +801,12 @@ int main (int argc, char* argv[]) {
   std::string comparisonReportFolder;  
   std::string dateOfTable;
 
-  bool verbose;
+  bool verbose = false;
+
+  ShardFunctions::ShardSettings shard;
+  std::string manifestFolder;
+  std::string filterManifestPath;
+  int prefetchCount = 0;
 
   try{
     TCLAP::CmdLine cmd("The command will compare the results of multiple "
@@ -857,6 +864,34 @@ int main (int argc, char* argv[]) {
 
     cmd.add(comparisonReportConfigurationFilePathInput);    
 
+    TCLAP::ValueArg<std::string> shardInput("s","shard", 
+      "Apply the filters only to shard i of N (e.g. 2/8) and write the result "
+      "to a shard manifest. No report is written: merge the manifests with "
+      "mergeShards and pass the merged manifest to the -l option.",
+      false,"","string");
+    cmd.add(shardInput);
+
+    TCLAP::ValueArg<std::string> manifestFolderInput("m","manifest_folder", 
+      "The folder that the shard manifest is written to. By default this is "
+      "the current directory.",
+      false,"","string");
+    cmd.add(manifestFolderInput);
+
+    TCLAP::ValueArg<std::string> filterManifestPathInput("l",
+      "filter_manifest", 
+      "A merged manifest (from mergeShards) of sharded runs. The tickers that "
+      "passed each screen are taken from this file rather than filtering "
+      "every ticker again.",
+      false,"","string");
+    cmd.add(filterManifestPathInput);
+
+    TCLAP::ValueArg<int> prefetchInput("z","prefetch", 
+      "The number of tickers after the current one whose files are read "
+      "ahead by a background I/O thread (0 to read each file when it is "
+      "needed).",
+      false,2,"int");
+    cmd.add(prefetchInput);
+
     TCLAP::SwitchArg verboseInput("v","verbose",
       "Verbose output printed to screen", false);
     cmd.add(verboseInput);    
@@ -873,6 +908,18 @@ int main (int argc, char* argv[]) {
     comparisonReportFolder    = comparisonReportFolderOutput.getValue();    
     dateOfTable               = dateOfTableInput.getValue();
     verbose                   = verboseInput.getValue();
+    manifestFolder            = manifestFolderInput.getValue();
+    filterManifestPath        = filterManifestPathInput.getValue();
+    prefetchCount             = prefetchInput.getValue();
+
+    bool validShard = 
+      ShardFunctions::parseShardSettings(shardInput.getValue(),shard);
+    if(!validShard){
+      std::cerr << "Error: the shard must be of the form i/N with "
+                << "1 <= i <= N but is " << shardInput.getValue() 
+                << std::endl;
+      std::abort();
+    }
 
     if(verbose){
       std::cout << "  Exchange Code" << std::endl;
@@ -902,6 +949,18 @@ int main (int argc, char* argv[]) {
       std::cout << "  Comparison Report Folder" << std::endl;
       std::cout << "    " << comparisonReportFolder << std::endl;  
 
+      if(shard.enabled){
+        std::cout << "  Shard" << std::endl;
+        std::cout << "    " << shard.index << "/" << shard.count << std::endl;
+      }
+
+      if(filterManifestPath.length()>0){
+        std::cout << "  Filter Manifest" << std::endl;
+        std::cout << "    " << filterManifestPath << std::endl;
+      }
+
+      std::cout << "  Number of tickers prefetched" << std::endl;
+      std::cout << "    " << prefetchCount << std::endl;
     }
 
   } catch (TCLAP::ArgException &e){ 
@@ -983,11 +1042,62 @@ int main (int argc, char* argv[]) {
     }
   }
 
-  for (const auto & file 
-        : std::filesystem::directory_iterator(calculateDataFolder)){    
+  std::vector< std::string > fileNames;
+  if(filterManifestPath.length()==0){
+    for (const auto & file 
+          : std::filesystem::directory_iterator(calculateDataFolder)){    
+      fileNames.push_back(file.path().filename());
+    }
+    std::sort(fileNames.begin(),fileNames.end());
+  }else{
+    for(size_t i=0; i<tickerSet.size(); ++i){
+      int numberOfTickersInManifest=0;
+      bool loadedFilterManifest = 
+        ShardFunctions::readScreenedTickers(filterManifestPath,
+                                            static_cast<int>(i),
+                                            tickerSet[i].filtered,
+                                            numberOfTickersInManifest,
+                                            verbose);
+      if(!loadedFilterManifest){
+        std::cerr << "Error: cannot open " << filterManifestPath 
+                  << std::endl;
+        std::abort();
+      }
+    }
+  }
+
+  ShardFunctions::ShardManifest manifest;
+  ShardFunctions::selectShard("generateComparisonReport",shard,fileNames,
+                              manifest);
+  manifest.hasScreenResults=true;
+  auto startTime = std::chrono::steady_clock::now();
+
+  //The files of the next tickers are read while this one is filtered
+  PrefetchFunctions::FilePrefetcher filterPrefetcher(
+    fileNames.size(),
+    [&](size_t indexFile, std::vector< std::string > &pathsUpd){
+      if(useFundamentalData){
+        pathsUpd.push_back(fundamentalFolder+fileNames[indexFile]);
+      }
+      if(useHistoricalData){
+        pathsUpd.push_back(historicalFolder+fileNames[indexFile]);
+      }
+      if(useCalculateData){
+        pathsUpd.push_back(calculateDataFolder+fileNames[indexFile]);
+      }
+    },
+    static_cast<size_t>(std::max(prefetchCount,0)),1,1);
+
+  for (size_t indexFile=0; indexFile < fileNames.size(); ++indexFile){    
+
+    PrefetchFunctions::TaskScope prefetchedFiles(&filterPrefetcher,indexFile);
 
     bool validInput = true;
-    std::string fileName   = file.path().filename();
+    std::string fileName   = fileNames[indexFile];
+
+    ShardFunctions::ShardManifestEntry manifestEntry;
+    manifestEntry.ticker = ShardFunctions::getTickerName(fileName);
+    auto tickerStartTime = std::chrono::steady_clock::now();
     std::size_t fileExtPos = fileName.find(analysisExt);
     //if(verbose){
     //  std::cout << fileName << std::endl;
@@ -1077,11 +1187,27 @@ int main (int argc, char* argv[]) {
                       << comparisonConfig["screens"].size()
                       << std::endl; 
           }
+          manifestEntry.passedScreen = screenCount;
           break;
         }
         ++screenCount;
       }
     }
+
+    manifestEntry.status = validInput ? 
+      ShardFunctions::PROCESSED : ShardFunctions::SKIPPED;
+    std::chrono::duration<double> tickerElapsedTime = 
+      std::chrono::steady_clock::now()-tickerStartTime;
+    manifestEntry.elapsedTimeInSeconds = tickerElapsedTime.count();
+    manifest.entries.push_back(manifestEntry);
+  }
+
+  if(shard.enabled){
+    std::chrono::duration<double> elapsedTime = 
+      std::chrono::steady_clock::now()-startTime;
+    manifest.elapsedTimeInSeconds = elapsedTime.count();
+    ShardFunctions::writeManifest(manifestFolder,manifest,verbose);
+    return 0;
   }
 
   //
@@ -1129,7 +1255,28 @@ int main (int argc, char* argv[]) {
       
       ScreenerFunctions::MetricSummaryDataSet metricSummaryData;
 
+      const std::vector< std::string > &filteredTickers = 
+        tickerSet[screenCount].filtered;
+      PrefetchFunctions::FilePrefetcher rankingPrefetcher(
+        filteredTickers.size(),
+        [&](size_t indexTicker, std::vector< std::string > &pathsUpd){
+          if(useFundamentalData){
+            pathsUpd.push_back(fundamentalFolder+filteredTickers[indexTicker]);
+          }
+          if(useHistoricalData){
+            pathsUpd.push_back(historicalFolder+filteredTickers[indexTicker]);
+          }
+          if(useCalculateData){
+            pathsUpd.push_back(
+              calculateDataFolder+filteredTickers[indexTicker]);
+          }
+        },
+        static_cast<size_t>(std::max(prefetchCount,0)),1,1);
+
       for(size_t i=0; i< tickerSet[screenCount].filtered.size();++i){
+
+        PrefetchFunctions::TaskScope prefetchedFiles(&rankingPrefetcher,i);
+
         //
         //Load the fundamental, historical, and calculate data
         //once so that the necessary ranking information can be retreived
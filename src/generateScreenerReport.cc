@@ -23,6 +23,8 @@
 #include "PlottingFunctions.h"
 #include "ReportingFunctions.h"
 #include "ScreenerFunctions.h"
+#include "ShardFunctions.h"
+#include "PrefetchFunctions.h"
 
 //==============================================================================
 void plotScreenerReportData(
@@ -548,7 +550,12 @@ int main (int argc, char* argv[]) {
   std::string screenerReportFolder;  
   std::string dateOfTable;
 
-  bool verbose;
+  bool verbose = false;
+
+  ShardFunctions::ShardSettings shard;
+  std::string manifestFolder;
+  std::string filterManifestPath;
+  int prefetchCount = 0;
 
   try{
     TCLAP::CmdLine cmd("The command will produce a screen report in the form of"
@@ -606,6 +613,34 @@ int main (int argc, char* argv[]) {
 
     cmd.add(screenerReportConfigurationFilePathInput);    
 
+    TCLAP::ValueArg<std::string> shardInput("s","shard", 
+      "Apply the filter only to shard i of N (e.g. 2/8) and write the result "
+      "to a shard manifest. No report is written: merge the manifests with "
+      "mergeShards and pass the merged manifest to the -l option.",
+      false,"","string");
+    cmd.add(shardInput);
+
+    TCLAP::ValueArg<std::string> manifestFolderInput("m","manifest_folder", 
+      "The folder that the shard manifest is written to. By default this is "
+      "the current directory.",
+      false,"","string");
+    cmd.add(manifestFolderInput);
+
+    TCLAP::ValueArg<std::string> filterManifestPathInput("l",
+      "filter_manifest", 
+      "A merged manifest (from mergeShards) of sharded runs. The tickers that "
+      "passed the filter are taken from this file rather than filtering "
+      "every ticker again.",
+      false,"","string");
+    cmd.add(filterManifestPathInput);
+
+    TCLAP::ValueArg<int> prefetchInput("z","prefetch", 
+      "The number of tickers after the current one whose files are read "
+      "ahead by a background I/O thread (0 to read each file when it is "
+      "needed).",
+      false,2,"int");
+    cmd.add(prefetchInput);
+
     TCLAP::SwitchArg verboseInput("v","verbose",
       "Verbose output printed to screen", false);
     cmd.add(verboseInput);    
@@ -622,6 +657,18 @@ int main (int argc, char* argv[]) {
     screenerReportFolder      = screenerReportFolderOutput.getValue();    
     dateOfTable               = dateOfTableInput.getValue();
     verbose                   = verboseInput.getValue();
+    manifestFolder            = manifestFolderInput.getValue();
+    filterManifestPath        = filterManifestPathInput.getValue();
+    prefetchCount             = prefetchInput.getValue();
+
+    bool validShard = 
+      ShardFunctions::parseShardSettings(shardInput.getValue(),shard);
+    if(!validShard){
+      std::cerr << "Error: the shard must be of the form i/N with "
+                << "1 <= i <= N but is " << shardInput.getValue() 
+                << std::endl;
+      std::abort();
+    }
 
     if(verbose){
       std::cout << "  Exchange Code" << std::endl;
@@ -651,6 +698,18 @@ int main (int argc, char* argv[]) {
       std::cout << "  Screener Report Folder" << std::endl;
       std::cout << "    " << screenerReportFolder << std::endl;  
 
+      if(shard.enabled){
+        std::cout << "  Shard" << std::endl;
+        std::cout << "    " << shard.index << "/" << shard.count << std::endl;
+      }
+
+      if(filterManifestPath.length()>0){
+        std::cout << "  Filter Manifest" << std::endl;
+        std::cout << "    " << filterManifestPath << std::endl;
+      }
+
+      std::cout << "  Number of tickers prefetched" << std::endl;
+      std::cout << "    " << prefetchCount << std::endl;
     }
 
   } catch (TCLAP::ArgException &e){ 
@@ -673,9 +732,12 @@ int main (int argc, char* argv[]) {
   std::filesystem::path screenReportPath(screenerReportFolder);
   screenReportPath.append(screenName);
 
-  if(!std::filesystem::create_directory(screenReportPath)){
-    for (auto& path: std::filesystem::directory_iterator(screenReportPath)) {
-        std::filesystem::remove_all(path);
+  //A sharded run only filters, and so it leaves the report folder alone
+  if(!shard.enabled){
+    if(!std::filesystem::create_directory(screenReportPath)){
+      for (auto& path: std::filesystem::directory_iterator(screenReportPath)) {
+          std::filesystem::remove_all(path);
+      }
     }
   }
 
@@ -734,13 +796,59 @@ int main (int argc, char* argv[]) {
       }
     }
 
-    for (const auto & file 
-          : std::filesystem::directory_iterator(calculateDataFolder)){  
+    std::vector< std::string > fileNames;
+    if(filterManifestPath.length()==0){
+      for (const auto & file 
+            : std::filesystem::directory_iterator(calculateDataFolder)){  
+        fileNames.push_back(file.path().filename());
+      }
+      std::sort(fileNames.begin(),fileNames.end());
+    }else{
+      bool loadedFilterManifest = 
+        ShardFunctions::readScreenedTickers(filterManifestPath,0,
+                                            filteredTickers,totalFileCount,
+                                            verbose);
+      if(!loadedFilterManifest){
+        std::cerr << "Error: cannot open " << filterManifestPath 
+                  << std::endl;
+        std::abort();
+      }
+    }
+
+    ShardFunctions::ShardManifest manifest;
+    ShardFunctions::selectShard("generateScreenerReport",shard,fileNames,
+                                manifest);
+    manifest.hasScreenResults=true;
+    auto startTime = std::chrono::steady_clock::now();
+
+    //The files of the next tickers are read while this one is filtered
+    PrefetchFunctions::FilePrefetcher filterPrefetcher(
+      fileNames.size(),
+      [&](size_t indexFile, std::vector< std::string > &pathsUpd){
+        if(useFundamentalData){
+          pathsUpd.push_back(fundamentalFolder+fileNames[indexFile]);
+        }
+        if(useHistoricalData){
+          pathsUpd.push_back(historicalFolder+fileNames[indexFile]);
+        }
+        if(useCalculateData){
+          pathsUpd.push_back(calculateDataFolder+fileNames[indexFile]);
+        }
+      },
+      static_cast<size_t>(std::max(prefetchCount,0)),1,1);
+
+    for (size_t indexFile=0; indexFile < fileNames.size(); ++indexFile){  
 
+      PrefetchFunctions::TaskScope prefetchedFiles(&filterPrefetcher,
+                                                   indexFile);
       ++totalFileCount;
       bool validInput = true;
 
-      std::string fileName   = file.path().filename();
+      std::string fileName   = fileNames[indexFile];
+
+      ShardFunctions::ShardManifestEntry manifestEntry;
+      manifestEntry.ticker = ShardFunctions::getTickerName(fileName);
+      auto tickerStartTime = std::chrono::steady_clock::now();
 
       std::size_t fileExtPos = fileName.find(analysisExt);
 
@@ -835,6 +943,21 @@ int main (int argc, char* argv[]) {
         }
       }
 
+      manifestEntry.status = validInput ? 
+        ShardFunctions::PROCESSED : ShardFunctions::SKIPPED;
+      manifestEntry.passedScreen = tickerPassesFilter ? 0 : -1;
+      std::chrono::duration<double> tickerElapsedTime = 
+        std::chrono::steady_clock::now()-tickerStartTime;
+      manifestEntry.elapsedTimeInSeconds = tickerElapsedTime.count();
+      manifest.entries.push_back(manifestEntry);
+    }
+
+    if(shard.enabled){
+      std::chrono::duration<double> elapsedTime = 
+        std::chrono::steady_clock::now()-startTime;
+      manifest.elapsedTimeInSeconds = elapsedTime.count();
+      ShardFunctions::writeManifest(manifestFolder,manifest,verbose);
+      return 0;
     }
 
     if(verbose){
@@ -883,8 +1006,24 @@ int main (int argc, char* argv[]) {
         }
       }
 
+      PrefetchFunctions::FilePrefetcher rankingPrefetcher(
+        filteredTickers.size(),
+        [&](size_t indexTicker, std::vector< std::string > &pathsUpd){
+          pathsUpd.push_back(fundamentalFolder+filteredTickers[indexTicker]);
+          if(useHistoricalData){
+            pathsUpd.push_back(historicalFolder+filteredTickers[indexTicker]);
+          }
+          if(useCalculateData){
+            pathsUpd.push_back(
+              calculateDataFolder+filteredTickers[indexTicker]);
+          }
+        },
+        static_cast<size_t>(std::max(prefetchCount,0)),1,1);
+
       for (size_t i=0; i<filteredTickers.size(); ++i){
 
+        PrefetchFunctions::TaskScope prefetchedFiles(&rankingPrefetcher,i);
+
         if(verbose){
           std::cout << i << "." << '\t' << filteredTickers[i] << std::endl;
         }        
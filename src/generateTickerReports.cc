@@ -23,6 +23,8 @@
 #include "JsonFunctions.h"
 #include "ReportingFunctions.h"
 #include "PlottingFunctions.h"
+#include "ShardFunctions.h"
+#include "PrefetchFunctions.h"
 
 //==============================================================================
 enum DataType{
@@ -2155,8 +2157,12 @@ int main (int argc, char* argv[]) {
 
   std::string singleFileToEvaluate;
 
-  bool gapFill;
-  bool verbose;
+  bool gapFill = false;
+  bool verbose = false;
+
+  ShardFunctions::ShardSettings shard;
+  std::string manifestFolder;
+  int prefetchCount = 0;
 
   try{
     TCLAP::CmdLine cmd("The command will produce reports in the form of text "
@@ -2223,6 +2229,25 @@ int main (int argc, char* argv[]) {
       " in the output folder.", false);
     cmd.add(gapFillInput);    
 
+    TCLAP::ValueArg<std::string> shardInput("s","shard", 
+      "Generate reports only for shard i of N (e.g. 2/8). Tickers are "
+      "assigned to shards using a hash of the ticker name.",
+      false,"","string");
+    cmd.add(shardInput);
+
+    TCLAP::ValueArg<std::string> manifestFolderInput("m","manifest_folder", 
+      "The folder that the shard manifest is written to. By default this is "
+      "the current directory.",
+      false,"","string");
+    cmd.add(manifestFolderInput);
+
+    TCLAP::ValueArg<int> prefetchInput("z","prefetch", 
+      "The number of tickers after the current one whose files are read "
+      "ahead by a background I/O thread (0 to read each file when it is "
+      "needed). Not used in gap fill mode.",
+      false,2,"int");
+    cmd.add(prefetchInput);
+
     TCLAP::SwitchArg verboseInput("v","verbose",
       "Verbose output printed to screen", false);
     cmd.add(verboseInput);    
@@ -2242,6 +2267,17 @@ int main (int argc, char* argv[]) {
     reportFolder             = reportFolderOutput.getValue();
     gapFill                  = gapFillInput.getValue();
     verbose                  = verboseInput.getValue();
+    manifestFolder           = manifestFolderInput.getValue();
+    prefetchCount            = prefetchInput.getValue();
+
+    bool validShard = 
+      ShardFunctions::parseShardSettings(shardInput.getValue(),shard);
+    if(!validShard){
+      std::cerr << "Error: the shard must be of the form i/N with "
+                << "1 <= i <= N but is " << shardInput.getValue() 
+                << std::endl;
+      std::abort();
+    }
 
     if(verbose){
       std::cout << "  Exchange Code" << std::endl;
@@ -2275,6 +2311,14 @@ int main (int argc, char* argv[]) {
 
       std::cout << "  Gapfill mode " << std::endl;
       std::cout << "    " << gapFill << std::endl;      
+
+      std::cout << "  Number of tickers prefetched" << std::endl;
+      std::cout << "    " << prefetchCount << std::endl;
+
+      if(shard.enabled){
+        std::cout << "  Shard" << std::endl;
+        std::cout << "    " << shard.index << "/" << shard.count << std::endl;
+      }
     }
 
   } catch (TCLAP::ArgException &e){ 
@@ -2374,20 +2418,48 @@ int main (int argc, char* argv[]) {
 
 
 
-  for (const auto & file 
-        : std::filesystem::directory_iterator(calculateDataFolder)){  
+  std::vector< std::string > fileNames;
+  if(singleFileToEvaluate.length() > 0){
+    fileNames.push_back(singleFileToEvaluate);
+  }else{
+    for (const auto & file 
+          : std::filesystem::directory_iterator(calculateDataFolder)){  
+      fileNames.push_back(file.path().filename());
+    }
+    std::sort(fileNames.begin(),fileNames.end());
+  }
 
+  ShardFunctions::ShardManifest manifest;
+  ShardFunctions::selectShard("generateTickerReports",shard,fileNames,
+                              manifest);
+  auto startTime = std::chrono::steady_clock::now();
+
+  //The files of the next tickers are read while this report is generated.
+  //In gap fill mode most tickers are skipped, and so nothing is prefetched.
+  PrefetchFunctions::FilePrefetcher prefetcher(
+    fileNames.size(),
+    [&](size_t indexFile, std::vector< std::string > &pathsUpd){
+      pathsUpd.push_back(fundamentalFolder+fileNames[indexFile]);
+      pathsUpd.push_back(historicalFolder+fileNames[indexFile]);
+      pathsUpd.push_back(calculateDataFolder+fileNames[indexFile]);
+    },
+    gapFill ? 0 : static_cast<size_t>(std::max(prefetchCount,0)),1,1);
+
+  for (size_t indexFile=0; indexFile < fileNames.size(); ++indexFile){  
+
+    PrefetchFunctions::TaskScope prefetchedFiles(&prefetcher,indexFile);
     ++totalFileCount;
     bool validInput = true;
 
+    ShardFunctions::ShardManifestEntry manifestEntry;
+    manifestEntry.ticker = ShardFunctions::getTickerName(fileNames[indexFile]);
+    manifestEntry.status = ShardFunctions::SKIPPED;
+    auto tickerStartTime = std::chrono::steady_clock::now();
+
     //
     // Check the file name
     //    
-    std::string fileName   = file.path().filename();
-
-    if(singleFileToEvaluate.length() > 0){
-      fileName = singleFileToEvaluate;
-    }    
+    std::string fileName   = fileNames[indexFile];
 
     std::size_t fileExtPos = fileName.find(analysisExt);
 
@@ -2592,16 +2664,34 @@ int main (int argc, char* argv[]) {
           }
 
           ++validFileCount;     
+          if(successGenerateLaTeXReport){
+            manifestEntry.status = ShardFunctions::PROCESSED;
+          }else{
+            manifestEntry.status = ShardFunctions::FAILED;
+          }
         }
       }
 
 
     }
 
+    std::chrono::duration<double> tickerElapsedTime = 
+      std::chrono::steady_clock::now()-tickerStartTime;
+    manifestEntry.elapsedTimeInSeconds = tickerElapsedTime.count();
+    manifest.entries.push_back(manifestEntry);
+
     if(singleFileToEvaluate.length() > 0){
       break;
     }
   }
+
+  std::chrono::duration<double> elapsedTime = 
+    std::chrono::steady_clock::now()-startTime;
+  manifest.elapsedTimeInSeconds = elapsedTime.count();
+
+  if(shard.enabled){
+    ShardFunctions::writeManifest(manifestFolder,manifest,verbose);
+  }
  
   if(verbose){
     if(gapFill){
@@ -0,0 +1,350 @@
+//SPDX-FileCopyrightText: 2023 Matthew Millard millard.matthew@gmail.com
+//SPDX-License-Identifier: MIT
+
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <iostream>
+#include <map>
+#include <set>
+
+#include <nlohmann/json.hpp>
+#include <tclap/CmdLine.h>
+
+#include <filesystem>
+
+#include "JsonFunctions.h"
+#include "ShardFunctions.h"
+
+
+int main (int argc, char* argv[]) {
+
+  std::string manifestFolder;
+  std::string toolName;
+  std::string outputFileName;
+  std::string inputFolder;
+  std::string exchangeCode;
+  bool verbose;
+
+  try{
+    TCLAP::CmdLine cmd("The command combines the shard manifests written by "
+    "calculate, generateTickerReports, generateScreenerReport or "
+    "generateComparisonReport when run with the --shard option, and checks "
+    "that every ticker was covered exactly once."
+    ,' ', "0.0");
+
+    TCLAP::ValueArg<std::string> manifestFolderInput("m",
+      "manifest_folder",
+      "The path to the folder that contains the shard manifests",
+      true,"","string");
+    cmd.add(manifestFolderInput);
+
+    TCLAP::ValueArg<std::string> toolNameInput("n",
+      "tool_name",
+      "The name of the tool that wrote the manifests (e.g. calculate)",
+      true,"","string");
+    cmd.add(toolNameInput);
+
+    TCLAP::ValueArg<std::string> outputFileNameInput("o",
+      "output_file",
+      "The path and file name of the merged manifest that will be written",
+      false,"","string");
+    cmd.add(outputFileNameInput);
+
+    TCLAP::ValueArg<std::string> inputFolderInput("d",
+      "input_folder",
+      "Optional: the folder of input files that was sharded. When this is "
+      "given the name of every ticker that is missing is reported.",
+      false,"","string");
+    cmd.add(inputFolderInput);
+
+    TCLAP::ValueArg<std::string> exchangeCodeInput("x","exchange_code",
+      "The exchange code used with the input folder. For example: US",
+      false,"","string");
+    cmd.add(exchangeCodeInput);
+
+    TCLAP::SwitchArg verboseInput("v","verbose",
+      "Verbose output printed to screen", false);
+    cmd.add(verboseInput);
+
+    cmd.parse(argc,argv);
+
+    manifestFolder  = manifestFolderInput.getValue();
+    toolName        = toolNameInput.getValue();
+    outputFileName  = outputFileNameInput.getValue();
+    inputFolder     = inputFolderInput.getValue();
+    exchangeCode    = exchangeCodeInput.getValue();
+    verbose         = verboseInput.getValue();
+
+    if(verbose){
+      std::cout << "  Manifest Folder" << std::endl;
+      std::cout << "    " << manifestFolder << std::endl;
+
+      std::cout << "  Tool Name" << std::endl;
+      std::cout << "    " << toolName << std::endl;
+
+      std::cout << "  Output File" << std::endl;
+      std::cout << "    " << outputFileName << std::endl;
+
+      std::cout << "  Input Folder" << std::endl;
+      std::cout << "    " << inputFolder << std::endl;
+
+      std::cout << "  Exchange Code" << std::endl;
+      std::cout << "    " << exchangeCode << std::endl;
+    }
+
+  } catch (TCLAP::ArgException &e)  // catch exceptions
+	{
+    std::cerr << "error: "    << e.error()
+              << " for arg "  << e.argId() << std::endl;
+  }
+
+  //============================================================================
+  // Load the manifests
+  //============================================================================
+  std::string manifestPrefix(toolName);
+  manifestPrefix.append("_shard_");
+
+  std::vector< std::string > manifestFileNames;
+  for(const auto &file : std::filesystem::directory_iterator(manifestFolder)){
+    std::string fileName = file.path().filename();
+    if(fileName.find(manifestPrefix) == 0
+       && fileName.find(".json") != std::string::npos){
+      manifestFileNames.push_back(file.path().string());
+    }
+  }
+  std::sort(manifestFileNames.begin(),manifestFileNames.end());
+
+  if(manifestFileNames.size()==0){
+    std::cerr << "Error: there are no manifests that begin with "
+              << manifestPrefix << " in " << manifestFolder << std::endl;
+    return 1;
+  }
+
+  bool complete = true;
+  int shardCount = -1;
+  int universeSize = -1;
+  std::string universeHash;
+  double totalElapsedTime = 0.;
+  double maximumElapsedTime = 0.;
+
+  std::set< int > shardIndices;
+  std::map< std::string, std::vector< int > > tickerShards;
+  std::map< std::string, nlohmann::ordered_json > tickerEntries;
+  std::vector< std::string > misassignedTickers;
+
+  for(auto const &manifestFileName : manifestFileNames){
+
+    nlohmann::ordered_json manifest;
+    bool loaded =
+      JsonFunctions::loadJsonFile(manifestFileName, manifest, verbose);
+    if(!loaded){
+      std::cerr << "Error: could not read " << manifestFileName << std::endl;
+      complete = false;
+      continue;
+    }
+
+    int shardIndex = manifest["shard_index"].get<int>();
+    int count      = manifest["shard_count"].get<int>();
+    int size       = manifest["universe_size"].get<int>();
+    std::string hash;
+    JsonFunctions::getJsonString(manifest["universe_hash"],hash);
+
+    if(verbose){
+      std::cout << shardIndex << "/" << count << '\t'
+                << manifest["tickers"].size() << " tickers" << '\t'
+                << manifest["elapsed_seconds"].get<double>() << " s"
+                << std::endl;
+    }
+
+    if(shardCount < 0){
+      shardCount   = count;
+      universeSize = size;
+      universeHash = hash;
+    }
+    if(count != shardCount){
+      std::cerr << "Error: " << manifestFileName << " was run with "
+                << count << " shards but other manifests were run with "
+                << shardCount << std::endl;
+      complete = false;
+    }
+    if(size != universeSize || hash.compare(universeHash) != 0){
+      std::cerr << "Error: " << manifestFileName << " was run over a different "
+                << "set of tickers than the other manifests" << std::endl;
+      complete = false;
+    }
+    if(!shardIndices.insert(shardIndex).second){
+      std::cerr << "Error: shard " << shardIndex
+                << " appears in more than one manifest" << std::endl;
+      complete = false;
+    }
+
+    double elapsedTime = manifest["elapsed_seconds"].get<double>();
+    totalElapsedTime  += elapsedTime;
+    maximumElapsedTime = std::max(maximumElapsedTime,elapsedTime);
+
+    for(auto &entry : manifest["tickers"]){
+      std::string ticker;
+      JsonFunctions::getJsonString(entry["ticker"],ticker);
+      tickerShards[ticker].push_back(shardIndex);
+      tickerEntries[ticker] = entry;
+      //calculate assigns the listings that share a primary by the primary
+      std::string shardKey(ticker);
+      if(entry.contains("shard_key")){
+        JsonFunctions::getJsonString(entry["shard_key"],shardKey);
+      }
+      if(ShardFunctions::getShardIndex(shardKey,count) != shardIndex){
+        misassignedTickers.push_back(ticker);
+      }
+    }
+  }
+
+  //============================================================================
+  // Check the coverage
+  //============================================================================
+  std::vector< int > missingShards;
+  for(int i=1; i<=shardCount; ++i){
+    if(shardIndices.find(i) == shardIndices.end()){
+      missingShards.push_back(i);
+      complete = false;
+    }
+  }
+
+  std::vector< std::string > duplicateTickers;
+  uint64_t mergedHash = 0;
+  for(auto const &item : tickerShards){
+    if(item.second.size() > 1){
+      duplicateTickers.push_back(item.first);
+    }
+    mergedHash ^= HashFunctions::calcStableHash(item.first);
+  }
+
+  if(duplicateTickers.size() > 0 || misassignedTickers.size() > 0){
+    complete = false;
+  }
+
+  if(static_cast<int>(tickerShards.size()) != universeSize
+     || HashFunctions::convertHashToString(mergedHash).compare(universeHash)!=0){
+    complete = false;
+  }
+
+  std::vector< std::string > missingTickers;
+  std::vector< std::string > unexpectedTickers;
+  if(inputFolder.length() > 0){
+    std::string validFileExtension = exchangeCode;
+    validFileExtension.append(".json");
+
+    std::set< std::string > inputTickers;
+    for(const auto &file : std::filesystem::directory_iterator(inputFolder)){
+      std::string fileName = file.path().filename();
+      if(fileName.find(validFileExtension) != std::string::npos){
+        inputTickers.insert(ShardFunctions::getTickerName(fileName));
+      }
+    }
+    for(auto const &ticker : inputTickers){
+      if(tickerShards.find(ticker) == tickerShards.end()){
+        missingTickers.push_back(ticker);
+      }
+    }
+    for(auto const &item : tickerShards){
+      if(inputTickers.find(item.first) == inputTickers.end()){
+        unexpectedTickers.push_back(item.first);
+      }
+    }
+    if(missingTickers.size() > 0 || unexpectedTickers.size() > 0){
+      complete = false;
+    }
+  }
+
+  //============================================================================
+  // Write the merged manifest
+  //============================================================================
+  int numberProcessed = 0;
+  int numberSkipped   = 0;
+  int numberUnchanged = 0;
+  int numberFailed    = 0;
+
+  nlohmann::ordered_json tickersJson = nlohmann::ordered_json::array();
+  for(auto const &item : tickerEntries){
+    std::string status;
+    JsonFunctions::getJsonString(item.second["status"],status);
+    if(status == ShardFunctions::PROCESSED){
+      ++numberProcessed;
+    }else if(status == ShardFunctions::SKIPPED){
+      ++numberSkipped;
+    }else if(status == ShardFunctions::UNCHANGED){
+      ++numberUnchanged;
+    }else if(status == ShardFunctions::FAILED){
+      ++numberFailed;
+    }
+    tickersJson.push_back(item.second);
+  }
+
+  nlohmann::ordered_json merged;
+  merged["tool"]                    = toolName;
+  merged["shard_count"]             = shardCount;
+  merged["universe_size"]           = universeSize;
+  merged["universe_hash"]           = universeHash;
+  merged["complete"]                = complete;
+  merged["elapsed_seconds_total"]   = totalElapsedTime;
+  merged["elapsed_seconds_maximum"] = maximumElapsedTime;
+  merged["summary"]["processed"]    = numberProcessed;
+  merged["summary"]["skipped"]      = numberSkipped;
+  merged["summary"]["unchanged"]    = numberUnchanged;
+  merged["summary"]["failed"]       = numberFailed;
+  merged["missing_shards"]          = missingShards;
+  merged["duplicate_tickers"]       = duplicateTickers;
+  merged["misassigned_tickers"]     = misassignedTickers;
+  if(inputFolder.length() > 0){
+    merged["missing_tickers"]       = missingTickers;
+    merged["unexpected_tickers"]    = unexpectedTickers;
+  }
+  merged["tickers"]                 = tickersJson;
+
+  if(outputFileName.length() > 0){
+    std::ofstream outputFileStream(outputFileName,
+        std::ios_base::trunc | std::ios_base::out);
+    outputFileStream << merged.dump(2);
+    outputFileStream.close();
+  }
+
+  //============================================================================
+  // Summary
+  //============================================================================
+  std::cout << "Merged " << manifestFileNames.size() << " of "
+            << shardCount << " " << toolName << " shards" << std::endl;
+  std::cout << '\t' << tickerShards.size() << " of " << universeSize
+            << " tickers covered" << std::endl;
+  std::cout << '\t' << numberProcessed << " processed" << std::endl;
+  std::cout << '\t' << numberSkipped   << " skipped" << std::endl;
+  std::cout << '\t' << numberUnchanged << " unchanged" << std::endl;
+  std::cout << '\t' << numberFailed    << " failed" << std::endl;
+  std::cout << '\t' << totalElapsedTime << " s in total, "
+            << maximumElapsedTime << " s in the slowest shard" << std::endl;
+
+  for(auto const &index : missingShards){
+    std::cout << "  Missing shard: " << index << std::endl;
+  }
+  for(auto const &ticker : duplicateTickers){
+    std::cout << "  Covered more than once: " << ticker << std::endl;
+  }
+  for(auto const &ticker : misassignedTickers){
+    std::cout << "  In the wrong shard: " << ticker << std::endl;
+  }
+  for(auto const &ticker : missingTickers){
+    std::cout << "  Not covered: " << ticker << std::endl;
+  }
+  for(auto const &ticker : unexpectedTickers){
+    std::cout << "  Not in the input folder: " << ticker << std::endl;
+  }
+
+  if(complete){
+    std::cout << "Every ticker was covered exactly once" << std::endl;
+    return 0;
+  }
+
+  std::cout << "Error: the shards do not cover every ticker exactly once"
+            << std::endl;
+  return 1;
+}